@@ -138,6 +138,12 @@ case "$ENABLE_OPTIMIZE" in
     *)       AC_MSG_ERROR([Unknown optimize option: "$ENABLE_OPTIMIZE"]) ;;
 esac
 
+# Flags for the few sources with batch math loops.  A sqrt() that may
+# set errno keeps such a loop from being vectorized.
+NO_MATH_ERRNO_CFLAGS=""
+AX_TRY_CPPFLAGS([-fno-math-errno], [NO_MATH_ERRNO_CFLAGS="-fno-math-errno"])
+AC_SUBST(NO_MATH_ERRNO_CFLAGS)
+
 if test x"$ENABLE_PROFILE" = "xyes"; then
     AX_TRY_CPPFLAGS([-pg], [AX_CFLAGS="$AX_CFLAGS -pg"], [AC_MSG_ERROR([Cannot enable profiling: compiler doesn't seem to support it])])
 fi
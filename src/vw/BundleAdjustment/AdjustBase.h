@@ -27,8 +27,20 @@
 #ifndef __VW_BUNDLEADJUSTMENT_ADJUST_BASE_H__
 #define __VW_BUNDLEADJUSTMENT_ADJUST_BASE_H__
 
+#include <vw/Core/Debugging.h>
+#include <vw/Core/Stopwatch.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/BundleAdjustment/ModelBase.h>
 #include <boost/foreach.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace vw {
 namespace ba {
@@ -217,6 +229,93 @@ namespace ba {
     return ret;
   };
 
+  // THREADING AND TIMING HELPERS
+  //--------------------------------------------------------
+
+  // Wall clock seconds spent in each stage of an update step, in the
+  // order the stages ran.
+  typedef std::vector<std::pair<std::string,double> > IterationTiming;
+
+  // Scoped timer for one stage of an update step. It logs to "ba" the
+  // same way vw::Timer does and appends the elapsed time to a timing
+  // record so the report can show where an iteration went.
+  class StageTimer : private boost::noncopyable {
+    Timer m_timer;
+    Stopwatch m_watch;
+    std::string m_name;
+    IterationTiming& m_record;
+  public:
+    StageTimer( std::string const& name, IterationTiming& record ) :
+      m_timer( name, DebugMessage, "ba" ), m_name(name), m_record(record) {
+      m_watch.start();
+    }
+    ~StageTimer() {
+      m_watch.stop();
+      m_record.push_back( std::make_pair( m_name, m_watch.elapsed_seconds() ) );
+    }
+  };
+
+  // Task that runs func(begin,end) over one contiguous block of
+  // indices. The first exception is recorded rather than thrown since
+  // the thread pool has no way to pass it back to the caller, and the
+  // blocks after it are skipped.
+  class BlockRangeTask : public Task, private boost::noncopyable {
+    boost::function<void (size_t, size_t)> m_func;
+    size_t m_begin, m_end;
+    Mutex& m_mutex;
+    std::exception_ptr& m_error;
+  public:
+    BlockRangeTask( boost::function<void (size_t, size_t)> const& func,
+                    size_t begin, size_t end,
+                    Mutex& mutex, std::exception_ptr& error ) :
+      m_func(func), m_begin(begin), m_end(end), m_mutex(mutex), m_error(error) {}
+
+    void operator()() {
+      {
+        Mutex::Lock lock(m_mutex);
+        if ( m_error )
+          return;
+      }
+      try {
+        m_func( m_begin, m_end );
+      } catch ( ... ) {
+        Mutex::Lock lock(m_mutex);
+        if ( !m_error )
+          m_error = std::current_exception();
+      }
+    }
+  };
+
+  // Splits [0,size) into contiguous blocks and runs func on each of
+  // them using num_threads threads. Every index belongs to exactly
+  // one block, so func may write anything owned by an index without
+  // locking. Results do not depend on the number of threads as long
+  // as func only touches data owned by the indices it was given. The
+  // first exception thrown by func is rethrown as is.
+  inline void run_in_blocks( size_t size, int num_threads,
+                             boost::function<void (size_t, size_t)> const& func ) {
+    if ( num_threads <= 1 || size < 2 ) {
+      func( 0, size );
+      return;
+    }
+
+    // A few blocks per thread keeps the threads busy when the work per
+    // index is uneven (cameras see very different numbers of points).
+    size_t num_blocks = std::min( size, size_t(num_threads) * 4 );
+    Mutex mutex;
+    std::exception_ptr error;
+    {
+      FifoWorkQueue queue( num_threads );
+      for ( size_t b = 0; b < num_blocks; b++ )
+        queue.add_task( boost::shared_ptr<Task>(
+          new BlockRangeTask( func, b * size / num_blocks,
+                              (b + 1) * size / num_blocks, mutex, error ) ) );
+      queue.join_all();
+    }
+    if ( error )
+      std::rethrow_exception( error );
+  }
+
   // BUNDLE ADJUSTMENT BASE
   //--------------------------------------------------------
   // This is a base class for the item which actually performs the
@@ -240,6 +339,9 @@ namespace ba {
     bool m_use_camera_constraint;
     bool m_use_gcp_constraint;
 
+    int m_num_threads;
+    IterationTiming m_iteration_timing;
+
   public:
     // Constructor
     AdjustBase( BundleAdjustModelT &model,
@@ -248,7 +350,8 @@ namespace ba {
                 bool use_gcp_constraint=true ) :
     m_model(model), m_robust_cost_func(robust_cost_func),
       m_use_camera_constraint(use_camera_constraint),
-      m_use_gcp_constraint(use_gcp_constraint) {
+      m_use_gcp_constraint(use_gcp_constraint),
+      m_num_threads(1) {
 
       m_iterations = 0;
       m_control_net = m_model.control_network();
@@ -334,11 +437,22 @@ namespace ba {
     bool camera_constraint() const { return m_use_camera_constraint; }
     bool gcp_constraint() const { return m_use_gcp_constraint; }
 
+    // Number of threads used by adjusters that run their update step in
+    // parallel. This is 1 unless it is raised here, since with more
+    // threads the model's cam_pixel and jacobians are called
+    // concurrently. Only raise it for models that are reentrant.
+    int num_threads() const { return m_num_threads; }
+    void set_num_threads(int num_threads) { m_num_threads = std::max(num_threads,1); }
+
     // Additional Information
     int iterations() const { return m_iterations; }
     RobustCostT costfunction() const { return m_robust_cost_func; }
     BundleAdjustModelT& bundle_adjust_model() { return m_model; }
 
+    // Stage timings of the most recent update. Empty for adjusters
+    // that don't record them.
+    IterationTiming const& iteration_timing() const { return m_iteration_timing; }
+
     // This is called repeatedly
     double update( double &abs_tol,
                    double &rel_tol ) {
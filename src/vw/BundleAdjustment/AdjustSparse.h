@@ -28,12 +28,15 @@
 #include <vw/Core/Debugging.h>
 #include <vw/BundleAdjustment/AdjustBase.h>
 #include <vw/BundleAdjustment/CameraRelation.h>
+#include <vw/BundleAdjustment/LinearSolver.h>
 
 // Boost
 #include <boost/numeric/ublas/matrix_sparse.hpp>
 #include <boost/numeric/ublas/vector_sparse.hpp>
 #include <boost/numeric/ublas/io.hpp>
 #include <boost/version.hpp>
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
 #if BOOST_VERSION<=103200
 // Mapped matrix doesn't exist in 1.32, but Sparse Matrix does
 //
@@ -61,10 +64,9 @@ namespace ba {
     typedef Vector<double,BundleAdjustModelT::camera_params_n> vector_camera;
     typedef Vector<double,BundleAdjustModelT::point_params_n> vector_point;
 
-    math::MatrixSparseSkyline<double> m_S;
-    std::vector<size_t> m_ideal_ordering;
-    Vector<size_t> m_ideal_skyline;
-    bool m_found_ideal_ordering;
+    math::BlockSparseSymmetricMatrix m_S;
+    LinearSolverType m_solver_type;
+    boost::shared_ptr<ReducedSystemSolver> m_solver;
     CameraRelationNetwork<JFeature> m_crn;
     typedef CameraNode<JFeature>::iterator crn_iter;
 
@@ -74,6 +76,217 @@ namespace ba {
     std::vector< vector_camera > epsilon_a;
     std::vector< vector_point > epsilon_b;
 
+    // Measures are numbered camera major, in the order m_crn[j] lists
+    // them. m_camera_offset[j] is the number of the first measure of
+    // camera j and m_point_measures[i] lists the measures of point i
+    // in increasing order.
+    std::vector< boost::shared_ptr<JFeature> > m_measures;
+    std::vector< size_t > m_camera_offset;
+    std::vector< std::vector<size_t> > m_point_measures;
+
+    // Per measure W, Y and contributions to V and epsilon_b and per
+    // camera error sums, written by the worker threads.
+    std::vector< matrix_camera_point > m_W, m_Y;
+    std::vector< matrix_point_point > m_V_part;
+    std::vector< vector_point > m_epsilon_b_part;
+    std::vector< double > m_camera_error;
+
+    // Cameras without any measures may be missing from the tail of
+    // m_crn, they simply get an empty range here.
+    void index_measures() {
+      size_t num_cameras = this->m_model.num_cameras();
+      m_measures.clear();
+      m_camera_offset.resize( num_cameras + 1 );
+      m_point_measures.clear();
+      m_point_measures.resize( this->m_model.num_points() );
+      for ( size_t j = 0; j < num_cameras; j++ ) {
+        m_camera_offset[j] = m_measures.size();
+        if ( j >= m_crn.size() )
+          continue;
+        BOOST_FOREACH( boost::shared_ptr<JFeature> measure, m_crn[j] ) {
+          m_point_measures[ measure->m_point_id ].push_back( m_measures.size() );
+          m_measures.push_back( measure );
+        }
+      }
+      m_camera_offset[ num_cameras ] = m_measures.size();
+
+      m_W.resize( m_measures.size() );
+      m_Y.resize( m_measures.size() );
+      m_V_part.resize( m_measures.size() );
+      m_epsilon_b_part.resize( m_measures.size() );
+      m_camera_error.resize( num_cameras );
+      m_S = math::BlockSparseSymmetricMatrix( num_cameras,
+                                              BundleAdjustModelT::camera_params_n );
+    }
+
+    // Weighted image error and inverse covariance of a measure
+    Vector2 measure_error( JFeature const& measure, size_t j,
+                           vector_camera const& cam, vector_point const& point,
+                           RobustCostT& robust_cost_func,
+                           Matrix2x2& inverse_cov ) const {
+      Vector2 error;
+      try {
+        error = measure.m_location -
+          this->m_model.cam_pixel( measure.m_point_id, j, cam, point );
+      } catch (const camera::PointToPixelErr& e) {}
+
+      if ( error != Vector2() ) {
+        double mag = norm_2(error);
+        double weight = sqrt(robust_cost_func(mag)) / mag;
+        error *= weight;
+      }
+
+      Vector2 pixel_sigma = measure.m_scale;
+      inverse_cov(0,0) = 1/(pixel_sigma(0)*pixel_sigma(0));
+      inverse_cov(1,1) = 1/(pixel_sigma(1)*pixel_sigma(1));
+      return error;
+    }
+
+    // Jacobians, U, epsilon_a, W and the point terms of every measure
+    // seen by cameras [begin,end).
+    void accumulate_cameras( size_t begin, size_t end ) {
+      RobustCostT robust_cost_func = this->m_robust_cost_func;
+      for ( size_t j = begin; j < end; j++ ) {
+        U[j] = matrix_camera_camera();
+        epsilon_a[j] = vector_camera();
+        m_camera_error[j] = 0;
+        vector_camera cam = this->m_model.cam_params(j);
+
+        for ( size_t m = m_camera_offset[j]; m < m_camera_offset[j+1]; m++ ) {
+          JFeature const& measure = *m_measures[m];
+          size_t i = measure.m_point_id;
+          vector_point point = this->m_model.point_params(i);
+
+          matrix_2_camera A = this->m_model.cam_jacobian( i, j, cam, point );
+          matrix_2_point B = this->m_model.point_jacobian( i, j, cam, point );
+
+          Matrix2x2 inverse_cov;
+          Vector2 error = measure_error( measure, j, cam, point,
+                                         robust_cost_func, inverse_cov );
+          m_camera_error[j] += .5 * transpose(error) * inverse_cov * error;
+
+          // Storing intermediate values
+          U[j] += transpose(A) * inverse_cov * A;
+          epsilon_a[j] += transpose(A) * inverse_cov * error;
+          m_V_part[m] = transpose(B) * inverse_cov * B;
+          m_epsilon_b_part[m] = transpose(B) * inverse_cov * error;
+          m_W[m] = transpose(A) * inverse_cov * B;
+        }
+      }
+    }
+
+    // Sums V and epsilon_b for points [begin,end).
+    void accumulate_points( size_t begin, size_t end ) {
+      for ( size_t i = begin; i < end; i++ ) {
+        V[i] = matrix_point_point();
+        epsilon_b[i] = vector_point();
+        BOOST_FOREACH( size_t m, m_point_measures[i] ) {
+          V[i] += m_V_part[m];
+          epsilon_b[i] += m_epsilon_b_part[m];
+        }
+      }
+    }
+
+    void invert_points( size_t begin, size_t end ) {
+      for ( size_t i = begin; i < end; i++ ) {
+        Matrix<double> V_temp = V[i];
+        chol_inverse( V_temp );
+        V_inverse[i] = transpose(V_temp)*V_temp;
+      }
+    }
+
+    // Y, the block of 'e' and the row of S for cameras [begin,end).
+    // Row j of S is stored as block column j of m_S, which no other
+    // camera writes to.
+    void reduce_cameras( size_t begin, size_t end, Vector<double>& e ) {
+      size_t num_cam_params = BundleAdjustModelT::camera_params_n;
+
+      // Off diagonal blocks of the row being built, indexed by camera
+      std::vector< matrix_camera_camera > S_row( m_S.num_blocks() );
+      std::vector< bool > touched( m_S.num_blocks(), false );
+      std::vector< size_t > touched_cameras;
+
+      for ( size_t j = begin; j < end; j++ ) {
+        vector_camera e_j = epsilon_a[j];
+        matrix_camera_camera S_jj = U[j];
+        for ( size_t m = m_camera_offset[j]; m < m_camera_offset[j+1]; m++ ) {
+          size_t i = m_measures[m]->m_point_id;
+
+          // Compute the blocks of Y and finish constructing e.
+          m_Y[m] = m_W[m] * V_inverse[i];
+          e_j -= m_Y[m] * epsilon_b[i];
+          S_jj -= m_Y[m] * transpose(m_W[m]);
+
+          // Every later camera k that also sees point i gets a
+          // contribution to S_jk.
+          BOOST_FOREACH( size_t m_k, m_point_measures[i] ) {
+            size_t k = m_measures[m_k]->m_camera_id;
+            if ( k <= j )
+              continue;
+            if ( !touched[k] ) {
+              touched[k] = true;
+              touched_cameras.push_back( k );
+              S_row[k] = matrix_camera_camera();
+            }
+            S_row[k] -= m_Y[m] * transpose(m_W[m_k]);
+          }
+        }
+        subvector(e, j*num_cam_params, num_cam_params) = e_j;
+
+        // S is stored by its lower blocks, hence the transposes.
+        m_S.block( j, j ) = transpose( S_jj );
+        BOOST_FOREACH( size_t k, touched_cameras ) {
+          m_S.block( k, j ) = transpose( S_row[k] );
+          touched[k] = false;
+        }
+        touched_cameras.clear();
+      }
+    }
+
+    // delta_b = inverse(V)*( epsilon_b - sum_across_cam( WijT * delta_aj ) )
+    // for points [begin,end).
+    void solve_points( size_t begin, size_t end,
+                       Vector<double> const& delta_a, Vector<double>& delta_b ) {
+      size_t num_cam_params = BundleAdjustModelT::camera_params_n;
+      size_t num_pt_params = BundleAdjustModelT::point_params_n;
+      for ( size_t i = begin; i < end; i++ ) {
+        vector_point right_delta_b;
+        BOOST_FOREACH( size_t m, m_point_measures[i] )
+          right_delta_b += transpose( m_W[m] ) *
+            subvector( delta_a, m_measures[m]->m_camera_id*num_cam_params,
+                       num_cam_params );
+
+        Vector<double> delta_temp = epsilon_b[i] - right_delta_b;
+        Matrix<double> hessian = V[i];
+        solve( delta_temp, hessian );
+        subvector( delta_b, i*num_pt_params, num_pt_params ) = delta_temp;
+      }
+    }
+
+    // Image error after applying the update, for cameras [begin,end).
+    void updated_camera_error( size_t begin, size_t end,
+                               Vector<double> const& delta_a,
+                               Vector<double> const& delta_b ) {
+      size_t num_cam_params = BundleAdjustModelT::camera_params_n;
+      size_t num_pt_params = BundleAdjustModelT::point_params_n;
+      RobustCostT robust_cost_func = this->m_robust_cost_func;
+      for ( size_t j = begin; j < end; j++ ) {
+        m_camera_error[j] = 0;
+        vector_camera new_a = this->m_model.cam_params(j) +
+          subvector( delta_a, num_cam_params*j, num_cam_params );
+        for ( size_t m = m_camera_offset[j]; m < m_camera_offset[j+1]; m++ ) {
+          JFeature const& measure = *m_measures[m];
+          vector_point new_b = this->m_model.point_params(measure.m_point_id) +
+            subvector( delta_b, num_pt_params*measure.m_point_id, num_pt_params );
+
+          Matrix2x2 inverse_cov;
+          Vector2 error = measure_error( measure, j, new_a, new_b,
+                                         robust_cost_func, inverse_cov );
+          m_camera_error[j] += .5 * transpose(error) * inverse_cov * error;
+        }
+      }
+    }
+
   public:
 
     AdjustSparse( BundleAdjustModelT & model,
@@ -88,10 +301,28 @@ namespace ba {
       epsilon_a( this->m_model.num_cameras() ), epsilon_b( this->m_model.num_points() ) {
       vw_out(DebugMessage,"ba") << "Constructed Sparse Bundle Adjuster.\n";
       m_crn.read_controlnetwork( *(this->m_control_net).get() );
-      m_found_ideal_ordering = false;
+      index_measures();
+      set_linear_solver( SkylineLinearSolver );
     }
 
-    math::MatrixSparseSkyline<double> S() const { return m_S; }
+    /// The reduced camera system from the last update, as a skyline
+    /// matrix.
+    math::MatrixSparseSkyline<double> S() const { return block_to_skyline<double>( m_S ); }
+
+    /// Selects how S * delta_a = e is solved. See LinearSolver.h.
+    void set_linear_solver( LinearSolverType type ) {
+      m_solver_type = type;
+      switch ( type ) {
+      case CholeskyLinearSolver:
+        m_solver.reset( new SupernodalCholeskySolver() ); break;
+      case PCGLinearSolver:
+        m_solver.reset( new BlockJacobiPCGSolver() ); break;
+      default:
+        m_solver.reset( new SkylineLDLSolver<double>() ); break;
+      }
+      vw_out(DebugMessage,"ba") << "Using " << m_solver->name() << " linear solver.\n";
+    }
+    LinearSolverType linear_solver() const { return m_solver_type; }
 
     // Covariance Calculator
     // ___________________________________________________________
@@ -127,76 +358,39 @@ namespace ba {
     //-------------------------------------------------------------
     // This is the sparse levenberg marquardt update step.  Returns
     // the average improvement in the cost function.
+    //
+    // The per camera and per point stages run on num_threads()
+    // threads. Anything owned by a point is summed over that point's
+    // measures in camera order, and every total is reduced in index
+    // order, so the answer doesn't change with the number of threads.
     double update(double &abs_tol, double &rel_tol) {
       ++this->m_iterations;
-      boost::scoped_ptr<Timer> time;
+      this->m_iteration_timing.clear();
+      boost::scoped_ptr<StageTimer> time;
 
       VW_DEBUG_ASSERT(this->m_control_net->size() == this->m_model.num_points(), LogicErr() << "BundleAdjustment::update() : Number of bundles does not match the number of points in the bundle adjustment model.");
 
-      // Reseting the values for U, V, epsilon
-      BOOST_FOREACH( matrix_camera_camera& element, U )
-        element = matrix_camera_camera();
-      BOOST_FOREACH( vector_camera& element, epsilon_a )
-        element = vector_camera();
-      BOOST_FOREACH( matrix_point_point& element, V )
-        element = matrix_point_point();
-      BOOST_FOREACH( vector_point& element, epsilon_b )
-        element = vector_point();
-
       size_t num_cam_params = BundleAdjustModelT::camera_params_n;
       size_t num_pt_params = BundleAdjustModelT::point_params_n;
+      size_t num_cameras = this->m_model.num_cameras();
+      size_t num_points = this->m_model.num_points();
 
       // Populate the Jacobian, which is broken into two sparse
       // matrices A & B, as well as the error matrix and the W
-      // matrix.
-      time.reset(new Timer("Solve for Image Error, Jacobian, U, V, and W:", DebugMessage, "ba"));
+      // matrix. Each camera's measures are handled by one thread, the
+      // point terms are then summed per point.
+      time.reset(new StageTimer("Jacobian, U, V, and W", this->m_iteration_timing));
+      run_in_blocks( num_cameras, this->m_num_threads,
+                     boost::bind( &AdjustSparse::accumulate_cameras, this, _1, _2 ) );
+      run_in_blocks( num_points, this->m_num_threads,
+                     boost::bind( &AdjustSparse::accumulate_points, this, _1, _2 ) );
       double error_total = 0; // assume this is r^T\Sigma^{-1}r
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        BOOST_FOREACH( boost::shared_ptr<JFeature> measure, m_crn[j] ) {
-          size_t i = measure->m_point_id;
-
-          matrix_2_camera A =
-            this->m_model.cam_jacobian( i, j,
-                                      this->m_model.cam_params(j),
-                                      this->m_model.point_params(i) );
-          matrix_2_point B =
-            this->m_model.point_jacobian( i, j,
-                                      this->m_model.cam_params(j),
-                                      this->m_model.point_params(i) );
-
-          // Apply robust cost function weighting
-          Vector2 error;
-          try {
-            error = measure->m_location -
-              this->m_model.cam_pixel(i,j,this->m_model.cam_params(j),
-                            this->m_model.point_params(i) );
-          } catch (const camera::PointToPixelErr& e) {}
-
-          if ( error != Vector2() ) {
-            double mag = norm_2(error);
-            double weight = sqrt(this->m_robust_cost_func(mag)) / mag;
-            error *= weight;
-          }
-
-          Matrix2x2 inverse_cov;
-          Vector2 pixel_sigma = measure->m_scale;
-          inverse_cov(0,0) = 1/(pixel_sigma(0)*pixel_sigma(0));
-          inverse_cov(1,1) = 1/(pixel_sigma(1)*pixel_sigma(1));
-          error_total += .5 * transpose(error) *
-            inverse_cov * error;
-
-          // Storing intermediate values
-          U[j] += transpose(A) * inverse_cov * A;
-          V[i] += transpose(B) * inverse_cov * B;
-          epsilon_a[j] += transpose(A) * inverse_cov * error;
-          epsilon_b[i] += transpose(B) * inverse_cov * error;
-          measure->m_w = transpose(A) * inverse_cov * B;
-        }
-      }
+      BOOST_FOREACH( double error, m_camera_error )
+        error_total += error;
       time.reset();
 
       // Add in the camera position and pose constraint terms and covariances.
-      time.reset(new Timer("Solving for Camera and GCP error:",DebugMessage,"ba"));
+      time.reset(new StageTimer("Camera and GCP error", this->m_iteration_timing));
       if ( this->m_use_camera_constraint )
         for ( size_t j = 0; j < U.size(); ++j ) {
           matrix_camera_camera inverse_cov =
@@ -224,7 +418,7 @@ namespace ba {
 
       // set initial lambda, and ignore if the user has touched it
       if ( this->m_iterations == 1 && this->m_lambda == 1e-3 ) {
-        time.reset(new Timer("Solving for Lambda:", DebugMessage, "ba"));
+        time.reset(new StageTimer("Lambda", this->m_iteration_timing));
         double max = 0.0;
         BOOST_FOREACH( matrix_camera_camera& element, U )
           for (size_t j = 0; j < BundleAdjustModelT::camera_params_n; ++j){
@@ -240,7 +434,7 @@ namespace ba {
         time.reset();
       }
 
-      time.reset(new Timer("Augmenting with lambda",DebugMessage,"ba"));
+      time.reset(new StageTimer("Augmenting with lambda", this->m_iteration_timing));
       //e at this point should be -g_a
 
       // "Augment" the diagonal entries of the U and V matrices with
@@ -262,121 +456,26 @@ namespace ba {
       }
       time.reset();
 
-      // Create the 'e' vector in S * delta_a = e.  The first step is
-      // to "flatten" our block structure to a vector that contains
-      // scalar entries.
-      time.reset(new Timer("Create special e vector", DebugMessage, "ba"));
-      Vector<double> e(this->m_model.num_cameras() * BundleAdjustModelT::camera_params_n);
-      for (size_t j = 0; j < epsilon_a.size(); ++j) {
-        subvector(e, j*BundleAdjustModelT::camera_params_n, BundleAdjustModelT::camera_params_n) =
-          epsilon_a[j];
-      }
-
-      // Compute V inverse
-      for ( size_t i = 0; i < this->m_model.num_points(); i++ ) {
-        Matrix<double> V_temp = V[i];
-        chol_inverse( V_temp );
-        V_inverse[i] = transpose(V_temp)*V_temp;
-      }
-
-      // Compute Y and finish constructing e.
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        for ( crn_iter fiter = m_crn[j].begin();
-              fiter != m_crn[j].end(); fiter++ ) {
-          // Compute the blocks of Y
-          (**fiter).m_y = (**fiter).m_w * V_inverse[(**fiter).m_point_id];
-          // Flatten the block structure to compute 'e'
-          subvector(e, j*num_cam_params, num_cam_params) -= (**fiter).m_y
-            * epsilon_b[ (**fiter).m_point_id ];
-        }
-      }
-
-      time.reset();
-
-      // --- BUILD SPARSE, SOLVE A'S UPDATE STEP -------------------------
-      time.reset(new Timer("Build Sparse", DebugMessage, "ba"));
-
+      // Eliminate the points. V is block diagonal so every point is
+      // inverted on its own. Then each camera computes its blocks of Y,
+      // its part of the 'e' vector in S * delta_a = e, and its row of
+      // S.
+      //
       // The S matrix is a m x m block matrix with blocks that are
-      // camera_params_n x camera_params_n in size.  It has a sparse
-      // skyline structure, which makes it more efficient to solve
-      // through L*D*L^T decomposition and forward/back substitution
-      // below.
-      math::MatrixSparseSkyline<double> S(this->m_model.num_cameras()*num_cam_params,
-                                          this->m_model.num_cameras()*num_cam_params);
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        { // Filling in diagonal
-          matrix_camera_camera S_jj;
-
-          // Iterate across all features seen by the camera
-          for ( crn_iter fiter = m_crn[j].begin();
-                fiter != m_crn[j].end(); fiter++ ) {
-            S_jj -= (**fiter).m_y*transpose((**fiter).m_w);
-          }
-
-          // Augmenting Diagonal
-          S_jj += U[j];
-
-          // Loading into sparse matrix
-          size_t offset = j * num_cam_params;
-          for ( size_t aa = 0; aa < num_cam_params; aa++ ) {
-            for ( size_t bb = aa; bb < num_cam_params; bb++ ) {
-              S( offset+bb, offset+aa ) = S_jj(aa,bb);  // Transposing
-            }
-          }
-        }
-
-        // Filling in off diagonal
-        for ( size_t k = j+1; k < m_crn.size(); k++ ) {
-          typedef boost::weak_ptr<JFeature> w_ptr;
-          typedef boost::shared_ptr<JFeature> f_ptr;
-          typedef std::multimap< size_t, f_ptr >::iterator mm_iterator;
-          std::pair< mm_iterator, mm_iterator > feature_range;
-          feature_range = m_crn[j].map.equal_range( k );
-
-          // Iterating through all features in camera j that have
-          // connections to camera k.
-          matrix_camera_camera S_jk;
-          bool found = false;
-          for ( mm_iterator f_j_iter = feature_range.first;
-                f_j_iter != feature_range.second; f_j_iter++ ) {
-            w_ptr f_k = (*f_j_iter).second->m_map[k];
-            found = true;
-            S_jk -= (*f_j_iter).second->m_y *
-              transpose( f_k.lock()->m_w );
-          }
-
-          // Loading into sparse matrix
-          // - if it seems we are loading in oddly, it's because the sparse
-          //   matrix is row major.
-          if ( found ) {
-            submatrix( S, k*num_cam_params, j*num_cam_params,
-                       num_cam_params, num_cam_params ) = transpose(S_jk);
-          }
-        }
-      }
-
-      m_S = S; // S is modified in sparse solve. Keeping a copy.
+      // camera_params_n x camera_params_n in size. Its pattern is the
+      // same for every iteration, so the solver can reuse its ordering.
+      time.reset(new StageTimer("Schur complement", this->m_iteration_timing));
+      run_in_blocks( num_points, this->m_num_threads,
+                     boost::bind( &AdjustSparse::invert_points, this, _1, _2 ) );
+      Vector<double> e(num_cameras * num_cam_params);
+      run_in_blocks( num_cameras, this->m_num_threads,
+                     boost::bind( &AdjustSparse::reduce_cameras, this, _1, _2,
+                                  boost::ref(e) ) );
       time.reset();
 
-      // Computing ideal ordering
-      if (!m_found_ideal_ordering) {
-        time.reset(new Timer("Solving Cuthill-Mckee", DebugMessage, "ba"));
-        m_ideal_ordering = cuthill_mckee_ordering(S,num_cam_params);
-        math::MatrixReorganize<math::MatrixSparseSkyline<double> > mod_S( S, m_ideal_ordering );
-        m_ideal_skyline = solve_for_skyline(mod_S);
-
-        m_found_ideal_ordering = true;
-        time.reset();
-      }
-
-      time.reset(new Timer("Solve Delta A", DebugMessage, "ba"));
-
-      // Compute the LDL^T decomposition and solve using sparse methods.
-      math::MatrixReorganize<math::MatrixSparseSkyline<double> > modified_S( S, m_ideal_ordering );
-      Vector<double> delta_a = sparse_solve( modified_S,
-                                             reorganize(e, m_ideal_ordering),
-                                             m_ideal_skyline );
-      delta_a = reorganize(delta_a, modified_S.inverse());
+      // --- SOLVE A'S UPDATE STEP -------------------------
+      time.reset(new StageTimer("Solve Delta A", this->m_iteration_timing));
+      Vector<double> delta_a = m_solver->solve( m_S, e );
       BOOST_FOREACH( double& e, delta_a )
         if ( std::isnan( e ) ) e = 0;
       time.reset();
@@ -384,38 +483,20 @@ namespace ba {
       // --- SOLVE B'S UPDATE STEP ---------------------------------
 
       // Back Solving for Delta B
-      time.reset(new Timer("Solve Delta B", DebugMessage, "ba"));
-      Vector<double> delta_b( this->m_model.num_points() * num_pt_params );
-      {
-        // delta_b = inverse(V)*( epsilon_b - sum_across_cam( WijT * delta_aj ) )
-
-        // Building right half, sum( WijT * delta_aj )
-        std::vector< vector_point > right_delta_b( this->m_model.num_points() );
-        for ( size_t j = 0; j < m_crn.size(); j++ ) {
-          for ( crn_iter fiter = m_crn[j].begin();
-                fiter != m_crn[j].end(); fiter++ ) {
-            right_delta_b[ (**fiter).m_point_id ] += transpose( (**fiter).m_w ) *
-              subvector( delta_a, j*num_cam_params, num_cam_params );
-          }
-        }
-
-        // Solving for delta b
-        for ( size_t i = 0; i < this->m_model.num_points(); i++ ) {
-          Vector<double> delta_temp = epsilon_b[i] - right_delta_b[i];
-          Matrix<double> hessian = V[i];
-          solve( delta_temp, hessian );
-          subvector( delta_b, i*num_pt_params, num_pt_params ) = delta_temp;
-        }
-      }
+      time.reset(new StageTimer("Solve Delta B", this->m_iteration_timing));
+      Vector<double> delta_b( num_points * num_pt_params );
+      run_in_blocks( num_points, this->m_num_threads,
+                     boost::bind( &AdjustSparse::solve_points, this, _1, _2,
+                                  boost::cref(delta_a), boost::ref(delta_b) ) );
       time.reset();
 
       //Predicted improvement for Fletcher modification
       double dS = 0;
-      for ( size_t j = 0; j < this->m_model.num_cameras(); j++ )
+      for ( size_t j = 0; j < num_cameras; j++ )
         dS += transpose(subvector(delta_a,j*num_cam_params,num_cam_params))
           * ( this->m_lambda * subvector(delta_a,j*num_cam_params,num_cam_params) +
               epsilon_a[j] );
-      for ( size_t i = 0; i < this->m_model.num_points(); i++ )
+      for ( size_t i = 0; i < num_points; i++ )
         dS += transpose(subvector(delta_b,i*num_pt_params,num_pt_params))
           * ( this->m_lambda * subvector(delta_b,i*num_pt_params,num_pt_params) +
               epsilon_b[i] );
@@ -424,36 +505,13 @@ namespace ba {
       // -------------------------------
       // Compute the update error vector and predicted change
       // -------------------------------
-      time.reset(new Timer("Solve for Updated Error", DebugMessage, "ba"));
+      time.reset(new StageTimer("Updated Error", this->m_iteration_timing));
+      run_in_blocks( num_cameras, this->m_num_threads,
+                     boost::bind( &AdjustSparse::updated_camera_error, this, _1, _2,
+                                  boost::cref(delta_a), boost::cref(delta_b) ) );
       double new_error_total = 0;
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        for ( crn_iter fiter = m_crn[j].begin();
-              fiter != m_crn[j].end(); fiter++ ) {
-          // Compute error vector
-          vector_camera new_a = this->m_model.cam_params(j) +
-            subvector( delta_a, num_cam_params*j, num_cam_params );
-          vector_point new_b = this->m_model.point_params((**fiter).m_point_id) +
-            subvector( delta_b, num_pt_params*(**fiter).m_point_id, num_pt_params );
-
-          // Apply robust cost function weighting
-          Vector2 error;
-          try {
-            error = (**fiter).m_location -
-              this->m_model.cam_pixel((**fiter).m_point_id,j,new_a,new_b);
-          } catch (const camera::PointToPixelErr& e) {}
-          double mag = norm_2( error );
-          double weight = sqrt( this->m_robust_cost_func(mag)) / mag;
-          error *= weight;
-
-          Matrix2x2 inverse_cov;
-          Vector2 pixel_sigma = (**fiter).m_scale;
-          inverse_cov(0,0) = 1/(pixel_sigma(0)*pixel_sigma(0));
-          inverse_cov(1,1) = 1/(pixel_sigma(1)*pixel_sigma(1));
-
-          new_error_total += .5 * transpose(error) *
-            inverse_cov * error;
-        }
-      }
+      BOOST_FOREACH( double error, m_camera_error )
+        new_error_total += error;
 
       // Camera Constraints
       if ( this->m_use_camera_constraint )
@@ -499,7 +557,7 @@ namespace ba {
 
       if ( R > 0 ) {
 
-        time.reset(new Timer("Setting Parameters",DebugMessage,"ba"));
+        time.reset(new StageTimer("Setting Parameters", this->m_iteration_timing));
         for (size_t j = 0; j < this->m_model.num_cameras(); ++j)
           this->m_model.set_cam_params(j, this->m_model.cam_params(j) +
                                          subvector(delta_a, num_cam_params*j,num_cam_params));
@@ -38,6 +38,7 @@
 #include <vw/Cartography/PointImageManipulation.h>
 #include <vw/FileIO/KML.h>
 #include <vw/BundleAdjustment/ControlNetwork.h>
+#include <vw/BundleAdjustment/AdjustBase.h>
 
 // Boost
 #include <boost/algorithm/string.hpp>
@@ -222,8 +223,10 @@ namespace ba {
       m_human_both << "[" << current_posix_time_string() << "]\tFinished Iteration "
                    << m_adjuster.iterations() << std::endl;
 
-      if ( report_level >= ClassicReport )
+      if ( report_level >= ClassicReport ) {
         generic_readings();
+        timing_readings();
+      }
 
       if ( report_level >= TriangulationReport )
         triangulation_readings();
@@ -310,6 +313,24 @@ namespace ba {
       m_human_both << std::flush;
     }
 
+    // Where the last iteration spent its time, for adjusters that
+    // record it.
+    void timing_readings() {
+      IterationTiming const& timing = m_adjuster.iteration_timing();
+      if ( timing.empty() )
+        return;
+      double total = 0;
+      for ( size_t i = 0; i < timing.size(); i++ )
+        total += timing[i].second;
+      m_human_both << "\tIteration Time: " << total << " s ("
+                   << m_adjuster.num_threads() << " threads)\n";
+      for ( size_t i = 0; i < timing.size(); i++ )
+        m_human_both << "\t  " << std::setw(24) << std::left
+                     << timing[i].first << std::right << " "
+                     << timing[i].second << " s\n";
+      m_human_both << std::flush;
+    }
+
     void stereo_errors( std::vector<double>& stereo_errors ) {
       // Where all the measurement errors will go
       stereo_errors.clear();
@@ -21,6 +21,7 @@
 
 #include <vw/BundleAdjustment/CameraRelation.h>
 #include <boost/foreach.hpp>
+#include <boost/unordered_set.hpp>
 
 namespace vw {
 namespace ba {
@@ -137,8 +138,11 @@ namespace ba {
       vw_throw( ArgumentErr() << "CameraRelation network is empty." );
     cnet.clear();
 
-    // This process is destructive, making a copy of self.
-    CameraRelationNetwork<FeatureT> crn = (*this);
+    // Features that already went into a control point. This replaces
+    // removing them from a copy of the network, which took time
+    // proportional to the features in the camera for every measure.
+    CameraRelationNetwork<FeatureT> const& crn = (*this);
+    boost::unordered_set<FeatureT const*> used;
 
     // On top of building the control network, we're also going filter
     // out 'spiral' type errors. Features that managed to link to the
@@ -151,13 +155,16 @@ namespace ba {
         progress.report_progress(float(i)/float(crn.size()-1));
         typedef          boost::weak_ptr<FeatureT>   w_ptr;
         typedef          boost::shared_ptr<FeatureT> f_ptr;
-        typedef typename std::list<f_ptr>::iterator  f_list_iter;
+        typedef typename std::list<f_ptr>::const_iterator f_list_iter;
         typedef typename std::list<w_ptr>::iterator  w_list_iter;
 
         // Iterating over matched relations inside a camera node and
         // building control points for them.
         for ( f_list_iter iter = crn[i].begin();
               iter != crn[i].end(); iter++ ) {
+          if ( used.count( iter->get() ) )
+            continue;
+
           // 1.) Building a listing of interest point for a control
           // point
           std::list<w_ptr> interestpts;
@@ -169,17 +176,17 @@ namespace ba {
           // 2.) Adding this location
           cpoint.add_measure( (*iter)->control_measure() );
 
-          // 3.) Adding and Removing measures in all other locations
+          // 3.) Adding and marking measures in all other locations
           w_list_iter measure = interestpts.begin();
           measure++;
           for ( ; measure != interestpts.end(); measure++ ) {
-            crn[(*measure).lock()->m_camera_id].relations.remove((*measure).lock());
-            cpoint.add_measure( (*measure).lock()->control_measure() );
+            f_ptr feature = (*measure).lock();
+            used.insert( feature.get() );
+            cpoint.add_measure( feature->control_measure() );
           }
 
-          // 4.) Removing this location finally
-          iter = crn[i].relations.erase(iter);
-          iter--;
+          // 4.) Marking this location finally
+          used.insert( iter->get() );
 
           // 5.) Checking for spiral error
           {
@@ -24,6 +24,9 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/foreach.hpp>
 
+#include <algorithm>
+#include <map>
+
 // Time Headers
 #include <boost/thread/xtime.hpp>
 #include <ctime>
@@ -59,39 +62,33 @@ namespace ba {
   // Control Measure        //
   ////////////////////////////
 
+  bool ControlMeasure::Details::operator==( Details const& other ) const {
+    return serial_number == other.serial_number && date_time == other.date_time &&
+      description == other.description && chooser_name == other.chooser_name &&
+      focalplane_x == other.focalplane_x && focalplane_y == other.focalplane_y &&
+      ephemeris_time == other.ephemeris_time && diameter == other.diameter;
+  }
+
+  boost::shared_ptr<ControlMeasure::Details> ControlMeasure::default_details() {
+    boost::shared_ptr<Details> details( new Details() );
+    details->serial_number = "Null";
+    details->description   = "Null";
+    details->chooser_name  = "Null";
+    details->date_time     = isis_style_time_string();
+    return details;
+  }
+
   /// Constructor
   ControlMeasure::ControlMeasure( float col, float row,
                                   float col_sigma, float row_sigma,
                                   uint64 image_id,
                                   ControlMeasureType type ) :
-    m_col(col), m_row(row), m_col_sigma(col_sigma), m_row_sigma(row_sigma), m_image_id(image_id), m_type(type) {
-
-    // Recording time
-    m_date_time = isis_style_time_string();
-
-    m_serialNumber    = "Null";
-    m_description     = "Null";
-    m_chooserName     = "Null";
-    m_ignore          = false;
-    m_pixels_dominant = true;
-
-    m_ephemeris_time = m_focalplane_x = m_focalplane_y = m_diameter = 0;
-  }
+    m_col(col), m_row(row), m_col_sigma(col_sigma), m_row_sigma(row_sigma), m_image_id(image_id),
+    m_details(default_details()), m_ignore(false), m_pixels_dominant(true), m_type(type) {}
 
   ControlMeasure::ControlMeasure( ControlMeasureType type ) :
-    m_col(0), m_row(0), m_col_sigma(0), m_row_sigma(0), m_image_id(0), m_type(type) {
-
-    // Recording time
-    m_date_time = isis_style_time_string();
-
-    m_serialNumber    = "Null";
-    m_description     = "Null";
-    m_chooserName     = "Null";
-    m_ignore          = false;
-    m_pixels_dominant = true;
-
-    m_ephemeris_time = m_focalplane_x = m_focalplane_y = m_diameter = 0;
-  }
+    m_col(0), m_row(0), m_col_sigma(0), m_row_sigma(0), m_image_id(0),
+    m_details(default_details()), m_ignore(false), m_pixels_dominant(true), m_type(type) {}
 
   std::string ControlMeasure::get_image_name(ControlNetwork const& net) const {
     if (net.get_image_list().size() <= m_image_id)
@@ -101,18 +98,19 @@ namespace ba {
 
   /// Write a compressed binary style of measure
   void ControlMeasure::write_binary( std::ostream &f ) const {
+    Details const& d = *m_details;
     // Writing out all the strings first
-    f << m_serialNumber << char(0) << m_date_time << char(0)
-      << m_description << char(0) << m_chooserName << char(0);
+    f << d.serial_number << char(0) << d.date_time << char(0)
+      << d.description << char(0) << d.chooser_name << char(0);
     // Writing the binary data
     f.write((char*)&(m_col),             sizeof(m_col));
     f.write((char*)&(m_row),             sizeof(m_row));
     f.write((char*)&(m_col_sigma),       sizeof(m_col_sigma));
     f.write((char*)&(m_row_sigma),       sizeof(m_row_sigma));
-    f.write((char*)&(m_diameter),        sizeof(m_diameter));
-    f.write((char*)&(m_focalplane_x),    sizeof(m_focalplane_x));
-    f.write((char*)&(m_focalplane_y),    sizeof(m_focalplane_y));
-    f.write((char*)&(m_ephemeris_time),  sizeof(m_ephemeris_time));
+    f.write((char*)&(d.diameter),        sizeof(d.diameter));
+    f.write((char*)&(d.focalplane_x),    sizeof(d.focalplane_x));
+    f.write((char*)&(d.focalplane_y),    sizeof(d.focalplane_y));
+    f.write((char*)&(d.ephemeris_time),  sizeof(d.ephemeris_time));
     f.write((char*)&(m_image_id),        sizeof(m_image_id));
     f.write((char*)&(m_ignore),          sizeof(m_ignore));
     f.write((char*)&(m_pixels_dominant), sizeof(m_pixels_dominant));
@@ -121,30 +119,34 @@ namespace ba {
 
   /// Reading a compressed binary style of measure
   void ControlMeasure::read_binary( std::istream &f ) {
+    boost::shared_ptr<Details> details( new Details() );
+    Details& d = *details;
     // Reading in all the strings
-    std::getline( f, m_serialNumber, '\0' );
-    std::getline( f, m_date_time, '\0' );
-    std::getline( f, m_description, '\0' );
-    std::getline( f, m_chooserName, '\0' );
+    std::getline( f, d.serial_number, '\0' );
+    std::getline( f, d.date_time, '\0' );
+    std::getline( f, d.description, '\0' );
+    std::getline( f, d.chooser_name, '\0' );
     // Reading the binary data
     f.read((char*)&(m_col),             sizeof(m_col));
     f.read((char*)&(m_row),             sizeof(m_row));
     f.read((char*)&(m_col_sigma),       sizeof(m_col_sigma));
     f.read((char*)&(m_row_sigma),       sizeof(m_row_sigma));
-    f.read((char*)&(m_diameter),        sizeof(m_diameter));
-    f.read((char*)&(m_focalplane_x),    sizeof(m_focalplane_x));
-    f.read((char*)&(m_focalplane_y),    sizeof(m_focalplane_y));
-    f.read((char*)&(m_ephemeris_time),  sizeof(m_ephemeris_time));
+    f.read((char*)&(d.diameter),        sizeof(d.diameter));
+    f.read((char*)&(d.focalplane_x),    sizeof(d.focalplane_x));
+    f.read((char*)&(d.focalplane_y),    sizeof(d.focalplane_y));
+    f.read((char*)&(d.ephemeris_time),  sizeof(d.ephemeris_time));
     f.read((char*)&(m_image_id),        sizeof(m_image_id));
     f.read((char*)&(m_ignore),          sizeof(m_ignore));
     f.read((char*)&(m_pixels_dominant), sizeof(m_pixels_dominant));
     f.read((char*)&(m_type),            sizeof(m_type));
+    m_details = details;
   }
 
   /// Write an isis style measure
   void ControlMeasure::write_isis( std::ostream &f ) const {
+    Details const& d = *m_details;
     f << "    Group = ControlMeasure\n";
-    f << "      SerialNumber   = " << m_serialNumber << std::endl;
+    f << "      SerialNumber   = " << d.serial_number << std::endl;
     f << "      MeasureType    = ";
     if ( m_type == ControlMeasure::Unmeasured ) {
       f << "Unmeasured\n";
@@ -171,17 +173,17 @@ namespace ba {
       f << "      ErrorLine      = " << m_col_sigma << "\n";
       f << "      ErrorSample    = " << m_row_sigma << "\n";
       f << "      ErrorMagnitude = " << sigma_magnitude() << "\n";
-      f << "      FocalPlaneX    = " << m_focalplane_x << "\n";
-      f << "      FocalPlaneY    = " << m_focalplane_y << "\n";
+      f << "      FocalPlaneX    = " << d.focalplane_x << "\n";
+      f << "      FocalPlaneY    = " << d.focalplane_y << "\n";
     }
-    if ( m_ephemeris_time != 0 )
-      f << "      EphemerisTime  = " << m_ephemeris_time << "\n";
-    if ( m_diameter > 0 )
-      f << "      Diameter       = " << m_diameter << "\n";
-    if ( !m_date_time.empty() )
-      f << "      DateTime       = " << m_date_time << "\n";
-    if ( !m_chooserName.empty() )
-      f << "      ChooserName    = " << m_chooserName << "\n";
+    if ( d.ephemeris_time != 0 )
+      f << "      EphemerisTime  = " << d.ephemeris_time << "\n";
+    if ( d.diameter > 0 )
+      f << "      Diameter       = " << d.diameter << "\n";
+    if ( !d.date_time.empty() )
+      f << "      DateTime       = " << d.date_time << "\n";
+    if ( !d.chooser_name.empty() )
+      f << "      ChooserName    = " << d.chooser_name << "\n";
     if ( m_ignore )
       f << "      Ignore         = True\n";
     f << "      Reference      = False\n";    // What is reference?
@@ -200,9 +202,11 @@ namespace ba {
     std::string str;
 
     // Setting defaults
-    m_diameter = 0;
-    m_date_time = "";
-    m_chooserName = "";
+    boost::shared_ptr<Details> details( new Details() );
+    Details& d = *details;
+    d.diameter = 0;
+    d.date_time = "";
+    d.chooser_name = "";
     m_ignore = false;
     m_pixels_dominant = true;
 
@@ -232,7 +236,7 @@ namespace ba {
         break;
       else if ( tokens[0] == "SerialNumber" ) {
         read_pvl_property( ostr, tokens );
-        m_serialNumber = ostr.str();
+        d.serial_number = ostr.str();
       } else if ( tokens[0] == "MeasureType" ) {
         read_pvl_property( ostr, tokens );
         if ( ostr.str() == "Unmeasured" )
@@ -282,28 +286,28 @@ namespace ba {
         read_pvl_property( ostr, tokens );
         converter.str( ostr.str() );
         converter.clear();
-        converter >> m_focalplane_x;
+        converter >> d.focalplane_x;
       } else if ( tokens[0] == "FocalPlaneY" ) {
         read_pvl_property( ostr, tokens );
         converter.str( ostr.str() );
         converter.clear();
-        converter >> m_focalplane_y;
+        converter >> d.focalplane_y;
       } else if ( tokens[0] == "EphemerisTime" ) {
         read_pvl_property( ostr, tokens );
         converter.str( ostr.str() );
         converter.clear();
-        converter >> m_ephemeris_time;
+        converter >> d.ephemeris_time;
       } else if ( tokens[0] == "Diameter" ) {
         read_pvl_property( ostr, tokens );
         converter.str( ostr.str() );
         converter.clear();
-        converter >> m_diameter;
+        converter >> d.diameter;
       } else if ( tokens[0] == "DateTime" ) {
         read_pvl_property( ostr, tokens );
-        m_date_time = ostr.str();
+        d.date_time = ostr.str();
       } else if ( tokens[0] == "ChooserName" ) {
         read_pvl_property( ostr, tokens );
-        m_chooserName = ostr.str();
+        d.chooser_name = ostr.str();
       } else if ( tokens[0] == "Ignore" ) {
         m_ignore = true;
       } else if ( tokens[0] == "PixelsDominant" ) {
@@ -318,6 +322,7 @@ namespace ba {
       if ( m_row_sigma == 0 )
         m_row_sigma = 1;
     }
+    m_details = details;
   }
 
   /// Write to a CSV stream
@@ -325,15 +330,16 @@ namespace ba {
     // TODO: Handle spaces and other formatting in the data!
     // Just write everything out to a single comma delimited line.
     
+    Details const& d = *m_details;
     const std::string delim = ", ";
-    f << m_serialNumber   << delim << m_date_time       << delim
-      << m_description    << delim 
-      << m_chooserName    << delim
+    f << d.serial_number  << delim << d.date_time       << delim
+      << d.description    << delim 
+      << d.chooser_name   << delim
       << m_col            << delim << m_row             << delim
       << m_col_sigma      << delim << m_row_sigma       << delim
-      << m_diameter       << delim 
-      << m_focalplane_x   << delim << m_focalplane_y    << delim
-      << m_ephemeris_time << delim << m_image_id        << delim
+      << d.diameter       << delim 
+      << d.focalplane_x   << delim << d.focalplane_y    << delim
+      << d.ephemeris_time << delim << m_image_id        << delim
       << (int)m_ignore    << delim << (int)m_pixels_dominant << delim
       << (int)m_type;
   }
@@ -352,22 +358,25 @@ namespace ba {
     if (parts.size() != EXPECTED_SIZE)
       vw_throw( vw::IOErr() << "Error reading Control Measure, on line: " << str );
 
-    m_serialNumber    = parts[0];
-    m_date_time       = parts[1];
-    m_description     = parts[2];
-    m_chooserName     = parts[3];
+    boost::shared_ptr<Details> details( new Details() );
+    Details& d = *details;
+    d.serial_number   = parts[0];
+    d.date_time       = parts[1];
+    d.description     = parts[2];
+    d.chooser_name    = parts[3];
     m_col             = atof(parts[ 4].c_str());
     m_row             = atof(parts[ 5].c_str());
     m_col_sigma       = atof(parts[ 6].c_str());
     m_row_sigma       = atof(parts[ 7].c_str());
-    m_diameter        = atof(parts[ 8].c_str());
-    m_focalplane_x    = atof(parts[ 9].c_str());
-    m_focalplane_y    = atof(parts[10].c_str());
-    m_ephemeris_time  = atof(parts[11].c_str());
+    d.diameter        = atof(parts[ 8].c_str());
+    d.focalplane_x    = atof(parts[ 9].c_str());
+    d.focalplane_y    = atof(parts[10].c_str());
+    d.ephemeris_time  = atof(parts[11].c_str());
     m_image_id        = atoi(parts[12].c_str());
     m_ignore          = atoi(parts[13].c_str());
     m_pixels_dominant = atoi(parts[14].c_str());
     m_type            = static_cast<ControlMeasureType>(atoi(parts[15].c_str()));
+    m_details = details;
   }
 
   ////////////////////////////
@@ -631,6 +640,7 @@ namespace ba {
       m_type = ControlNetwork::ImageToGround;
 
     m_control_points.push_back(point);
+    share_details( m_control_points.back() );
   }
 
   /// Add a vector of Control Points
@@ -646,7 +656,22 @@ namespace ba {
       }
     }
 
+    size_t first = m_control_points.size();
     m_control_points.insert(m_control_points.end(), points.begin(), points.end());
+    for ( size_t i = first; i < m_control_points.size(); i++ )
+      share_details( m_control_points[i] );
+  }
+
+  // Share each measure's details with the last record when they are
+  // equal. Records are never changed in place, so this is safe even
+  // when a record is also held outside the network.
+  void ControlNetwork::share_details( ControlPoint& point ) {
+    BOOST_FOREACH( ControlMeasure& cm, point ) {
+      if ( m_last_details && *m_last_details == *cm.m_details )
+        cm.m_details = m_last_details;
+      else
+        m_last_details = cm.m_details;
+    }
   }
 
   // Delete control point
@@ -725,8 +750,10 @@ namespace ba {
     m_control_points.reserve( size );
 
     // Reading in all the control points
-    for ( int p = 0; p < size; p++ )
+    for ( int p = 0; p < size; p++ ) {
       m_control_points.push_back( ControlPoint( f, FmtBinary ) );
+      share_details( m_control_points.back() );
+    }
 
     f.close();
   }
@@ -864,6 +891,7 @@ namespace ba {
           continue;
         } else if ( tokens[1] == "ControlPoint" ) {
           m_control_points.push_back( ControlPoint( f, FmtIsisPvl  ) );
+          share_details( m_control_points.back() );
         } else if ( tokens[1] == "ControlMeasure" ) {
           vw_throw( IOErr() << "Failed to open \"" << filename
                     << "\". Control Measure found out of order." );
@@ -938,12 +966,301 @@ namespace ba {
     m_control_points.reserve( size );
 
     // Reading in all the control points
-    for ( int p = 0; p < size; p++ )
+    for ( int p = 0; p < size; p++ ) {
       m_control_points.push_back( ControlPoint( f, FmtCsv ) );
+      share_details( m_control_points.back() );
+    }
 
     f.close();
   }
 
+  // Snapshot helpers. Every column is written as its length followed by
+  // the raw array.
+  namespace {
+    const char   SNAPSHOT_MAGIC[8] = { 'V','W','C','N','E','T','S','S' };
+    const uint32 SNAPSHOT_VERSION  = 1;
+
+    template <class T>
+    void write_snapshot_column( std::ostream& f, std::vector<T> const& column ) {
+      uint64 size = column.size();
+      f.write((char*)&size, sizeof(size));
+      if ( size )
+        f.write((char*)&column[0], sizeof(T)*size);
+    }
+
+    void write_snapshot_column( std::ostream& f, std::vector<std::string> const& column ) {
+      uint64 size = column.size();
+      f.write((char*)&size, sizeof(size));
+      BOOST_FOREACH( std::string const& str, column )
+        f << str << char(0);
+    }
+
+    // How many items of item_bytes each fit in the rest of f. Counts
+    // read from a snapshot are checked against this before anything is
+    // allocated for them.
+    uint64 snapshot_capacity( std::istream& f, uint64 item_bytes ) {
+      std::streampos here = f.tellg();
+      if ( !f || here == std::streampos(-1) )
+        return 0;
+      f.seekg( 0, std::ios::end );
+      std::streampos end = f.tellg();
+      f.seekg( here );
+      if ( !f || end < here )
+        return 0;
+      return uint64( end - here ) / item_bytes;
+    }
+
+    void check_snapshot_size( std::istream& f, uint64 size, uint64 item_bytes ) {
+      if ( size > snapshot_capacity( f, item_bytes ) )
+        vw_throw( IOErr() << "Control network snapshot is truncated or corrupt." );
+    }
+
+    template <class T>
+    void read_snapshot_column( std::istream& f, std::vector<T>& column, uint64 expected_size ) {
+      uint64 size = 0;
+      f.read((char*)&size, sizeof(size));
+      if ( !f || size != expected_size )
+        vw_throw( IOErr() << "Control network snapshot is truncated or corrupt." );
+      check_snapshot_size( f, size, sizeof(T) );
+      column.resize( size );
+      if ( size )
+        f.read((char*)&column[0], sizeof(T)*size);
+    }
+
+    // Strings take at least their terminator
+    void read_snapshot_column( std::istream& f, std::vector<std::string>& column, uint64 expected_size ) {
+      uint64 size = 0;
+      f.read((char*)&size, sizeof(size));
+      if ( !f || size != expected_size )
+        vw_throw( IOErr() << "Control network snapshot is truncated or corrupt." );
+      check_snapshot_size( f, size, 1 );
+      column.resize( size );
+      for ( uint64 i = 0; i < size; i++ )
+        std::getline( f, column[i], '\0' );
+    }
+
+    uint64 read_snapshot_size( std::istream& f, uint64 item_bytes ) {
+      uint64 size = 0;
+      f.read((char*)&size, sizeof(size));
+      if ( !f )
+        vw_throw( IOErr() << "Control network snapshot is truncated or corrupt." );
+      check_snapshot_size( f, size, item_bytes );
+      return size;
+    }
+  }
+
+  /// Write a snapshot of the control network
+  void ControlNetwork::write_snapshot( std::string const& filename ) const {
+    typedef ControlMeasure::Details Details;
+
+    // Recording the modified time
+    m_modified = isis_style_time_string();
+
+    // Splitting the network into columns. Measure details are written
+    // once for every distinct record.
+    std::vector<std::string> point_ids;
+    std::vector<uint8>  point_flags;
+    std::vector<double> point_data;
+    std::vector<uint32> measure_counts;
+    std::vector<float>  measure_data;
+    std::vector<uint64> image_ids;
+    std::vector<uint8>  measure_flags;
+    std::vector<uint32> details_index;
+    std::map<Details const*, uint32> details_lookup;
+    std::vector<Details const*> details;
+
+    BOOST_FOREACH( ControlPoint const& cp, m_control_points ) {
+      point_ids.push_back( cp.id() );
+      point_flags.push_back( uint8( cp.ignore() ) | uint8( cp.type() << 1 ) );
+      Vector3 position = cp.position(), sigma = cp.sigma();
+      point_data.insert( point_data.end(), position.begin(), position.end() );
+      point_data.insert( point_data.end(), sigma.begin(), sigma.end() );
+      measure_counts.push_back( cp.size() );
+
+      BOOST_FOREACH( ControlMeasure const& cm, cp ) {
+        measure_data.push_back( cm.m_col );
+        measure_data.push_back( cm.m_row );
+        measure_data.push_back( cm.m_col_sigma );
+        measure_data.push_back( cm.m_row_sigma );
+        image_ids.push_back( cm.m_image_id );
+        measure_flags.push_back( uint8( cm.m_ignore ) | uint8( cm.m_pixels_dominant << 1 ) |
+                                 uint8( cm.m_type << 2 ) );
+        std::pair<std::map<Details const*, uint32>::iterator, bool> inserted =
+          details_lookup.insert( std::make_pair( cm.m_details.get(), uint32(details.size()) ) );
+        if ( inserted.second )
+          details.push_back( cm.m_details.get() );
+        details_index.push_back( inserted.first->second );
+      }
+    }
+
+    std::vector<std::string> serials, date_times, descriptions, choosers;
+    std::vector<double> details_data;
+    BOOST_FOREACH( Details const* d, details ) {
+      serials.push_back( d->serial_number );
+      date_times.push_back( d->date_time );
+      descriptions.push_back( d->description );
+      choosers.push_back( d->chooser_name );
+      details_data.push_back( d->focalplane_x );
+      details_data.push_back( d->focalplane_y );
+      details_data.push_back( d->ephemeris_time );
+      details_data.push_back( d->diameter );
+    }
+
+    std::ofstream f( filename.c_str(), std::ofstream::binary );
+    if ( !f.is_open() )
+      vw_throw( IOErr() << "Failed to open \"" << filename << "\" for writing." );
+
+    f.write( SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC) );
+    f.write((char*)&SNAPSHOT_VERSION, sizeof(SNAPSHOT_VERSION));
+    f << m_targetName << char(0) << m_networkId << char(0)
+      << m_created << char(0) << m_modified << char(0)
+      << m_description << char(0) << m_userName << char(0);
+    f.write((char*)&(m_type), sizeof(m_type));
+    write_snapshot_column( f, m_image_names );
+
+    write_snapshot_column( f, point_ids );
+    write_snapshot_column( f, point_flags );
+    write_snapshot_column( f, point_data );
+    write_snapshot_column( f, measure_counts );
+
+    write_snapshot_column( f, measure_data );
+    write_snapshot_column( f, image_ids );
+    write_snapshot_column( f, measure_flags );
+    write_snapshot_column( f, details_index );
+
+    write_snapshot_column( f, serials );
+    write_snapshot_column( f, date_times );
+    write_snapshot_column( f, descriptions );
+    write_snapshot_column( f, choosers );
+    write_snapshot_column( f, details_data );
+
+    if ( !f )
+      vw_throw( IOErr() << "Failed to write \"" << filename << "\"." );
+    f.close();
+  }
+
+  /// Read a snapshot of the control network
+  void ControlNetwork::read_snapshot( std::string const& filename ) {
+    typedef ControlMeasure::Details Details;
+
+    std::ifstream f( filename.c_str(), std::ifstream::binary );
+    if ( !f.is_open() )
+      vw_throw( IOErr() << "Failed to open \"" << filename << "\" as a Control Network." );
+
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    uint32 version = 0;
+    f.read( magic, sizeof(magic) );
+    f.read((char*)&version, sizeof(version));
+    if ( !f || !std::equal( magic, magic + sizeof(magic), SNAPSHOT_MAGIC ) )
+      vw_throw( IOErr() << "\"" << filename << "\" is not a Control Network snapshot." );
+    if ( version != SNAPSHOT_VERSION )
+      vw_throw( IOErr() << "Unsupported Control Network snapshot version "
+                << version << " in \"" << filename << "\"." );
+
+    std::getline( f, m_targetName, '\0' );
+    std::getline( f, m_networkId, '\0' );
+    std::getline( f, m_created, '\0' );
+    std::getline( f, m_modified, '\0' );
+    std::getline( f, m_description, '\0' );
+    std::getline( f, m_userName, '\0' );
+    f.read((char*)&(m_type), sizeof(m_type));
+
+    // The size of the first column of each group sets the size of the
+    // rest of the group.
+    uint64 num_images = read_snapshot_size( f, 1 );
+    m_image_names.resize( num_images );
+    for ( uint64 i = 0; i < num_images; i++ )
+      std::getline( f, m_image_names[i], '\0' );
+
+    std::vector<std::string> point_ids;
+    std::vector<uint8>  point_flags;
+    std::vector<double> point_data;
+    std::vector<uint32> measure_counts;
+    uint64 num_points = read_snapshot_size( f, 1 );
+    point_ids.resize( num_points );
+    for ( uint64 i = 0; i < num_points; i++ )
+      std::getline( f, point_ids[i], '\0' );
+    read_snapshot_column( f, point_flags, num_points );
+    read_snapshot_column( f, point_data, 6 * num_points );
+    read_snapshot_column( f, measure_counts, num_points );
+
+    // Each measure has at least its four floats left to read
+    uint64 num_measures = 0;
+    uint64 max_measures = snapshot_capacity( f, 4 * sizeof(float) );
+    BOOST_FOREACH( uint32 count, measure_counts ) {
+      num_measures += count;
+      if ( num_measures > max_measures )
+        vw_throw( IOErr() << "Control network snapshot \"" << filename
+                  << "\" is truncated or corrupt." );
+    }
+    std::vector<float>  measure_data;
+    std::vector<uint64> image_ids;
+    std::vector<uint8>  measure_flags;
+    std::vector<uint32> details_index;
+    read_snapshot_column( f, measure_data, 4 * num_measures );
+    read_snapshot_column( f, image_ids, num_measures );
+    read_snapshot_column( f, measure_flags, num_measures );
+    read_snapshot_column( f, details_index, num_measures );
+
+    std::vector<std::string> serials, date_times, descriptions, choosers;
+    std::vector<double> details_data;
+    uint64 num_details = read_snapshot_size( f, 1 );
+    serials.resize( num_details );
+    for ( uint64 i = 0; i < num_details; i++ )
+      std::getline( f, serials[i], '\0' );
+    read_snapshot_column( f, date_times, num_details );
+    read_snapshot_column( f, descriptions, num_details );
+    read_snapshot_column( f, choosers, num_details );
+    read_snapshot_column( f, details_data, 4 * num_details );
+    if ( !f )
+      vw_throw( IOErr() << "Control network snapshot \"" << filename
+                << "\" is truncated or corrupt." );
+    f.close();
+
+    std::vector<boost::shared_ptr<Details> > details( num_details );
+    for ( uint64 i = 0; i < num_details; i++ ) {
+      details[i].reset( new Details() );
+      details[i]->serial_number  = serials[i];
+      details[i]->date_time      = date_times[i];
+      details[i]->description    = descriptions[i];
+      details[i]->chooser_name   = choosers[i];
+      details[i]->focalplane_x   = details_data[4*i];
+      details[i]->focalplane_y   = details_data[4*i+1];
+      details[i]->ephemeris_time = details_data[4*i+2];
+      details[i]->diameter       = details_data[4*i+3];
+    }
+
+    // Reassembling the points
+    m_control_points.clear();
+    m_control_points.resize( num_points );
+    ControlMeasure cm;
+    size_t m = 0;
+    for ( uint64 p = 0; p < num_points; p++ ) {
+      ControlPoint& cp = m_control_points[p];
+      cp.set_id( point_ids[p] );
+      cp.set_ignore( point_flags[p] & 1 );
+      cp.set_type( ControlPoint::ControlPointType( point_flags[p] >> 1 ) );
+      cp.set_position( point_data[6*p], point_data[6*p+1], point_data[6*p+2] );
+      cp.set_sigma( point_data[6*p+3], point_data[6*p+4], point_data[6*p+5] );
+      cp.reserve( measure_counts[p] );
+      for ( uint32 i = 0; i < measure_counts[p]; i++, m++ ) {
+        if ( details_index[m] >= num_details )
+          vw_throw( IOErr() << "Control network snapshot \"" << filename
+                    << "\" is corrupt." );
+        cm.m_col             = measure_data[4*m];
+        cm.m_row             = measure_data[4*m+1];
+        cm.m_col_sigma       = measure_data[4*m+2];
+        cm.m_row_sigma       = measure_data[4*m+3];
+        cm.m_image_id        = image_ids[m];
+        cm.m_ignore          = measure_flags[m] & 1;
+        cm.m_pixels_dominant = measure_flags[m] & 2;
+        cm.m_type            = ControlMeasure::ControlMeasureType( measure_flags[m] >> 2 );
+        cm.m_details         = details[ details_index[m] ];
+        cp.add_measure( cm );
+      }
+    }
+  }
+
 void ControlNetwork::write_in_gcp_format(std::string const& filename, cartography::Datum const& d) const{
 
   const std::string UNSPECIFIED_DATUM = "unspecified_datum";
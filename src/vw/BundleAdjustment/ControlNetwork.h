@@ -26,6 +26,7 @@
 #define __VW_BUNDLEADJUSTMENT_CONTROL_NETWORK_H__
 
 // STL
+#include <atomic>
 #include <string>
 #include <vector>
 #include <fstream>
@@ -37,6 +38,7 @@
 
 // Boost
 #include <boost/algorithm/string.hpp>
+#include <boost/shared_ptr.hpp>
 
 namespace vw {
 namespace ba {
@@ -50,15 +52,48 @@ namespace ba {
   /// to a control point.  In addition to the location of the pixel, the
   /// control measure also stores the uncertainty of the measurement,
   /// and a identifier for the image from which it was derived.
+  ///
+  /// Networks can hold many millions of measures, and nearly all of
+  /// them only use the pixel location, sigma and image id. The rarely
+  /// used ISIS fields (serial number, date, focal plane location, ...)
+  /// are kept in a side record that is copied when a measure is
+  /// changed. A ControlNetwork shares equal records between the
+  /// measures it holds.
   class ControlMeasure {
-    std::string m_serialNumber;
-    float       m_col, m_row, m_col_sigma, m_row_sigma, m_diameter;
-    std::string m_date_time, m_description, m_chooserName;
-    double      m_focalplane_x, m_focalplane_y;
-    double      m_ephemeris_time;
+    struct Details {
+      std::string serial_number, date_time, description, chooser_name;
+      double      focalplane_x, focalplane_y;
+      double      ephemeris_time;
+      float       diameter;
+
+      Details() : focalplane_x(0), focalplane_y(0), ephemeris_time(0), diameter(0) {}
+      bool operator==( Details const& other ) const;
+    };
+    friend class ControlNetwork; // For the snapshot format
+
+    float       m_col, m_row, m_col_sigma, m_row_sigma;
     uint64      m_image_id;
+    boost::shared_ptr<Details> m_details;
     bool        m_ignore, m_pixels_dominant;
 
+    /// A new details record, stamped with the current time.
+    static boost::shared_ptr<Details> default_details();
+
+    /// Returns a details record that belongs to this measure alone.
+    /// Records are only shared by copying measures, and like any other
+    /// object a measure must not be copied while another thread changes
+    /// it. So once this measure is the only owner of its record, no
+    /// other thread can start sharing it, and the record can be changed
+    /// in place. The fence orders the change after the last reads of
+    /// the owners that have let go of it.
+    Details& edit_details() {
+      if ( m_details.use_count() == 1 )
+        std::atomic_thread_fence( std::memory_order_acquire );
+      else
+        m_details.reset( new Details( *m_details ) );
+      return *m_details;
+    }
+
   public:
 
     /// Control Measure Type
@@ -106,35 +141,31 @@ namespace ba {
     }
 
     /// Setting/Reading millimeter location
-    Vector2 focalplane() const { return Vector2( m_focalplane_x,
-                                                 m_focalplane_y ); }
+    Vector2 focalplane() const { return Vector2( m_details->focalplane_x,
+                                                 m_details->focalplane_y ); }
     void set_focalplane( double x, double y ) {
-      m_focalplane_x = x;
-      m_focalplane_y = y;
+      Details& details = edit_details();
+      details.focalplane_x = x;
+      details.focalplane_y = y;
     }
     void set_focalplane( Vector2 location ) {
-      m_focalplane_x = location[0];
-      m_focalplane_y = location[1];
+      set_focalplane( location[0], location[1] );
     }
 
     /// Setting/Reading dominant location (used by BA, defaults to
     /// position)
     Vector2 dominant() const {
-      return m_pixels_dominant ? Vector2(m_col,m_row) : Vector2(m_focalplane_x,m_focalplane_y);
+      return m_pixels_dominant ? Vector2(m_col,m_row) : focalplane();
     }
     void set_dominant( double x, double y ) {
       if ( m_pixels_dominant ) {
         m_col = x; m_row = y;
       } else {
-        m_focalplane_x = x; m_focalplane_y = y;
+        set_focalplane( x, y );
       }
     }
     void set_dominant( Vector2 location ) {
-      if ( m_pixels_dominant ) {
-        m_col = location[0]; m_row = location[1];
-      } else {
-        m_focalplane_x = location[0]; m_focalplane_y = location[1];
-      }
+      set_dominant( location[0], location[1] );
     }
     bool is_pixels_dominant() { return m_pixels_dominant; }
     void set_pixels_dominant( bool state ) { m_pixels_dominant = state; }
@@ -160,20 +191,20 @@ namespace ba {
     void set_image_id(uint64 image_id) { m_image_id = image_id; }
 
     /// Setting/Reading the description
-    std::string description() const { return m_description; }
-    void set_description(std::string const& description) { m_description = description; }
+    std::string description() const { return m_details->description; }
+    void set_description(std::string const& description) { edit_details().description = description; }
 
     /// Setting/Reading the data & time
-    std::string date_time() const { return m_date_time; }
-    void set_date_time(std::string const& date_time) { m_date_time = date_time; }
+    std::string date_time() const { return m_details->date_time; }
+    void set_date_time(std::string const& date_time) { edit_details().date_time = date_time; }
 
     /// Setting/Reading the chooser's name
-    std::string chooser() const { return m_chooserName; }
-    void set_chooser(std::string const& chooser) { m_chooserName = chooser; }
+    std::string chooser() const { return m_details->chooser_name; }
+    void set_chooser(std::string const& chooser) { edit_details().chooser_name = chooser; }
 
     /// Setting/Reading the measure's serial number
-    std::string serial() const { return m_serialNumber; }
-    void set_serial(std::string const& serial) { m_serialNumber = serial; }
+    std::string serial() const { return m_details->serial_number; }
+    void set_serial(std::string const& serial) { edit_details().serial_number = serial; }
 
     /// Setting/Reading whether this control measurement should be
     /// ignored in a bundle adjustment.
@@ -181,8 +212,12 @@ namespace ba {
     void set_ignore(bool state) { m_ignore = state; }
 
     /// Setting/Reading Ephemeris Time
-    double ephemeris_time() const { return m_ephemeris_time; }
-    void set_ephemeris_time( double const& time ) { m_ephemeris_time = time; }
+    double ephemeris_time() const { return m_details->ephemeris_time; }
+    void set_ephemeris_time( double const& time ) { edit_details().ephemeris_time = time; }
+
+    /// Setting/Reading the diameter of the measured feature
+    float diameter() const { return m_details->diameter; }
+    void set_diameter( float diameter ) { edit_details().diameter = diameter; }
 
     /// Get the image name associated with this point in a control network.
     /// - Returns an empty string if there is no associated image name.
@@ -326,6 +361,15 @@ namespace ba {
     /// 3D points, each with a list of observations.
     std::vector<ControlPoint> m_control_points;
 
+    /// The details record of the last measure added. Points are
+    /// usually added in long runs of measures with equal details, so
+    /// these share it rather than each keeping their own.
+    boost::shared_ptr<ControlMeasure::Details> m_last_details;
+
+    /// Shares the details records of the measures in a point that was
+    /// just added.
+    void share_details( ControlPoint& point );
+
     std::string m_targetName;         // Name of the target
     std::string m_networkId;          // Network Id
     std::string m_created;            // Creation Date
@@ -448,6 +492,14 @@ namespace ba {
     /// Write to a csv file in the same format used for ground control points.
     void write_in_gcp_format( std::string const& filename, cartography::Datum const& d) const;
 
+    /// Snapshot I/O. A snapshot stores the whole network, including the
+    /// image list, as a few large arrays per field. It is much faster
+    /// to read and write than the other formats and is meant for
+    /// caching a built network between runs. The layout is native
+    /// endian and is not meant for exchange between machines.
+    void read_snapshot ( std::string const& filename );
+    void write_snapshot( std::string const& filename ) const;
+
   }; // End class ControlNetwork
 
   std::ostream& operator<<( std::ostream& os, ControlNetwork const& cnet);
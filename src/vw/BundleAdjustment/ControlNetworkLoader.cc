@@ -17,6 +17,7 @@
 
 
 #include <vw/BundleAdjustment/ControlNetworkLoader.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Stereo/StereoModel.h>
 #include <vw/InterestPoint/Matcher.h>
 
@@ -24,26 +25,64 @@ using namespace vw;
 using namespace vw::ba;
 
 #include <boost/filesystem/fstream.hpp>
+#include <boost/unordered_map.hpp>
 
-namespace fs = boost::filesystem;
-
-struct ContainsEqualIP {
-  ip::InterestPoint& m_compare;
-  ContainsEqualIP( ip::InterestPoint& comp ) : m_compare(comp) {}
+#include <exception>
 
-  bool operator()( boost::shared_ptr<IPFeature> in ) {
-    if (  m_compare.x == in->m_ip.x &&
-          m_compare.y == in->m_ip.y )
-      return true;
-    return false;
-  }
-};
+namespace fs = boost::filesystem;
 
 // Utility for checking that the point is BA safe
 void safe_measurement( ip::InterestPoint& ip ) {
   if ( ip.scale <= 0 ) ip.scale = 10;
 }
 
+// Reads one match file and strips it down to what the network needs.
+class MatchFileLoadTask : public Task {
+  std::string m_match_file;
+  std::vector<ip::InterestPoint> &m_ip1, &m_ip2;
+  std::exception_ptr& m_error;
+public:
+  MatchFileLoadTask( std::string const& match_file,
+                     std::vector<ip::InterestPoint>& ip1,
+                     std::vector<ip::InterestPoint>& ip2,
+                     std::exception_ptr& error ) :
+    m_match_file(match_file), m_ip1(ip1), m_ip2(ip2), m_error(error) {}
+
+  void operator()() {
+    try {
+      vw_out(DebugMessage,"ba") << "Loading: " << m_match_file << std::endl;
+      ip::read_binary_match_file( m_match_file, m_ip1, m_ip2 );
+      std::for_each( m_ip1.begin(), m_ip1.end(), ip::remove_descriptor );
+      std::for_each( m_ip2.begin(), m_ip2.end(), ip::remove_descriptor );
+      std::for_each( m_ip1.begin(), m_ip1.end(), safe_measurement );
+      std::for_each( m_ip2.begin(), m_ip2.end(), safe_measurement );
+    } catch ( ... ) {
+      m_error = std::current_exception();
+    }
+  }
+};
+
+// Finds the feature at a pixel location in each image, so that matches
+// from different files that land on the same pixel become one point.
+class FeatureIndex {
+  typedef boost::shared_ptr<ba::IPFeature> f_ptr;
+  typedef boost::unordered_map<std::pair<float,float>, f_ptr> image_index;
+  std::vector<image_index> m_index;
+  ba::CameraRelationNetwork<ba::IPFeature>& m_crn;
+public:
+  FeatureIndex( ba::CameraRelationNetwork<ba::IPFeature>& crn ) :
+    m_index( crn.size() ), m_crn( crn ) {}
+
+  f_ptr const& find_or_add( ip::InterestPoint const& ip, size_t image ) {
+    f_ptr& feature = m_index[image][ std::make_pair( ip.x, ip.y ) ];
+    if ( !feature ) {
+      feature.reset( new ba::IPFeature( ip, image ) );
+      m_crn[image].relations.push_front( feature );
+    }
+    return feature;
+  }
+};
+
 double vw::ba::triangulate_control_point( ControlPoint& cp,
                                           std::vector<boost::shared_ptr<camera::CameraModel> >
                                           const& camera_models,
@@ -186,67 +225,65 @@ bool vw::ba::build_control_network( bool triangulate_control_points,
     }
   }
 
-  // Loop through the match files...
+  // Loop through the match files. They are read in parallel a batch
+  // at a time and merged in order, so the network comes out the same
+  // no matter how many threads are used.
   size_t num_load_rejected = 0, num_loaded = 0;
-  for (size_t file_iter = 0; file_iter < match_files_vec.size(); file_iter++){
-    std::string match_file = match_files_vec[file_iter];
-    size_t index1 = index1_vec[file_iter];
-    size_t index2 = index2_vec[file_iter];
-
-    // Actually read in the file as it seems we've found something correct
-    std::vector<ip::InterestPoint> ip1, ip2;
-    vw_out(DebugMessage,"ba") << "Loading: " << match_file << std::endl;
-    ip::read_binary_match_file( match_file, ip1, ip2 );
-    if ( ip1.size() < min_matches ) {
-      vw_out(DebugMessage,"ba") << "\t" << match_file << "    "
-                                << ip1.size() << " matches. [rejected]\n";
-      num_load_rejected += ip1.size();
-      continue;
+  int num_threads = vw_settings().default_num_threads();
+  size_t batch_size = 4 * std::max( num_threads, 1 );
+  FeatureIndex feature_index( crn );
+  TerminalProgressCallback progress("ba", "Building: ");
+  progress.report_progress(0);
+  for ( size_t batch_start = 0; batch_start < match_files_vec.size();
+        batch_start += batch_size ) {
+    size_t batch_end = std::min( batch_start + batch_size, match_files_vec.size() );
+    std::vector<std::vector<ip::InterestPoint> > ip1( batch_end - batch_start ),
+      ip2( batch_end - batch_start );
+    std::vector<std::exception_ptr> errors( batch_end - batch_start );
+    {
+      FifoWorkQueue queue( num_threads );
+      for ( size_t file_iter = batch_start; file_iter < batch_end; file_iter++ ) {
+        size_t b = file_iter - batch_start;
+        queue.add_task( boost::shared_ptr<Task>
+                        ( new MatchFileLoadTask( match_files_vec[file_iter],
+                                                 ip1[b], ip2[b], errors[b] ) ) );
+      }
+      queue.join_all();
     }
-    vw_out(DebugMessage,"ba") << "\t" << match_file << "    "
-                              << ip1.size() << " matches.\n";
-    num_loaded += ip1.size();
-
-    // Remove descriptors from interest points and correct scale
-    std::for_each( ip1.begin(), ip1.end(), ip::remove_descriptor );
-    std::for_each( ip2.begin(), ip2.end(), ip::remove_descriptor );
-    std::for_each( ip1.begin(), ip1.end(), safe_measurement );
-    std::for_each( ip2.begin(), ip2.end(), safe_measurement );
-
-    typedef boost::shared_ptr< ba::IPFeature > f_ptr;
-    typedef std::list< f_ptr >::iterator f_itr;
-
-    // Checking to see if features already exist, adding if they
-    // don't, then linking them.
-    vw_out() << "Building the control network for " << match_file <<".\n";
-    TerminalProgressCallback progress("ba", "Building: ");
-    progress.report_progress(0);
-    double inc_prog = 1.0/double(ip1.size());
-    for ( size_t k = 0; k < ip1.size(); k++ ) { // Loop through all existing IP
-      // Check if either IP is already in the lists
-      f_itr ipfeature1 = std::find_if( crn[index1].begin(),
-                                       crn[index1].end(),
-                                       ContainsEqualIP( ip1[k] ) );
-      f_itr ipfeature2 = std::find_if( crn[index2].begin(),
-                                       crn[index2].end(),
-                                       ContainsEqualIP( ip2[k] ) );
-      // If the IP are new, add them to the list
-      if ( ipfeature1 == crn[index1].end() ) {
-        crn[index1].relations.push_front( f_ptr( new ba::IPFeature( ip1[k], index1 ) ) );
-        ipfeature1 = crn[index1].begin();
+
+    for ( size_t file_iter = batch_start; file_iter < batch_end; file_iter++ ) {
+      size_t b = file_iter - batch_start;
+      std::string const& match_file = match_files_vec[file_iter];
+      size_t index1 = index1_vec[file_iter];
+      size_t index2 = index2_vec[file_iter];
+      if ( errors[b] )
+        std::rethrow_exception( errors[b] );
+
+      if ( ip1[b].size() < min_matches ) {
+        vw_out(DebugMessage,"ba") << "\t" << match_file << "    "
+                                  << ip1[b].size() << " matches. [rejected]\n";
+        num_load_rejected += ip1[b].size();
+        continue;
       }
-      if ( ipfeature2 == crn[index2].end() ) {
-        crn[index2].relations.push_front( f_ptr( new ba::IPFeature( ip2[k], index2 ) ) );
-        ipfeature2 = crn[index2].begin();
+      vw_out(DebugMessage,"ba") << "\t" << match_file << "    "
+                                << ip1[b].size() << " matches.\n";
+      num_loaded += ip1[b].size();
+
+      // Finding or adding the features, then linking them.
+      for ( size_t k = 0; k < ip1[b].size(); k++ ) {
+        boost::shared_ptr<ba::IPFeature> const& ipfeature1 =
+          feature_index.find_or_add( ip1[b][k], index1 );
+        boost::shared_ptr<ba::IPFeature> const& ipfeature2 =
+          feature_index.find_or_add( ip2[b][k], index2 );
+
+        // Doubly linking
+        ipfeature1->connection( ipfeature2, false );
+        ipfeature2->connection( ipfeature1, false );
       }
-
-      // Doubly linking
-      (*ipfeature1)->connection( *ipfeature2, false );
-      (*ipfeature2)->connection( *ipfeature1, false );
-      progress.report_incremental_progress(inc_prog );
-    } // End loop through ip1
-    progress.report_finished();
+    }
+    progress.report_progress( double(batch_end) / double(match_files_vec.size()) );
   } // End loop through match files
+  progress.report_finished();
 
   if ( num_load_rejected != 0 ) {
     vw_out(WarningMessage,"ba") << "\tDidn't load " << num_load_rejected
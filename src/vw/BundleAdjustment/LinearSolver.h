@@ -0,0 +1,171 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file LinearSolver.h
+///
+/// Solvers for the reduced camera system S * delta_a = e that the
+/// sparse bundle adjusters build after eliminating the points.
+///
+/// - SkylineLDLSolver is the original method. It reorders S with
+///   Cuthill-McKee and runs an LDL^T decomposition on its skyline
+///   profile. It works well for strip-like networks. The profile fills
+///   in badly when cameras overlap in many directions.
+/// - SupernodalCholeskySolver reorders by nested dissection and runs
+///   a supernodal Cholesky factorization. Fill-in stays close to the
+///   real structure of the factor.
+/// - BlockJacobiPCGSolver never factors S. It runs conjugate gradient
+///   preconditioned by the inverse camera blocks, so memory stays at
+///   the size of S for very large networks.
+
+#ifndef __VW_BUNDLEADJUSTMENT_LINEAR_SOLVER_H__
+#define __VW_BUNDLEADJUSTMENT_LINEAR_SOLVER_H__
+
+#include <vw/Core/Exception.h>
+#include <vw/Core/Log.h>
+#include <vw/Math/Vector.h>
+#include <vw/Math/SparseCholesky.h>
+#include <vw/Math/ConjugateGradient.h>
+#include <vw/Math/MatrixSparseSkyline.h>
+
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace vw {
+namespace ba {
+
+  enum LinearSolverType {
+    SkylineLinearSolver,
+    CholeskyLinearSolver,
+    PCGLinearSolver
+  };
+
+  // Base class for the reduced system solvers. The pattern of S is
+  // the same for every iteration of an adjustment, so solvers are
+  // free to cache anything that only depends on it.
+  class ReducedSystemSolver {
+  public:
+    virtual ~ReducedSystemSolver() {}
+    virtual Vector<double> solve( math::BlockSparseSymmetricMatrix const& S,
+                                  Vector<double> const& e ) = 0;
+    virtual std::string name() const = 0;
+  };
+
+  /// Copies a block matrix into a skyline matrix
+  template <class ElemT>
+  math::MatrixSparseSkyline<ElemT> block_to_skyline( math::BlockSparseSymmetricMatrix const& S ) {
+    size_t bs = S.block_size();
+    math::MatrixSparseSkyline<ElemT> result( S.rows(), S.cols() );
+    for ( size_t j = 0; j < S.num_blocks(); j++ ) {
+      typedef math::BlockSparseSymmetricMatrix::column_type::const_iterator col_iter;
+      for ( col_iter it = S.column(j).begin(); it != S.column(j).end(); ++it ) {
+        size_t i = it->first;
+        for ( size_t r = 0; r < bs; r++ )
+          for ( size_t c = 0; c < bs; c++ )
+            if ( i != j || r >= c )
+              result( i*bs + r, j*bs + c ) = it->second(r,c);
+      }
+    }
+    return result;
+  }
+
+  // This is a template so that the ublas based skyline matrix is only
+  // compiled by code that uses it.
+  template <class ElemT>
+  class SkylineLDLSolver : public ReducedSystemSolver {
+    std::vector<size_t> m_ordering;
+    Vector<size_t> m_skyline;
+    bool m_found_ordering;
+  public:
+    SkylineLDLSolver() : m_found_ordering(false) {}
+
+    Vector<double> solve( math::BlockSparseSymmetricMatrix const& block_S,
+                          Vector<double> const& e ) {
+      math::MatrixSparseSkyline<ElemT> S = block_to_skyline<ElemT>( block_S );
+
+      if ( !m_found_ordering ) {
+        m_ordering = cuthill_mckee_ordering( S, block_S.block_size() );
+        math::MatrixReorganize<math::MatrixSparseSkyline<ElemT> > mod_S( S, m_ordering );
+        m_skyline = solve_for_skyline( mod_S );
+        m_found_ordering = true;
+      }
+
+      // Compute the LDL^T decomposition and solve using sparse methods.
+      math::MatrixReorganize<math::MatrixSparseSkyline<ElemT> > modified_S( S, m_ordering );
+      Vector<double> delta = sparse_solve( modified_S,
+                                           reorganize(e, m_ordering),
+                                           m_skyline );
+      return reorganize(delta, modified_S.inverse());
+    }
+
+    std::string name() const { return "skyline LDL"; }
+  };
+
+  class SupernodalCholeskySolver : public ReducedSystemSolver {
+    math::SupernodalCholesky m_cholesky;
+  public:
+    Vector<double> solve( math::BlockSparseSymmetricMatrix const& S,
+                          Vector<double> const& e ) {
+      if ( !m_cholesky.analyzed() ) {
+        m_cholesky.analyze( S );
+        vw_out(DebugMessage,"ba") << "Supernodal Cholesky: " << m_cholesky.num_supernodes()
+                                  << " supernodes, " << m_cholesky.factor_size()
+                                  << " entries in L.\n";
+      }
+      try {
+        m_cholesky.factor( S );
+      } catch ( const MathErr& err ) {
+        // Same outcome as a failed skyline solve: no step is taken and
+        // the adjuster raises lambda.
+        vw_out(WarningMessage,"ba") << err.what() << "\n";
+        Vector<double> result( e.size() );
+        result.set_all( std::numeric_limits<double>::quiet_NaN() );
+        return result;
+      }
+      return m_cholesky.solve( e );
+    }
+
+    std::string name() const { return "supernodal Cholesky"; }
+  };
+
+  class BlockJacobiPCGSolver : public ReducedSystemSolver {
+    int m_max_iterations;
+    double m_tolerance;
+    int m_last_iterations;
+  public:
+    BlockJacobiPCGSolver( int max_iterations = 500, double tolerance = 1e-10 ) :
+      m_max_iterations(max_iterations), m_tolerance(tolerance), m_last_iterations(0) {}
+
+    Vector<double> solve( math::BlockSparseSymmetricMatrix const& S,
+                          Vector<double> const& e ) {
+      Vector<double> x( e.size() );
+      return math::preconditioned_conjugate_gradient( S, e, x,
+                                                      math::BlockJacobiPreconditioner( S ),
+                                                      m_max_iterations, m_tolerance,
+                                                      &m_last_iterations );
+    }
+
+    /// Iterations used by the last solve
+    int last_iterations() const { return m_last_iterations; }
+
+    std::string name() const { return "block Jacobi PCG"; }
+  };
+
+}} // namespace vw::ba
+
+#endif//__VW_BUNDLEADJUSTMENT_LINEAR_SOLVER_H__
@@ -213,6 +213,53 @@ protected:
   boost::shared_ptr<ControlNetwork> cnet;
 };
 
+// Like ComparisonTest, but without the corrupted pose of camera 3.
+// That pose turns the camera away from every point, which leaves its
+// block of the reduced camera system empty.
+class SolverTest : public ::testing::Test {
+protected:
+  SolverTest() {}
+
+  virtual void SetUp() {
+    generate_camera_data( cameras, cnet );
+
+    cameras[0]->set_camera_center( cameras[0]->camera_center() +
+                                   Vector3(1.2,0,-1) );
+    cameras[1]->set_camera_center( cameras[1]->camera_center() +
+                                   Vector3(0.5,2,1) );
+    cameras[2]->set_camera_center( cameras[2]->camera_center() +
+                                   Vector3(-0.2,-1,3.0) );
+    for ( uint32 i = 0; i < cnet->size(); i++ ) {
+      if ( i % 2 ) {
+        (*cnet)[i].set_position( (*cnet)[i].position()+Vector3(-1,0.5,-0.7) );
+      } else {
+        (*cnet)[i].set_position( (*cnet)[i].position()+Vector3(0.4,-1.5,0.3) );
+      }
+    }
+  }
+
+  // Runs AdjustSparse and returns the camera parameters
+  std::vector<Vector<double> > adjust_sparse( LinearSolverType solver,
+                                              int num_threads = 1 ) {
+    TestBAModel model( cameras, cnet );
+    AdjustSparse< TestBAModel, L2Error > adjuster( model, L2Error(), true, true );
+    adjuster.set_linear_solver( solver );
+    adjuster.set_num_threads( num_threads );
+
+    double abs_tol = 1e10, rel_tol = 1e10;
+    for ( unsigned i = 0; i < 10; i++ )
+      adjuster.update(abs_tol,rel_tol);
+
+    std::vector<Vector<double> > solution;
+    for ( uint32 i = 0; i < model.num_cameras(); i++ )
+      solution.push_back( model.cam_params(i) );
+    return solution;
+  }
+
+  std::vector<boost::shared_ptr<PinholeModel> > cameras;
+  boost::shared_ptr<ControlNetwork> cnet;
+};
+
 // Null Tests
 // -----------------------
 TEST_F( NullTest, AdjustRef ) {
@@ -324,6 +371,41 @@ TEST_F( ComparisonTest, Ref_VS_Sparse ) {
                         1e-3 );
 }
 
+// Linear Solver Tests
+// -----------------------
+TEST_F( SolverTest, Skyline_VS_Cholesky ) {
+  std::vector<Vector<double> > skyline = adjust_sparse( SkylineLinearSolver );
+  std::vector<Vector<double> > cholesky = adjust_sparse( CholeskyLinearSolver );
+
+  ASSERT_EQ( skyline.size(), cholesky.size() );
+  for ( uint32 i = 0; i < skyline.size(); i++ )
+    EXPECT_VECTOR_NEAR( skyline[i], cholesky[i], 1e-5 );
+
+  // The corrupted cameras have to move for this to mean anything
+  EXPECT_GT( norm_2( subvector( skyline[0], 0, 3 ) ), 0.5 );
+}
+
+TEST_F( SolverTest, Skyline_VS_PCG ) {
+  std::vector<Vector<double> > skyline = adjust_sparse( SkylineLinearSolver );
+  std::vector<Vector<double> > pcg = adjust_sparse( PCGLinearSolver );
+
+  ASSERT_EQ( skyline.size(), pcg.size() );
+  for ( uint32 i = 0; i < skyline.size(); i++ )
+    EXPECT_VECTOR_NEAR( skyline[i], pcg[i], 1e-5 );
+}
+
+TEST_F( SolverTest, Sparse_Threads ) {
+  LinearSolverType solvers[] = { SkylineLinearSolver, CholeskyLinearSolver, PCGLinearSolver };
+  for ( uint32 s = 0; s < 3; s++ ) {
+    std::vector<Vector<double> > serial = adjust_sparse( solvers[s], 1 );
+    std::vector<Vector<double> > threaded = adjust_sparse( solvers[s], 4 );
+
+    ASSERT_EQ( serial.size(), threaded.size() );
+    for ( uint32 i = 0; i < serial.size(); i++ )
+      EXPECT_VECTOR_NEAR( serial[i], threaded[i], 1e-10 );
+  }
+}
+
 // For whatever reason .. RobustRef and RobustSparse diverge
 // quickly. This is probably do to unwise application of floats or
 // arithmetic ordering.
@@ -18,6 +18,7 @@
 
 #include <gtest/gtest_VW.h>
 
+#include <fstream>
 #include <sstream>
 #include <vw/BundleAdjustment/ControlNetwork.h>
 
@@ -25,6 +26,7 @@
 
 using namespace vw;
 using namespace vw::ba;
+using namespace vw::test;
 
 TEST( ControlNetwork, Construction ) {
 
@@ -108,3 +110,117 @@ TEST( ControlNetwork, Construction ) {
   cnet.clear();
   ASSERT_EQ( cnet.size(), 0u );
 }
+
+TEST( ControlNetwork, MeasureDetails ) {
+  ControlMeasure cm1( 10, 20, 1, 1, 0 );
+  ControlMeasure cm2 = cm1;
+  EXPECT_EQ( "Null", cm1.serial() );
+  EXPECT_FALSE( cm1.date_time().empty() );
+
+  // Changing a copy leaves the original alone
+  cm2.set_serial( "image2" );
+  cm2.set_focalplane( 1.5, 2.5 );
+  EXPECT_EQ( "Null", cm1.serial() );
+  EXPECT_EQ( "image2", cm2.serial() );
+  EXPECT_VECTOR_DOUBLE_EQ( Vector2(), cm1.focalplane() );
+  EXPECT_VECTOR_DOUBLE_EQ( Vector2(1.5,2.5), cm2.focalplane() );
+
+  cm2.set_pixels_dominant( false );
+  cm2.set_dominant( Vector2(3,4) );
+  EXPECT_VECTOR_DOUBLE_EQ( Vector2(3,4), cm2.focalplane() );
+  EXPECT_VECTOR_DOUBLE_EQ( Vector2(10,20), cm2.position() );
+
+  // Measures in a network may share their details, but changing one
+  // still leaves the others alone.
+  ControlNetwork cnet( "TestCNET" );
+  for ( int i = 0; i < 3; i++ ) {
+    ControlPoint cpoint;
+    cpoint.add_measure( cm1 );
+    cpoint.add_measure( i == 1 ? cm2 : cm1 );
+    cnet.add_control_point( cpoint );
+  }
+  cnet[0][1].set_serial( "image3" );
+  EXPECT_EQ( "image3", cnet[0][1].serial() );
+  EXPECT_EQ( "Null", cnet[0][0].serial() );
+  EXPECT_EQ( "image2", cnet[1][1].serial() );
+  EXPECT_EQ( "Null", cnet[2][1].serial() );
+  EXPECT_EQ( "Null", cm1.serial() );
+  EXPECT_EQ( cm1.date_time(), cnet[2][1].date_time() );
+}
+
+TEST( ControlNetwork, Snapshot ) {
+  ControlNetwork cnet( "TestCNET", ControlNetwork::ImageToImage, "Moon" );
+  cnet.add_image_name( "image1.tif" );
+  cnet.add_image_name( "image2.tif" );
+  for ( uint32 i = 0; i < 5; i++ ) {
+    ControlPoint cpoint( i == 2 ? ControlPoint::GroundControlPoint : ControlPoint::TiePoint );
+    cpoint.set_position( i, 2*i, 3*i );
+    cpoint.set_sigma( 1, 2, 3 );
+    for ( uint32 j = 0; j < 2; j++ ) {
+      ControlMeasure cm( 100.5 + i, 200.25 + j, 1, 2, j );
+      if ( i == 3 ) {
+        cm.set_serial( "serial" );
+        cm.set_ephemeris_time( 12.5 );
+        cm.set_ignore( true );
+      }
+      cpoint.add_measure( cm );
+    }
+    cnet.add_control_point( cpoint );
+  }
+
+  UnlinkName snapshot("ControlNetwork.snapshot");
+  cnet.write_snapshot( snapshot );
+
+  ControlNetwork copy( "" );
+  copy.read_snapshot( snapshot );
+  ASSERT_EQ( cnet.size(), copy.size() );
+  EXPECT_EQ( ControlNetwork::ImageToGround, copy.type() );
+  ASSERT_EQ( 2u, copy.get_image_list().size() );
+  EXPECT_EQ( "image2.tif", copy.get_image_list()[1] );
+  for ( size_t i = 0; i < cnet.size(); i++ ) {
+    EXPECT_EQ( cnet[i].type(), copy[i].type() );
+    EXPECT_VECTOR_DOUBLE_EQ( cnet[i].position(), copy[i].position() );
+    EXPECT_VECTOR_DOUBLE_EQ( cnet[i].sigma(), copy[i].sigma() );
+    ASSERT_EQ( cnet[i].size(), copy[i].size() );
+    for ( size_t j = 0; j < cnet[i].size(); j++ ) {
+      EXPECT_TRUE( cnet[i][j] == copy[i][j] );
+      EXPECT_EQ( cnet[i][j].serial(), copy[i][j].serial() );
+      EXPECT_EQ( cnet[i][j].date_time(), copy[i][j].date_time() );
+      EXPECT_EQ( cnet[i][j].ignore(), copy[i][j].ignore() );
+    }
+  }
+  EXPECT_EQ( "serial", copy[3][1].serial() );
+  EXPECT_EQ( "Null", copy[4][1].serial() );
+
+  // Other formats are rejected
+  UnlinkName csv("ControlNetwork.csv");
+  cnet.write_csv( csv );
+  EXPECT_THROW( copy.read_snapshot( csv ), IOErr );
+
+  // So are snapshots with counts the file can't hold
+  std::string bytes;
+  {
+    std::ifstream in( snapshot.c_str(), std::ifstream::binary );
+    std::ostringstream buffer;
+    buffer << in.rdbuf();
+    bytes = buffer.str();
+  }
+  size_t image_count = bytes.find( "image1.tif" ) - sizeof(uint64);
+  ASSERT_LT( image_count, bytes.size() );
+  UnlinkName corrupt("ControlNetworkCorrupt.snapshot");
+  {
+    std::string bad = bytes;
+    uint64 count = uint64(1) << 60;
+    bad.replace( image_count, sizeof(count), (char*)&count, sizeof(count) );
+    std::ofstream out( corrupt.c_str(), std::ofstream::binary );
+    out << bad;
+  }
+  EXPECT_THROW( copy.read_snapshot( corrupt ), IOErr );
+  for ( size_t length = image_count; length < bytes.size(); length += 7 ) {
+    {
+      std::ofstream out( corrupt.c_str(), std::ofstream::binary );
+      out << bytes.substr( 0, length );
+    }
+    EXPECT_THROW( copy.read_snapshot( corrupt ), IOErr ) << "length " << length;
+  }
+}
@@ -18,7 +18,9 @@
 
 #include <gtest/gtest_VW.h>
 
+#include <set>
 #include <sstream>
+#include <vw/Core/Settings.h>
 #include <vw/BundleAdjustment/ControlNetworkLoader.h>
 
 #include <test/Helpers.h>
@@ -94,3 +96,101 @@ TEST( GCPLoad, LoadingGCP ) {
   EXPECT_EQ(27, cnet.size());
 }
 
+namespace {
+  // Where track t is seen in image i, if it is seen there at all
+  bool sees( size_t t, size_t i ) { return (t + i) % 3 != 0; }
+  ip::InterestPoint track_ip( size_t t, size_t i ) {
+    return ip::InterestPoint( 10.0*t + i, 3.0*t + 0.5*i );
+  }
+
+  // A point's measures as (image, col, row), ordered by image
+  std::vector<double> flatten( ControlPoint const& cp ) {
+    std::set<std::vector<double> > measures;
+    BOOST_FOREACH( ControlMeasure const& cm, cp ) {
+      std::vector<double> measure( 3 );
+      measure[0] = cm.image_id();
+      measure[1] = cm.position()[0];
+      measure[2] = cm.position()[1];
+      measures.insert( measure );
+    }
+    std::vector<double> result;
+    BOOST_FOREACH( std::vector<double> const& measure, measures )
+      result.insert( result.end(), measure.begin(), measure.end() );
+    return result;
+  }
+}
+
+TEST( ControlNetworkLoad, BuildFromMatches ) {
+  // Every pair of images gets a match file holding the tracks they
+  // share, except the last pair, which has too few matches to load.
+  const size_t num_images = 7, num_tracks = 30;
+  std::vector<std::string> image_files;
+  for ( size_t i = 0; i < num_images; i++ ) {
+    std::ostringstream name;
+    name << "image" << i << ".tif";
+    image_files.push_back( name.str() );
+  }
+
+  std::set<std::vector<double> > tracks;
+  for ( size_t t = 0; t < num_tracks; t++ ) {
+    std::vector<double> track;
+    for ( size_t i = 0; i < num_images; i++ ) {
+      if ( !sees( t, i ) )
+        continue;
+      track.push_back( i );
+      track.push_back( track_ip( t, i ).x );
+      track.push_back( track_ip( t, i ).y );
+    }
+    tracks.insert( track );
+  }
+
+  std::vector<boost::shared_ptr<UnlinkName> > unlink;
+  std::map<std::pair<int,int>, std::string> match_files;
+  for ( size_t i = 0; i < num_images; i++ ) {
+    for ( size_t j = i + 1; j < num_images; j++ ) {
+      std::vector<ip::InterestPoint> ip1, ip2;
+      if ( i == num_images - 2 ) {
+        ip1.push_back( ip::InterestPoint( 1000, 1000 ) );
+        ip2.push_back( ip::InterestPoint( 1000, 1000 ) );
+      } else {
+        for ( size_t t = 0; t < num_tracks; t++ ) {
+          if ( sees( t, i ) && sees( t, j ) ) {
+            ip1.push_back( track_ip( t, i ) );
+            ip2.push_back( track_ip( t, j ) );
+          }
+        }
+      }
+      std::ostringstream name;
+      name << "BuildFromMatches-" << i << "__" << j << ".match";
+      unlink.push_back( boost::shared_ptr<UnlinkName>( new UnlinkName( name.str() ) ) );
+      ip::write_binary_match_file( *unlink.back(), ip1, ip2 );
+      match_files[ std::make_pair( int(i), int(j) ) ] = *unlink.back();
+    }
+  }
+
+  // Loading is split into batches of 4 files per thread, so 4 threads
+  // take two batches here.
+  std::vector<boost::shared_ptr<camera::CameraModel> > cameras( num_images );
+  uint32 num_threads = vw_settings().default_num_threads();
+  ControlNetwork serial( "serial" ), parallel( "parallel" );
+  vw_settings().set_default_num_threads( 1 );
+  EXPECT_TRUE( build_control_network( false, serial, cameras, image_files,
+                                      match_files, 2, 0, 0 ) );
+  vw_settings().set_default_num_threads( 4 );
+  EXPECT_TRUE( build_control_network( false, parallel, cameras, image_files,
+                                      match_files, 2, 0, 0 ) );
+  vw_settings().set_default_num_threads( num_threads );
+
+  // One point per track, in the same order however many threads read
+  // the files.
+  ASSERT_EQ( num_tracks, serial.size() );
+  ASSERT_EQ( serial.size(), parallel.size() );
+  std::set<std::vector<double> > found;
+  for ( size_t p = 0; p < serial.size(); p++ ) {
+    ASSERT_EQ( serial[p].size(), parallel[p].size() );
+    for ( size_t m = 0; m < serial[p].size(); m++ )
+      EXPECT_TRUE( serial[p][m] == parallel[p][m] );
+    found.insert( flatten( serial[p] ) );
+  }
+  EXPECT_TRUE( tracks == found );
+}
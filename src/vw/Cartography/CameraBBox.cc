@@ -18,6 +18,12 @@
 
 #include <vw/Cartography/CameraBBox.h>
 
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <fstream>
+#include <iomanip>
+
 using namespace vw;
 using vw::math::BresenhamLine;
 
@@ -165,3 +171,79 @@ BBox2 cartography::camera_bbox( cartography::GeoReference const& georef,
   return functor.box;
 }
 
+
+namespace {
+  // 64-bit FNV-1a, continued from hash
+  uint64 fnv1a( std::string const& bytes, uint64 hash = 14695981039346656037ULL ) {
+    for (size_t i = 0; i < bytes.size(); i++) {
+      hash ^= uint64((unsigned char)bytes[i]);
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+}
+
+std::string cartography::CameraBBoxCache::key( std::string const& camera_file,
+                                               std::string const& context ) const {
+  std::ifstream in(camera_file.c_str(), std::ios::binary);
+  if (!in)
+    vw_throw(IOErr() << "CameraBBoxCache: Could not read camera file " << camera_file << ".");
+  std::ostringstream contents;
+  contents << in.rdbuf();
+
+  std::ostringstream key;
+  key << std::hex << std::setfill('0')
+      << std::setw(16) << fnv1a(contents.str()) << "-"
+      << std::setw(16) << fnv1a(context);
+  return key.str();
+}
+
+std::string cartography::CameraBBoxCache::file_context( std::string const& file ) const {
+  namespace fs = boost::filesystem;
+  std::ostringstream context;
+  try {
+    context << file << " " << fs::file_size(file) << " " << fs::last_write_time(file);
+  } catch (const fs::filesystem_error& e) {
+    vw_throw(IOErr() << "CameraBBoxCache: Could not read " << file << ": " << e.what());
+  }
+  return context.str();
+}
+
+bool cartography::CameraBBoxCache::read( std::string const& key, BBox2 & bbox,
+                                         float & mean_gsd ) const {
+  std::string file = (boost::filesystem::path(m_directory) / (key + ".txt")).string();
+  std::ifstream in(file.c_str());
+  if (!in)
+    return false;
+  Vector2 min, max;
+  double gsd;
+  if (!(in >> min[0] >> min[1] >> max[0] >> max[1] >> gsd)) {
+    vw_out(WarningMessage) << "Ignoring corrupt footprint cache entry " << file << ".\n";
+    return false;
+  }
+  bbox = BBox2(min, max);
+  mean_gsd = gsd;
+  return true;
+}
+
+void cartography::CameraBBoxCache::write( std::string const& key, BBox2 const& bbox,
+                                          float mean_gsd ) const {
+  namespace fs = boost::filesystem;
+  try {
+    fs::create_directories(m_directory);
+    fs::path file = fs::path(m_directory) / (key + ".txt");
+    fs::path temp = fs::path(m_directory) / fs::unique_path(key + "-%%%%%%%%.tmp");
+    {
+      std::ofstream out(temp.string().c_str());
+      out << std::setprecision(17)
+          << bbox.min()[0] << " " << bbox.min()[1] << " "
+          << bbox.max()[0] << " " << bbox.max()[1] << " " << double(mean_gsd) << "\n";
+      out.close();
+      if (!out)
+        vw_throw(IOErr() << "CameraBBoxCache: Could not write " << temp.string() << ".");
+    }
+    fs::rename(temp, file);
+  } catch (const fs::filesystem_error& e) {
+    vw_throw(IOErr() << "CameraBBoxCache: " << e.what());
+  }
+}
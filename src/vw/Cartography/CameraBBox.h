@@ -32,10 +32,14 @@
 #include <vw/Camera/CameraModel.h>
 #include <vw/Cartography/PointImageManipulation.h>
 #include <vw/Cartography/GeoReference.h>
+#include <vw/Cartography/RayDEMIntersection.h>
 
 
 #include <boost/shared_ptr.hpp>
 
+#include <sstream>
+#include <string>
+
 
 namespace vw {
 namespace cartography {
@@ -141,6 +145,14 @@ namespace cartography {
   // hole in the DEM where there is no data, we return no-intersection
   // or intersection with the datum, depending on whether the variable
   // treat_nodata_as_zero is false or true.
+  //
+  // The search starts from the intersection with the datum, or from
+  // xyz_guess, and takes secant steps along the ray until the
+  // crossing of the DEM is bracketed, then refines the bracket. It
+  // stops when a step is under max_abs_tol + max_rel_tol times the
+  // distance along the ray, and fails if the DEM height is still off
+  // by more than height_error_tol. To intersect many rays with the
+  // same DEM, use a RayDEMIntersector instead.
   template <class DEMImageT>
   Vector3 camera_pixel_to_dem_xyz(Vector3 const& camera_ctr, Vector3 const& camera_vec,
                                   ImageViewBase<DEMImageT> const& dem_image,
@@ -148,7 +160,7 @@ namespace cartography {
                                   bool treat_nodata_as_zero,
                                   bool & has_intersection,
                                   double height_error_tol = 1e-1,  // error in DEM height
-                                  double max_abs_tol      = 1e-14, // abs cost fun change b/w iters
+                                  double max_abs_tol      = 1e-14, // abs step length b/w iters
                                   double max_rel_tol      = 1e-14,
                                   int num_max_iter        = 100,
                                   Vector3 xyz_guess       = Vector3()
@@ -157,8 +169,13 @@ namespace cartography {
     // This is a very fragile function and things can easily go wrong. 
     try {
       has_intersection = false;
-      RayDEMIntersectionLMA<DEMImageT> model(dem_image, georef, camera_ctr,
-                                             camera_vec, treat_nodata_as_zero);
+      typedef detail::RayDEMSampler<DEMImageT> SamplerT;
+      SamplerT sampler(dem_image.impl(), georef, treat_nodata_as_zero);
+
+      double len = norm_2(camera_vec);
+      if (len == 0 || len != len)
+        return Vector3();
+      Vector3 dir = camera_vec/len;
 
       Vector3 xyz;
       if ( xyz_guess == Vector3() ){ // If no guess provided
@@ -174,62 +191,108 @@ namespace cartography {
       }
 
       // Length along the ray from camera center to intersection point
-      Vector<double, 1> len0, len;
-      len0[0] = norm_2(xyz - camera_ctr);
+      double len0 = dot_prod(xyz - camera_ctr, dir);
 
       // If the ray intersects the datum at a point which does not
       // correspond to a valid location in the DEM, wiggle that point
       // along the ray until hopefully it does.
+      typename SamplerT::Sample cur, prev;
       const double radius     = norm_2(xyz); // Radius from XZY coordinate center
-      const int    ITER_LIMIT = 10; // There are two solver attempts per iteration
+      const int    ITER_LIMIT = 10; // There are two attempts per iteration
       const double small      = radius*0.02/( 1 << (ITER_LIMIT-1) ); // Wiggle
-      for (int i = 0; i <= ITER_LIMIT; i++){
+      bool found = false;
+      for (int i = 0; i <= ITER_LIMIT && !found; i++){
         // Gradually expand delta until on final iteration it is == radius*0.02
         double delta = 0;
         if (i > 0)
           delta = small*( 1 << (i-1) );
 
         for (int k = -1; k <= 1; k += 2){ // For k==-1, k==1
-          len[0] = len0[0] + k*delta; // Ray guess length +/- 2% planetary radius
-          // Use our model to compute the height diff at this length
-          Vector<double, 1> height_diff = model(len);
-          // TODO: This is an EXTREMELY lenient threshold! big_val()/10.0 == 1.0e+49!!!
-          //       The effect of this may be to just stop this loop when we get over valid DEM terrain.
-          if ( std::abs(height_diff[0]) < (model.big_val()/10.0) ){
-            has_intersection = true;
+          // Ray guess length +/- 2% planetary radius
+          sampler.evaluate(camera_ctr, dir, len0 + k*delta, cur);
+          if ( cur.diff == cur.diff ){ // There is DEM here
+            found = true;
             break;
           }
-          //if (i == 0) break; // When k*delta==0, no reason to do both + and -!
-
         } // End k loop
-        if (has_intersection)
-          break;
       } // End i loop
 
-      // Failed to compute an intersection in the hard coded iteration limit!
-      if ( !has_intersection ) {
-        return Vector3();
-      }
+      // Secant steps on the height difference, the first of which only
+      // knows how fast the ray goes down. Once the crossing is
+      // bracketed, refine it keeping the bracket.
+      double t = len0;
+      if ( found ) {
+        typename SamplerT::Sample above, below;
+        bool have_above = false, have_below = false;
+        t = cur.t;
+        for (int iter = 0; iter < num_max_iter; iter++) {
+          if (cur.diff < 0) { above = cur; have_above = true; }
+          else              { below = cur; have_below = true; }
+          if (cur.diff == 0)
+            break;
+          if (have_above && have_below) {
+            sampler.refine(camera_ctr, dir, above.t, above.diff, below.t, below.diff,
+                           height_error_tol, 0, max_abs_tol, max_rel_tol,
+                           num_max_iter - iter, t);
+            break;
+          }
 
-      // Refining the intersection using Levenberg-Marquardt
-      // - This will actually use the L-M solver to play around with the len
-      //   value to minimize the height difference from the DEM.
-      int status = 0;
-      Vector<double, 1> observation; observation[0] = 0;
-      len = math::levenberg_marquardt(model, len, observation, status,
-                                      max_abs_tol, max_rel_tol,
-                                      num_max_iter
-                                      );
+          // A secant step through two points on the same side can go
+          // away from the DEM, and then cycle over a ridge, so go by how
+          // fast the ray goes down instead.
+          double step = std::numeric_limits<double>::quiet_NaN();
+          if (iter > 0 && cur.diff != prev.diff)
+            step = -cur.diff*(cur.t - prev.t)/(cur.diff - prev.diff);
+          if (!(step*cur.diff < 0) && cur.descent != 0)
+            step = -cur.diff/cur.descent;
+          if (step != step)
+            break;
 
-      Vector<double, 1> dem_height = model(len);
+          // Back off from places with no DEM
+          typename SamplerT::Sample next;
+          sampler.evaluate(camera_ctr, dir, cur.t + step, next);
+          for (int h = 0; h < ITER_LIMIT && next.diff != next.diff; h++) {
+            step *= 0.5;
+            sampler.evaluate(camera_ctr, dir, cur.t + step, next);
+          }
+          if (next.diff != next.diff)
+            break;
+          prev = cur;
+          cur  = next;
+          t    = cur.t;
+          if (std::abs(step) <= max_abs_tol + max_rel_tol*std::abs(cur.t))
+            break;
+        }
+      }
 
-      if ( (status < 0) || (std::abs(dem_height[0]) > height_error_tol) ){
+      // The ray may cross the DEM before the point found, even where it
+      // only clips the terrain, so look for the first crossing from the
+      // camera on.  If the steps above did not find the DEM, look as far
+      // as the wiggle did.
+      typename SamplerT::Sample start, end;
+      sampler.evaluate(camera_ctr, dir, 0, start);
+      sampler.evaluate(camera_ctr, dir, t, end);
+      if ( !found || !(std::abs(end.diff) <= height_error_tol) )
+        sampler.evaluate(camera_ctr, dir, std::max(t, len0 + radius*0.02), end);
+      bool   crossed = false;
+      double t_first = t;
+      if (end.t > 0 && !(start.diff >= 0))
+        sampler.first_crossing(camera_ctr, dir, start, end, NULL,
+                               height_error_tol, 0, max_abs_tol, max_rel_tol,
+                               num_max_iter, crossed, t_first);
+      if (crossed)
+        t = t_first;
+      else if (!found)
+        return Vector3(); // Failed to find the DEM
+
+      double dem_height = sampler.height_diff(camera_ctr, dir, t);
+      if ( !(std::abs(dem_height) <= height_error_tol) ){
         has_intersection = false;
         return Vector3();
       }
 
       has_intersection = true;
-      xyz = camera_ctr + len[0]*camera_vec;
+      xyz = camera_ctr + t*dir;
       return xyz;
     }catch(...){
       has_intersection = false;
@@ -239,6 +302,40 @@ namespace cartography {
 
   namespace detail {
 
+    /// Intersects rays with a DEM one at a time, each starting from the
+    /// datum, with camera_pixel_to_dem_xyz().  This needs no pass over
+    /// the DEM, but unlike RayDEMIntersector it can miss the first
+    /// crossing of rough terrain.  It has the interface of
+    /// RayDEMIntersector which camera_bbox() uses.
+    template <class DEMImageT>
+    class DatumStartIntersector {
+      DEMImageT    m_dem;
+      GeoReference m_georef;
+      double       m_height_tol;
+    public:
+      typedef DEMImageT image_type;
+
+      DatumStartIntersector( ImageViewBase<DEMImageT> const& dem, GeoReference const& georef,
+                             double height_tol )
+        : m_dem(dem.impl()), m_georef(georef), m_height_tol(height_tol) {}
+
+      /// The guess is not used, so that a ray gives the same point
+      /// wherever it is in a batch.
+      Vector3 intersect( Vector3 const& camera_ctr, Vector3 const& camera_vec,
+                         bool& has_intersection, Vector3 const& /*xyz_guess*/ = Vector3() ) const {
+        return camera_pixel_to_dem_xyz(camera_ctr, camera_vec, m_dem, m_georef, false,
+                                       has_intersection, m_height_tol);
+      }
+
+      void intersect( std::vector<Vector3> const& camera_ctrs,
+                      std::vector<Vector3> const& camera_vecs,
+                      std::vector<Vector3>      & xyz,
+                      std::vector<bool>         & has_intersection,
+                      int num_threads = 0 ) const {
+        intersect_rays(*this, camera_ctrs, camera_vecs, xyz, has_intersection, num_threads);
+      }
+    };
+
     // TODO: This should be done by default!
     // Normalize the coordinate if lonlat
     void recenter_point(bool center_on_zero, GeoReference const& georef, Vector2 & point);
@@ -254,6 +351,34 @@ namespace cartography {
       }
     }
 
+    /// Collects the pixels bresenham_apply() visits
+    struct PixelCollector {
+      std::vector<Vector2> & pixels;
+      PixelCollector( std::vector<Vector2> & pixels ) : pixels(pixels) {}
+      void operator()( Vector2i const& pix ) { pixels.push_back(pix); }
+    };
+
+    /// Intersect the rays through these camera pixels with the DEM. The
+    /// rays are found on this thread, as camera models need not be
+    /// thread safe, and then intersected in parallel.
+    template <class IntersectorT>
+    void camera_pixels_to_dem_xyz( IntersectorT const& intersector,
+                                   camera::CameraModel const* camera,
+                                   std::vector<Vector2> const& pixels,
+                                   std::vector<Vector3> & xyz, // output
+                                   std::vector<bool> & has_intersection ) {
+      std::vector<Vector3> ctrs(pixels.size()), vecs(pixels.size());
+      for (size_t it = 0; it < pixels.size(); it++) {
+        try {
+          ctrs[it] = camera->camera_center(pixels[it]);
+          vecs[it] = camera->pixel_to_vector(pixels[it]);
+        }catch(...){
+          vecs[it] = Vector3(); // No ray, so no intersection
+        }
+      }
+      intersector.intersect(ctrs, vecs, xyz, has_intersection);
+    }
+
     /// Class to accumulate some information about a series of DEM intersections
     template <class DEMImageT>
     class CameraDEMBBoxHelper {
@@ -303,7 +428,7 @@ namespace cartography {
           
           bool   has_intersection = false;
           double height_error_tol = 1e-3;   // error in DEM height
-          double max_abs_tol      = 1e-14;  // abs cost function change b/w iters
+          double max_abs_tol      = 1e-14;  // abs step length b/w iters
           double max_rel_tol      = 1e-14;
           int    num_max_iter     = 100;
           Vector3 xyz_guess       = Vector3();
@@ -321,14 +446,26 @@ namespace cartography {
           // Quit if we did not find an intersection
           if (!has_intersection)
             return false;
-          
+
+          return dem_xyz_to_point(target_georef, center_on_zero, xyz, point);
+        }catch(...){
+          return false;
+        }
+      }
+
+      /// Convert an intersection with the DEM to a point in the target
+      /// georeference.
+      static bool dem_xyz_to_point(GeoReference const& target_georef,
+                                   bool center_on_zero,
+                                   Vector3 const& xyz,
+                                   Vector2 & point){ // output
+        try {
           // Use the datum to convert GCC coordinate to lon/lat/height
           // and to a projected coordinate system
           Vector3 llh = target_georef.datum().cartesian_to_geodetic(xyz);
           point = target_georef.lonlat_to_point( Vector2(llh.x(), llh.y()) );
           recenter_point(center_on_zero, target_georef, point);
-                    
-          return has_intersection;
+          return true;
         }catch(...){
           return false;
         }
@@ -336,7 +473,6 @@ namespace cartography {
       
       /// Intersect this pixel with the DEM and record some information about the intersection
       void operator() ( Vector2 const& pixel ) {
-
         Vector2 point;
         Vector3 xyz;
         bool has_intersection = camera_pixel_to_dem_point(pixel, m_dem, m_dem_georef,
@@ -344,6 +480,20 @@ namespace cartography {
                                                           m_camera, m_center_on_zero,  
                                                           point, // output
                                                           xyz);
+        record(pixel, has_intersection, point, xyz);
+      }
+
+      /// Record the intersection of this pixel with the DEM, found elsewhere
+      void operator() ( Vector2 const& pixel, bool has_intersection, Vector3 const& xyz ) {
+        Vector2 point;
+        if (has_intersection)
+          has_intersection = dem_xyz_to_point(m_target_georef, m_center_on_zero, xyz, point);
+        record(pixel, has_intersection, point, xyz);
+      }
+
+    private:
+      void record( Vector2 const& pixel, bool has_intersection,
+                   Vector2 const& point, Vector3 const& xyz ) {
         // Quit if we did not find an intersection
         if ( !has_intersection ) {
           m_last_valid = false;
@@ -370,6 +520,99 @@ namespace cartography {
       }
     }; // End class CameraDEMBBoxHelper
 
+    /// Sample lines of image pixels adaptively, for the footprint of a
+    /// camera.  line_pixels holds the candidate pixels of all the lines,
+    /// those of line it going from line_starts[it] to line_starts[it+1].
+    /// A few candidates spread evenly along each line are intersected
+    /// first.  Then, round by round, the candidate halfway between two
+    /// consecutive samples is added where they differ in having an
+    /// intersection, or where the footprint bends at either of them by
+    /// more than the ground spacing of the candidates there. Straight
+    /// stretches of the footprint edge thus get few samples. Each round
+    /// is intersected as one batch.  On return, sampled is 1 for the
+    /// evenly spread candidates, 2 for those added, and 0 for the rest.
+    template <class IntersectorT>
+    void sample_lines_adaptively( IntersectorT const& intersector,
+                                  camera::CameraModel const* camera,
+                                  GeoReference const& target_georef,
+                                  bool center_on_zero,
+                                  std::vector<Vector2> const& line_pixels,
+                                  std::vector<size_t>  const& line_starts,
+                                  std::vector<char>    & sampled,          // output
+                                  std::vector<Vector3> & xyz,              // output
+                                  std::vector<bool>    & has_intersection ) { // output
+      const size_t INITIAL_SEGMENTS = 32; // Per line
+      size_t num = line_pixels.size();
+      sampled.assign(num, 0);
+      xyz.assign(num, Vector3());
+      has_intersection.assign(num, false);
+      std::vector<Vector2> points(num);
+      std::vector<char>    has_point(num, 0);
+
+      std::vector<size_t> pending;
+      for (size_t it = 0; it + 1 < line_starts.size(); it++) {
+        size_t begin = line_starts[it], len = line_starts[it+1] - begin;
+        for (size_t k = 0; len > 0 && k <= INITIAL_SEGMENTS; k++) {
+          size_t p = begin + (k*(len - 1))/INITIAL_SEGMENTS;
+          if (!sampled[p]) {
+            sampled[p] = 1;
+            pending.push_back(p);
+          }
+        }
+      }
+
+      std::vector<Vector2> pixels;
+      std::vector<Vector3> batch_xyz;
+      std::vector<bool>    batch_has_intersection;
+      std::vector<size_t>  samples;
+      std::vector<char>    refine;
+      while (!pending.empty()) {
+        pixels.clear();
+        for (size_t it = 0; it < pending.size(); it++)
+          pixels.push_back(line_pixels[pending[it]]);
+        camera_pixels_to_dem_xyz(intersector, camera, pixels, batch_xyz, batch_has_intersection);
+        for (size_t it = 0; it < pending.size(); it++) {
+          size_t p = pending[it];
+          xyz[p]              = batch_xyz[it];
+          has_intersection[p] = batch_has_intersection[it];
+          has_point[p] = has_intersection[p] &&
+            CameraDEMBBoxHelper<typename IntersectorT::image_type>::dem_xyz_to_point
+              (target_georef, center_on_zero, xyz[p], points[p]);
+        }
+        pending.clear();
+
+        // Find the segments between consecutive samples to split
+        for (size_t it = 0; it + 1 < line_starts.size(); it++) {
+          samples.clear();
+          for (size_t p = line_starts[it]; p < line_starts[it+1]; p++)
+            if (sampled[p])
+              samples.push_back(p);
+          if (samples.size() < 2)
+            continue;
+          refine.assign(samples.size() - 1, 0);
+          for (size_t k = 0; k + 1 < samples.size(); k++)
+            if (has_point[samples[k]] != has_point[samples[k+1]])
+              refine[k] = 1;
+          for (size_t k = 1; k + 1 < samples.size(); k++) {
+            size_t a = samples[k-1], c = samples[k], b = samples[k+1];
+            if (!has_point[a] || !has_point[c] || !has_point[b])
+              continue;
+            Vector2 expected = points[a] + (points[b] - points[a])*(double(c - a)/double(b - a));
+            double  spacing  = norm_2(points[b] - points[a])/double(b - a);
+            if (norm_2(points[c] - expected) > spacing)
+              refine[k-1] = refine[k] = 1;
+          }
+          for (size_t k = 0; k + 1 < samples.size(); k++) {
+            size_t a = samples[k], b = samples[k+1];
+            if (refine[k] && b - a > 1) {
+              sampled[(a + b)/2] = 2;
+              pending.push_back((a + b)/2);
+            }
+          }
+        }
+      }
+    }
+
     // Collect valid pixel coordinates on the perimeter of the DEM,
     // and also inside using an X pattern. Some of these points may be duplicated. 
     template <class DEMImageT>
@@ -477,232 +720,283 @@ namespace cartography {
     return camera_bbox( dem_georef, camera_model, cols, rows, scale );
   }
 
-  /// Intersections that take into account DEM topography
-  /// - Returns a bounding box in Georeference coordinate system (projected if available)
-  ///    containing everything visible in the camera image.
-  /// - Computes mean_gsd which is the estimated mean ground resolution of the camera.
-  ///   Note that ground resolution in row and col directions can be different for LRO NAC.
-  ///   This will just return a mean of the two. 
-  ///   The mean_gsd is in GeoReference measurement units (not necessarily meters!)
-  /// - If the quick option is enabled, only rays along the image borders will be used
-  ///   to perform the computation.
-  /// - If coords is provided the intersection coordinates will be stored there.
-  template< class DEMImageT >
-  BBox2 camera_bbox( ImageViewBase<DEMImageT> const& dem,
-                     GeoReference const& dem_georef,
-                     GeoReference const& target_georef, // return box in this projection
-                     boost::shared_ptr<vw::camera::CameraModel> camera_model,
-                     int32 cols, int32 rows, float &mean_gsd,
-                     bool quick=false,
-                     std::vector<Vector3> *coords=0 ) {
+  namespace detail {
 
-    // Testing to see if we should be centering on zero
-    bool center_on_zero = true;
-    Vector3 camera_llr = // Compute lon/lat/radius of camera center
-      target_georef.datum().cartesian_to_geodetic(camera_model->camera_center(Vector2()));
-    if ( camera_llr[0] < -90 || camera_llr[0] > 90 )
-      center_on_zero = false;
+    /// camera_bbox() with the rays intersected by intersector, in
+    /// batches.
+    template< class DEMImageT, class IntersectorT >
+    BBox2 camera_bbox( IntersectorT const& intersector,
+                       ImageViewBase<DEMImageT> const& dem,
+                       GeoReference const& dem_georef,
+                       GeoReference const& target_georef,
+                       boost::shared_ptr<vw::camera::CameraModel> camera_model,
+                       int32 cols, int32 rows, float &mean_gsd,
+                       bool quick, std::vector<Vector3> *coords ) {
+
+      // Testing to see if we should be centering on zero
+      bool center_on_zero = true;
+      Vector3 camera_llr = // Compute lon/lat/radius of camera center
+        target_georef.datum().cartesian_to_geodetic(camera_model->camera_center(Vector2()));
+      if ( camera_llr[0] < -90 || camera_llr[0] > 90 )
+        center_on_zero = false;
 
-    int dem_cols = dem.impl().cols(); 
-    int dem_rows = dem.impl().rows();
-    if (dem_cols <= 0 || dem_rows <= 0)
-      return BBox2(); // nothing to do
+      int dem_cols = dem.impl().cols(); 
+      int dem_rows = dem.impl().rows();
+      if (dem_cols <= 0 || dem_rows <= 0)
+        return BBox2(); // nothing to do
 
-    int NUM_SAMPLES = 1000; // increased from 100, which was cutting corners
-    
-    // Image sampling
-    int32 image_step = (2*cols+2*rows)/NUM_SAMPLES;
-    image_step = std::min(image_step, cols/4); // must have at least several points per col
-    image_step = std::min(image_step, rows/4); // must have at least several points per row
-    image_step = std::max(image_step, 1);      // step amount must be > 0
-
-    // DEM sampling
-    int32 dem_step = (2*dem_cols+2*dem_rows)/NUM_SAMPLES;
-    dem_step = std::min(dem_step, dem_cols/4); // must have at least several points per col
-    dem_step = std::min(dem_step, dem_rows/4); // must have at least several points per row
-    dem_step = std::max(dem_step, 1);          // step amount must be > 0
-
-    // Construct helper class with DEM and camera information.
-    detail::CameraDEMBBoxHelper<DEMImageT> functor( dem, dem_georef, target_georef,
-                                                    camera_model, center_on_zero, coords );
-
-    // Running the edges. Note: The last valid point on a
-    // BresenhamLine is the last point before the endpoint.
-
-    // Left to right across the top side
-    functor.m_last_valid = false;
-    bresenham_apply( math::BresenhamLine(0,0,cols,0), image_step, functor );
+      int NUM_SAMPLES = 1000; // increased from 100, which was cutting corners
     
-    // Top to bottom down the right side
-    functor.m_last_valid = false;
-    bresenham_apply( math::BresenhamLine(cols-1,0,cols-1,rows), image_step, functor );
-
-    // Right to left across the bottom side
-    functor.m_last_valid = false;
-    bresenham_apply( math::BresenhamLine(cols-1,rows-1,0,rows-1), image_step, functor );
-
-    // Bottom to top up the left side
-    functor.m_last_valid = false;
-    bresenham_apply( math::BresenhamLine(0,rows-1,0,0), image_step, functor );
-
-    if (!quick) {
-      // Do the x pattern
-      functor.m_last_valid = false;
-      bresenham_apply( math::BresenhamLine(0,0,cols-1,rows-1), image_step, functor );
+      // Image sampling
+      int32 image_step = (2*cols+2*rows)/NUM_SAMPLES;
+      image_step = std::min(image_step, cols/4); // must have at least several points per col
+      image_step = std::min(image_step, rows/4); // must have at least several points per row
+      image_step = std::max(image_step, 1);      // step amount must be > 0
+
+      // DEM sampling
+      int32 dem_step = (2*dem_cols+2*dem_rows)/NUM_SAMPLES;
+      dem_step = std::min(dem_step, dem_cols/4); // must have at least several points per col
+      dem_step = std::min(dem_step, dem_rows/4); // must have at least several points per row
+      dem_step = std::max(dem_step, 1);          // step amount must be > 0
+
+      // Construct helper class with DEM and camera information.
+      detail::CameraDEMBBoxHelper<DEMImageT> functor( dem, dem_georef, target_georef,
+                                                      camera_model, center_on_zero, coords );
+
+      // Running the edges. Note: The last valid point on a
+      // BresenhamLine is the last point before the endpoint.
+      std::vector<math::BresenhamLine> lines;
+      lines.push_back(math::BresenhamLine(0,0,cols,0));             // Left to right across the top side
+      lines.push_back(math::BresenhamLine(cols-1,0,cols-1,rows));   // Top to bottom down the right side
+      lines.push_back(math::BresenhamLine(cols-1,rows-1,0,rows-1)); // Right to left across the bottom side
+      lines.push_back(math::BresenhamLine(0,rows-1,0,0));           // Bottom to top up the left side
+      if (!quick) {
+        // Do the x pattern
+        lines.push_back(math::BresenhamLine(0,0,cols-1,rows-1));
+        lines.push_back(math::BresenhamLine(0,rows-1,cols-1,0));
+      }
 
+      // Sample all lines, then accumulate the samples in order, line by
+      // line.  The Bresenham steps are the finest the sampling goes.
+      std::vector<Vector2> line_pixels;
+      std::vector<size_t>  line_starts;
+      detail::PixelCollector collector(line_pixels);
+      for (size_t it = 0; it < lines.size(); it++) {
+        line_starts.push_back(line_pixels.size());
+        bresenham_apply( lines[it], image_step, collector );
+      }
+      line_starts.push_back(line_pixels.size());
+
+      std::vector<char>    line_sampled;
+      std::vector<Vector3> line_xyz;
+      std::vector<bool>    line_has_intersection;
+      detail::sample_lines_adaptively(intersector, camera_model.get(), target_georef, center_on_zero,
+                                      line_pixels, line_starts,
+                                      line_sampled, line_xyz, line_has_intersection);
+      for (size_t it = 0; it < lines.size(); it++) {
+        functor.m_last_valid = false;
+        for (size_t p = line_starts[it]; p < line_starts[it+1]; p++)
+          if (line_sampled[p])
+            functor(line_pixels[p], line_has_intersection[p], line_xyz[p]);
+      }
       functor.m_last_valid = false;
-      bresenham_apply( math::BresenhamLine(0,rows-1,cols-1,0), image_step, functor );
-      functor.m_last_valid = false;
-    }
     
-    // Estimate the smallest distance between adjacent points on the bounding box edges
-    // We in fact want the average distance, so we will re-estimate that below.
-    mean_gsd = functor.scale/double(image_step);
-
-    // The bounding box collected so far. 
-    BBox2 cam_bbox = functor.box;
-
-    // Sampled camera pixels collected so far 
-    std::vector<Vector2> cam_pixels = functor.cam_pixels; 
-
-    if (!quick) {
-
-      //vw_out() << "Computed image to DEM bbox: " << cam_bbox << std::endl;
-
-      // Bugfix. Traversing the bbox of the image and drawing an X on
-      // its diagonals is not enough sometimes to accurately determine
-      // where the map-projected image overlaps with the DEM. It fails
-      // if the DEM is small. Therefore, also do the reverse, from the
-      // DEM project points in the camera, traversing the bbox of the
-      // DEM and doing an X pattern, and see which fall inside.
-      std::vector<Vector2> dem_pixels;
-      detail::sample_points_on_dem(dem, dem_step, dem_pixels);
+      // The bounding box collected so far. 
+      BBox2 cam_bbox = functor.box;
+
+      // Sampled camera pixels collected so far. Only the evenly spread
+      // ones are used for the mean_gsd below, as the others crowd where
+      // the footprint bends or leaves the DEM.
+      std::vector<Vector2> cam_pixels;
+      for (size_t p = 0; p < line_pixels.size(); p++)
+        if (line_sampled[p] == 1 && line_has_intersection[p])
+          cam_pixels.push_back(line_pixels[p]);
+
+      if (!quick) {
+
+        //vw_out() << "Computed image to DEM bbox: " << cam_bbox << std::endl;
+
+        // Bugfix. Traversing the bbox of the image and drawing an X on
+        // its diagonals is not enough sometimes to accurately determine
+        // where the map-projected image overlaps with the DEM. It fails
+        // if the DEM is small. Therefore, also do the reverse, from the
+        // DEM project points in the camera, traversing the bbox of the
+        // DEM and doing an X pattern, and see which fall inside.
+        std::vector<Vector2> dem_pixels;
+        detail::sample_points_on_dem(dem, dem_step, dem_pixels);
         
-      // Project the sampled points into the camera
-      for (size_t it = 0; it < dem_pixels.size(); it++) {
-
-        Vector2 lonlat, point, dem_pix, cam_pix;
-        double  height;
-        Vector3 llh, xyz;
-
-        try {
-          // Get the point for this DEM pixel and convert it to GCC coords
-          dem_pix = dem_pixels[it];
-          if (!is_valid(dem.impl()(dem_pix[0], dem_pix[1])))
-            continue; // redundant
-          lonlat = dem_georef.pixel_to_lonlat(dem_pix);
-          height = dem.impl()(dem_pix[0], dem_pix[1]);
-
-          point = target_georef.lonlat_to_point(lonlat);
-          detail::recenter_point(center_on_zero, target_georef, point);
+        // Project the sampled points into the camera
+        for (size_t it = 0; it < dem_pixels.size(); it++) {
+
+          Vector2 lonlat, point, dem_pix, cam_pix;
+          double  height;
+          Vector3 llh, xyz;
+
+          try {
+            // Get the point for this DEM pixel and convert it to GCC coords
+            dem_pix = dem_pixels[it];
+            if (!is_valid(dem.impl()(dem_pix[0], dem_pix[1])))
+              continue; // redundant
+            lonlat = dem_georef.pixel_to_lonlat(dem_pix);
+            height = dem.impl()(dem_pix[0], dem_pix[1]);
+
+            point = target_georef.lonlat_to_point(lonlat);
+            detail::recenter_point(center_on_zero, target_georef, point);
           
-          llh[0] = lonlat[0]; llh[1] = lonlat[1]; llh[2] = height;
+            llh[0] = lonlat[0]; llh[1] = lonlat[1]; llh[2] = height;
 
-          xyz = dem_georef.datum().geodetic_to_cartesian(llh);
-          if (xyz == Vector3() || xyz != xyz) // watch for invalid values
-            continue;
+            xyz = dem_georef.datum().geodetic_to_cartesian(llh);
+            if (xyz == Vector3() || xyz != xyz) // watch for invalid values
+              continue;
 
-          cam_pix = camera_model->point_to_pixel(xyz);
-          if (cam_pix != cam_pix)
-            continue; // watch for nan
+            cam_pix = camera_model->point_to_pixel(xyz);
+            if (cam_pix != cam_pix)
+              continue; // watch for nan
 	
-          if (cam_pix[0] >= 0 && cam_pix[0] <= cols-1 &&
-              cam_pix[1] >= 0 && cam_pix[1] <= rows-1 ) {
-
-            // Finally a good point we can accept
-            cam_bbox.grow(point);
-            //vw_out() << "cam_pix: " << cam_pix << std::endl;
-            //vw_out() << "point: " << point << std::endl;
-            //vw_out() << "llh: " << llh << std::endl;
-
-            // Add to cam_pixels from this different way of sampling
-            cam_pixels.push_back(cam_pix);
+            if (cam_pix[0] >= 0 && cam_pix[0] <= cols-1 &&
+                cam_pix[1] >= 0 && cam_pix[1] <= rows-1 ) {
+
+              // Finally a good point we can accept
+              cam_bbox.grow(point);
+              //vw_out() << "cam_pix: " << cam_pix << std::endl;
+              //vw_out() << "point: " << point << std::endl;
+              //vw_out() << "llh: " << llh << std::endl;
+
+              // Add to cam_pixels from this different way of sampling
+              cam_pixels.push_back(cam_pix);
+            }
           }
-        }
-        catch(...) {
-          // It is possible to hit exceptions in here from coordinate transformation and such which
-          //  do not cause further problems, for example with points on large DEMs that do not fit
-          //  well into the target georef.  We can safely skip these since they probably don't intersect
-          //  the image anyways.
+          catch(...) {
+            // It is possible to hit exceptions in here from coordinate transformation and such which
+            //  do not cause further problems, for example with points on large DEMs that do not fit
+            //  well into the target georef.  We can safely skip these since they probably don't intersect
+            //  the image anyways.
+            continue;
+          }  
+        } // End loop through points on the DEM
+      
+        //vw_out() << "Expanded bbox with DEM to image: " << cam_bbox << std::endl;
+      } // End if (!quick)
+
+      // Now estimate the gsd, in point units, by projecting onto the ground neighboring points.
+      // Each sampled pixel in the image is followed by its neighbors in the image.
+      std::vector<double> gsd;
+      BBox2i image_box(0, 0, cols, rows);
+      std::vector<Vector2> gsd_pixels;
+      std::vector<size_t>  gsd_starts;
+      for (size_t it = 0; it < cam_pixels.size(); it++) {
+
+        Vector2i ctr_pix = cam_pixels[it];
+        if (!image_box.contains(ctr_pix))
           continue;
-        }  
-      } // End loop through points on the DEM
+        gsd_starts.push_back(gsd_pixels.size());
+        gsd_pixels.push_back(ctr_pix);
+
+        // Four neighboring pixels
+        for (int j = 0; j < 4; j++) {
+          Vector2i off_pix = ctr_pix;
+          if (j == 0) off_pix += Vector2i(1, 0);
+          if (j == 1) off_pix += Vector2i(0, 1);
+          if (j == 2) off_pix += Vector2i(-1, 0);
+          if (j == 3) off_pix += Vector2i(0, -1);
+          if (!image_box.contains(off_pix))
+            continue;
+          gsd_pixels.push_back(off_pix);
+        }
+      }
+      gsd_starts.push_back(gsd_pixels.size());
+
+      std::vector<Vector3> gsd_xyz;
+      std::vector<bool>    gsd_has_intersection;
+      detail::camera_pixels_to_dem_xyz(intersector, camera_model.get(), gsd_pixels,
+                                       gsd_xyz, gsd_has_intersection);
+      for (size_t it = 0; it + 1 < gsd_starts.size(); it++) {
+
+        size_t ctr = gsd_starts[it];
+        Vector2 ctr_point;
+        if ( !gsd_has_intersection[ctr] ||
+             !functor.dem_xyz_to_point(target_georef, center_on_zero, gsd_xyz[ctr], ctr_point) )
+          continue; 
       
-      //vw_out() << "Expanded bbox with DEM to image: " << cam_bbox << std::endl;
-    } // End if (!quick)
+        for (size_t off = ctr + 1; off < gsd_starts[it+1]; off++) {
+          Vector2 off_point;
+          if ( !gsd_has_intersection[off] ||
+               !functor.dem_xyz_to_point(target_georef, center_on_zero, gsd_xyz[off], off_point) )
+            continue; 
 
-    // Now estimate the gsd, in point units, by projecting onto the ground neighboring points
-    std::vector<double> gsd;
-    BBox2i image_box(0, 0, cols, rows);
-    for (size_t it = 0; it < cam_pixels.size(); it++) {
+          gsd.push_back(norm_2(ctr_point-off_point));
+        }
+      }
 
-      Vector2i ctr_pix = cam_pixels[it];
-      if (!image_box.contains(ctr_pix))
-        continue;
+      VW_ASSERT(!gsd.empty(), ArgumentErr() << "Could not sample correctly the image.");
 
-      Vector2 ctr_point;
-      Vector3 xyz;
-      bool has_intersection = functor.camera_pixel_to_dem_point(ctr_pix, dem, dem_georef,
-                                                                target_georef,  
-                                                                camera_model, center_on_zero,  
-                                                                ctr_point, // output
-                                                                xyz
-                                                               );
-      if ( !has_intersection )
-        continue; 
-      
-      // Four neighboring pixels
-      for (int j = 0; j < 4; j++) {
-        Vector2i off_pix = ctr_pix;
-        if (j == 0) off_pix += Vector2i(1, 0);
-        if (j == 1) off_pix += Vector2i(0, 1);
-        if (j == 2) off_pix += Vector2i(-1, 0);
-        if (j == 3) off_pix += Vector2i(0, -1);
-        if (!image_box.contains(off_pix))
-          continue;
-        
-        Vector2 off_point;
-        bool has_intersection = functor.camera_pixel_to_dem_point(off_pix, dem, dem_georef,
-                                                                  target_georef,  
-                                                                  camera_model, center_on_zero,  
-                                                                  off_point, // output
-                                                                  xyz
-                                                                 );
-        if ( !has_intersection )
-          continue; 
+      // Note that, at least for LRO NAC, the GSD in row and column
+      // direction can be wildly different (not true for WV
+      // though). Hence we should do an average, not a median. But first
+      // trimming some outliers.
+      std::sort(gsd.begin(), gsd.end()); // in order
+      int gsd_len = gsd.size();
+      int beg = int(0.1*gsd_len);
+      int end = int(0.9*gsd_len);
+      VW_ASSERT(beg < end, ArgumentErr() << "Could not sample correctly the image.");
 
-        gsd.push_back(norm_2(ctr_point-off_point));
+      mean_gsd = 0;
+      int num = 0;
+      for (int it = beg; it < end; it++) {
+        double val = gsd[it];
+        if (val <= 0 || val != val)
+          continue;
+        mean_gsd += val;
+        num   += 1;
       }
-    }
 
-    VW_ASSERT(!gsd.empty(), ArgumentErr() << "Could not sample correctly the image.");
-
-    // Note that, at least for LRO NAC, the GSD in row and column
-    // direction can be wildly different (not true for WV
-    // though). Hence we should do an average, not a median. But first
-    // trimming some outliers.
-    std::sort(gsd.begin(), gsd.end()); // in order
-    int gsd_len = gsd.size();
-    int beg = int(0.1*gsd_len);
-    int end = int(0.9*gsd_len);
-    VW_ASSERT(beg < end, ArgumentErr() << "Could not sample correctly the image.");
-
-    mean_gsd = 0;
-    int num = 0;
-    for (int it = beg; it < end; it++) {
-      double val = gsd[it];
-      if (val <= 0 || val != val)
-        continue;
-      mean_gsd += val;
-      num   += 1;
+      if (num == 0)
+        VW_ASSERT(beg < end, ArgumentErr() << "Could not sample correctly the image.");
+
+      mean_gsd /= num;
+    
+      return cam_bbox;
     }
 
-    if (num == 0)
-      VW_ASSERT(beg < end, ArgumentErr() << "Could not sample correctly the image.");
+  } // end namespace detail
 
-    mean_gsd /= num;
-    
-    return cam_bbox;
+  /// Intersections that take into account DEM topography
+  /// - Returns a bounding box in Georeference coordinate system (projected if available)
+  ///    containing everything visible in the camera image.
+  /// - Computes mean_gsd which is the estimated mean ground resolution of the camera.
+  ///   Note that ground resolution in row and col directions can be different for LRO NAC.
+  ///   This will just return a mean of the two. 
+  ///   The mean_gsd is in GeoReference measurement units (not necessarily meters!)
+  /// - If the quick option is enabled, only rays along the image borders will be used
+  ///   to perform the computation.
+  /// - If coords is provided the intersection coordinates will be stored there.
+  /// - The image edges are sampled more densely where the footprint
+  ///   bends or leaves the DEM, and the samples are intersected with
+  ///   the DEM in parallel.
+  /// - Pass bounds, built once with DEMHeightBounds(dem) and shared
+  ///   between the cameras, to intersect the rays with a RayDEMIntersector,
+  ///   which finds the first crossing of the terrain.  Without it, each
+  ///   ray is intersected on its own starting from the datum, as with
+  ///   camera_pixel_to_dem_xyz(), which needs no pass over the DEM.
+  template< class DEMImageT >
+  BBox2 camera_bbox( ImageViewBase<DEMImageT> const& dem,
+                     GeoReference const& dem_georef,
+                     GeoReference const& target_georef, // return box in this projection
+                     boost::shared_ptr<vw::camera::CameraModel> camera_model,
+                     int32 cols, int32 rows, float &mean_gsd,
+                     bool quick=false,
+                     std::vector<Vector3> *coords=0,
+                     boost::shared_ptr<DEMHeightBounds> bounds = boost::shared_ptr<DEMHeightBounds>() ) {
+    double height_error_tol = 1e-3; // error in DEM height
+    if (bounds)
+      return detail::camera_bbox(RayDEMIntersector<DEMImageT>(dem, dem_georef, false,
+                                                              height_error_tol, bounds),
+                                 dem, dem_georef, target_georef, camera_model,
+                                 cols, rows, mean_gsd, quick, coords);
+    return detail::camera_bbox(detail::DatumStartIntersector<DEMImageT>(dem, dem_georef,
+                                                                        height_error_tol),
+                               dem, dem_georef, target_georef, camera_model,
+                               cols, rows, mean_gsd, quick, coords);
   }
 
   /// Overload of camera_bbox when we don't care about getting the mean_gsd back.
@@ -717,6 +1011,74 @@ namespace cartography {
                                     camera_model, cols, rows, mean_gsd );
   }
 
+  /// Footprints found by camera_bbox, kept in a directory on disk so
+  /// that later runs over the same cameras do not compute them again.
+  /// An entry is keyed by a hash of the contents of the camera file and
+  /// a hash of a description of everything else the footprint depends
+  /// on.  Entries are written to a temporary file which is then renamed,
+  /// so processes sharing the directory never see a partial one.
+  class CameraBBoxCache {
+    std::string m_directory;
+  public:
+    CameraBBoxCache( std::string const& directory ) : m_directory(directory) {}
+
+    std::string const& directory() const { return m_directory; }
+
+    /// The key of a footprint. Throws IOErr if the camera file cannot
+    /// be read.
+    std::string key( std::string const& camera_file, std::string const& context ) const;
+
+    /// A description of a file which changes when the file does: its
+    /// path, size and modification time. Throws IOErr if the file
+    /// cannot be found.
+    std::string file_context( std::string const& file ) const;
+
+    /// Returns false if there is no entry for this key.
+    bool read( std::string const& key, BBox2 & bbox, float & mean_gsd ) const;
+
+    /// Throws IOErr if the entry cannot be written.
+    void write( std::string const& key, BBox2 const& bbox, float mean_gsd ) const;
+  };
+
+  /// camera_bbox through a cache of footprints on disk. The camera was
+  /// loaded from camera_file and the DEM from dem_file.  The cache entry
+  /// also depends on the image size, the options, the georeferences, and
+  /// the size and modification time of dem_file, so a new DEM or
+  /// georeference makes a new entry. Looking up an entry does not read
+  /// the DEM.
+  template< class DEMImageT >
+  BBox2 camera_bbox( CameraBBoxCache const& cache,
+                     std::string const& camera_file,
+                     std::string const& dem_file,
+                     ImageViewBase<DEMImageT> const& dem,
+                     GeoReference const& dem_georef,
+                     GeoReference const& target_georef,
+                     boost::shared_ptr<vw::camera::CameraModel> camera_model,
+                     int32 cols, int32 rows, float &mean_gsd,
+                     bool quick=false,
+                     boost::shared_ptr<DEMHeightBounds> bounds = boost::shared_ptr<DEMHeightBounds>() ) {
+    std::ostringstream context;
+    context.precision(17);
+    context << "camera_bbox " << cols << " " << rows << " " << quick << " "
+            << dem.impl().cols() << " " << dem.impl().rows() << " "
+            << cache.file_context(dem_file) << "\n"
+            << dem_georef << "\n" << target_georef << "\n";
+    std::string key = cache.key(camera_file, context.str());
+
+    BBox2 bbox;
+    if (cache.read(key, bbox, mean_gsd))
+      return bbox;
+    bbox = camera_bbox(dem, dem_georef, target_georef, camera_model, cols, rows, mean_gsd,
+                       quick, 0, bounds);
+    try {
+      cache.write(key, bbox, mean_gsd);
+    } catch (const IOErr& e) {
+      vw_out(WarningMessage) << "Could not cache the footprint of " << camera_file
+                             << ": " << e.what() << "\n";
+    }
+    return bbox;
+  }
+
 } // namespace cartography
 } // namespace vw
 
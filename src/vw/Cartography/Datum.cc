@@ -19,9 +19,12 @@
 #include <boost/algorithm/string.hpp>
 #include <vw/Cartography/Datum.h>
 #include <vw/Math/Functions.h>
+#include <vw/Math/BatchFunctions.h>
 #include <ogr_spatialref.h>
 #include <cpl_string.h>
 
+#include <algorithm>
+
 vw::cartography::Datum::Datum(std::string const& name,
                               std::string const& spheroid_name,
                               std::string const& meridian_name,
@@ -373,6 +376,121 @@ vw::Vector3 vw::cartography::Datum::cartesian_to_geodetic( vw::Vector3 const& xy
   return llh;
 }
 
+namespace {
+  // Points are converted in blocks of this size, through local arrays,
+  // so that the loops have a fixed length and do not overlap the
+  // caller's arrays. The last block is padded with zeros.
+  const size_t CONVERSION_BLOCK = 256;
+}
+
+void vw::cartography::Datum::geodetic_to_cartesian( double const* lon, double const* lat,
+                                                    double const* alt,
+                                                    double* x, double* y, double* z,
+                                                    size_t n ) const {
+  const size_t BLOCK = CONVERSION_BLOCK;
+  const double a  = m_semi_major_axis;
+  const double b  = m_semi_minor_axis;
+  const double e2 = (a * a - b * b) / (a * a);
+
+  double rlon[BLOCK], rlat[BLOCK], h[BLOCK], slon[BLOCK], clon[BLOCK], slat[BLOCK], clat[BLOCK];
+  for (size_t start = 0; start < n; start += BLOCK) {
+    size_t count = std::min(BLOCK, n - start);
+    for (size_t i = 0; i < count; i++) {
+      double l = lat[start + i];
+      l = (l < -90) ? -90 : ((l > 90) ? 90 : l);
+      rlon[i] = (lon[start + i] + m_meridian_offset) * (M_PI/180);
+      rlat[i] = l * (M_PI/180);
+      h[i]    = alt[start + i];
+    }
+    std::fill(rlon + count, rlon + BLOCK, 0.0);
+    std::fill(rlat + count, rlat + BLOCK, 0.0);
+    std::fill(h    + count, h    + BLOCK, 0.0);
+    math::batch_sincos(rlon, slon, clon, BLOCK);
+    math::batch_sincos(rlat, slat, clat, BLOCK);
+    for (size_t i = 0; i < BLOCK; i++) {
+      double radius = a / std::sqrt(1.0 - e2 * slat[i] * slat[i]);
+      rlon[i] = (radius + h[i]) * clat[i] * clon[i];
+      rlat[i] = (radius + h[i]) * clat[i] * slon[i];
+      h[i]    = (radius * (1 - e2) + h[i]) * slat[i];
+    }
+    std::copy(rlon, rlon + count, x + start);
+    std::copy(rlat, rlat + count, y + start);
+    std::copy(h,    h    + count, z + start);
+  }
+}
+
+// The same algorithm as the single point version, for points well
+// outside the evolute, which is every point more than about 100 km
+// from the center of the Earth.  There u = r (1 + w), where w is the
+// root above 2 of w^3 - 3w - 2(1+s), with s = e^4 p q / (4 r^3).  The
+// single point version finds it with two cube roots, which do not
+// vectorize.  Newton's method from 2 + 2s/9 converges to it from above
+// and reaches full precision in four steps for s <= 1.  Other points,
+// and those on the polar axis, where the longitude is a convention, go
+// through the single point version.
+void vw::cartography::Datum::cartesian_to_geodetic( double const* x, double const* y,
+                                                    double const* z,
+                                                    double* lon, double* lat, double* alt,
+                                                    size_t n ) const {
+  const size_t BLOCK = CONVERSION_BLOCK;
+  const double a2 = m_semi_major_axis * m_semi_major_axis;
+  const double b2 = m_semi_minor_axis * m_semi_minor_axis;
+  const double e2 = 1 - b2 / a2;
+  const double e4 = e2 * e2;
+
+  double xb[BLOCK], yb[BLOCK], zb[BLOCK], hb[BLOCK], lat_x[BLOCK], lon_b[BLOCK], lat_b[BLOCK];
+  double general[BLOCK];
+  for (size_t start = 0; start < n; start += BLOCK) {
+    size_t count = std::min(BLOCK, n - start);
+    std::copy(x + start, x + start + count, xb);
+    std::copy(y + start, y + start + count, yb);
+    std::copy(z + start, z + start + count, zb);
+    std::fill(xb + count, xb + BLOCK, m_semi_major_axis);
+    std::fill(yb + count, yb + BLOCK, 0.0);
+    std::fill(zb + count, zb + BLOCK, 0.0);
+
+    for (size_t i = 0; i < BLOCK; i++) {
+      double xy2 = xb[i] * xb[i] + yb[i] * yb[i];
+      double xy_dist = std::sqrt(xy2);
+      double p = xy2 / a2;
+      double q = (1 - e2) * zb[i] * zb[i] / a2;
+      double r = (p + q - e4) / 6.0;
+      double s = e4 * p * q / (4 * r * r * r);
+      double w = 2 + 2 * s / 9;
+      for (int iter = 0; iter < 4; iter++)
+        w -= (w * w * w - 3 * w - 2 - 2 * s) / (3 * w * w - 3);
+      double u   = r * (1 + w);
+      double v   = std::sqrt(u * u + e4 * q);
+      double u_v = u + v;
+      double ww  = e2 * (u_v - q) / (2 * v);
+      double k   = u_v / (ww + std::sqrt(ww * ww + u_v));
+      double D   = k * xy_dist / (k + e2);
+      double dist = std::sqrt(D * D + zb[i] * zb[i]);
+      hb[i]    = (k + e2 - 1) * dist / k;
+      lat_x[i] = dist + D;
+      general[i] = ((r > 0) & (s <= 1) & (xy2 > 0)) ? 1.0 : 0.0;
+    }
+    math::batch_atan2(zb, lat_x, lat_b, BLOCK);
+    math::batch_atan2(yb, xb, lon_b, BLOCK);
+    for (size_t i = 0; i < BLOCK; i++) {
+      lon_b[i] = lon_b[i] * (180.0 / M_PI) - m_meridian_offset;
+      lat_b[i] = lat_b[i] * (360.0 / M_PI);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      if (general[i] == 0) {
+        Vector3 llh = cartesian_to_geodetic(Vector3(xb[i], yb[i], zb[i]));
+        lon_b[i] = llh[0];
+        lat_b[i] = llh[1];
+        hb[i]    = llh[2];
+      }
+    }
+    std::copy(lon_b, lon_b + count, lon + start);
+    std::copy(lat_b, lat_b + count, lat + start);
+    std::copy(hb,    hb    + count, alt + start);
+  }
+}
+
 std::ostream& vw::cartography::operator<<( std::ostream& os, vw::cartography::Datum const& datum ) {
   std::ostringstream oss; // To use custom precision
   oss.precision(17);
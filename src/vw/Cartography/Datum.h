@@ -135,6 +135,20 @@ namespace cartography {
     Matrix3x3 lonlat_to_ned_matrix(Vector2 const& lonlat) const;
 
     Vector3 cartesian_to_geodetic( Vector3 const& xyz ) const;
+
+    /// Convert n points at once, with each coordinate in its own array.
+    /// The outputs may be the same arrays as the inputs.  These use
+    /// vectorized arithmetic (see vw/Math/BatchFunctions.h) and agree
+    /// with the single point versions to within 1e-8 m and 1e-12
+    /// degrees.  The one exception is longitudes within about a degree
+    /// of 180, where the single point cartesian_to_geodetic() loses
+    /// precision (up to about 1e-6 degrees) and these do not.  Points
+    /// near the center of the body (within about 100 km, for the Earth)
+    /// are converted one at a time.
+    void geodetic_to_cartesian( double const* lon, double const* lat, double const* alt,
+                                double* x, double* y, double* z, size_t n ) const;
+    void cartesian_to_geodetic( double const* x, double const* y, double const* z,
+                                double* lon, double* lat, double* alt, size_t n ) const;
   };
 
   std::ostream& operator<<(std::ostream& os, const Datum& datum);
@@ -170,7 +170,8 @@ size_t remove_proj4_duplicates(std::string const& str_in, std::string &str_out)
   void GeoReference::init_proj() {
     // Update the projection context object with the current proj4 string, 
     //  then make sure the lon center is still correct.
-    m_proj_context = ProjContext( overall_proj4_str() );
+    m_proj_context      = ProjContext( overall_proj4_str() );
+    m_projection_kernel = ProjectionKernel( overall_proj4_str() );
     update_lon_center_private();
   }
 
@@ -463,6 +464,7 @@ size_t remove_proj4_duplicates(std::string const& str_in, std::string &str_out)
       string_replace(m_proj_projection_str, "  ", " ");
       m_proj_projection_str = boost::trim_copy(m_proj_projection_str);
       m_proj_context        = ProjContext( overall_proj4_str() );
+      m_projection_kernel   = ProjectionKernel( overall_proj4_str() );
     }
   }
 
@@ -478,6 +480,7 @@ size_t remove_proj4_duplicates(std::string const& str_in, std::string &str_out)
       string_replace(m_proj_projection_str, "  ", " ");
       m_proj_projection_str = boost::trim_copy(m_proj_projection_str);
       m_proj_context        = ProjContext( overall_proj4_str() );
+      m_projection_kernel   = ProjectionKernel( overall_proj4_str() );
     }
   }
 
@@ -822,28 +825,18 @@ double GeoReference::test_pixel_reprojection_error(Vector2 const& pixel) {
   }
 
 
+  namespace {
+    // This value is proj's internal limit
+    const double LAT_BOUND = 1.5707963267948966 - (1e-10) - std::numeric_limits<double>::epsilon();
+
+    // Points are handed to the projection kernel this many at a time.
+    const size_t KERNEL_CHUNK = 64;
+  }
+
   /// For a point in the projected space, compute the position of
   /// that point in unprojected (Geographic) coordinates (lat,lon).
   Vector2 GeoReference::point_to_lonlat(Vector2 loc) const {
-  
-    Vector2 lon_lat;
-    if ( !m_is_projected ) {
-      lon_lat = loc;
-    } else {
-
-      projXY projected;
-      projLP unprojected;
-
-      projected.u = loc[0]; // Store in proj4 object
-      projected.v = loc[1];
-
-      // Call proj4 to do the conversion and check for errors.
-      unprojected = pj_inv(projected, m_proj_context.proj_ptr());
-      CHECK_PROJ_ERROR(m_proj_context, loc);
-
-      // Convert from radians to degrees.
-      lon_lat = Vector2(unprojected.u * RAD_TO_DEG, unprojected.v * RAD_TO_DEG);
-    }
+    Vector2 lon_lat = point_to_lonlat_no_normalize(loc);
 
     // Get the longitude into the correct range for this georeference.    
     lon_lat[0] = math::normalize_longitude(lon_lat[0], m_center_lon_zero);
@@ -855,6 +848,16 @@ double GeoReference::test_pixel_reprojection_error(Vector2 const& pixel) {
     if ( !m_is_projected ) 
       return loc;
 
+    if (m_projection_kernel.is_valid()) {
+      Vector2 lon_lat;
+      m_projection_kernel.inverse(&loc, &lon_lat, 1);
+      if (!boost::math::isnan(lon_lat[0]))
+        return lon_lat;
+    }
+    return proj_point_to_lonlat(loc);
+  }
+
+  Vector2 GeoReference::proj_point_to_lonlat(Vector2 loc) const {
     projXY projected;
     projLP unprojected;
 
@@ -879,9 +882,18 @@ double GeoReference::test_pixel_reprojection_error(Vector2 const& pixel) {
     if ( ! m_is_projected ) 
       return lon_lat;
 
-    // This value is proj's internal limit
-    static const double BOUND = 1.5707963267948966 - (1e-10) - std::numeric_limits<double>::epsilon();
+    if (m_projection_kernel.is_valid()) {
+      // The same latitude clamp as below
+      Vector2 clamped(lon_lat[0], std::max(-LAT_BOUND, std::min(LAT_BOUND, lon_lat[1] * DEG_TO_RAD)) * RAD_TO_DEG);
+      Vector2 point;
+      m_projection_kernel.forward(&clamped, &point, 1);
+      if (!boost::math::isnan(point[0]))
+        return point;
+    }
+    return proj_lonlat_to_point(lon_lat);
+  }
 
+  Vector2 GeoReference::proj_lonlat_to_point(Vector2 lon_lat) const {
     projXY projected;
     projLP unprojected;
 
@@ -893,8 +905,8 @@ double GeoReference::test_pixel_reprojection_error(Vector2 const& pixel) {
     // we get edge pixels that extend slightly beyond that range (probably due
     // to pixel as area vs point) and cause Proj.4 to fail. We use HALFPI
     // rather than other incantations for pi/2 because that's what proj.4 uses.
-    if(unprojected.v > BOUND)        unprojected.v = BOUND;
-    else if(unprojected.v < -BOUND) unprojected.v = -BOUND;
+    if(unprojected.v > LAT_BOUND)        unprojected.v = LAT_BOUND;
+    else if(unprojected.v < -LAT_BOUND) unprojected.v = -LAT_BOUND;
 
     // Call proj4 to do the conversion and check for errors.
     projected = pj_fwd(unprojected, m_proj_context.proj_ptr());
@@ -903,6 +915,62 @@ double GeoReference::test_pixel_reprojection_error(Vector2 const& pixel) {
     return Vector2(projected.u, projected.v);
   }
 
+  // The batch versions give the kernel a chunk of points at a time, so
+  // that the points it can't handle can still be read from the input
+  // and converted one at a time after it is done with them.
+  void GeoReference::point_to_lonlat(Vector2 const* locs, Vector2* lon_lats, size_t n) const {
+    if (!m_is_projected || !m_projection_kernel.is_valid()) {
+      for (size_t k = 0; k < n; ++k)
+        lon_lats[k] = point_to_lonlat(locs[k]);
+      return;
+    }
+    Vector2 buffer[KERNEL_CHUNK];
+    for (size_t k0 = 0; k0 < n; k0 += KERNEL_CHUNK) {
+      size_t m = std::min(KERNEL_CHUNK, n - k0);
+      m_projection_kernel.inverse(locs + k0, buffer, m);
+      for (size_t k = 0; k < m; ++k) {
+        if (boost::math::isnan(buffer[k][0]))
+          buffer[k] = proj_point_to_lonlat(locs[k0+k]);
+        buffer[k][0] = math::normalize_longitude(buffer[k][0], m_center_lon_zero);
+        lon_lats[k0+k] = buffer[k];
+      }
+    }
+  }
+
+  void GeoReference::lonlat_to_point(Vector2 const* lon_lats, Vector2* locs, size_t n) const {
+    if (!m_is_projected || !m_projection_kernel.is_valid()) {
+      for (size_t k = 0; k < n; ++k)
+        locs[k] = lonlat_to_point(lon_lats[k]);
+      return;
+    }
+    Vector2 input[KERNEL_CHUNK], buffer[KERNEL_CHUNK];
+    for (size_t k0 = 0; k0 < n; k0 += KERNEL_CHUNK) {
+      size_t m = std::min(KERNEL_CHUNK, n - k0);
+      for (size_t k = 0; k < m; ++k) {
+        double lat = std::max(-LAT_BOUND, std::min(LAT_BOUND, lon_lats[k0+k][1] * DEG_TO_RAD));
+        input[k] = Vector2(math::normalize_longitude(lon_lats[k0+k][0], m_center_lon_zero), lat * RAD_TO_DEG);
+      }
+      m_projection_kernel.forward(input, buffer, m);
+      for (size_t k = 0; k < m; ++k) {
+        if (boost::math::isnan(buffer[k][0]))
+          buffer[k] = proj_lonlat_to_point(Vector2(input[k][0], lon_lats[k0+k][1]));
+        locs[k0+k] = buffer[k];
+      }
+    }
+  }
+
+  void GeoReference::pixel_to_lonlat(Vector2 const* pixels, Vector2* lon_lats, size_t n) const {
+    for (size_t k = 0; k < n; ++k)
+      lon_lats[k] = pixel_to_point(pixels[k]);
+    point_to_lonlat(lon_lats, lon_lats, n);
+  }
+
+  void GeoReference::lonlat_to_pixel(Vector2 const* lon_lats, Vector2* pixels, size_t n) const {
+    lonlat_to_point(lon_lats, pixels, n);
+    for (size_t k = 0; k < n; ++k)
+      pixels[k] = point_to_pixel(pixels[k]);
+  }
+
   /// Convert lon/lat/alt to projected x/y/alt 
   Vector3 GeoReference::geodetic_to_point(Vector3 llh) const {
 
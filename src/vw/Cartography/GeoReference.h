@@ -22,6 +22,7 @@
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/Algorithms.h>
 #include <vw/Cartography/Datum.h>
+#include <vw/Cartography/ProjectionKernel.h>
 #include <vw/FileIO/DiskImageResource.h>
 #include <vw/Core/Exception.h>
 
@@ -117,6 +118,7 @@ namespace cartography {
     Matrix<double,3,3> m_transform, m_inv_transform, m_shifted_transform, m_inv_shifted_transform;
     std::string m_proj_projection_str; // Duplicate of information in m_proj_context
     ProjContext m_proj_context;
+    ProjectionKernel m_projection_kernel; // Used instead of m_proj_context where it can be
     bool        m_is_projected; // As opposed to lonlat
     
     /// If true, the projected space maps to the -180 to 180 degree longitude range.
@@ -140,6 +142,10 @@ namespace cartography {
     /// Version of the public function that does not perform normalization
     Vector2 point_to_lonlat_no_normalize(Vector2 loc) const;
 
+    /// Calls Proj.4 for point_to_lonlat_no_normalize() and lonlat_to_point().
+    Vector2 proj_point_to_lonlat(Vector2 loc) const;
+    Vector2 proj_lonlat_to_point(Vector2 lon_lat) const;
+
     /// Attempts to extract the value of a key= part of the proj4 string.
     static bool extract_proj4_value(std::string const& proj4_string, std::string const& key,
                                     std::string &s);
@@ -304,6 +310,14 @@ namespace cartography {
     /// the location in the projected coordinate system.
     Vector2 lonlat_to_point(Vector2 lon_lat) const;
 
+    /// Converts n points at once, as point_to_lonlat() does one at a
+    /// time.  The output may be the same array as the input.
+    void point_to_lonlat(Vector2 const* locs, Vector2* lon_lats, size_t n) const;
+
+    /// Converts n lonlats at once, as lonlat_to_point() does one at a
+    /// time.  The output may be the same array as the input.
+    void lonlat_to_point(Vector2 const* lon_lats, Vector2* locs, size_t n) const;
+
     /// Convert lon/lat/alt to projected x/y/alt 
     Vector3 geodetic_to_point(Vector3 llh) const;
 
@@ -335,6 +349,14 @@ namespace cartography {
       return point_to_pixel(lonlat_to_point(lat_lon));
     }
 
+    /// Converts n pixels at once, as pixel_to_lonlat() does one at a
+    /// time.  The output may be the same array as the input.
+    void pixel_to_lonlat(Vector2 const* pixels, Vector2* lon_lats, size_t n) const;
+
+    /// Converts n lonlats at once, as lonlat_to_pixel() does one at a
+    /// time.  The output may be the same array as the input.
+    void lonlat_to_pixel(Vector2 const* lon_lats, Vector2* pixels, size_t n) const;
+
     /// For a given pixel bbox, return the corresponding bbox in projected space
     BBox2  pixel_to_point_bbox(BBox2i const& pixel_bbox) const;
 
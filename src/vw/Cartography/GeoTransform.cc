@@ -16,6 +16,11 @@
 // __END_LICENSE__
 
 
+#include <map>
+
+#include <boost/static_assert.hpp>
+#include <boost/thread/tss.hpp>
+
 #include <vw/Math/BresenhamLine.h>
 #include <vw/Cartography/GeoTransform.h>
 
@@ -33,11 +38,65 @@ namespace cartography {
 
   using vw::math::BresenhamLine;
 
+  namespace {
+
+    // A proj handle can only be used by one thread at a time, so every
+    // thread opens its own for each datum.  The datums are numbered
+    // once, and the handles are kept for the life of the thread; the
+    // lock is only taken the first time a thread needs a handle.
+    Mutex& datum_proj_mutex() {
+      static Mutex mutex;
+      return mutex;
+    }
+
+    std::vector<std::string>& datum_proj_strings() {
+      static std::vector<std::string> strings;
+      return strings;
+    }
+
+    int datum_proj_id(std::string const& proj4_str) {
+      static std::map<std::string, int> ids;
+      Mutex::WriteLock lock(datum_proj_mutex());
+      std::map<std::string, int>::const_iterator it = ids.find(proj4_str);
+      if (it != ids.end())
+        return it->second;
+      int id = int(datum_proj_strings().size());
+      datum_proj_strings().push_back(proj4_str);
+      ids[proj4_str] = id;
+      return id;
+    }
+
+    typedef std::vector<boost::shared_ptr<ProjContext> > ThreadProjContexts;
+
+    ProjContext& thread_datum_proj(int id) {
+      static boost::thread_specific_ptr<ThreadProjContexts> thread_contexts;
+      ThreadProjContexts* contexts = thread_contexts.get();
+      if (!contexts) {
+        contexts = new ThreadProjContexts;
+        thread_contexts.reset(contexts);
+      }
+      if (size_t(id) >= contexts->size())
+        contexts->resize(id+1);
+      boost::shared_ptr<ProjContext>& context = (*contexts)[id];
+      if (!context) {
+        std::string proj4_str;
+        {
+          Mutex::WriteLock lock(datum_proj_mutex());
+          proj4_str = datum_proj_strings()[id];
+        }
+        context.reset(new ProjContext(proj4_str));
+      }
+      return *context;
+    }
+
+  } // end anonymous namespace
+
   // Constructor
   GeoTransform::GeoTransform(GeoReference const& src_georef, GeoReference const& dst_georef,
                              BBox2 const& src_bbox, BBox2 const& dst_bbox) :
     m_src_georef(src_georef), m_dst_georef(dst_georef),
-    m_src_bbox(src_bbox), m_dst_bbox(dst_bbox) {
+    m_src_bbox(src_bbox), m_dst_bbox(dst_bbox),
+    m_src_datum_id(-1), m_dst_datum_id(-1) {
     
     const std::string src_datum = m_src_georef.datum().proj4_str();
     const std::string dst_datum = m_dst_georef.datum().proj4_str();
@@ -65,33 +124,22 @@ namespace cartography {
       // We convert lat/long to lat/long regardless of what the
       // source or destination georef uses.
       ss_src << "+proj=longlat " << src_datum;
-      m_src_datum_proj = ProjContext( ss_src.str() );
+      m_src_datum_id = datum_proj_id( ss_src.str() );
 
       // The destination proj4 context.
       std::stringstream ss_dst;
       ss_dst << "+proj=longlat " << dst_datum;
-      m_dst_datum_proj = ProjContext( ss_dst.str() );
+      m_dst_datum_id = datum_proj_id( ss_dst.str() );
+
+      // Opening this thread's handles reports bad datums right away.
+      thread_datum_proj( m_src_datum_id );
+      thread_datum_proj( m_dst_datum_id );
     }
     // Because GeoTransform is typically very slow, we default to a tolerance
     // of 0.1 pixels to allow ourselves to be approximated.
     set_tolerance( 0.1 );
   }
 
-  GeoTransform::GeoTransform(GeoTransform const& other) {
-    *this = other;
-  }
-
-  GeoTransform& GeoTransform::operator=(GeoTransform const& other) {
-    m_src_georef            = other.m_src_georef;
-    m_dst_georef            = other.m_dst_georef;
-    m_src_datum_proj        = other.m_src_datum_proj;
-    m_dst_datum_proj        = other.m_dst_datum_proj;
-    m_skip_map_projection   = other.m_skip_map_projection;
-    m_skip_datum_conversion = other.m_skip_datum_conversion;
-    return *this;
-  }
-
-
   Vector2 GeoTransform::reverse(Vector2 const& v) const {
     if (m_skip_map_projection)
       return m_src_georef.point_to_pixel(m_dst_georef.pixel_to_point(v));
@@ -102,6 +150,19 @@ namespace cartography {
     return m_src_georef.lonlat_to_pixel(src_lonlat);
   }
 
+  void GeoTransform::reverse_row(double y, double x0, int32 n, Vector2* out) const {
+    if (m_skip_map_projection) {
+      for (int32 k = 0; k < n; ++k)
+        out[k] = m_src_georef.point_to_pixel(m_dst_georef.pixel_to_point(Vector2(x0+k, y)));
+      return;
+    }
+    for (int32 k = 0; k < n; ++k)
+      out[k] = Vector2(x0+k, y);
+    m_dst_georef.pixel_to_lonlat(out, out, n);
+    lonlat_to_lonlat(out, n, false);
+    m_src_georef.lonlat_to_pixel(out, out, n);
+  }
+
 
   Vector2 GeoTransform::pixel_to_pixel(Vector2 const& v) const {
     if (m_skip_map_projection)
@@ -182,43 +243,60 @@ namespace cartography {
 
   // Performs a forward or reverse datum conversion.
   Vector2 GeoTransform::lonlat_to_lonlat(Vector2 const& lonlat, bool forward) const {
-    if (m_skip_datum_conversion)
-      return lonlat;
-
-    double lon = lonlat[0] * DEG_TO_RAD; // proj4 requires radians
-    double lat = lonlat[1] * DEG_TO_RAD;
-    double alt = 0;
-
-    Mutex::WriteLock write_lock(m_mutex);
-
-    if(forward) // src to dst
-      pj_transform(m_src_datum_proj.proj_ptr(), m_dst_datum_proj.proj_ptr(), 1, 0, &lon, &lat, &alt);
-    else // dst to src
-      pj_transform(m_dst_datum_proj.proj_ptr(), m_src_datum_proj.proj_ptr(), 1, 0, &lon, &lat, &alt);
-    CHECK_PROJ_ERROR( m_src_datum_proj );
-    CHECK_PROJ_ERROR( m_dst_datum_proj );
-
-    return Vector2(lon*RAD_TO_DEG, lat*RAD_TO_DEG);
+    Vector2 result = lonlat;
+    lonlat_to_lonlat(&result, 1, forward);
+    return result;
   }
 
   Vector3 GeoTransform::lonlatalt_to_lonlatalt(Vector3 const& lonlatalt, bool forward) const {
-    if (m_skip_datum_conversion)
-      return lonlatalt;
+    Vector3 result = lonlatalt;
+    lonlatalt_to_lonlatalt(&result, 1, forward);
+    return result;
+  }
 
-    double lon = lonlatalt[0] * DEG_TO_RAD; // proj4 requires radians
-    double lat = lonlatalt[1] * DEG_TO_RAD;
-    double alt = lonlatalt[2];
+  namespace {
+    // Converts n points in place with a single call.  The coordinates
+    // of point k are at lon[k*offset] and so on, as pj_transform takes them.
+    void transform_datum(ProjContext& src, ProjContext& dst, size_t n, int offset,
+                         double* lon, double* lat, double* alt) {
+      if (n == 0)
+        return;
+      for (size_t k = 0; k < n; ++k) {
+        lon[k*offset] *= DEG_TO_RAD; // proj4 requires radians
+        lat[k*offset] *= DEG_TO_RAD;
+      }
+      pj_transform(src.proj_ptr(), dst.proj_ptr(), long(n), offset, lon, lat, alt);
+      CHECK_PROJ_ERROR( src );
+      CHECK_PROJ_ERROR( dst );
+      for (size_t k = 0; k < n; ++k) {
+        lon[k*offset] *= RAD_TO_DEG;
+        lat[k*offset] *= RAD_TO_DEG;
+      }
+    }
+  }
 
-    Mutex::WriteLock write_lock(m_mutex);
+  void GeoTransform::lonlat_to_lonlat(Vector2* lonlats, size_t n, bool forward) const {
+    if (m_skip_datum_conversion)
+      return;
+    BOOST_STATIC_ASSERT(sizeof(Vector2) == 2*sizeof(double));
+
+    // The points are converted at zero altitude.
+    std::vector<double> alt(2*n, 0.0);
+    ProjContext& src = thread_datum_proj(forward ? m_src_datum_id : m_dst_datum_id);
+    ProjContext& dst = thread_datum_proj(forward ? m_dst_datum_id : m_src_datum_id);
+    double* data = reinterpret_cast<double*>(lonlats);
+    transform_datum(src, dst, n, 2, data, data+1, n ? &alt[0] : 0);
+  }
 
-    if(forward) // src to dst
-      pj_transform(m_src_datum_proj.proj_ptr(), m_dst_datum_proj.proj_ptr(), 1, 0, &lon, &lat, &alt);
-    else // dst to src
-      pj_transform(m_dst_datum_proj.proj_ptr(), m_src_datum_proj.proj_ptr(), 1, 0, &lon, &lat, &alt);
-    CHECK_PROJ_ERROR( m_src_datum_proj );
-    CHECK_PROJ_ERROR( m_dst_datum_proj );
+  void GeoTransform::lonlatalt_to_lonlatalt(Vector3* lonlatalts, size_t n, bool forward) const {
+    if (m_skip_datum_conversion)
+      return;
+    BOOST_STATIC_ASSERT(sizeof(Vector3) == 3*sizeof(double));
 
-    return Vector3(lon*RAD_TO_DEG, lat*RAD_TO_DEG, alt);
+    ProjContext& src = thread_datum_proj(forward ? m_src_datum_id : m_dst_datum_id);
+    ProjContext& dst = thread_datum_proj(forward ? m_dst_datum_id : m_src_datum_id);
+    double* data = reinterpret_cast<double*>(lonlatalts);
+    transform_datum(src, dst, n, 3, data, data+1, data+2);
   }
 
 
@@ -273,8 +351,6 @@ namespace cartography {
     if (bbox.empty())
       return BBox2();
 
-    BBox2 out_box;
-    
     double minx = bbox.min().x(), maxx = bbox.max().x();
     double miny = bbox.min().y(), maxy = bbox.max().y();
     double rangex = maxx-minx;
@@ -282,37 +358,32 @@ namespace cartography {
 
     // At the poles this won't be enough, more thought is needed.
     int num_steps = 100;
+    std::vector<Vector2> points;
+    points.reserve(6*(num_steps+1));
     for (int i = 0; i <= num_steps; i++) {
       double r = double(i)/num_steps;
+      points.push_back(Vector2(minx, miny + r*rangey));            // left edge
+      points.push_back(Vector2(maxx, miny + r*rangey));            // right edge
+      points.push_back(Vector2(minx + r*rangex, miny));            // bottom edge
+      points.push_back(Vector2(minx + r*rangex, maxy));            // top edge
+      points.push_back(Vector2(minx + r*rangex, miny + r*rangey)); // diag1
+      points.push_back(Vector2(maxx - r*rangex, miny + r*rangey)); // diag2
+    }
 
-      // left edge
-      Vector2 P2 = Vector2(minx, miny + r*rangey);
-      try { out_box.grow(lonlat_to_lonlat(P2)); }
-      catch ( const std::exception & e ) {}
-
-      // right edge
-      P2 = Vector2(maxx, miny + r*rangey);
-      try { out_box.grow(lonlat_to_lonlat(P2)); }
-      catch ( const std::exception & e ) {}
-
-      // bottom edge
-      P2 = Vector2(minx + r*rangex, miny);
-      try { out_box.grow(lonlat_to_lonlat(P2)); }
-      catch ( const std::exception & e ) {}
-
-      // top edge
-      P2 = Vector2(minx + r*rangex, maxy);
-      try { out_box.grow(lonlat_to_lonlat(P2)); }
-      catch ( const std::exception & e ) {}
-      
-      // diag1
-      P2 = Vector2(minx + r*rangex, miny + r*rangey);
-      try { out_box.grow(lonlat_to_lonlat(P2)); }
-      catch ( const std::exception & e ) {}
+    BBox2 out_box;
 
-      // diag2
-      P2 = Vector2(maxx - r*rangex, miny + r*rangey);
-      try { out_box.grow(lonlat_to_lonlat(P2)); }
+    // Convert all the points at once, and only if that fails go
+    // through them one by one to skip the ones that can't be converted.
+    std::vector<Vector2> converted(points);
+    try {
+      lonlat_to_lonlat(&converted[0], converted.size());
+      for (size_t k = 0; k < converted.size(); ++k)
+        out_box.grow(converted[k]);
+      return out_box;
+    } catch ( const std::exception & e ) {}
+
+    for (size_t k = 0; k < points.size(); ++k) {
+      try { out_box.grow(lonlat_to_lonlat(points[k])); }
       catch ( const std::exception & e ) {}
     }
 
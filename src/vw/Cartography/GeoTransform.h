@@ -46,26 +46,23 @@ namespace cartography {
     GeoReference  m_dst_georef;
     BBox2         m_src_bbox,
                   m_dst_bbox;
-    ProjContext   m_src_datum_proj,
-                  m_dst_datum_proj;
+    // The datum conversion uses a proj handle per thread for each of
+    // these ids, so copies of the transform never contend for one.
+    int           m_src_datum_id,
+                  m_dst_datum_id;
     bool          m_skip_map_projection;
     bool          m_skip_datum_conversion;
-    mutable Mutex m_mutex; // Used to control access to the ProjContext objects
 
   public:
   
     /// Default constructor, does not generate a usable object.
-    GeoTransform() {}
-
-    GeoTransform(GeoTransform const& other);
+    GeoTransform() : m_src_datum_id(-1), m_dst_datum_id(-1) {}
 
     /// Normal constructor
     GeoTransform(GeoReference const& src_georef, GeoReference const& dst_georef,
                  BBox2 const& src_bbox = BBox2i(0, 0, 0, 0),
                  BBox2 const& dst_bbox = BBox2i(0, 0, 0, 0));
 
-    GeoTransform& operator=(GeoTransform const& other);
-
     //---------------------------------------------------------------
     // These functions implement the Transform interface and allow
     //  this class to be passed in to functions expecting a Transform object.
@@ -80,6 +77,10 @@ namespace cartography {
     /// pixel from an image in the source georeference frame.
     Vector2 reverse(Vector2 const& v) const;
 
+    /// Computes reverse() at the n pixels (x0+k,y), converting the
+    /// whole row with the batch versions of the conversions.
+    void reverse_row(double y, double x0, int32 n, Vector2* out) const;
+
     /// Convert a pixel bounding box in the source image to
     ///  a pixel bounding box in the destination image.
     /// - This function handles the case where the image crosses the poles.
@@ -112,6 +113,12 @@ namespace cartography {
     /// - The parameter 'forward' specifies whether we convert forward (true) or reverse (false).
     Vector3 lonlatalt_to_lonlatalt(Vector3 const& lonlatalt, bool forward=true) const;
 
+    /// Converts n lonlat coords in place, in a single call to proj.
+    void lonlat_to_lonlat(Vector2* lonlats, size_t n, bool forward=true) const;
+
+    /// Converts n lonlatalt coords in place, in a single call to proj.
+    void lonlatalt_to_lonlatalt(Vector3* lonlatalts, size_t n, bool forward=true) const;
+
     /// Returns true if bounding box conversions wrap around the output
     ///  georeference, creating a very large bounding box.
     bool check_bbox_wraparound() const;
@@ -138,6 +145,12 @@ namespace cartography {
   /// Format a GeoTransform to a text stream (for debugging)
   std::ostream& operator<<(std::ostream& os, const GeoTransform& trans);
 
+  /// Lets TransformView and ApproximateTransform compute exact rows
+  /// with GeoTransform::reverse_row().  Found by argument dependent lookup.
+  inline void exact_reverse_row(GeoTransform const& mapper, double y, double x0, int32 n, Vector2* out) {
+    mapper.reverse_row(y, x0, n, out);
+  }
+
 
   // ---------------------------------------------------------------------------
   // Image View Functions
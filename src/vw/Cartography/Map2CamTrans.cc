@@ -16,14 +16,158 @@
 // __END_LICENSE__
 
 
+#include <list>
+
+#include <boost/thread/tss.hpp>
+
+#include <vw/Core/Thread.h>
 #include <vw/Cartography/PointImageManipulation.h>
 #include <vw/Cartography/GeoTransform.h>
 #include <vw/Cartography/Map2CamTrans.h>
+#include <vw/Image/Interpolation.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Image/MaskViews.h>
 #include <vw/Camera/CameraModel.h>
 
 namespace vw { namespace cartography {
 
+  namespace {
+
+    // What a thread keeps for a transform, found by the id the
+    // transform shares with its copies: its own copies of the
+    // georeferences, as a proj handle can only be used by one thread at
+    // a time, and the camera pixels it last computed. A thread keeps
+    // these for the few transforms it used most recently.
+    struct ThreadState {
+      int32              id;
+      GeoReference       image_georef, dem_georef;
+      BBox2i             box;
+      ImageView<Vector2> pixels;
+
+      // Copy constructed, since assigning a GeoReference would share
+      // its proj handle.
+      ThreadState(int32 id, GeoReference const& image_georef, GeoReference const& dem_georef)
+        : id(id), image_georef(image_georef), dem_georef(dem_georef) {}
+    };
+
+    typedef std::list<ThreadState> ThreadStates;
+    const size_t MAX_THREAD_STATES = 4;
+
+    // The calling thread's state for a transform, made from the
+    // transform's georeferences the first time.
+    ThreadState& thread_state(int32 id, GeoReference const& image_georef,
+                              GeoReference const& dem_georef) {
+      static boost::thread_specific_ptr<ThreadStates> thread_states;
+      if (!thread_states.get())
+        thread_states.reset(new ThreadStates);
+      ThreadStates& states = *thread_states;
+      for (ThreadStates::iterator it = states.begin(); it != states.end(); ++it) {
+        if (it->id != id)
+          continue;
+        if (it != states.begin())
+          states.splice(states.begin(), states, it);
+        return states.front();
+      }
+      if (states.size() >= MAX_THREAD_STATES)
+        states.pop_back();
+      states.emplace_front(id, image_georef, dem_georef);
+      return states.front();
+    }
+
+    int32 next_transform_id() {
+      static Mutex mutex;
+      static int32 id = 0;
+      Mutex::Lock lock(mutex);
+      return id++;
+    }
+
+  } // end anonymous namespace
+
+  // -----------------------------------------------------------------
+  // DemTileCache
+
+  DemTileCache::DemTileCache( std::string const& dem_file, int32 margin,
+                              int32 block_size, Cache& cache ):
+    m_dem(dem_file, &cache), m_margin(margin), m_block_size(block_size),
+    m_table_width(0), m_table_height(0) {
+
+    if (m_block_size <= 0 || m_margin < 0)
+      vw_throw( ArgumentErr() << "DemTileCache: Illegal block size " << m_block_size
+                              << " or margin " << m_margin );
+
+    boost::shared_ptr<vw::DiskImageResource>
+      dem_rsrc( vw::DiskImageResourcePtr(dem_file) );
+    bool  has_nodata = dem_rsrc->has_nodata_read();
+    float nodata     = has_nodata ? dem_rsrc->nodata_read() : 0;
+
+    if (cols() <= 0 || rows() <= 0)
+      return;
+    m_table_width  = (cols()-1) / m_block_size + 1;
+    m_table_height = (rows()-1) / m_block_size + 1;
+    m_blocks.reserve(m_table_width * m_table_height);
+    for (int32 iy = 0; iy < m_table_height; ++iy)
+      for (int32 ix = 0; ix < m_table_width; ++ix)
+        m_blocks.push_back( cache.insert( BlockGenerator( m_dem, block_bbox(Vector2i(ix, iy)),
+                                                          has_nodata, nodata ) ) );
+  }
+
+  BBox2i DemTileCache::block_bbox( Vector2i const& index ) const {
+    BBox2i bbox( index.x()*m_block_size, index.y()*m_block_size, m_block_size, m_block_size );
+    bbox.expand( m_margin );
+    bbox.crop( bounding_box(m_dem) );
+    return bbox;
+  }
+
+  boost::shared_ptr<DemTileCache::block_type>
+  DemTileCache::block( Vector2i const& index, Vector2i& origin ) const {
+    if (index.x() < 0 || index.x() >= m_table_width ||
+        index.y() < 0 || index.y() >= m_table_height)
+      vw_throw( ArgumentErr() << "DemTileCache: Block index " << index << " out of bounds ("
+                              << m_table_width << "," << m_table_height << ")" );
+
+    // A copy of the handle, since other threads may be using the same one.
+    Cache::Handle<BlockGenerator> handle = m_blocks[index.y()*m_table_width + index.x()];
+    boost::shared_ptr<block_type> heights = handle;
+    handle.release();
+    origin = block_bbox(index).min();
+    return heights;
+  }
+
+  void DemTileCache::prefetch( BBox2i const& bbox ) const {
+    BBox2i dem_box = bbox;
+    dem_box.crop( bounding_box(m_dem) );
+    if (dem_box.empty())
+      return;
+    Vector2i first = block_index(dem_box.min());
+    Vector2i last  = block_index(dem_box.max() - Vector2i(1, 1));
+    Vector2i origin;
+    for (int32 iy = first.y(); iy <= last.y(); ++iy)
+      for (int32 ix = first.x(); ix <= last.x(); ++ix)
+        block( Vector2i(ix, iy), origin );
+  }
+
+  boost::shared_ptr<DemTileCache::block_type>
+  DemTileCache::BlockGenerator::generate() const {
+    ImageView<float> heights = crop(m_dem, m_bbox);
+    boost::shared_ptr<block_type> block( new block_type );
+    if (m_has_nodata)
+      *block = create_mask(heights, m_nodata);
+    else // Don't need to handle nodata
+      *block = pixel_cast< PixelMask<float> >(heights);
+    return block;
+  }
+
+  // -----------------------------------------------------------------
+  // Map2CamTrans
+
+  // The DEM block that camera_pixel() last read heights from, so that
+  // runs of nearby pixels only look it up in the cache once.
+  struct Map2CamTrans::DemBlock {
+    Vector2i index, origin;
+    boost::shared_ptr<DemTileCache::block_type> heights;
+    DemBlock() : index(-1, -1) {}
+  };
+
   Map2CamTrans::Map2CamTrans( vw::camera::CameraModel const* cam,
                               GeoReference const& image_georef,
                               GeoReference const& dem_georef,
@@ -32,59 +176,45 @@ namespace vw { namespace cartography {
                               bool call_from_mapproject,
                               bool nearest_neighbor):
     m_cam(cam), m_image_georef(image_georef), m_dem_georef(dem_georef),
-    m_dem(dem_file), m_image_size(image_size),
+    m_image_size(image_size),
     m_call_from_mapproject(call_from_mapproject), 
-    m_nearest_neighbor(nearest_neighbor), m_has_nodata(false),
-    m_nodata(std::numeric_limits<double>::quiet_NaN()){
-
-    boost::shared_ptr<vw::DiskImageResource>
-      dem_rsrc( vw::DiskImageResourcePtr(dem_file) );
-
-    m_has_nodata = dem_rsrc->has_nodata_read();
-    if (m_has_nodata) m_nodata = dem_rsrc->nodata_read();
-
-    m_invalid_pix = vw::camera::CameraModel::invalid_pixel();
+    m_nearest_neighbor(nearest_neighbor),
+    m_pixel_buffer(nearest_neighbor ? NearestPixelInterpolation::pixel_buffer
+                                    : BicubicInterpolation::pixel_buffer),
+    m_invalid_pix(vw::camera::CameraModel::invalid_pixel()),
+    m_id(next_transform_id()) {
+
+    // The margin of the blocks covers the heights that interpolating
+    // anywhere in a block reads.
+    m_dem.reset( new DemTileCache(dem_file, m_pixel_buffer + 1) );
   }
 
   vw::Vector2
-  Map2CamTrans::reverse(const vw::Vector2 &p) const {
-
-    // If we have data for the location already cached
-    if (m_img_cache_box.contains(p)){
-      // Interpolate the output value using the cached data
-      PixelMask<Vector2> v = m_cache_interp_mask(p.x() - m_img_cache_box.min().x(),
-                                                 p.y() - m_img_cache_box.min().y());
-      // We can just return the value if it is valid!
-      if (is_valid(v)) return v.child();
-      else             return m_invalid_pix;
-    }
-
-    int b = BicubicInterpolation::pixel_buffer;
-    if (m_nearest_neighbor)
-      b = NearestPixelInterpolation::pixel_buffer;
-    Vector2 lonlat  = m_image_georef.pixel_to_lonlat(p);
-    Vector2 dem_pix = m_dem_georef.lonlat_to_pixel(lonlat);
-    if ((dem_pix[0] < b - 1) || (dem_pix[0] >= m_dem.cols() - b) ||
-        (dem_pix[1] < b - 1) || (dem_pix[1] >= m_dem.rows() - b)
+  Map2CamTrans::camera_pixel(Vector2 const& lonlat, Vector2 const& dem_pix,
+                             DemBlock& block) const {
+    int b = m_pixel_buffer;
+    if (!((dem_pix[0] >= b - 1) && (dem_pix[0] < m_dem->cols() - b) &&
+          (dem_pix[1] >= b - 1) && (dem_pix[1] < m_dem->rows() - b))
         ){
-      // No DEM data
+      // No DEM data (or a point the georeference could not convert)
       return m_invalid_pix;
     }
 
-    Vector2 sdem_pix = dem_pix - m_dem_cache_box.min(); // since we cropped the DEM
-    if (m_dem_cache_box.empty() ||
-        (sdem_pix[0] < b - 1) || (sdem_pix[0] >= m_cropped_dem.cols() - b) ||
-        (sdem_pix[1] < b - 1) || (sdem_pix[1] >= m_cropped_dem.rows() - b)
-        ){
-      // Cache miss. Will not happen often.
-      BBox2i box;
-      box.min() = floor(p) - Vector2(1, 1);
-      box.max() = ceil(p)  + Vector2(1, 1);
-      cache_dem(box);
-      return reverse(p);
+    Vector2i index = m_dem->block_index(Vector2i(int32(floor(dem_pix[0])),
+                                                 int32(floor(dem_pix[1]))));
+    if (index != block.index) {
+      block.heights = m_dem->block(index, block.origin);
+      block.index   = index;
     }
 
-    PixelMask<float> h = m_interp_dem(sdem_pix[0], sdem_pix[1]);
+    Vector2 sdem_pix = dem_pix - block.origin; // since the block is cropped
+    PixelMask<float> h;
+    if (m_nearest_neighbor)
+      h = interpolate(*block.heights, NearestPixelInterpolation(),
+                      ZeroEdgeExtension())(sdem_pix[0], sdem_pix[1]);
+    else
+      h = interpolate(*block.heights, BicubicInterpolation(),
+                      ZeroEdgeExtension())(sdem_pix[0], sdem_pix[1]);
     if (!is_valid(h))
       return m_invalid_pix;
 
@@ -107,91 +237,122 @@ namespace vw { namespace cartography {
     return pt;
   }
 
+  vw::Vector2
+  Map2CamTrans::reverse(const vw::Vector2 &p) const {
+
+    // If this thread has the camera pixels around p in its grid,
+    // interpolate the output value from them.
+    ThreadState const& state = thread_state(m_id, m_image_georef, m_dem_georef);
+    if (state.pixels.is_valid_image() &&
+        p.x() >= state.box.min().x() + m_pixel_buffer &&
+        p.x() <= state.box.max().x() - 1 - m_pixel_buffer &&
+        p.y() >= state.box.min().y() + m_pixel_buffer &&
+        p.y() <= state.box.max().y() - 1 - m_pixel_buffer) {
+      double x = p.x() - state.box.min().x(), y = p.y() - state.box.min().y();
+      PixelMask<Vector2> v;
+      if (m_nearest_neighbor)
+        v = interpolate(create_mask(state.pixels, m_invalid_pix),
+                        NearestPixelInterpolation(), ZeroEdgeExtension())(x, y);
+      else
+        v = interpolate(create_mask(state.pixels, m_invalid_pix),
+                        BicubicInterpolation(), ZeroEdgeExtension())(x, y);
+      // We can just return the value if it is valid!
+      if (is_valid(v)) return v.child();
+      else             return m_invalid_pix;
+    }
+
+    Vector2 lonlat = state.image_georef.pixel_to_lonlat(p);
+    DemBlock block;
+    return camera_pixel(lonlat, state.dem_georef.lonlat_to_pixel(lonlat), block);
+  }
+
   void Map2CamTrans::cache_dem(vw::BBox2i const& bbox) const{
 
     // TODO: This may fail around poles. Need to do the standard X trick, traverse
     // the edges and diagonals of the box.
+    ThreadState const& state = thread_state(m_id, m_image_georef, m_dem_georef);
+    GeoReference const& image_georef = state.image_georef;
+    GeoReference const& dem_georef   = state.dem_georef;
     BBox2 dbox;
-    dbox.grow( m_dem_georef.lonlat_to_pixel(m_image_georef.pixel_to_lonlat( Vector2(bbox.min().x(),   bbox.min().y()  ) ) )); // Top left
-    dbox.grow( m_dem_georef.lonlat_to_pixel(m_image_georef.pixel_to_lonlat( Vector2(bbox.max().x()-1, bbox.min().y()  ) ) )); // Top right
-    dbox.grow( m_dem_georef.lonlat_to_pixel(m_image_georef.pixel_to_lonlat( Vector2(bbox.min().x(),   bbox.max().y()-1) ) )); // Bottom left
-    dbox.grow( m_dem_georef.lonlat_to_pixel(m_image_georef.pixel_to_lonlat( Vector2(bbox.max().x()-1, bbox.max().y()-1) ) )); // Bottom right
+    dbox.grow( dem_georef.lonlat_to_pixel(image_georef.pixel_to_lonlat( Vector2(bbox.min().x(),   bbox.min().y()  ) ) )); // Top left
+    dbox.grow( dem_georef.lonlat_to_pixel(image_georef.pixel_to_lonlat( Vector2(bbox.max().x()-1, bbox.min().y()  ) ) )); // Top right
+    dbox.grow( dem_georef.lonlat_to_pixel(image_georef.pixel_to_lonlat( Vector2(bbox.min().x(),   bbox.max().y()-1) ) )); // Bottom left
+    dbox.grow( dem_georef.lonlat_to_pixel(image_georef.pixel_to_lonlat( Vector2(bbox.max().x()-1, bbox.max().y()-1) ) )); // Bottom right
 
     // A lot of care is needed here when going from real box to int
     // box, and if in doubt, better expand more rather than less.
     dbox.expand(1);
-    m_dem_cache_box = grow_bbox_to_int(dbox);
-    if (m_nearest_neighbor)
-      m_dem_cache_box.expand(NearestPixelInterpolation::pixel_buffer); // for interp
-    else
-      m_dem_cache_box.expand(BicubicInterpolation::pixel_buffer); // for interp
-    m_dem_cache_box.crop(bounding_box(m_dem));
-
-    // Read the dem in memory for speed in the region of the expanded bounding box.
-    m_cropped_dem = crop(m_dem, m_dem_cache_box);
-
-    if (m_has_nodata){
-      m_masked_dem = create_mask(m_cropped_dem, m_nodata);
-    }else{ // Don't need to handle nodata
-      m_masked_dem = pixel_cast< PixelMask<float> >(m_cropped_dem);
-    }
-    // Set up interpolation interface to the data we loaded into memory
-    if (m_nearest_neighbor)
-      m_interp_dem = interpolate(m_masked_dem, NearestPixelInterpolation(), ZeroEdgeExtension());
-    else
-      m_interp_dem = interpolate(m_masked_dem, BicubicInterpolation(), ZeroEdgeExtension());
+    m_dem->prefetch(grow_bbox_to_int(dbox));
 
   } // End function cache_dem
 
   // This function will be called whenever we start to apply the
-  // transform in a tile. It computes and caches the point cloud at
-  // each pixel in the tile, to be used later when we iterate over pixels.
+  // transform in a tile. It computes the camera pixel at each pixel in
+  // the tile into this thread's grid, to be used later when we iterate
+  // over pixels.
   vw::BBox2i
   Map2CamTrans::reverse_bbox( vw::BBox2i const& bbox ) const {
 
     // Custom reverse_bbox() function which can handle invalid pixels.
-    if (!m_cached_rv_box.empty()) return m_cached_rv_box;
+    if (bbox.empty())
+      return vw::BBox2i(0, 0, 0, 0);
 
-    cache_dem(bbox);
+    BBox2i local_cache_box = bbox;
+    local_cache_box.expand(m_pixel_buffer); // for interpolation
+
+    ThreadState& state = thread_state(m_id, m_image_georef, m_dem_georef);
+    if (!state.pixels.is_valid_image() || !state.box.contains(local_cache_box)) {
+      // Camera pixels the old grid has in common with the new one,
+      // such as along the edge of an adjacent tile, are copied over.
+      BBox2i reuse_box;
+      if (state.pixels.is_valid_image()) {
+        reuse_box = state.box;
+        reuse_box.crop(local_cache_box);
+      }
 
-    // Cache the reverse transform
+      // The georeferences convert the rest a row at a time.
+      ImageView<Vector2> pixels(local_cache_box.width(), local_cache_box.height());
+      std::vector<Vector2> lonlats(local_cache_box.width()), dem_pixels(local_cache_box.width());
+      std::vector<int32> columns(local_cache_box.width());
+      DemBlock block;
+      for( int32 y=local_cache_box.min().y(); y<local_cache_box.max().y(); ++y ){
+        int32 row = y - local_cache_box.min().y(), n = 0;
+        for( int32 x=local_cache_box.min().x(); x<local_cache_box.max().x(); ++x ){
+          int32 col = x - local_cache_box.min().x();
+          if (reuse_box.contains(Vector2i(x, y))) {
+            pixels(col, row) = state.pixels(x - state.box.min().x(), y - state.box.min().y());
+          } else {
+            columns[n] = col;
+            lonlats[n++] = Vector2(x, y);
+          }
+        }
+        if (n == 0)
+          continue;
+        state.image_georef.pixel_to_lonlat(&lonlats[0], &lonlats[0], n);
+        state.dem_georef.lonlat_to_pixel(&lonlats[0], &dem_pixels[0], n);
+        for (int32 k = 0; k < n; ++k)
+          pixels(columns[k], row) = camera_pixel(lonlats[k], dem_pixels[k], block);
+      }
+      state.box    = local_cache_box;
+      state.pixels = pixels;
+    }
 
-    m_img_cache_box = BBox2i();
-    BBox2i local_cache_box = bbox;
-    if (m_nearest_neighbor)
-      local_cache_box.expand(NearestPixelInterpolation::pixel_buffer); // for interpolation
-    else
-      local_cache_box.expand(BicubicInterpolation::pixel_buffer); // for interpolation
-    
-    m_cache.set_size(local_cache_box.width(), local_cache_box.height());
     vw::BBox2 out_box;
-    for( int32 y=local_cache_box.min().y(); y<local_cache_box.max().y(); ++y ){
-      for( int32 x=local_cache_box.min().x(); x<local_cache_box.max().x(); ++x ){
-        Vector2 p = reverse( Vector2(x,y) );
-        m_cache(x - local_cache_box.min().x(), y - local_cache_box.min().y()) = p;
+    for( int32 y=bbox.min().y(); y<bbox.max().y(); ++y ){
+      for( int32 x=bbox.min().x(); x<bbox.max().x(); ++x ){
+        Vector2 p = state.pixels(x - state.box.min().x(), y - state.box.min().y());
         if (p == m_invalid_pix) continue;
-        if (bbox.contains(Vector2i(x, y))) out_box.grow( p );
+        out_box.grow( p );
       }
     }
     out_box = grow_bbox_to_int( out_box );
 
-    // Must happen after all calls to reverse finished.
-    m_img_cache_box = local_cache_box;
-
-    if (m_nearest_neighbor)
-      m_cache_interp_mask = interpolate(create_mask(m_cache, m_invalid_pix),
-                                        NearestPixelInterpolation(), ZeroEdgeExtension());
-    else
-      m_cache_interp_mask = interpolate(create_mask(m_cache, m_invalid_pix),
-                                        BicubicInterpolation(), ZeroEdgeExtension());
-
     // Need the check below as to not try to create images with
     // negative dimensions.
     if (out_box.empty())
       out_box = vw::BBox2i(0, 0, 0, 0);
 
-    m_cached_rv_box = out_box;
-    return m_cached_rv_box;
+    return out_box;
   }
 /*
   std::ostream& operator<<( std::ostream& os, Map2CamTrans const& trans ) {
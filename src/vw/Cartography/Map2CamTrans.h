@@ -19,7 +19,16 @@
 #ifndef __VW_CARTOGRAPHY_MAP_TRANSFORM_H__
 #define __VW_CARTOGRAPHY_MAP_TRANSFORM_H__
 
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <vw/Core/Cache.h>
+#include <vw/Core/System.h>
+#include <vw/Image/ImageView.h>
 #include <vw/Image/ImageViewRef.h>
+#include <vw/Image/PixelMask.h>
 #include <vw/Image/Transform.h>
 #include <vw/FileIO/DiskImageView.h>
 #include <vw/Cartography/GeoReference.h>
@@ -30,11 +39,16 @@
 /// convert to the DEM pixel, then to the DEM lonlat, then to the DEM
 /// xyz, then project into the camera, and find the camera pixel.
 
-/// This class is not thread-safe. For performance reasons it better not
-/// be invoked for individual pixels. The best approach is to first
-/// create a new instance of this class for each tile, do one wholesale
-/// caching computation on the entire tile, then invoke it repeatedly
-/// individual pixels in the tile.
+/// One instance can be shared by all the threads that transform
+/// tiles, and copies are cheap. Each thread converts coordinates with
+/// its own copies of the georeferences, made the first time it uses
+/// the transform, since their proj handles can't be shared. The DEM is
+/// read in blocks that live in the vw::Cache and are shared by all
+/// copies, so overlapping tiles don't read the same part of the DEM
+/// again. reverse_bbox() computes the camera pixels of a whole tile at
+/// once into a lookup grid kept per thread, which reverse() then
+/// interpolates into, so it is best to call reverse_bbox() on a tile
+/// before transforming its pixels.
 
 /// The class can handle DEMs with holes.
 
@@ -44,26 +58,67 @@ namespace vw { namespace camera{
 
 namespace vw { namespace cartography {
 
+  /// The heights of a DEM file, cut into square blocks that are read
+  /// when first needed and kept in a vw::Cache. Every block carries a
+  /// margin of the neighboring heights, so that a height anywhere in
+  /// the block can be interpolated from that block alone. Nodata
+  /// heights are masked. Thread-safe.
+  class DemTileCache : private boost::noncopyable {
+  public:
+    typedef ImageView< PixelMask<float> > block_type;
+
+    DemTileCache( std::string const& dem_file, int32 margin,
+                  int32 block_size = 256, Cache& cache = vw_system_cache() );
+
+    int32 cols() const { return m_dem.cols(); }
+    int32 rows() const { return m_dem.rows(); }
+
+    /// The index of the block that holds a DEM pixel.
+    Vector2i block_index( Vector2i const& pixel ) const {
+      return Vector2i( pixel.x() / m_block_size, pixel.y() / m_block_size );
+    }
+
+    /// Returns a block with its margin, and sets origin to the DEM
+    /// pixel at its top left corner.
+    boost::shared_ptr<block_type> block( Vector2i const& index, Vector2i& origin ) const;
+
+    /// Reads all the blocks under a region of the DEM.
+    void prefetch( BBox2i const& bbox ) const;
+
+  private:
+    class BlockGenerator {
+      DiskImageView<float> m_dem;
+      BBox2i m_bbox;
+      bool   m_has_nodata;
+      float  m_nodata;
+    public:
+      typedef block_type value_type;
+      BlockGenerator( DiskImageView<float> const& dem, BBox2i const& bbox,
+                      bool has_nodata, float nodata )
+        : m_dem(dem), m_bbox(bbox), m_has_nodata(has_nodata), m_nodata(nodata) {}
+      size_t size() const { return m_bbox.width() * m_bbox.height() * sizeof(PixelMask<float>); }
+      boost::shared_ptr<value_type> generate() const;
+    };
+
+    BBox2i block_bbox( Vector2i const& index ) const;
+
+    DiskImageView<float> m_dem;
+    int32 m_margin, m_block_size, m_table_width, m_table_height;
+    std::vector<Cache::Handle<BlockGenerator> > m_blocks;
+  };
+
   class Map2CamTrans : public TransformBase<Map2CamTrans> {
     camera::CameraModel const* m_cam;
     GeoReference         m_image_georef, m_dem_georef;
-    DiskImageView<float> m_dem;
+    boost::shared_ptr<DemTileCache> m_dem;
     Vector2i             m_image_size;
     bool                 m_call_from_mapproject, m_nearest_neighbor;
-    bool                 m_has_nodata;
-    double               m_nodata;
+    int32                m_pixel_buffer;
     Vector2              m_invalid_pix;
+    int32                m_id; // Shared by copies, picks each thread's state
 
-
-    // We will always be modifying these
-    mutable BBox2i                             m_dem_cache_box;
-    mutable ImageView<float>                   m_cropped_dem;
-    mutable ImageViewRef< PixelMask<float> >   m_masked_dem;
-    mutable ImageViewRef< PixelMask<float> >   m_interp_dem;
-    mutable ImageView<Vector2>                 m_cache;
-    mutable ImageViewRef< PixelMask<Vector2> > m_cache_interp_mask;
-    mutable BBox2i                             m_img_cache_box;
-    mutable BBox2i                             m_cached_rv_box;
+    struct DemBlock;
+    Vector2 camera_pixel( Vector2 const& lonlat, Vector2 const& dem_pix, DemBlock& block ) const;
 
   public:
     Map2CamTrans( camera::CameraModel const* cam,
@@ -77,8 +132,12 @@ namespace vw { namespace cartography {
     /// Convert Map Projected Coordinate to camera coordinate
     Vector2 reverse(const Vector2 &p) const;
 
-    // Not thread safe ... you must copy this object
+    /// Reads the DEM under a region of the map-projected image.
     void       cache_dem   ( BBox2i const& bbox ) const;
+
+    /// Computes the camera pixels of the region and its interpolation
+    /// margin into the calling thread's lookup grid, reusing those that
+    /// the grid already holds, and returns their bounding box.
     BBox2i reverse_bbox( BBox2i const& bbox ) const;
   }; // End class Map2CamTrans
 
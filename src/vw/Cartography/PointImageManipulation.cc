@@ -17,10 +17,18 @@
 
 
 #include <vw/Cartography/PointImageManipulation.h>
+#include <vw/Math/BatchFunctions.h>
 #include <boost/math/special_functions/fpclassify.hpp>
 
+#include <algorithm>
+
 using namespace vw;
 
+namespace {
+  // The batch conversions go through arrays of this many coordinates
+  const size_t CONVERSION_BLOCK = 256;
+}
+
 Vector3 cartography::GeodeticToCartesian::operator()( Vector3 const& v ) const {
   if ( boost::math::isnan(v[2]) )
     return Vector3();
@@ -33,6 +41,74 @@ Vector3 cartography::CartesianToGeodetic::operator()( Vector3 const& v ) const {
   return m_datum.cartesian_to_geodetic(v);
 }
 
+void cartography::GeodeticToCartesian::convert( Vector3 const* in, Vector3* out, size_t n ) const {
+  double a[CONVERSION_BLOCK], b[CONVERSION_BLOCK], c[CONVERSION_BLOCK];
+  for (size_t start = 0; start < n; start += CONVERSION_BLOCK) {
+    size_t count = std::min(CONVERSION_BLOCK, n - start);
+    for (size_t i = 0; i < count; i++) {
+      a[i] = in[start + i][0];
+      b[i] = in[start + i][1];
+      c[i] = in[start + i][2];
+    }
+    m_datum.geodetic_to_cartesian(a, b, c, a, b, c, count);
+    for (size_t i = 0; i < count; i++) {
+      if ( boost::math::isnan(in[start + i][2]) )
+        out[start + i] = Vector3();
+      else
+        out[start + i] = Vector3(a[i], b[i], c[i]);
+    }
+  }
+}
+
+void cartography::CartesianToGeodetic::convert( Vector3 const* in, Vector3* out, size_t n ) const {
+  double a[CONVERSION_BLOCK], b[CONVERSION_BLOCK], c[CONVERSION_BLOCK];
+  for (size_t start = 0; start < n; start += CONVERSION_BLOCK) {
+    size_t count = std::min(CONVERSION_BLOCK, n - start);
+    for (size_t i = 0; i < count; i++) {
+      a[i] = in[start + i][0];
+      b[i] = in[start + i][1];
+      c[i] = in[start + i][2];
+    }
+    m_datum.cartesian_to_geodetic(a, b, c, a, b, c, count);
+    for (size_t i = 0; i < count; i++) {
+      if ( in[start + i] == Vector3() )
+        out[start + i] = Vector3(0,0,std::numeric_limits<double>::quiet_NaN());
+      else
+        out[start + i] = Vector3(a[i], b[i], c[i]);
+    }
+  }
+}
+
+void cartography::XYZtoLonLatRadEstimateFunctor::convert( Vector3 const* in, Vector3* out,
+                                                         size_t n ) const {
+  double x[CONVERSION_BLOCK], y[CONVERSION_BLOCK], z[CONVERSION_BLOCK];
+  double xy[CONVERSION_BLOCK], lon[CONVERSION_BLOCK], lat[CONVERSION_BLOCK];
+  const double sign = m_east_positive ? 1 : -1;
+  for (size_t start = 0; start < n; start += CONVERSION_BLOCK) {
+    size_t count = std::min(CONVERSION_BLOCK, n - start);
+    for (size_t i = 0; i < count; i++) {
+      x[i] = in[start + i][0];
+      y[i] = sign * in[start + i][1];
+      z[i] = in[start + i][2];
+      xy[i] = sqrt(x[i] * x[i] + y[i] * y[i]);
+    }
+    math::batch_atan2(y, x, lon, count);
+    math::batch_atan2(z, xy, lat, count);
+    for (size_t i = 0; i < count; i++) {
+      if ( in[start + i] == Vector3() ) {
+        out[start + i] = Vector3();
+        continue;
+      }
+      // atan2 is already in [-pi,pi]
+      double l = lon[i];
+      if ( !m_centered_on_zero && l < 0 )
+        l += 2*M_PI;
+      out[start + i] = Vector3( l * 180.0 / M_PI, lat[i] * 180.0 / M_PI,
+                                sqrt(xy[i] * xy[i] + z[i] * z[i]) );
+    }
+  }
+}
+
 Vector3 cartography::GeodeticToProjection::operator()( Vector3 const& v ) const {
   if ( boost::math::isnan(v[2]) )
     return v;
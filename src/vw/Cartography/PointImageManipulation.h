@@ -28,6 +28,8 @@
 #include <cmath>
 #include <vw/Math/Functors.h>
 #include <vw/Image/ImageViewBase.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
 
 // This include is here to keep compat (the contents of that header used to be
 // here, and was split up to break the Camera<=>Cartography circular dep).
@@ -69,6 +71,10 @@ namespace cartography {
     GeodeticToCartesian(Datum const& d) : m_datum(d) {}
 
     Vector3 operator()( Vector3 const& v ) const;
+
+    /// Converts n points at once. The output may be the same array as
+    /// the input.
+    void convert( Vector3 const* in, Vector3* out, size_t n ) const;
   };
 
   /// Functor to convert GCC x/y/z to lon/lat/alt using a datum.
@@ -78,6 +84,10 @@ namespace cartography {
     CartesianToGeodetic(Datum const& d) : m_datum(d) {}
 
     Vector3 operator()( Vector3 const& v ) const;
+
+    /// Converts n points at once. The output may be the same array as
+    /// the input.
+    void convert( Vector3 const* in, Vector3* out, size_t n ) const;
   };
 
   /// Functor to convert lon/lat/alt to projected pixel col/row/alt using a georef.
@@ -117,8 +127,47 @@ namespace cartography {
   };
 
   // Image View operations ---------------------------------------
-  
-  
+
+  /// A per-pixel view for the point conversions above.  Single pixels
+  /// are converted by the functor as in UnaryPerPixelView, but whole
+  /// tiles are rasterized into a buffer and converted with the
+  /// functor's convert() method, which does them many at a time.
+  template <class ImageT, class FuncT>
+  class PointConversionView : public ImageViewBase<PointConversionView<ImageT,FuncT> > {
+    ImageT m_image;
+    FuncT  m_func;
+  public:
+    typedef typename boost::tr1_result_of<FuncT(typename ImageT::pixel_type)>::type                  result_type;
+    typedef typename boost::remove_cv<typename boost::remove_reference<result_type>::type>::type pixel_type;
+    typedef UnaryPerPixelAccessor<typename ImageT::pixel_accessor, FuncT>                        pixel_accessor;
+
+    PointConversionView( ImageT const& image, FuncT const& func ) : m_image(image), m_func(func) {}
+
+    inline int32 cols  () const { return m_image.cols();   }
+    inline int32 rows  () const { return m_image.rows();   }
+    inline int32 planes() const { return m_image.planes(); }
+
+    inline pixel_accessor origin() const { return pixel_accessor(m_image.origin(),m_func); }
+    inline result_type operator()( int32 i, int32 j, int32 p=0 ) const { return m_func(m_image(i,j,p)); }
+
+    ImageT const& child() const { return m_image; }
+    FuncT  const& func () const { return m_func;  }
+
+    /// \cond INTERNAL
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      ImageView<Vector3> points = crop( m_image, bbox );
+      m_func.convert( points.data(), points.data(),
+                      size_t(points.cols()) * points.rows() * points.planes() );
+      ImageView<pixel_type> result = points;
+      return prerasterize_type( result, BBox2i(-bbox.min().x(), -bbox.min().y(), cols(), rows()) );
+    }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+    /// \endcond
+  };
+
   template <class ImageT>
   BinaryPerPixelView<PerPixelIndexView<VectorIndexFunctor>, ImageT, DemToGeodetic<typename ImageT::pixel_type> >
   inline dem_to_geodetic(ImageViewBase<ImageT> const& dem, GeoReference const& georef) {
@@ -129,30 +178,30 @@ namespace cartography {
   }
 
   template <class ImageT>
-  UnaryPerPixelView<ImageT,GeodeticToCartesian>
+  PointConversionView<ImageT,GeodeticToCartesian>
   inline geodetic_to_cartesian( ImageViewBase<ImageT> const& lla_image, Datum const& d ) {
-    typedef UnaryPerPixelView<ImageT,GeodeticToCartesian> result_type;
+    typedef PointConversionView<ImageT,GeodeticToCartesian> result_type;
     return result_type(lla_image.impl(), GeodeticToCartesian(d) );
   }
 
   template <class ImageT>
-  UnaryPerPixelView<ImageT,CartesianToGeodetic>
+  PointConversionView<ImageT,CartesianToGeodetic>
   inline cartesian_to_geodetic( ImageViewBase<ImageT> const& xyz_image, Datum const& d ) {
-    typedef UnaryPerPixelView<ImageT,CartesianToGeodetic> result_type;
+    typedef PointConversionView<ImageT,CartesianToGeodetic> result_type;
     return result_type(xyz_image.impl(), CartesianToGeodetic(d) );
   }
 
   template <class ImageT>
-  UnaryPerPixelView<ImageT,GeodeticToCartesian>
+  PointConversionView<ImageT,GeodeticToCartesian>
   inline geodetic_to_cartesian( ImageViewBase<ImageT> const& lla_image, GeoReference const& r ) {
-    typedef UnaryPerPixelView<ImageT,GeodeticToCartesian> result_type;
+    typedef PointConversionView<ImageT,GeodeticToCartesian> result_type;
     return result_type(lla_image.impl(), GeodeticToCartesian(r.datum()) );
   }
 
   template <class ImageT>
-  UnaryPerPixelView<ImageT,CartesianToGeodetic>
+  PointConversionView<ImageT,CartesianToGeodetic>
   inline cartesian_to_geodetic( ImageViewBase<ImageT> const& xyz_image, GeoReference const& r ) {
-    typedef UnaryPerPixelView<ImageT,CartesianToGeodetic> result_type;
+    typedef PointConversionView<ImageT,CartesianToGeodetic> result_type;
     return result_type(xyz_image.impl(), CartesianToGeodetic(r.datum()) );
   }
 
@@ -237,6 +286,10 @@ namespace cartography {
 
       return T (lon * 180.0 / M_PI, lat * 180.0 / M_PI, radius);
     }
+
+    /// Converts n points at once, with the latitude from an atan2
+    /// instead of an asin. The output may be the same array as the input.
+    void convert( Vector3 const* in, Vector3* out, size_t n ) const;
   };
 
   /// GDC to GCC conversion with elevation being distance from 0,0,0
@@ -296,11 +349,11 @@ namespace cartography {
   /// the notion of horizontal (x) and vertical (y) coordinates in an
   /// image.
   template <class ImageT>
-  UnaryPerPixelView<ImageT, XYZtoLonLatRadEstimateFunctor>
+  PointConversionView<ImageT, XYZtoLonLatRadEstimateFunctor>
   inline xyz_to_lon_lat_radius_estimate( ImageViewBase<ImageT> const& image,
                                          bool east_positive    = true, 
                                          bool centered_on_zero = true ) {
-    return UnaryPerPixelView<ImageT,XYZtoLonLatRadEstimateFunctor>( image.impl(), XYZtoLonLatRadEstimateFunctor(east_positive, centered_on_zero ) );
+    return PointConversionView<ImageT,XYZtoLonLatRadEstimateFunctor>( image.impl(), XYZtoLonLatRadEstimateFunctor(east_positive, centered_on_zero ) );
   }
 
   template <class ElemT>
@@ -0,0 +1,460 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Core/Exception.h>
+#include <vw/Cartography/ProjectionKernel.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <map>
+
+#include <boost/algorithm/string.hpp>
+
+namespace vw {
+namespace cartography {
+
+namespace {
+
+  const double PI         = 3.14159265358979323846;
+  const double HALF_PI    = PI / 2;
+  const double DEG_TO_RAD = PI / 180;
+  const double RAD_TO_DEG = 180 / PI;
+
+  // Proj.4's ellipsoidal transverse Mercator uses Snyder's series in
+  // the longitude difference, which part from Krueger's by 0.08 mm at
+  // 4 degrees but 0.4 m at 15, so Proj.4 takes over beyond this.  On a
+  // sphere both are exact, and only the conditioning limits the range.
+  const double TMERC_MAX_LAMBDA        = 4  * DEG_TO_RAD;
+  const double TMERC_SPHERE_MAX_LAMBDA = 35 * DEG_TO_RAD;
+
+  const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+  // Same as Proj.4's adjlon(): wraps a longitude in radians to [-pi,pi].
+  inline double adjust_lon(double lam) {
+    if (std::fabs(lam) <= PI + 1e-12)
+      return lam;
+    lam += PI;
+    lam -= 2 * PI * std::floor(lam / (2 * PI));
+    return lam - PI;
+  }
+
+  // The tangent of the conformal latitude, given the tangent of the
+  // geodetic latitude, and the inverse of that.  These follow Karney,
+  // "Transverse Mercator with an accuracy of a few nanometers" (2011).
+  inline double taupf(double tau, double e) {
+    double tau1 = std::sqrt(1 + tau * tau);
+    double sig  = std::sinh(e * std::atanh(e * tau / tau1));
+    return std::sqrt(1 + sig * sig) * tau - sig * tau1;
+  }
+
+  inline double tauf(double taup, double e2, double e) {
+    static const double tmax = 2 / std::sqrt(std::numeric_limits<double>::epsilon());
+    double e2m = 1 - e2;
+    double tau = std::fabs(taup) > 70 ? taup * std::exp(e * std::atanh(e)) : taup / e2m;
+    if (!(std::fabs(tau) < tmax))
+      return tau;
+    // From this start, Newton's method converges to full precision in
+    // two steps for ellipsoids as flat as the Earth's.
+    for (int i = 0; i < 2; ++i) {
+      double taupa = taupf(tau, e);
+      tau += (taup - taupa) * (1 + e2m * tau * tau)
+           / (e2m * std::sqrt(1 + tau * tau) * std::sqrt(1 + taupa * taupa));
+    }
+    return tau;
+  }
+
+  // Adds sign * sum_j c[j] sin(2 (j+1) (xi + i eta)) to (xi, eta), by
+  // Clenshaw summation in complex arithmetic.  Takes the sin and cos of
+  // 2 xi and the sinh and cosh of 2 eta, which the callers have cheaper
+  // ways to get than calling those functions.
+  inline void krueger_series(double const* c, double sign, double sin2, double cos2,
+                             double sh2, double ch2, double& xi, double& eta) {
+    double ar = 2 * cos2 * ch2, ai = -2 * sin2 * sh2;
+    double y1r = 0, y1i = 0, y2r = 0, y2i = 0;
+    for (int j = 5; j >= 0; --j) {
+      double y0r = ar * y1r - ai * y1i - y2r + c[j];
+      double y0i = ar * y1i + ai * y1r - y2i;
+      y2r = y1r; y2i = y1i;
+      y1r = y0r; y1i = y0i;
+    }
+    double sr = sin2 * ch2, si = cos2 * sh2;
+    xi  += sign * (sr * y1r - si * y1i);
+    eta += sign * (sr * y1i + si * y1r);
+  }
+
+  // tan(pi/4 - phi/2) corrected for the ellipsoid, as Proj.4's pj_tsfn().
+  inline double tsfn(double phi, double e) {
+    return std::exp(-std::asinh(taupf(std::tan(phi), e)));
+  }
+
+  typedef std::map<std::string, std::string> ParamMap;
+
+  bool parse_number(ParamMap const& params, std::string const& key, double& value) {
+    ParamMap::const_iterator it = params.find(key);
+    if (it == params.end())
+      return false;
+    char* end;
+    value = strtod(it->second.c_str(), &end);
+    if (it->second.empty() || *end != '\0')
+      vw_throw(ArgumentErr() << "ProjectionKernel: Bad value for +" << key << ".");
+    return true;
+  }
+
+  // Semi-major axis and reciprocal flattening (or zero for a given
+  // semi-minor axis) of the ellipsoids Proj.4 knows by name.
+  struct NamedEllipsoid {
+    const char* name;
+    double a, rf, b;
+  };
+
+  const NamedEllipsoid NAMED_ELLIPSOIDS[] = {
+    { "WGS84",  6378137.0,   298.257223563, 0 },
+    { "GRS80",  6378137.0,   298.257222101, 0 },
+    { "WGS72",  6378135.0,   298.26,        0 },
+    { "intl",   6378388.0,   297.0,         0 },
+    { "clrk66", 6378206.4,   0,             6356583.8 },
+    { "clrk80", 6378249.145, 293.4663,      0 },
+    { "bessel", 6377397.155, 299.1528128,   0 },
+    { "airy",   6377563.396, 0,             6356256.910 },
+    { "sphere", 6370997.0,   0,             6370997.0 }
+  };
+
+  // The ellipsoids of the datums Proj.4 knows by name.
+  const char* const NAMED_DATUMS[][2] = {
+    { "WGS84", "WGS84" },  { "NAD83", "GRS80" },  { "NAD27", "clrk66" },
+    { "GGRS87", "GRS80" }, { "potsdam", "bessel" }, { "carthage", "clrk80" },
+    { "hermannskogel", "bessel" }, { "nzgd49", "intl" }, { "OSGB36", "airy" }
+  };
+
+} // end anonymous namespace
+
+
+  ProjectionKernel::ProjectionKernel(std::string const& proj4_str) : m_type(Invalid) {
+    // Strings the kernel can't parse are Proj.4's business.
+    try {
+      if (!parse(proj4_str))
+        m_type = Invalid;
+    } catch (const ArgumentErr&) {
+      m_type = Invalid;
+    }
+  }
+
+  bool ProjectionKernel::parse(std::string const& proj4_str) {
+    std::vector<std::string> tokens;
+    std::string trimmed = boost::trim_copy(proj4_str);
+    boost::split(tokens, trimmed, boost::is_any_of(" \t"), boost::token_compress_on);
+
+    // Like Proj.4, the first occurrence of a parameter is the one used.
+    ParamMap params;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      if (tokens[i].size() < 2 || tokens[i][0] != '+')
+        return false;
+      size_t eq = tokens[i].find('=');
+      std::string key   = tokens[i].substr(1, eq == std::string::npos ? std::string::npos : eq-1);
+      std::string value = eq == std::string::npos ? "" : tokens[i].substr(eq+1);
+      params.insert(std::make_pair(key, value));
+    }
+
+    // Only accept parameters whose effect on pj_fwd() and pj_inv() is
+    // accounted for below.  Datum shifts don't affect either.
+    static const char* const known[] = {
+      "proj", "zone", "south", "lon_0", "lat_0", "lat_ts", "k", "k_0", "x_0", "y_0",
+      "units", "over", "a", "b", "rf", "f", "es", "e", "R", "ellps", "datum",
+      "towgs84", "nadgrids", "no_defs", "wktext", "type"
+    };
+    for (ParamMap::const_iterator it = params.begin(); it != params.end(); ++it) {
+      bool found = false;
+      for (size_t i = 0; i < sizeof(known)/sizeof(known[0]); ++i)
+        found = found || it->first == known[i];
+      if (!found)
+        return false;
+    }
+    if (params.count("units") && params.find("units")->second != "m")
+      return false;
+
+    // The ellipsoid.  Proj.4 appends the parameters of a named
+    // ellipsoid after the explicit ones, which then take precedence in
+    // ways that are not worth reproducing, so only accept one or the other.
+    std::string ellps;
+    if (params.count("ellps"))
+      ellps = params["ellps"];
+    else if (params.count("datum")) {
+      for (size_t i = 0; i < sizeof(NAMED_DATUMS)/sizeof(NAMED_DATUMS[0]); ++i)
+        if (params["datum"] == NAMED_DATUMS[i][0])
+          ellps = NAMED_DATUMS[i][1];
+      if (ellps.empty())
+        return false;
+    }
+    bool has_shape = params.count("b") || params.count("rf") || params.count("f") ||
+                     params.count("es") || params.count("e");
+    double value;
+    if (parse_number(params, "R", m_a)) {
+      m_e2 = 0;
+    } else if (!ellps.empty()) {
+      if (has_shape || params.count("a"))
+        return false;
+      bool found = false;
+      for (size_t i = 0; i < sizeof(NAMED_ELLIPSOIDS)/sizeof(NAMED_ELLIPSOIDS[0]); ++i) {
+        NamedEllipsoid const& named = NAMED_ELLIPSOIDS[i];
+        if (ellps != named.name)
+          continue;
+        m_a = named.a;
+        if (named.rf != 0) {
+          double f = 1 / named.rf;
+          m_e2 = f * (2 - f);
+        } else {
+          m_e2 = 1 - (named.b * named.b) / (m_a * m_a);
+        }
+        found = true;
+      }
+      if (!found)
+        return false;
+    } else {
+      if (!parse_number(params, "a", m_a))
+        return false;
+      m_e2 = 0;
+      if (parse_number(params, "es", value))
+        m_e2 = value;
+      else if (parse_number(params, "e", value))
+        m_e2 = value * value;
+      else if (parse_number(params, "rf", value))
+        m_e2 = (2 - 1/value) / value;
+      else if (parse_number(params, "f", value))
+        m_e2 = value * (2 - value);
+      else if (parse_number(params, "b", value))
+        m_e2 = 1 - (value * value) / (m_a * m_a);
+    }
+    if (!(m_a > 0) || !(m_e2 >= 0) || !(m_e2 < 1))
+      return false;
+    m_e = std::sqrt(m_e2);
+
+    // Parameters common to all projections
+    m_over = params.count("over") != 0;
+    m_lon0 = m_lat0 = m_x0 = m_y0 = 0;
+    m_k0 = 1;
+    if (parse_number(params, "lon_0", value)) m_lon0 = value * DEG_TO_RAD;
+    if (parse_number(params, "lat_0", value)) m_lat0 = value * DEG_TO_RAD;
+    parse_number(params, "x_0", m_x0);
+    parse_number(params, "y_0", m_y0);
+    if (!parse_number(params, "k_0", m_k0))
+      parse_number(params, "k", m_k0);
+    m_has_lat_ts = parse_number(params, "lat_ts", value);
+    m_lat_ts = m_has_lat_ts ? value * DEG_TO_RAD : 0;
+    if (!(m_k0 > 0))
+      return false;
+
+    std::string const& proj = params["proj"];
+    if (proj == "eqc") {
+      // A spherical projection, on a sphere of the semi-major axis.
+      m_e2 = m_e = 0;
+      if (!(std::cos(m_lat_ts) > 0))
+        return false;
+      m_type = Equirectangular;
+    }
+    else if (proj == "tmerc") {
+      m_type = TransverseMercator;
+      init_transverse_mercator();
+    }
+    else if (proj == "utm") {
+      double zone;
+      if (!parse_number(params, "zone", zone) || zone != std::floor(zone) || zone < 1 || zone > 60 || m_e2 == 0)
+        return false;
+      m_lon0 = ((zone - 1) * 6 - 180 + 3) * DEG_TO_RAD;
+      m_lat0 = 0;
+      m_k0   = 0.9996;
+      m_x0   = 500000;
+      m_y0   = params.count("south") ? 10000000 : 0;
+      m_type = TransverseMercator;
+      init_transverse_mercator();
+    }
+    else if (proj == "merc") {
+      if (m_has_lat_ts) {
+        if (!(std::fabs(m_lat_ts) < HALF_PI))
+          return false;
+        double s = std::sin(m_lat_ts);
+        m_k0 = std::cos(m_lat_ts) / std::sqrt(1 - m_e2 * s * s);
+      }
+      m_scale = m_k0 * m_a;
+      m_type  = Mercator;
+    }
+    else if (proj == "stere") {
+      if (std::fabs(std::fabs(m_lat0) - HALF_PI) > 1e-10)
+        return false; // Only the polar aspects
+      m_pole = m_lat0 > 0 ? 1 : -1;
+      double phits = m_has_lat_ts ? m_pole * m_lat_ts : HALF_PI;
+      if (!(phits > 0))
+        return false;
+      if (std::fabs(phits - HALF_PI) < 1e-10) {
+        m_scale = 2 * m_a * m_k0 / std::sqrt(std::pow(1 + m_e, 1 + m_e) * std::pow(1 - m_e, 1 - m_e));
+      } else {
+        // The true scale latitude overrides the scale factor.
+        double s = std::sin(phits);
+        m_scale = m_a * std::cos(phits) / std::sqrt(1 - m_e2 * s * s) / tsfn(phits, m_e);
+      }
+      m_type = PolarStereographic;
+    }
+    else {
+      return false;
+    }
+    return true;
+  }
+
+  void ProjectionKernel::init_transverse_mercator() {
+    // Krueger's series in the third flattening n, from Karney (2011),
+    // equations 35 and 36.
+    double f  = 1 - std::sqrt(1 - m_e2);
+    double n  = f / (2 - f);
+    double n2 = n*n, n3 = n2*n, n4 = n3*n, n5 = n4*n, n6 = n5*n;
+
+    m_alpha[0] = n/2 - 2*n2/3 + 5*n3/16 + 41*n4/180 - 127*n5/288 + 7891*n6/37800;
+    m_alpha[1] = 13*n2/48 - 3*n3/5 + 557*n4/1440 + 281*n5/630 - 1983433*n6/1935360;
+    m_alpha[2] = 61*n3/240 - 103*n4/140 + 15061*n5/26880 + 167603*n6/181440;
+    m_alpha[3] = 49561*n4/161280 - 179*n5/168 + 6601661*n6/7257600;
+    m_alpha[4] = 34729*n5/80640 - 3418889*n6/1995840;
+    m_alpha[5] = 212378941*n6/319334400;
+
+    m_beta[0] = n/2 - 2*n2/3 + 37*n3/96 - n4/360 - 81*n5/512 + 96199*n6/604800;
+    m_beta[1] = n2/48 + n3/15 - 437*n4/1440 + 46*n5/105 - 1118711*n6/3870720;
+    m_beta[2] = 17*n3/480 - 37*n4/840 - 209*n5/4480 + 5569*n6/90720;
+    m_beta[3] = 4397*n4/161280 - 11*n5/504 - 830251*n6/7257600;
+    m_beta[4] = 4583*n5/161280 - 108847*n6/3991680;
+    m_beta[5] = 20648693*n6/638668800;
+
+    // The rectifying radius, times the scale on the central meridian
+    m_scale = m_k0 * m_a / (1 + n) * (1 + n2/4 + n4/64 + n6/256);
+
+    m_max_lambda = m_e2 == 0 ? TMERC_SPHERE_MAX_LAMBDA : TMERC_MAX_LAMBDA;
+
+    // The northing of the origin is the rectified latitude of lat_0.
+    double xi = std::atan(taupf(std::tan(m_lat0), m_e)), eta = 0;
+    krueger_series(m_alpha, 1, std::sin(2 * xi), std::cos(2 * xi), 0, 1, xi, eta);
+    m_origin = xi;
+  }
+
+  void ProjectionKernel::forward(Vector2 const* lonlats, Vector2* points, size_t n) const {
+    for (size_t k = 0; k < n; ++k) {
+      double lam = lonlats[k][0] * DEG_TO_RAD;
+      double phi = lonlats[k][1] * DEG_TO_RAD;
+
+      // Proj.4 rejects these points.
+      if (!(std::fabs(phi) <= HALF_PI) || !(std::fabs(lam) <= 10)) {
+        points[k] = Vector2(NaN, NaN);
+        continue;
+      }
+      lam -= m_lon0;
+      if (!m_over)
+        lam = adjust_lon(lam);
+
+      double x, y;
+      switch (m_type) {
+      case Equirectangular:
+        x = m_a * std::cos(m_lat_ts) * lam;
+        y = m_a * (phi - m_lat0);
+        break;
+      case TransverseMercator: {
+        if (!(std::fabs(lam) <= m_max_lambda)) {
+          x = y = NaN;
+          break;
+        }
+        // The double angle functions of the conformal coordinates
+        // follow from the same terms as the coordinates themselves.
+        double taup = taupf(std::tan(phi), m_e);
+        double c = std::cos(lam), s = std::sin(lam);
+        double r2 = taup * taup + c * c, taup1 = std::sqrt(1 + taup * taup);
+        double xi  = std::atan2(taup, c);
+        double eta = std::asinh(s / std::sqrt(r2));
+        krueger_series(m_alpha, 1, 2 * taup * c / r2, (c * c - taup * taup) / r2,
+                       2 * s * taup1 / r2, (1 + taup * taup + s * s) / r2, xi, eta);
+        x = m_scale * eta;
+        y = m_scale * (xi - m_origin);
+        break;
+      }
+      case Mercator:
+        if (!(std::fabs(phi) < HALF_PI)) {
+          x = y = NaN;
+          break;
+        }
+        x = m_scale * lam;
+        y = m_scale * std::asinh(taupf(std::tan(phi), m_e));
+        break;
+      case PolarStereographic: {
+        // The opposite pole is at infinity.
+        if (!(m_pole * phi > -HALF_PI + 1e-4)) {
+          x = y = NaN;
+          break;
+        }
+        double rho = m_scale * tsfn(m_pole * phi, m_e);
+        x = rho * std::sin(lam);
+        y = -m_pole * rho * std::cos(lam);
+        break;
+      }
+      default:
+        vw_throw(LogicErr() << "ProjectionKernel: Not a supported projection.");
+      }
+      points[k] = Vector2(x + m_x0, y + m_y0);
+    }
+  }
+
+  void ProjectionKernel::inverse(Vector2 const* points, Vector2* lonlats, size_t n) const {
+    for (size_t k = 0; k < n; ++k) {
+      double x = points[k][0] - m_x0;
+      double y = points[k][1] - m_y0;
+
+      double lam, phi;
+      switch (m_type) {
+      case Equirectangular:
+        lam = x / (m_a * std::cos(m_lat_ts));
+        phi = y / m_a + m_lat0;
+        break;
+      case TransverseMercator: {
+        double xi  = y / m_scale + m_origin;
+        double eta = x / m_scale;
+        double ex = std::exp(2 * eta), inv_ex = 1 / ex;
+        krueger_series(m_beta, -1, std::sin(2 * xi), std::cos(2 * xi),
+                       (ex - inv_ex) / 2, (ex + inv_ex) / 2, xi, eta);
+        double s = std::sinh(eta), c = std::cos(xi);
+        lam = std::atan2(s, c);
+        phi = std::atan(tauf(std::sin(xi) / std::sqrt(s * s + c * c), m_e2, m_e));
+        if (!(std::fabs(lam) <= m_max_lambda))
+          lam = phi = NaN;
+        break;
+      }
+      case Mercator:
+        lam = x / m_scale;
+        phi = std::atan(tauf(std::sinh(y / m_scale), m_e2, m_e));
+        break;
+      case PolarStereographic: {
+        double t = std::sqrt(x * x + y * y) / m_scale;
+        lam = std::atan2(x, -m_pole * y);
+        // The tangent of the conformal latitude is (1-t^2)/(2t).
+        phi = t > 0 ? m_pole * std::atan(tauf((1 - t * t) / (2 * t), m_e2, m_e)) : m_pole * HALF_PI;
+        break;
+      }
+      default:
+        vw_throw(LogicErr() << "ProjectionKernel: Not a supported projection.");
+      }
+
+      lam += m_lon0;
+      if (!m_over)
+        lam = adjust_lon(lam);
+      lonlats[k] = Vector2(lam * RAD_TO_DEG, phi * RAD_TO_DEG);
+    }
+  }
+
+}} // namespace vw::cartography
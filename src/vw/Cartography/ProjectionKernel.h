@@ -0,0 +1,106 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file ProjectionKernel.h
+///
+/// Closed form versions of the map projections that most georeferences
+/// use, so that they can be evaluated without going through Proj.4 one
+/// point at a time.
+///
+#ifndef __VW_CARTOGRAPHY_PROJECTIONKERNEL_H__
+#define __VW_CARTOGRAPHY_PROJECTIONKERNEL_H__
+
+#include <string>
+
+#include <vw/Math/Vector.h>
+
+namespace vw {
+namespace cartography {
+
+  /// Forward and inverse equations for a few common projections.
+  ///
+  /// The kernel is picked from a complete proj4 string (projection and
+  /// datum, as GeoReference::overall_proj4_str() gives it) and gives the
+  /// same results as pj_fwd() and pj_inv() on that string, to well under
+  /// a millimeter.  These are supported:
+  ///
+  /// - +proj=eqc   Equirectangular, on a sphere of radius +a.
+  /// - +proj=tmerc Transverse Mercator, with Krueger's series to sixth
+  ///               order in the third flattening.  On an ellipsoid only
+  ///               within 4 degrees of the central meridian, where it
+  ///               agrees with the older series Proj.4 uses.
+  /// - +proj=utm   As tmerc, for one zone.
+  /// - +proj=merc  Mercator, on the ellipsoid or a sphere.
+  /// - +proj=stere Polar stereographic, with +lat_0 at either pole.
+  ///
+  /// Any other projection, or a string with parameters the kernel does
+  /// not know about, gives an invalid kernel, and the caller has to use
+  /// Proj.4 instead.  The same goes for single points outside the range
+  /// where the equations above are accurate (or defined), for which the
+  /// kernel returns NaN coordinates.
+  class ProjectionKernel {
+  public:
+    enum Type { Invalid, Equirectangular, TransverseMercator, Mercator, PolarStereographic };
+
+    ProjectionKernel() : m_type(Invalid) {}
+
+    /// Picks the kernel for a proj4 string, or an invalid kernel.
+    explicit ProjectionKernel(std::string const& proj4_str);
+
+    Type type() const { return m_type; }
+    bool is_valid() const { return m_type != Invalid; }
+
+    /// Projects n (lon,lat) points in degrees.  The output may be the
+    /// same array as the input.
+    void forward(Vector2 const* lonlats, Vector2* points, size_t n) const;
+
+    /// Unprojects n points to (lon,lat) in degrees.  The output may be
+    /// the same array as the input.
+    void inverse(Vector2 const* points, Vector2* lonlats, size_t n) const;
+
+  private:
+    bool parse(std::string const& proj4_str);
+    void init_transverse_mercator();
+
+    Type   m_type;
+    bool   m_over;           // Longitudes are not wrapped to [-180,180]
+    double m_a, m_e2, m_e;   // Ellipsoid
+    double m_lon0, m_lat0;   // Radians
+    double m_k0, m_x0, m_y0;
+    double m_lat_ts;         // Radians, only meaningful if m_has_lat_ts
+    bool   m_has_lat_ts;
+
+    // Scale from the unit projection to meters, and the unit northing
+    // of the origin.
+    double m_scale, m_origin;
+
+    // Krueger series coefficients, from geodetic to transverse Mercator
+    // coordinates and back.
+    double m_alpha[6], m_beta[6];
+
+    // Longitude differences from the central meridian beyond which the
+    // transverse Mercator is left to Proj.4.
+    double m_max_lambda;
+
+    // +1 for the north polar stereographic, -1 for the south.
+    double m_pole;
+  };
+
+}} // namespace vw::cartography
+
+#endif // __VW_CARTOGRAPHY_PROJECTIONKERNEL_H__
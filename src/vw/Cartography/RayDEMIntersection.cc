@@ -0,0 +1,132 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Cartography/RayDEMIntersection.h>
+
+using namespace vw;
+using namespace vw::cartography;
+
+const int32 DEMHeightBounds::LEAF_SIZE;
+const int32 DEMHeightBounds::LEAF_SIZE_LOG;
+
+bool cartography::detail::ray_ellipsoid_intersection( double a, double b,
+                                                      Vector3 const& ctr, Vector3 const& dir,
+                                                      double& t0, double& t1 ) {
+  // Scale z so that the ellipsoid becomes a sphere of radius a. The
+  // distances along the scaled direction are the same as along dir.
+  double z_scale = a / b;
+  Vector3 c(ctr.x(), ctr.y(), ctr.z()*z_scale);
+  Vector3 d(dir.x(), dir.y(), dir.z()*z_scale);
+  double qa = dot_prod(d, d);
+  double qb = dot_prod(c, d);
+  double qc = dot_prod(c, c) - a*a;
+  double disc = qb*qb - qa*qc;
+  if (qa == 0 || !(disc >= 0))
+    return false;
+  // Avoid cancellation in the root closer to zero
+  double q = -(qb + (qb >= 0 ? 1 : -1)*sqrt(disc));
+  t0 = q / qa;
+  t1 = (q != 0) ? qc / q : t0;
+  if (t0 > t1)
+    std::swap(t0, t1);
+  return true;
+}
+
+void DEMHeightBounds::init( int32 cols, int32 rows ) {
+  VW_ASSERT(cols > 0 && rows > 0, ArgumentErr() << "DEMHeightBounds: The DEM is empty.");
+  m_cols = cols;
+  m_rows = rows;
+
+  // Leaf blocks over the cells between pixels. A DEM one pixel wide
+  // still has one cell, of zero width.
+  Level leaves;
+  leaves.cols = (std::max(cols - 1, 1) + LEAF_SIZE - 1) / LEAF_SIZE;
+  leaves.rows = (std::max(rows - 1, 1) + LEAF_SIZE - 1) / LEAF_SIZE;
+  leaves.ranges.assign(size_t(leaves.cols)*leaves.rows,
+                       range_type(std::numeric_limits<double>::max(),
+                                  -std::numeric_limits<double>::max()));
+  m_levels.clear();
+  m_levels.push_back(leaves);
+  m_slopes.assign(leaves.ranges.size(), 0.0);
+}
+
+void DEMHeightBounds::build_pyramid() {
+  while (m_levels.back().cols > 1 || m_levels.back().rows > 1) {
+    Level const& fine = m_levels.back();
+    Level coarse;
+    coarse.cols = (fine.cols + 1) / 2;
+    coarse.rows = (fine.rows + 1) / 2;
+    coarse.ranges.assign(size_t(coarse.cols)*coarse.rows,
+                         range_type(std::numeric_limits<double>::max(),
+                                    -std::numeric_limits<double>::max()));
+    for (int32 j = 0; j < fine.rows; j++) {
+      for (int32 i = 0; i < fine.cols; i++) {
+        range_type const& f = fine.ranges[j*fine.cols + i];
+        range_type      & c = coarse.ranges[(j/2)*coarse.cols + i/2];
+        c[0] = std::min(c[0], f[0]);
+        c[1] = std::max(c[1], f[1]);
+      }
+    }
+    m_levels.push_back(coarse);
+  }
+}
+
+BBox2i DEMHeightBounds::block_box( int32 level, int32 col, int32 row ) const {
+  int32 size = block_size(level);
+  Vector2i begin((col / size) * size, (row / size) * size);
+  Vector2i end(std::min(begin.x() + size, std::max(m_cols - 1, 0)),
+               std::min(begin.y() + size, std::max(m_rows - 1, 0)));
+  return BBox2i(begin, end);
+}
+
+DEMHeightBounds::range_type DEMHeightBounds::range( BBox2i const& pixel_box ) const {
+  const int32 MAX_BLOCKS = 64;
+  range_type result(std::numeric_limits<double>::max(), -std::numeric_limits<double>::max());
+
+  BBox2i box = pixel_box;
+  box.crop(BBox2i(0, 0, m_cols, m_rows));
+  if (box.empty())
+    return result;
+
+  // The cells starting at each pixel of the box cover all of its
+  // pixels. The last pixel of the DEM is covered by the last cell.
+  int32 num_cell_cols = std::max(m_cols - 1, 1), num_cell_rows = std::max(m_rows - 1, 1);
+  int32 c0 = std::min(box.min().x(),     num_cell_cols - 1);
+  int32 c1 = std::min(box.max().x() - 1, num_cell_cols - 1);
+  int32 r0 = std::min(box.min().y(),     num_cell_rows - 1);
+  int32 r1 = std::min(box.max().y() - 1, num_cell_rows - 1);
+
+  // The finest level at which the box spans only a few blocks
+  int32 level = 0;
+  for (; level < num_levels() - 1; level++) {
+    int32 shift = LEAF_SIZE_LOG + level;
+    if (((c1 >> shift) - (c0 >> shift) + 1) * ((r1 >> shift) - (r0 >> shift) + 1) <= MAX_BLOCKS)
+      break;
+  }
+
+  Level const& l = m_levels[level];
+  int32 shift = LEAF_SIZE_LOG + level;
+  for (int32 j = r0 >> shift; j <= (r1 >> shift); j++) {
+    for (int32 i = c0 >> shift; i <= (c1 >> shift); i++) {
+      range_type const& r = l.ranges[j*l.cols + i];
+      result[0] = std::min(result[0], r[0]);
+      result[1] = std::max(result[1], r[1]);
+    }
+  }
+  return result;
+}
@@ -0,0 +1,1099 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file RayDEMIntersection.h
+///
+/// Intersection of rays with a DEM.
+///
+/// A DEMHeightBounds is a pyramid of the lowest and highest elevation
+/// over blocks of the DEM.  A RayDEMIntersector marches each ray down
+/// through that pyramid, skipping over every block the ray passes
+/// above, and refines the first crossing of the terrain it finds with
+/// a bracketed secant method.  Batches of rays are intersected in
+/// parallel.
+///
+#ifndef __VW_CARTOGRAPHY_RAYDEMINTERSECTION_H__
+#define __VW_CARTOGRAPHY_RAYDEMINTERSECTION_H__
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <exception>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/utility/enable_if.hpp>
+
+#include <vw/Core/Settings.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Math/Vector.h>
+#include <vw/Math/BBox.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Cartography/Datum.h>
+#include <vw/Cartography/GeoReference.h>
+
+namespace vw {
+namespace cartography {
+
+  class DEMHeightBounds;
+
+  namespace detail {
+
+    /// The height of a DEM pixel, if it is valid.  Compound pixels keep
+    /// the height in their first channel.
+    template <class PixelT>
+    typename boost::enable_if< IsScalar<PixelT>, bool >::type
+    inline dem_pixel_height( PixelT const& pix, double& height ) {
+      if (!is_valid(pix))
+        return false;
+      height = pix;
+      return true;
+    }
+
+    template <class PixelT>
+    typename boost::enable_if< IsCompound<PixelT>, bool >::type
+    inline dem_pixel_height( PixelT const& pix, double& height ) {
+      if (!is_valid(pix))
+        return false;
+      height = pix[0];
+      return true;
+    }
+
+    /// Intersect a ray with the ellipsoid of semi-axes a and b.  On
+    /// success t0 <= t1 are the distances along the unit direction
+    /// where the ray enters and leaves it.
+    bool ray_ellipsoid_intersection( double a, double b,
+                                     Vector3 const& ctr, Vector3 const& dir,
+                                     double& t0, double& t1 );
+
+    /// Evaluates how far a ray is above or below a DEM, at points along
+    /// it, and refines where it crosses the DEM.  This needs no
+    /// preprocessing of the DEM, so it suits intersecting a single ray.
+    template <class DEMImageT>
+    class RayDEMSampler {
+    public:
+      /// The ray at one point.
+      struct Sample {
+        double  t;
+        double  diff;      // DEM height minus the height of the point, or NaN
+        double  alt;       // Height of the point above the datum
+        double  descent;   // Rate at which the height drops along the ray
+        Vector2 pix;       // Location in the DEM
+        bool    projected; // If pix could be computed
+      };
+
+      RayDEMSampler( DEMImageT const& dem, GeoReference const& georef, bool treat_nodata_as_zero )
+        : m_dem(dem), m_georef(georef), m_treat_nodata_as_zero(treat_nodata_as_zero) {}
+
+      DEMImageT    const& dem   () const { return m_dem;    }
+      GeoReference const& georef() const { return m_georef; }
+      bool treat_nodata_as_zero() const { return m_treat_nodata_as_zero; }
+
+      /// Bilinearly interpolated height of the DEM.  Returns false if
+      /// there is none there.
+      bool dem_height( Vector2 const& pix, double& height ) const;
+
+      /// The point at distance t along the ray with unit direction dir.
+      void evaluate( Vector3 const& ctr, Vector3 const& dir, double t, Sample& s ) const;
+
+      /// Difference between the DEM height and the height of the point at
+      /// distance t along the ray, or NaN where there is no DEM.
+      double height_diff( Vector3 const& ctr, Vector3 const& dir, double t ) const {
+        Sample s;
+        evaluate(ctr, dir, t, s);
+        return s.diff;
+      }
+
+      /// Refine the crossing of the DEM between two points along a ray,
+      /// t0 where the ray is above the DEM and t1 where it is below it.
+      /// These need not be in order.
+      /// Iterates until the height error is under stop_tol, or the
+      /// bracket is narrower than abs_tol + rel_tol*t.  Returns false if
+      /// the final height error is over height_tol.
+      bool refine( Vector3 const& ctr, Vector3 const& dir,
+                   double t0, double diff0, double t1, double diff1,
+                   double height_tol, double stop_tol, double abs_tol, double rel_tol,
+                   int max_iter, double& t ) const;
+
+      /// The highest the DEM gets over a box of pixels, or -infinity if
+      /// it has no terrain there.  Over each cell in the box this is the
+      /// highest corner of the part of the cell in the box, as a bilinear
+      /// patch is highest at a corner of any rectangle in it, so the
+      /// bound gets tight as the box shrinks.  Returns false if the box
+      /// spans more than max_cells cells.
+      bool dem_max( BBox2 const& box, int32 max_cells, double& height ) const;
+
+      /// Find the first crossing of the DEM between samples s0 and s1,
+      /// where s0 is above the DEM or off it.  The interval is split
+      /// until each piece is either clear of the DEM, as dem_max() shows,
+      /// or lies within one cell going from above the DEM to below it.
+      /// Along the ray the height of a cell is quadratic, so such a piece
+      /// crosses the DEM just once, and that crossing is refined as
+      /// refine() does.  Pieces too wide for dem_max() are bounded with
+      /// bounds, if given.  Returns false if refining fails, and crossed
+      /// says whether there was a crossing, at t.
+      bool first_crossing( Vector3 const& ctr, Vector3 const& dir,
+                           Sample const& s0, Sample const& s1,
+                           DEMHeightBounds const* bounds,
+                           double height_tol, double stop_tol, double abs_tol, double rel_tol,
+                           int max_iter, bool& crossed, double& t ) const;
+
+    private:
+      static BBox2 track_box( Sample const& s0, Sample const& s1 );
+
+      /// Whether the ray is certainly above the DEM between two samples
+      bool clear_between( Sample const& s0, Sample const& s1,
+                          DEMHeightBounds const* bounds ) const;
+
+      DEMImageT    m_dem;
+      GeoReference m_georef;
+      bool         m_treat_nodata_as_zero;
+    };
+
+  } // namespace detail
+
+  /// The range of elevations over blocks of a DEM, at every level of a
+  /// quadtree from blocks of LEAF_SIZE x LEAF_SIZE cells up to the whole
+  /// DEM.  A cell is the square between four adjacent pixels, over
+  /// which the DEM is bilinearly interpolated, so the range of a block
+  /// bounds the interpolated terrain everywhere in it.  The leaf blocks
+  /// also bound the slope of the terrain.
+  ///
+  /// Invalid pixels do not count, unless treat_nodata_as_zero is set, in
+  /// which case they count as height zero.  A block with no valid pixel
+  /// has an empty range, with min() > max().
+  ///
+  /// This is built once per DEM, with a single pass over it, and is
+  /// read-only afterwards, so it can be shared between threads and
+  /// between intersectors.
+  class DEMHeightBounds {
+  public:
+    static const int32 LEAF_SIZE = 8;
+
+    /// Height range, as (min, max).
+    typedef Vector2 range_type;
+
+    template <class DEMImageT>
+    DEMHeightBounds( ImageViewBase<DEMImageT> const& dem, bool treat_nodata_as_zero = false );
+
+    int32 cols() const { return m_cols; }
+    int32 rows() const { return m_rows; }
+    bool  treat_nodata_as_zero() const { return m_treat_nodata_as_zero; }
+
+    /// Levels go from 0, the leaf blocks, to num_levels()-1, a single
+    /// block covering the whole DEM.
+    int32 num_levels() const { return int32(m_levels.size()); }
+
+    /// Number of cells on the side of a block at this level.
+    int32 block_size( int32 level ) const { return LEAF_SIZE << level; }
+
+    /// Range of the whole DEM.
+    range_type range() const { return m_levels.back().ranges[0]; }
+
+    /// Range of the block at this level which contains cell (col, row).
+    range_type range( int32 level, int32 col, int32 row ) const {
+      Level const& l = m_levels[level];
+      return l.ranges[ (row >> (LEAF_SIZE_LOG + level)) * l.cols + (col >> (LEAF_SIZE_LOG + level)) ];
+    }
+
+    /// Pixel extent of the block at this level which contains cell
+    /// (col, row).  The box includes its far edge, which is shared with
+    /// the next block.
+    BBox2i block_box( int32 level, int32 col, int32 row ) const;
+
+    /// The most the terrain can rise or fall, in meters, per pixel moved
+    /// in any direction, within the leaf block containing cell (col, row).
+    /// It is infinite for a block with holes, as the terrain is not
+    /// connected across them.
+    double slope( int32 col, int32 row ) const {
+      return m_slopes[ (row >> LEAF_SIZE_LOG) * m_levels[0].cols + (col >> LEAF_SIZE_LOG) ];
+    }
+
+    /// A range that contains the heights of all pixels in the box.  It
+    /// comes from a few blocks covering the box, so it is conservative.
+    range_type range( BBox2i const& pixel_box ) const;
+
+    static bool is_empty( range_type const& r ) { return r[0] > r[1]; }
+
+  private:
+    static const int32 LEAF_SIZE_LOG = 3;
+
+    struct Level {
+      int32 cols, rows;
+      std::vector<range_type> ranges;
+    };
+
+    void init( int32 cols, int32 rows );
+    void build_pyramid();
+
+    int32 m_cols, m_rows;
+    bool  m_treat_nodata_as_zero;
+    std::vector<Level>  m_levels;
+    std::vector<double> m_slopes; // Of the leaf blocks
+  };
+
+  /// Intersects rays with a DEM, returning the first point where each
+  /// ray hits the terrain.
+  ///
+  /// The DEM is interpolated bilinearly, as in camera_pixel_to_dem_xyz().
+  /// Cells next to invalid pixels have no terrain, unless
+  /// treat_nodata_as_zero is set, in which case those pixels, and
+  /// everything off the DEM, are at height zero.
+  ///
+  /// A ray is marched from where it enters the shell of the highest
+  /// DEM elevation.  At each step the coarsest block of the DEM pyramid
+  /// the ray is above says how far it can go without reaching the
+  /// terrain, so only the blocks the ray actually grazes are stepped
+  /// through half a pixel at a time, or further where their slope
+  /// allows.  Each of those steps is split until the heights of the
+  /// cells under it show the ray is clear of them, or a piece within
+  /// one cell goes below the DEM, so the crossing found is the first
+  /// one even where the ray only clips the terrain.  The crossing is
+  /// then refined well within height_tol meters, and rays where that
+  /// fails (at the edge of a hole, say) have no intersection.  Given a guess, such as the solution for a
+  /// neighboring pixel, the march starts from a point near the guess
+  /// which the height bounds show the ray is clear of the DEM until.
+  ///
+  /// The intersector holds a copy of the georeference, which is not safe
+  /// to use from several threads, so give each thread its own copy of
+  /// the intersector.  Copies share the DEMHeightBounds.  The batch
+  /// version of intersect() does this itself.
+  template <class DEMImageT>
+  class RayDEMIntersector {
+  public:
+    typedef DEMImageT image_type;
+
+    RayDEMIntersector( ImageViewBase<DEMImageT> const& dem, GeoReference const& georef,
+                       bool treat_nodata_as_zero = false, double height_tol = 1e-3,
+                       boost::shared_ptr<DEMHeightBounds> bounds = boost::shared_ptr<DEMHeightBounds>() )
+      : m_sampler(dem.impl(), georef, treat_nodata_as_zero), m_bounds(bounds),
+        m_height_tol(height_tol) {
+      if (!m_bounds)
+        m_bounds.reset(new DEMHeightBounds(dem, treat_nodata_as_zero));
+      VW_ASSERT(m_bounds->cols() == dem.impl().cols() && m_bounds->rows() == dem.impl().rows() &&
+                m_bounds->treat_nodata_as_zero() == treat_nodata_as_zero,
+                ArgumentErr() << "RayDEMIntersector: The height bounds are not for this DEM.");
+    }
+
+    boost::shared_ptr<DEMHeightBounds> bounds() const { return m_bounds; }
+    GeoReference const& georef() const { return m_sampler.georef(); }
+
+    /// Intersect one ray.  If xyz_guess is not zero, the search starts
+    /// from it.  Returns Vector3() if there is no intersection.
+    Vector3 intersect( Vector3 const& camera_ctr, Vector3 const& camera_vec,
+                       bool& has_intersection, Vector3 const& xyz_guess = Vector3() ) const;
+
+    /// Intersect a batch of rays in parallel.  Rays are processed in
+    /// order in chunks, each ray starting from the solution of the one
+    /// before it, so neighboring rays should be neighbors in the batch.
+    /// Use 0 threads for the default number.
+    void intersect( std::vector<Vector3> const& camera_ctrs,
+                    std::vector<Vector3> const& camera_vecs,
+                    std::vector<Vector3>      & xyz,
+                    std::vector<bool>         & has_intersection,
+                    int num_threads = 0 ) const;
+
+  private:
+    typedef typename detail::RayDEMSampler<DEMImageT>::Sample Sample;
+
+    /// Bounds on how fast the ray moves across the DEM along one axis,
+    /// in pixels per meter, ahead in the direction it was last seen
+    /// moving and back against it.
+    struct AxisRate {
+      double ahead, back;
+      bool   forward;
+      AxisRate( double velocity, double speed );
+    };
+
+    /// Distance along the ray to go d pixels along an axis, in the
+    /// given direction, or down h meters
+    static double step_across( double d, AxisRate const& r, bool forward ) {
+      double rate = (forward == r.forward) ? r.ahead : r.back;
+      return (rate > 0) ? d/rate : std::numeric_limits<double>::infinity();
+    }
+    static double step_down( double h, double descent ) {
+      return (descent > 0) ? h/descent : std::numeric_limits<double>::infinity();
+    }
+    /// The pixels the ray can reach going dt meters
+    static BBox2 reach( Vector2 const& pix, double dt, AxisRate const& rx, AxisRate const& ry ) {
+      Vector2 ahead(rx.ahead*dt, ry.ahead*dt), back(rx.back*dt, ry.back*dt);
+      Vector2 lo(rx.forward ? back.x()  : ahead.x(), ry.forward ? back.y()  : ahead.y());
+      Vector2 hi(rx.forward ? ahead.x() : back.x(),  ry.forward ? ahead.y() : back.y());
+      return BBox2(pix - lo, pix + hi);
+    }
+    /// Distance along the ray to go pad pixels out of the box
+    static double step_out( Vector2 const& pix, BBox2i const& box, double pad,
+                            AxisRate const& rx, AxisRate const& ry ) {
+      return std::min(std::min(step_across(box.max().x() - pix.x() + pad, rx, true),
+                               step_across(pix.x() - box.min().x() + pad, rx, false)),
+                      std::min(step_across(box.max().y() - pix.y() + pad, ry, true),
+                               step_across(pix.y() - box.min().y() + pad, ry, false)));
+    }
+
+    double march_step( Sample const& s, Vector2 const& velocity, bool& clear ) const;
+    bool clear_above( Sample const& s0, Sample const& s1 ) const;
+    double warm_start( Vector3 const& ctr, Vector3 const& dir,
+                       double t_begin, double t_guess ) const;
+    bool march( Vector3 const& ctr, Vector3 const& dir, double t_begin, double t_end,
+                bool& crossed, double& t ) const;
+
+    detail::RayDEMSampler<DEMImageT>   m_sampler;
+    boost::shared_ptr<DEMHeightBounds> m_bounds;
+    double m_height_tol;
+  };
+
+  namespace detail {
+
+    /// Intersects a contiguous chunk of a batch of rays.  The first
+    /// exception of any chunk is kept in error, and the chunks after
+    /// it are skipped.
+    template <class IntersectorT>
+    class RayDEMIntersectTask : public Task {
+      IntersectorT         m_intersector; // A copy, for the georeference
+      Vector3       const* m_ctrs;
+      Vector3       const* m_vecs;
+      Vector3            * m_xyz;
+      char               * m_has_intersection;
+      size_t               m_begin, m_end;
+      Mutex              & m_mutex;
+      std::exception_ptr & m_error;
+    public:
+      RayDEMIntersectTask( IntersectorT const& intersector,
+                           Vector3 const* ctrs, Vector3 const* vecs, Vector3* xyz,
+                           char* has_intersection, size_t begin, size_t end,
+                           Mutex& mutex, std::exception_ptr& error )
+        : m_intersector(intersector), m_ctrs(ctrs), m_vecs(vecs), m_xyz(xyz),
+          m_has_intersection(has_intersection), m_begin(begin), m_end(end),
+          m_mutex(mutex), m_error(error) {}
+
+      virtual void operator()() {
+        {
+          Mutex::Lock lock(m_mutex);
+          if (m_error)
+            return;
+        }
+        try {
+          Vector3 guess;
+          for (size_t i = m_begin; i < m_end; i++) {
+            bool has_intersection = false;
+            m_xyz[i] = m_intersector.intersect(m_ctrs[i], m_vecs[i], has_intersection, guess);
+            guess = has_intersection ? m_xyz[i] : Vector3();
+            m_has_intersection[i] = has_intersection;
+          }
+        } catch (...) {
+          Mutex::Lock lock(m_mutex);
+          if (!m_error)
+            m_error = std::current_exception();
+        }
+      }
+    };
+
+    /// Intersect a batch of rays in parallel, as RayDEMIntersector
+    /// does, with any intersector which can intersect one ray.
+    template <class IntersectorT>
+    void intersect_rays( IntersectorT const& intersector,
+                         std::vector<Vector3> const& camera_ctrs,
+                         std::vector<Vector3> const& camera_vecs,
+                         std::vector<Vector3>      & xyz,
+                         std::vector<bool>         & has_intersection,
+                         int num_threads );
+
+  } // namespace detail
+
+  // ---------------------------------------------------------------------------
+  // Implementation
+  // ---------------------------------------------------------------------------
+
+  template <class DEMImageT>
+  DEMHeightBounds::DEMHeightBounds( ImageViewBase<DEMImageT> const& dem, bool treat_nodata_as_zero )
+    : m_treat_nodata_as_zero(treat_nodata_as_zero) {
+    typedef typename DEMImageT::pixel_type PixelT;
+    init(dem.impl().cols(), dem.impl().rows());
+
+    // Rasterize a strip of leaf blocks at a time, with the row of pixels
+    // they share with the next strip.
+    Level& leaves = m_levels[0];
+    std::vector<double> heights;
+    std::vector<char>   valid;
+    for (int32 j = 0; j < leaves.rows; j++) {
+      BBox2i strip(0, j*LEAF_SIZE, m_cols, LEAF_SIZE + 1);
+      strip.crop(BBox2i(0, 0, m_cols, m_rows));
+      ImageView<PixelT> pixels = crop(dem.impl(), strip);
+      heights.assign(size_t(pixels.cols())*pixels.rows(), 0.0);
+      valid.assign(heights.size(), 0);
+      for (int32 row = 0; row < pixels.rows(); row++) {
+        for (int32 col = 0; col < pixels.cols(); col++) {
+          size_t k = size_t(row)*pixels.cols() + col;
+          valid[k] = detail::dem_pixel_height(pixels(col, row), heights[k]) || treat_nodata_as_zero;
+        }
+      }
+
+      for (int32 i = 0; i < leaves.cols; i++) {
+        range_type& r = leaves.ranges[j*leaves.cols + i];
+        double slope_x = 0, slope_y = 0;
+        bool   holes = false;
+        int32 end_col = std::min((i+1)*LEAF_SIZE, m_cols-1);
+        for (int32 row = 0; row < pixels.rows(); row++) {
+          for (int32 col = i*LEAF_SIZE; col <= end_col; col++) {
+            size_t k = size_t(row)*pixels.cols() + col;
+            if (!valid[k]) {
+              holes = true;
+              continue;
+            }
+            r[0] = std::min(r[0], heights[k]);
+            r[1] = std::max(r[1], heights[k]);
+            if (col < end_col && valid[k+1])
+              slope_x = std::max(slope_x, std::abs(heights[k+1] - heights[k]));
+            if (row + 1 < pixels.rows() && valid[k + pixels.cols()])
+              slope_y = std::max(slope_y, std::abs(heights[k + pixels.cols()] - heights[k]));
+          }
+        }
+        // Bilinear interpolation changes by at most slope_x per pixel
+        // along x and slope_y along y.
+        m_slopes[j*leaves.cols + i] = holes ? std::numeric_limits<double>::infinity()
+                                            : slope_x + slope_y;
+      }
+    }
+    build_pyramid();
+  }
+
+  template <class DEMImageT>
+  bool detail::RayDEMSampler<DEMImageT>::dem_height( Vector2 const& pix, double& height ) const {
+    double x = pix[0], y = pix[1];
+    int32  cols = m_dem.cols(), rows = m_dem.rows();
+    if ( !(x >= 0 && x <= cols - 1 && y >= 0 && y <= rows - 1) ) {
+      height = 0;
+      return m_treat_nodata_as_zero;
+    }
+
+    // Bilinear interpolation, where only the pixels with a non-zero
+    // weight need to be valid.
+    int32  x0 = std::min(int32(x), std::max(cols - 2, 0));
+    int32  y0 = std::min(int32(y), std::max(rows - 2, 0));
+    double wx = x - x0, wy = y - y0;
+    height = 0;
+    for (int32 k = 0; k < 4; k++) {
+      int32  dx = k & 1, dy = k >> 1;
+      double w  = (dx ? wx : 1 - wx) * (dy ? wy : 1 - wy);
+      if (w == 0)
+        continue;
+      double h;
+      if (!detail::dem_pixel_height(m_dem(x0 + dx, y0 + dy), h)) {
+        height = 0;
+        return m_treat_nodata_as_zero;
+      }
+      height += w*h;
+    }
+    return true;
+  }
+
+  template <class DEMImageT>
+  void detail::RayDEMSampler<DEMImageT>::evaluate( Vector3 const& ctr, Vector3 const& dir,
+                                                   double t, Sample& s ) const {
+    s.t         = t;
+    s.diff      = std::numeric_limits<double>::quiet_NaN();
+    s.descent   = 0;
+    s.projected = false;
+    Vector3 llh = m_georef.datum().cartesian_to_geodetic(ctr + t*dir);
+    s.alt = llh[2];
+
+    // The local vertical, to know how fast the ray is going down
+    double lon = llh[0]*M_PI/180.0, lat = llh[1]*M_PI/180.0;
+    Vector3 up(cos(lat)*cos(lon), cos(lat)*sin(lon), sin(lat));
+    s.descent = -dot_prod(dir, up);
+
+    try {
+      s.pix = m_georef.lonlat_to_pixel(Vector2(llh[0], llh[1]));
+    } catch (...) {
+      return;
+    }
+    s.projected = (s.pix == s.pix);
+    double height;
+    if (s.projected && dem_height(s.pix, height))
+      s.diff = height - s.alt;
+  }
+
+  template <class DEMImageT>
+  RayDEMIntersector<DEMImageT>::AxisRate::AxisRate( double velocity, double speed ) {
+    // Margin on the velocity, which is measured over the last step, and
+    // some slack for the track of the ray in the DEM turning.
+    const double RATE_MARGIN = 1.25, TURN_SLACK = 1e-2;
+    forward = (velocity >= 0);
+    back    = TURN_SLACK*RATE_MARGIN*speed;
+    ahead   = RATE_MARGIN*std::abs(velocity) + back;
+  }
+
+  /// How far to step the ray from this sample, moving across the DEM at
+  /// a velocity in pixels per meter along the ray.  clear says whether
+  /// the height bounds show the ray stays above the DEM over the step.
+  /// Other steps, through the leaves the ray grazes, off the DEM, or
+  /// below it, are searched for a crossing afterwards.
+  template <class DEMImageT>
+  double RayDEMIntersector<DEMImageT>::march_step( Sample const& s, Vector2 const& velocity,
+                                                   bool& clear ) const {
+    // Smallest step down, in meters, so that the march does not stall
+    // just above a block
+    const double MIN_HEIGHT_STEP = 1e-2;
+    double   speed = norm_inf(velocity);
+    AxisRate rx(velocity.x(), speed), ry(velocity.y(), speed);
+    double   max_rate = std::max(rx.ahead, ry.ahead);
+    double   min_drop = (s.descent > 0) ? MIN_HEIGHT_STEP/s.descent : 0;
+
+    double x = s.pix[0], y = s.pix[1];
+    int32  cols = m_bounds->cols(), rows = m_bounds->rows();
+    double dt;
+    clear = false;
+    if ( !(x >= 0 && x <= cols - 1 && y >= 0 && y <= rows - 1) ) {
+      // Off the DEM, go to its edge, or down to the datum if there is
+      // terrain there. Each axis the ray is off along must be crossed.
+      dt = 0;
+      if (x < 0)        dt = std::max(dt, step_across(-x + 0.5,               rx, true ));
+      if (x > cols - 1) dt = std::max(dt, step_across(x - (cols - 1) + 0.5,   rx, false));
+      if (y < 0)        dt = std::max(dt, step_across(-y + 0.5,               ry, true ));
+      if (y > rows - 1) dt = std::max(dt, step_across(y - (rows - 1) + 0.5,   ry, false));
+      if (m_sampler.treat_nodata_as_zero())
+        dt = std::min(dt, step_down(std::max(s.alt, 0.0), s.descent) + min_drop);
+    } else {
+      int32 col = std::min(int32(x), std::max(cols - 2, 0));
+      int32 row = std::min(int32(y), std::max(rows - 2, 0));
+
+      if (s.diff >= 0) {
+        // Below the DEM, having come on it at its edge or from a hole.
+        // Going down, the ray can only come out above it where the
+        // terrain is lower, so go out of the coarsest block that is all
+        // higher. Within a leaf, half a pixel at a time, or further if
+        // the slope of the terrain shows it cannot fall to the ray.
+        for (int32 level = m_bounds->num_levels() - 1; level >= 0; level--) {
+          DEMHeightBounds::range_type r = m_bounds->range(level, col, row);
+          if (!DEMHeightBounds::is_empty(r) && r[0] > s.alt)
+            return step_out(s.pix, m_bounds->block_box(level, col, row), 0.5, rx, ry);
+        }
+        dt = (max_rate > 0) ? 0.5/max_rate : std::numeric_limits<double>::infinity();
+        double opening = m_bounds->slope(col, row)*max_rate - s.descent;
+        double leaf    = step_out(s.pix, m_bounds->block_box(0, col, row), 0.0, rx, ry);
+        if ( !(opening > 0) )
+          return std::max(dt, leaf);
+        return std::max(dt, std::min(s.diff/opening, leaf));
+      }
+
+      // The coarsest block the ray is above
+      int32 level = m_bounds->num_levels() - 1;
+      DEMHeightBounds::range_type r;
+      for (; level >= 0; level--) {
+        r = m_bounds->range(level, col, row);
+        if (DEMHeightBounds::is_empty(r) || r[1] < s.alt)
+          break;
+      }
+
+      if (level >= 0) {
+        // Go out of the block, or down to its top
+        dt = step_out(s.pix, m_bounds->block_box(level, col, row), 0.5, rx, ry);
+        if (!DEMHeightBounds::is_empty(r))
+          dt = std::min(dt, step_down(s.alt - r[1], s.descent) + min_drop);
+        clear = true;
+      } else {
+        // The ray is within the heights of this leaf, step through it
+        // half a pixel at a time, or further if the slope of the terrain
+        // shows it is unlikely to rise to the ray before then.
+        r  = m_bounds->range(0, col, row);
+        dt = std::min((max_rate > 0) ? 0.5/max_rate : std::numeric_limits<double>::infinity(),
+                      step_down(std::max(s.alt - r[0], 0.0), s.descent) + min_drop);
+        double closing = s.descent + m_bounds->slope(col, row)*max_rate;
+        if (s.diff < 0 && closing > 0)
+          dt = std::max(dt, std::min(-s.diff/closing,
+                                     step_out(s.pix, m_bounds->block_box(0, col, row), 0.0, rx, ry)));
+      }
+    }
+
+    return dt;
+  }
+
+  /// March the ray from t_begin to t_end.  Returns false if the ray
+  /// cannot be followed.  Otherwise, crossed says whether it went below
+  /// the DEM on the way, and then t is where.
+  template <class DEMImageT>
+  bool RayDEMIntersector<DEMImageT>::march( Vector3 const& ctr, Vector3 const& dir,
+                                            double t_begin, double t_end,
+                                            bool& crossed, double& t ) const {
+    const int MAX_STEPS = 1000000;
+    crossed = false;
+
+    Sample prev, next;
+    m_sampler.evaluate(ctr, dir, t_begin, prev);
+    if (prev.diff >= 0) // Starts below the DEM
+      return false;
+
+    // Pixels per meter along the ray, from a small step to start with
+    Vector2 velocity;
+    if (prev.projected) {
+      double probe = std::max(1.0, 1e-6*t_begin);
+      m_sampler.evaluate(ctr, dir, t_begin + probe, next);
+      if (next.projected)
+        velocity = (next.pix - prev.pix)/probe;
+    }
+
+    for (int step = 0; step < MAX_STEPS && prev.t < t_end; step++) {
+      bool   clear = false;
+      double dt = prev.projected ? march_step(prev, velocity, clear) : (t_end - t_begin)/64.0;
+      if (!(dt < std::numeric_limits<double>::infinity())) {
+        // Neither moving across the DEM nor going down
+        return true;
+      }
+      dt = std::max(dt, 1e-9*(1.0 + prev.t));
+      m_sampler.evaluate(ctr, dir, std::min(prev.t + dt, t_end), next);
+
+      // Unless the bounds showed the ray stays above the DEM, look for
+      // the first crossing over the step.  The ray may dip below the DEM
+      // and come back out between two samples above it, or cross it
+      // just before a hole or the edge of the DEM.
+      if (!(prev.diff >= 0) && (!clear || next.diff >= 0)) {
+        bool ok = m_sampler.first_crossing(ctr, dir, prev, next, m_bounds.get(),
+                                           m_height_tol, 1e-2*m_height_tol, 0, 1e-15, 100,
+                                           crossed, t);
+        if (crossed || !ok)
+          return ok;
+      }
+      if (prev.projected && next.projected && next.t > prev.t)
+        velocity = (next.pix - prev.pix)/(next.t - prev.t);
+      prev = next;
+    }
+    return true;
+  }
+
+  template <class DEMImageT>
+  bool detail::RayDEMSampler<DEMImageT>::refine( Vector3 const& ctr, Vector3 const& dir,
+                                                 double t0, double diff0, double t1, double diff1,
+                                                 double height_tol, double stop_tol,
+                                                 double abs_tol, double rel_tol,
+                                                 int max_iter, double& t ) const {
+    // Illinois variant of regula falsi, which keeps the bracket and
+    // converges superlinearly. The ends may be in either order.
+    double best = (-diff0 < diff1) ? t0 : t1;
+    double best_diff = std::min(-diff0, diff1);
+    int side = 0;
+    for (int iter = 0; iter < max_iter; iter++) {
+      if (best_diff <= stop_tol ||
+          std::abs(t1 - t0) <= abs_tol + rel_tol*std::max(std::abs(t0), std::abs(t1)))
+        break;
+      double tn = t1 - diff1*(t1 - t0)/(diff1 - diff0);
+      if ( !(tn > std::min(t0, t1) && tn < std::max(t0, t1)) )
+        tn = 0.5*(t0 + t1);
+      double dn = height_diff(ctr, dir, tn);
+      if (dn != dn) { // A hole in the DEM, try the middle instead
+        tn = 0.5*(t0 + t1);
+        dn = height_diff(ctr, dir, tn);
+        if (dn != dn)
+          break;
+      }
+      if (std::abs(dn) < best_diff) {
+        best      = tn;
+        best_diff = std::abs(dn);
+      }
+      if (dn < 0) {
+        t0 = tn; diff0 = dn;
+        if (side == -1) diff1 *= 0.5;
+        side = -1;
+      } else {
+        t1 = tn; diff1 = dn;
+        if (side == 1) diff0 *= 0.5;
+        side = 1;
+      }
+    }
+    t = best;
+    return best_diff <= height_tol;
+  }
+
+  template <class DEMImageT>
+  bool detail::RayDEMSampler<DEMImageT>::dem_max( BBox2 const& box, int32 max_cells,
+                                                  double& height ) const {
+    int32 cols = m_dem.cols(), rows = m_dem.rows();
+    height = -std::numeric_limits<double>::infinity();
+    if (m_treat_nodata_as_zero &&
+        !(box.min().x() >= 0 && box.min().y() >= 0 &&
+          box.max().x() <= cols - 1 && box.max().y() <= rows - 1))
+      height = 0; // There is terrain at zero off the DEM
+    double x0 = std::max(box.min().x(), 0.0), x1 = std::min(box.max().x(), double(cols - 1));
+    double y0 = std::max(box.min().y(), 0.0), y1 = std::min(box.max().y(), double(rows - 1));
+    if ( !(x0 <= x1 && y0 <= y1) )
+      return true;
+
+    // The cells the box touches, also those it only touches on an edge,
+    // as the terrain on an edge may only be there for one of its cells.
+    int32 num_cell_cols = std::max(cols - 1, 1), num_cell_rows = std::max(rows - 1, 1);
+    int32 c0 = std::max(int32(ceil(x0)) - 1, 0), c1 = std::min(int32(floor(x1)), num_cell_cols - 1);
+    int32 r0 = std::max(int32(ceil(y0)) - 1, 0), r1 = std::min(int32(floor(y1)), num_cell_rows - 1);
+    c0 = std::min(c0, c1);
+    r0 = std::min(r0, r1);
+    if (double(c1 - c0 + 1)*double(r1 - r0 + 1) > max_cells)
+      return false;
+
+    for (int32 row = r0; row <= r1; row++) {
+      for (int32 col = c0; col <= c1; col++) {
+        // Corners of the cell, in the order (0,0), (1,0), (0,1), (1,1)
+        double h[4];
+        bool   valid[4], all_valid = true;
+        for (int32 k = 0; k < 4; k++) {
+          valid[k] = detail::dem_pixel_height(m_dem(std::min(col + (k & 1), cols - 1),
+                                                    std::min(row + (k >> 1), rows - 1)), h[k]);
+          all_valid = all_valid && valid[k];
+        }
+        // The part of the cell in the box
+        double u[2] = { std::min(std::max(x0 - col, 0.0), 1.0), std::min(std::max(x1 - col, 0.0), 1.0) };
+        double v[2] = { std::min(std::max(y0 - row, 0.0), 1.0), std::min(std::max(y1 - row, 0.0), 1.0) };
+        if (all_valid) {
+          for (int32 k = 0; k < 4; k++) {
+            double uk = u[k & 1], vk = v[k >> 1];
+            height = std::max(height, (h[0]*(1 - uk) + h[1]*uk)*(1 - vk) + (h[2]*(1 - uk) + h[3]*uk)*vk);
+          }
+          continue;
+        }
+
+        // Only the edges with valid ends, and the valid corners, have
+        // terrain.  Elsewhere there is none, or it is at zero.
+        if (m_treat_nodata_as_zero)
+          height = std::max(height, 0.0);
+        for (int32 e = 0; e < 2; e++) {
+          // Edge along x at v = e, and along y at u = e
+          if (v[0] <= e && v[1] >= e && valid[2*e] && valid[2*e + 1])
+            for (int32 k = 0; k < 2; k++)
+              height = std::max(height, h[2*e]*(1 - u[k]) + h[2*e + 1]*u[k]);
+          if (u[0] <= e && u[1] >= e && valid[e] && valid[e + 2])
+            for (int32 k = 0; k < 2; k++)
+              height = std::max(height, h[e]*(1 - v[k]) + h[e + 2]*v[k]);
+        }
+        for (int32 k = 0; k < 4; k++)
+          if (valid[k] && u[0] <= (k & 1) && u[1] >= (k & 1) && v[0] <= (k >> 1) && v[1] >= (k >> 1))
+            height = std::max(height, h[k]);
+      }
+    }
+    return true;
+  }
+
+  /// The pixels the ray can be over between two samples.  Over short
+  /// steps its track in the DEM is close to straight, and the box is
+  /// padded for the little it bends.
+  template <class DEMImageT>
+  BBox2 detail::RayDEMSampler<DEMImageT>::track_box( Sample const& s0, Sample const& s1 ) {
+    const double TRACK_PAD = 1e-2;
+    BBox2 box(s0.pix, s0.pix);
+    box.grow(s1.pix);
+    double pad = TRACK_PAD*norm_inf(s1.pix - s0.pix);
+    box.min() -= Vector2(pad, pad);
+    box.max() += Vector2(pad, pad);
+    return box;
+  }
+
+  template <class DEMImageT>
+  bool detail::RayDEMSampler<DEMImageT>::clear_between( Sample const& s0, Sample const& s1,
+                                                        DEMHeightBounds const* bounds ) const {
+    const int32 MAX_CELLS = 64;
+    if (!s0.projected || !s1.projected)
+      return false;
+
+    // The height along a straight line bends up by at most the
+    // curvature of the datum, which is at most a/b^2.
+    double a = m_georef.datum().semi_major_axis(), b = m_georef.datum().semi_minor_axis();
+    double len = std::abs(s1.t - s0.t);
+    double ray_min = std::min(s0.alt, s1.alt) - 0.125*len*len*a/(b*b);
+
+    BBox2  box = track_box(s0, s1);
+    double top;
+    if (!dem_max(box, MAX_CELLS, top)) {
+      if (!bounds)
+        return false;
+      BBox2i pixels(Vector2i(floor(box.min().x()), floor(box.min().y())),
+                    Vector2i(floor(box.max().x()) + 1, floor(box.max().y()) + 1));
+      DEMHeightBounds::range_type r = bounds->range(pixels);
+      top = DEMHeightBounds::is_empty(r) ? -std::numeric_limits<double>::infinity() : r[1];
+      if (m_treat_nodata_as_zero && !BBox2i(0, 0, m_dem.cols(), m_dem.rows()).contains(pixels))
+        top = std::max(top, 0.0);
+    }
+    return top < ray_min;
+  }
+
+  template <class DEMImageT>
+  bool detail::RayDEMSampler<DEMImageT>::first_crossing( Vector3 const& ctr, Vector3 const& dir,
+                                                         Sample const& s0, Sample const& s1,
+                                                         DEMHeightBounds const* bounds,
+                                                         double height_tol, double stop_tol,
+                                                         double abs_tol, double rel_tol,
+                                                         int max_iter, bool& crossed, double& t ) const {
+    // Pieces are not split once they are this small, in pixels and in
+    // meters along the ray, or once there are this many of them.
+    const double MIN_PIXELS = 1e-6, MIN_REL_LENGTH = 1e-12;
+    const int    MAX_PIECES = 4096;
+    crossed = false;
+
+    // Pieces still to look at, with the first one last
+    std::vector<std::pair<Sample, Sample> > pieces(1, std::make_pair(s0, s1));
+    int num_pieces = 1;
+    int32 cols = m_dem.cols(), rows = m_dem.rows();
+    while (!pieces.empty()) {
+      Sample p0 = pieces.back().first, p1 = pieces.back().second;
+      pieces.pop_back();
+      if (p0.diff >= 0 || clear_between(p0, p1, bounds))
+        continue; // Below the DEM from the start, or above it all the way
+
+      bool tiny = !(p1.t - p0.t > MIN_REL_LENGTH*std::max(1.0, std::abs(p1.t))) ||
+        (p0.projected && p1.projected && norm_inf(p1.pix - p0.pix) <= MIN_PIXELS);
+      if (p0.diff < 0 && p1.diff >= 0) {
+        // Going below the DEM.  Within a cell it is crossed only once.
+        bool one_cell = tiny || num_pieces >= MAX_PIECES;
+        if (!one_cell && p0.projected && p1.projected) {
+          BBox2 box = track_box(p0, p1);
+          int32 col = std::min(int32(floor(box.min().x())), std::max(cols - 2, 0));
+          int32 row = std::min(int32(floor(box.min().y())), std::max(rows - 2, 0));
+          one_cell = box.min().x() >= 0 && box.min().y() >= 0 &&
+            box.max().x() <= std::min(col + 1, cols - 1) && box.max().y() <= std::min(row + 1, rows - 1);
+          for (int32 k = 0; k < 4 && one_cell; k++) {
+            double h;
+            one_cell = detail::dem_pixel_height(m_dem(std::min(col + (k & 1), cols - 1),
+                                                      std::min(row + (k >> 1), rows - 1)), h);
+          }
+        }
+        if (one_cell) {
+          crossed = true;
+          return refine(ctr, dir, p0.t, p0.diff, p1.t, p1.diff,
+                        height_tol, stop_tol, abs_tol, rel_tol, max_iter, t);
+        }
+      }
+      if (tiny || num_pieces >= MAX_PIECES)
+        continue;
+
+      Sample mid;
+      evaluate(ctr, dir, 0.5*(p0.t + p1.t), mid);
+      pieces.push_back(std::make_pair(mid, p1));
+      pieces.push_back(std::make_pair(p0, mid));
+      num_pieces++;
+    }
+    return true;
+  }
+
+  /// Whether the ray is certainly above the DEM between two samples.
+  /// The height along a straight line is convex, so when the ray is
+  /// still going down at s1 it is above the tangent there.  Near s1 the
+  /// slope of its leaf block bounds how fast the terrain can rise toward
+  /// the ray, and further back the height bounds of the pixels the ray
+  /// can be over, split in pieces until they are tight enough.
+  template <class DEMImageT>
+  bool RayDEMIntersector<DEMImageT>::clear_above( Sample const& s0, Sample const& s1 ) const {
+    const int MAX_PIECES = 8;
+    if (!s0.projected || !s1.projected || !(s1.descent > 0) || !(s1.diff < 0) || !(s1.t > s0.t))
+      return false;
+
+    // How fast the ray moves across the DEM, forward from s0 and back
+    // from s1
+    Vector2  velocity = (s1.pix - s0.pix)/(s1.t - s0.t);
+    double   speed    = norm_inf(velocity);
+    AxisRate fx( velocity.x(), speed), fy( velocity.y(), speed);
+    AxisRate bx(-velocity.x(), speed), by(-velocity.y(), speed);
+
+    double x = s1.pix[0], y = s1.pix[1];
+    int32  cols = m_bounds->cols(), rows = m_bounds->rows();
+    double t_end = s1.t;
+    if (x >= 0 && x <= cols - 1 && y >= 0 && y <= rows - 1) {
+      int32  col = std::min(int32(x), std::max(cols - 2, 0));
+      int32  row = std::min(int32(y), std::max(rows - 2, 0));
+      double span = step_out(s1.pix, m_bounds->block_box(0, col, row), 0.0, bx, by);
+      double rise = m_bounds->slope(col, row)*std::max(bx.ahead, by.ahead);
+      if ( !(rise <= s1.descent) )
+        span = (rise < std::numeric_limits<double>::infinity())
+          ? std::min(span, -s1.diff/(rise - s1.descent)) : 0.0;
+      t_end = s1.t - span;
+    }
+
+    std::vector<Vector2> pieces(1, Vector2(s0.t, t_end));
+    int num_pieces = 1;
+    while (!pieces.empty()) {
+      Vector2 piece = pieces.back();
+      pieces.pop_back();
+      if (!(piece[1] > piece[0]))
+        continue;
+      BBox2 box = reach(s0.pix, piece[1] - s0.t, fx, fy);
+      box.crop(reach(s1.pix, s1.t - piece[0], bx, by));
+      BBox2i pixels(Vector2i(floor(box.min().x()), floor(box.min().y())),
+                    Vector2i(floor(box.max().x()) + 1, floor(box.max().y()) + 1));
+      DEMHeightBounds::range_type r = m_bounds->range(pixels);
+      if (m_sampler.treat_nodata_as_zero() &&
+          !BBox2i(0, 0, cols, rows).contains(pixels))
+        r[1] = std::max(r[1], 0.0);
+      if (DEMHeightBounds::is_empty(r) || r[1] < s1.alt + s1.descent*(s1.t - piece[1]))
+        continue;
+      if (num_pieces + 1 > MAX_PIECES)
+        return false;
+      double mid = 0.5*(piece[0] + piece[1]);
+      pieces.push_back(Vector2(mid, piece[1]));
+      pieces.push_back(Vector2(piece[0], mid));
+      num_pieces++;
+    }
+    return true;
+  }
+
+  /// Find how far along the ray it is certainly clear of the DEM, near
+  /// the distance t_guess where a neighboring ray hit it.  Try there,
+  /// then back off further each time.  The march can start from there.
+  template <class DEMImageT>
+  double RayDEMIntersector<DEMImageT>::warm_start( Vector3 const& ctr, Vector3 const& dir,
+                                                   double t_begin, double t_guess ) const {
+    const int    MAX_TRIES = 6;
+    const double BACK_OFF  = 4.0;
+    Sample begin, s;
+    m_sampler.evaluate(ctr, dir, t_begin, begin);
+    double t_try = t_guess, back = 0;
+    for (int it = 0; it < MAX_TRIES && t_try > t_begin; it++) {
+      m_sampler.evaluate(ctr, dir, t_try, s);
+      if (clear_above(begin, s))
+        return s.t;
+      if (it == 0) {
+        // The first step back is to above the DEM where the neighbor hit
+        // it, and above the heights of the leaf block there.
+        if (!(s.descent > 0))
+          break;
+        double climb = (s.diff == s.diff) ? std::abs(s.diff) + m_height_tol : 0.0;
+        double x = s.pix[0], y = s.pix[1];
+        int32  cols = m_bounds->cols(), rows = m_bounds->rows();
+        if (x >= 0 && x <= cols - 1 && y >= 0 && y <= rows - 1) {
+          DEMHeightBounds::range_type r =
+            m_bounds->range(0, std::min(int32(x), std::max(cols - 2, 0)),
+                            std::min(int32(y), std::max(rows - 2, 0)));
+          if (!DEMHeightBounds::is_empty(r))
+            climb = std::max(climb, r[1] - s.alt + m_height_tol);
+        }
+        back = climb/s.descent;
+      } else {
+        back *= BACK_OFF;
+      }
+      if (!(back > 0))
+        break;
+      t_try = t_guess - back;
+    }
+    return t_begin;
+  }
+
+  template <class DEMImageT>
+  Vector3 RayDEMIntersector<DEMImageT>::intersect( Vector3 const& camera_ctr,
+                                                   Vector3 const& camera_vec,
+                                                   bool& has_intersection,
+                                                   Vector3 const& xyz_guess ) const {
+    has_intersection = false;
+    try {
+      double len = norm_2(camera_vec);
+      DEMHeightBounds::range_type r = m_bounds->range();
+      if (len == 0 || len != len || DEMHeightBounds::is_empty(r))
+        return Vector3();
+      Vector3 dir = camera_vec/len;
+      if (m_sampler.treat_nodata_as_zero()) { // There is terrain at zero off the DEM
+        r[0] = std::min(r[0], 0.0);
+        r[1] = std::max(r[1], 0.0);
+      }
+
+      // The ray is between these shells when it can hit the DEM.  Pad
+      // them, as the shell at a given height is not exactly at that
+      // geodetic height.
+      double pad = 1.0 + 1e-2*std::max(std::abs(r[0]), std::abs(r[1]));
+      double a = georef().datum().semi_major_axis(), b = georef().datum().semi_minor_axis();
+      double t_begin, t_end, t_low0, t_low1;
+      if (!detail::ray_ellipsoid_intersection(a + r[1] + pad, b + r[1] + pad,
+                                              camera_ctr, dir, t_begin, t_end) || t_end < 0)
+        return Vector3();
+      if (detail::ray_ellipsoid_intersection(a + r[0] - pad, b + r[0] - pad,
+                                             camera_ctr, dir, t_low0, t_low1) && t_low0 > 0)
+        t_end = std::min(t_end, t_low0);
+      t_begin = std::max(t_begin, 0.0);
+
+      // Skip the part of the ray which is clear of the DEM on the way to
+      // the guess.
+      double t_guess = dot_prod(xyz_guess - camera_ctr, dir);
+      if (xyz_guess != Vector3() && t_guess > t_begin && t_guess < t_end)
+        t_begin = warm_start(camera_ctr, dir, t_begin, t_guess);
+
+      bool   crossed = false;
+      double t = 0;
+      if (!march(camera_ctr, dir, t_begin, t_end, crossed, t) || !crossed)
+        return Vector3();
+
+      has_intersection = true;
+      return camera_ctr + t*dir;
+    } catch (...) {
+      has_intersection = false;
+    }
+    return Vector3();
+  }
+
+  template <class DEMImageT>
+  void RayDEMIntersector<DEMImageT>::intersect( std::vector<Vector3> const& camera_ctrs,
+                                                std::vector<Vector3> const& camera_vecs,
+                                                std::vector<Vector3>      & xyz,
+                                                std::vector<bool>         & has_intersection,
+                                                int num_threads ) const {
+    detail::intersect_rays(*this, camera_ctrs, camera_vecs, xyz, has_intersection, num_threads);
+  }
+
+  template <class IntersectorT>
+  void detail::intersect_rays( IntersectorT const& intersector,
+                               std::vector<Vector3> const& camera_ctrs,
+                               std::vector<Vector3> const& camera_vecs,
+                               std::vector<Vector3>      & xyz,
+                               std::vector<bool>         & has_intersection,
+                               int num_threads ) {
+    VW_ASSERT(camera_ctrs.size() == camera_vecs.size(),
+              ArgumentErr() << "RayDEMIntersector: Expecting as many camera centers as directions.");
+    const size_t CHUNK_SIZE = 64;
+    size_t num = camera_ctrs.size();
+    xyz.resize(num);
+    has_intersection.assign(num, false);
+    if (num == 0)
+      return;
+    if (num_threads <= 0)
+      num_threads = vw_settings().default_num_threads();
+
+    // std::vector<bool> packs its elements, which threads cannot write
+    // to independently, so the tasks write flags to a char array. The
+    // chunks are the same however many threads there are, so that the
+    // results are too.
+    // The first exception is rethrown as is once the tasks are done.
+    typedef RayDEMIntersectTask<IntersectorT> TaskT;
+    std::vector<char> flags(num, 0);
+    Mutex mutex;
+    std::exception_ptr error;
+    if (num_threads == 1 || num <= CHUNK_SIZE) {
+      for (size_t begin = 0; begin < num; begin += CHUNK_SIZE)
+        TaskT(intersector, &camera_ctrs[0], &camera_vecs[0], &xyz[0], &flags[0],
+              begin, std::min(num, begin + CHUNK_SIZE), mutex, error)();
+    } else {
+      FifoWorkQueue queue(num_threads);
+      for (size_t begin = 0; begin < num; begin += CHUNK_SIZE) {
+        boost::shared_ptr<Task> task(new TaskT(intersector, &camera_ctrs[0], &camera_vecs[0],
+                                               &xyz[0], &flags[0],
+                                               begin, std::min(num, begin + CHUNK_SIZE),
+                                               mutex, error));
+        queue.add_task(task);
+      }
+      queue.join_all();
+    }
+    if (error)
+      std::rethrow_exception(error);
+    for (size_t i = 0; i < num; i++)
+      has_intersection[i] = flags[i];
+  }
+
+}} // namespace vw::cartography
+
+#endif // __VW_CARTOGRAPHY_RAYDEMINTERSECTION_H__
@@ -23,6 +23,8 @@
 #include <vw/Cartography/CameraBBox.h>
 #include <vw/Camera/PinholeModel.h>
 #include <vw/FileIO/DiskImageView.h>
+#include <vw/Image/Interpolation.h>
+#include <vw/Image/PerPixelViews.h>
 
 #if defined(VW_HAVE_PKG_CAMERA) && VW_HAVE_PKG_CAMERA
 
@@ -84,6 +86,14 @@ TEST_F( CameraBBoxTest, CameraBBoxDEM ) {
   BBox2 image_bbox = camera_bbox( DEM, dem_georef, dem_georef, pinhole_camera, 5616, 3744 );
   EXPECT_VECTOR_NEAR( image_bbox.min(), Vector2(-2.30944e+06,1.10892e+06), 5 );
   EXPECT_VECTOR_NEAR( image_bbox.max(), Vector2(-2.30635e+06,1.11089e+06), 5 );
+
+  // Through a RayDEMIntersector, with height bounds shared between calls
+  boost::shared_ptr<DEMHeightBounds> bounds(new DEMHeightBounds(DEM));
+  float gsd;
+  image_bbox = camera_bbox( DEM, dem_georef, dem_georef, pinhole_camera, 5616, 3744, gsd,
+                            false, 0, bounds );
+  EXPECT_VECTOR_NEAR( image_bbox.min(), Vector2(-2.30944e+06,1.10892e+06), 5 );
+  EXPECT_VECTOR_NEAR( image_bbox.max(), Vector2(-2.30635e+06,1.11089e+06), 5 );
 }
 
 // Try projecting a pixel to and from the DEM using the bbox tool.
@@ -107,6 +117,248 @@ TEST_F( CameraBBoxTest, CameraPixelToXYZ) {
   EXPECT_VECTOR_NEAR(input_pixel, output_pixel, 1e-4);
 }
 
+// The height bounds contain every valid pixel of the DEM.
+TEST_F( CameraBBoxTest, DEMHeightBounds ) {
+  DEMHeightBounds bounds(DEM);
+  ASSERT_EQ(bounds.cols(), DEM.cols());
+  ASSERT_EQ(bounds.rows(), DEM.rows());
+  double lo = std::numeric_limits<double>::max(), hi = -lo;
+  for (int32 row = 0; row < DEM.rows(); row++) {
+    for (int32 col = 0; col < DEM.cols(); col++) {
+      if (!is_valid(DEM(col, row)))
+        continue;
+      double h = DEM(col, row).child();
+      lo = std::min(lo, h);
+      hi = std::max(hi, h);
+      int32 cell_col = std::min(col, DEM.cols() - 2), cell_row = std::min(row, DEM.rows() - 2);
+      for (int32 level = 0; level < bounds.num_levels(); level++) {
+        DEMHeightBounds::range_type r = bounds.range(level, cell_col, cell_row);
+        EXPECT_LE(r[0], h);
+        EXPECT_GE(r[1], h);
+      }
+    }
+  }
+  EXPECT_EQ(bounds.range()[0], lo);
+  EXPECT_EQ(bounds.range()[1], hi);
+}
+
+// Intersect camera rays with the DEM and project them back.
+TEST_F( CameraBBoxTest, RayDEMIntersector ) {
+  GeoReference dem_georef;
+  read_georeference(dem_georef, "tinyDemAN.tif");
+  RayDEMIntersector< ImageView< PixelMask<float> > > intersector(DEM, dem_georef);
+
+  std::vector<Vector2> pixels;
+  std::vector<Vector3> ctrs, vecs;
+  for (int32 row = 0; row < 3744; row += 312) {
+    for (int32 col = 0; col < 5616; col += 312) {
+      pixels.push_back(Vector2(col, row));
+      ctrs.push_back(pinhole_camera->camera_center(pixels.back()));
+      vecs.push_back(pinhole_camera->pixel_to_vector(pixels.back()));
+    }
+  }
+
+  int32 hits = 0;
+  for (size_t i = 0; i < ctrs.size(); i++) {
+    bool has_intersection;
+    Vector3 xyz = intersector.intersect(ctrs[i], vecs[i], has_intersection);
+    if (!has_intersection)
+      continue;
+    hits++;
+    EXPECT_VECTOR_NEAR(pixels[i], pinhole_camera->point_to_pixel(xyz), 1e-4);
+
+    // The point is on the DEM
+    Vector3 llh     = dem_georef.datum().cartesian_to_geodetic(xyz);
+    Vector2 dem_pix = dem_georef.lonlat_to_pixel(subvector(llh, 0, 2));
+    PixelMask<float> h = interpolate(DEM, BilinearInterpolation(), ZeroEdgeExtension())
+      (dem_pix.x(), dem_pix.y());
+    ASSERT_TRUE(is_valid(h));
+    EXPECT_NEAR(h.child(), llh[2], 1e-2);
+  }
+  EXPECT_GT(hits, 0);
+
+  // A batch gives the same points as one ray at a time
+  std::vector<Vector3> xyz;
+  std::vector<bool>    has_intersection;
+  intersector.intersect(ctrs, vecs, xyz, has_intersection, 4);
+  ASSERT_EQ(xyz.size(), ctrs.size());
+  for (size_t i = 0; i < ctrs.size(); i++) {
+    bool has_single;
+    Vector3 single = intersector.intersect(ctrs[i], vecs[i], has_single);
+    EXPECT_EQ(has_single, has_intersection[i]);
+    if (has_single && has_intersection[i]) {
+      EXPECT_VECTOR_NEAR(single, xyz[i], 1e-2);
+    }
+  }
+}
+
+// Fails on rays pointing up, as a bad DEM read would
+struct FailingIntersector {
+  Vector3 intersect( Vector3 const& ctr, Vector3 const& vec, bool& has_intersection,
+                     Vector3 const& /*guess*/ ) const {
+    if (vec.z() > 0)
+      vw_throw(IOErr() << "FailingIntersector: bad ray.");
+    has_intersection = true;
+    return ctr + vec;
+  }
+};
+
+// The exception of a chunk of rays reaches the caller, with its type
+TEST( CameraBBox, RayDEMIntersectErrors ) {
+  std::vector<Vector3> ctrs(1000, Vector3()), vecs(1000, Vector3(0,0,-1));
+  vecs[700] = Vector3(0,0,1);
+  std::vector<Vector3> xyz;
+  std::vector<bool>    has_intersection;
+  EXPECT_THROW(detail::intersect_rays(FailingIntersector(), ctrs, vecs, xyz, has_intersection, 1),
+               IOErr);
+  EXPECT_THROW(detail::intersect_rays(FailingIntersector(), ctrs, vecs, xyz, has_intersection, 4),
+               IOErr);
+}
+
+// The first crossing of the DEM along a ray, found by stepping along
+// it in small steps and bisecting the first step that goes below it.
+template <class DEMImageT>
+bool brute_force_crossing( detail::RayDEMSampler<DEMImageT> const& sampler,
+                           Vector3 const& ctr, Vector3 const& dir,
+                           double t_begin, double t_end, double step, double& t ) {
+  double prev_t = t_begin, prev = sampler.height_diff(ctr, dir, t_begin);
+  for (double next_t = t_begin + step; next_t <= t_end; next_t += step) {
+    double next = sampler.height_diff(ctr, dir, next_t);
+    if (!(prev >= 0) && next >= 0) {
+      // From above the DEM or from a hole.  Bisect, keeping a point
+      // above the DEM if there is one.
+      double lo = prev_t, hi = next_t;
+      bool above = (prev < 0);
+      for (int iter = 0; iter < 60; iter++) {
+        double mid = 0.5*(lo + hi), diff = sampler.height_diff(ctr, dir, mid);
+        if (diff < 0)
+          above = true;
+        if (diff >= 0)
+          hi = mid;
+        else
+          lo = mid;
+      }
+      if (above) {
+        t = 0.5*(lo + hi);
+        return true;
+      }
+    }
+    prev_t = next_t;
+    prev   = next;
+  }
+  return false;
+}
+
+// Rays that only clip a cliff, a ramp or the edge of a hole for a few
+// meters still give their first crossing of the DEM.
+TEST( CameraBBox, RayDEMFirstCrossing ) {
+  typedef ImageView< PixelMask<float> > DEMT;
+  const int32 size = 80;
+  DEMT dem(size, size);
+  for (int32 row = 0; row < size; row++) {
+    for (int32 col = 0; col < size; col++) {
+      double h = 40*sin(col/7.0)*cos(row/5.0) + 5*sin(1.7*col + 0.9*row);
+      if (col > 40 && col < 44)
+        h += 250;              // A cliff
+      if (row > 50)
+        h += 8.0*(row - 50);   // A ramp
+      dem(col, row) = PixelMask<float>(h);
+    }
+  }
+  for (int32 row = 20; row < 30; row++)
+    for (int32 col = 15; col < 30; col++)
+      dem(col, row).invalidate(); // A hole
+
+  // About 11 meters per pixel
+  GeoReference georef;
+  georef.set_well_known_geogcs("WGS84");
+  Matrix3x3 transform = math::identity_matrix<3>();
+  transform(0,0) =  1e-4; transform(0,2) = 10.0;
+  transform(1,1) = -1e-4; transform(1,2) = 20.008;
+  georef.set_transform(transform);
+  Datum const& datum = georef.datum();
+
+  RayDEMIntersector<DEMT> intersector(dem, georef);
+  detail::RayDEMSampler<DEMT> sampler(dem, georef, false);
+
+  // Rays from a camera off to the side, aimed at points spread over
+  // the DEM and the heights of its terrain, so that many of them graze it.
+  Vector3 ctr = datum.geodetic_to_cartesian(Vector3(9.998, 20.009, 1500));
+  int32 num_hits = 0;
+  for (int32 k = 0; k < 1000; k++) {
+    double frac_x = (k*37 % 1000)/1000.0, frac_y = (k*91 % 997)/997.0, frac_h = (k*53 % 991)/991.0;
+    Vector3 target = datum.geodetic_to_cartesian
+      (Vector3(10.0 + 0.0079*frac_x, 20.008 - 0.0079*frac_y, -50 + 600*frac_h));
+    Vector3 dir = normalize(target - ctr);
+
+    double t_brute = 0;
+    bool   brute_hit = brute_force_crossing(sampler, ctr, dir, 0, 1.5*norm_2(target - ctr), 0.25, t_brute);
+    num_hits += brute_hit;
+
+    bool has_intersection, has_pixel_xyz;
+    Vector3 xyz       = intersector.intersect(ctr, dir, has_intersection);
+    Vector3 pixel_xyz = camera_pixel_to_dem_xyz(ctr, dir, dem, georef, false, has_pixel_xyz, 1e-3);
+    EXPECT_TRUE(!brute_hit || has_intersection) << "Ray " << k;
+    EXPECT_TRUE(!brute_hit || has_pixel_xyz)    << "Ray " << k;
+
+    // The steps can skip a crossing shorter than them, but not one of
+    // the methods.
+    if (has_intersection) {
+      EXPECT_NEAR(0, sampler.height_diff(ctr, dir, dot_prod(xyz - ctr, dir)), 1e-2);
+      if (brute_hit) {
+        EXPECT_LE(dot_prod(xyz - ctr, dir), t_brute + 1e-2) << "Ray " << k;
+      }
+    }
+    if (has_pixel_xyz) {
+      EXPECT_NEAR(0, sampler.height_diff(ctr, dir, dot_prod(pixel_xyz - ctr, dir)), 1e-2);
+      if (brute_hit) {
+        EXPECT_LE(dot_prod(pixel_xyz - ctr, dir), t_brute + 1e-2) << "Ray " << k;
+      }
+    }
+  }
+  EXPECT_GT(num_hits, 500);
+}
+
+// Counts the DEM pixels read
+struct CountingDEMFunc : ReturnFixedType<PixelMask<float> > {
+  int32 *count;
+  CountingDEMFunc( int32 *count ) : count(count) {}
+  PixelMask<float> operator()( PixelMask<float> const& pix ) const { (*count)++; return pix; }
+};
+
+// A footprint read back from the cache is the one computed, and is
+// found without reading the DEM.
+TEST_F( CameraBBoxTest, CameraBBoxCache ) {
+  GeoReference dem_georef;
+  read_georeference(dem_georef, "tinyDemAN.tif");
+  UnlinkName dir("camera_bbox_cache");
+  CameraBBoxCache cache(dir);
+
+  float gsd, cached_gsd;
+  BBox2 bbox = camera_bbox( DEM, dem_georef, dem_georef, pinhole_camera, 5616, 3744, gsd );
+  BBox2 first  = camera_bbox( cache, "pinhole_AN.tsai", "tinyDemAN.tif", DEM, dem_georef,
+                              dem_georef, pinhole_camera, 5616, 3744, cached_gsd );
+  EXPECT_VECTOR_NEAR( first.min(), bbox.min(), 1e-6 );
+  EXPECT_VECTOR_NEAR( first.max(), bbox.max(), 1e-6 );
+  EXPECT_NEAR( cached_gsd, gsd, 1e-6 );
+
+  // Now from the cache
+  int32 count = 0;
+  BBox2 second = camera_bbox( cache, "pinhole_AN.tsai", "tinyDemAN.tif",
+                              per_pixel_view(DEM, CountingDEMFunc(&count)), dem_georef,
+                              dem_georef, pinhole_camera, 5616, 3744, cached_gsd );
+  EXPECT_EQ( 0, count );
+  EXPECT_VECTOR_NEAR( second.min(), bbox.min(), 1e-6 );
+  EXPECT_VECTOR_NEAR( second.max(), bbox.max(), 1e-6 );
+  EXPECT_NEAR( cached_gsd, gsd, 1e-6 );
+  EXPECT_NE( cache.key("pinhole_AN.tsai", "a"), cache.key("pinhole_AN.tsai", "b") );
+
+  BBox2 missing;
+  EXPECT_FALSE( cache.read(cache.key("pinhole_AN.tsai", "a"), missing, cached_gsd) );
+  EXPECT_THROW( cache.key("no_such_camera.tsai", "a"), IOErr );
+  EXPECT_THROW( cache.file_context("no_such_dem.tif"), IOErr );
+}
+
 
 /* // Make sure camera_bbox works properly in a non-toy case.
 TEST( CameraBBox, CameraBBoxDEM11 ) {
@@ -167,3 +167,77 @@ TEST( Datum, GeodeticConversion ) {
   EXPECT_VECTOR_NEAR( datum.cartesian_to_geodetic(datum.geodetic_to_cartesian(Vector3(30,-10,173740))),
                       Vector3(30,-10,173740), 1e-6 );
 }
+
+TEST( Datum, BatchGeodeticConversion ) {
+  Datum datum("WGS84");
+  std::vector<double> values;
+  values += -8000000.,-6500000.,-5788000.,-500000.,-50000.,-1000.,-1.,0.,1.,1000.,50000.,500000.,5788000.,6500000.,8000000.;
+  std::vector<double> x, y, z;
+  for ( size_t ix = 0; ix < values.size(); ix++ )
+    for ( size_t iy = 0; iy < values.size(); iy++ )
+      for ( size_t iz = 0; iz < values.size(); iz++ ) {
+        x.push_back(values[ix]);
+        y.push_back(values[iy]);
+        z.push_back(values[iz]);
+      }
+  const size_t n = x.size();
+
+  // Every point, including those near the center, against the single
+  // point versions.
+  std::vector<double> lon(n), lat(n), alt(n), x2(n), y2(n), z2(n);
+  datum.cartesian_to_geodetic(&x[0], &y[0], &z[0], &lon[0], &lat[0], &alt[0], n);
+  datum.geodetic_to_cartesian(&lon[0], &lat[0], &alt[0], &x2[0], &y2[0], &z2[0], n);
+  for ( size_t i = 0; i < n; i++ ) {
+    Vector3 llh = datum.cartesian_to_geodetic(Vector3(x[i], y[i], z[i]));
+    // Longitudes of 180 and -180 are the same.  Near there the single
+    // point version is less precise.
+    double dlon = std::fmod(lon[i] - llh[0] + 540.0, 360.0) - 180.0;
+    EXPECT_NEAR( 0, dlon, std::fabs(lon[i]) > 179 ? 1e-6 : 1e-12 );
+    EXPECT_NEAR( llh[1], lat[i], 1e-12 );
+    EXPECT_NEAR( llh[2], alt[i], 1e-8 );
+    EXPECT_VECTOR_NEAR( Vector3(x2[i], y2[i], z2[i]),
+                        datum.geodetic_to_cartesian(Vector3(lon[i], lat[i], alt[i])), 1e-8 );
+  }
+
+  // In place
+  datum.cartesian_to_geodetic(&x[0], &y[0], &z[0], &x[0], &y[0], &z[0], n);
+  for ( size_t i = 0; i < n; i++ )
+    EXPECT_VECTOR_NEAR( Vector3(x[i], y[i], z[i]), Vector3(lon[i], lat[i], alt[i]), 0 );
+}
+
+// Converts a few million points with the batch and the single point
+// functions.
+TEST( Datum, DISABLED_BatchConversionBenchmark ) {
+  Datum datum("WGS84");
+  const size_t n = 4000000;
+  std::vector<double> lon(n), lat(n), alt(n), x(n), y(n), z(n);
+  for ( size_t i = 0; i < n; i++ ) {
+    lon[i] = -180 + 360.0 * (i % 7919) / 7919;
+    lat[i] = -90  + 180.0 * (i % 6271) / 6271;
+    alt[i] = -500 + 9000.0 * (i % 101) / 101;
+  }
+
+  Stopwatch batch_forward, batch_inverse, single_forward, single_inverse;
+  batch_forward.start();
+  datum.geodetic_to_cartesian(&lon[0], &lat[0], &alt[0], &x[0], &y[0], &z[0], n);
+  batch_forward.stop();
+  batch_inverse.start();
+  datum.cartesian_to_geodetic(&x[0], &y[0], &z[0], &lon[0], &lat[0], &alt[0], n);
+  batch_inverse.stop();
+
+  double sum = 0;
+  single_forward.start();
+  for ( size_t i = 0; i < n; i++ )
+    sum += datum.geodetic_to_cartesian(Vector3(lon[i], lat[i], alt[i]))[0];
+  single_forward.stop();
+  single_inverse.start();
+  for ( size_t i = 0; i < n; i++ )
+    sum += datum.cartesian_to_geodetic(Vector3(x[i], y[i], z[i]))[2];
+  single_inverse.stop();
+
+  std::cout << "geodetic_to_cartesian: single " << single_forward.elapsed_seconds() / n * 1e9
+            << " ns, batch " << batch_forward.elapsed_seconds() / n * 1e9 << " ns per point\n"
+            << "cartesian_to_geodetic: single " << single_inverse.elapsed_seconds() / n * 1e9
+            << " ns, batch " << batch_inverse.elapsed_seconds() / n * 1e9 << " ns per point ("
+            << sum << ")\n";
+}
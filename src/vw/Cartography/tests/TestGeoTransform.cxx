@@ -23,6 +23,7 @@
 #include <vw/Cartography/GeoReference.h>
 #include <vw/Cartography/GeoTransform.h>
 #include <vw/Cartography/GeoReferenceUtils.h>
+#include <vw/Core/ThreadPool.h>
 
 using namespace vw;
 using namespace vw::cartography;
@@ -348,3 +349,75 @@ TEST(GeoTransform, sinusoidalTest) {
   EXPECT_NEAR(pixel2.max().x(), 924.0, eps);
   EXPECT_NEAR(pixel2.max().y(), 914.0, eps);  
 }
+
+namespace {
+  void reverse_rows(GeoTransform const& tx, int32 first_row, int32 num_rows, int32 cols,
+                    std::vector<Vector2>* out) {
+    for (int32 j = first_row; j < first_row + num_rows; ++j)
+      tx.reverse_row(j, 0, cols, &(*out)[j*cols]);
+  }
+
+  // Reverses some rows with its own copy of the transform.
+  class ReverseRowsTask : public Task {
+    GeoTransform m_tx;
+    int32 m_first_row, m_num_rows, m_cols;
+    std::vector<Vector2>* m_out;
+  public:
+    ReverseRowsTask(GeoTransform const& tx, int32 first_row, int32 num_rows, int32 cols,
+                    std::vector<Vector2>* out)
+      : m_tx(tx), m_first_row(first_row), m_num_rows(num_rows), m_cols(cols), m_out(out) {}
+    virtual void operator()() { reverse_rows(m_tx, m_first_row, m_num_rows, m_cols, m_out); }
+  };
+}
+
+TEST(GeoTransform, BatchDatumConversion) {
+  Datum wgs84, intl;
+  wgs84.set_datum_from_proj_str("+proj=longlat +datum=WGS84 +no_defs");
+  intl.set_datum_from_proj_str("+proj=longlat +ellps=intl +towgs84=-87,-98,-121,0,0,0,0 +no_defs");
+
+  Matrix3x3 affine = math::identity_matrix<3>();
+  affine(0,0) =  0.01;
+  affine(1,1) = -0.01;
+  affine(0,2) = 10;
+  affine(1,2) = 50;
+  GeoReference src_georef(intl, affine), dst_georef(wgs84, affine);
+  GeoTransform tx(src_georef, dst_georef);
+
+  // The batch gives the same result as converting point by point
+  std::vector<Vector2> lonlats;
+  std::vector<Vector3> lonlatalts;
+  for (int32 i = 0; i < 20; ++i) {
+    lonlats.push_back(Vector2(10 + 0.3*i, 50 - 0.2*i));
+    lonlatalts.push_back(Vector3(10 + 0.3*i, 50 - 0.2*i, 100.0*i));
+  }
+  std::vector<Vector2> batch(lonlats);
+  std::vector<Vector3> batch_alt(lonlatalts);
+  tx.lonlat_to_lonlat(&batch[0], batch.size(), false);
+  tx.lonlatalt_to_lonlatalt(&batch_alt[0], batch_alt.size());
+  for (size_t i = 0; i < lonlats.size(); ++i) {
+    EXPECT_VECTOR_NEAR(tx.lonlat_to_lonlat(lonlats[i], false), batch[i], 1e-12);
+    EXPECT_VECTOR_NEAR(tx.lonlatalt_to_lonlatalt(lonlatalts[i]), batch_alt[i], 1e-12);
+    EXPECT_GT(norm_2(lonlats[i] - batch[i]), 1e-4); // The datums really differ
+  }
+
+  // Whole rows match the point by point reverse()
+  const int32 cols = 37, rows = 24;
+  std::vector<Vector2> serial(cols*rows);
+  reverse_rows(tx, 0, rows, cols, &serial);
+  for (int32 j = 0; j < rows; ++j)
+    for (int32 i = 0; i < cols; ++i)
+      EXPECT_VECTOR_NEAR(tx.reverse(Vector2(i,j)), serial[j*cols+i], 1e-9);
+
+  // Copies of the transform convert in parallel
+  std::vector<Vector2> parallel(cols*rows);
+  {
+    FifoWorkQueue queue(4);
+    for (int32 j = 0; j < rows; j += 3) {
+      boost::shared_ptr<Task> task(new ReverseRowsTask(tx, j, 3, cols, &parallel));
+      queue.add_task(task);
+    }
+    queue.join_all();
+  }
+  for (size_t k = 0; k < serial.size(); ++k)
+    EXPECT_VECTOR_NEAR(serial[k], parallel[k], 1e-12);
+}
@@ -0,0 +1,184 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+// TestMap2CamTrans.h
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+
+#include <vw/Cartography/Map2CamTrans.h>
+#include <vw/Cartography/GeoReferenceUtils.h>
+#include <vw/Cartography/ProjectionKernel.h>
+#include <vw/Camera/PinholeModel.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/FileIO/DiskImageView.h>
+#include <vw/Image/Interpolation.h>
+#include <vw/Image/MaskViews.h>
+
+#if defined(VW_HAVE_PKG_CAMERA) && VW_HAVE_PKG_CAMERA
+
+using namespace vw;
+using namespace vw::cartography;
+using namespace vw::test;
+using namespace vw::camera;
+
+// Map-project onto the grid of a low res DEM in Antarctica, seen by a
+// pinhole camera.
+class Map2CamTransTest :  public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    pinhole_camera = boost::shared_ptr<CameraModel>(new PinholeModel("pinhole_AN.tsai"));
+    read_georeference(dem_georef, "tinyDemAN.tif");
+    DEM = create_mask(DiskImageView<short>("tinyDemAN.tif"), -32768);
+  }
+
+  // The camera pixel of a map pixel, computed directly on the DEM.
+  Vector2 expected_pixel(Vector2 const& p) const { return expected_pixel(dem_georef, p); }
+
+  Vector2 expected_pixel(GeoReference const& image_georef, Vector2 const& p) const {
+    Vector2 lonlat  = image_georef.pixel_to_lonlat(p);
+    Vector2 dem_pix = dem_georef.lonlat_to_pixel(lonlat);
+    PixelMask<float> h = interpolate(DEM, BicubicInterpolation(), ZeroEdgeExtension())(dem_pix.x(), dem_pix.y());
+    if (!is_valid(h))
+      return CameraModel::invalid_pixel();
+    try {
+      return pinhole_camera->point_to_pixel
+        (dem_georef.datum().geodetic_to_cartesian(Vector3(lonlat[0], lonlat[1], h.child())));
+    } catch (...) {
+      return CameraModel::invalid_pixel();
+    }
+  }
+
+  boost::shared_ptr<CameraModel> pinhole_camera;
+  GeoReference dem_georef;
+  ImageView< PixelMask<float> > DEM;
+};
+
+namespace {
+
+  // Transforms the tiles of a region one at a time, as TransformView
+  // does, with no copy of the transform.
+  void transform_tiles(Map2CamTrans const& trans, std::vector<BBox2i> const& tiles,
+                       size_t first, size_t step, ImageView<Vector2>& out) {
+    for (size_t i = first; i < tiles.size(); i += step) {
+      trans.reverse_bbox(tiles[i]);
+      for (int32 y = tiles[i].min().y(); y < tiles[i].max().y(); ++y)
+        for (int32 x = tiles[i].min().x(); x < tiles[i].max().x(); ++x)
+          out(x, y) = trans.reverse(Vector2(x, y));
+    }
+  }
+
+  class TransformTilesTask : public Task {
+    Map2CamTrans const& m_trans;
+    std::vector<BBox2i> const& m_tiles;
+    size_t m_first, m_step;
+    ImageView<Vector2>& m_out;
+  public:
+    TransformTilesTask(Map2CamTrans const& trans, std::vector<BBox2i> const& tiles,
+                       size_t first, size_t step, ImageView<Vector2>& out)
+      : m_trans(trans), m_tiles(tiles), m_first(first), m_step(step), m_out(out) {}
+    virtual void operator()() { transform_tiles(m_trans, m_tiles, m_first, m_step, m_out); }
+  };
+}
+
+TEST_F( Map2CamTransTest, MatchesDirectProjection ) {
+  Map2CamTrans trans(pinhole_camera.get(), dem_georef, dem_georef, "tinyDemAN.tif",
+                     Vector2i(5616, 3744), false);
+
+  // Through the lookup grid of a tile, and without it
+  BBox2i tile(5, 5, 12, 9);
+  tile.crop(bounding_box(DEM));
+  trans.reverse_bbox(tile);
+  Map2CamTrans other(trans);
+  int32 valid = 0;
+  for (int32 y = 0; y < DEM.rows(); ++y) {
+    for (int32 x = 0; x < DEM.cols(); ++x) {
+      if (x < 3 || y < 3 || x >= DEM.cols() - 3 || y >= DEM.rows() - 3)
+        continue; // Too close to the edge of the DEM to interpolate
+      Vector2 expected = expected_pixel(Vector2(x, y));
+      EXPECT_VECTOR_NEAR(expected, trans.reverse(Vector2(x, y)), 1e-6);
+      EXPECT_VECTOR_NEAR(expected, other.reverse(Vector2(x, y)), 1e-6);
+      if (expected != CameraModel::invalid_pixel())
+        ++valid;
+    }
+  }
+  EXPECT_GT(valid, 0);
+}
+
+namespace {
+
+  // Transforms the DEM's extent in tiles, on one thread and on four
+  // sharing the transform.
+  void transform_serial_and_parallel(Map2CamTrans const& trans, BBox2i const& extent,
+                                     ImageView<Vector2>& serial, ImageView<Vector2>& parallel) {
+    std::vector<BBox2i> tiles;
+    for (int32 y = 0; y < extent.height(); y += 7)
+      for (int32 x = 0; x < extent.width(); x += 6) {
+        tiles.push_back(BBox2i(x, y, 6, 7));
+        tiles.back().crop(extent);
+      }
+
+    serial.set_size(extent.width(), extent.height());
+    parallel.set_size(extent.width(), extent.height());
+    transform_tiles(trans, tiles, 0, 1, serial);
+    FifoWorkQueue queue(4);
+    for (size_t i = 0; i < 4; ++i) {
+      boost::shared_ptr<Task> task(new TransformTilesTask(trans, tiles, i, 4, parallel));
+      queue.add_task(task);
+    }
+    queue.join_all();
+  }
+}
+
+TEST_F( Map2CamTransTest, SharedAcrossThreads ) {
+  Map2CamTrans trans(pinhole_camera.get(), dem_georef, dem_georef, "tinyDemAN.tif",
+                     Vector2i(5616, 3744), false);
+
+  ImageView<Vector2> serial, parallel;
+  transform_serial_and_parallel(trans, bounding_box(DEM), serial, parallel);
+  for (int32 y = 0; y < DEM.rows(); ++y)
+    for (int32 x = 0; x < DEM.cols(); ++x)
+      EXPECT_VECTOR_NEAR(serial(x, y), parallel(x, y), 1e-6);
+}
+
+TEST_F( Map2CamTransTest, SharedAcrossThreadsThroughProj ) {
+  // A map projection the kernel leaves to Proj.4, so that every thread
+  // converts map pixels with a proj handle.
+  GeoReference image_georef = dem_georef;
+  image_georef.set_lambert_azimuthal(-90, 0);
+  ASSERT_FALSE(ProjectionKernel(image_georef.overall_proj4_str()).is_valid());
+
+  Map2CamTrans trans(pinhole_camera.get(), image_georef, dem_georef, "tinyDemAN.tif",
+                     Vector2i(5616, 3744), false);
+  ImageView<Vector2> serial, parallel;
+  transform_serial_and_parallel(trans, bounding_box(DEM), serial, parallel);
+
+  int32 valid = 0;
+  for (int32 y = 0; y < DEM.rows(); ++y)
+    for (int32 x = 0; x < DEM.cols(); ++x) {
+      EXPECT_VECTOR_NEAR(serial(x, y), parallel(x, y), 1e-6);
+      if (x < 3 || y < 3 || x >= DEM.cols() - 3 || y >= DEM.rows() - 3)
+        continue; // Too close to the edge of the DEM to interpolate
+      Vector2 expected = expected_pixel(image_georef, Vector2(x, y));
+      EXPECT_VECTOR_NEAR(expected, parallel(x, y), 1e-6);
+      if (expected != CameraModel::invalid_pixel())
+        ++valid;
+    }
+  EXPECT_GT(valid, 0);
+}
+
+#endif
@@ -82,3 +82,35 @@ TEST( PointImageManipulation, CartesianGeodetic ) {
   EXPECT_SEQ_NEAR( cartesian, result_moon,  1e-6 );
   EXPECT_SEQ_NEAR( cartesian, result_earth, 1e-6 );
 }
+
+// Rasterizing converts whole tiles at once, which should give the same
+// result as converting each pixel.
+TEST( PointImageManipulation, TileConversion ) {
+  ImageView<Vector3> geodetic(300,4);
+  for ( int32 j = 0; j < geodetic.rows(); j++ )
+    for ( int32 i = 0; i < geodetic.cols(); i++ )
+      geodetic(i,j) = Vector3( -179 + 1.19*i, -89 + 59*j, 100*i - 5000 );
+  geodetic(7,2) = Vector3(0, 0, std::numeric_limits<double>::quiet_NaN() ); // invalid measure.
+
+  Datum earth("WGS84");
+  BBox2i bbox(5,1,290,3);
+  ImageView<Vector3> cartesian = crop(geodetic_to_cartesian(geodetic, earth), bbox);
+  ImageView<Vector3> result    = crop(cartesian_to_geodetic(geodetic_to_cartesian(geodetic, earth), earth), bbox);
+  ImageView<Vector3> estimate  = crop(xyz_to_lon_lat_radius_estimate(geodetic_to_cartesian(geodetic, earth)), bbox);
+  ASSERT_EQ( bbox.width(),  cartesian.cols() );
+  ASSERT_EQ( bbox.height(), cartesian.rows() );
+  for ( int32 j = 0; j < bbox.height(); j++ ) {
+    for ( int32 i = 0; i < bbox.width(); i++ ) {
+      Vector3 point = geodetic(i + bbox.min().x(), j + bbox.min().y());
+      Vector3 xyz   = GeodeticToCartesian(earth)(point);
+      EXPECT_VECTOR_NEAR( xyz, cartesian(i,j), 1e-8 );
+      EXPECT_VECTOR_NEAR( XYZtoLonLatRadEstimateFunctor()(xyz), estimate(i,j), 1e-8 );
+      if ( boost::math::isnan(point.z()) ) {
+        EXPECT_EQ( Vector3(), cartesian(i,j) );
+        EXPECT_TRUE( boost::math::isnan(result(i,j).z()) );
+      } else {
+        EXPECT_VECTOR_NEAR( point, result(i,j), 1e-6 );
+      }
+    }
+  }
+}
@@ -0,0 +1,197 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+// TestProjectionKernel.h
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+
+#include <vw/Cartography/GeoReference.h>
+#include <vw/Cartography/ProjectionKernel.h>
+#include <vw/Math/Geometry.h>
+
+#include <proj_api.h>
+
+using namespace vw;
+using namespace vw::cartography;
+using namespace vw::test;
+
+namespace {
+
+  struct KernelCase {
+    const char* proj4_str;
+    ProjectionKernel::Type type;
+    double lon, lat, dlon, dlat; // The area to test
+  };
+
+  const KernelCase KERNEL_CASES[] = {
+    { "+proj=utm +zone=13 +units=m +datum=WGS84 +no_defs",
+      ProjectionKernel::TransverseMercator, -105, 40, 4, 40 },
+    { "+proj=utm +zone=33 +south +units=m +ellps=intl +towgs84=-87,-98,-121,0,0,0,0 +no_defs",
+      ProjectionKernel::TransverseMercator, 15, -30, 4, 50 },
+    { "+proj=tmerc +lat_0=0 +lon_0=10 +k_0=1 +x_0=0 +y_0=0 +over +a=3396190 +b=3396190 +no_defs",
+      ProjectionKernel::TransverseMercator, 10, 0, 20, 85 },
+    { "+proj=eqc +lat_ts=30 +lat_0=10 +lon_0=100 +x_0=5 +y_0=7 +datum=WGS84 +no_defs",
+      ProjectionKernel::Equirectangular, 100, 10, 60, 70 },
+    { "+proj=merc +lon_0=0 +k=1 +x_0=0 +y_0=0 +datum=WGS84 +units=m +no_defs",
+      ProjectionKernel::Mercator, 0, 0, 179, 85 },
+    { "+proj=merc +lat_ts=33 +lon_0=120 +x_0=1000 +y_0=0 +ellps=GRS80 +no_defs +over",
+      ProjectionKernel::Mercator, 120, 0, 170, 80 },
+    { "+proj=stere +lat_0=90 +lat_ts=70 +lon_0=-45 +k=1 +x_0=0 +y_0=0 +datum=WGS84 +units=m +no_defs",
+      ProjectionKernel::PolarStereographic, -45, 75, 180, 15 },
+    { "+proj=stere +lat_0=-90 +lon_0=0 +k=0.994 +x_0=2000000 +y_0=2000000 +a=1737400 +b=1737400 +no_defs",
+      ProjectionKernel::PolarStereographic, 0, -75, 180, 15 }
+  };
+
+  const size_t NUM_KERNEL_CASES = sizeof(KERNEL_CASES) / sizeof(KERNEL_CASES[0]);
+
+  // A reproducible spread of points over the area of a case
+  Vector2 sample_lonlat(KernelCase const& c, int i) {
+    double u = std::fmod(i * 0.6180339887498949, 1.0) * 2 - 1;
+    double v = std::fmod(i * 0.7548776662466927, 1.0) * 2 - 1;
+    return Vector2(c.lon + u * c.dlon, std::max(-89.9, std::min(89.9, c.lat + v * c.dlat)));
+  }
+
+}
+
+TEST( ProjectionKernel, Selection ) {
+  for (size_t i = 0; i < NUM_KERNEL_CASES; ++i)
+    EXPECT_EQ(KERNEL_CASES[i].type, ProjectionKernel(KERNEL_CASES[i].proj4_str).type()) << KERNEL_CASES[i].proj4_str;
+
+  // Projections and parameters the kernel leaves to Proj.4
+  EXPECT_FALSE(ProjectionKernel("+proj=sinu +lon_0=0 +x_0=0 +y_0=0 +datum=WGS84 +no_defs").is_valid());
+  EXPECT_FALSE(ProjectionKernel("+proj=stere +lat_0=45 +lon_0=0 +k=1 +datum=WGS84 +no_defs").is_valid());
+  EXPECT_FALSE(ProjectionKernel("+proj=utm +zone=13 +units=km +datum=WGS84 +no_defs").is_valid());
+  EXPECT_FALSE(ProjectionKernel("+proj=tmerc +lon_0=10 +pm=paris +datum=WGS84 +no_defs").is_valid());
+  EXPECT_FALSE(ProjectionKernel("+proj=tmerc +lon_0=10 +datum=unknown +no_defs").is_valid());
+  EXPECT_FALSE(ProjectionKernel("+proj=tmerc +lon_0=ten +datum=WGS84 +no_defs").is_valid());
+  EXPECT_FALSE(ProjectionKernel("").is_valid());
+}
+
+TEST( ProjectionKernel, KnownValues ) {
+  struct Known { const char* proj4_str; Vector2 lonlat, point; };
+  const Known known[] = {
+    { "+proj=utm +zone=13 +units=m +datum=WGS84 +no_defs",
+      Vector2(-104.5, 40.25), Vector2(542523.885869, 4455625.261065) },
+    { "+proj=stere +lat_0=-90 +lat_ts=-71 +lon_0=0 +k=1 +x_0=0 +y_0=0 +datum=WGS84 +units=m +no_defs",
+      Vector2(120.0, -75.5), Vector2(1371423.259764, -791791.588198) },
+    { "+proj=merc +lat_ts=33 +lon_0=120 +x_0=1000 +y_0=0 +ellps=GRS80 +no_defs",
+      Vector2(135.0, 60.0), Vector2(1402798.221199, 7020523.160214) },
+    { "+proj=eqc +lat_ts=30 +lat_0=10 +lon_0=100 +x_0=5 +y_0=7 +datum=WGS84 +no_defs",
+      Vector2(110.0, -20.0), Vector2(964060.069633, -3339577.723798) }
+  };
+  for (size_t i = 0; i < sizeof(known)/sizeof(known[0]); ++i) {
+    ProjectionKernel kernel(known[i].proj4_str);
+    Vector2 point, lonlat;
+    kernel.forward(&known[i].lonlat, &point, 1);
+    EXPECT_VECTOR_NEAR(known[i].point, point, 1e-5);
+    kernel.inverse(&known[i].point, &lonlat, 1);
+    EXPECT_VECTOR_NEAR(known[i].lonlat, lonlat, 1e-10);
+  }
+}
+
+TEST( ProjectionKernel, MatchesProj ) {
+  for (size_t c = 0; c < NUM_KERNEL_CASES; ++c) {
+    KernelCase const& kc = KERNEL_CASES[c];
+    ProjectionKernel kernel(kc.proj4_str);
+    ProjContext proj(kc.proj4_str);
+
+    std::vector<Vector2> lonlats, points;
+    for (int i = 0; i < 500; ++i) {
+      lonlats.push_back(sample_lonlat(kc, i));
+      projLP lp;
+      lp.u = lonlats.back()[0] * DEG_TO_RAD;
+      lp.v = lonlats.back()[1] * DEG_TO_RAD;
+      projXY xy = pj_fwd(lp, proj.proj_ptr());
+      points.push_back(Vector2(xy.u, xy.v));
+    }
+
+    // Sub-millimeter agreement both ways
+    std::vector<Vector2> result(lonlats.size());
+    kernel.forward(&lonlats[0], &result[0], lonlats.size());
+    for (size_t i = 0; i < lonlats.size(); ++i)
+      EXPECT_VECTOR_NEAR(points[i], result[i], 1e-4) << kc.proj4_str << " at " << lonlats[i];
+    kernel.inverse(&points[0], &result[0], points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+      projXY xy;
+      xy.u = points[i][0];
+      xy.v = points[i][1];
+      projLP lp = pj_inv(xy, proj.proj_ptr());
+      EXPECT_NEAR(lp.v * RAD_TO_DEG, result[i][1], 1e-9) << kc.proj4_str << " at " << points[i];
+      EXPECT_NEAR(0, math::degree_diff(lp.u * RAD_TO_DEG, result[i][0]), 1e-9) << kc.proj4_str << " at " << points[i];
+    }
+  }
+}
+
+TEST( ProjectionKernel, TransverseMercatorRange ) {
+  // On an ellipsoid the kernel stops where its series and Proj.4's part,
+  // and leaves the points past that to Proj.4.
+  const char* proj4_str = "+proj=utm +zone=13 +units=m +datum=WGS84 +no_defs";
+  ProjectionKernel kernel(proj4_str);
+  ProjContext proj(proj4_str);
+  for (int lat = -80; lat <= 80; lat += 5) {
+    for (int side = -1; side <= 1; side += 2) {
+      Vector2 inside(-105 + side * 3.999, lat), outside(-105 + side * 4.001, lat), point;
+      kernel.forward(&inside, &point, 1);
+      projLP lp;
+      lp.u = inside[0] * DEG_TO_RAD;
+      lp.v = inside[1] * DEG_TO_RAD;
+      projXY xy = pj_fwd(lp, proj.proj_ptr());
+      EXPECT_VECTOR_NEAR(Vector2(xy.u, xy.v), point, 1e-4) << inside;
+      kernel.forward(&outside, &point, 1);
+      EXPECT_TRUE(point[0] != point[0]) << outside;
+    }
+  }
+}
+
+TEST( ProjectionKernel, GeoReferenceBatches ) {
+  GeoReference georef;
+  georef.set_well_known_geogcs("WGS84");
+  georef.set_UTM(13);
+  Matrix3x3 affine = math::identity_matrix<3>();
+  affine(0,0) =  30;
+  affine(1,1) = -30;
+  affine(0,2) = 500000;
+  affine(1,2) = 4500000;
+  georef.set_transform(affine);
+
+  // Rows of pixels, some of which are too far from the central meridian
+  // for the kernel and go through Proj.4 instead.
+  std::vector<Vector2> pixels;
+  for (int i = 0; i < 150; ++i)
+    pixels.push_back(Vector2(i * 1000.0 - 20000, i * 37.0));
+  std::vector<Vector2> lonlats(pixels.size()), back;
+  georef.pixel_to_lonlat(&pixels[0], &lonlats[0], pixels.size());
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    Vector2 expected = georef.pixel_to_lonlat(pixels[i]);
+    EXPECT_EQ(expected[0], lonlats[i][0]);
+    EXPECT_EQ(expected[1], lonlats[i][1]);
+  }
+  EXPECT_GT(std::fabs(lonlats.back()[0] + 105), 35);
+
+  // In place
+  back = lonlats;
+  georef.lonlat_to_pixel(&back[0], &back[0], back.size());
+  for (size_t i = 0; i < back.size(); ++i) {
+    Vector2 expected = georef.lonlat_to_pixel(lonlats[i]);
+    EXPECT_EQ(expected[0], back[i][0]);
+    EXPECT_EQ(expected[1], back[i][1]);
+    if (std::fabs(lonlats[i][0] + 105) < 30) {
+      EXPECT_VECTOR_NEAR(pixels[i], back[i], 1e-3);
+    }
+  }
+}
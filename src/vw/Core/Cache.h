@@ -171,6 +171,12 @@ namespace vw {
       /// Constructor with a CacheLine object
       Handle( boost::shared_ptr<CacheLine<GeneratorT> > line_ptr ) : m_line_ptr(line_ptr), m_is_locked(false) {}
 
+      /// Copies refer to the same Cacheline object but don't share the
+      /// lock, so each copy must release what it locks.  Threads that
+      /// share a handle should each use their own copy.
+      Handle( Handle const& other ) : m_line_ptr(other.m_line_ptr), m_is_locked(false) {}
+      Handle& operator=( Handle const& other );
+
       /// Destructor - release the Cacheline object
       ~Handle();
       
@@ -98,7 +98,14 @@ typename Cache::CacheLine<GeneratorT>::value_type const& Cache::CacheLine<Genera
 
     //TODO: Why allocate and then generate?
     m_generation_count++; // Update stats
-    m_value = core::detail::pointerish(m_generator)->generate();
+    try {
+      m_value = core::detail::pointerish(m_generator)->generate();
+    } catch ( ... ) {
+      // Leave the line empty and unlocked so a later access can try again
+      CacheLineBase::deallocate();
+      m_mutex.unlock();
+      throw;
+    }
     // Downgrade from exclusive access down to shared access
     m_mutex.unlock_and_lock_upgrade();
     m_mutex.unlock_upgrade_and_lock_shared();
@@ -133,26 +140,39 @@ Cache::Handle<GeneratorT>::~Handle() {
     m_line_ptr->release();
 }
 
+template <class GeneratorT>
+Cache::Handle<GeneratorT>& Cache::Handle<GeneratorT>::operator=( Handle const& other ) {
+  if (this == &other)
+    return *this;
+  if (m_is_locked)
+    release();
+  m_line_ptr = other.m_line_ptr;
+  return *this;
+}
+
 template <class GeneratorT>
 boost::shared_ptr<typename Cache::Handle<GeneratorT>::value_type> Cache::Handle<GeneratorT>::operator->() const {
   VW_ASSERT( m_line_ptr, NullPtrErr() << "Invalid cache handle!" );
+  boost::shared_ptr<value_type> result = m_line_ptr->value(); // Locked once this returns
   m_is_locked = true;
-  return m_line_ptr->value();
+  return result;
 }
 
 template <class GeneratorT>
 typename Cache::Handle<GeneratorT>::value_type const& Cache::Handle<GeneratorT>::operator*() const {
   VW_ASSERT( m_line_ptr, NullPtrErr() << "Invalid cache handle!" );
+  value_type const& result = *(m_line_ptr->value()); // Locked once this returns
   m_is_locked = true;
-  return *(m_line_ptr->value());
+  return result;
 }
 
 // TODO: Can we delete this?
 template <class GeneratorT>
 Cache::Handle<GeneratorT>::operator boost::shared_ptr<value_type>() const {
   VW_ASSERT( m_line_ptr, NullPtrErr() << "Invalid cache handle!" );
+  boost::shared_ptr<value_type> result = m_line_ptr->value(); // Locked once this returns
   m_is_locked = true;
-  return m_line_ptr->value();
+  return result;
 }
 
 template <class GeneratorT>
@@ -347,6 +347,9 @@ namespace vw {
     UnaryCompoundFunctor() : func() {}
     UnaryCompoundFunctor( FuncT const& func ) : func(func) {}
 
+    /// The functor applied to each channel
+    FuncT const& channel_functor() const { return func; }
+
     template <class ArgsT> struct result {};
 
     template <class F, class ArgT>
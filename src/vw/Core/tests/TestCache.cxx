@@ -249,6 +249,85 @@ TEST(Cache, Stats) {
   EXPECT_EQ(0u, cache.evictions());
 }
 
+TEST(Cache, HandleCopies) {
+  typedef Cache::Handle<BlockGenerator> handle_t;
+
+  // Cache can hold 1 item. A locked line is never evicted.
+  vw::Cache cache(sizeof(handle_t::value_type));
+
+  handle_t h[3] = {
+    cache.insert(BlockGenerator(1, 0)),
+    cache.insert(BlockGenerator(1, 1)),
+    cache.insert(BlockGenerator(1, 2))};
+
+  // A copy of a locked handle doesn't share its lock, so destroying
+  // the copy leaves the line locked until the original releases it.
+  EXPECT_EQ(0, *h[0]);
+  {
+    handle_t copy( h[0] );
+    EXPECT_TRUE( copy.attached() );
+  }
+  EXPECT_EQ(1, *h[1]);
+  EXPECT_EQ(0u, cache.evictions());
+  EXPECT_NO_THROW( h[1].release() );
+  EXPECT_NO_THROW( h[0].release() );
+  EXPECT_TRUE( h[0].valid() );
+
+  // A copy releases what it locks when it is destroyed.
+  {
+    handle_t copy( h[0] );
+    EXPECT_EQ(0, *copy);
+  }
+  EXPECT_EQ(2, *h[2]);
+  EXPECT_FALSE( h[0].valid() );
+  EXPECT_FALSE( h[1].valid() );
+  EXPECT_NO_THROW( h[2].release() );
+
+  // Assigning to a locked handle releases the line it held.
+  handle_t other( h[0] );
+  EXPECT_EQ(0, *other);
+  other = h[1];
+  EXPECT_EQ(2, *h[2]);
+  EXPECT_FALSE( h[0].valid() );
+  EXPECT_NO_THROW( h[2].release() );
+}
+
+// Fails the first time it is asked to generate
+class FlakyGenerator : public BlockGenerator {
+  boost::shared_ptr<int> m_calls;
+public:
+  FlakyGenerator( vw::uint8 fill_value ) : BlockGenerator(1, fill_value), m_calls(new int(0)) {}
+  boost::shared_ptr< value_type > generate() const {
+    if ( (*m_calls)++ == 0 )
+      vw_throw( IOErr() << "FlakyGenerator: first try fails." );
+    return BlockGenerator::generate();
+  }
+};
+
+TEST(Cache, GeneratorErrors) {
+  typedef Cache::Handle<FlakyGenerator> handle_t;
+
+  // Cache can hold 2 items
+  vw::Cache cache(2*sizeof(handle_t::value_type));
+  handle_t h[2] = {
+    cache.insert(FlakyGenerator(0)),
+    cache.insert(FlakyGenerator(1))};
+
+  // A failed generation leaves the line empty and unlocked, so it can
+  // be tried again, and gives back its share of the cache size.
+  EXPECT_THROW( *h[0], IOErr );
+  EXPECT_FALSE( h[0].valid() );
+  EXPECT_EQ(0, *h[0]);
+  EXPECT_NO_THROW( h[0].release() );
+
+  EXPECT_THROW( *h[1], IOErr );
+  EXPECT_EQ(1, *h[1]);
+  EXPECT_NO_THROW( h[1].release() );
+  EXPECT_TRUE( h[0].valid() );
+  EXPECT_TRUE( h[1].valid() );
+  EXPECT_EQ(0u, cache.evictions());
+}
+
 // Here's a more aggressive test that uses many threads plus a good
 // chunk of memory (24k).
 class ArrayDataGenerator {
@@ -162,7 +162,7 @@ void DstMemoryImageResourceGDAL::write( ImageBuffer const& src, BBox2i const& bb
     convert(dst, src, true);
   }
 
-  m_data->write(buf.get(), bufsize, width, height, planes);
+  m_data->write(buf.get(), bufsize, height, width, planes);
 }
 
 const uint8* DstMemoryImageResourceGDAL::data() const {
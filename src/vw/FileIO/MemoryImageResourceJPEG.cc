@@ -129,7 +129,7 @@ void DstMemoryImageResourceJPEG::write( ImageBuffer const& src, BBox2i const& bb
     convert(dst, src, true);
   }
 
-  m_data->write(buf.get(), bufsize, width, height, planes);
+  m_data->write(buf.get(), bufsize, height, width, planes);
 }
 
 const uint8* DstMemoryImageResourceJPEG::data() const {
@@ -148,7 +148,7 @@ void DstMemoryImageResourcePNG::write( ImageBuffer const& src, BBox2i const& bbo
     convert(dst, src, true);
   }
 
-  m_data->write(buf.get(), bufsize, width, height, planes);
+  m_data->write(buf.get(), bufsize, height, width, planes);
 }
 
 const uint8* DstMemoryImageResourcePNG::data() const {
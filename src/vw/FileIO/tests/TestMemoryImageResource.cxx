@@ -93,9 +93,10 @@ TEST_P(MemoryImageResourceTest, BasicWriteRead) {
 
   {
     typedef PixelRGBA<float> Py;
-    const size_t SIZE = 64;
-    ImageView<Py> src_(SIZE,SIZE);
-    for (size_t row = 0; row < SIZE; ++row) {
+    // not square, so that swapped dimensions show up
+    const size_t SIZE = 64, ROWS = 40;
+    ImageView<Py> src_(SIZE,ROWS);
+    for (size_t row = 0; row < ROWS; ++row) {
       for (size_t col = 0; col < SIZE; ++col) {
         src_(col, row) =
           Py(float(row)/SIZE, float(col)/SIZE, 1 - ((float(row) + col) / 2 / SIZE), 1);
@@ -130,7 +130,7 @@ namespace vw {
       BBox2i child_bbox = bbox;
       child_bbox.max() += Vector2i( m_reduce_amt - 1,
                                     m_reduce_amt - 1 );
-      ImageView<pixel_type> src_buf = edge_extend(m_image,child_bbox,ZeroEdgeExtension());
+      CropView<ImageView<pixel_type> > src_buf = edge_extend_buffer(m_image,child_bbox,ZeroEdgeExtension());
 
       ImageView<sum_type> work( bbox.width(), bbox.height() + m_reduce_amt - 1 );
       ImageView<int32> count( bbox.width(), bbox.height() + m_reduce_amt - 1 );
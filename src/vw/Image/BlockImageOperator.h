@@ -40,6 +40,9 @@
 #include <vw/Image/Manipulation.h>
 #include <vw/Image/BlockProcessor.h>
 
+#include <exception>
+#include <map>
+
 namespace vw {
 
   /// A wrapper view that processes the input image in blocks.
@@ -157,6 +160,123 @@ namespace vw {
     block_op.execute_func(bounding_box(image));
   }
 
+
+  namespace image_block {
+
+    /// Runs a copy of an accumulator over each block of an image and
+    /// merges the partial results back in block order. Used by reduce_blocks().
+    /// The first exception thrown by a block is kept for the caller to
+    /// rethrow, and the blocks after it are skipped.
+    template <class ImageT, class AccumT>
+    class ReduceFunctor {
+      ImageT const& m_image;
+      AccumT const& m_prototype;
+      AccumT      & m_result;
+      Vector2i      m_block_size;
+      BBox2i        m_bbox;
+      int32         m_blocks_per_row;
+      Mutex       & m_mutex;
+      // Partials that finished ahead of an earlier block
+      std::map<size_t, boost::shared_ptr<AccumT> > & m_pending;
+      size_t      & m_next_block;
+      std::exception_ptr & m_error;
+
+    public:
+      ReduceFunctor( ImageT const& image, AccumT const& prototype, AccumT& result,
+                     Vector2i const& block_size, BBox2i const& bbox, Mutex& mutex,
+                     std::map<size_t, boost::shared_ptr<AccumT> >& pending, size_t& next_block,
+                     std::exception_ptr& error )
+        : m_image(image), m_prototype(prototype), m_result(result),
+          m_block_size(block_size), m_bbox(bbox),
+          m_blocks_per_row((bbox.width() + block_size.x() - 1) / block_size.x()),
+          m_mutex(mutex), m_pending(pending), m_next_block(next_block), m_error(error) {}
+
+      void operator()( BBox2i const& bbox ) const {
+        {
+          Mutex::Lock lock( m_mutex );
+          if ( m_error )
+            return;
+        }
+        boost::shared_ptr<AccumT> partial;
+        try {
+          ImageView<typename ImageT::pixel_type> buffer( bbox.width(), bbox.height(), m_image.planes() );
+          m_image.rasterize( buffer, bbox );
+
+          partial.reset( new AccumT( m_prototype ) );
+          typedef typename ImageView<typename ImageT::pixel_type>::pixel_type* ptr_type;
+          ptr_type end = buffer.data() + size_t(buffer.cols()) * buffer.rows() * buffer.planes();
+          for ( ptr_type pix = buffer.data(); pix != end; ++pix )
+            (*partial)( *pix );
+        } catch ( ... ) {
+          Mutex::Lock lock( m_mutex );
+          if ( !m_error )
+            m_error = std::current_exception();
+          return;
+        }
+
+        size_t index = size_t( (bbox.min().y() - m_bbox.min().y()) / m_block_size.y() ) * m_blocks_per_row
+                     + size_t( (bbox.min().x() - m_bbox.min().x()) / m_block_size.x() );
+        Mutex::Lock lock( m_mutex );
+        if ( m_error )
+          return;
+        try {
+          m_pending[index] = partial;
+          typename std::map<size_t, boost::shared_ptr<AccumT> >::iterator it;
+          while ( (it = m_pending.find( m_next_block )) != m_pending.end() ) {
+            m_result.merge( *it->second );
+            m_pending.erase( it );
+            m_next_block++;
+          }
+        } catch ( ... ) {
+          m_error = std::current_exception();
+        }
+      }
+    };
+
+  } // namespace image_block
+
+  /// Applies an accumulator to every pixel of an image, one block at
+  /// a time and in parallel.
+  /// - Each block is rasterized into a contiguous buffer and run
+  ///   through its own copy of the accumulator. The copies start out
+  ///   as copies of the input accumulator, so it should be empty.
+  /// - The partial results are merged into accumulator with
+  ///   AccumT::merge(AccumT const&) in block order, so the result
+  ///   does not depend on the thread count.
+  /// - No more threads are started than there are blocks, and an image
+  ///   of one block is reduced on the calling thread.
+  /// - An exception thrown while rasterizing or accumulating a block is
+  ///   rethrown here once the threads have finished.
+  template <class ViewT, class AccumT>
+  void reduce_blocks( ImageViewBase<ViewT> const& view, AccumT& accumulator,
+                      Vector2i const& block_size = Vector2i(256,256), int num_threads = 0 ) {
+    BBox2i bbox = bounding_box( view );
+    if ( bbox.empty() )
+      return;
+    AccumT prototype( accumulator );
+    Mutex mutex;
+    std::map<size_t, boost::shared_ptr<AccumT> > pending;
+    size_t next_block = 0;
+    std::exception_ptr error;
+
+    int64 num_blocks = int64( (bbox.width()  + block_size.x() - 1) / block_size.x() ) *
+                       int64( (bbox.height() + block_size.y() - 1) / block_size.y() );
+    if ( num_threads <= 0 )
+      num_threads = vw_settings().default_num_threads();
+    if ( num_blocks < num_threads )
+      num_threads = int( num_blocks );
+
+    // Blocks are aligned to the top left of the image so that they
+    // can be numbered.
+    image_block::ReduceFunctor<ViewT, AccumT> func( view.impl(), prototype, accumulator, block_size,
+                                                    bbox, mutex, pending, next_block, error );
+    image_block::BlockProcessor<image_block::ReduceFunctor<ViewT, AccumT> >
+      processor( func, block_size, num_threads );
+    processor( bbox );
+    if ( error )
+      std::rethrow_exception( error );
+  }
+
 } // namespace vw
 
 #endif // __VW_IMAGE_BLOCKIMAGEOPERATOR_H__
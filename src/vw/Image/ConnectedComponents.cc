@@ -0,0 +1,287 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file ConnectedComponents.cc
+///
+
+#include <vw/Core/Log.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Image/ConnectedComponents.h>
+
+#include <exception>
+#include <utility>
+
+namespace vw {
+namespace components_p {
+
+namespace {
+
+  // Union-find over labels. The root of a set is always its smallest
+  // label, which keeps the final numbering independent of the order
+  // the unions happen in.
+  inline uint32 find_root( std::vector<uint32>& parent, uint32 x ) {
+    uint32 root = x;
+    while ( parent[root] != root )
+      root = parent[root];
+    while ( parent[x] != root ) { // Path compression
+      uint32 next = parent[x];
+      parent[x] = root;
+      x = next;
+    }
+    return root;
+  }
+
+  inline void unite( std::vector<uint32>& parent, uint32 a, uint32 b ) {
+    a = find_root( parent, a );
+    b = find_root( parent, b );
+    if ( a < b )
+      parent[b] = a;
+    else if ( b < a )
+      parent[a] = b;
+  }
+
+}
+
+uint32 label_tile( ImageView<uint8> const& valid, ImageView<uint32>& labels ) {
+  const int32 cols = valid.cols(), rows = valid.rows();
+  labels.set_size( cols, rows );
+
+  // First pass: provisional labels, merging them where a pixel
+  // touches more than one.
+  std::vector<uint32> parent( 1, 0 );
+  for ( int32 row = 0; row < rows; ++row ) {
+    uint8 const* v = &valid( 0, row );
+    uint32* l = &labels( 0, row );
+    uint32 const* above = row > 0 ? &labels( 0, row - 1 ) : 0;
+    for ( int32 col = 0; col < cols; ++col ) {
+      if ( !v[col] ) {
+        l[col] = 0;
+        continue;
+      }
+      uint32 label = 0;
+      uint32 neighbors[4] = { col > 0 ? l[col-1] : 0,
+                              above && col > 0 ? above[col-1] : 0,
+                              above ? above[col] : 0,
+                              above && col + 1 < cols ? above[col+1] : 0 };
+      for ( int i = 0; i < 4; ++i ) {
+        if ( !neighbors[i] )
+          continue;
+        if ( !label )
+          label = neighbors[i];
+        else if ( neighbors[i] != label )
+          unite( parent, label, neighbors[i] );
+      }
+      if ( !label ) {
+        label = uint32( parent.size() );
+        parent.push_back( label );
+      }
+      l[col] = label;
+    }
+  }
+
+  // Second pass: number the sets in order of their first pixel
+  std::vector<uint32> final_label( parent.size(), 0 );
+  uint32 count = 0;
+  for ( int32 row = 0; row < rows; ++row ) {
+    uint32* l = &labels( 0, row );
+    for ( int32 col = 0; col < cols; ++col ) {
+      if ( !l[col] )
+        continue;
+      uint32 root = find_root( parent, l[col] );
+      if ( !final_label[root] )
+        final_label[root] = ++count;
+      l[col] = final_label[root];
+    }
+  }
+  return count;
+}
+
+void TileSummary::summarize( ImageView<uint32> const& labels, uint32 label_count ) {
+  const int32 cols = labels.cols(), rows = labels.rows();
+  count = label_count;
+  top.assign( &labels( 0, 0 ), &labels( 0, 0 ) + cols );
+  bottom.assign( &labels( 0, rows - 1 ), &labels( 0, rows - 1 ) + cols );
+  left.resize( rows );
+  right.resize( rows );
+  for ( int32 row = 0; row < rows; ++row ) {
+    left[row]  = labels( 0, row );
+    right[row] = labels( cols - 1, row );
+  }
+
+  sizes.assign( count, 0 );
+  bboxes.assign( count, BBox2i() );
+  for ( int32 row = 0; row < rows; ++row )
+    for ( int32 col = 0; col < cols; ++col ) {
+      uint32 l = labels( col, row );
+      if ( !l )
+        continue;
+      sizes[l-1]++;
+      bboxes[l-1].grow( BBox2i( bbox.min().x() + col, bbox.min().y() + row, 1, 1 ) );
+    }
+}
+
+namespace {
+
+  typedef std::vector<std::pair<uint32,uint32> > pair_list;
+
+  inline void add_pair( pair_list& pairs, uint32 a, uint32 b ) {
+    std::pair<uint32,uint32> p( a, b );
+    if ( pairs.empty() || pairs.back() != p )
+      pairs.push_back( p );
+  }
+
+  // Finds the labels that touch across the right and bottom edges of
+  // a tile, including the corners shared with the tiles diagonally
+  // below it. The first exception is kept for merge() to rethrow.
+  class EdgeMergeTask : public Task, private boost::noncopyable {
+    std::vector<TileSummary> const& m_tiles;
+    Vector2i m_grid;
+    int32 m_tx, m_ty;
+    pair_list& m_pairs;
+    Mutex& m_mutex;
+    std::exception_ptr& m_error;
+  public:
+    EdgeMergeTask( std::vector<TileSummary> const& tiles, Vector2i const& grid,
+                   int32 tx, int32 ty, pair_list& pairs,
+                   Mutex& mutex, std::exception_ptr& error )
+      : m_tiles(tiles), m_grid(grid), m_tx(tx), m_ty(ty), m_pairs(pairs),
+        m_mutex(mutex), m_error(error) {}
+
+    TileSummary const& tile( int32 tx, int32 ty ) const { return m_tiles[ ty * m_grid.x() + tx ]; }
+
+    void operator()() {
+      try {
+        find_pairs();
+      } catch ( ... ) {
+        Mutex::Lock lock( m_mutex );
+        if ( !m_error )
+          m_error = std::current_exception();
+      }
+    }
+
+    void find_pairs() {
+      TileSummary const& a = tile( m_tx, m_ty );
+      if ( m_tx + 1 < m_grid.x() ) {
+        TileSummary const& b = tile( m_tx + 1, m_ty );
+        int32 h = int32( a.right.size() );
+        for ( int32 r = 0; r < h; ++r ) {
+          if ( !a.right[r] )
+            continue;
+          for ( int32 r2 = std::max( 0, r - 1 ); r2 <= std::min( h - 1, r + 1 ); ++r2 )
+            if ( b.left[r2] )
+              add_pair( m_pairs, a.first + a.right[r] - 1, b.first + b.left[r2] - 1 );
+        }
+      }
+      if ( m_ty + 1 < m_grid.y() ) {
+        TileSummary const& c = tile( m_tx, m_ty + 1 );
+        int32 w = int32( a.bottom.size() );
+        for ( int32 i = 0; i < w; ++i ) {
+          if ( !a.bottom[i] )
+            continue;
+          for ( int32 i2 = std::max( 0, i - 1 ); i2 <= std::min( w - 1, i + 1 ); ++i2 )
+            if ( c.top[i2] )
+              add_pair( m_pairs, a.first + a.bottom[i] - 1, c.first + c.top[i2] - 1 );
+        }
+        if ( m_tx + 1 < m_grid.x() ) {
+          TileSummary const& d = tile( m_tx + 1, m_ty + 1 );
+          if ( a.bottom.back() && d.top.front() )
+            add_pair( m_pairs, a.first + a.bottom.back() - 1, d.first + d.top.front() - 1 );
+        }
+        if ( m_tx > 0 ) {
+          TileSummary const& e = tile( m_tx - 1, m_ty + 1 );
+          if ( a.bottom.front() && e.top.back() )
+            add_pair( m_pairs, a.first + a.bottom.front() - 1, e.first + e.top.back() - 1 );
+        }
+      }
+    }
+  };
+
+}
+} // namespace components_p
+
+void ConnectedComponents::merge( int32 num_threads ) {
+  using namespace components_p;
+
+  // Provisional labels are the local labels of all tiles in tile order
+  uint32 total = 0;
+  for ( size_t i = 0; i < m_tiles.size(); ++i ) {
+    m_tiles[i].first = total;
+    total += m_tiles[i].count;
+  }
+
+  // Collect the labels that meet across tile edges
+  std::vector<pair_list> pairs( m_tiles.size() );
+  Mutex mutex;
+  std::exception_ptr error;
+  {
+    FifoWorkQueue queue( num_threads );
+    for ( int32 ty = 0; ty < m_tile_grid.y(); ++ty )
+      for ( int32 tx = 0; tx < m_tile_grid.x(); ++tx ) {
+        boost::shared_ptr<Task> task( new EdgeMergeTask( m_tiles, m_tile_grid, tx, ty,
+                                                         pairs[ ty * m_tile_grid.x() + tx ],
+                                                         mutex, error ) );
+        queue.add_task( task );
+      }
+    queue.join_all();
+  }
+  if ( error )
+    std::rethrow_exception( error );
+
+  std::vector<uint32> parent( total );
+  for ( uint32 i = 0; i < total; ++i )
+    parent[i] = i;
+  for ( size_t t = 0; t < pairs.size(); ++t )
+    for ( size_t i = 0; i < pairs[t].size(); ++i )
+      unite( parent, pairs[t][i].first, pairs[t][i].second );
+
+  // Roots are the smallest member of each set, so they are numbered
+  // before anything that refers to them.
+  m_final.assign( total, 0 );
+  m_sizes.assign( 1, 0 );
+  m_bboxes.assign( 1, BBox2i() );
+  for ( size_t t = 0; t < m_tiles.size(); ++t ) {
+    TileSummary& tile = m_tiles[t];
+    for ( uint32 l = 0; l < tile.count; ++l ) {
+      uint32 id = tile.first + l;
+      uint32 root = find_root( parent, id );
+      if ( root == id ) {
+        m_final[id] = uint32( m_sizes.size() );
+        m_sizes.push_back( 0 );
+        m_bboxes.push_back( BBox2i() );
+      } else {
+        m_final[id] = m_final[root];
+      }
+      m_sizes[ m_final[id] ] += tile.sizes[l];
+      m_bboxes[ m_final[id] ].grow( tile.bboxes[l] );
+    }
+
+    // Only the label offset is needed from here on
+    std::vector<uint32>().swap( tile.top );
+    std::vector<uint32>().swap( tile.bottom );
+    std::vector<uint32>().swap( tile.left );
+    std::vector<uint32>().swap( tile.right );
+    std::vector<uint64>().swap( tile.sizes );
+    std::vector<BBox2i>().swap( tile.bboxes );
+  }
+
+  vw_out(DebugMessage,"image") << "ConnectedComponents: " << total << " tile labels merged into "
+                               << num_components() << " components.\n";
+}
+
+} // namespace vw
@@ -0,0 +1,313 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file ConnectedComponents.h
+///
+/// Tiled labeling of the 8-connected components of the valid pixels
+/// of an image, for images too large to hold in memory.
+///
+/// Labeling takes two passes over the source.
+///
+/// - The ConnectedComponents constructor labels each tile on its own
+///   with a union-find, in parallel. It keeps only the labels along
+///   the tile edges and the size and bounding box of each local
+///   component. The edges of neighboring tiles are then compared, also
+///   in parallel, and components that touch across an edge are merged.
+///   The result maps every local label to a final label.
+///
+/// - component_labels() returns a view that labels a tile again and
+///   looks up the final labels. Block rasterizing it with the same
+///   tile size writes out the label image one tile at a time. Pixels
+///   read one at a time come from a cached row of labeled tiles.
+///
+/// Neither pass holds more than one tile of the source per thread, so
+/// both work over a DiskImageView of any size. Components are
+/// numbered from 1 in the order their first pixel appears in tile
+/// order; invalid pixels get label 0.
+///
+#ifndef __VW_IMAGE_CONNECTED_COMPONENTS_H__
+#define __VW_IMAGE_CONNECTED_COMPONENTS_H__
+
+#include <vw/Core/Settings.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Math/BBox.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelAccessors.h>
+#include <vw/Image/PixelMask.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <exception>
+#include <vector>
+
+namespace vw {
+
+  /// \cond INTERNAL
+  namespace components_p {
+
+    // Labels the 8-connected components of the nonzero pixels of
+    // valid from 1, in raster order of their first pixel. Returns the
+    // number of components.
+    uint32 label_tile( ImageView<uint8> const& valid, ImageView<uint32>& labels );
+
+    // Writes 1 to valid where src is valid and 0 elsewhere.
+    template <class SourceT>
+    void valid_pixels( SourceT const& src, ImageView<uint8>& valid ) {
+      valid.set_size( src.cols(), src.rows() );
+      typename SourceT::pixel_accessor srow = src.origin();
+      for ( int32 row = 0; row < src.rows(); ++row ) {
+        typename SourceT::pixel_accessor scol = srow;
+        uint8* v = &valid( 0, row );
+        for ( int32 col = 0; col < src.cols(); ++col ) {
+          v[col] = is_valid( *scol ) ? 1 : 0;
+          scol.next_col();
+        }
+        srow.next_row();
+      }
+    }
+
+    // What the first pass keeps for a tile
+    struct TileSummary {
+      BBox2i bbox;
+      uint32 first;                       // Provisional label of local label 1
+      uint32 count;                       // Number of local labels
+      std::vector<uint32> top, bottom;    // Local labels along each edge
+      std::vector<uint32> left, right;
+      std::vector<uint64> sizes;          // Pixels per local label
+      std::vector<BBox2i> bboxes;         // Image coordinates
+
+      TileSummary() : first(0), count(0) {}
+      void summarize( ImageView<uint32> const& labels, uint32 count );
+    };
+
+    // The first exception thrown by a tile is kept for the caller to
+    // rethrow, and the tiles after it are skipped.
+    template <class SourceT>
+    class TileLabelTask : public Task, private boost::noncopyable {
+      SourceT const& m_src;
+      TileSummary&   m_summary;
+      Mutex&         m_mutex;
+      std::exception_ptr& m_error;
+    public:
+      TileLabelTask( SourceT const& src, TileSummary& summary,
+                     Mutex& mutex, std::exception_ptr& error )
+        : m_src(src), m_summary(summary), m_mutex(mutex), m_error(error) {}
+
+      void operator()() {
+        {
+          Mutex::Lock lock( m_mutex );
+          if ( m_error )
+            return;
+        }
+        try {
+          ImageView<typename SourceT::pixel_type> tile = crop( m_src, m_summary.bbox );
+          ImageView<uint8> valid;
+          valid_pixels( tile, valid );
+          ImageView<uint32> labels;
+          uint32 count = label_tile( valid, labels );
+          m_summary.summarize( labels, count );
+        } catch ( ... ) {
+          Mutex::Lock lock( m_mutex );
+          if ( !m_error )
+            m_error = std::current_exception();
+        }
+      }
+    };
+  }
+  /// \endcond
+
+  /// The connected components of the valid pixels of an image, found
+  /// one tile at a time.  See ConnectedComponents.h.
+  class ConnectedComponents : private boost::noncopyable {
+    int32 m_tile_size;
+    Vector2i m_image_size, m_tile_grid;
+    std::vector<components_p::TileSummary> m_tiles;
+    std::vector<uint32> m_final;     // Provisional label -> final label
+    std::vector<uint64> m_sizes;     // Indexed by final label
+    std::vector<BBox2i> m_bboxes;
+
+    // Merges across tile edges and assigns the final labels
+    void merge( int32 num_threads );
+
+  public:
+    /// Labels src.  Pixels are valid as defined by is_valid(), so plain
+    /// pixels are always valid and masked pixels are valid when not
+    /// masked.
+    template <class SourceT>
+    ConnectedComponents( ImageViewBase<SourceT> const& src,
+                         int32 tile_size   = vw_settings().default_tile_size(),
+                         int32 num_threads = vw_settings().default_num_threads() )
+      : m_tile_size(tile_size), m_image_size( src.impl().cols(), src.impl().rows() ) {
+      VW_ASSERT( tile_size > 0, ArgumentErr() << "ConnectedComponents: tile_size must be positive." );
+      VW_ASSERT( src.impl().planes() == 1,
+                 NoImplErr() << "ConnectedComponents only works with single plane images." );
+      m_tile_grid = Vector2i( ( m_image_size.x() + tile_size - 1 ) / tile_size,
+                              ( m_image_size.y() + tile_size - 1 ) / tile_size );
+      m_tiles.resize( m_tile_grid.x() * m_tile_grid.y() );
+      for ( int32 ty = 0; ty < m_tile_grid.y(); ++ty )
+        for ( int32 tx = 0; tx < m_tile_grid.x(); ++tx ) {
+          BBox2i bbox( tx * tile_size, ty * tile_size, tile_size, tile_size );
+          bbox.crop( BBox2i( 0, 0, m_image_size.x(), m_image_size.y() ) );
+          m_tiles[ ty * m_tile_grid.x() + tx ].bbox = bbox;
+        }
+
+      typedef components_p::TileLabelTask<SourceT> task_type;
+      Mutex mutex;
+      std::exception_ptr error;
+      {
+        FifoWorkQueue queue( num_threads );
+        for ( size_t i = 0; i < m_tiles.size(); ++i ) {
+          boost::shared_ptr<Task> task( new task_type( src.impl(), m_tiles[i], mutex, error ) );
+          queue.add_task( task );
+        }
+        queue.join_all();
+      }
+      if ( error )
+        std::rethrow_exception( error );
+      merge( num_threads );
+    }
+
+    /// Number of components.  Labels run from 1 to num_components().
+    uint32 num_components() const { return uint32( m_sizes.size() ) - 1; }
+
+    /// Number of pixels in a component
+    uint64 size( uint32 label ) const { return m_sizes[label]; }
+
+    /// Bounding box of a component
+    BBox2i const& bounding_box( uint32 label ) const { return m_bboxes[label]; }
+
+    int32 tile_size() const { return m_tile_size; }
+    int32 cols() const { return m_image_size.x(); }
+    int32 rows() const { return m_image_size.y(); }
+
+    /// Final label of a local label of the tile whose top left corner
+    /// is at (tile_size*tx, tile_size*ty).  Local label 0 maps to 0.
+    uint32 label( int32 tx, int32 ty, uint32 local ) const {
+      if ( local == 0 )
+        return 0;
+      return m_final[ m_tiles[ ty * m_tile_grid.x() + tx ].first + local - 1 ];
+    }
+  };
+
+  /// The second labeling pass.  Each tile of the source is labeled
+  /// again and its labels replaced by the final labels.  Rasterize it in
+  /// blocks aligned to the tile size of the ConnectedComponents,
+  /// otherwise tiles are labeled more than once.  Pixels read one at a
+  /// time, as through the pixel accessor, are looked up in the labeled
+  /// tiles of the last row of tiles read, which the copies of the view
+  /// share, so reading in raster order labels each tile once.  The view
+  /// keeps a reference to the ConnectedComponents, which must outlive it.
+  template <class SourceT>
+  class ComponentLabelView : public ImageViewBase<ComponentLabelView<SourceT> > {
+    SourceT m_src;
+    ConnectedComponents const& m_components;
+
+    // The tiles of one row of tiles, labeled as pixels are read from them
+    struct RowCache {
+      Mutex mutex;
+      int32 ty;
+      std::vector<ImageView<uint32> > tiles;
+      RowCache() : ty(-1) {}
+    };
+    boost::shared_ptr<RowCache> m_cache;
+
+    // The final labels of the tile at (tx,ty)
+    ImageView<uint32> tile_labels( int32 tx, int32 ty ) const {
+      const int32 size = m_components.tile_size();
+      BBox2i tile_bbox( tx * size, ty * size, size, size );
+      tile_bbox.crop( BBox2i( 0, 0, cols(), rows() ) );
+      ImageView<typename SourceT::pixel_type> tile = crop( m_src, tile_bbox );
+      ImageView<uint8> valid;
+      components_p::valid_pixels( tile, valid );
+      ImageView<uint32> labels;
+      components_p::label_tile( valid, labels );
+      for ( int32 row = 0; row < labels.rows(); ++row )
+        for ( int32 col = 0; col < labels.cols(); ++col )
+          labels( col, row ) = m_components.label( tx, ty, labels( col, row ) );
+      return labels;
+    }
+
+  public:
+    typedef uint32 pixel_type;
+    typedef uint32 result_type;
+    typedef ProceduralPixelAccessor<ComponentLabelView> pixel_accessor;
+
+    ComponentLabelView( SourceT const& src, ConnectedComponents const& components )
+      : m_src(src), m_components(components), m_cache( new RowCache ) {
+      VW_ASSERT( src.cols() == components.cols() && src.rows() == components.rows(),
+                 ArgumentErr() << "ComponentLabelView: the image does not match its components." );
+    }
+
+    inline int32 cols  () const { return m_src.cols(); }
+    inline int32 rows  () const { return m_src.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+
+    inline result_type operator()( int32 i, int32 j, int32 /*p*/=0 ) const {
+      const int32 size = m_components.tile_size();
+      const int32 tx = i / size, ty = j / size;
+      Mutex::Lock lock( m_cache->mutex );
+      if ( m_cache->ty != ty ) {
+        m_cache->tiles.clear();
+        m_cache->tiles.resize( ( cols() + size - 1 ) / size );
+        m_cache->ty = ty;
+      }
+      ImageView<uint32>& labels = m_cache->tiles[tx];
+      if ( !labels.is_valid_image() )
+        labels = tile_labels( tx, ty );
+      return labels( i - tx * size, j - ty * size );
+    }
+
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      ImageView<pixel_type> result( bbox.width(), bbox.height() );
+      const int32 size = m_components.tile_size();
+      for ( int32 ty = bbox.min().y() / size; ty * size < bbox.max().y(); ++ty )
+        for ( int32 tx = bbox.min().x() / size; tx * size < bbox.max().x(); ++tx ) {
+          BBox2i tile_bbox( tx * size, ty * size, size, size );
+          tile_bbox.crop( BBox2i( 0, 0, cols(), rows() ) );
+          ImageView<uint32> labels = tile_labels( tx, ty );
+
+          BBox2i overlap = tile_bbox;
+          overlap.crop( bbox );
+          crop( result, overlap - bbox.min() ) = crop( labels, overlap - tile_bbox.min() );
+        }
+      return prerasterize_type( result, -bbox.min().x(), -bbox.min().y(), cols(), rows() );
+    }
+
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+  };
+
+  /// Returns the label image of src.  components must have been
+  /// computed from the same image.
+  template <class SourceT>
+  ComponentLabelView<SourceT>
+  component_labels( ImageViewBase<SourceT> const& src, ConnectedComponents const& components ) {
+    return ComponentLabelView<SourceT>( src.impl(), components );
+  }
+
+} // namespace vw
+
+#endif // __VW_IMAGE_CONNECTED_COMPONENTS_H__
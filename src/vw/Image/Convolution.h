@@ -28,11 +28,19 @@
 #include <vector>
 #include <iterator>
 
+#include <boost/type_traits/is_arithmetic.hpp>
+#include <boost/type_traits/is_integral.hpp>
+#include <boost/type_traits/integral_constant.hpp>
+
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Manipulation.h>
 #include <vw/Image/EdgeExtension.h>
 #include <vw/Image/PixelMask.h>
 
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+  #include <emmintrin.h>
+#endif
+
 namespace vw {
 
   // *******************************************************************
@@ -160,9 +168,11 @@ namespace vw {
                        bbox.width () + (m_kernel.cols()-1), 
                        bbox.height() + (m_kernel.rows()-1) );
       // Take an edge extended image view of the input support region
-      ImageView<typename ImageT::pixel_type> src = edge_extend( m_image, src_bbox, m_edge );
+      CropView<ImageView<typename ImageT::pixel_type> > src = edge_extend_buffer( m_image, src_bbox, m_edge );
       // Use the crop trick to fake that the support region is the same size as the entire image.
-      return prerasterize_type( crop( src, -src_bbox.min().x(), -src_bbox.min().y(), m_image.cols(), m_image.rows() ),
+      return prerasterize_type( CropView<ImageView<typename ImageT::pixel_type> >(
+                                  src.child(), src.col_offset() - src_bbox.min().x(),
+                                  src.row_offset() - src_bbox.min().y(), m_image.cols(), m_image.rows() ),
                                 m_kernel.child(), m_ci, m_cj, NoEdgeExtension() );
     }
 
@@ -172,6 +182,422 @@ namespace vw {
   };
 
 
+  // *******************************************************************
+  // Row based separable convolution
+  // *******************************************************************
+
+  /// \cond INTERNAL
+
+  // These are used by SeparableConvolutionView to convolve contiguous
+  // image buffers. Pixels are treated as flat arrays of channels, so
+  // a horizontal tap is a fixed offset of num_channels and a vertical
+  // tap a fixed offset of one row. Both passes then reduce to adding
+  // scaled copies of contiguous rows into an accumulator row, which
+  // the compiler (or the SSE code below) can vectorize.
+  namespace convolution_p {
+
+    /// True if pixels can be processed as flat arrays of channels: no
+    /// mask, arithmetic channels and no padding.
+    template <class PixelT, class KernelT>
+    struct IsRowConvolvable {
+      typedef typename CompoundChannelType<PixelT>::type channel_type;
+      static const bool value = !IsMasked<PixelT>::value &&
+                                boost::is_arithmetic<channel_type>::value &&
+                                boost::is_arithmetic<KernelT>::value &&
+                                sizeof(PixelT) == CompoundNumChannels<PixelT>::value * sizeof(channel_type);
+      typedef boost::integral_constant<bool, value> type;
+    };
+
+    /// A 1D kernel in correlation order, with the properties that
+    /// select the specialized code paths.
+    /// - box: integer channels and all taps equal, handled with running
+    ///   sums. These are exact, and integers have no NaN or Inf which
+    ///   would stay in the sum.
+    /// - symmetric: the taps are mirrored, so pairs of inputs are added
+    ///   before they are multiplied.
+    /// - exact_int: 8 and 16 bit channels with a kernel whose taps are
+    ///   integers times a power of two (binomial, Sobel, ...). These
+    ///   are summed in int32 and give the same result as the floating
+    ///   point sum.
+    template <class ChannelT, class KernelT>
+    struct RowKernel {
+      std::vector<KernelT> taps;
+      std::vector<int32>   int_taps;
+      int32 shift;
+      bool box, symmetric, exact_int;
+
+      RowKernel( std::vector<KernelT> const& kernel )
+        : taps( kernel.rbegin(), kernel.rend() ), shift(0),
+          box(false), symmetric(false), exact_int(false) {
+        size_t n = taps.size();
+        if ( n >= 3 ) {
+          box = symmetric = true;
+          for ( size_t t = 0; t < n; ++t ) {
+            box       = box       && taps[t] == taps[0];
+            symmetric = symmetric && taps[t] == taps[n-1-t];
+          }
+          box = box && boost::is_integral<ChannelT>::value;
+        }
+        if ( boost::is_integral<ChannelT>::value && sizeof(ChannelT) <= 2 )
+          find_integer_taps();
+      }
+
+    private:
+      void find_integer_taps() {
+        // Keep sums below 2^24, where float sums are also exact.
+        const double max_input = std::max( double(std::numeric_limits<ChannelT>::max()),
+                                           -double(std::numeric_limits<ChannelT>::min()) );
+        for ( shift = 0; shift <= 16; ++shift ) {
+          double scale = double(1 << shift), total = 0;
+          bool integral = true;
+          for ( size_t t = 0; t < taps.size() && integral; ++t ) {
+            double tap = double(taps[t]) * scale;
+            integral = tap == std::floor(tap);
+            total += std::fabs(tap);
+          }
+          if ( !integral )
+            continue;
+          if ( total * max_input >= double(1 << 24) )
+            return;
+          int_taps.resize( taps.size() );
+          for ( size_t t = 0; t < taps.size(); ++t )
+            int_taps[t] = int32( double(taps[t]) * scale );
+          exact_int = true;
+          return;
+        }
+      }
+    };
+
+    // acc[j] = k * in[j]
+    template <class AccT, class ChannelT>
+    inline void multiply_row( AccT* acc, ChannelT const* in, AccT k, size_t n ) {
+      for ( size_t j = 0; j < n; ++j )
+        acc[j] = k * AccT(in[j]);
+    }
+
+    // acc[j] += k * in[j]
+    template <class AccT, class ChannelT>
+    inline void multiply_add_row( AccT* acc, ChannelT const* in, AccT k, size_t n ) {
+      for ( size_t j = 0; j < n; ++j )
+        acc[j] += k * AccT(in[j]);
+    }
+
+    // acc[j] += k * (in1[j] + in2[j])
+    template <class AccT, class ChannelT>
+    inline void multiply_add_rows( AccT* acc, ChannelT const* in1, ChannelT const* in2, AccT k, size_t n ) {
+      for ( size_t j = 0; j < n; ++j )
+        acc[j] += k * ( AccT(in1[j]) + AccT(in2[j]) );
+    }
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+    // The multiply and add are kept separate, so these give the same
+    // results as the loops above.
+    inline void multiply_add_row( float* acc, float const* in, float k, size_t n ) {
+      size_t j = 0;
+      __m128 kk = _mm_set1_ps( k );
+      for ( ; j + 4 <= n; j += 4 )
+        _mm_storeu_ps( acc+j, _mm_add_ps( _mm_loadu_ps(acc+j), _mm_mul_ps( kk, _mm_loadu_ps(in+j) ) ) );
+      for ( ; j < n; ++j )
+        acc[j] += k * in[j];
+    }
+
+    inline void multiply_add_row( double* acc, double const* in, double k, size_t n ) {
+      size_t j = 0;
+      __m128d kk = _mm_set1_pd( k );
+      for ( ; j + 2 <= n; j += 2 )
+        _mm_storeu_pd( acc+j, _mm_add_pd( _mm_loadu_pd(acc+j), _mm_mul_pd( kk, _mm_loadu_pd(in+j) ) ) );
+      for ( ; j < n; ++j )
+        acc[j] += k * in[j];
+    }
+
+    inline void multiply_add_row( double* acc, float const* in, double k, size_t n ) {
+      size_t j = 0;
+      __m128d kk = _mm_set1_pd( k );
+      for ( ; j + 4 <= n; j += 4 ) {
+        __m128 v = _mm_loadu_ps( in+j );
+        __m128d lo = _mm_cvtps_pd( v ), hi = _mm_cvtps_pd( _mm_movehl_ps( v, v ) );
+        _mm_storeu_pd( acc+j,   _mm_add_pd( _mm_loadu_pd(acc+j),   _mm_mul_pd( kk, lo ) ) );
+        _mm_storeu_pd( acc+j+2, _mm_add_pd( _mm_loadu_pd(acc+j+2), _mm_mul_pd( kk, hi ) ) );
+      }
+      for ( ; j < n; ++j )
+        acc[j] += k * double(in[j]);
+    }
+
+    inline void multiply_add_rows( float* acc, float const* in1, float const* in2, float k, size_t n ) {
+      size_t j = 0;
+      __m128 kk = _mm_set1_ps( k );
+      for ( ; j + 4 <= n; j += 4 ) {
+        __m128 sum = _mm_add_ps( _mm_loadu_ps(in1+j), _mm_loadu_ps(in2+j) );
+        _mm_storeu_ps( acc+j, _mm_add_ps( _mm_loadu_ps(acc+j), _mm_mul_ps( kk, sum ) ) );
+      }
+      for ( ; j < n; ++j )
+        acc[j] += k * ( in1[j] + in2[j] );
+    }
+
+    inline void multiply_add_rows( double* acc, double const* in1, double const* in2, double k, size_t n ) {
+      size_t j = 0;
+      __m128d kk = _mm_set1_pd( k );
+      for ( ; j + 2 <= n; j += 2 ) {
+        __m128d sum = _mm_add_pd( _mm_loadu_pd(in1+j), _mm_loadu_pd(in2+j) );
+        _mm_storeu_pd( acc+j, _mm_add_pd( _mm_loadu_pd(acc+j), _mm_mul_pd( kk, sum ) ) );
+      }
+      for ( ; j < n; ++j )
+        acc[j] += k * ( in1[j] + in2[j] );
+    }
+#endif // VW_ENABLE_SSE
+
+    // out[j] = acc[j], clamped for integer channels
+    template <class ChannelT, class AccT>
+    inline void store_row( AccT const* acc, size_t n, int32 /*shift*/, ChannelT* out ) {
+      for ( size_t j = 0; j < n; ++j )
+        out[j] = channel_cast_clamp_if_int<ChannelT>( acc[j] );
+    }
+
+    // Fixed point version. Truncates towards zero like the cast of a
+    // floating point sum would.
+    template <class ChannelT>
+    inline void store_row( int32 const* acc, size_t n, int32 shift, ChannelT* out ) {
+      for ( size_t j = 0; j < n; ++j ) {
+        int32 value = acc[j] >= 0 ? ( acc[j] >> shift ) : -( (-acc[j]) >> shift );
+        out[j] = channel_cast_clamp_if_int<ChannelT>( value );
+      }
+    }
+
+    /// out[j] = sum_t taps[t] * in[j + t*tap_stride] for j < len. The
+    /// rows are processed in chunks so that the accumulators stay in
+    /// the L1 cache.
+    template <class AccT, class TapT, class ChannelT>
+    void correlate_rows( ChannelT const* in, ptrdiff_t tap_stride, size_t len,
+                         std::vector<TapT> const& taps, bool symmetric, int32 shift,
+                         ChannelT* out ) {
+      const size_t chunk = 512;
+      AccT acc[chunk];
+      size_t n = taps.size();
+      for ( size_t start = 0; start < len; start += chunk ) {
+        size_t count = std::min( chunk, len - start );
+        ChannelT const* src = in + start;
+        if ( symmetric ) {
+          size_t half = n / 2;
+          if ( n % 2 )
+            multiply_row( acc, src + half*tap_stride, AccT(taps[half]), count );
+          else
+            std::fill( acc, acc + count, AccT() );
+          for ( size_t t = 0; t < half; ++t )
+            multiply_add_rows( acc, src + t*tap_stride, src + (n-1-t)*tap_stride,
+                               AccT(taps[t]), count );
+        } else {
+          multiply_row( acc, src, AccT(taps[0]), count );
+          for ( size_t t = 1; t < n; ++t )
+            multiply_add_row( acc, src + t*tap_stride, AccT(taps[t]), count );
+        }
+        store_row( acc, count, shift, out + start );
+      }
+    }
+
+    template <class ChannelT, class KernelT>
+    void correlate_rows( ChannelT const* in, ptrdiff_t tap_stride, size_t len,
+                         RowKernel<ChannelT,KernelT> const& kernel, ChannelT* out ) {
+      typedef typename ProductType<ChannelT, KernelT>::type acc_type;
+      if ( kernel.exact_int )
+        correlate_rows<int32>( in, tap_stride, len, kernel.int_taps, kernel.symmetric, kernel.shift, out );
+      else
+        correlate_rows<acc_type>( in, tap_stride, len, kernel.taps, kernel.symmetric, 0, out );
+    }
+
+    /// Box filter along rows, with one running sum per channel.
+    template <class ChannelT, class KernelT>
+    void box_filter_row( ChannelT const* in, size_t num_channels, size_t width,
+                         RowKernel<ChannelT,KernelT> const& kernel, ChannelT* out ) {
+      size_t n = kernel.taps.size();
+      double k = kernel.taps[0];
+      for ( size_t c = 0; c < num_channels; ++c ) {
+        ChannelT const* src = in + c;
+        ChannelT* dst = out + c;
+        double sum = 0;
+        for ( size_t t = 0; t < n; ++t )
+          sum += src[t*num_channels];
+        dst[0] = channel_cast_clamp_if_int<ChannelT>( k * sum );
+        for ( size_t x = 1; x < width; ++x ) {
+          sum += double(src[(x+n-1)*num_channels]) - double(src[(x-1)*num_channels]);
+          dst[x*num_channels] = channel_cast_clamp_if_int<ChannelT>( k * sum );
+        }
+      }
+    }
+
+    /// Box filter down columns, with a running sum row. Input rows are
+    /// in_stride channels apart.
+    template <class ChannelT, class KernelT>
+    void box_filter_columns( ChannelT const* in, ptrdiff_t in_stride, size_t row_len, size_t height,
+                             RowKernel<ChannelT,KernelT> const& kernel, ChannelT* out ) {
+      size_t n = kernel.taps.size();
+      double k = kernel.taps[0];
+      std::vector<double> sum( row_len, 0.0 );
+      for ( size_t t = 0; t < n; ++t )
+        multiply_add_row( &sum[0], in + t*in_stride, 1.0, row_len );
+      for ( size_t y = 0; y < height; ++y ) {
+        if ( y > 0 ) {
+          ChannelT const* add = in + (y+n-1)*in_stride;
+          ChannelT const* sub = in + (y-1)*in_stride;
+          for ( size_t j = 0; j < row_len; ++j )
+            sum[j] += double(add[j]) - double(sub[j]);
+        }
+        ChannelT* dst = out + y*row_len;
+        for ( size_t j = 0; j < row_len; ++j )
+          dst[j] = channel_cast_clamp_if_int<ChannelT>( k * sum[j] );
+      }
+    }
+
+    /// Distance between the rows of a view in memory, in channels.
+    /// The sources below are an ImageView or a crop of one.
+    template <class SrcT>
+    inline ptrdiff_t channel_row_stride( SrcT const& src ) {
+      typedef typename SrcT::pixel_type pixel_type;
+      typedef typename CompoundChannelType<pixel_type>::type channel_type;
+      ptrdiff_t pixels = src.rows() > 1 ? &src(0,1) - &src(0,0) : src.cols();
+      return pixels * ptrdiff_t( sizeof(pixel_type) / sizeof(channel_type) );
+    }
+
+    /// Horizontal pass. dest is narrower than src by the kernel size - 1.
+    template <class SrcT, class PixelT, class KernelT>
+    void convolve_rows( SrcT const& src, ImageView<PixelT> const& dest,
+                        RowKernel<typename CompoundChannelType<PixelT>::type, KernelT> const& kernel ) {
+      typedef typename CompoundChannelType<PixelT>::type channel_type;
+      const size_t num_channels = CompoundNumChannels<PixelT>::value;
+      for ( int32 p = 0; p < dest.planes(); ++p )
+        for ( int32 y = 0; y < dest.rows(); ++y ) {
+          channel_type const* in = reinterpret_cast<channel_type const*>( &src(0,y,p) );
+          channel_type* out = reinterpret_cast<channel_type*>( &dest(0,y,p) );
+          if ( kernel.box )
+            box_filter_row( in, num_channels, dest.cols(), kernel, out );
+          else
+            correlate_rows( in, num_channels, dest.cols()*num_channels, kernel, out );
+        }
+    }
+
+    /// Vertical pass. dest is shorter than src by the kernel size - 1.
+    template <class SrcT, class PixelT, class KernelT>
+    void convolve_columns( SrcT const& src, ImageView<PixelT> const& dest,
+                           RowKernel<typename CompoundChannelType<PixelT>::type, KernelT> const& kernel ) {
+      typedef typename CompoundChannelType<PixelT>::type channel_type;
+      const size_t row_len = dest.cols() * CompoundNumChannels<PixelT>::value;
+      const ptrdiff_t in_stride = channel_row_stride( src );
+      for ( int32 p = 0; p < dest.planes(); ++p ) {
+        channel_type const* in = reinterpret_cast<channel_type const*>( &src(0,0,p) );
+        channel_type* out = reinterpret_cast<channel_type*>( &dest(0,0,p) );
+        if ( kernel.box ) {
+          box_filter_columns( in, in_stride, row_len, dest.rows(), kernel, out );
+          continue;
+        }
+        for ( int32 y = 0; y < dest.rows(); ++y )
+          correlate_rows( in + y*in_stride, in_stride, row_len, kernel, out + y*row_len );
+      }
+    }
+
+    /// Convolves an edge extended buffer with separable kernels. Either
+    /// kernel may be empty. src is an ImageView or a crop of one, as
+    /// returned by edge_extend_buffer().
+    template <class SrcT, class PixelT, class KernelT>
+    void separable_convolve( SrcT const& src, ImageView<PixelT> const& dest,
+                             std::vector<KernelT> const& i_kernel,
+                             std::vector<KernelT> const& j_kernel ) {
+      typedef RowKernel<typename CompoundChannelType<PixelT>::type, KernelT> kernel_type;
+      if ( dest.cols() == 0 || dest.rows() == 0 || dest.planes() == 0 )
+        return;
+      if ( !i_kernel.empty() && !j_kernel.empty() ) {
+        ImageView<PixelT> work( dest.cols(), src.rows(), dest.planes() );
+        convolve_rows( src, work, kernel_type( i_kernel ) );
+        convolve_columns( work, dest, kernel_type( j_kernel ) );
+      }
+      else if ( !i_kernel.empty() )
+        convolve_rows( src, dest, kernel_type( i_kernel ) );
+      else
+        convolve_columns( src, dest, kernel_type( j_kernel ) );
+    }
+
+    /// out[x] = sum_t taps[t] * in[(factor*x + t)*num_channels] for
+    /// every channel, summed in the same order as correlate_rows.
+    template <class AccT, class TapT, class ChannelT>
+    void correlate_row_decimated( ChannelT const* in, size_t num_channels, size_t width,
+                                  size_t factor, std::vector<TapT> const& taps, bool symmetric,
+                                  int32 shift, ChannelT* out ) {
+      const size_t n = taps.size(), half = n / 2;
+      for ( size_t x = 0; x < width; ++x )
+        for ( size_t c = 0; c < num_channels; ++c ) {
+          ChannelT const* src = in + x*factor*num_channels + c;
+          AccT acc;
+          if ( symmetric ) {
+            acc = ( n % 2 ) ? AccT(taps[half]) * AccT(src[half*num_channels]) : AccT();
+            for ( size_t t = 0; t < half; ++t )
+              acc += AccT(taps[t]) * ( AccT(src[t*num_channels]) + AccT(src[(n-1-t)*num_channels]) );
+          } else {
+            acc = AccT(taps[0]) * AccT(src[0]);
+            for ( size_t t = 1; t < n; ++t )
+              acc += AccT(taps[t]) * AccT(src[t*num_channels]);
+          }
+          store_row( &acc, 1, shift, out + x*num_channels + c );
+        }
+    }
+
+    /// Convolves an edge extended buffer with separable kernels and
+    /// keeps every factor-th pixel. Pixel (x,y) of dest is pixel
+    /// (factor*x,factor*y) of what separable_convolve would give with
+    /// a dest of the full resolution, so src must be factor*(size-1) +
+    /// kernel size pixels across. Only the kept pixels are computed.
+    template <class SrcT, class PixelT, class KernelT>
+    void separable_convolve_decimated( SrcT const& src, ImageView<PixelT> const& dest,
+                                       std::vector<KernelT> const& i_kernel,
+                                       std::vector<KernelT> const& j_kernel, int32 factor ) {
+      typedef typename CompoundChannelType<PixelT>::type channel_type;
+      typedef typename ProductType<channel_type, KernelT>::type acc_type;
+      typedef RowKernel<channel_type, KernelT> kernel_type;
+      const size_t num_channels = CompoundNumChannels<PixelT>::value;
+      if ( dest.cols() == 0 || dest.rows() == 0 || dest.planes() == 0 )
+        return;
+      kernel_type ik( i_kernel ), jk( j_kernel );
+
+      // Running sums don't skip, so box kernels go the long way
+      if ( i_kernel.empty() || j_kernel.empty() || ik.box || jk.box ) {
+        ImageView<PixelT> full( src.cols() - ( i_kernel.empty() ? 0 : int32(i_kernel.size()) - 1 ),
+                                src.rows() - ( j_kernel.empty() ? 0 : int32(j_kernel.size()) - 1 ),
+                                dest.planes() );
+        separable_convolve( src, full, i_kernel, j_kernel );
+        for ( int32 p = 0; p < dest.planes(); ++p )
+          for ( int32 y = 0; y < dest.rows(); ++y )
+            for ( int32 x = 0; x < dest.cols(); ++x )
+              dest( x, y, p ) = full( factor*x, factor*y, p );
+        return;
+      }
+
+      // Horizontal pass at the kept columns only. Every source row
+      // feeds some kept row unless the kernel is shorter than the
+      // factor, so all rows go through it.
+      ImageView<PixelT> work( dest.cols(), src.rows(), dest.planes() );
+      for ( int32 p = 0; p < dest.planes(); ++p )
+        for ( int32 y = 0; y < src.rows(); ++y ) {
+          channel_type const* in = reinterpret_cast<channel_type const*>( &src(0,y,p) );
+          channel_type* out = reinterpret_cast<channel_type*>( &work(0,y,p) );
+          if ( ik.exact_int )
+            correlate_row_decimated<int32>( in, num_channels, dest.cols(), factor,
+                                            ik.int_taps, ik.symmetric, ik.shift, out );
+          else
+            correlate_row_decimated<acc_type>( in, num_channels, dest.cols(), factor,
+                                               ik.taps, ik.symmetric, 0, out );
+        }
+
+      const size_t row_len = dest.cols() * num_channels;
+      for ( int32 p = 0; p < dest.planes(); ++p ) {
+        channel_type const* in = reinterpret_cast<channel_type const*>( &work(0,0,p) );
+        channel_type* out = reinterpret_cast<channel_type*>( &dest(0,0,p) );
+        for ( int32 y = 0; y < dest.rows(); ++y )
+          correlate_rows( in + y*factor*row_len, row_len, row_len, jk, out + y*row_len );
+      }
+    }
+
+  } // namespace convolution_p
+
+  /// \endcond
+
+
   // *******************************************************************
   // The separable 2D convolution view type
   // *******************************************************************
@@ -266,10 +692,9 @@ namespace vw {
                                                           m_image.cols(), m_image.rows()) );
     }
 
-    // In principle we could avoid rasterizing the child first if it's
-    // MultiplyAccessible.  In practice that turns out to be a pain to
-    // get right, and convolution is generally a much more expensive
-    // operation than a single extra copy.
+    // The child is rasterized first unless its pixels are already in
+    // memory, in which case tiles away from the image edges read them
+    // in place.  See edge_extend_buffer().
     template <class DestT>
     void rasterize( DestT const& dest, BBox2i const& bbox ) const {
       size_t ni = m_i_kernel.size(), 
@@ -280,11 +705,33 @@ namespace vw {
       BBox2i child_bbox = bbox;
       child_bbox.min() -= Vector2i( int32(ni?(ni-m_ci-1):0), int32(nj?(nj-m_cj-1):0) );
       child_bbox.max() += Vector2i( int32(ni?m_ci:0), int32(nj?m_cj:0) );
-      ImageView<typename ImageT::pixel_type> src_buf = edge_extend(m_image,child_bbox,m_edge);
+      convolve_buffer( edge_extend_buffer(m_image,child_bbox,m_edge), dest,
+                       typename convolution_p::IsRowConvolvable<pixel_type,KernelT>::type() );
+    }
+
+    /// Plain pixels are convolved row by row in contiguous buffers.
+    void convolve_buffer( CropView<ImageView<pixel_type> > const& src_buf, ImageView<pixel_type> const& dest,
+                          boost::true_type ) const {
+      convolution_p::separable_convolve( src_buf, dest, m_i_kernel, m_j_kernel );
+    }
+
+    template <class DestT>
+    void convolve_buffer( CropView<ImageView<pixel_type> > const& src_buf, DestT const& dest,
+                          boost::true_type ) const {
+      ImageView<pixel_type> result( dest.cols(), dest.rows(), dest.planes() );
+      convolution_p::separable_convolve( src_buf, result, m_i_kernel, m_j_kernel );
+      vw::rasterize( result, dest, bounding_box(result) );
+    }
+
+    /// Masked pixels go through the pixel accessors.
+    template <class DestT>
+    void convolve_buffer( CropView<ImageView<pixel_type> > const& src_buf, DestT const& dest,
+                          boost::false_type ) const {
+      size_t ni = m_i_kernel.size(),
+             nj = m_j_kernel.size();
       if( ni>0 && nj>0 ) {
-        ImageView<pixel_type> work( bbox.width(), child_bbox.height(), planes() );
+        ImageView<pixel_type> work( dest.cols(), src_buf.rows(), planes() );
         convolve_1d( src_buf, work, m_i_kernel );
-        src_buf.reset(); // Free up some memory
         convolve_1d( transpose(work), transpose(dest), m_j_kernel );
       }
       else if( ni>0 ) {
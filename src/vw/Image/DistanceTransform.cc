@@ -0,0 +1,198 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file DistanceTransform.cc
+///
+
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Image/DistanceTransform.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <exception>
+#include <limits>
+#include <vector>
+
+namespace vw {
+namespace distance_p {
+
+void column_pass( ImageView<float>& dist, int32 col_begin, int32 col_end,
+                  bool border_features ) {
+  const float inf = std::numeric_limits<float>::infinity();
+  const int32 rows = dist.rows();
+  if ( rows == 0 || col_begin >= col_end )
+    return;
+
+  // Both sweeps run a row at a time over the whole strip so that
+  // memory is read in order.
+  const float outside = border_features ? 0 : inf;
+  float* d = &dist( col_begin, 0 );
+  for ( int32 col = 0; col < col_end - col_begin; ++col )
+    d[col] = ( d[col] == 0 ) ? 0 : outside + 1;
+  for ( int32 row = 1; row < rows; ++row ) {
+    float* above = &dist( col_begin, row - 1 );
+    d = &dist( col_begin, row );
+    for ( int32 col = 0; col < col_end - col_begin; ++col )
+      d[col] = ( d[col] == 0 ) ? 0 : above[col] + 1;
+  }
+
+  d = &dist( col_begin, rows - 1 );
+  for ( int32 col = 0; col < col_end - col_begin; ++col )
+    d[col] = std::min( d[col], outside + 1 );
+  for ( int32 row = rows - 2; row >= 0; --row ) {
+    float* below = &dist( col_begin, row + 1 );
+    d = &dist( col_begin, row );
+    for ( int32 col = 0; col < col_end - col_begin; ++col )
+      d[col] = std::min( d[col], below[col] + 1 );
+  }
+}
+
+void row_pass( ImageView<float>& dist, int32 row_begin, int32 row_end,
+               bool border_features ) {
+  const double inf = std::numeric_limits<double>::infinity();
+  const int32 cols = dist.cols();
+
+  // Squared column distances, the parabolas of the lower envelope and
+  // the boundaries between them.
+  std::vector<double> f( cols );
+  std::vector<int32>  v( cols );
+  std::vector<double> z( cols + 1 );
+
+  for ( int32 row = row_begin; row < row_end; ++row ) {
+    float* d = &dist( 0, row );
+    int32 k = -1;
+    for ( int32 q = 0; q < cols; ++q ) {
+      if ( d[q] == std::numeric_limits<float>::infinity() )
+        continue;
+      f[q] = double(d[q]) * double(d[q]);
+      double s = -inf;
+      while ( k >= 0 ) {
+        s = ( ( f[q] + double(q)*q ) - ( f[v[k]] + double(v[k])*v[k] ) ) / ( 2.0 * ( q - v[k] ) );
+        if ( s > z[k] )
+          break;
+        --k;
+      }
+      ++k;
+      v[k] = q;
+      z[k] = ( k == 0 ) ? -inf : s;
+      z[k+1] = inf;
+    }
+
+    if ( k < 0 ) {
+      for ( int32 q = 0; q < cols; ++q )
+        d[q] = border_features ? float( std::min( q + 1, cols - q ) )
+                               : std::numeric_limits<float>::infinity();
+      continue;
+    }
+
+    int32 j = 0;
+    for ( int32 q = 0; q < cols; ++q ) {
+      while ( z[j+1] < q )
+        ++j;
+      double dq = double(q - v[j]);
+      double d2 = dq*dq + f[v[j]];
+      if ( border_features ) {
+        double edge = std::min( q + 1, cols - q );
+        d2 = std::min( d2, edge*edge );
+      }
+      d[q] = float( std::sqrt( d2 ) );
+    }
+  }
+}
+
+namespace {
+
+  // Runs a pass over the columns or rows [begin,end). The first
+  // exception thrown by a strip is kept for distance_transform() to
+  // rethrow, and the strips after it are skipped.
+  class PassTask : public Task, private boost::noncopyable {
+    typedef void (*pass_type)( ImageView<float>&, int32, int32, bool );
+    pass_type m_pass;
+    ImageView<float>& m_dist;
+    int32 m_begin, m_end;
+    bool m_border_features;
+    Mutex& m_mutex;
+    std::exception_ptr& m_error;
+  public:
+    PassTask( pass_type pass, ImageView<float>& dist, int32 begin, int32 end,
+              bool border_features, Mutex& mutex, std::exception_ptr& error )
+      : m_pass(pass), m_dist(dist), m_begin(begin), m_end(end),
+        m_border_features(border_features), m_mutex(mutex), m_error(error) {}
+
+    void operator()() {
+      {
+        Mutex::Lock lock( m_mutex );
+        if ( m_error )
+          return;
+      }
+      try {
+        m_pass( m_dist, m_begin, m_end, m_border_features );
+      } catch ( ... ) {
+        Mutex::Lock lock( m_mutex );
+        if ( !m_error )
+          m_error = std::current_exception();
+      }
+    }
+  };
+
+}
+
+void distance_transform( ImageView<float>& dist, bool border_features,
+                         int32 num_threads ) {
+  if ( num_threads <= 1 || dist.cols() * dist.rows() < 65536 ) {
+    column_pass( dist, 0, dist.cols(), border_features );
+    row_pass( dist, 0, dist.rows(), border_features );
+    return;
+  }
+
+  // A few strips per thread keeps the threads evenly loaded. Column
+  // strips are kept wide enough that each row read fills cache lines.
+  const int32 strips = 4 * num_threads;
+  Mutex mutex;
+  std::exception_ptr error;
+  {
+    FifoWorkQueue queue( num_threads );
+    int32 width = std::max( int32(16), ( dist.cols() + strips - 1 ) / strips );
+    for ( int32 col = 0; col < dist.cols(); col += width ) {
+      boost::shared_ptr<Task> task( new PassTask( &column_pass, dist, col,
+                                                  std::min( col + width, dist.cols() ),
+                                                  border_features, mutex, error ) );
+      queue.add_task( task );
+    }
+    queue.join_all();
+  }
+  if ( error )
+    std::rethrow_exception( error );
+  {
+    FifoWorkQueue queue( num_threads );
+    int32 height = std::max( int32(1), ( dist.rows() + strips - 1 ) / strips );
+    for ( int32 row = 0; row < dist.rows(); row += height ) {
+      boost::shared_ptr<Task> task( new PassTask( &row_pass, dist, row,
+                                                  std::min( row + height, dist.rows() ),
+                                                  border_features, mutex, error ) );
+      queue.add_task( task );
+    }
+    queue.join_all();
+  }
+  if ( error )
+    std::rethrow_exception( error );
+}
+
+}} // namespace vw::distance_p
@@ -0,0 +1,202 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file DistanceTransform.h
+///
+/// Exact Euclidean distance transforms.
+///
+/// These are the Euclidean counterparts of grassfire(). Each output
+/// pixel is the distance to the nearest pixel whose input value is
+/// zero. Unless ignore_borders is set, the pixels just outside the
+/// image count as zero, so edge pixels have a distance of one.
+///
+/// The transform is separable. A pass down each column finds the
+/// distance to the nearest zero in that column. A pass along each row
+/// then takes the lower envelope of the parabolas through those
+/// distances (Felzenszwalb and Huttenlocher). Both passes are exact
+/// and linear in the number of pixels.
+///
+/// - euclidean_distance_transform() works on a whole image in memory
+///   and splits each pass across threads.
+/// - euclidean_distance_view() is a lazy view that caps distances at a
+///   given maximum. Each tile only needs the input within that
+///   distance, so it can be block rasterized from a DiskImageView
+///   that does not fit in memory.
+///
+#ifndef __VW_IMAGE_DISTANCE_TRANSFORM_H__
+#define __VW_IMAGE_DISTANCE_TRANSFORM_H__
+
+#include <vw/Core/Settings.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelAccessors.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace vw {
+
+  /// \cond INTERNAL
+  namespace distance_p {
+
+    // On input pixels of dist are zero for features and nonzero
+    // elsewhere. Replaces columns [col_begin,col_end) with the
+    // distance to the nearest feature in the same column. If
+    // border_features is set the rows just outside the image are
+    // features. Columns with no feature are set to infinity.
+    void column_pass( ImageView<float>& dist, int32 col_begin, int32 col_end,
+                      bool border_features );
+
+    // Turns the column distances in rows [row_begin,row_end) into
+    // Euclidean distances. If border_features is set the columns just
+    // outside the image are features.
+    void row_pass( ImageView<float>& dist, int32 row_begin, int32 row_end,
+                   bool border_features );
+
+    // Runs both passes over dist, splitting each one across threads.
+    void distance_transform( ImageView<float>& dist, bool border_features,
+                             int32 num_threads );
+
+    // Writes 0 to dist where src is zero and 1 elsewhere.
+    template <class SourceT>
+    void features( SourceT const& src, ImageView<float>& dist,
+                   int32 col0, int32 row0 ) {
+      typedef typename SourceT::pixel_accessor src_accessor;
+      const typename SourceT::pixel_type zero = typename SourceT::pixel_type();
+      src_accessor srow = src.origin();
+      for ( int32 row = 0; row < src.rows(); ++row ) {
+        src_accessor scol = srow;
+        float* d = &dist( col0, row0 + row );
+        for ( int32 col = 0; col < src.cols(); ++col ) {
+          d[col] = ( *scol == zero ) ? 0.0f : 1.0f;
+          scol.next_col();
+        }
+        srow.next_row();
+      }
+    }
+  }
+  /// \endcond
+
+  /// Computes the exact Euclidean distance from each pixel to the
+  /// nearest pixel with zero value. If ignore_borders is not set, the
+  /// borders of the image are treated as zero. Pixels with no zero
+  /// pixel to measure to are set to infinity.
+  template <class SourceT>
+  void euclidean_distance_transform( ImageViewBase<SourceT> const& src, ImageView<float>& dst,
+                                     bool ignore_borders = false,
+                                     int32 num_threads = vw_settings().default_num_threads() ) {
+    int32 cols = src.impl().cols(), rows = src.impl().rows();
+    dst.set_size( cols, rows );
+    // Rasterize the source a strip at a time so that only the output
+    // has to fit in memory.
+    const int32 strip = vw_settings().default_tile_size();
+    for ( int32 row = 0; row < rows; row += strip ) {
+      ImageView<typename SourceT::pixel_type> image =
+        crop( src.impl(), 0, row, cols, std::min( strip, rows - row ) );
+      distance_p::features( image, dst, 0, row );
+    }
+    distance_p::distance_transform( dst, !ignore_borders, num_threads );
+  }
+
+  // Without destination given, return in a newly-created ImageView<float>
+  template <class SourceT>
+  ImageView<float> euclidean_distance_transform( ImageViewBase<SourceT> const& src,
+                                                 bool ignore_borders = false ) {
+    ImageView<float> result;
+    euclidean_distance_transform( src, result, ignore_borders );
+    return result;
+  }
+
+  /// A lazy Euclidean distance transform, capped at max_distance.
+  ///
+  /// A tile is computed from the input within max_distance of it.
+  /// Distances up to max_distance are exact and larger ones are set
+  /// to max_distance.  The cost of a tile grows with
+  /// (tile size + 2*max_distance)^2, so this is meant for distances
+  /// up to about a tile size, such as feathering lengths.
+  template <class ImageT>
+  class EuclideanDistanceView : public ImageViewBase<EuclideanDistanceView<ImageT> > {
+    ImageT m_image;
+    float  m_max_distance;
+    bool   m_ignore_borders;
+  public:
+    typedef float pixel_type;
+    typedef float result_type;
+    typedef ProceduralPixelAccessor<EuclideanDistanceView> pixel_accessor;
+
+    EuclideanDistanceView( ImageT const& image, float max_distance, bool ignore_borders )
+      : m_image(image), m_max_distance(max_distance), m_ignore_borders(ignore_borders) {
+      VW_ASSERT( max_distance >= 0,
+                 ArgumentErr() << "EuclideanDistanceView: max_distance must not be negative." );
+    }
+
+    inline int32 cols  () const { return m_image.cols(); }
+    inline int32 rows  () const { return m_image.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+
+    inline result_type operator()( int32 i, int32 j, int32 /*p*/=0 ) const {
+      return prerasterize( BBox2i( i, j, 1, 1 ) )( i, j );
+    }
+
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      // Nothing further than max_distance away can change the result
+      int32 margin = int32( std::ceil( m_max_distance ) );
+      BBox2i search = bbox;
+      search.expand( margin );
+      BBox2i inside = search;
+      inside.crop( BBox2i( 0, 0, cols(), rows() ) );
+
+      // The margin outside the image holds the zero border
+      ImageView<float> dist( search.width(), search.height() );
+      std::fill( dist.data(), dist.data() + dist.cols() * dist.rows(),
+                 m_ignore_borders ? 1.0f : 0.0f );
+      if ( !inside.empty() ) {
+        ImageView<typename ImageT::pixel_type> image = crop( m_image, inside );
+        distance_p::features( image, dist, inside.min().x() - search.min().x(),
+                              inside.min().y() - search.min().y() );
+      }
+      distance_p::distance_transform( dist, false, 1 );
+
+      ImageView<float> result = crop( dist, bbox - search.min() );
+      for ( int32 row = 0; row < result.rows(); ++row )
+        for ( int32 col = 0; col < result.cols(); ++col )
+          result( col, row ) = std::min( result( col, row ), m_max_distance );
+      return prerasterize_type( result, -bbox.min().x(), -bbox.min().y(), cols(), rows() );
+    }
+
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+  };
+
+  /// Returns a lazy Euclidean distance transform of src that is exact
+  /// up to max_distance and capped there. See EuclideanDistanceView.
+  template <class ImageT>
+  EuclideanDistanceView<ImageT>
+  euclidean_distance_view( ImageViewBase<ImageT> const& src, float max_distance,
+                           bool ignore_borders = false ) {
+    return EuclideanDistanceView<ImageT>( src.impl(), max_distance, ignore_borders );
+  }
+
+} // namespace vw
+
+#endif // __VW_IMAGE_DISTANCE_TRANSFORM_H__
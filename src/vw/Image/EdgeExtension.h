@@ -34,12 +34,17 @@
 ///  - \ref vw::PeriodicEdgeExtension extends an image by repeating it periodically
 ///  - \ref vw::NoEdgeExtension is a special class that can be used to represent no edge extension
 ///
+/// Filters that read a neighborhood around each tile should get it
+/// with \ref vw::edge_extend_buffer, which only copies what it has to.
+///
 #ifndef __VW_IMAGE_EDGEEXTENSION_H__
 #define __VW_IMAGE_EDGEEXTENSION_H__
 
 #include <boost/type_traits.hpp>
 
+#include <vw/Image/ImageView.h>
 #include <vw/Image/ImageViewBase.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Image/PixelAccessors.h>
 #include <vw/Image/SparseImageCheck.h>
 #include <vw/Core/Log.h>
@@ -227,6 +232,91 @@ namespace vw {
     return EdgeExtensionView<ImageT,ConstantEdgeExtension>( v.impl() );
   }
 
+
+  // *******************************************************************
+  // Edge extended tile buffers
+  // *******************************************************************
+
+  /// \cond INTERNAL
+  namespace edge_p {
+
+    // The pixels of view in bbox, if they are in memory. The result is
+    // returned rather than assigned, since assigning to a CropView
+    // writes through it.
+    template <class ViewT, class PixelT>
+    inline CropView<ImageView<PixelT> > memory_region( ViewT const& /*view*/, BBox2i const& /*bbox*/,
+                                                       PixelT const&, bool& found ) {
+      found = false;
+      return CropView<ImageView<PixelT> >( ImageView<PixelT>(), 0, 0, 0, 0 );
+    }
+
+    template <class PixelT>
+    inline CropView<ImageView<PixelT> > memory_region( ImageView<PixelT> const& view, BBox2i const& bbox,
+                                                       PixelT const&, bool& found ) {
+      found = true;
+      return CropView<ImageView<PixelT> >( view, bbox.min().x(), bbox.min().y(),
+                                           bbox.width(), bbox.height() );
+    }
+
+    template <class PixelT>
+    inline CropView<ImageView<PixelT> > memory_region( CropView<ImageView<PixelT> > const& view,
+                                                       BBox2i const& bbox, PixelT const&, bool& found ) {
+      found = true;
+      return CropView<ImageView<PixelT> >( view.child(), view.col_offset() + bbox.min().x(),
+                                           view.row_offset() + bbox.min().y(),
+                                           bbox.width(), bbox.height() );
+    }
+
+  } // namespace edge_p
+  /// \endcond
+
+  /// The pixels of an edge extended image in bbox, in memory, for
+  /// filters that read a neighborhood around each tile.  Pixel (0,0) of
+  /// the result is pixel bbox.min() of the image.
+  ///
+  /// When bbox lies inside the image and the image prerasterizes to
+  /// pixels in memory, as an ImageView or a crop of one does, the
+  /// result refers to those pixels and nothing is copied.  Otherwise
+  /// the part inside the image is rasterized into a new buffer and only
+  /// the pixels outside it go through the edge extension.
+  ///
+  /// The result has the same pixels as ImageView<PixelT>(edge_extend(
+  /// image, bbox, extension)).  It may share memory with the image, so
+  /// it must not be written to.
+  template <class ImageT, class ExtensionT>
+  CropView<ImageView<typename ImageT::pixel_type> >
+  edge_extend_buffer( ImageViewBase<ImageT> const& image, BBox2i const& bbox, ExtensionT const& extension ) {
+    typedef typename ImageT::pixel_type pixel_type;
+    ImageT const& view = image.impl();
+    BBox2i src_bbox = extension.source_bbox( view, bbox );
+    if ( src_bbox.empty() ) src_bbox = BBox2i(0,0,0,0);
+    typename ImageT::prerasterize_type source = view.prerasterize( src_bbox );
+
+    BBox2i inside = bbox;
+    inside.crop( BBox2i( 0, 0, view.cols(), view.rows() ) );
+    bool in_memory;
+    CropView<ImageView<pixel_type> > region = edge_p::memory_region( source, bbox, pixel_type(), in_memory );
+    if ( in_memory && inside == bbox )
+      return region;
+
+    ImageView<pixel_type> buffer( bbox.width(), bbox.height(), view.planes() );
+    if ( !inside.empty() )
+      vw::rasterize( crop( source, inside ), crop( buffer, inside - bbox.min() ),
+                     BBox2i( 0, 0, inside.width(), inside.height() ) );
+    for ( int32 p = 0; p < buffer.planes(); ++p )
+      for ( int32 y = bbox.min().y(); y < bbox.max().y(); ++y ) {
+        bool row_inside = y >= inside.min().y() && y < inside.max().y();
+        for ( int32 x = bbox.min().x(); x < bbox.max().x(); ++x ) {
+          if ( row_inside && x == inside.min().x() ) {
+            x = inside.max().x() - 1;
+            continue;
+          }
+          buffer( x - bbox.min().x(), y - bbox.min().y(), p ) = extension( source, x, y, p );
+        }
+      }
+    return CropView<ImageView<pixel_type> >( buffer, 0, 0, bbox.width(), bbox.height() );
+  }
+
 } // namespace vw
 
 #include "EdgeExtension.tcc"
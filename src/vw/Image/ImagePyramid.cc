@@ -0,0 +1,55 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file ImagePyramid.cc
+///
+
+#include <vw/Image/ImagePyramid.h>
+
+#include <boost/weak_ptr.hpp>
+
+namespace vw {
+namespace pyramid_p {
+
+namespace {
+
+  typedef std::map<std::string, boost::weak_ptr<void> > registry_type;
+
+  // Entries are dropped once they are found dead, so the map only
+  // grows with the number of ids in use.
+  Mutex         registry_mutex;
+  registry_type registry;
+
+}
+
+boost::shared_ptr<void> share_levels( std::string const& key, boost::shared_ptr<void> const& levels ) {
+  Mutex::WriteLock lock( registry_mutex );
+  for ( registry_type::iterator it = registry.begin(); it != registry.end(); ) {
+    if ( it->second.expired() && it->first != key )
+      registry.erase( it++ );
+    else
+      ++it;
+  }
+  boost::shared_ptr<void> existing = registry[key].lock();
+  if ( existing )
+    return existing;
+  registry[key] = levels;
+  return levels;
+}
+
+}} // namespace vw::pyramid_p
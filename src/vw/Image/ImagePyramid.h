@@ -0,0 +1,508 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file ImagePyramid.h
+///
+/// Gaussian image pyramids.
+///
+/// pyramid_reduce() smooths an image and halves it in one step. It
+/// gives the same pixels as
+///
+///   subsample( separable_convolution_filter( image, kernel, kernel, edge ), 2 )
+///
+/// but only computes the pixels that are kept, which is about a third
+/// of the work for the usual five tap kernel.
+///
+/// ImagePyramid builds the levels of a pyramid lazily, a tile at a
+/// time, each level from the tiles of the one above it. Tiles are kept
+/// in a vw::Cache, so a level can be rasterized in any order, by any
+/// number of threads, and asking for it again is cheap. Pyramids that
+/// are given the same id share their tiles, so separate consumers of
+/// one image in a process build its pyramid once. A level that was
+/// saved earlier, for example with block_write_gdal_image(), can be
+/// handed back with set_level() and is read instead of being computed.
+///
+#ifndef __VW_IMAGE_IMAGEPYRAMID_H__
+#define __VW_IMAGE_IMAGEPYRAMID_H__
+
+#include <exception>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include <vw/Core/Cache.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/System.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Image/Convolution.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/Filter.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/ImageViewRef.h>
+#include <vw/Image/Manipulation.h>
+
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace vw {
+
+  // *******************************************************************
+  // pyramid_reduce()
+  // *******************************************************************
+
+  /// Smooths an image with a separable kernel and keeps every other
+  /// pixel.  See pyramid_reduce().
+  template <class ImageT, class KernelT, class EdgeT>
+  class PyramidReduceView : public ImageViewBase<PyramidReduceView<ImageT,KernelT,EdgeT> > {
+    ImageT m_child;
+    std::vector<KernelT> m_kernel;
+    EdgeT m_edge;
+
+  public:
+    typedef typename ImageT::pixel_type pixel_type;
+    typedef pixel_type result_type;
+    typedef ProceduralPixelAccessor<PyramidReduceView> pixel_accessor;
+
+    PyramidReduceView( ImageT const& image, std::vector<KernelT> const& kernel, EdgeT const& edge = EdgeT() )
+      : m_child(image), m_kernel(kernel), m_edge(edge) {
+      VW_ASSERT( !kernel.empty(), ArgumentErr() << "pyramid_reduce: The kernel is empty." );
+    }
+
+    inline int32 cols  () const { return 1 + ( m_child.cols() - 1 ) / 2; }
+    inline int32 rows  () const { return 1 + ( m_child.rows() - 1 ) / 2; }
+    inline int32 planes() const { return m_child.planes(); }
+
+    inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+
+    inline result_type operator()( int32 i, int32 j, int32 p=0 ) const {
+      return prerasterize( BBox2i( i, j, 1, 1 ) )( i, j, p );
+    }
+
+    ImageT const& child() const { return m_child; }
+    std::vector<KernelT> const& kernel() const { return m_kernel; }
+
+    /// \cond INTERNAL
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      ImageView<pixel_type> dest( bbox.width(), bbox.height(), planes() );
+      rasterize( dest, bbox );
+      return prerasterize_type( dest, -bbox.min().x(), -bbox.min().y(), cols(), rows() );
+    }
+
+    template <class DestT>
+    inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      reduce( dest, bbox, typename convolution_p::IsRowConvolvable<pixel_type,KernelT>::type() );
+    }
+
+  private:
+    void reduce( ImageView<pixel_type> const& dest, BBox2i const& bbox, boost::true_type ) const {
+      // Pixel x of the result is centered on pixel 2x of the child
+      const int32 n = int32( m_kernel.size() ), c = ( n - 1 ) / 2;
+      BBox2i src_bbox( 2 * bbox.min().x() - ( n - 1 - c ), 2 * bbox.min().y() - ( n - 1 - c ),
+                       2 * ( bbox.width() - 1 ) + n, 2 * ( bbox.height() - 1 ) + n );
+      convolution_p::separable_convolve_decimated( edge_extend_buffer( m_child, src_bbox, m_edge ),
+                                                   dest, m_kernel, m_kernel, 2 );
+    }
+
+    template <class DestT>
+    void reduce( DestT const& dest, BBox2i const& bbox, boost::true_type ) const {
+      ImageView<pixel_type> result( bbox.width(), bbox.height(), planes() );
+      reduce( result, bbox, boost::true_type() );
+      vw::rasterize( result, dest, bounding_box( result ) );
+    }
+
+    /// Masked pixels are filtered at full resolution.
+    template <class DestT>
+    void reduce( DestT const& dest, BBox2i const& bbox, boost::false_type ) const {
+      vw::rasterize( subsample( separable_convolution_filter( m_child, m_kernel, m_kernel, m_edge ), 2 ),
+                     dest, bbox );
+    }
+    /// \endcond
+  };
+
+  /// Smooths an image with the separable kernel in both directions and
+  /// keeps the pixels with even coordinates, in one pass.  The result
+  /// matches subsample(separable_convolution_filter(image, kernel,
+  /// kernel, edge), 2), but the smoothing is only evaluated where it is
+  /// kept.
+  template <class ImageT, class KernelT, class EdgeT>
+  PyramidReduceView<ImageT, KernelT, EdgeT>
+  inline pyramid_reduce( ImageViewBase<ImageT> const& image, std::vector<KernelT> const& kernel,
+                         EdgeT const& edge ) {
+    return PyramidReduceView<ImageT, KernelT, EdgeT>( image.impl(), kernel, edge );
+  }
+
+  /// pyramid_reduce() with constant edge extension.
+  template <class ImageT, class KernelT>
+  PyramidReduceView<ImageT, KernelT, ConstantEdgeExtension>
+  inline pyramid_reduce( ImageViewBase<ImageT> const& image, std::vector<KernelT> const& kernel ) {
+    return PyramidReduceView<ImageT, KernelT, ConstantEdgeExtension>( image.impl(), kernel );
+  }
+
+  /// pyramid_reduce() with generate_pyramid_smoothing_kernel() and
+  /// constant edge extension.
+  template <class ImageT>
+  PyramidReduceView<ImageT, float, ConstantEdgeExtension>
+  inline pyramid_reduce( ImageViewBase<ImageT> const& image ) {
+    return PyramidReduceView<ImageT, float, ConstantEdgeExtension>( image.impl(),
+                                                                    generate_pyramid_smoothing_kernel() );
+  }
+
+
+  // *******************************************************************
+  // ImagePyramid
+  // *******************************************************************
+
+  template <class PixelT> class ImagePyramidLevelView;
+
+  /// \cond INTERNAL
+  namespace pyramid_p {
+
+    // Returns the levels registered under key if they are still alive,
+    // otherwise registers levels under key and returns them.
+    boost::shared_ptr<void> share_levels( std::string const& key, boost::shared_ptr<void> const& levels );
+
+    template <class PixelT> class PyramidLevels;
+
+    // Builds one tile of a level for the cache
+    template <class PixelT>
+    class PyramidTileGenerator {
+      PyramidLevels<PixelT> const* m_levels;
+      int32 m_level;
+      BBox2i m_bbox;
+    public:
+      typedef ImageView<PixelT> value_type;
+
+      PyramidTileGenerator( PyramidLevels<PixelT> const& levels, int32 level, BBox2i const& bbox )
+        : m_levels(&levels), m_level(level), m_bbox(bbox) {}
+
+      size_t size() const {
+        return size_t(m_bbox.width()) * m_bbox.height() * m_levels->planes() * sizeof(PixelT);
+      }
+
+      boost::shared_ptr<value_type> generate() const {
+        boost::shared_ptr<value_type> tile( new value_type( m_bbox.width(), m_bbox.height(),
+                                                            m_levels->planes() ) );
+        pyramid_reduce( m_levels->level( m_level - 1 ), m_levels->kernel(),
+                        ConstantEdgeExtension() ).rasterize( *tile, m_bbox );
+        return tile;
+      }
+    };
+
+    // The levels of a pyramid and the cache handles of their tiles.
+    // Shared by the copies of an ImagePyramid, by the views of its
+    // levels and by pyramids with the same id.
+    template <class PixelT>
+    class PyramidLevels : public boost::enable_shared_from_this<PyramidLevels<PixelT> >,
+                          private boost::noncopyable {
+    public:
+      typedef PyramidTileGenerator<PixelT> generator_type;
+
+    private:
+      struct Level {
+        int32 cols, rows;
+        Vector2i grid;
+        bool is_stored;
+        ImageViewRef<PixelT> stored;    // The source, or set by set_level()
+        std::vector<Cache::Handle<generator_type> > handles;
+      };
+
+      std::vector<float> m_kernel;
+      int32 m_planes, m_tile_size;
+      Cache* m_cache;
+      mutable Mutex m_mutex;
+      mutable std::vector<Level> m_levels;
+
+      // Adds levels down to level. Must be called with the lock held.
+      void grow( int32 level ) const {
+        while ( int32( m_levels.size() ) <= level ) {
+          Level const& above = m_levels.back();
+          Level next;
+          next.is_stored = false;
+          next.cols = 1 + ( above.cols - 1 ) / 2;
+          next.rows = 1 + ( above.rows - 1 ) / 2;
+          next.grid = Vector2i( ( next.cols + m_tile_size - 1 ) / m_tile_size,
+                                ( next.rows + m_tile_size - 1 ) / m_tile_size );
+          next.handles.resize( next.grid.x() * next.grid.y() );
+          m_levels.push_back( next );
+        }
+      }
+
+    public:
+      PyramidLevels( ImageViewRef<PixelT> const& source, std::vector<float> const& kernel,
+                     int32 tile_size, Cache& cache )
+        : m_kernel(kernel), m_planes( source.planes() ), m_tile_size(tile_size), m_cache(&cache) {
+        Level base;
+        base.cols = source.cols();
+        base.rows = source.rows();
+        base.is_stored = true;
+        base.stored = source;
+        m_levels.push_back( base );
+      }
+
+      std::vector<float> const& kernel() const { return m_kernel; }
+      int32 planes() const { return m_planes; }
+      int32 tile_size() const { return m_tile_size; }
+
+      Vector2i size( int32 level ) const {
+        Mutex::WriteLock lock( m_mutex );
+        grow( level );
+        return Vector2i( m_levels[level].cols, m_levels[level].rows );
+      }
+
+      // The tile grid of a level, or zero if the level is stored
+      Vector2i grid( int32 level ) const {
+        Mutex::WriteLock lock( m_mutex );
+        grow( level );
+        return m_levels[level].is_stored ? Vector2i() : m_levels[level].grid;
+      }
+
+      ImagePyramidLevelView<PixelT> level( int32 level ) const {
+        return ImagePyramidLevelView<PixelT>( this->shared_from_this(), level );
+      }
+
+      void set_level( int32 level, ImageViewRef<PixelT> const& image ) {
+        Mutex::WriteLock lock( m_mutex );
+        grow( level );
+        Level& l = m_levels[level];
+        VW_ASSERT( image.cols() == l.cols && image.rows() == l.rows && image.planes() == m_planes,
+                   ArgumentErr() << "ImagePyramid: Level " << level << " should be "
+                   << l.cols << "x" << l.rows << "x" << m_planes << ", not "
+                   << image.cols() << "x" << image.rows() << "x" << image.planes() << "." );
+        l.is_stored = true;
+        l.stored = image;
+        for ( size_t i = 0; i < l.handles.size(); ++i )
+          l.handles[i].reset();
+      }
+
+      // Sets image to the stored image of a level, if there is one
+      bool stored( int32 level, ImageViewRef<PixelT>& image ) const {
+        Mutex::WriteLock lock( m_mutex );
+        grow( level );
+        if ( !m_levels[level].is_stored )
+          return false;
+        image = m_levels[level].stored;
+        return true;
+      }
+
+      // A tile of a computed level, from the cache if it is there
+      boost::shared_ptr<ImageView<PixelT> > tile( int32 level, int32 tx, int32 ty ) const {
+        Cache::Handle<generator_type> handle;
+        {
+          Mutex::WriteLock lock( m_mutex );
+          grow( level );
+          Level& l = m_levels[level];
+          Cache::Handle<generator_type>& entry = l.handles[ ty * l.grid.x() + tx ];
+          if ( !entry.attached() ) {
+            BBox2i bbox( tx * m_tile_size, ty * m_tile_size, m_tile_size, m_tile_size );
+            bbox.crop( BBox2i( 0, 0, l.cols, l.rows ) );
+            entry = m_cache->insert( generator_type( *this, level, bbox ) );
+          }
+          handle = entry;
+        }
+        boost::shared_ptr<ImageView<PixelT> > result = handle;
+        handle.release();
+        return result;
+      }
+    };
+
+    // Fills the cache with the tiles of one level.  The first
+    // exception is kept for the caller, and the tiles after it are
+    // skipped.
+    template <class PixelT>
+    class PyramidTileTask : public Task, private boost::noncopyable {
+      PyramidLevels<PixelT> const& m_levels;
+      int32 m_level, m_tx, m_ty;
+      Mutex& m_mutex;
+      std::exception_ptr& m_error;
+    public:
+      PyramidTileTask( PyramidLevels<PixelT> const& levels, int32 level, int32 tx, int32 ty,
+                       Mutex& mutex, std::exception_ptr& error )
+        : m_levels(levels), m_level(level), m_tx(tx), m_ty(ty), m_mutex(mutex), m_error(error) {}
+      void operator()() {
+        {
+          Mutex::Lock lock( m_mutex );
+          if ( m_error )
+            return;
+        }
+        try {
+          m_levels.tile( m_level, m_tx, m_ty );
+        } catch ( ... ) {
+          Mutex::Lock lock( m_mutex );
+          if ( !m_error )
+            m_error = std::current_exception();
+        }
+      }
+    };
+
+  } // namespace pyramid_p
+  /// \endcond
+
+  /// One level of an ImagePyramid.  Level 0 is the source image; each
+  /// level after it is pyramid_reduce() of the level before, assembled
+  /// from cached tiles.
+  template <class PixelT>
+  class ImagePyramidLevelView : public ImageViewBase<ImagePyramidLevelView<PixelT> > {
+    boost::shared_ptr<const pyramid_p::PyramidLevels<PixelT> > m_levels;
+    int32 m_level;
+    Vector2i m_size;
+
+  public:
+    typedef PixelT pixel_type;
+    typedef PixelT result_type;
+    typedef ProceduralPixelAccessor<ImagePyramidLevelView> pixel_accessor;
+
+    ImagePyramidLevelView( boost::shared_ptr<const pyramid_p::PyramidLevels<PixelT> > const& levels,
+                           int32 level )
+      : m_levels(levels), m_level(level), m_size( levels->size( level ) ) {}
+
+    inline int32 cols  () const { return m_size.x(); }
+    inline int32 rows  () const { return m_size.y(); }
+    inline int32 planes() const { return m_levels->planes(); }
+    int32 level() const { return m_level; }
+
+    inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+
+    inline result_type operator()( int32 i, int32 j, int32 p=0 ) const {
+      return prerasterize( BBox2i( i, j, 1, 1 ) )( i, j, p );
+    }
+
+    /// \cond INTERNAL
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      ImageView<pixel_type> result( bbox.width(), bbox.height(), planes() );
+      rasterize( result, bbox );
+      return prerasterize_type( result, -bbox.min().x(), -bbox.min().y(), cols(), rows() );
+    }
+
+    template <class DestT>
+    void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      ImageViewRef<pixel_type> stored;
+      if ( m_levels->stored( m_level, stored ) ) {
+        stored.rasterize( dest, bbox );
+        return;
+      }
+      VW_ASSERT( BBox2i( 0, 0, cols(), rows() ).contains( bbox ),
+                 ArgumentErr() << "ImagePyramidLevelView: " << bbox << " is outside level "
+                 << m_level << "." );
+      const int32 size = m_levels->tile_size();
+      for ( int32 ty = bbox.min().y() / size; ty * size < bbox.max().y(); ++ty )
+        for ( int32 tx = bbox.min().x() / size; tx * size < bbox.max().x(); ++tx ) {
+          boost::shared_ptr<ImageView<pixel_type> > tile = m_levels->tile( m_level, tx, ty );
+          BBox2i tile_bbox( tx * size, ty * size, tile->cols(), tile->rows() );
+          BBox2i overlap = tile_bbox;
+          overlap.crop( bbox );
+          vw::rasterize( crop( *tile, overlap - tile_bbox.min() ),
+                         crop( dest, overlap - bbox.min() ),
+                         BBox2i( 0, 0, overlap.width(), overlap.height() ) );
+        }
+    }
+    /// \endcond
+  };
+
+  /// A Gaussian pyramid of an image, built lazily and kept in a
+  /// vw::Cache.  See ImagePyramid.h.
+  ///
+  /// Copies of a pyramid share their levels.  The source must be safe
+  /// to rasterize from several threads at once, as any view that only
+  /// reads from memory or disk is.
+  template <class PixelT>
+  class ImagePyramid {
+    boost::shared_ptr<pyramid_p::PyramidLevels<PixelT> > m_levels;
+
+  public:
+    typedef PixelT pixel_type;
+    typedef ImagePyramidLevelView<PixelT> level_type;
+
+    /// A pyramid of source.  Pyramids made with the same nonempty id,
+    /// pixel type, size and kernel share their levels while any of them
+    /// is alive, so the id should name the source, for example by its
+    /// file name.  Levels are built in tiles of tile_size pixels.
+    template <class ImageT>
+    ImagePyramid( ImageViewBase<ImageT> const& source, std::string const& id = "",
+                  std::vector<float> const& kernel = generate_pyramid_smoothing_kernel(),
+                  int32 tile_size = vw_settings().default_tile_size(),
+                  Cache& cache = vw_system_cache() ) {
+      VW_ASSERT( !kernel.empty(), ArgumentErr() << "ImagePyramid: The kernel is empty." );
+      VW_ASSERT( tile_size > 0, ArgumentErr() << "ImagePyramid: tile_size must be positive." );
+      m_levels.reset( new pyramid_p::PyramidLevels<PixelT>( ImageViewRef<PixelT>( source.impl() ),
+                                                            kernel, tile_size, cache ) );
+      if ( id.empty() )
+        return;
+      std::ostringstream key;
+      key << id << ':' << typeid(PixelT).name() << ':' << source.impl().cols() << 'x'
+          << source.impl().rows() << 'x' << source.impl().planes() << ':' << tile_size;
+      // Enough digits that kernels differing in any bit differ in key
+      key.precision( std::numeric_limits<float>::max_digits10 );
+      for ( size_t i = 0; i < kernel.size(); ++i )
+        key << ':' << kernel[i];
+      m_levels = boost::static_pointer_cast<pyramid_p::PyramidLevels<PixelT> >(
+                   pyramid_p::share_levels( key.str(), m_levels ) );
+    }
+
+    /// Level 0 is the source.  Level i+1 has 1 + (n-1)/2 pixels across
+    /// where level i has n.  Any level can be asked for; the smallest
+    /// ones are one pixel.
+    level_type level( int32 i ) const {
+      VW_ASSERT( i >= 0, ArgumentErr() << "ImagePyramid: Negative level " << i << "." );
+      return m_levels->level( i );
+    }
+
+    /// Reads level i from image instead of computing it, for example
+    /// from a DiskImageView of a level written out earlier.  Levels
+    /// after it are computed from it.  This affects every pyramid that
+    /// shares these levels.
+    void set_level( int32 i, ImageViewRef<PixelT> const& image ) {
+      VW_ASSERT( i > 0, ArgumentErr() << "ImagePyramid: Only levels after 0 can be set." );
+      m_levels->set_level( i, image );
+    }
+
+    /// Computes the tiles of levels 1 to last ahead of time, one level
+    /// after the other with the tiles of each level in parallel.  The
+    /// first exception thrown by a tile is rethrown here.
+    void build( int32 last, int32 num_threads = vw_settings().default_num_threads() ) const {
+      Mutex mutex;
+      std::exception_ptr error;
+      for ( int32 l = 1; l <= last; ++l ) {
+        Vector2i grid = m_levels->grid( l );
+        FifoWorkQueue queue( num_threads );
+        for ( int32 ty = 0; ty < grid.y(); ++ty )
+          for ( int32 tx = 0; tx < grid.x(); ++tx ) {
+            boost::shared_ptr<Task> task( new pyramid_p::PyramidTileTask<PixelT>( *m_levels, l, tx, ty,
+                                                                                   mutex, error ) );
+            queue.add_task( task );
+          }
+        queue.join_all();
+        if ( error )
+          std::rethrow_exception( error );
+      }
+    }
+
+    /// True if both pyramids use the same levels
+    bool shares_levels( ImagePyramid const& other ) const { return m_levels == other.m_levels; }
+  };
+
+} // namespace vw
+
+#endif // __VW_IMAGE_IMAGEPYRAMID_H__
@@ -38,6 +38,10 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/scoped_ptr.hpp>
 
+#include <algorithm>
+#include <vector>
+
+#include <vw/Core/Settings.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Manipulation.h>
 #include <vw/Image/SparseImageCheck.h>
@@ -45,88 +49,45 @@
 namespace vw {
 
   /// \cond INTERNAL
+  /// A block of rasterized pixels from the view behind an
+  /// ImageViewRef.  Pixel (i,j,p) of the view is stored at
+  /// data(i-bbox.min().x(), j-bbox.min().y(), p).
   template <class PixelT>
-  class ImageViewRefAccessorBase {
-  public:
-    virtual ~ImageViewRefAccessorBase() {}
-    virtual ImageViewRefAccessorBase* copy() const = 0;
-    virtual void next_col  () = 0;
-    virtual void prev_col  () = 0;
-    virtual void next_row  () = 0;
-    virtual void prev_row  () = 0;
-    virtual void next_plane() = 0;
-    virtual void prev_plane() = 0;
-    virtual void advance( ssize_t di, ssize_t dj, ssize_t dp=0 ) = 0;
-    virtual PixelT operator*() const = 0;
+  struct ImageViewRefTile {
+    BBox2i bbox;
+    ImageView<PixelT> data;
   };
 
-  template <class IterT>
-  class ImageViewRefAccessorImpl : public ImageViewRefAccessorBase<typename IterT::pixel_type> {
-  private:
-    IterT m_iter;
-    // We know what this is, but the base class doesn't. Just cast...
-    typedef typename IterT::offset_type iter_offset_type;
-  public:
-    typedef typename IterT::pixel_type pixel_type;
-
-    ImageViewRefAccessorImpl( IterT const& iter ) : m_iter(iter) {}
-    virtual ~ImageViewRefAccessorImpl() {}
-
-    virtual ImageViewRefAccessorBase<pixel_type>* copy() const { return new ImageViewRefAccessorImpl(m_iter); }
-
-    virtual void next_col  () { m_iter.next_col();   }
-    virtual void prev_col  () { m_iter.prev_col();   }
-    virtual void next_row  () { m_iter.next_row();   }
-    virtual void prev_row  () { m_iter.prev_row();   }
-    virtual void next_plane() { m_iter.next_plane(); }
-    virtual void prev_plane() { m_iter.prev_plane(); }
-    virtual void advance( ssize_t di, ssize_t dj, ssize_t dp=0 ) {
-      m_iter.advance((iter_offset_type)di,(iter_offset_type)dj,dp);
+  namespace image_view_ref_p {
+    // Rasterizes bbox of a view into a new tile
+    template <class ViewT>
+    boost::shared_ptr<ImageViewRefTile<typename ViewT::pixel_type> const>
+    make_tile( ViewT const& view, BBox2i const& bbox ) {
+      boost::shared_ptr<ImageViewRefTile<typename ViewT::pixel_type> > tile( new ImageViewRefTile<typename ViewT::pixel_type>() );
+      tile->bbox = bbox;
+      tile->data.set_size( bbox.width(), bbox.height(), view.planes() );
+      view.rasterize( tile->data, bbox );
+      return tile;
     }
-    virtual pixel_type operator*() const { return *m_iter; }
-  };
-  /// \endcond
 
-  /// A special virtualized accessor adaptor.
-  ///
-  /// This accessor adaptor is used by the \ref vw::ImageViewRef class.
-  template <class PixelT>
-  class ImageViewRefAccessor {
-  private:
-    boost::scoped_ptr< ImageViewRefAccessorBase<PixelT> > m_iter;
-  public:
-    typedef PixelT  pixel_type;
-    typedef PixelT  result_type;
-    typedef ssize_t offset_type;
-
-    template <class IterT> ImageViewRefAccessor( IterT const& iter ) : m_iter( new ImageViewRefAccessorImpl<IterT>(iter) ) {}
-    ~ImageViewRefAccessor() {}
-
-    ImageViewRefAccessor( ImageViewRefAccessor const& other ) : m_iter( other.m_iter->copy() ) {}
-    ImageViewRefAccessor& operator=( ImageViewRefAccessor const& other ) { 
-      m_iter = other.m_iter->copy(); return *this; 
+    // A plain image is already in memory, so it becomes a single tile
+    // that shares its data.
+    template <class PixelT>
+    boost::shared_ptr<ImageViewRefTile<PixelT> const>
+    make_tile( ImageView<PixelT> const& view, BBox2i const& /*bbox*/ ) {
+      boost::shared_ptr<ImageViewRefTile<PixelT> > tile( new ImageViewRefTile<PixelT>() );
+      tile->bbox = BBox2i( 0, 0, view.cols(), view.rows() );
+      tile->data = view;
+      return tile;
     }
+  }
 
-    inline ImageViewRefAccessor& next_col  () { m_iter->next_col();   return *this; }
-    inline ImageViewRefAccessor& prev_col  () { m_iter->prev_col();   return *this; }
-    inline ImageViewRefAccessor& next_row  () { m_iter->next_row();   return *this; }
-    inline ImageViewRefAccessor& prev_row  () { m_iter->prev_row();   return *this; }
-    inline ImageViewRefAccessor& next_plane() { m_iter->next_plane(); return *this; }
-    inline ImageViewRefAccessor& prev_plane() { m_iter->prev_plane(); return *this; }
-    inline ImageViewRefAccessor& advance( ssize_t di, ssize_t dj, ssize_t dp=0 ) { 
-      m_iter->advance(di,dj,dp=0); return *this; 
-    }
-    inline pixel_type operator*() const { return *(*m_iter); }
-  };
-
-
-  /// \cond INTERNAL
   // Base class definition
   template <class PixelT>
   class ImageViewRefBase {
   public:
     typedef PixelT pixel_type;
-    typedef ImageViewRefAccessor<PixelT> pixel_accessor;
+    typedef boost::shared_ptr<ImageViewRefTile<PixelT> const> tile_ptr;
 
     virtual ~ImageViewRefBase() {}
 
@@ -135,7 +96,10 @@ namespace vw {
     virtual int32 planes() const = 0;
     virtual pixel_type operator()( int32 i,  int32 j,  int32 p ) const = 0;
     virtual pixel_type operator()( double i, double j, int32 p ) const = 0;
-    virtual pixel_accessor origin() const = 0;
+
+    /// Returns a tile that covers at least bbox, which must lie
+    /// inside the view.
+    virtual tile_ptr tile( BBox2i const& bbox ) const = 0;
 
     virtual bool sparse_check( BBox2i const& bbox ) const = 0;
     virtual void rasterize( ImageView<pixel_type> const& dest, BBox2i const& bbox ) const = 0;
@@ -148,7 +112,7 @@ namespace vw {
     ViewT m_view;
   public:
     typedef typename ViewT::pixel_type pixel_type;
-    typedef ImageViewRefAccessor<typename ViewT::pixel_type> pixel_accessor;
+    typedef typename ImageViewRefBase<pixel_type>::tile_ptr tile_ptr;
 
     ImageViewRefImpl( ImageViewBase<ViewT> const& view ) : m_view(view.impl()) {}
     virtual ~ImageViewRefImpl() {}
@@ -156,11 +120,12 @@ namespace vw {
     virtual int32          cols  () const { return m_view.cols();   }
     virtual int32          rows  () const { return m_view.rows();   }
     virtual int32          planes() const { return m_view.planes(); }
-    virtual pixel_accessor origin() const { return m_view.origin(); }
-    
+
     virtual pixel_type     operator()( int32  i, int32  j, int32 p ) const { return m_view(i,j,p); }
     virtual pixel_type     operator()( double i, double j, int32 p ) const { return m_view(i,j,p); }
 
+    virtual tile_ptr tile( BBox2i const& bbox ) const { return image_view_ref_p::make_tile( m_view, bbox ); }
+
     virtual bool sparse_check( BBox2i const& bbox ) const { return vw::sparse_check( m_view, bbox ); }
     virtual void rasterize( ImageView<pixel_type> const& dest, BBox2i const& bbox ) const { m_view.rasterize( dest, bbox ); }
 
@@ -168,6 +133,143 @@ namespace vw {
   };
   /// \endcond
 
+  /// The tiles that one accessor and its copies have rasterized.
+  /// Each call to ImageViewRef::origin() starts a new cache, so pixels
+  /// written to the source before then are always seen.  One tile is
+  /// kept per tile column, which is enough for a row by row scan to
+  /// rasterize every pixel once.  The cache is not locked, so copies of
+  /// one accessor must not be used from several threads at once.
+  ///
+  /// A tile is only rasterized once a sixteenth of its pixels have
+  /// been read one at a time.  Scans pay little for this, and sparse
+  /// samples, such as those of an interpolated downsampling, don't
+  /// rasterize every pixel of a tile to read a few of them.
+  template <class PixelT>
+  struct ImageViewRefTileCache {
+    typedef boost::shared_ptr<ImageViewRefTile<PixelT> const> tile_ptr;
+
+    struct Slot {
+      int32 row;   // Tile row held by this slot, or -1
+      int32 reads; // Pixels of that tile read one at a time
+      tile_ptr tile;
+      Slot() : row(-1), reads(0) {}
+    };
+
+    int32 cols, rows, planes, tile_size;
+    std::vector<Slot> slots; // One per tile column
+
+    ImageViewRefTileCache( ImageViewRefBase<PixelT> const& view )
+      : cols( view.cols() ), rows( view.rows() ), planes( view.planes() ),
+        tile_size( std::max( int32(1), int32(vw_settings().default_tile_size()) ) ),
+        slots( ( std::max( cols, int32(1) ) - 1 ) / tile_size + 1 ) {}
+
+    /// Returns the slot for the tile that contains pos.  Its tile is
+    /// null if the pixel should be read on its own, and the bbox of the
+    /// tile to rasterize is returned in bbox.
+    Slot& find( Vector2i const& pos, BBox2i& bbox ) {
+      int32 tx = pos.x() / tile_size, ty = pos.y() / tile_size;
+      Slot& slot = slots[tx];
+      if ( slot.row != ty ) {
+        slot.row   = ty;
+        slot.reads = 0;
+        slot.tile.reset();
+      }
+      bbox = BBox2i( tx * tile_size, ty * tile_size, tile_size, tile_size );
+      bbox.crop( BBox2i( 0, 0, cols, rows ) );
+      return slot;
+    }
+  };
+
+  /// A buffered accessor for ImageViewRef.
+  ///
+  /// Moving the accessor only updates its position. Dereferencing it
+  /// reads from a tile rasterized from the underlying view, so pixels
+  /// are produced a tile at a time by one virtual call instead of one
+  /// virtual call each.  Tiles are default_tile_size() squares, kept in
+  /// a cache shared by the accessor and its copies, so a row by row
+  /// scan rasterizes every pixel about once.  Pixels of tiles that have
+  /// not been rasterized yet, and pixels outside the view, are read
+  /// with the view's operator(), so edge extended views still behave
+  /// as before.  Pixels are read as they were when their tile was
+  /// rasterized, so take a new accessor after writing to the source.
+  template <class PixelT>
+  class ImageViewRefAccessor {
+    typedef ImageViewRefBase<PixelT> view_type;
+    typedef ImageViewRefTileCache<PixelT> cache_type;
+    typedef typename view_type::tile_ptr tile_ptr;
+
+    boost::shared_ptr<view_type const> m_view;
+    boost::shared_ptr<cache_type> m_cache;
+    ssize_t m_i, m_j, m_p;
+
+    // The current tile, with its layout copied out so that reading a
+    // pixel from it needs no indirection.
+    mutable tile_ptr m_tile;
+    mutable PixelT const* m_data;
+    mutable ssize_t m_x0, m_y0;
+    mutable size_t m_cols, m_rows, m_planes, m_pstride;
+
+    void set_tile( tile_ptr const& tile ) const {
+      m_tile    = tile;
+      m_data    = tile->data.data();
+      m_x0      = tile->bbox.min().x();
+      m_y0      = tile->bbox.min().y();
+      m_cols    = tile->data.cols();
+      m_rows    = tile->data.rows();
+      m_planes  = tile->data.planes();
+      m_pstride = m_cols * m_rows;
+    }
+
+    // Finds or rasterizes the tile under the accessor
+    PixelT fetch() const {
+      cache_type& cache = *m_cache;
+      if ( m_i < 0 || m_j < 0 || m_p < 0 ||
+           m_i >= cache.cols || m_j >= cache.rows || m_p >= cache.planes )
+        return (*m_view)( int32(m_i), int32(m_j), int32(m_p) );
+
+      BBox2i bbox;
+      typename cache_type::Slot& slot = cache.find( Vector2i( (int32)m_i, (int32)m_j ), bbox );
+      if ( !slot.tile ) {
+        if ( slot.reads++ < bbox.width() * bbox.height() / 16 )
+          return (*m_view)( int32(m_i), int32(m_j), int32(m_p) );
+        slot.tile = m_view->tile( bbox );
+      }
+      set_tile( slot.tile );
+      return m_data[ (m_i - m_x0) + (m_j - m_y0) * m_cols + m_p * m_pstride ];
+    }
+
+  public:
+    typedef PixelT  pixel_type;
+    typedef PixelT  result_type;
+    typedef ssize_t offset_type;
+
+    /// A plain image can be passed as the initial tile, which then
+    /// covers the whole view and is read in place.
+    ImageViewRefAccessor( boost::shared_ptr<view_type const> const& view,
+                          tile_ptr const& tile = tile_ptr() )
+      : m_view( view ), m_cache( new cache_type( *view ) ), m_i(0), m_j(0), m_p(0),
+        m_data(0), m_x0(0), m_y0(0), m_cols(0), m_rows(0), m_planes(0), m_pstride(0) {
+      if ( tile )
+        set_tile( tile );
+    }
+
+    inline ImageViewRefAccessor& next_col  () { ++m_i; return *this; }
+    inline ImageViewRefAccessor& prev_col  () { --m_i; return *this; }
+    inline ImageViewRefAccessor& next_row  () { ++m_j; return *this; }
+    inline ImageViewRefAccessor& prev_row  () { --m_j; return *this; }
+    inline ImageViewRefAccessor& next_plane() { ++m_p; return *this; }
+    inline ImageViewRefAccessor& prev_plane() { --m_p; return *this; }
+    inline ImageViewRefAccessor& advance( ssize_t di, ssize_t dj, ssize_t dp=0 ) {
+      m_i += di; m_j += dj; m_p += dp; return *this;
+    }
+
+    inline result_type operator*() const {
+      size_t i = m_i - m_x0, j = m_j - m_y0;
+      if ( i < m_cols && j < m_rows && size_t(m_p) < m_planes )
+        return m_data[ i + j * m_cols + m_p * m_pstride ];
+      return fetch();
+    }
+  };
 
   /// A virtualized image view reference object.
   ///
@@ -179,6 +281,9 @@ namespace vw {
   /// function call per method invocation.  In many cases there
   /// are additional costs associated with not being able to
   /// perform template-based optimizations at compile time.
+  /// Rasterization and the pixel accessor work a tile at a time, so
+  /// they pay this cost once per tile rather than once per pixel.
+  /// Indexing with operator() still makes one virtual call per pixel.
   ///
   /// Like any C++ reference, you bind an ImageViewRef to a view
   /// using a constructor and future operations act on the bound
@@ -189,6 +294,11 @@ namespace vw {
   class ImageViewRef : public ImageViewBase<ImageViewRef<PixelT> > {
   private:
     boost::shared_ptr< ImageViewRefBase<PixelT> > m_view;
+    bool m_plain; // Whether m_view wraps a plain ImageView
+
+    void reset_plain() {
+      m_plain = dynamic_cast<ImageViewRefImpl<ImageView<PixelT> >*>( m_view.get() ) != 0;
+    }
   public:
     typedef PixelT pixel_type;
     typedef PixelT result_type;
@@ -199,13 +309,13 @@ namespace vw {
     // any arguments, which makes it suitable for use in situations
     // where creation and assignment must happen as seperate steps,
     // such as in STL containers.
-    ImageViewRef() : m_view( new ImageViewRefImpl<ImageView<PixelT> >(ImageView<PixelT>()) ) {}
+    ImageViewRef() : m_view( new ImageViewRefImpl<ImageView<PixelT> >(ImageView<PixelT>()) ) { reset_plain(); }
 
     // Assignment constructor creates an ImageViewRef from another ImageView.
-    template <class ViewT> ImageViewRef( ImageViewBase<ViewT> const& view ) : m_view( new ImageViewRefImpl<ViewT>(view) ) {}
+    template <class ViewT> ImageViewRef( ImageViewBase<ViewT> const& view ) : m_view( new ImageViewRefImpl<ViewT>(view) ) { reset_plain(); }
     ~ImageViewRef() {}
 
-    template <class ViewT> void reset( ImageViewBase<ViewT> const& view ) { m_view.reset( new ImageViewRefImpl<ViewT>(view) ); }
+    template <class ViewT> void reset( ImageViewBase<ViewT> const& view ) { m_view.reset( new ImageViewRefImpl<ViewT>(view) ); reset_plain(); }
 
     inline int32 cols  () const { return m_view->cols();   }
     inline int32 rows  () const { return m_view->rows();   }
@@ -227,7 +337,12 @@ namespace vw {
       return m_view->operator()(double(i),double(j),p);
     }
 
-    inline pixel_accessor origin() const { return m_view->origin(); }
+    inline pixel_accessor origin() const {
+      // A plain image is a single tile that costs nothing to make
+      if ( m_plain )
+        return pixel_accessor( m_view, m_view->tile( BBox2i( 0, 0, cols(), rows() ) ) );
+      return pixel_accessor( m_view );
+    }
 
     inline bool sparse_check( BBox2i const& bbox ) const { return m_view->sparse_check(bbox); }
 
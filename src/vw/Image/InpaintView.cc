@@ -0,0 +1,276 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file InpaintView.cc
+///
+
+#include <vw/Image/InpaintView.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace vw {
+namespace inpaint_p {
+
+namespace {
+
+  // The diffusion stencil, row by row. The weights sum to one.
+  const double stencil_w[9] = { .176765, .073235, .176765,
+                                .073235, 0,       .073235,
+                                .176765, .073235, .176765 };
+
+  // One level of the pyramid, with the equations
+  //   sum_k a[i][k] v[i+k] = f[i]
+  // for each unknown pixel i over its 3x3 neighborhood k. On the patch
+  // itself a[i] is the diffusion stencil, without the neighbors that
+  // are excluded, and the known pixels are fixed. The coarser levels
+  // solve for corrections to the level above and are zero off their
+  // unknowns.
+  struct Level {
+    int32 cols, rows, planes;
+    ImageView<uint8>    state;
+    ImageView<double>   values, rhs;
+    std::vector<int32>  index;   // Unknown pixels, as row * cols + col
+    std::vector<double> a;       // Nine per unknown pixel
+    int32 offset[9];
+
+    void init( int32 num_planes ) {
+      cols = state.cols(); rows = state.rows(); planes = num_planes;
+      for ( int32 k = 0; k < 9; ++k )
+        offset[k] = ( k / 3 - 1 ) * cols + ( k % 3 - 1 );
+      rhs.set_size( cols, rows, planes );
+      std::fill( rhs.data(), rhs.data() + cols * rows * planes, 0.0 );
+    }
+
+    // f - Av at unknown u
+    double residual( size_t u, int32 p ) const {
+      double const* s = &a[ 9 * u ];
+      double const* v = values.data() + p * cols * rows + index[u];
+      double sum = rhs.data()[ p * cols * rows + index[u] ];
+      for ( int32 k = 0; k < 9; ++k )
+        if ( s[k] != 0 )
+          sum -= s[k] * v[ offset[k] ];
+      return sum;
+    }
+
+    // Gauss-Seidel
+    void smooth( int32 sweeps ) {
+      for ( int32 i = 0; i < sweeps; ++i )
+        for ( size_t u = 0; u < index.size(); ++u )
+          for ( int32 p = 0; p < planes; ++p )
+            values.data()[ p * cols * rows + index[u] ] += residual( u, p ) / a[ 9 * u + 4 ];
+    }
+  };
+
+  // The coarse pixels that a fine pixel interpolates from, and their
+  // weights. Coarse pixel i sits on fine pixel 2i.
+  inline int32 parents( int32 x, int32 first[2], double weight[2] ) {
+    if ( x % 2 == 0 ) {
+      first[0] = x / 2; weight[0] = 1;
+      return 1;
+    }
+    first[0] = x / 2;     weight[0] = 0.5;
+    first[1] = x / 2 + 1; weight[1] = 0.5;
+    return 2;
+  }
+
+  // Builds the next coarser level. Corrections are interpolated
+  // bilinearly and residuals restricted with the transpose, so the
+  // coarse equations are the Galerkin product of the fine ones. That
+  // keeps the coarse levels faithful to holes of any shape.
+  void coarsen( Level const& fine, Level& coarse ) {
+    coarse.state.set_size( fine.cols / 2 + 1, fine.rows / 2 + 1 );
+    std::fill( coarse.state.data(), coarse.state.data() + coarse.state.cols() * coarse.state.rows(),
+               uint8(Known) );
+    int32 px[2], py[2];
+    double wx[2], wy[2];
+    for ( size_t u = 0; u < fine.index.size(); ++u ) {
+      int32 nx = parents( fine.index[u] % fine.cols, px, wx );
+      int32 ny = parents( fine.index[u] / fine.cols, py, wy );
+      for ( int32 y = 0; y < ny; ++y )
+        for ( int32 x = 0; x < nx; ++x )
+          coarse.state( px[x], py[y] ) = Unknown;
+    }
+    coarse.init( fine.planes );
+    coarse.values.set_size( coarse.cols, coarse.rows, coarse.planes );
+
+    std::vector<int32> number( coarse.cols * coarse.rows, -1 );
+    for ( int32 row = 0; row < coarse.rows; ++row )
+      for ( int32 col = 0; col < coarse.cols; ++col )
+        if ( coarse.state( col, row ) == Unknown ) {
+          number[ row * coarse.cols + col ] = int32( coarse.index.size() );
+          coarse.index.push_back( row * coarse.cols + col );
+        }
+    coarse.a.assign( 9 * coarse.index.size(), 0.0 );
+
+    int32 qx[2], qy[2];
+    double vx[2], vy[2];
+    for ( size_t u = 0; u < fine.index.size(); ++u ) {
+      int32 col = fine.index[u] % fine.cols, row = fine.index[u] / fine.cols;
+      int32 nx = parents( col, px, wx ), ny = parents( row, py, wy );
+      for ( int32 k = 0; k < 9; ++k ) {
+        double s = fine.a[ 9 * u + k ];
+        int32 c = col + k % 3 - 1, r = row + k / 3 - 1;
+        if ( s == 0 || fine.state( c, r ) != Unknown )
+          continue;
+        int32 mx = parents( c, qx, vx ), my = parents( r, qy, vy );
+        for ( int32 y = 0; y < ny; ++y )
+          for ( int32 x = 0; x < nx; ++x ) {
+            double* t = &coarse.a[ 9 * number[ py[y] * coarse.cols + px[x] ] ];
+            for ( int32 j = 0; j < my; ++j )
+              for ( int32 i = 0; i < mx; ++i )
+                t[ ( qy[j] - py[y] + 1 ) * 3 + ( qx[i] - px[x] + 1 ) ] += wx[x] * wy[y] * s * vx[i] * vy[j];
+          }
+      }
+    }
+  }
+
+  // A multigrid V-cycle on levels[l] and below
+  void cycle( std::vector<Level>& levels, size_t l ) {
+    Level& fine = levels[l];
+    if ( l + 1 == levels.size() ) {
+      fine.smooth( 50 );
+      return;
+    }
+    fine.smooth( 2 );
+
+    Level& coarse = levels[l+1];
+    const int32 cplane = coarse.cols * coarse.rows;
+    std::fill( coarse.values.data(), coarse.values.data() + cplane * coarse.planes, 0.0 );
+    std::fill( coarse.rhs.data(), coarse.rhs.data() + cplane * coarse.planes, 0.0 );
+    int32 px[2], py[2];
+    double wx[2], wy[2];
+    for ( size_t u = 0; u < fine.index.size(); ++u ) {
+      int32 nx = parents( fine.index[u] % fine.cols, px, wx );
+      int32 ny = parents( fine.index[u] / fine.cols, py, wy );
+      for ( int32 p = 0; p < fine.planes; ++p ) {
+        double r = fine.residual( u, p );
+        for ( int32 y = 0; y < ny; ++y )
+          for ( int32 x = 0; x < nx; ++x )
+            coarse.rhs( px[x], py[y], p ) += wx[x] * wy[y] * r;
+      }
+    }
+
+    cycle( levels, l + 1 );
+
+    for ( size_t u = 0; u < fine.index.size(); ++u ) {
+      int32 col = fine.index[u] % fine.cols, row = fine.index[u] / fine.cols;
+      int32 nx = parents( col, px, wx ), ny = parents( row, py, wy );
+      for ( int32 p = 0; p < fine.planes; ++p )
+        for ( int32 y = 0; y < ny; ++y )
+          for ( int32 x = 0; x < nx; ++x )
+            fine.values( col, row, p ) += wx[x] * wy[y] * coarse.values( px[x], py[y], p );
+    }
+    fine.smooth( 2 );
+  }
+
+}
+
+void diffuse( ImageView<double>& values, ImageView<uint8> const& state ) {
+  VW_ASSERT( values.cols() == state.cols() && values.rows() == state.rows(),
+             ArgumentErr() << "inpaint: values and states differ in size." );
+  const int32 cols = values.cols(), rows = values.rows();
+
+  // Converge relative to the spread of the known values
+  double lo = 0, hi = 0;
+  bool first = true;
+  for ( int32 p = 0; p < values.planes(); ++p )
+    for ( int32 row = 0; row < rows; ++row )
+      for ( int32 col = 0; col < cols; ++col ) {
+        if ( state( col, row ) != Known )
+          continue;
+        double v = values( col, row, p );
+        lo = first ? v : std::min( lo, v );
+        hi = first ? v : std::max( hi, v );
+        first = false;
+      }
+  const double tolerance = 1e-5 * ( hi - lo );
+
+  // Unknown pixels with nothing around them to diffuse from are left
+  // out of the equations.
+  std::vector<Level> levels( 1 );
+  Level& top = levels[0];
+  top.state = copy( state );
+  top.init( values.planes() );
+  top.values = values;
+  for ( int32 row = 0; row < rows; ++row )
+    for ( int32 col = 0; col < cols; ++col ) {
+      if ( state( col, row ) != Unknown )
+        continue;
+      double s[9], total = 0;
+      for ( int32 k = 0; k < 9; ++k ) {
+        int32 c = col + k % 3 - 1, r = row + k / 3 - 1;
+        bool used = c >= 0 && c < cols && r >= 0 && r < rows && state( c, r ) != Excluded;
+        s[k] = used ? -stencil_w[k] : 0;
+        total += s[k];
+      }
+      if ( total == 0 ) {
+        top.state( col, row ) = Excluded;
+        continue;
+      }
+      s[4] = -total;
+      top.index.push_back( row * cols + col );
+      top.a.insert( top.a.end(), s, s + 9 );
+    }
+  if ( top.index.empty() )
+    return;
+
+  // Start from the mean of the known values
+  for ( int32 p = 0; p < values.planes(); ++p ) {
+    double sum = 0;
+    int32 known = 0;
+    for ( int32 row = 0; row < rows; ++row )
+      for ( int32 col = 0; col < cols; ++col )
+        if ( state( col, row ) == Known ) {
+          sum += values( col, row, p );
+          ++known;
+        }
+    double mean = known ? sum / known : 0.0;
+    for ( int32 row = 0; row < rows; ++row )
+      for ( int32 col = 0; col < cols; ++col )
+        if ( state( col, row ) == Unknown )
+          values( col, row, p ) = mean;
+  }
+
+  // Coarsen until the unknowns can be solved for directly
+  while ( levels.back().index.size() > 16 ) {
+    levels.push_back( Level() );
+    coarsen( levels[ levels.size() - 2 ], levels.back() );
+  }
+
+  // Cycle until the fill stops moving
+  Level& fine = levels[0];
+  const int32 plane = cols * rows;
+  std::vector<double> last( fine.index.size() * fine.planes );
+  for ( int32 iteration = 0; iteration < 100; ++iteration ) {
+    for ( size_t u = 0; u < fine.index.size(); ++u )
+      for ( int32 p = 0; p < fine.planes; ++p )
+        last[ u * fine.planes + p ] = fine.values.data()[ p * plane + fine.index[u] ];
+    cycle( levels, 0 );
+    double change = 0;
+    for ( size_t u = 0; u < fine.index.size(); ++u )
+      for ( int32 p = 0; p < fine.planes; ++p )
+        change = std::max( change, std::fabs( fine.values.data()[ p * plane + fine.index[u] ] -
+                                              last[ u * fine.planes + p ] ) );
+    if ( change <= tolerance )
+      break;
+  }
+}
+
+}} // namespace vw::inpaint_p
@@ -18,14 +18,41 @@
 
 /// \file InpaintView.h
 ///
+/// Hole filling.
+///
+/// InpaintView fills the blobs of a BlobIndexThreaded, which are
+/// found one tile at a time and so can come from an image of any
+/// size. Each blob is filled on its own, from a crop of the blob and
+/// a one pixel border, into a patch:
+///
+/// - The diffusion fill solves for the values that are the stencil
+///   weighted mean of their neighbors, which is what repeated
+///   diffusion sweeps converge to. It is solved by multigrid over a
+///   pyramid of the patch, cycling until the fill stops changing, so
+///   large holes cost about as much per pixel as small ones.
+/// - Otherwise blobs are filled with a constant.
+///
+/// Patches are kept in a vw::Cache. A tile only reads its own pixels
+/// from the source and copies in the patches of the blobs that touch
+/// it, so a blob that straddles several tiles is filled once and the
+/// tiles around it never load its neighborhood. solve() fills all
+/// blobs ahead of time on a thread pool, largest first.
+///
 
 #ifndef __VW_IMAGE_INPAINTVIEW_H__
 #define __VW_IMAGE_INPAINTVIEW_H__
 
 // Standard
+#include <algorithm>
+#include <exception>
+#include <list>
+#include <utility>
 #include <vector>
 
 // VW
+#include <vw/Core/Cache.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/System.h>
 #include <vw/Core/Thread.h>
 #include <vw/Core/ThreadPool.h>
 #include <vw/Core/Stopwatch.h>
@@ -33,118 +60,252 @@
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/MaskViews.h>
 #include <vw/Image/BlobIndex.h>
-#include <vw/Image/SparseView.h>
 
-#include <boost/foreach.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
 
 namespace vw {
   namespace inpaint_p {
 
-    // Semi-private tasks that I wouldn't like the user to know about
-    //
-    // This is used for threaded rendering
-    template <class ViewT, class SViewT>
-    class InpaintTask : public Task, boost::noncopyable {
-      ViewT const& m_view;
-      blob::BlobCompressed m_c_blob;
+    // States of the pixels of a patch
+    enum { Known = 0, Unknown = 1, Excluded = 2 };
+
+    // Replaces the Unknown pixels of values with the solution of the
+    // diffusion fill, using the Known pixels around them. Excluded
+    // pixels are neither used nor changed. Each plane is a channel.
+    void diffuse( ImageView<double>& values, ImageView<uint8> const& state );
+
+    // A filled blob. Pixels outside the blob are left unset.
+    template <class PixelT>
+    struct InpaintPatch {
+      BBox2i            bbox;   // Bounding box of the blob
+      ImageView<PixelT> values;
+      ImageView<uint8>  mask;   // Nonzero on the blob
+    };
+
+    // Fills one blob for the cache
+    template <class ViewT>
+    class InpaintPatchGenerator {
+      typedef typename ViewT::pixel_type pixel_type;
+      boost::shared_ptr<const ViewT> m_view;
+      blob::BlobCompressed const*    m_blob;
+      bool       m_use_grassfire;
+      pixel_type m_default_inpaint_val;
+
+    public:
+      typedef InpaintPatch<pixel_type> value_type;
+
+      InpaintPatchGenerator( boost::shared_ptr<const ViewT> const& view,
+                             blob::BlobCompressed const& blob,
+                             bool use_grassfire, pixel_type default_inpaint_val )
+        : m_view(view), m_blob(&blob), m_use_grassfire(use_grassfire),
+          m_default_inpaint_val(default_inpaint_val) {}
+
+      size_t size() const {
+        BBox2i bbox = m_blob->bounding_box();
+        return sizeof(value_type) + size_t(bbox.width()) * bbox.height() * ( sizeof(pixel_type) + 1 );
+      }
+
+      boost::shared_ptr<value_type> generate() const {
+        typedef typename UnmaskedPixelType<pixel_type>::type unmasked_type;
+        typedef typename PixelChannelType<unmasked_type>::type channel_type;
+        const int32 channels = PixelNumChannels<unmasked_type>::value;
+
+        boost::shared_ptr<value_type> patch( new value_type );
+        patch->bbox = m_blob->bounding_box();
+        BBox2i support = patch->bbox;
+        support.expand(1);
+        ImageView<pixel_type> image = crop( *m_view, support );
+
+        // Excluded pixels are the holes of other blobs
+        ImageView<uint8> state( image.cols(), image.rows() );
+        for ( int32 row = 0; row < image.rows(); ++row )
+          for ( int32 col = 0; col < image.cols(); ++col )
+            state( col, row ) = is_valid( image( col, row ) ) ? Known : Excluded;
+        std::list<Vector2i> pixels;
+        m_blob->decompress( pixels );
+        for ( std::list<Vector2i>::const_iterator it = pixels.begin(); it != pixels.end(); ++it )
+          state( it->x() - support.min().x(), it->y() - support.min().y() ) = Unknown;
+
+        if ( m_use_grassfire ) {
+          ImageView<double> values( image.cols(), image.rows(), channels );
+          for ( int32 row = 0; row < image.rows(); ++row )
+            for ( int32 col = 0; col < image.cols(); ++col ) {
+              unmasked_type const& px = remove_mask( image( col, row ) );
+              for ( int32 c = 0; c < channels; ++c )
+                values( col, row, c ) = double( compound_select_channel<channel_type const&>( px, c ) );
+            }
+          diffuse( values, state );
+          for ( std::list<Vector2i>::const_iterator it = pixels.begin(); it != pixels.end(); ++it ) {
+            int32 col = it->x() - support.min().x(), row = it->y() - support.min().y();
+            unmasked_type px;
+            for ( int32 c = 0; c < channels; ++c )
+              compound_select_channel<channel_type&>( px, c ) =
+                channel_cast_round_if_int<channel_type>( values( col, row, c ) );
+            image( col, row ) = px;
+            validate( image( col, row ) );
+          }
+        } else {
+          for ( std::list<Vector2i>::const_iterator it = pixels.begin(); it != pixels.end(); ++it )
+            image( it->x() - support.min().x(), it->y() - support.min().y() ) = m_default_inpaint_val;
+        }
+
+        patch->values = crop( image, 1, 1, patch->bbox.width(), patch->bbox.height() );
+        patch->mask.set_size( patch->bbox.width(), patch->bbox.height() );
+        for ( int32 row = 0; row < patch->mask.rows(); ++row )
+          for ( int32 col = 0; col < patch->mask.cols(); ++col )
+            patch->mask( col, row ) = state( col + 1, row + 1 ) == Unknown;
+        return patch;
+      }
+    };
+
+    // The patches of all the blobs of an image, and a grid of buckets
+    // to find the blobs that touch a tile. Shared by the copies of an
+    // InpaintView.
+    template <class ViewT>
+    class InpaintPatches : private boost::noncopyable {
+    public:
+      typedef InpaintPatchGenerator<ViewT> generator_type;
+      typedef typename generator_type::value_type patch_type;
+
+    private:
+      BlobIndexThreaded const& m_bindex;
+      boost::shared_ptr<const ViewT> m_view;
       bool m_use_grassfire;
       typename ViewT::pixel_type m_default_inpaint_val;
-      SparseCompositeView<SViewT> & m_patches; // Store our output
+      Cache* m_cache;
+      int32 m_cell_size;
+      Vector2i m_grid;
+      std::vector<BBox2i> m_bboxes;
+      std::vector<std::vector<uint32> > m_cells;
+      mutable Mutex m_mutex;
+      mutable std::vector<Cache::Handle<generator_type> > m_handles;
+
+      // The first exception thrown by a blob is kept for solve() to
+      // rethrow, and the blobs after it are skipped.
+      class SolveTask : public Task, private boost::noncopyable {
+        InpaintPatches const& m_patches;
+        uint32 m_blob;
+        Mutex& m_mutex;
+        std::exception_ptr& m_error;
+      public:
+        SolveTask( InpaintPatches const& patches, uint32 blob,
+                   Mutex& mutex, std::exception_ptr& error )
+          : m_patches(patches), m_blob(blob), m_mutex(mutex), m_error(error) {}
+        void operator()() {
+          {
+            Mutex::Lock lock( m_mutex );
+            if ( m_error )
+              return;
+          }
+          try {
+            m_patches.patch( m_blob );
+          } catch ( ... ) {
+            Mutex::Lock lock( m_mutex );
+            if ( !m_error )
+              m_error = std::current_exception();
+          }
+        }
+      };
 
     public:
-      InpaintTask( ImageViewBase<ViewT> const& view,
-                   blob::BlobCompressed const& c_blob,
-                   bool use_grassfire,
-                   typename ViewT::pixel_type default_inpaint_val,
-                   SparseCompositeView<SViewT> & sparse ) :
-        m_view(view.impl()), m_c_blob(c_blob),
-        m_use_grassfire(use_grassfire), m_default_inpaint_val(default_inpaint_val),
-        m_patches(sparse) {}
-
-      void operator()() {
-        using namespace vw;
-
-        typedef typename ViewT::pixel_type pixel_type;
-
-        // Gathering information about blob
-        BBox2i bbox = m_c_blob.bounding_box();
-        bbox.expand(1);
-
-        // How do we want to handle spots on the edges?
-        if ( bbox.min().x() < 0 || bbox.min().y() < 0 ||
-             bbox.max().x() >= m_view.impl().cols() ||
-             bbox.max().y() >= m_view.impl().rows() ) {
-          return;
+      InpaintPatches( ViewT const& view, BlobIndexThreaded const& bindex,
+                      bool use_grassfire, typename ViewT::pixel_type default_inpaint_val,
+                      Cache& cache )
+        : m_bindex(bindex), m_view( new ViewT(view) ), m_use_grassfire(use_grassfire),
+          m_default_inpaint_val(default_inpaint_val), m_cache(&cache),
+          m_cell_size( vw_settings().default_tile_size() ), m_handles( bindex.num_blobs() ) {
+        m_grid = Vector2i( ( view.cols() + m_cell_size - 1 ) / m_cell_size,
+                           ( view.rows() + m_cell_size - 1 ) / m_cell_size );
+        m_cells.resize( m_grid.x() * m_grid.y() );
+        m_bboxes.resize( bindex.num_blobs() );
+        BBox2i image( 0, 0, view.cols(), view.rows() );
+        for ( uint32 i = 0; i < bindex.num_blobs(); ++i ) {
+          m_bboxes[i] = bindex.compressed_blob(i).bounding_box();
+
+          // Blobs on the edge of the image are not holes. Neither are
+          // blobs whose border reaches the last row or column.
+          BBox2i support = m_bboxes[i];
+          support.expand(1);
+          if ( support.min().x() < 0 || support.min().y() < 0 ||
+               support.max().x() >= view.cols() || support.max().y() >= view.rows() )
+            continue;
+          for ( int32 y = m_bboxes[i].min().y() / m_cell_size;
+                y <= ( m_bboxes[i].max().y() - 1 ) / m_cell_size; ++y )
+            for ( int32 x = m_bboxes[i].min().x() / m_cell_size;
+                  x <= ( m_bboxes[i].max().x() - 1 ) / m_cell_size; ++x )
+              m_cells[ y * m_grid.x() + x ].push_back( i );
         }
+      }
 
-        std::list<Vector2i> blob;
-        m_c_blob.decompress( blob );
-        for ( std::list<Vector2i>::iterator iter = blob.begin();
-              iter != blob.end(); iter++ )
-          *iter -= bbox.min();
-
-        // Building a cropped copy for my patch
-        ImageView<pixel_type> cropped_copy =
-          crop( m_view, bbox );
-
-        // Creating binary image to highlight hole
-        ImageView<uint8> mask( bbox.width(), bbox.height() );
-        fill( mask, 0 );
-        for ( std::list<Vector2i>::const_iterator iter = blob.begin();
-              iter != blob.end(); iter++ )
-          mask( iter->x(), iter->y() ) = 255;
-
-        if (m_use_grassfire){
-          ImageView<int32> distance = grassfire(mask);
-          int max_distance = max_pixel_value( distance );
-
-          // Working out order of convolution
-          std::list<Vector2i> processing_order;
-          for ( int d = 1; d < max_distance+1; d++ )
-            for ( int i = 0; i < bbox.width(); i++ )
-              for ( int j = 0; j < bbox.height(); j++ )
-                if ( distance(i,j) == d ) {
-                  processing_order.push_back( Vector2i(i,j) );
-                }
-
-          // Iterate and apply convolution seperately to each channel
-          typedef typename CompoundChannelCast<pixel_type,float>::type AccumulatorType;
-          for ( int d = 0; d < 10*max_distance*max_distance; d++ )
-            BOOST_FOREACH( Vector2i const& l, processing_order ) {
-              typename ImageView<pixel_type>::pixel_accessor pit =
-                cropped_copy.origin();
-              pit.advance( l.x() - 1, l.y() - 1 );
-
-              AccumulatorType sum;
-              sum += .176765 * (*pit);
-              pit.next_col();
-              sum += .073235 * (*pit);
-              pit.next_col();
-              sum += .176765 * (*pit);
-              pit.advance( -2, 1 );
-              sum += .073235 * (*pit);
-              pit.advance( 2, 0 );
-              sum += .073235 * (*pit);
-              pit.advance( -2, 1 );
-              sum += .176765 * (*pit);
-              pit.next_col();
-              sum += .073235 * (*pit);
-              pit.next_col();
-              sum += .176765 * (*pit);
-
-              sum.validate();
-              cropped_copy(l.x(),l.y()) = sum;
-            }
-        }else{
-          for ( std::list<Vector2i>::const_iterator iter = blob.begin();
-                iter != blob.end(); iter++ )
-            cropped_copy( iter->x(), iter->y() ) = m_default_inpaint_val;
-        }
+      /// The blobs that have pixels in bbox
+      std::vector<uint32> blobs( BBox2i const& bbox ) const {
+        std::vector<uint32> result;
+        BBox2i area = bbox;
+        area.crop( BBox2i( 0, 0, m_view->cols(), m_view->rows() ) );
+        if ( area.empty() )
+          return result;
+        for ( int32 y = area.min().y() / m_cell_size; y <= ( area.max().y() - 1 ) / m_cell_size; ++y )
+          for ( int32 x = area.min().x() / m_cell_size; x <= ( area.max().x() - 1 ) / m_cell_size; ++x ) {
+            std::vector<uint32> const& cell = m_cells[ y * m_grid.x() + x ];
+            result.insert( result.end(), cell.begin(), cell.end() );
+          }
+        std::sort( result.begin(), result.end() );
+        result.erase( std::unique( result.begin(), result.end() ), result.end() );
+
+        std::vector<uint32>::iterator last = result.begin();
+        for ( std::vector<uint32>::const_iterator it = result.begin(); it != result.end(); ++it )
+          if ( m_bboxes[*it].intersects( area ) && m_bindex.compressed_blob(*it).intersects( area ) )
+            *last++ = *it;
+        result.erase( last, result.end() );
+        return result;
+      }
 
-        // Insert results into sparse view
-        m_patches.absorb(bbox.min(),copy_mask(cropped_copy,create_mask( mask, 0 )));
+      /// The filled patch of a blob, from the cache if it is there
+      boost::shared_ptr<patch_type> patch( uint32 blob ) const {
+        Cache::Handle<generator_type> handle;
+        {
+          Mutex::WriteLock lock( m_mutex );
+          Cache::Handle<generator_type>& entry = m_handles[blob];
+          if ( !entry.attached() )
+            entry = m_cache->insert( generator_type( m_view, m_bindex.compressed_blob(blob),
+                                                     m_use_grassfire, m_default_inpaint_val ) );
+          handle = entry;
+        }
+        boost::shared_ptr<patch_type> result = handle;
+        handle.release();
+        return result;
       }
 
+      /// Fills every blob that is a hole, biggest first
+      void solve( int32 num_threads ) const {
+        std::vector<std::pair<int64,uint32> > order;
+        for ( size_t c = 0; c < m_cells.size(); ++c )
+          for ( size_t i = 0; i < m_cells[c].size(); ++i ) {
+            BBox2i const& bbox = m_bboxes[ m_cells[c][i] ];
+            order.push_back( std::make_pair( -int64(bbox.width()) * bbox.height(), m_cells[c][i] ) );
+          }
+        std::sort( order.begin(), order.end() );
+        order.erase( std::unique( order.begin(), order.end() ), order.end() );
+
+        Stopwatch sw;
+        sw.start();
+        Mutex mutex;
+        std::exception_ptr error;
+        {
+          FifoWorkQueue queue( num_threads );
+          for ( size_t i = 0; i < order.size(); ++i ) {
+            boost::shared_ptr<Task> task( new SolveTask( *this, order[i].second, mutex, error ) );
+            queue.add_task( task );
+          }
+          queue.join_all();
+        }
+        if ( error )
+          std::rethrow_exception( error );
+        sw.stop();
+        vw_out(DebugMessage,"inpaint") << "Filling " << order.size() << " holes took "
+                                       << sw.elapsed_seconds() << "s\n";
+      }
     };
 
   } // end namespace inpaint_p
@@ -155,9 +316,7 @@ namespace vw {
   class InpaintView : public ImageViewBase<InpaintView<ViewT> > {
 
     ViewT m_child;
-    BlobIndexThreaded const& m_bindex;
-    bool m_use_grassfire;
-    typename ViewT::pixel_type m_default_inpaint_val;
+    boost::shared_ptr<inpaint_p::InpaintPatches<ViewT> > m_patches;
 
   public:
     typedef typename UnmaskedPixelType<typename ViewT::pixel_type>::type sparse_type;
@@ -165,12 +324,16 @@ namespace vw {
     typedef pixel_type result_type; // We can't return references
     typedef ProceduralPixelAccessor<InpaintView<ViewT> > pixel_accessor;
 
+    /// The blob index must outlive the view.  Blobs touching the edge
+    /// of the image are left alone.
     InpaintView( ImageViewBase<ViewT> const& image,
                  BlobIndexThreaded const& bindex,
                  bool use_grassfire,
-                 pixel_type default_inpaint_val):
-      m_child(image.impl()), m_bindex(bindex),
-      m_use_grassfire(use_grassfire), m_default_inpaint_val(default_inpaint_val) {}
+                 pixel_type default_inpaint_val,
+                 Cache& cache = vw_system_cache() ):
+      m_child(image.impl()),
+      m_patches( new inpaint_p::InpaintPatches<ViewT>( image.impl(), bindex, use_grassfire,
+                                                       default_inpaint_val, cache ) ) {}
 
     inline int32 cols  () const { return m_child.cols(); }
     inline int32 rows  () const { return m_child.rows(); }
@@ -179,47 +342,36 @@ namespace vw {
     inline pixel_accessor origin() const { return pixel_accessor(*this,0,0); }
 
     inline result_type operator()( int32 i, int32 j, int32 /*p*/=0 ) const {
-      vw_throw( NoImplErr() << "Per pixel access is not provided for InpaintView" );
+      return prerasterize( BBox2i( i, j, 1, 1 ) )( i, j );
+    }
+
+    /// Fills all the holes now, on num_threads threads, instead of as
+    /// tiles need them.  The largest holes go first so that they do not
+    /// hold up the end of the run.  Only useful when the cache has room
+    /// for all the patches.  An exception thrown while filling a hole is
+    /// rethrown here once the threads have finished.
+    void solve( int32 num_threads = vw_settings().default_num_threads() ) const {
+      m_patches->solve( num_threads );
     }
 
-    typedef CropView<ImageView<pixel_type> >    inner_pre_type;
-    typedef SparseCompositeView<inner_pre_type> prerasterize_type;
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
-      using namespace vw;
-
-      // Expand the preraster size to include all the area that our patches use
-      // - This makes sure all contained blobs are identified and fully contained
-      std::vector<size_t> intersections;
-      intersections.reserve(20);
-      BBox2i bbox_expanded = bbox;
-      for ( size_t i = 0; i < m_bindex.num_blobs(); i++ ) {
-        if ( m_bindex.blob_bbox(i).intersects( bbox ) && // Early exit option
-             m_bindex.compressed_blob(i).intersects( bbox ) ) {
-          bbox_expanded.grow( m_bindex.blob_bbox(i) );
-          intersections.push_back(i);
-        }
+      ImageView<pixel_type> tile = crop( m_child, bbox );
+
+      std::vector<uint32> blobs = m_patches->blobs( bbox );
+      for ( size_t i = 0; i < blobs.size(); ++i ) {
+        boost::shared_ptr<typename inpaint_p::InpaintPatches<ViewT>::patch_type> patch =
+          m_patches->patch( blobs[i] );
+        BBox2i overlap = patch->bbox;
+        overlap.crop( bbox );
+        for ( int32 row = overlap.min().y(); row < overlap.max().y(); ++row )
+          for ( int32 col = overlap.min().x(); col < overlap.max().x(); ++col ) {
+            int32 pc = col - patch->bbox.min().x(), pr = row - patch->bbox.min().y();
+            if ( patch->mask( pc, pr ) )
+              tile( col - bbox.min().x(), row - bbox.min().y() ) = patch->values( pc, pr );
+          }
       }
-      // Expand by one more pixel, then make sure the BB has not exceeded the image bounds.
-      bbox_expanded.expand(1);
-      bbox_expanded.crop( BBox2i(0,0,cols(),rows()) );
-
-      // Generate sparse view that will hold background data and all the patches.
-      inner_pre_type preraster =
-        crop(ImageView<pixel_type>(crop(m_child,bbox_expanded)),
-             -bbox_expanded.min().x(), -bbox_expanded.min().y(), cols(), rows());
-      SparseCompositeView<inner_pre_type> patched_view( preraster );
-
-      // Build up the patches that intersect our tile
-      // - For each intersecting blob, use InpaintTask to fill in that blob
-      typedef inpaint_p::InpaintTask<inner_pre_type, inner_pre_type> task_type;
-      for ( std::vector<size_t>::const_iterator it = intersections.begin();
-            it != intersections.end(); it++ ) {
-        task_type task( preraster, m_bindex.compressed_blob(*it), m_use_grassfire,
-                        m_default_inpaint_val, patched_view );
-        task();
-      }
-
-      return patched_view;
+      return prerasterize_type( tile, -bbox.min().x(), -bbox.min().y(), cols(), rows() );
     }
     template <class DestT>
     inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
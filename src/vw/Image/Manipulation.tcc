@@ -560,6 +560,10 @@ public:
     return m_child;
   }
 
+  /// Position of the crop in the child
+  offset_type col_offset() const { return m_ci; }
+  offset_type row_offset() const { return m_cj; }
+
   /// \cond INTERNAL
   typedef CropView<typename ImageT::prerasterize_type> prerasterize_type;
   inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
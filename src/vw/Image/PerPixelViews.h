@@ -28,11 +28,25 @@
 #include <boost/mpl/if.hpp>
 #include <boost/utility/result_of.hpp>
 
+#include <vw/Core/CompoundTypes.h>
+#include <vw/Core/Functors.h>
 #include <vw/Image/ImageViewBase.h>
+#include <vw/Image/ImageView.h>
 #include <vw/Image/PixelAccessors.h>
+#include <vw/Image/PixelTypeInfo.h>
 
 namespace vw {
 
+  /// \cond INTERNAL
+  namespace perpixel_p {
+    // Rasterizes a chain of per-pixel views over ImageViews a row at a
+    // time, and any other view through its pixel accessors.  Defined
+    // in PerPixelViews.tcc.
+    template <class SrcT, class DestT>
+    inline void fused_rasterize( SrcT const& src, DestT const& dest, BBox2i const& bbox );
+  }
+  /// \endcond
+
   // *******************************************************************
   // PerPixelIndexView
   // *******************************************************************
@@ -124,10 +138,13 @@ namespace vw {
       return *this;
     }
 
+    ImageT const& child() const { return m_image; }
+    FuncT  const& func () const { return m_func;  }
+
     /// \cond INTERNAL
     typedef UnaryPerPixelView<typename ImageT::prerasterize_type, FuncT> prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i const& bbox ) const { return prerasterize_type( m_image.prerasterize(bbox), m_func ); }
-    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { perpixel_p::fused_rasterize( prerasterize(bbox), dest, bbox ); }
     /// \endcond
   };
 
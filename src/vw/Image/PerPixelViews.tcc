@@ -88,10 +88,14 @@ namespace vw {
     inline pixel_accessor origin() const { return pixel_accessor(m_image1.origin(),m_image2.origin(),m_func); }
     inline result_type operator()( int32 i, int32 j, int32 p=0 ) const { return m_func(m_image1(i,j,p),m_image2(i,j,p)); }
 
+    Image1T const& child1() const { return m_image1; }
+    Image2T const& child2() const { return m_image2; }
+    FuncT   const& func  () const { return m_func;   }
+
     /// \cond INTERNAL
     typedef BinaryPerPixelView<typename Image1T::prerasterize_type, typename Image2T::prerasterize_type, FuncT> prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i const& bbox ) const { return prerasterize_type( m_image1.prerasterize(bbox), m_image2.prerasterize(bbox), m_func ); }
-    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { perpixel_p::fused_rasterize( prerasterize(bbox), dest, bbox ); }
     /// \endcond
   };
 
@@ -285,8 +289,224 @@ namespace vw {
   };
 
 
+  // *******************************************************************
+  // Row evaluation of per-pixel view chains
+  // *******************************************************************
 
+  /// \cond INTERNAL
+  template <class ImageT>   class CropView;
+  template <class ChildT>   struct PixelMask;
+  template <class ChannelT> struct PixelChannelCastFunctor;
+  template <class ChannelT> struct PixelChannelCastRescaleFunctor;
+
+  namespace perpixel_p {
+
+    // Pixels that are a plain array of their channels
+    template <class PixelT>
+    struct IsFlatPixel
+      : boost::mpl::bool_< IsCompound<PixelT>::value &&
+                           sizeof(PixelT) == CompoundNumChannels<PixelT>::value *
+                                             sizeof(typename CompoundChannelType<PixelT>::type) > {};
+
+    template <class ChildT>
+    struct IsFlatPixel<PixelMask<ChildT> > : boost::false_type {};
+
+    // Pixel functors that act on each channel on its own.  type is the
+    // functor to apply to the channels instead, or void.
+    template <class FuncT>
+    struct ChannelFunctor { typedef void type; };
+
+    template <class ChanFuncT, class ArgT>
+    struct ChannelFunctor<UnaryCompoundFunctor<ChanFuncT,ArgT> > {
+      typedef ChanFuncT type;
+      static ChanFuncT const& get( UnaryCompoundFunctor<ChanFuncT,ArgT> const& func ) { return func.channel_functor(); }
+    };
+
+    template <class ChannelT>
+    struct ChannelFunctor<PixelChannelCastFunctor<ChannelT> > {
+      typedef ChannelCastFunctor<ChannelT> type;
+      static type get( PixelChannelCastFunctor<ChannelT> const& ) { return type(); }
+    };
+
+    template <class ChannelT>
+    struct ChannelFunctor<PixelChannelCastRescaleFunctor<ChannelT> > {
+      typedef ChannelCastRescaleFunctor<ChannelT> type;
+      static type get( PixelChannelCastRescaleFunctor<ChannelT> const& ) { return type(); }
+    };
+
+    // Pixel arithmetic is per channel, as long as any value is a scalar
+#define VW_PERPIXEL_CHANNEL_FUNCTOR(ftor)                                    \
+    template <>                                                             \
+    struct ChannelFunctor<ftor> {                                           \
+      typedef ftor type;                                                    \
+      static ftor const& get( ftor const& func ) { return func; }           \
+    };
+#define VW_PERPIXEL_CHANNEL_VAL_FUNCTOR(ftor)                                \
+    template <class ValT>                                                   \
+    struct ChannelFunctor<ftor<ValT> > {                                    \
+      typedef typename boost::mpl::if_<IsScalar<ValT>, ftor<ValT>, void>::type type; \
+      static ftor<ValT> const& get( ftor<ValT> const& func ) { return func; } \
+    };
+
+    VW_PERPIXEL_CHANNEL_FUNCTOR(ArgNegationFunctor)
+    VW_PERPIXEL_CHANNEL_FUNCTOR(ArgArgSumFunctor)
+    VW_PERPIXEL_CHANNEL_FUNCTOR(ArgArgDifferenceFunctor)
+    VW_PERPIXEL_CHANNEL_FUNCTOR(ArgArgProductFunctor)
+    VW_PERPIXEL_CHANNEL_FUNCTOR(ArgArgQuotientFunctor)
+    VW_PERPIXEL_CHANNEL_VAL_FUNCTOR(ArgValSumFunctor)
+    VW_PERPIXEL_CHANNEL_VAL_FUNCTOR(ValArgSumFunctor)
+    VW_PERPIXEL_CHANNEL_VAL_FUNCTOR(ArgValDifferenceFunctor)
+    VW_PERPIXEL_CHANNEL_VAL_FUNCTOR(ValArgDifferenceFunctor)
+    VW_PERPIXEL_CHANNEL_VAL_FUNCTOR(ArgValProductFunctor)
+    VW_PERPIXEL_CHANNEL_VAL_FUNCTOR(ValArgProductFunctor)
+    VW_PERPIXEL_CHANNEL_VAL_FUNCTOR(ArgValQuotientFunctor)
+    VW_PERPIXEL_CHANNEL_VAL_FUNCTOR(ValArgQuotientFunctor)
+
+#undef VW_PERPIXEL_CHANNEL_FUNCTOR
+#undef VW_PERPIXEL_CHANNEL_VAL_FUNCTOR
+
+    // Whether a functor from ArgT to ResultT can run on the channels
+    template <class FuncT, class ArgT, class ResultT>
+    struct IsChannelwise
+      : boost::mpl::bool_< !boost::is_void<typename ChannelFunctor<FuncT>::type>::value &&
+                           IsFlatPixel<ArgT>::value && IsFlatPixel<ResultT>::value &&
+                           int(CompoundNumChannels<ArgT>::value) == int(CompoundNumChannels<ResultT>::value) > {};
+
+    // RowEvaluator<ViewT> evaluates an ImageView, a crop of one, or a
+    // chain of per-pixel views over those along a row of raw pointers.
+    // seek(i,j,p) moves to the row starting at (i,j) in plane p, after
+    // which [k] is the pixel k columns along.  The whole chain inlines
+    // into a single loop over the row, which the compiler can
+    // vectorize.  When every pixel in the chain is a flat array of
+    // channels and every functor acts on each channel on its own,
+    // channel(k) runs the chain on the k'th channel of the row
+    // instead.  For any other view value is false.
+    template <class ViewT>
+    struct RowEvaluator : boost::false_type {
+      static const bool channelwise = false;
+    };
+
+    template <class ViewT, class PixelT>
+    struct RowLeaf : boost::true_type {
+      typedef typename CompoundChannelType<PixelT>::type channel_type;
+      static const bool channelwise = IsFlatPixel<PixelT>::value;
+      ViewT const& m_view;
+      PixelT* m_row;
+      RowLeaf( ViewT const& view ) : m_view(view), m_row(0) {}
+      inline void seek( int32 i, int32 j, int32 p ) { m_row = &m_view(i,j,p); }
+      inline PixelT& operator[]( int32 k ) const { return m_row[k]; }
+      inline channel_type& channel( int32 k ) const { return reinterpret_cast<channel_type*>(m_row)[k]; }
+    };
+
+    template <class PixelT>
+    struct RowEvaluator<ImageView<PixelT> > : RowLeaf<ImageView<PixelT>,PixelT> {
+      RowEvaluator( ImageView<PixelT> const& view ) : RowLeaf<ImageView<PixelT>,PixelT>(view) {}
+    };
+
+    template <class PixelT>
+    struct RowEvaluator<CropView<ImageView<PixelT> > > : RowLeaf<CropView<ImageView<PixelT> >,PixelT> {
+      RowEvaluator( CropView<ImageView<PixelT> > const& view ) : RowLeaf<CropView<ImageView<PixelT> >,PixelT>(view) {}
+    };
+
+    template <class ImageT, class FuncT>
+    struct RowEvaluator<UnaryPerPixelView<ImageT,FuncT> > : RowEvaluator<ImageT>::type {
+      typedef UnaryPerPixelView<ImageT,FuncT> view_type;
+      typedef typename CompoundChannelType<typename view_type::pixel_type>::type channel_type;
+      static const bool channelwise = RowEvaluator<ImageT>::channelwise &&
+        IsChannelwise<FuncT, typename ImageT::pixel_type, typename view_type::pixel_type>::value;
+      RowEvaluator<ImageT> m_child;
+      FuncT                m_func;
+      RowEvaluator( view_type const& view ) : m_child(view.child()), m_func(view.func()) {}
+      inline void seek( int32 i, int32 j, int32 p ) { m_child.seek(i,j,p); }
+      inline typename view_type::result_type operator[]( int32 k ) const {
+        return m_func( m_child[k] );
+      }
+      inline channel_type channel( int32 k ) const {
+        return channel_type( ChannelFunctor<FuncT>::get(m_func)( m_child.channel(k) ) );
+      }
+    };
+
+    template <class Image1T, class Image2T, class FuncT>
+    struct RowEvaluator<BinaryPerPixelView<Image1T,Image2T,FuncT> >
+      : boost::mpl::and_<RowEvaluator<Image1T>, RowEvaluator<Image2T> >::type {
+      typedef BinaryPerPixelView<Image1T,Image2T,FuncT> view_type;
+      typedef typename CompoundChannelType<typename view_type::pixel_type>::type channel_type;
+      static const bool channelwise = RowEvaluator<Image1T>::channelwise && RowEvaluator<Image2T>::channelwise &&
+        IsChannelwise<FuncT, typename Image1T::pixel_type, typename view_type::pixel_type>::value &&
+        IsChannelwise<FuncT, typename Image2T::pixel_type, typename view_type::pixel_type>::value;
+      RowEvaluator<Image1T> m_child1;
+      RowEvaluator<Image2T> m_child2;
+      FuncT                 m_func;
+      RowEvaluator( view_type const& view )
+        : m_child1(view.child1()), m_child2(view.child2()), m_func(view.func()) {}
+      inline void seek( int32 i, int32 j, int32 p ) { m_child1.seek(i,j,p); m_child2.seek(i,j,p); }
+      inline typename view_type::result_type operator[]( int32 k ) const {
+        return m_func( m_child1[k], m_child2[k] );
+      }
+      inline channel_type channel( int32 k ) const {
+        return channel_type( ChannelFunctor<FuncT>::get(m_func)( m_child1.channel(k), m_child2.channel(k) ) );
+      }
+    };
+
+    // Destinations that can be written a row at a time
+    template <class DestT>
+    struct RowDestination : boost::false_type {};
+
+    template <class PixelT>
+    struct RowDestination<ImageView<PixelT> > : boost::true_type {};
+
+    template <class PixelT>
+    struct RowDestination<CropView<ImageView<PixelT> > > : boost::true_type {};
+
+    template <class EvalT, class DestPixelT>
+    inline void rasterize_row( EvalT const& eval, DestPixelT* dest, int32 width, boost::mpl::false_ ) {
+      for ( int32 k = 0; k < width; ++k )
+        dest[k] = DestPixelT( eval[k] );
+    }
+
+    template <class EvalT, class DestPixelT>
+    inline void rasterize_row( EvalT const& eval, DestPixelT* dest, int32 width, boost::mpl::true_ ) {
+      typedef typename CompoundChannelType<DestPixelT>::type channel_type;
+      channel_type* d = reinterpret_cast<channel_type*>( dest );
+      const int32 count = width * int32( CompoundNumChannels<DestPixelT>::value );
+      for ( int32 k = 0; k < count; ++k )
+        d[k] = channel_type( eval.channel(k) );
+    }
+
+    template <class SrcT, class DestT>
+    inline void fused_rasterize( SrcT const& src, DestT const& dest, BBox2i const& bbox, boost::mpl::false_ ) {
+      vw::rasterize( src, dest, bbox );
+    }
+
+    template <class SrcT, class DestT>
+    void fused_rasterize( SrcT const& src, DestT const& dest, BBox2i const& bbox, boost::mpl::true_ ) {
+      typedef typename SrcT::pixel_type  src_pixel_type;
+      typedef typename DestT::pixel_type dest_pixel_type;
+      typedef typename CompoundChannelType<dest_pixel_type>::type dest_channel_type;
+      // Channels are converted one at a time only when that is all the
+      // pixel conversion does.
+      typedef boost::mpl::bool_< RowEvaluator<SrcT>::channelwise && IsFlatPixel<dest_pixel_type>::value &&
+        boost::is_same<typename CompoundChannelCast<src_pixel_type,dest_channel_type>::type, dest_pixel_type>::value > channelwise;
+      VW_ASSERT( int(dest.cols())==bbox.width() && int(dest.rows())==bbox.height() && dest.planes()==src.planes(),
+                 ArgumentErr() << "rasterize: Source and destination must have same dimensions." );
+      if ( bbox.width() <= 0 )
+        return;
+      RowEvaluator<SrcT> eval( src );
+      for ( int32 p = 0; p < src.planes(); ++p )
+        for ( int32 row = 0; row < bbox.height(); ++row ) {
+          eval.seek( bbox.min().x(), bbox.min().y() + row, p );
+          rasterize_row( eval, &dest( 0, row, p ), bbox.width(), channelwise() );
+        }
+    }
+
+    template <class SrcT, class DestT>
+    inline void fused_rasterize( SrcT const& src, DestT const& dest, BBox2i const& bbox ) {
+      typedef typename boost::mpl::and_<RowEvaluator<SrcT>, RowDestination<DestT> >::type fused;
+      fused_rasterize( src, dest, bbox, fused() );
+    }
 
+  } // namespace perpixel_p
+  /// \endcond
 
 } // End namespace vw
 
@@ -39,6 +39,13 @@
 /// - stddev_pixel_value
 /// - median_pixel_value
 /// - weighted_mean_pixel_value
+///
+/// Each function takes an optional number of threads, which defaults
+/// to one.  One thread visits the pixels in order with for_each_pixel().
+/// More threads read the image in blocks with reduce_blocks(), so the
+/// view must be safe to rasterize from several threads at once.  Sums
+/// are then added up block by block, which can change them in the last
+/// bits, and medians are estimated with math::QuantileAccumulator.
 
 #ifndef __VW_IMAGE_STATISTICS_H__
 #define __VW_IMAGE_STATISTICS_H__
@@ -69,14 +76,25 @@ namespace vw {
     }
   };
 
+  /// Applies an accumulator to every pixel of an image, in order with
+  /// one thread or in blocks with reduce_blocks() with more.  Used by
+  /// the functions below.
+  template <class ViewT, class AccumT>
+  void accumulate_pixels( ImageViewBase<ViewT> const& view, AccumT& accumulator, int num_threads ) {
+    if ( num_threads > 1 )
+      reduce_blocks( view, accumulator, Vector2i(256,256), num_threads );
+    else
+      for_each_pixel( view, accumulator );
+  }
+
   /// Compute the minimum value stored in all of the channels of all
   /// of the planes of the images.
   template <class ViewT>
   typename PixelChannelType<typename ViewT::pixel_type>::type
-  min_channel_value( const ImageViewBase<ViewT>& view ) {
+  min_channel_value( const ImageViewBase<ViewT>& view, int num_threads = 1 ) {
     typedef typename PixelChannelType<typename ViewT::pixel_type>::type accum_type;
     ChannelAccumulator<MinMaxAccumulator<accum_type> > accumulator;
-    for_each_pixel( view, accumulator );
+    accumulate_pixels( view, accumulator, num_threads );
     return accumulator.minimum();
   }
 
@@ -84,10 +102,10 @@ namespace vw {
   /// of the planes of the images.
   template <class ViewT>
   typename PixelChannelType<typename ViewT::pixel_type>::type
-  max_channel_value( const ImageViewBase<ViewT>& view ) {
+  max_channel_value( const ImageViewBase<ViewT>& view, int num_threads = 1 ) {
     typedef typename PixelChannelType<typename ViewT::pixel_type>::type accum_type;
     ChannelAccumulator<MinMaxAccumulator<accum_type> > accumulator;
-    for_each_pixel( view, accumulator );
+    accumulate_pixels( view, accumulator, num_threads );
     return accumulator.maximum();
   }
 
@@ -96,11 +114,12 @@ namespace vw {
   template <class ViewT>
   void min_max_channel_values( const ImageViewBase<ViewT> &view,
                                typename PixelChannelType<typename ViewT::pixel_type>::type &min,
-                               typename PixelChannelType<typename ViewT::pixel_type>::type &max )
+                               typename PixelChannelType<typename ViewT::pixel_type>::type &max,
+                               int num_threads = 1 )
   {
     typedef typename PixelChannelType<typename ViewT::pixel_type>::type accum_type;
     ChannelAccumulator<MinMaxAccumulator<accum_type> > accumulator;
-    for_each_pixel( view, accumulator );
+    accumulate_pixels( view, accumulator, num_threads );
     min = accumulator.minimum();
     max = accumulator.maximum();
   }
@@ -108,10 +127,10 @@ namespace vw {
   /// Compute the sum of all the channels of all the valid pixels of the image.
   template <class ViewT>
   typename AccumulatorType<typename PixelChannelType<typename ViewT::pixel_type>::type>::type
-  sum_of_channel_values( const ImageViewBase<ViewT>& view ) {
+  sum_of_channel_values( const ImageViewBase<ViewT>& view, int num_threads = 1 ) {
     typedef typename AccumulatorType<typename PixelChannelType<typename ViewT::pixel_type>::type>::type accum_type;
     ChannelAccumulator<Accumulator<accum_type> > accumulator;
-    for_each_pixel( view, accumulator );
+    accumulate_pixels( view, accumulator, num_threads );
     return accumulator.value();
   }
 
@@ -119,10 +138,10 @@ namespace vw {
   /// valid (non-masked) pixels of an image (including alpha but
   /// excluding mask channels).
   template <class ViewT>
-  double mean_channel_value( const ImageViewBase<ViewT> &view ) {
+  double mean_channel_value( const ImageViewBase<ViewT> &view, int num_threads = 1 ) {
     typedef typename PixelChannelType<typename ViewT::pixel_type>::type accum_type;
     ChannelAccumulator<MeanAccumulator<accum_type> > accumulator;
-    for_each_pixel( view, accumulator );
+    accumulate_pixels( view, accumulator, num_threads );
     return accumulator.value();
   }
 
@@ -143,22 +162,30 @@ namespace vw {
   /// images with alpha channels.
   ///
   template <class ViewT>
-  double stddev_channel_value( const ImageViewBase<ViewT> &view ) {
+  double stddev_channel_value( const ImageViewBase<ViewT> &view, int num_threads = 1 ) {
     typedef typename PixelChannelType<typename ViewT::pixel_type>::type channel_type;
     ChannelAccumulator<StdDevAccumulator<channel_type> > accumulator;
-    for_each_pixel( view, accumulator );
+    accumulate_pixels( view, accumulator, num_threads );
     return accumulator.value();
   }
 
   /// Computes the median channel value of an image.  Only non-alpha
   /// channels of valid (e.g.  non-transparent) pixels are considered.
-  /// This function computes the median by sorting all the channel
-  /// values in the image, which is time- and memory-intensive, so
-  /// this operation is not recommended for large images.
+  /// With one thread this function computes the median by sorting all
+  /// the channel values in the image, which is time- and
+  /// memory-intensive, so this operation is not recommended for large
+  /// images.  With more threads the median is exact for up to a million
+  /// channel values and estimated with math::QuantileAccumulator, in
+  /// bounded memory, beyond that.
   template <class ViewT>
   typename PixelChannelType<typename ViewT::pixel_type>::type
-  median_channel_value( const ImageViewBase<ViewT> &view ) {
+  median_channel_value( const ImageViewBase<ViewT> &view, int num_threads = 1 ) {
     typedef typename PixelChannelType<typename ViewT::pixel_type>::type accum_type;
+    if ( num_threads > 1 ) {
+      ChannelAccumulator<math::QuantileAccumulator<accum_type> > accumulator;
+      reduce_blocks( view, accumulator, Vector2i(256,256), num_threads );
+      return accumulator.value();
+    }
     ChannelAccumulator<MedianAccumulator<accum_type> > accumulator;
     for_each_pixel( view, accumulator );
     return accumulator.value();
@@ -191,6 +218,13 @@ namespace vw {
 
     bool is_valid() const { return m_valid; }
 
+    void merge( EWMinMaxAccumulator const& other ) {
+      if ( !other.m_valid )
+        return;
+      (*this)( other.m_min );
+      (*this)( other.m_max );
+    }
+
     ValT minimum() const {
       VW_ASSERT(m_valid, ArgumentErr() << "EWMinMaxAccumulator: no valid samples" );
       return m_min;
@@ -224,6 +258,14 @@ namespace vw {
       }
     }
 
+    void merge( EWStdDevAccumulator const& other ) {
+      num_samples += other.num_samples;
+      for ( vw::int32 i = 0; i < CompoundNumChannels<ValT>::value; i++ ) {
+        m_sum[i] += other.m_sum[i];
+        m_sum_2[i] += other.m_sum_2[i];
+      }
+    }
+
     ValT value() const {
       VW_ASSERT(num_samples, ArgumentErr() << "EWStdDevAccumulator(): no valid samples.");
       ValT result;
@@ -251,7 +293,38 @@ namespace vw {
       VW_ASSERT(m_values[0].size(), ArgumentErr() << "MedianAccumulator: no valid samples");
       ValT result;
       for ( vw::int32 i = 0; i < CompoundNumChannels<ValT>::value; i++ ) {
-        result[i] = destructive_median(m_values[i]);
+        result[i] = math::destructive_median(m_values[i]);
+      }
+      return result;
+    }
+  };
+
+  /// Per channel median for reduce_blocks(), exact for small images.
+  /// See math::QuantileAccumulator.
+  template <class ValT>
+  class EWQuantileAccumulator : public ReturnFixedType<void> {
+    typedef std::vector<math::QuantileAccumulator<typename PixelChannelType<ValT>::type> > storage_type;
+    storage_type m_values;
+  public:
+    EWQuantileAccumulator() {
+      m_values.resize( CompoundNumChannels<ValT>::value );
+    }
+
+    void operator()( ValT const& value ) {
+      for ( vw::int32 i = 0; i < CompoundNumChannels<ValT>::value; i++ )
+        m_values[i]( value[i] );
+    }
+
+    void merge( EWQuantileAccumulator const& other ) {
+      for ( vw::int32 i = 0; i < CompoundNumChannels<ValT>::value; i++ )
+        m_values[i].merge( other.m_values[i] );
+    }
+
+    ValT value() const {
+      VW_ASSERT(m_values[0].size(), ArgumentErr() << "MedianAccumulator: no valid samples");
+      ValT result;
+      for ( vw::int32 i = 0; i < CompoundNumChannels<ValT>::value; i++ ) {
+        result[i] = m_values[i].median();
       }
       return result;
     }
@@ -273,46 +346,47 @@ namespace vw {
   template <class ViewT>
   typename boost::enable_if< IsCompound<typename UnmaskedPixelType<typename ViewT::pixel_type>::type>,
                                         typename UnmaskedPixelType<typename ViewT::pixel_type>::type>::type
-  min_pixel_value( ImageViewBase<ViewT> const& view ) {
+  min_pixel_value( ImageViewBase<ViewT> const& view, int num_threads = 1 ) {
     typedef typename UnmaskedPixelType<typename ViewT::pixel_type>::type accum_type;
     PixelAccumulator<EWMinMaxAccumulator<accum_type> > accumulator;
-    for_each_pixel( view, accumulator );
+    accumulate_pixels( view, accumulator, num_threads );
     return accumulator.minimum();
   }
 
   template <class ViewT>
     typename boost::disable_if< IsCompound<typename UnmaskedPixelType<typename ViewT::pixel_type>::type>,
                                            typename PixelChannelType<typename ViewT::pixel_type>::type>::type
-  min_pixel_value( ImageViewBase<ViewT> const& view ) {
-    return min_channel_value( view );
+  min_pixel_value( ImageViewBase<ViewT> const& view, int num_threads = 1 ) {
+    return min_channel_value( view, num_threads );
   }
 
   template <class ViewT>
     typename boost::enable_if< IsCompound<typename UnmaskedPixelType<typename ViewT::pixel_type>::type>,
                                           typename UnmaskedPixelType<typename ViewT::pixel_type>::type>::type
-  max_pixel_value( ImageViewBase<ViewT> const& view ) {
+  max_pixel_value( ImageViewBase<ViewT> const& view, int num_threads = 1 ) {
     typedef typename UnmaskedPixelType<typename ViewT::pixel_type>::type accum_type;
     PixelAccumulator<EWMinMaxAccumulator<accum_type> > accumulator;
-    for_each_pixel( view, accumulator );
+    accumulate_pixels( view, accumulator, num_threads );
     return accumulator.maximum();
-    return max_channel_value( view );
+    return max_channel_value( view, num_threads );
   }
 
   template <class ViewT>
     typename boost::disable_if< IsCompound<typename UnmaskedPixelType<typename ViewT::pixel_type>::type>,
                                            typename PixelChannelType<typename ViewT::pixel_type>::type>::type
-  max_pixel_value( ImageViewBase<ViewT> const& view ) {
-    return max_channel_value( view );
+  max_pixel_value( ImageViewBase<ViewT> const& view, int num_threads = 1 ) {
+    return max_channel_value( view, num_threads );
   }
 
   template <class ViewT>
   void min_max_pixel_values( ImageViewBase<ViewT> const& view,
                              typename boost::enable_if< IsCompound<typename UnmaskedPixelType<typename ViewT::pixel_type>::type>, 
                              typename UnmaskedPixelType<typename ViewT::pixel_type>::type>::type &min,
-                             typename UnmaskedPixelType<typename ViewT::pixel_type>::type        &max ) {
+                             typename UnmaskedPixelType<typename ViewT::pixel_type>::type        &max,
+                             int num_threads = 1 ) {
     typedef typename UnmaskedPixelType<typename ViewT::pixel_type>::type accum_type;
     PixelAccumulator<EWMinMaxAccumulator<accum_type> > accumulator;
-    for_each_pixel( view, accumulator );
+    accumulate_pixels( view, accumulator, num_threads );
     min = accumulator.minimum();
     max = accumulator.maximum();
   }
@@ -321,52 +395,58 @@ namespace vw {
   void min_max_pixel_values( ImageViewBase<ViewT> const& view,
                              typename boost::disable_if< IsCompound<typename UnmaskedPixelType<typename ViewT::pixel_type>::type>, 
                              typename PixelChannelType<typename ViewT::pixel_type>::type>::type &min,
-                             typename PixelChannelType<typename ViewT::pixel_type>::type        &max ) {
-    min_max_channel_values( view, min, max );
+                             typename PixelChannelType<typename ViewT::pixel_type>::type        &max,
+                             int num_threads = 1 ) {
+    min_max_channel_values( view, min, max, num_threads );
   }
 
   /// Compute the sum of all valid pixels in the image.
   template <class ViewT>
   typename PixelChannelCast<typename UnmaskedPixelType<typename ViewT::pixel_type>::type,
                             typename AccumulatorType<typename PixelChannelType<typename ViewT::pixel_type>::type>::type>::type
-  sum_of_pixel_values( const ImageViewBase<ViewT>& view ) {
+  sum_of_pixel_values( const ImageViewBase<ViewT>& view, int num_threads = 1 ) {
     typedef typename PixelChannelCast<typename UnmaskedPixelType<typename ViewT::pixel_type>::type,
                           typename AccumulatorType<typename PixelChannelType<typename ViewT::pixel_type>::type>::type>::type accum_type;
     PixelAccumulator<Accumulator<accum_type> > accumulator;
-    for_each_pixel( view, accumulator );
+    accumulate_pixels( view, accumulator, num_threads );
     return accumulator.value();
   }
 
   template <class ViewT>
   typename PixelChannelCast<typename UnmaskedPixelType<typename ViewT::pixel_type>::type,double>::type
-  mean_pixel_value( ImageViewBase<ViewT> const& view ) {
+  mean_pixel_value( ImageViewBase<ViewT> const& view, int num_threads = 1 ) {
     typedef typename PixelChannelCast<typename UnmaskedPixelType<typename ViewT::pixel_type>::type,double>::type accum_type;
     PixelAccumulator<MeanAccumulator<accum_type> > accumulator;
-    for_each_pixel( view, accumulator );
+    accumulate_pixels( view, accumulator, num_threads );
     return accumulator.value();
   }
 
   template <class ViewT>
   typename boost::enable_if< IsCompound<typename UnmaskedPixelType<typename ViewT::pixel_type>::type>,
                                         typename UnmaskedPixelType<typename ViewT::pixel_type>::type>::type
-  stddev_pixel_value( ImageViewBase<ViewT> const& view ) {
+  stddev_pixel_value( ImageViewBase<ViewT> const& view, int num_threads = 1 ) {
     typedef typename UnmaskedPixelType<typename ViewT::pixel_type>::type accum_type;
     PixelAccumulator<EWStdDevAccumulator<accum_type> > accumulator;
-    for_each_pixel( view, accumulator );
+    accumulate_pixels( view, accumulator, num_threads );
     return accumulator.value();
   }
 
   template <class ViewT>
   typename boost::disable_if< IsCompound<typename UnmaskedPixelType<typename ViewT::pixel_type>::type>,double>::type
-  stddev_pixel_value( ImageViewBase<ViewT> const& view ) {
-    return stddev_channel_value( view );
+  stddev_pixel_value( ImageViewBase<ViewT> const& view, int num_threads = 1 ) {
+    return stddev_channel_value( view, num_threads );
   }
 
   template <class ViewT>
     typename boost::enable_if< IsCompound<typename UnmaskedPixelType<typename ViewT::pixel_type>::type>,
                                           typename UnmaskedPixelType<typename ViewT::pixel_type>::type>::type
-  median_pixel_value( ImageViewBase<ViewT> const& view ) {
+  median_pixel_value( ImageViewBase<ViewT> const& view, int num_threads = 1 ) {
     typedef typename UnmaskedPixelType<typename ViewT::pixel_type>::type accum_type;
+    if ( num_threads > 1 ) {
+      PixelAccumulator<EWQuantileAccumulator<accum_type> > accumulator;
+      reduce_blocks( view, accumulator, Vector2i(256,256), num_threads );
+      return accumulator.value();
+    }
     PixelAccumulator<EWMedianAccumulator<accum_type> > accumulator;
     for_each_pixel( view, accumulator );
     return accumulator.value();
@@ -375,8 +455,8 @@ namespace vw {
   template <class ViewT>
     typename boost::disable_if< IsCompound<typename UnmaskedPixelType<typename ViewT::pixel_type>::type>,
                                            typename PixelChannelType<typename ViewT::pixel_type>::type>::type
-  median_pixel_value( ImageViewBase<ViewT> const& view ) {
-    return median_channel_value( view );
+  median_pixel_value( ImageViewBase<ViewT> const& view, int num_threads = 1 ) {
+    return median_channel_value( view, num_threads );
   }
 
   /// Computes the weighted mean of the values of all the pixels of an
@@ -387,9 +467,9 @@ namespace vw {
   /// channel this function is identical to mean_pixel_value().
   template <class ViewT>
   typename PixelWithoutAlpha<typename PixelChannelCast<typename UnmaskedPixelType<typename ViewT::pixel_type>::type,double>::type>::type
-  weighted_mean_pixel_value( const ImageViewBase<ViewT> &view ) {
+  weighted_mean_pixel_value( const ImageViewBase<ViewT> &view, int num_threads = 1 ) {
     typedef typename PixelChannelCast<typename UnmaskedPixelType<typename ViewT::pixel_type>::type,double>::type accum_type;
-    accum_type mean = mean_pixel_value( view );
+    accum_type mean = mean_pixel_value( view, num_threads );
     if ( PixelHasAlpha<typename ViewT::pixel_type>::value ) {
       double weight = alpha_channel( mean ) / ChannelRange<typename PixelChannelType<typename ViewT::pixel_type>::type>::max();
       VW_ASSERT(weight, ArgumentErr() << "weighted_mean_pixel_value(): no weighted samples");
@@ -405,24 +485,49 @@ namespace vw {
   /// is completely transparent.  For images with no alpha channel
   /// this function is identical to mean_channel_value().
   template <class ViewT>
-  double weighted_mean_channel_value( const ImageViewBase<ViewT> &view ) {
-    return mean_channel_value( weighted_mean_pixel_value( view ) );
+  double weighted_mean_channel_value( const ImageViewBase<ViewT> &view, int num_threads = 1 ) {
+    return mean_channel_value( weighted_mean_pixel_value( view, num_threads ) );
   }
 
-  // Find the histogram of an image. 
+  /// An adapter that converts the valid pixels of a single channel
+  /// image to double before passing them to an accumulator.
+  template <class AccumT>
+  class ValueAccumulator : public AccumT {
+  public:
+    ValueAccumulator() {}
+    ValueAccumulator( AccumT const& accum ) : AccumT( accum ) {}
+
+    template <class ArgT>
+    void operator()( ArgT const& pix ) {
+      if ( is_valid(pix) ) {
+        double val = pix;
+        AccumT::operator()( val );
+      }
+    }
+  };
+
+  /// Find the histogram of an image.  The bins span the range of the
+  /// valid pixels.  With more than one thread the data is read once, in
+  /// blocks, with math::StreamingHistogram:
+  /// - For integer pixels of up to 16 bits the counts are exact.
+  /// - For other pixels a value may be counted in a neighbor of its
+  ///   bin if it is close to the boundary, within 1/32 of a bin for
+  ///   256 bins.
   template <class ViewT>
-  void histogram( const ImageViewBase<ViewT> &view, int num_bins, math::Histogram &hist);
+  void histogram( const ImageViewBase<ViewT> &view, int num_bins, math::Histogram &hist,
+                  int num_threads = 1 );
 
 
   /// Find the min and max values in an image
   /// - TODO: Why are there two methods for doing this?
   template <class ViewT>
-  void find_image_min_max( const ImageViewBase<ViewT> &view, double &min_val, double &max_val);
+  void find_image_min_max( const ImageViewBase<ViewT> &view, double &min_val, double &max_val,
+                           int num_threads = 1 );
 
   /// Overload that takes precomputed min and max values
   template <class ViewT>
   void histogram( const ImageViewBase<ViewT> &view, int num_bins, double min_val, double max_val,
-                  math::Histogram &hist);
+                  math::Histogram &hist, int num_threads = 1 );
 
   // Find the optimal Otsu threshold for splitting a gray scale image
   // into black and white pixels.
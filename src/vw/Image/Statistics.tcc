@@ -20,9 +20,19 @@
 
 
 template <class ViewT>
-void histogram( const ImageViewBase<ViewT> &view, int num_bins, math::Histogram &hist){
+void histogram( const ImageViewBase<ViewT> &view, int num_bins, math::Histogram &hist,
+                int num_threads){
   
   VW_ASSERT(num_bins > 0, ArgumentErr() << "histogram: number of input bins must be positive");
+
+  if (num_threads > 1) {
+    // The range is not known yet, so the values are collected in a
+    // histogram that adapts to it.
+    ValueAccumulator<math::StreamingHistogram> accumulator;
+    reduce_blocks( view, accumulator, Vector2i(256,256), num_threads );
+    accumulator.fill( num_bins, hist );
+    return;
+  }
   
   // Find the maximum and minimum
   double max_val = -std::numeric_limits<double>::max(), min_val = -max_val;
@@ -53,7 +63,21 @@ void histogram( const ImageViewBase<ViewT> &view, int num_bins, math::Histogram
 
 
 template <class ViewT>
-void find_image_min_max( const ImageViewBase<ViewT> &view, double &min_val, double &max_val){
+void find_image_min_max( const ImageViewBase<ViewT> &view, double &min_val, double &max_val,
+                         int num_threads){
+
+  if (num_threads > 1) {
+    ValueAccumulator<math::MinMaxAccumulator<double> > accumulator;
+    reduce_blocks( view, accumulator, Vector2i(256,256), num_threads );
+    if ( accumulator.is_valid() ) {
+      min_val = accumulator.minimum();
+      max_val = accumulator.maximum();
+    } else {
+      max_val = -std::numeric_limits<double>::max();
+      min_val = -max_val;
+    }
+    return;
+  }
 
   max_val = -std::numeric_limits<double>::max();
   min_val = -max_val;
@@ -70,13 +94,20 @@ void find_image_min_max( const ImageViewBase<ViewT> &view, double &min_val, doub
 
 template <class ViewT>
 void histogram( const ImageViewBase<ViewT> &view, int num_bins, double min_val, double max_val,
-                math::Histogram &hist){
+                math::Histogram &hist, int num_threads){
   
   VW_ASSERT(num_bins > 0, ArgumentErr() << "histogram: number of input bins must be positive");
   
   if (max_val == min_val) 
     max_val = min_val + 1.0;
   
+  if (num_threads > 1) {
+    ValueAccumulator<math::Histogram> accumulator( math::Histogram(num_bins, min_val, max_val) );
+    reduce_blocks( view, accumulator, Vector2i(256,256), num_threads );
+    hist = accumulator;
+    return;
+  }
+
   hist.initialize(num_bins, min_val, max_val);
   for (int row = 0; row < view.impl().rows(); row++){
     for (int col = 0; col < view.impl().cols(); col++){
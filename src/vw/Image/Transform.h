@@ -25,11 +25,21 @@
 #ifndef __VW_IMAGE_TRANSFORM_H__
 #define __VW_IMAGE_TRANSFORM_H__
 
+#include <vw/Core/Cache.h>
 #include <vw/Math/Transform.h>
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/ImageViewRef.h>
 #include <vw/Image/Interpolation.h>
 
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <vector>
+
 static const double VW_DEFAULT_MIN_TRANSFORM_IMAGE_SIZE = 1;
 static const double VW_DEFAULT_MAX_TRANSFORM_IMAGE_SIZE = 1e10; // Ten gigapixels
 
@@ -132,73 +142,121 @@ namespace vw {
     virtual FunctionType reverse_type() const { return m_impl.reverse_type(); }
   };
 
-  // ApproximateTransform image transform functor template.
-  //
-  // Mimics the behavior of a given transform functor, but attempts to
-  // build a lookup table to linearly interpolate approimate results
-  // to the reverse() function for arguments within the given bounding
-  // box, to within the original transform functor's tolerance.
-  template <class TransformT>
-  class ApproximateTransform : public TransformT {
-    BBox2i m_bbox;
-    ImageView<Vector2> m_table;
-  public:
-    ApproximateTransform( TransformT const& transform, BBox2i const& bbox )
-      : TransformT( transform ), m_bbox( bbox ), m_table(2,2)
-    {
+  /// \cond INTERNAL
+  namespace transform_p {
+
+    enum TableResult { TableBuilt, TableFailed, TableTooDense };
+
+    // Fills table with eval() sampled on a regular grid spanning bbox.
+    // The grid density is doubled until bilinear interpolation of the
+    // table is within tolerance. The table is left empty and
+    // TableFailed returned if that takes as many nodes as bbox has
+    // pixels, or if eval() returns NaN. If the table would need more
+    // than max_nodes nodes per side it is left empty and TableTooDense
+    // is returned.
+    template <class EvalT>
+    TableResult build_approximation_table( EvalT& eval, double tolerance, BBox2i const& bbox,
+                                           ImageView<Vector2>& table,
+                                           int32 max_nodes = std::numeric_limits<int32>::max() ) {
       // Initialize with a simple 2x2 lookup table
       int32 n=2;
-      m_table(0,0) = TransformT::reverse(bbox.min());
-      m_table(1,0) = TransformT::reverse(Vector2(bbox.max().x(),bbox.min().y()));
-      m_table(0,1) = TransformT::reverse(Vector2(bbox.min().x(),bbox.max().y()));
-      m_table(1,1) = TransformT::reverse(bbox.max());
+      table.set_size(2,2);
+      table(0,0) = eval(bbox.min());
+      table(1,0) = eval(Vector2(bbox.max().x(),bbox.min().y()));
+      table(0,1) = eval(Vector2(bbox.min().x(),bbox.max().y()));
+      table(1,1) = eval(bbox.max());
 
       // Double the grid density until the worst (squared) approximation error
       // is less than the allowed (squared) tolerance.
       double max_sqr_err = 0;
-      double tol_sqr = TransformT::tolerance() * TransformT::tolerance();
+      double tol_sqr = tolerance * tolerance;
       Vector2 origin = bbox.min(), diag = bbox.size();
       do {
         n = 2*n-1;
         // Fall back for unapproximatably crazy transform functions.
         if( n>=bbox.width()|| n>=bbox.height() ) {
-          m_table.reset();
-          return;
+          table.reset();
+          return TableFailed;
         }
-        ImageView<Vector2> prev = m_table;
-        m_table.set_size(n,n);
+        if( n > max_nodes ) {
+          table.reset();
+          return TableTooDense;
+        }
+        ImageView<Vector2> prev = table;
+        table.set_size(n,n);
         max_sqr_err = 0;
         for( int y=0; y<n; ++y ) {
           for( int x=0; x<n; ++x ) {
             if( (y%2)==0 && (x%2==0) ) {
-              m_table(x,y) = prev(x/2,y/2);
+              table(x,y) = prev(x/2,y/2);
             }
             else {
               Vector2 pos = Vector2(x,y)/(n-1);
-              m_table(x,y) = TransformT::reverse(origin+elem_prod(pos,diag));
+              table(x,y) = eval(origin+elem_prod(pos,diag));
               Vector2 interp;
               if( (y%2)==0 ) interp = (prev(x/2,y/2) + prev(x/2+1,y/2)) / 2.0;
               else if( (x%2)==0 ) interp = (prev(x/2,y/2) + prev(x/2,y/2+1)) / 2.0;
               else interp = (prev(x/2,y/2) + prev(x/2,y/2+1) + prev(x/2+1,y/2) + prev(x/2+1,y/2+1)) / 4.0;
-              double sqr_err = norm_2_sqr( m_table(x,y) - interp );
+              double sqr_err = norm_2_sqr( table(x,y) - interp );
+              if( sqr_err != sqr_err ) {
+                table.reset();
+                return TableFailed;
+              }
               if( sqr_err > max_sqr_err ) max_sqr_err = sqr_err;
             }
           }
         }
       } while( max_sqr_err > tol_sqr );
+      return TableBuilt;
     }
 
-    inline Vector2 reverse( Vector2 const& p ) const {
-      // Fall back if the function was not approximatable.
-      if( ! m_table.is_valid_image() )
-        return TransformT::reverse( p );
+    // Calls the exact reverse() of a transform, bypassing any override
+    // of it in a class derived from TransformT.
+    template <class TransformT>
+    struct ExactReverse {
+      TransformT const& transform;
+      size_t calls;
+      ExactReverse( TransformT const& transform ) : transform(transform), calls(0) {}
+      Vector2 operator()( Vector2 const& p ) { ++calls; return transform.TransformT::reverse(p); }
+    };
+
+    // Computes the exact reverse() at the n points (x0+k,y), bypassing
+    // any override of it in a class derived from TransformT. A transform
+    // that can do a whole row faster than point by point overloads this
+    // for its own type, in its own namespace.
+    template <class TransformT>
+    inline void exact_reverse_row( TransformT const& transform, double y, double x0, int32 n, Vector2* out ) {
+      for( int32 k=0; k<n; ++k )
+        out[k] = transform.TransformT::reverse( Vector2(x0+k,y) );
+    }
 
-      // We re-implement bilinear interpolation by hand here because for
-      // some reason the BilinearInterpolation object is exceptionally
-      // slow for Vector data still.
-      int    n  = m_table.cols() - 1;
-      double px = n * (p.x() - m_bbox.min().x()) / (m_bbox.max().x() - m_bbox.min().x());
-      double py = n * (p.y() - m_bbox.min().y()) / (m_bbox.max().y() - m_bbox.min().y());
+    // Same, but remembers every point so that tables that share nodes
+    // only evaluate them once.
+    template <class TransformT>
+    struct MemoizedReverse : public ExactReverse<TransformT> {
+      std::map<std::pair<double,double>, Vector2> nodes;
+      MemoizedReverse( TransformT const& transform ) : ExactReverse<TransformT>(transform) {}
+      Vector2 operator()( Vector2 const& p ) {
+        std::pair<double,double> key( p.x(), p.y() );
+        typename std::map<std::pair<double,double>, Vector2>::iterator it = nodes.find( key );
+        if( it != nodes.end() )
+          return it->second;
+        Vector2 result = ExactReverse<TransformT>::operator()( p );
+        nodes.insert( std::make_pair( key, result ) );
+        return result;
+      }
+    };
+
+    // Bilinear interpolation in a table built over bbox.
+    //
+    // We re-implement bilinear interpolation by hand here because for
+    // some reason the BilinearInterpolation object is exceptionally
+    // slow for Vector data still.
+    inline Vector2 interpolate_table( ImageView<Vector2> const& table, BBox2i const& bbox,
+                                      Vector2 const& p ) {
+      int    n  = table.cols() - 1;
+      double px = n * (p.x() - bbox.min().x()) / (bbox.max().x() - bbox.min().x());
+      double py = n * (p.y() - bbox.min().y()) / (bbox.max().y() - bbox.min().y());
       int32  ix = math::impl::_floor(px);
       if( ix < 0  ) ix = 0;
       if( ix >= n ) ix = n-1;
@@ -207,10 +265,10 @@ namespace vw {
       if( iy >= n ) iy = n-1;
       double normx = px-ix, normy = py-iy;
 
-      Vector2 const& m00 = m_table(ix,  iy);
-      Vector2 const& m10 = m_table(ix+1,iy);
-      Vector2 const& m01 = m_table(ix,  iy+1);
-      Vector2 const& m11 = m_table(ix+1,iy+1);
+      Vector2 const& m00 = table(ix,  iy);
+      Vector2 const& m10 = table(ix+1,iy);
+      Vector2 const& m01 = table(ix,  iy+1);
+      Vector2 const& m11 = table(ix+1,iy+1);
 
       return Vector2( (m00.x()*(1-normy)+m01.x()*normy)*(1-normx) +
                       (m10.x()*(1-normy)+m11.x()*normy)*normx,
@@ -218,6 +276,390 @@ namespace vw {
                       (m10.y()*(1-normy)+m11.y()*normy)*normx );
     }
 
+    // Same as interpolate_table() at the n points (x0+k,y), but the
+    // vertical half of the interpolation is done once for the row.
+    inline void interpolate_table_row( ImageView<Vector2> const& table, BBox2i const& bbox,
+                                       double y, double x0, int32 n, Vector2* out ) {
+      int    nt = table.cols() - 1;
+      double py = nt * (y - bbox.min().y()) / (bbox.max().y() - bbox.min().y());
+      int32  iy = math::impl::_floor(py);
+      if( iy < 0   ) iy = 0;
+      if( iy >= nt ) iy = nt-1;
+      double normy = py-iy;
+
+      std::vector<Vector2> column( nt+1 );
+      for( int ix=0; ix<=nt; ++ix ) {
+        Vector2 const& m0 = table(ix,iy);
+        Vector2 const& m1 = table(ix,iy+1);
+        column[ix] = Vector2( m0.x()*(1-normy)+m1.x()*normy,
+                              m0.y()*(1-normy)+m1.y()*normy );
+      }
+
+      for( int32 k=0; k<n; ++k ) {
+        double px = nt * ((x0+k) - bbox.min().x()) / (bbox.max().x() - bbox.min().x());
+        int32  ix = math::impl::_floor(px);
+        if( ix < 0   ) ix = 0;
+        if( ix >= nt ) ix = nt-1;
+        double normx = px-ix;
+        Vector2 const& c0 = column[ix];
+        Vector2 const& c1 = column[ix+1];
+        out[k] = Vector2( c0.x()*(1-normx) + c1.x()*normx,
+                          c0.y()*(1-normx) + c1.y()*normx );
+      }
+    }
+
+    // One square cell of an ApproximationGrid, split into a quadtree of
+    // leaves that each have their own lookup table, over the part of
+    // the leaf in the grid's domain. A leaf with an empty table is
+    // transformed exactly. index holds the leaf covering each
+    // leaf_size square of the cell.
+    struct ApproximationCell {
+      struct Leaf {
+        BBox2i             bbox;
+        ImageView<Vector2> table;
+      };
+      BBox2i              bbox;
+      int32               leaf_size, side;
+      std::vector<Leaf>   leaves;
+      std::vector<uint16> index;
+
+      Leaf const& leaf( int32 x, int32 y ) const {
+        return leaves[ index[ ((y - bbox.min().y()) / leaf_size) * side +
+                              (x - bbox.min().x()) / leaf_size ] ];
+      }
+    };
+
+  } // namespace transform_p
+  /// \endcond
+
+  /// Counts the work done by an approximated transform: the number of
+  /// calls made to the exact reverse() and the number of pixels that
+  /// were rasterized. Thread-safe.
+  class ApproximationStats : private boost::noncopyable {
+    mutable Mutex m_mutex;
+    uint64 m_exact_calls, m_pixels;
+  public:
+    ApproximationStats() : m_exact_calls(0), m_pixels(0) {}
+
+    void add_exact_calls( uint64 calls  ) { Mutex::WriteLock lock(m_mutex); m_exact_calls += calls;  }
+    void add_pixels     ( uint64 pixels ) { Mutex::WriteLock lock(m_mutex); m_pixels      += pixels; }
+    void clear() { Mutex::WriteLock lock(m_mutex); m_exact_calls = m_pixels = 0; }
+
+    uint64 exact_calls() const { Mutex::ReadLock lock(m_mutex); return m_exact_calls; }
+    uint64 pixels     () const { Mutex::ReadLock lock(m_mutex); return m_pixels;      }
+
+    /// Exact reverse() calls per rasterized pixel, or 0 before anything
+    /// was rasterized.
+    double exact_calls_per_pixel() const {
+      Mutex::ReadLock lock(m_mutex);
+      return m_pixels ? double(m_exact_calls) / double(m_pixels) : 0.0;
+    }
+  };
+
+  /// \cond INTERNAL
+  namespace transform_p {
+
+    // Builds the leaves of one grid cell for the cache.
+    template <class TransformT>
+    class ApproximationCellGenerator {
+      boost::shared_ptr<const TransformT> m_transform;
+      boost::shared_ptr<ApproximationStats> m_stats;
+      BBox2i m_bbox, m_domain;
+      int32  m_leaf_size;
+
+      // A leaf is split rather than given a table with more nodes per
+      // side than this, unless it is already as small as allowed.
+      static const int32 max_leaf_nodes = 9;
+
+      // Builds the leaves of the square. It is split if it needs a
+      // denser table than a leaf of its size may have, or if the
+      // transform fails somewhere in it, which may be in a small part.
+      void build( MemoizedReverse<TransformT>& eval, double tolerance,
+                  ApproximationCell& cell, BBox2i const& square ) const {
+        ApproximationCell::Leaf leaf;
+        leaf.bbox = square;
+        leaf.bbox.crop( m_domain );
+        if( !leaf.bbox.empty() ) {
+          int32 max_nodes = square.width() > m_leaf_size ? max_leaf_nodes : std::numeric_limits<int32>::max();
+          TableResult result = build_approximation_table( eval, tolerance, leaf.bbox,
+                                                          leaf.table, max_nodes );
+          if( result != TableBuilt && square.width() > m_leaf_size ) {
+            int32 half = square.width() / 2;
+            build( eval, tolerance, cell, BBox2i( square.min().x(),      square.min().y(),      half, half ) );
+            build( eval, tolerance, cell, BBox2i( square.min().x()+half, square.min().y(),      half, half ) );
+            build( eval, tolerance, cell, BBox2i( square.min().x(),      square.min().y()+half, half, half ) );
+            build( eval, tolerance, cell, BBox2i( square.min().x()+half, square.min().y()+half, half, half ) );
+            return;
+          }
+        }
+        int32 x0 = (square.min().x() - cell.bbox.min().x()) / m_leaf_size;
+        int32 y0 = (square.min().y() - cell.bbox.min().y()) / m_leaf_size;
+        int32 n  = square.width() / m_leaf_size;
+        for( int32 y=y0; y<y0+n; ++y )
+          for( int32 x=x0; x<x0+n; ++x )
+            cell.index[ y*cell.side + x ] = uint16( cell.leaves.size() );
+        cell.leaves.push_back( leaf );
+      }
+
+    public:
+      typedef ApproximationCell value_type;
+
+      ApproximationCellGenerator( boost::shared_ptr<const TransformT> const& transform,
+                                  boost::shared_ptr<ApproximationStats> const& stats,
+                                  BBox2i const& bbox, BBox2i const& domain, int32 leaf_size )
+        : m_transform(transform), m_stats(stats), m_bbox(bbox), m_domain(domain),
+          m_leaf_size(leaf_size) {}
+
+      // The size of the cell if every leaf is as small and dense as it
+      // can get.
+      size_t size() const {
+        size_t side  = m_bbox.width() / m_leaf_size;
+        size_t nodes = m_leaf_size / 2 + 1;
+        return sizeof(value_type) + side * side * ( sizeof(ApproximationCell::Leaf) + sizeof(uint16) +
+                                                    nodes * nodes * sizeof(Vector2) );
+      }
+
+      boost::shared_ptr<value_type> generate() const {
+        boost::shared_ptr<value_type> cell( new value_type );
+        cell->bbox      = m_bbox;
+        cell->leaf_size = m_leaf_size;
+        cell->side      = m_bbox.width() / m_leaf_size;
+        cell->index.resize( cell->side * cell->side );
+        // Cells are generated on any thread, so each works on its own
+        // copy of the transform, which may not be thread-safe.
+        TransformT transform( *m_transform );
+        MemoizedReverse<TransformT> eval( transform );
+        build( eval, transform.tolerance(), *cell, m_bbox );
+        m_stats->add_exact_calls( eval.calls );
+        return cell;
+      }
+    };
+
+  } // namespace transform_p
+  /// \endcond
+
+  /// An image-wide set of ApproximateTransform lookup tables.
+  ///
+  /// The plane is divided into square cells aligned to multiples of
+  /// cell_size. A cell is covered by one lookup table if a coarse one
+  /// meets the transform's tolerance; otherwise it is split into
+  /// quarters, down to leaf_size, so that dense tables are only built
+  /// where the transform needs them, or where it fails in part of a
+  /// piece. Nodes shared by the pieces of a cell are evaluated once. A
+  /// leaf_size square that would need a node every pixel, or where the
+  /// transform fails, is transformed exactly.
+  ///
+  /// The tables only cover the part of the cells in the domain, such
+  /// as the bounds of the transformed image, so the transform is not
+  /// called far outside of it. Points outside of the tables are
+  /// transformed exactly.
+  ///
+  /// Cells are built the first time a tile touches them and are kept in
+  /// a vw::Cache, so neighbouring and repeated tiles reuse them instead
+  /// of calling the exact transform again. The grid is thread-safe.
+  template <class TransformT>
+  class ApproximationGrid : private boost::noncopyable {
+  public:
+    typedef transform_p::ApproximationCellGenerator<TransformT> generator_type;
+
+    /// cell_size must be leaf_size times a power of two, and leaf_size
+    /// at most 2^16 times smaller.
+    ApproximationGrid( TransformT const& transform, BBox2i const& domain,
+                       int32 cell_size = 256, int32 leaf_size = 32,
+                       Cache& cache = vw_system_cache() )
+      : m_transform( new TransformT(transform) ), m_stats( new ApproximationStats ),
+        m_domain( domain ), m_cell_size( cell_size ), m_leaf_size( leaf_size ), m_cache( &cache ) {
+      int32 side = leaf_size > 0 ? cell_size / leaf_size : 0;
+      if( side <= 0 || side * leaf_size != cell_size || (side & (side-1)) != 0 || side > 256 )
+        vw_throw( ArgumentErr() << "ApproximationGrid: cell size " << cell_size
+                  << " is not a power of two multiple of leaf size " << leaf_size << "." );
+    }
+
+    TransformT const& transform() const { return *m_transform; }
+    BBox2i const& domain() const { return m_domain; }
+    int32 cell_size() const { return m_cell_size; }
+    int32 leaf_size() const { return m_leaf_size; }
+
+    /// Calls made to the exact transform and pixels rasterized through
+    /// this grid.
+    ApproximationStats      & stats()       { return *m_stats; }
+    ApproximationStats const& stats() const { return *m_stats; }
+
+    /// The range of cells [min,max) covering a pixel bbox.
+    BBox2i cells( BBox2i const& bbox ) const {
+      return BBox2i( Vector2i( cell_index(bbox.min().x()), cell_index(bbox.min().y()) ),
+                     Vector2i( cell_index(bbox.max().x()-1)+1, cell_index(bbox.max().y()-1)+1 ) );
+    }
+
+    /// Cell (i,j), which covers pixels [i*cell_size,(i+1)*cell_size) x
+    /// [j*cell_size,(j+1)*cell_size).
+    boost::shared_ptr<transform_p::ApproximationCell> cell( int32 i, int32 j ) const {
+      Cache::Handle<generator_type> handle;
+      {
+        Mutex::WriteLock lock( m_mutex );
+        Cache::Handle<generator_type>& entry = m_cells[ std::make_pair(i,j) ];
+        if( !entry.attached() )
+          entry = m_cache->insert( generator_type( m_transform, m_stats,
+                                                   BBox2i( i*m_cell_size, j*m_cell_size,
+                                                           m_cell_size, m_cell_size ),
+                                                   m_domain, m_leaf_size ) );
+        handle = entry;
+      }
+      boost::shared_ptr<transform_p::ApproximationCell> result = handle;
+      handle.release();
+      return result;
+    }
+
+  private:
+    int32 cell_index( int32 x ) const {
+      return x >= 0 ? x / m_cell_size : -((m_cell_size - 1 - x) / m_cell_size);
+    }
+
+    boost::shared_ptr<const TransformT> m_transform;
+    boost::shared_ptr<ApproximationStats> m_stats;
+    BBox2i m_domain;
+    int32 m_cell_size, m_leaf_size;
+    Cache *m_cache;
+    mutable Mutex m_mutex;
+    mutable std::map<std::pair<int32,int32>, Cache::Handle<generator_type> > m_cells;
+  };
+
+  // ApproximateTransform image transform functor template.
+  //
+  // Mimics the behavior of a given transform functor, but attempts to
+  // build a lookup table to linearly interpolate approimate results
+  // to the reverse() function for arguments within the given bounding
+  // box, to within the original transform functor's tolerance.
+  //
+  // When constructed from an ApproximationGrid the tables of the
+  // grid's cells are used instead of building one for the bbox.
+  template <class TransformT>
+  class ApproximateTransform : public TransformT {
+    typedef transform_p::ApproximationCell::Leaf leaf_type;
+
+    BBox2i m_bbox;
+    ImageView<Vector2> m_table;
+
+    boost::shared_ptr<ApproximationGrid<TransformT> > m_grid;
+    BBox2i m_cell_range;
+    std::vector<boost::shared_ptr<transform_p::ApproximationCell> > m_cells;
+    mutable uint64 m_exact_calls;
+
+    // The grid leaf whose leaf_size square holds p, or null outside
+    // of the cells.
+    inline leaf_type const* square_leaf( Vector2 const& p ) const {
+      int32 x = math::impl::_floor( p.x() ), y = math::impl::_floor( p.y() );
+      int32 size = m_grid->cell_size();
+      int32 cx = ( x >= 0 ? x / size : -((size - 1 - x) / size) ) - m_cell_range.min().x();
+      int32 cy = ( y >= 0 ? y / size : -((size - 1 - y) / size) ) - m_cell_range.min().y();
+      if( cx < 0 || cy < 0 || cx >= m_cell_range.width() || cy >= m_cell_range.height() )
+        return 0;
+      return &m_cells[ cy * m_cell_range.width() + cx ]->leaf( x, y );
+    }
+
+    // Whether the leaf's table covers p. A leaf's table may stop short
+    // of its square at the edge of the grid's domain, and is not
+    // extrapolated past it.
+    static inline bool covers( leaf_type const& leaf, Vector2 const& p ) {
+      return leaf.table.is_valid_image() &&
+        p.x() >= leaf.bbox.min().x() && p.x() <= leaf.bbox.max().x() &&
+        p.y() >= leaf.bbox.min().y() && p.y() <= leaf.bbox.max().y();
+    }
+
+    // The grid leaf whose table covers p, or null if p must be
+    // transformed exactly.
+    inline leaf_type const* find_leaf( Vector2 const& p ) const {
+      leaf_type const* leaf = square_leaf( p );
+      return leaf && covers( *leaf, p ) ? leaf : 0;
+    }
+
+  public:
+    ApproximateTransform( TransformT const& transform, BBox2i const& bbox )
+      : TransformT( transform ), m_bbox( bbox ), m_exact_calls( 0 )
+    {
+      transform_p::ExactReverse<TransformT> eval( *this );
+      transform_p::build_approximation_table( eval, TransformT::tolerance(), bbox, m_table );
+    }
+
+    ApproximateTransform( boost::shared_ptr<ApproximationGrid<TransformT> > const& grid, BBox2i const& bbox )
+      : TransformT( grid->transform() ), m_bbox( bbox ), m_grid( grid ), m_exact_calls( 0 )
+    {
+      if( bbox.empty() )
+        return;
+      m_cell_range = grid->cells( bbox );
+      m_cells.reserve( m_cell_range.width() * m_cell_range.height() );
+      for( int32 j=m_cell_range.min().y(); j<m_cell_range.max().y(); ++j )
+        for( int32 i=m_cell_range.min().x(); i<m_cell_range.max().x(); ++i )
+          m_cells.push_back( grid->cell(i,j) );
+    }
+
+    // Copies keep their own count of exact calls.
+    ApproximateTransform( ApproximateTransform const& other )
+      : TransformT( other ), m_bbox( other.m_bbox ), m_table( other.m_table ),
+        m_grid( other.m_grid ), m_cell_range( other.m_cell_range ), m_cells( other.m_cells ),
+        m_exact_calls( 0 ) {}
+
+    ~ApproximateTransform() {
+      if( m_grid && m_exact_calls )
+        m_grid->stats().add_exact_calls( m_exact_calls );
+    }
+
+    inline Vector2 reverse( Vector2 const& p ) const {
+      if( m_grid ) {
+        if( leaf_type const* leaf = find_leaf( p ) )
+          return transform_p::interpolate_table( leaf->table, leaf->bbox, p );
+        ++m_exact_calls;
+        return TransformT::reverse( p );
+      }
+
+      // Fall back if the function was not approximatable.
+      if( ! m_table.is_valid_image() )
+        return TransformT::reverse( p );
+      return transform_p::interpolate_table( m_table, m_bbox, p );
+    }
+
+    /// Evaluates reverse() at the n points (x0+k,y), writing them to
+    /// out. The results are the same as calling reverse() on every
+    /// point, but the vertical half of the interpolation is done once
+    /// per row instead of once per point.
+    void reverse_row( double y, double x0, int32 n, Vector2* out ) const {
+      using transform_p::exact_reverse_row;
+      TransformT const& exact = *this;
+      if( !m_grid ) {
+        if( ! m_table.is_valid_image() ) {
+          exact_reverse_row( exact, y, x0, n, out );
+        }
+        else {
+          transform_p::interpolate_table_row( m_table, m_bbox, y, x0, n, out );
+        }
+        return;
+      }
+
+      // Split the row where it crosses into the next leaf_size square,
+      // which never straddles two leaves, and where it enters or leaves
+      // the table of a leaf cropped to the domain.
+      double size = m_grid->leaf_size();
+      int32 k = 0;
+      while( k < n ) {
+        Vector2 p( x0 + k, y );
+        double boundary = ( math::impl::_floor( p.x() / size ) + 1 ) * size;
+        int32 end = k + std::max( 1, int32( std::ceil( boundary - p.x() ) ) );
+        if( end > n ) end = n;
+        leaf_type const* leaf = square_leaf( p );
+        if( leaf && covers( *leaf, p ) ) {
+          end = std::min( end, k + 1 + int32( std::floor( leaf->bbox.max().x() - p.x() ) ) );
+          transform_p::interpolate_table_row( leaf->table, leaf->bbox, y, p.x(), end-k, out+k );
+        }
+        else {
+          if( leaf && p.x() < leaf->bbox.min().x() && covers( *leaf, Vector2( leaf->bbox.min().x(), y ) ) )
+            end = std::min( end, k + int32( std::ceil( leaf->bbox.min().x() - p.x() ) ) );
+          exact_reverse_row( exact, y, p.x(), end-k, out+k );
+          m_exact_calls += end-k;
+        }
+        k = end;
+      }
+    }
+
     // Never re-approximate the approximation.
     virtual double tolerance() const { return 0; }
 
@@ -325,6 +767,117 @@ namespace vw {
   }
 
 
+  /// \cond INTERNAL
+  namespace transform_p {
+
+    // Computes the source coordinates of the n pixels (x0+k,y). The
+    // views hold their transform by value, so the exact reverse() is
+    // qualified to skip the virtual dispatch the compiler could
+    // otherwise not see through.
+    template <class TransformT>
+    inline void reverse_row( TransformT const& mapper, double y, double x0, int32 n, Vector2* out ) {
+      exact_reverse_row( mapper, y, x0, n, out );
+    }
+
+    template <class TransformT>
+    inline void reverse_row( ApproximateTransform<TransformT> const& mapper, double y, double x0, int32 n, Vector2* out ) {
+      mapper.reverse_row( y, x0, n, out );
+    }
+
+    // Views over a transform with a tolerance share one grid of lookup
+    // tables, over the view, between all the tiles they rasterize.
+    template <class TransformT>
+    boost::shared_ptr<ApproximationGrid<TransformT> > make_approximation_grid( TransformT const& transform,
+                                                                             int32 width, int32 height ) {
+      boost::shared_ptr<ApproximationGrid<TransformT> > grid;
+      if( transform.tolerance() > 0.0 )
+        grid.reset( new ApproximationGrid<TransformT>( transform, BBox2i(0,0,width,height) ) );
+      return grid;
+    }
+
+    // The approximation grid of a view and its copies, made the first
+    // time one of them is rasterized.
+    template <class TransformT>
+    class LazyApproximationGrid : private boost::noncopyable {
+      typedef boost::shared_ptr<ApproximationGrid<TransformT> > grid_ptr;
+      Mutex    m_mutex;
+      bool     m_made;
+      grid_ptr m_grid;
+    public:
+      LazyApproximationGrid() : m_made(false) {}
+      explicit LazyApproximationGrid( grid_ptr const& grid ) : m_made(true), m_grid(grid) {}
+
+      // The grid, or null if it was not made yet.
+      grid_ptr get() {
+        Mutex::Lock lock( m_mutex );
+        return m_grid;
+      }
+
+      grid_ptr make( TransformT const& transform, int32 width, int32 height ) {
+        Mutex::Lock lock( m_mutex );
+        if( !m_made ) {
+          m_grid = make_approximation_grid( transform, width, height );
+          m_made = true;
+        }
+        return m_grid;
+      }
+    };
+
+    // Rasterizes a transformed, already prerasterized image one row
+    // at a time. The source coordinates of a row are computed once and
+    // shared by all planes. If nodata is set, source points closer
+    // than pixel_buffer to the edge of the image produce nodata.
+    template <class ImageT, class TransformT, class DestT>
+    void rasterize_rows( ImageT const& image, TransformT const& mapper,
+                         DestT const& dest, BBox2i const& bbox,
+                         typename ImageT::pixel_type const* nodata = 0,
+                         int pixel_buffer = 0 ) {
+      typedef typename DestT::pixel_type     DestPixelT;
+      typedef typename DestT::pixel_accessor DestAccT;
+      VW_ASSERT( int(dest.cols())==bbox.width() && int(dest.rows())==bbox.height() && dest.planes()==image.planes(),
+                 ArgumentErr() << "rasterize: Source and destination must have same dimensions." );
+      if( bbox.empty() )
+        return;
+
+      // A local copy lets the compiler keep the source's pointers and
+      // strides in registers while writing to dest.
+      ImageT const src( image );
+      int32 width = bbox.width();
+      std::vector<Vector2> coords( width );
+      double min_x = pixel_buffer - 1, max_x = src.cols() - pixel_buffer;
+      double min_y = pixel_buffer - 1, max_y = src.rows() - pixel_buffer;
+
+      DestAccT drow = dest.origin();
+      for( int32 row=0; row<bbox.height(); ++row ) {
+        reverse_row( mapper, bbox.min().y()+row, bbox.min().x(), width, &coords[0] );
+        DestAccT dplane = drow;
+        for( int32 plane=0; plane<src.planes(); ++plane ) {
+          DestAccT dcol = dplane;
+          if( nodata ) {
+            for( int32 col=0; col<width; ++col, dcol.next_col() ) {
+              Vector2 const& pt = coords[col];
+              if( pt[0] < min_x || pt[0] >= max_x || pt[1] < min_y || pt[1] >= max_y ) {
+                *dcol = DestPixelT( *nodata );
+              } else {
+                DestPixelT buffer( src( pt[0], pt[1], plane ) );
+                *dcol = buffer;
+              }
+            }
+          } else {
+            for( int32 col=0; col<width; ++col, dcol.next_col() ) {
+              DestPixelT buffer( src( coords[col][0], coords[col][1], plane ) );
+              *dcol = buffer;
+            }
+          }
+          dplane.next_plane();
+        }
+        drow.next_row();
+      }
+    }
+
+  } // namespace transform_p
+  /// \endcond
+
   // ------------------------
   // class TransformView
   // ------------------------
@@ -338,6 +891,11 @@ namespace vw {
     ImageT     m_image;
     TransformT m_mapper;
     int32      m_width, m_height;
+    boost::shared_ptr<transform_p::LazyApproximationGrid<TransformT> > m_grid;
+
+    boost::shared_ptr<ApproximationGrid<TransformT> > grid() const {
+      return m_grid->make( m_mapper, m_width, m_height );
+    }
 
   public:
     typedef typename ImageT::pixel_type pixel_type;
@@ -347,11 +905,19 @@ namespace vw {
     // The default constructor creates a tranformed image with the
     // same dimensions as the original.
     TransformView( ImageT const& view, TransformT const& mapper ) :
-      m_image(view), m_mapper(mapper), m_width(view.cols()), m_height(view.rows()) {}
+      m_image(view), m_mapper(mapper), m_width(view.cols()), m_height(view.rows()),
+      m_grid(new transform_p::LazyApproximationGrid<TransformT>) {}
 
     // This constructor allows you to specify the size of the transformed image.
     TransformView( ImageT const& view, TransformT const& mapper, int32 width, int32 height ) :
-      m_image(view), m_mapper(mapper), m_width(width), m_height(height) {}
+      m_image(view), m_mapper(mapper), m_width(width), m_height(height),
+      m_grid(new transform_p::LazyApproximationGrid<TransformT>) {}
+
+    // This constructor shares an existing approximation grid, which may be null.
+    TransformView( ImageT const& view, TransformT const& mapper, int32 width, int32 height,
+                   boost::shared_ptr<ApproximationGrid<TransformT> > const& grid ) :
+      m_image(view), m_mapper(mapper), m_width(width), m_height(height),
+      m_grid(new transform_p::LazyApproximationGrid<TransformT>(grid)) {}
 
     inline int32 cols  () const { return m_width;          }
     inline int32 rows  () const { return m_height;         }
@@ -367,22 +933,42 @@ namespace vw {
     ImageT     const& child()     const { return m_image;  }
     TransformT const& transform() const { return m_mapper; }
 
+    /// The lookup tables shared by all tiles of this view, or null if
+    /// the transform has no tolerance or the view was not rasterized
+    /// yet. Its stats() tell how many exact transform calls
+    /// rasterization needed.
+    boost::shared_ptr<ApproximationGrid<TransformT> > approximation_grid() const { return m_grid->get(); }
+
     // \cond INTERNAL
     typedef TransformView<typename ImageT::prerasterize_type, TransformT> prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
       BBox2i transformed_bbox = m_mapper.reverse_bbox(bbox);
-      return prerasterize_type( m_image.prerasterize(transformed_bbox), m_mapper, m_width, m_height );
+      return prerasterize_type( m_image.prerasterize(transformed_bbox), m_mapper, m_width, m_height, grid() );
     }
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
-      if( m_mapper.tolerance() > 0.0 ) {
+      boost::shared_ptr<ApproximationGrid<TransformT> > approx_grid = grid();
+      if( approx_grid ) {
+        {
+          ApproximateTransform<TransformT> approx_transform( approx_grid, bbox );
+          TransformView<ImageT, ApproximateTransform<TransformT> > approx_view( m_image, approx_transform, m_width, m_height );
+          approx_view.prerasterize(bbox).rasterize_rows( dest, bbox );
+        }
+        approx_grid->stats().add_pixels( uint64(bbox.width()) * bbox.height() );
+      }
+      else if( m_mapper.tolerance() > 0.0 ) {
+        // A null grid was shared with this view.
         ApproximateTransform<TransformT> approx_transform( m_mapper, bbox );
         TransformView<ImageT, ApproximateTransform<TransformT> > approx_view( m_image, approx_transform, m_width, m_height );
-        vw::rasterize( approx_view.prerasterize(bbox), dest, bbox );
+        approx_view.prerasterize(bbox).rasterize_rows( dest, bbox );
       }
       else {
-        vw::rasterize( prerasterize(bbox), dest, bbox );
+        prerasterize(bbox).rasterize_rows( dest, bbox );
       }
     }
+    // Row-at-a-time rasterization of an already prerasterized view.
+    template <class DestT> inline void rasterize_rows( DestT const& dest, BBox2i const& bbox ) const {
+      transform_p::rasterize_rows( m_image, m_mapper, dest, bbox );
+    }
     // \endcond
   };
 
@@ -407,6 +993,11 @@ namespace vw {
     TransformT m_mapper;
     int32      m_width, m_height;
     int        m_pixel_buffer;
+    boost::shared_ptr<transform_p::LazyApproximationGrid<TransformT> > m_grid;
+
+    boost::shared_ptr<ApproximationGrid<TransformT> > grid() const {
+      return m_grid->make( m_mapper, m_width, m_height );
+    }
   public:
     typedef typename ImageT::pixel_type                  pixel_type;
     typedef pixel_type                                   result_type;
@@ -419,7 +1010,18 @@ namespace vw {
                          typename ImageT::pixel_type nodata_val,
                          int pixel_buffer) :
       m_image(view), m_mapper(mapper), m_width(width), m_height(height),
-      m_nodata_val(nodata_val), m_pixel_buffer(pixel_buffer) {}
+      m_nodata_val(nodata_val), m_pixel_buffer(pixel_buffer),
+      m_grid(new transform_p::LazyApproximationGrid<TransformT>) {}
+
+    // This constructor shares an existing approximation grid, which may be null.
+    TransformViewNoData( ImageT const& view, TransformT const& mapper,
+                         int32 width, int32 height,
+                         typename ImageT::pixel_type nodata_val,
+                         int pixel_buffer,
+                         boost::shared_ptr<ApproximationGrid<TransformT> > const& grid ) :
+      m_image(view), m_mapper(mapper), m_width(width), m_height(height),
+      m_nodata_val(nodata_val), m_pixel_buffer(pixel_buffer),
+      m_grid(new transform_p::LazyApproximationGrid<TransformT>(grid)) {}
 
     inline int32 cols  () const { return m_width; }
     inline int32 rows  () const { return m_height; }
@@ -439,25 +1041,43 @@ namespace vw {
     ImageT const& child() const { return m_image; }
     TransformT const& transform() const { return m_mapper; }
 
+    /// The lookup tables shared by all tiles of this view, or null if
+    /// the transform has no tolerance or the view was not rasterized
+    /// yet.
+    boost::shared_ptr<ApproximationGrid<TransformT> > approximation_grid() const { return m_grid->get(); }
+
     // \cond INTERNAL
     typedef TransformViewNoData<typename ImageT::prerasterize_type,
                                 TransformT> prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
       BBox2i transformed_bbox = m_mapper.reverse_bbox(bbox);
       return prerasterize_type( m_image.prerasterize(transformed_bbox), m_mapper,
-                                m_width, m_height, m_nodata_val, m_pixel_buffer);
+                                m_width, m_height, m_nodata_val, m_pixel_buffer, grid() );
     }
     template <class DestT> inline void rasterize( DestT const& dest,
                                                   BBox2i const& bbox ) const {
-      if( m_mapper.tolerance() > 0.0 ) {
+      boost::shared_ptr<ApproximationGrid<TransformT> > approx_grid = grid();
+      if( approx_grid ) {
+        {
+          ApproximateTransform<TransformT> approx_transform( approx_grid, bbox );
+          TransformViewNoData<ImageT, ApproximateTransform<TransformT> > approx_view( m_image, approx_transform, m_width, m_height, m_nodata_val, m_pixel_buffer );
+          approx_view.prerasterize(bbox).rasterize_rows( dest, bbox );
+        }
+        approx_grid->stats().add_pixels( uint64(bbox.width()) * bbox.height() );
+      }
+      else if( m_mapper.tolerance() > 0.0 ) {
         ApproximateTransform<TransformT> approx_transform( m_mapper, bbox );
         TransformViewNoData<ImageT, ApproximateTransform<TransformT> > approx_view( m_image, approx_transform, m_width, m_height, m_nodata_val, m_pixel_buffer );
-        vw::rasterize( approx_view.prerasterize(bbox), dest, bbox );
+        approx_view.prerasterize(bbox).rasterize_rows( dest, bbox );
       }
       else {
-        vw::rasterize( prerasterize(bbox), dest, bbox );
+        prerasterize(bbox).rasterize_rows( dest, bbox );
       }
     }
+    // Row-at-a-time rasterization of an already prerasterized view.
+    template <class DestT> inline void rasterize_rows( DestT const& dest, BBox2i const& bbox ) const {
+      transform_p::rasterize_rows( m_image, m_mapper, dest, bbox, &m_nodata_val, m_pixel_buffer );
+    }
     // \endcond
   };
 
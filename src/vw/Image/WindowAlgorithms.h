@@ -196,9 +196,11 @@ public:
                      bbox.width () + m_window_size[0]-1, 
                      bbox.height() + m_window_size[1]-1 );
     // Take an edge extended image view of the input support region
-    ImageView<typename ImageT::pixel_type> src = edge_extend(m_image, src_bbox, m_edge);
+    CropView<ImageView<typename ImageT::pixel_type> > src = edge_extend_buffer(m_image, src_bbox, m_edge);
     // Use the crop trick to fake that the support region is the same size as the entire image.
-    return prerasterize_type( crop(src, -src_bbox.min().x(), -src_bbox.min().y(), m_image.cols(), m_image.rows()),
+    return prerasterize_type( CropView<ImageView<typename ImageT::pixel_type> >(
+                                src.child(), src.col_offset() - src_bbox.min().x(),
+                                src.row_offset() - src_bbox.min().y(), m_image.cols(), m_image.rows() ),
                               m_window_size, m_functor, NoEdgeExtension() );
   }
 
@@ -0,0 +1,205 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+// TestConnectedComponents.h
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+
+#include <vw/Image/ConnectedComponents.h>
+#include <vw/Image/Filter.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelMask.h>
+
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+using namespace vw;
+
+typedef PixelMask<uint8> MPx;
+
+// Random blobs that wander across tile edges
+static ImageView<MPx> test_image( int32 cols, int32 rows ) {
+  srand(11);
+  ImageView<MPx> image( cols, rows );
+  for ( int32 row = 0; row < rows; ++row )
+    for ( int32 col = 0; col < cols; ++col )
+      if ( rand() % 100 < 35 )
+        image( col, row ) = MPx( 1 );
+  return image;
+}
+
+// Checks that two label images describe the same partition
+static void expect_same_components( ImageView<uint32> const& a, ImageView<uint32> const& b ) {
+  std::map<uint32,uint32> a_to_b, b_to_a;
+  for ( int32 row = 0; row < a.rows(); ++row )
+    for ( int32 col = 0; col < a.cols(); ++col ) {
+      uint32 la = a( col, row ), lb = b( col, row );
+      ASSERT_EQ( la == 0, lb == 0 ) << col << " " << row;
+      if ( la == 0 )
+        continue;
+      if ( a_to_b.count( la ) ) {
+        EXPECT_EQ( a_to_b[la], lb ) << col << " " << row;
+      }
+      if ( b_to_a.count( lb ) ) {
+        EXPECT_EQ( b_to_a[lb], la ) << col << " " << row;
+      }
+      a_to_b[la] = lb;
+      b_to_a[lb] = la;
+    }
+}
+
+// Flood fill labeling to compare against
+static ImageView<uint32> flood_fill_labels( ImageView<MPx> const& image ) {
+  ImageView<uint32> labels( image.cols(), image.rows() );
+  uint32 count = 0;
+  for ( int32 row = 0; row < image.rows(); ++row )
+    for ( int32 col = 0; col < image.cols(); ++col ) {
+      if ( !is_valid( image( col, row ) ) || labels( col, row ) )
+        continue;
+      labels( col, row ) = ++count;
+      std::vector<Vector2i> stack( 1, Vector2i( col, row ) );
+      while ( !stack.empty() ) {
+        Vector2i p = stack.back();
+        stack.pop_back();
+        for ( int32 dy = -1; dy <= 1; ++dy )
+          for ( int32 dx = -1; dx <= 1; ++dx ) {
+            Vector2i q = p + Vector2i( dx, dy );
+            if ( q.x() < 0 || q.y() < 0 || q.x() >= image.cols() || q.y() >= image.rows() )
+              continue;
+            if ( is_valid( image( q.x(), q.y() ) ) && !labels( q.x(), q.y() ) ) {
+              labels( q.x(), q.y() ) = count;
+              stack.push_back( q );
+            }
+          }
+      }
+    }
+  return labels;
+}
+
+TEST( ConnectedComponents, MatchesFloodFill ) {
+  ImageView<MPx> image = test_image( 53, 41 );
+  ImageView<uint32> expected = flood_fill_labels( image );
+
+  ConnectedComponents components( image, 8, 3 );
+  ImageView<uint32> labels = component_labels( image, components );
+  expect_same_components( expected, labels );
+
+  // Sizes and bounding boxes add up
+  uint64 total = 0;
+  for ( uint32 l = 1; l <= components.num_components(); ++l )
+    total += components.size( l );
+  uint64 valid = 0;
+  for ( int32 row = 0; row < image.rows(); ++row )
+    for ( int32 col = 0; col < image.cols(); ++col )
+      if ( is_valid( image( col, row ) ) ) {
+        valid++;
+        EXPECT_TRUE( components.bounding_box( labels( col, row ) ).contains( Vector2i( col, row ) ) );
+      }
+  EXPECT_EQ( valid, total );
+}
+
+TEST( ConnectedComponents, TileSizeIndependent ) {
+  ImageView<MPx> image = test_image( 40, 33 );
+  ConnectedComponents whole( image, 64, 1 );
+  ConnectedComponents tiled( image, 5, 2 );
+  EXPECT_EQ( whole.num_components(), tiled.num_components() );
+
+  ImageView<uint32> a = component_labels( image, whole );
+  ImageView<uint32> b = component_labels( image, tiled );
+  expect_same_components( a, b );
+  for ( int32 row = 0; row < image.rows(); ++row )
+    for ( int32 col = 0; col < image.cols(); ++col )
+      if ( a( col, row ) ) {
+        EXPECT_EQ( whole.size( a( col, row ) ), tiled.size( b( col, row ) ) );
+      }
+}
+
+TEST( ConnectedComponents, Diagonal ) {
+  // One component that only connects through the corners of four tiles
+  ImageView<MPx> image( 6, 6 );
+  image( 2, 2 ) = MPx( 1 );
+  image( 3, 3 ) = MPx( 1 );
+  image( 2, 4 ) = MPx( 1 );
+  image( 1, 5 ) = MPx( 1 );
+  ConnectedComponents components( image, 3, 1 );
+  EXPECT_EQ( 1u, components.num_components() );
+  EXPECT_EQ( 4u, components.size( 1 ) );
+  EXPECT_EQ( BBox2i( 1, 2, 3, 4 ), components.bounding_box( 1 ) );
+}
+
+namespace {
+  // Throws for the pixels of one column
+  struct FailAtColumn : ReturnFixedType<uint8> {
+    uint8 operator()( uint8 value ) const {
+      if ( value == 7 )
+        vw_throw( IOErr() << "FailAtColumn: bad pixel." );
+      return value;
+    }
+  };
+
+  // Counts the source pixels read
+  struct CountReads : ReturnFixedType<MPx> {
+    int32* m_count;
+    CountReads( int32* count ) : m_count(count) {}
+    MPx operator()( MPx const& value ) const {
+      ++*m_count;
+      return value;
+    }
+  };
+}
+
+TEST( ConnectedComponents, PixelReads ) {
+  // Reading pixels one at a time matches block rasterizing, and labels
+  // each tile once when read in raster order
+  ImageView<MPx> image = test_image( 40, 33 );
+  ConnectedComponents components( image, 8, 1 );
+  ImageView<uint32> expected = component_labels( image, components );
+
+  int32 count = 0;
+  ComponentLabelView<UnaryPerPixelView<ImageView<MPx>, CountReads> > view =
+    component_labels( per_pixel_filter( image, CountReads( &count ) ), components );
+  for ( int32 row = 0; row < image.rows(); ++row )
+    for ( int32 col = 0; col < image.cols(); ++col )
+      EXPECT_EQ( expected( col, row ), view( col, row ) ) << col << " " << row;
+  EXPECT_EQ( image.cols() * image.rows(), count );
+
+  count = 0;
+  ImageView<uint32> accessed( image.cols(), image.rows() );
+  typedef ComponentLabelView<UnaryPerPixelView<ImageView<MPx>, CountReads> >::pixel_accessor Acc;
+  Acc row_acc = view.origin();
+  for ( int32 row = 0; row < image.rows(); ++row, row_acc.next_row() ) {
+    Acc acc = row_acc;
+    for ( int32 col = 0; col < image.cols(); ++col, acc.next_col() )
+      accessed( col, row ) = *acc;
+  }
+  EXPECT_EQ( image.cols() * image.rows(), count );
+  for ( int32 row = 0; row < image.rows(); ++row )
+    for ( int32 col = 0; col < image.cols(); ++col )
+      EXPECT_EQ( expected( col, row ), accessed( col, row ) );
+}
+
+TEST( ConnectedComponents, SourceErrors ) {
+  // A read error in a tile reaches the caller, with its type
+  ImageView<uint8> image( 40, 33 );
+  for ( int32 row = 0; row < image.rows(); ++row )
+    for ( int32 col = 0; col < image.cols(); ++col )
+      image( col, row ) = col == 27 ? 7 : 1;
+  EXPECT_THROW( ConnectedComponents( per_pixel_filter( image, FailAtColumn() ), 8, 1 ), IOErr );
+  EXPECT_THROW( ConnectedComponents( per_pixel_filter( image, FailAtColumn() ), 8, 4 ), IOErr );
+}
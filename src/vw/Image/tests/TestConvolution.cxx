@@ -219,3 +219,93 @@ TEST( Convolution, Prerasterize ) {
   EXPECT_EQ(right_buf(1000,100), 0.0);
   EXPECT_EQ(right_buf(900,100), 1.0);
 }
+
+// The rasterized result goes through the row based code, while
+// operator() convolves each pixel with the 2D kernel.
+template <class PixelT, class KernelT>
+static void check_against_pixel_access( ImageView<PixelT> const& src,
+                                        std::vector<KernelT> const& ik,
+                                        std::vector<KernelT> const& jk, double tol ) {
+  SeparableConvolutionView<ImageView<PixelT>,KernelT,ConstantEdgeExtension> cnv( src, ik, jk );
+  ImageView<PixelT> dst = cnv;
+  ImageView<PixelT> cropped = crop( cnv, BBox2i(3,2,9,7) );
+  for ( int32 y = 0; y < src.rows(); ++y )
+    for ( int32 x = 0; x < src.cols(); ++x ) {
+      EXPECT_PIXEL_NEAR( dst(x,y), cnv(x,y), tol ) << x << "," << y;
+      if ( x >= 3 && x < 12 && y >= 2 && y < 9 ) {
+        EXPECT_PIXEL_NEAR( cropped(x-3,y-2), dst(x,y), tol );
+      }
+    }
+}
+
+TEST( Convolution, SeparableView_RowKernels ) {
+  ImageView<double> src(23,17);
+  ImageView<PixelRGB<float> > rgb(23,17);
+  for ( int32 y = 0; y < src.rows(); ++y )
+    for ( int32 x = 0; x < src.cols(); ++x ) {
+      src(x,y) = sin( x * 0.7 ) + cos( y * 1.3 ) * x;
+      rgb(x,y) = PixelRGB<float>( x, y, x*y % 7 );
+    }
+
+  std::vector<double> gauss, box( 5, 0.2 ), asym, none;
+  generate_gaussian_kernel( gauss, 1.5 );
+  asym.push_back( 1 ); asym.push_back( -2 ); asym.push_back( 0.5 ); asym.push_back( 3 );
+
+  check_against_pixel_access( src, gauss, gauss, 1e-12 );
+  check_against_pixel_access( src, box, asym, 1e-12 );
+  check_against_pixel_access( src, none, gauss, 1e-12 );
+  check_against_pixel_access( src, asym, none, 1e-12 );
+  check_against_pixel_access( rgb, gauss, box, 1e-4 );
+}
+
+TEST( Convolution, SeparableView_Box ) {
+  std::vector<double> box( 3, 1/3.0 );
+  ImageView<uint8> src(9,7);
+  for ( int32 y = 0; y < src.rows(); ++y )
+    for ( int32 x = 0; x < src.cols(); ++x )
+      src(x,y) = uint8( (x*37 + y*91) % 256 );
+  check_against_pixel_access( src, box, box, 1 );
+
+  // A NaN only reaches the outputs whose window covers it
+  ImageView<float> nan_src(9,7);
+  fill( nan_src, 1.0f );
+  nan_src(4,3) = std::numeric_limits<float>::quiet_NaN();
+  ImageView<float> dst = separable_convolution_filter( nan_src, box, box, ConstantEdgeExtension() );
+  for ( int32 y = 0; y < dst.rows(); ++y )
+    for ( int32 x = 0; x < dst.cols(); ++x ) {
+      if ( std::abs( x - 4 ) <= 1 && std::abs( y - 3 ) <= 1 ) {
+        EXPECT_TRUE( dst(x,y) != dst(x,y) ) << x << "," << y;
+      } else {
+        EXPECT_NEAR( 1.0, dst(x,y), 1e-6 ) << x << "," << y;
+      }
+    }
+}
+
+TEST( Convolution, SeparableView_Integer ) {
+  // The binomial kernel is summed exactly in fixed point. Each pass
+  // truncates to uint8, like the floating point version.
+  ImageView<uint8> src(6,1);
+  src(0,0) = 0; src(1,0) = 255; src(2,0) = 17; src(3,0) = 3; src(4,0) = 200; src(5,0) = 90;
+  std::vector<float> binomial;
+  binomial.push_back( 1/16.f ); binomial.push_back( 4/16.f ); binomial.push_back( 6/16.f );
+  binomial.push_back( 4/16.f ); binomial.push_back( 1/16.f );
+  std::vector<float> none;
+  ImageView<uint8> dst = separable_convolution_filter( src, binomial, none, ZeroEdgeExtension() );
+  for ( int32 x = 0; x < src.cols(); ++x ) {
+    int sum = 0;
+    for ( int32 t = -2; t <= 2; ++t )
+      if ( x+t >= 0 && x+t < src.cols() )
+        sum += int( binomial[t+2] * 16 ) * src(x+t,0);
+    EXPECT_EQ( sum / 16, dst(x,0) );
+  }
+
+  // Negative sums are clamped
+  std::vector<float> diff; diff.push_back( -1 ); diff.push_back( 0 ); diff.push_back( 1 );
+  dst = separable_convolution_filter( src, diff, none, ZeroEdgeExtension() );
+  EXPECT_EQ( 0,   dst(0,0) );
+  EXPECT_EQ( 0,   dst(1,0) );
+  EXPECT_EQ( 252, dst(2,0) );
+  EXPECT_EQ( 0,   dst(3,0) );
+  EXPECT_EQ( 0,   dst(4,0) );
+  EXPECT_EQ( 200, dst(5,0) );
+}
@@ -0,0 +1,114 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+// TestDistanceTransform.h
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+
+#include <vw/Image/DistanceTransform.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+using namespace vw;
+
+// A sparse random pattern of zeros
+static ImageView<uint8> test_mask( int32 cols, int32 rows, int32 one_in ) {
+  srand(7);
+  ImageView<uint8> mask( cols, rows );
+  for ( int32 row = 0; row < rows; ++row )
+    for ( int32 col = 0; col < cols; ++col )
+      mask( col, row ) = ( rand() % one_in == 0 ) ? 0 : 1;
+  return mask;
+}
+
+static float brute_force_distance( ImageView<uint8> const& mask, int32 col, int32 row,
+                                   bool ignore_borders ) {
+  double best = std::numeric_limits<double>::infinity();
+  for ( int32 r = 0; r < mask.rows(); ++r )
+    for ( int32 c = 0; c < mask.cols(); ++c )
+      if ( mask( c, r ) == 0 )
+        best = std::min( best, std::sqrt( double( (c-col)*(c-col) + (r-row)*(r-row) ) ) );
+  if ( !ignore_borders ) {
+    best = std::min( best, double( std::min( col + 1, mask.cols() - col ) ) );
+    best = std::min( best, double( std::min( row + 1, mask.rows() - row ) ) );
+  }
+  return float(best);
+}
+
+TEST( DistanceTransform, Exact ) {
+  ImageView<uint8> mask = test_mask( 37, 29, 40 );
+  for ( int i = 0; i < 2; ++i ) {
+    bool ignore_borders = ( i == 1 );
+    ImageView<float> dist = euclidean_distance_transform( mask, ignore_borders );
+    ASSERT_EQ( mask.cols(), dist.cols() );
+    ASSERT_EQ( mask.rows(), dist.rows() );
+    for ( int32 row = 0; row < mask.rows(); ++row )
+      for ( int32 col = 0; col < mask.cols(); ++col )
+        EXPECT_NEAR( brute_force_distance( mask, col, row, ignore_borders ),
+                     dist( col, row ), 1e-4 ) << col << " " << row;
+  }
+}
+
+TEST( DistanceTransform, Threaded ) {
+  ImageView<uint8> mask = test_mask( 400, 300, 500 );
+  ImageView<float> single, threaded;
+  euclidean_distance_transform( mask, single, false, 1 );
+  euclidean_distance_transform( mask, threaded, false, 4 );
+  for ( int32 row = 0; row < mask.rows(); ++row )
+    for ( int32 col = 0; col < mask.cols(); ++col )
+      EXPECT_EQ( single( col, row ), threaded( col, row ) );
+}
+
+TEST( DistanceTransform, NoZeros ) {
+  ImageView<uint8> mask( 5, 4 );
+  fill( mask, 1 );
+  ImageView<float> dist = euclidean_distance_transform( mask );
+  EXPECT_EQ( 1, dist( 0, 2 ) );
+  EXPECT_EQ( 2, dist( 2, 1 ) );
+  dist = euclidean_distance_transform( mask, true );
+  EXPECT_EQ( std::numeric_limits<float>::infinity(), dist( 2, 1 ) );
+}
+
+TEST( DistanceTransform, View ) {
+  ImageView<uint8> mask = test_mask( 61, 47, 150 );
+  const float max_distance = 6.5;
+  for ( int i = 0; i < 2; ++i ) {
+    bool ignore_borders = ( i == 1 );
+    ImageView<float> full = euclidean_distance_transform( mask, ignore_borders );
+    EuclideanDistanceView<ImageView<uint8> > view =
+      euclidean_distance_view( mask, max_distance, ignore_borders );
+
+    // Rasterize in tiles much smaller than the image
+    ImageView<float> tiled( mask.cols(), mask.rows() );
+    for ( int32 row = 0; row < mask.rows(); row += 8 )
+      for ( int32 col = 0; col < mask.cols(); col += 8 ) {
+        BBox2i bbox( col, row, 8, 8 );
+        bbox.crop( bounding_box( mask ) );
+        crop( tiled, bbox ) = crop( view, bbox );
+      }
+
+    for ( int32 row = 0; row < mask.rows(); ++row )
+      for ( int32 col = 0; col < mask.cols(); ++col )
+        EXPECT_EQ( std::min( full( col, row ), max_distance ), tiled( col, row ) );
+    EXPECT_EQ( std::min( full( 30, 20 ), max_distance ), view( 30, 20 ) );
+  }
+}
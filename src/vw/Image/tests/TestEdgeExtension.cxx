@@ -25,6 +25,10 @@
 #include <vw/Image/PixelAccessors.h>    // for ProceduralPixelAccessor
 #include <vw/Image/EdgeExtension.h>     // for EdgeExtensionView, etc
 #include <vw/Image/ImageView.h>         // for ImageView
+#include <vw/Image/ImageMath.h>         // for operator+
+#include <vw/Image/Filter.h>            // for gaussian_filter
+#include <vw/Image/BlockRasterize.h>    // for block_rasterize
+#include <vw/Core/Stopwatch.h>          // for Stopwatch
 
 #include <algorithm>                    // for min, max
 #include <new>                          // for operator new[]
@@ -464,3 +468,84 @@ template <class PixelT>
 FloatingView<PixelT> floating_view( PixelT const& /*value*/, int32 cols, int32 rows, int32 planes=1 ) {
   return FloatingView<PixelT>( cols, rows, planes );
 }
+
+// edge_extend_buffer() against the edge extension view, for a tile
+// inside the image, tiles over each edge and a tile past the corner.
+template <class ViewT, class ExtensionT>
+static void check_buffer( ViewT const& view, ExtensionT const& extension ) {
+  BBox2i bboxes[] = { BBox2i(2,3,5,4), BBox2i(-3,2,6,5), BBox2i(8,-2,6,7),
+                      BBox2i(-2,-2,17,16), BBox2i(14,12,3,3) };
+  for ( size_t b = 0; b < sizeof(bboxes)/sizeof(BBox2i); ++b ) {
+    ImageView<float> expected = edge_extend( view, bboxes[b], extension );
+    CropView<ImageView<float> > actual = edge_extend_buffer( view, bboxes[b], extension );
+    ASSERT_EQ( expected.cols(), actual.cols() );
+    ASSERT_EQ( expected.rows(), actual.rows() );
+    for ( int32 y = 0; y < expected.rows(); ++y )
+      for ( int32 x = 0; x < expected.cols(); ++x )
+        EXPECT_EQ( expected(x,y), actual(x,y) ) << bboxes[b] << " " << x << "," << y;
+  }
+}
+
+TEST( EdgeExtension, Buffer ) {
+  ImageView<float> im(13,11);
+  for ( int32 y = 0; y < im.rows(); ++y )
+    for ( int32 x = 0; x < im.cols(); ++x )
+      im(x,y) = float( x + 100*y );
+
+  check_buffer( im, ZeroEdgeExtension() );
+  check_buffer( im, ConstantEdgeExtension() );
+  check_buffer( im, ValueEdgeExtension<float>( 7 ) );
+  check_buffer( im, PeriodicEdgeExtension() );
+  check_buffer( im, ReflectEdgeExtension() );
+  check_buffer( im, LinearEdgeExtension() );
+  check_buffer( crop( im, 0, 0, 13, 11 ), ConstantEdgeExtension() );
+  check_buffer( im + 1.0f, ConstantEdgeExtension() );
+  check_buffer( im + 1.0f, ReflectEdgeExtension() );
+
+  // Tiles inside an image in memory are not copied
+  CropView<ImageView<float> > inside = edge_extend_buffer( im, BBox2i(2,3,5,4), ConstantEdgeExtension() );
+  EXPECT_EQ( &im(2,3), &inside(0,0) );
+  CropView<ImageView<float> > cropped =
+    edge_extend_buffer( crop( im, 1, 1, 12, 10 ), BBox2i(2,3,5,4), ConstantEdgeExtension() );
+  EXPECT_EQ( &im(3,4), &cropped(0,0) );
+  CropView<ImageView<float> > border = edge_extend_buffer( im, BBox2i(-1,3,5,4), ConstantEdgeExtension() );
+  EXPECT_NE( &im(0,3), &border(1,0) );
+}
+
+// Run with --gtest_also_run_disabled_tests to compare the bytes copied
+// into tile buffers by a tiled blur with and without edge_extend_buffer().
+TEST( EdgeExtension, DISABLED_BufferBenchmark ) {
+  ImageView<float> im(2048,2048);
+  for ( int32 y = 0; y < im.rows(); ++y )
+    for ( int32 x = 0; x < im.cols(); ++x )
+      im(x,y) = float( (x*7 + y*13) % 255 );
+  const int32 tile = 256, halo = 4;
+
+  double copied_before = 0, copied_after = 0;
+  Stopwatch before, after;
+  for ( int32 y = 0; y < im.rows(); y += tile )
+    for ( int32 x = 0; x < im.cols(); x += tile ) {
+      BBox2i bbox( x - halo, y - halo, tile + 2*halo, tile + 2*halo );
+      before.start();
+      ImageView<float> copy = edge_extend( im, bbox, ConstantEdgeExtension() );
+      before.stop();
+      copied_before += double(bbox.width()) * bbox.height() * sizeof(float);
+
+      after.start();
+      CropView<ImageView<float> > buffer = edge_extend_buffer( im, bbox, ConstantEdgeExtension() );
+      after.stop();
+      if ( buffer.child().data() != im.data() )
+        copied_after += double(bbox.width()) * bbox.height() * sizeof(float);
+    }
+  double pixels = double(im.cols()) * im.rows();
+  std::cout << "Bytes copied per output pixel: " << copied_before / pixels << " before, "
+            << copied_after / pixels << " after\n"
+            << "Tile buffers: " << before.elapsed_seconds() << "s before, "
+            << after.elapsed_seconds() << "s after\n";
+
+  Stopwatch blur;
+  blur.start();
+  ImageView<float> result = block_rasterize( gaussian_filter( im, 1.5 ), Vector2i(tile,tile), 1 );
+  blur.stop();
+  std::cout << "Tiled gaussian_filter: " << blur.elapsed_seconds() << "s\n";
+}
@@ -0,0 +1,213 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <test/Helpers.h>
+
+#include <vw/Core/Stopwatch.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/ImagePyramid.h>
+#include <vw/Image/PixelTypes.h>
+
+#include <cmath>
+
+using namespace vw;
+
+template <class PixelT>
+static ImageView<PixelT> test_image( int32 cols, int32 rows ) {
+  typedef typename CompoundChannelType<PixelT>::type channel_type;
+  ImageView<PixelT> image( cols, rows );
+  for ( int32 row = 0; row < rows; ++row )
+    for ( int32 col = 0; col < cols; ++col )
+      for ( int32 c = 0; c < int32( CompoundNumChannels<PixelT>::value ); ++c )
+        compound_select_channel<channel_type&>( image( col, row ), c ) =
+          channel_type( ( col * 37 + row * 101 + c * 53 + ( col * row ) % 17 ) % 251 );
+  return image;
+}
+
+template <class ImageT>
+static void expect_same( ImageT const& expected, ImageT const& actual ) {
+  ASSERT_EQ( expected.cols(), actual.cols() );
+  ASSERT_EQ( expected.rows(), actual.rows() );
+  for ( int32 row = 0; row < expected.rows(); ++row )
+    for ( int32 col = 0; col < expected.cols(); ++col )
+      EXPECT_EQ( expected( col, row ), actual( col, row ) ) << col << "," << row;
+}
+
+template <class PixelT>
+class PyramidReduce : public ::testing::Test {};
+
+typedef ::testing::Types<PixelGray<float>, PixelRGB<uint8>, PixelGray<int16>, float> ReduceTypes;
+TYPED_TEST_CASE( PyramidReduce, ReduceTypes );
+
+TYPED_TEST( PyramidReduce, MatchesSubsampledFilter ) {
+  typedef TypeParam Px;
+  std::vector<float> kernel = generate_pyramid_smoothing_kernel();
+  for ( int32 size = 1; size < 12; ++size ) {
+    ImageView<Px> image = test_image<Px>( size + 20, size );
+    ImageView<Px> expected = subsample( separable_convolution_filter( image, kernel, kernel ), 2 );
+    ImageView<Px> actual = pyramid_reduce( image, kernel );
+    expect_same( expected, actual );
+  }
+
+  // Even kernels, other edges and a crop that doesn't start at 0
+  std::vector<float> even( 4, 0.25f );
+  even[0] = 0.125f; even[1] = 0.5f;
+  ImageView<Px> image = test_image<Px>( 33, 18 );
+  ImageView<Px> expected = subsample( separable_convolution_filter( image, even, even, ReflectEdgeExtension() ), 2 );
+  ImageView<Px> actual = pyramid_reduce( image, even, ReflectEdgeExtension() );
+  expect_same( expected, actual );
+  expected = crop( subsample( separable_convolution_filter( image, kernel, kernel, ZeroEdgeExtension() ), 2 ),
+                   3, 2, 9, 6 );
+  actual = crop( pyramid_reduce( image, kernel, ZeroEdgeExtension() ), 3, 2, 9, 6 );
+  expect_same( expected, actual );
+}
+
+TEST( PyramidReduce, BoxKernel ) {
+  std::vector<float> box( 3, 1.0f / 3.0f );
+  ImageView<float> image = test_image<float>( 21, 14 );
+  ImageView<float> expected = subsample( separable_convolution_filter( image, box, box ), 2 );
+  ImageView<float> actual = pyramid_reduce( image, box );
+  expect_same( expected, actual );
+}
+
+TEST( PyramidReduce, Masked ) {
+  std::vector<float> kernel = generate_pyramid_smoothing_kernel();
+  ImageView<PixelMask<float> > image( 13, 9 );
+  for ( int32 row = 0; row < image.rows(); ++row )
+    for ( int32 col = 0; col < image.cols(); ++col )
+      image( col, row ) = PixelMask<float>( float( col + 3 * row ) );
+  image( 4, 4 ).invalidate();
+  ImageView<PixelMask<float> > expected = subsample( separable_convolution_filter( image, kernel, kernel ), 2 );
+  ImageView<PixelMask<float> > actual = pyramid_reduce( image, kernel );
+  expect_same( expected, actual );
+}
+
+TEST( ImagePyramid, LevelsMatchRepeatedReduce ) {
+  ImageView<PixelGray<float> > image = test_image<PixelGray<float> >( 150, 97 );
+  ImagePyramid<PixelGray<float> > pyramid( image, "", generate_pyramid_smoothing_kernel(), 16 );
+
+  ImageView<PixelGray<float> > expected = image;
+  for ( int32 l = 0; l < 8; ++l ) {
+    if ( l > 0 )
+      expected = pyramid_reduce( expected );
+    ImageView<PixelGray<float> > actual = pyramid.level( l );
+    expect_same( expected, actual );
+  }
+  EXPECT_EQ( 1, pyramid.level( 8 ).cols() );
+  EXPECT_EQ( 1, pyramid.level( 8 ).rows() );
+
+  // Rasterizing in blocks that don't line up with the tiles
+  ImageView<PixelGray<float> > blocks = block_rasterize( pyramid.level( 2 ), Vector2i( 7, 5 ), 2 );
+  expect_same( ImageView<PixelGray<float> >( pyramid_reduce( pyramid_reduce( image ) ) ), blocks );
+}
+
+TEST( ImagePyramid, Build ) {
+  ImageView<uint8> image = test_image<uint8>( 120, 80 );
+  ImagePyramid<uint8> pyramid( image, "", generate_pyramid_smoothing_kernel(), 32 );
+  pyramid.build( 3, 2 );
+  ImageView<uint8> expected = pyramid_reduce( pyramid_reduce( pyramid_reduce( image ) ) );
+  expect_same( expected, ImageView<uint8>( pyramid.level( 3 ) ) );
+}
+
+namespace {
+  // Fails on pixels past a column, as a bad read would
+  struct FailPastColumn : ReturnFixedType<float> {
+    float operator()( float value ) const {
+      if ( value >= 100 )
+        vw_throw( IOErr() << "FailPastColumn: bad pixel." );
+      return value;
+    }
+  };
+}
+
+TEST( ImagePyramid, BuildErrors ) {
+  ImageView<float> image( 120, 80 );
+  for ( int32 row = 0; row < image.rows(); ++row )
+    for ( int32 col = 0; col < image.cols(); ++col )
+      image( col, row ) = float( col );
+
+  // The exception of a tile reaches the caller, with its type
+  ImagePyramid<float> pyramid( per_pixel_filter( image, FailPastColumn() ), "",
+                               generate_pyramid_smoothing_kernel(), 16 );
+  EXPECT_THROW( pyramid.build( 2, 4 ), IOErr );
+}
+
+TEST( ImagePyramid, SharedById ) {
+  ImageView<float> image = test_image<float>( 64, 48 );
+  ImagePyramid<float> a( image, "TestImagePyramid.SharedById" );
+  ImagePyramid<float> b( image, "TestImagePyramid.SharedById" );
+  ImagePyramid<float> c( image, "TestImagePyramid.Other" );
+  ImagePyramid<float> d( image );
+  EXPECT_TRUE ( a.shares_levels( b ) );
+  EXPECT_FALSE( a.shares_levels( c ) );
+  EXPECT_FALSE( a.shares_levels( d ) );
+
+  // A different kernel is a different pyramid
+  std::vector<float> box( 3, 1.0f / 3.0f );
+  ImagePyramid<float> e( image, "TestImagePyramid.SharedById", box );
+  EXPECT_FALSE( a.shares_levels( e ) );
+
+  // Even if it only differs past the sixth digit
+  std::vector<float> nudged( box );
+  nudged[1] = std::nextafter( nudged[1], 1.0f );
+  ImagePyramid<float> f( image, "TestImagePyramid.SharedById", box );
+  ImagePyramid<float> g( image, "TestImagePyramid.SharedById", nudged );
+  EXPECT_TRUE ( e.shares_levels( f ) );
+  EXPECT_FALSE( e.shares_levels( g ) );
+}
+
+TEST( ImagePyramid, SetLevel ) {
+  ImageView<float> image = test_image<float>( 40, 30 );
+  ImagePyramid<float> pyramid( image );
+
+  // A stored level is read back as is, and the levels after it are
+  // computed from it.
+  ImageView<float> stored( 20, 15 );
+  fill( stored, 5.0f );
+  pyramid.set_level( 1, stored );
+  expect_same( stored, ImageView<float>( pyramid.level( 1 ) ) );
+  expect_same( ImageView<float>( pyramid_reduce( stored ) ), ImageView<float>( pyramid.level( 2 ) ) );
+
+  EXPECT_THROW( pyramid.set_level( 2, stored ), ArgumentErr );
+  EXPECT_THROW( pyramid.set_level( 0, image ), ArgumentErr );
+}
+
+// Run with --gtest_also_run_disabled_tests to compare the fused
+// reduce with smoothing at full resolution and subsampling.
+TEST( PyramidReduce, DISABLED_Benchmark ) {
+  ImageView<PixelGray<float> > image = test_image<PixelGray<float> >( 2048, 2048 );
+  std::vector<float> kernel = generate_pyramid_smoothing_kernel();
+  ImageView<PixelGray<float> > a, b;
+
+  Stopwatch sw;
+  sw.start();
+  for ( int32 i = 0; i < 5; ++i )
+    a = subsample( separable_convolution_filter( image, kernel, kernel ), 2 );
+  sw.stop();
+  double separate = sw.elapsed_seconds();
+
+  sw = Stopwatch();
+  sw.start();
+  for ( int32 i = 0; i < 5; ++i )
+    b = pyramid_reduce( image, kernel );
+  sw.stop();
+  double fused = sw.elapsed_seconds();
+
+  std::cout << "Filter and subsample: " << separate << "s, pyramid_reduce: " << fused << "s\n";
+  expect_same( a, b );
+}
@@ -22,6 +22,11 @@
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageViewRef.h>
 #include <vw/Image/Interpolation.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/ImageMath.h>
+#include <vw/Image/Filter.h>
+#include <vw/Image/Algorithms.h>
+#include <vw/Core/Settings.h>
 
 using namespace vw;
 
@@ -93,3 +98,101 @@ TEST( ImageViewRef, FloatAccess ) {
   EXPECT_EQ( ref(char(0),int32(0)), 0 );
   EXPECT_EQ( ref(char(0),int32(0),0), 0 );
 }
+
+TEST( ImageViewRef, BufferedAccessor ) {
+  uint32 tile_size = vw_settings().default_tile_size();
+  vw_settings().set_default_tile_size( 4 );
+
+  const int cols=11, rows=9;
+  ImageView<float> image(cols,rows,2);
+  for( int p=0; p<2; ++p )
+    for( int r=0; r<rows; ++r )
+      for( int c=0; c<cols; ++c )
+        image(c,r,p) = (float)(p*100+r*cols+c);
+  ImageViewRef<float> ref = edge_extend( image + 1.0f, ConstantEdgeExtension() );
+
+  // Row by row scan across several tiles
+  ImageView<float> result(cols,rows,2);
+  vw::rasterize( ref, result, BBox2i(0,0,cols,rows) );
+  for( int p=0; p<2; ++p )
+    for( int r=0; r<rows; ++r )
+      for( int c=0; c<cols; ++c )
+        EXPECT_EQ( image(c,r,p) + 1, result(c,r,p) );
+
+  // Column scan, backwards moves and copies
+  ImageViewRef<float>::pixel_accessor acc = ref.origin();
+  acc.advance( 7, 0, 1 );
+  for( int r=0; r<rows; ++r, acc.next_row() ) {
+    ImageViewRef<float>::pixel_accessor copy = acc;
+    EXPECT_EQ( image(7,r,1) + 1, *copy );
+    copy.prev_col();
+    EXPECT_EQ( image(6,r,1) + 1, *copy );
+  }
+
+  // Pixels outside the view go to the view itself
+  acc = ref.origin();
+  acc.advance( -2, 3 );
+  EXPECT_EQ( image(0,3) + 1, *acc );
+  acc.advance( cols+4, 0 );
+  EXPECT_EQ( image(cols-1,3) + 1, *acc );
+
+  // A plain image is read in place
+  ImageViewRef<float> plain = image;
+  ImageViewRef<float>::pixel_accessor pacc = plain.origin();
+  pacc.advance( 3, 5, 1 );
+  EXPECT_EQ( image(3,5,1), *pacc );
+  image(3,5,1) = -1;
+  EXPECT_EQ( -1, *pacc );
+
+  vw_settings().set_default_tile_size( tile_size );
+}
+
+// Counts the pixels that are computed
+struct CountingFunc : ReturnFixedType<float> {
+  int32* count;
+  CountingFunc( int32* count ) : count( count ) {}
+  float operator()( float value ) const { ++*count; return value + 1; }
+};
+
+TEST( ImageViewRef, AccessorSamples ) {
+  const int cols=600, rows=500;
+  ImageView<float> image(cols,rows);
+  for( int r=0; r<rows; ++r )
+    for( int c=0; c<cols; ++c )
+      image(c,r) = (float)(c + 2*r);
+  int32 count = 0;
+  ImageViewRef<float> ref = per_pixel_filter( image, CountingFunc( &count ) );
+
+  // Interpolation reads a few pixels through a new accessor for each
+  // sample, which should not rasterize a whole tile each time.
+  BilinearInterpolation::Interpolator<ImageViewRef<float> >::type interp;
+  for( int k=0; k<20; ++k ) {
+    double x = (k*97) % (cols-1) + 0.5, y = (k*61) % (rows-1) + 0.25;
+    EXPECT_NEAR( x + 2*y + 1, interp( ref, x, y, 0 ), 1e-3 );
+  }
+  EXPECT_EQ( 20*4, count );
+
+  // A scan through one accessor rasterizes each pixel about once
+  count = 0;
+  ImageViewRef<float>::pixel_accessor row = ref.origin();
+  for( int r=0; r<rows; ++r, row.next_row() ) {
+    ImageViewRef<float>::pixel_accessor col = row;
+    for( int c=0; c<cols; ++c, col.next_col() )
+      EXPECT_EQ( image(c,r) + 1, *col );
+  }
+  EXPECT_LE( count, cols*rows * 17 / 16 );
+
+  // Accessors taken after a write to the source see the new pixels
+  fill( image, 5 );
+  ImageViewRef<float> copy = ref;
+  EXPECT_EQ( 6, *copy.origin() );
+  EXPECT_EQ( 6, copy(10,10) );
+  double sum = 0;
+  row = ref.origin();
+  for( int r=0; r<rows; ++r, row.next_row() ) {
+    ImageViewRef<float>::pixel_accessor col = row;
+    for( int c=0; c<cols; ++c, col.next_col() )
+      sum += *col;
+  }
+  EXPECT_EQ( 6.0*cols*rows, sum );
+}
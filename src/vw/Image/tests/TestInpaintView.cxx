@@ -18,6 +18,8 @@
 
 #include <test/Helpers.h>
 
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/Filter.h>
 #include <vw/Image/ImageViewRef.h>
 #include <vw/Image/InpaintView.h>
 
@@ -48,4 +50,119 @@ TEST(InpaintView, compile) {
   
 }
 
+// A ramp with holes, some of them straddling the tiles used below
+static ImageView<PixelMask<float> > ramp_with_holes() {
+  ImageView<PixelMask<float> > image( 97, 83 );
+  for ( int32 row = 0; row < image.rows(); ++row )
+    for ( int32 col = 0; col < image.cols(); ++col ) {
+      image( col, row ) = PixelMask<float>( 2.0f * col - 3.0f * row + 7.0f );
+      bool big   = col > 10 && col < 70 && row > 20 && row < 60 && ( col + row ) % 11 != 0;
+      bool small = col >= 80 && col < 84 && row >= 5 && row < 7;
+      bool edge  = col < 3 && row > 70;
+      if ( big || small || edge )
+        image( col, row ).invalidate();
+    }
+  return image;
+}
+
+TEST(InpaintView, DiffusionFill) {
+  ImageView<PixelMask<float> > image = ramp_with_holes();
+  BlobIndexThreaded bindex( invert_mask( image ), 0, 32 );
+
+  // The fill is the mean of its neighbors, which a ramp already is
+  ImageView<PixelMask<float> > filled = inpaint( image, bindex, true, PixelMask<float>() );
+  for ( int32 row = 0; row < image.rows(); ++row )
+    for ( int32 col = 0; col < image.cols(); ++col ) {
+      if ( col < 3 && row > 70 ) {
+        EXPECT_FALSE( is_valid( filled( col, row ) ) ); // Not a hole
+        continue;
+      }
+      ASSERT_TRUE( is_valid( filled( col, row ) ) ) << col << " " << row;
+      EXPECT_NEAR( 2.0f * col - 3.0f * row + 7.0f, filled( col, row ).child(), 0.02 );
+    }
+}
+
+TEST(InpaintView, TilesMatchWhole) {
+  ImageView<PixelMask<float> > image = ramp_with_holes();
+  for ( int32 row = 0; row < image.rows(); ++row )
+    for ( int32 col = 0; col < image.cols(); ++col )
+      if ( is_valid( image( col, row ) ) )
+        image( col, row ).child() += 10.0f * float( ( col * 7 + row * 13 ) % 5 );
+  BlobIndexThreaded bindex( invert_mask( image ), 0, 32 );
+
+  InpaintView<ImageView<PixelMask<float> > > view( image, bindex, true, PixelMask<float>() );
+  ImageView<PixelMask<float> > whole = view;
+
+  // Tiles only see their own pixels and the patches of the blobs they
+  // touch, solved ahead of time here
+  InpaintView<ImageView<PixelMask<float> > > tiled( image, bindex, true, PixelMask<float>() );
+  tiled.solve( 2 );
+  ImageView<PixelMask<float> > blocks = block_rasterize( tiled, Vector2i( 16, 16 ), 2 );
+  for ( int32 row = 0; row < image.rows(); ++row )
+    for ( int32 col = 0; col < image.cols(); ++col ) {
+      EXPECT_EQ( is_valid( whole( col, row ) ), is_valid( blocks( col, row ) ) );
+      EXPECT_EQ( whole( col, row ).child(), blocks( col, row ).child() );
+    }
+}
+
+TEST(InpaintView, ConstantFill) {
+  ImageView<PixelMask<uint8> > image( 8, 8 );
+  fill( image, PixelMask<uint8>( 10 ) );
+  image( 3, 3 ).invalidate();
+  image( 4, 3 ).invalidate();
+  BlobIndexThreaded bindex( invert_mask( image ), 0, 32 );
 
+  ImageView<PixelMask<uint8> > filled = inpaint( image, bindex, false, PixelMask<uint8>( 42 ) );
+  EXPECT_PIXEL_EQ( PixelMask<uint8>( 42 ), filled( 3, 3 ) );
+  EXPECT_PIXEL_EQ( PixelMask<uint8>( 42 ), filled( 4, 3 ) );
+  EXPECT_PIXEL_EQ( PixelMask<uint8>( 10 ), filled( 5, 3 ) );
+}
+
+TEST(InpaintView, EdgeBlobs) {
+  // Blobs whose one pixel border reaches the edge of the image, or its
+  // last row or column, are left alone
+  ImageView<PixelMask<uint8> > image( 8, 8 );
+  fill( image, PixelMask<uint8>( 10 ) );
+  image( 1, 3 ).invalidate();
+  image( 6, 3 ).invalidate();
+  image( 3, 6 ).invalidate();
+  image( 0, 5 ).invalidate();
+  BlobIndexThreaded bindex( invert_mask( image ), 0, 32 );
+  EXPECT_EQ( 4u, bindex.num_blobs() );
+
+  ImageView<PixelMask<uint8> > filled = inpaint( image, bindex, false, PixelMask<uint8>( 42 ) );
+  EXPECT_PIXEL_EQ( PixelMask<uint8>( 42 ), filled( 1, 3 ) );
+  EXPECT_FALSE( is_valid( filled( 6, 3 ) ) );
+  EXPECT_FALSE( is_valid( filled( 3, 6 ) ) );
+  EXPECT_FALSE( is_valid( filled( 0, 5 ) ) );
+}
+
+namespace {
+  // Throws when it reads a pixel of value 13
+  struct FailAtValue : ReturnFixedType<PixelMask<float> > {
+    PixelMask<float> operator()( PixelMask<float> const& px ) const {
+      if ( is_valid( px ) && px.child() == 13 )
+        vw_throw( IOErr() << "FailAtValue: bad pixel." );
+      return px;
+    }
+  };
+}
+
+TEST(InpaintView, SolveErrors) {
+  ImageView<PixelMask<float> > image( 12, 12 );
+  fill( image, PixelMask<float>( 10 ) );
+  image( 3, 3 ).invalidate();
+  image( 7, 7 ).invalidate();
+  image( 7, 8 ).invalidate();
+  image( 2, 3 ) = PixelMask<float>( 13 ); // On the border of a hole
+  BlobIndexThreaded bindex( invert_mask( image ), 0, 32 );
+
+  // The exception of a hole reaches the caller, with its type
+  typedef UnaryPerPixelView<ImageView<PixelMask<float> >, FailAtValue> failing_type;
+  InpaintView<failing_type> serial( per_pixel_filter( image, FailAtValue() ), bindex,
+                                    true, PixelMask<float>() );
+  EXPECT_THROW( serial.solve( 1 ), IOErr );
+  InpaintView<failing_type> threaded( per_pixel_filter( image, FailAtValue() ), bindex,
+                                      true, PixelMask<float>() );
+  EXPECT_THROW( threaded.solve( 4 ), IOErr );
+}
@@ -21,7 +21,12 @@
 
 #include <vw/Image/PerPixelViews.h>
 #include <vw/Image/ImageView.h>
+#include <vw/Image/ImageMath.h>
+#include <vw/Image/Algorithms.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelTypes.h>
 #include <vw/Core/Functors.h>
+#include <vw/Core/Stopwatch.h>
 
 using namespace vw;
 
@@ -323,3 +328,105 @@ TEST( PerPixelView, UnaryIndex ) {
   ASSERT_TRUE( bool_trait<IsImageView>(ppv) );
 }
 
+
+// Wide enough that rows are evaluated in several pieces
+template <class PixelT>
+static ImageView<PixelT> test_pattern( int32 cols, int32 rows, double phase ) {
+  typedef typename CompoundChannelType<PixelT>::type channel_type;
+  ImageView<PixelT> im( cols, rows );
+  for ( int32 j = 0; j < rows; ++j )
+    for ( int32 i = 0; i < cols; ++i )
+      for ( int32 c = 0; c < int32(CompoundNumChannels<PixelT>::value); ++c )
+        compound_select_channel<channel_type&>( im(i,j), c ) =
+          channel_type( 0.5 + 0.5 * sin( 0.01 * i + 0.3 * j + phase + c ) );
+  return im;
+}
+
+TEST( PerPixelView, FusedChain ) {
+  ImageView<float> a = test_pattern<float>( 600, 7, 0 ), b = test_pattern<float>( 600, 7, 1 ),
+                   c = test_pattern<float>( 600, 7, 2 );
+
+  // Row evaluated
+  ImageView<float> fused = clamp( a*b + c*0.5f, 0.2, 0.8 );
+  ImageView<uint8> cast = channel_cast<uint8>( threshold( a - b, 0.1 ) * 200 );
+  ImageView<float> part( 400, 3 );
+  clamp( a*b + c*0.5f, 0.2, 0.8 ).rasterize( part, BBox2i( 150, 2, 400, 3 ) );
+  ImageView<float> cropped( 600, 7 );
+  crop( cropped, 100, 0, 500, 7 ) = crop( a + b, 100, 0, 500, 7 );
+
+  // Through the pixel accessors
+  ImageView<float> generic( 600, 7 );
+  vw::rasterize( clamp( a*b + c*0.5f, 0.2, 0.8 ), generic, BBox2i( 0, 0, 600, 7 ) );
+  ImageView<uint8> generic_cast( 600, 7 );
+  vw::rasterize( channel_cast<uint8>( threshold( a - b, 0.1 ) * 200 ), generic_cast, BBox2i( 0, 0, 600, 7 ) );
+
+  for ( int32 j = 0; j < 7; ++j )
+    for ( int32 i = 0; i < 600; ++i ) {
+      ASSERT_EQ( generic(i,j), fused(i,j) ) << i << "," << j;
+      ASSERT_EQ( generic_cast(i,j), cast(i,j) ) << i << "," << j;
+      if ( i >= 150 && i < 550 && j >= 2 && j < 5 ) {
+        ASSERT_EQ( generic(i,j), part(i-150,j-2) );
+      }
+      if ( i >= 100 ) {
+        ASSERT_EQ( a(i,j) + b(i,j), cropped(i,j) );
+      }
+    }
+}
+
+TEST( PerPixelView, FusedChannels ) {
+  ImageView<PixelRGB<float> > a = test_pattern<PixelRGB<float> >( 300, 5, 0 );
+  ImageView<PixelRGB<float> > b = test_pattern<PixelRGB<float> >( 300, 5, 1 );
+
+  ImageView<PixelRGB<uint8> > fused = channel_cast_rescale<uint8>( clamp( a + b, 0.3, 1.5 ) / 1.5 );
+  ImageView<PixelRGB<float> > thresh = threshold( a, 0.5 );
+  ImageView<PixelRGB<int16> > cast = channel_cast<int16>( a * 1000 );
+
+  ImageView<PixelRGB<uint8> > generic( 300, 5 );
+  vw::rasterize( channel_cast_rescale<uint8>( clamp( a + b, 0.3, 1.5 ) / 1.5 ), generic, BBox2i( 0, 0, 300, 5 ) );
+  ImageView<PixelRGB<float> > generic_thresh( 300, 5 );
+  vw::rasterize( threshold( a, 0.5 ), generic_thresh, BBox2i( 0, 0, 300, 5 ) );
+  ImageView<PixelRGB<int16> > generic_cast( 300, 5 );
+  vw::rasterize( channel_cast<int16>( a * 1000 ), generic_cast, BBox2i( 0, 0, 300, 5 ) );
+
+  for ( int32 j = 0; j < 5; ++j )
+    for ( int32 i = 0; i < 300; ++i ) {
+      ASSERT_EQ( generic(i,j), fused(i,j) ) << i << "," << j;
+      ASSERT_EQ( generic_thresh(i,j), thresh(i,j) ) << i << "," << j;
+      ASSERT_EQ( generic_cast(i,j), cast(i,j) ) << i << "," << j;
+    }
+}
+
+// Run with --gtest_also_run_disabled_tests to compare row evaluation
+// of per-pixel chains against rasterizing through the pixel accessors.
+TEST( PerPixelView, DISABLED_FusedBenchmark ) {
+  const int32 size = 2048, repeat = 10;
+  ImageView<float> a = test_pattern<float>( size, size, 0 ), b = test_pattern<float>( size, size, 1 ),
+                   c = test_pattern<float>( size, size, 2 ), result( size, size );
+  ImageView<PixelRGB<float> > rgb = test_pattern<PixelRGB<float> >( size, size, 0 );
+  ImageView<PixelRGB<uint8> > rgb_result( size, size );
+  const BBox2i bbox( 0, 0, size, size );
+
+  Stopwatch generic, fused;
+  generic.start();
+  for ( int32 r = 0; r < repeat; ++r )
+    vw::rasterize( clamp( a*b + c*0.5f, 0.2, 0.8 ), result, bbox );
+  generic.stop();
+  fused.start();
+  for ( int32 r = 0; r < repeat; ++r )
+    clamp( a*b + c*0.5f, 0.2, 0.8 ).rasterize( result, bbox );
+  fused.stop();
+  std::cout << "clamp(a*b+c*0.5): accessors " << generic.elapsed_seconds() / repeat
+            << " s, rows " << fused.elapsed_seconds() / repeat << " s\n";
+
+  Stopwatch generic_rgb, fused_rgb;
+  generic_rgb.start();
+  for ( int32 r = 0; r < repeat; ++r )
+    vw::rasterize( channel_cast<uint8>( threshold( rgb, 0.5, 255 ) ), rgb_result, bbox );
+  generic_rgb.stop();
+  fused_rgb.start();
+  for ( int32 r = 0; r < repeat; ++r )
+    channel_cast<uint8>( threshold( rgb, 0.5, 255 ) ).rasterize( rgb_result, bbox );
+  fused_rgb.stop();
+  std::cout << "channel_cast<uint8>(threshold(rgb)): accessors " << generic_rgb.elapsed_seconds() / repeat
+            << " s, rows " << fused_rgb.elapsed_seconds() / repeat << " s\n";
+}
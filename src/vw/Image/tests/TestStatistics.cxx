@@ -23,6 +23,7 @@
 #include <vw/Image/PixelTypes.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Manipulation.h>
+#include <vw/Image/Filter.h>
 
 #include <test/Helpers.h>
 
@@ -562,3 +563,94 @@ TEST(BlockOperations, DISABLED_CDF) {
   EXPECT_NEAR(normal_cdf.quantile(0.02),       parallel_cdf.quantile(0.02), EPS);
   EXPECT_NEAR(normal_cdf.quantile(0.98),       parallel_cdf.quantile(0.98), EPS);
 }
+
+TEST( Statistics, ReduceBlocks ) {
+  // Blocks that don't divide the image, with some masked pixels
+  ImageView<PixelMask<float> > image(300, 170);
+  for ( int row = 0; row < image.rows(); row++ )
+    for ( int col = 0; col < image.cols(); col++ ) {
+      image(col,row) = float( (col * 7 + row * 13) % 101 ) / 4 - 3;
+      if ( (col + row) % 17 == 0 )
+        image(col,row).invalidate();
+    }
+
+  ChannelAccumulator<MeanAccumulator<float> > serial, blocked, threaded;
+  for_each_pixel( image, serial );
+  reduce_blocks( image, blocked, Vector2i(64,48), 1 );
+  reduce_blocks( image, threaded, Vector2i(64,48), 4 );
+  EXPECT_NEAR( serial.value(), blocked.value(), 1e-9 );
+  // Partials are merged in block order, so threads don't change the result
+  EXPECT_EQ( blocked.value(), threaded.value() );
+
+  // One thread is the default, and visits the pixels in order
+  EXPECT_EQ( serial.value(), mean_channel_value(image) );
+  EXPECT_EQ( blocked.value(), mean_channel_value(image, 4) );
+  EXPECT_NEAR( stddev_channel_value(image), stddev_channel_value(image, 4), 1e-9 );
+  EXPECT_EQ( sum_of_channel_values(image), sum_of_channel_values(image, 4) );
+
+  EXPECT_EQ( min_channel_value(image), -3 );
+  EXPECT_EQ( max_channel_value(image), 22 );
+  EXPECT_EQ( min_channel_value(image, 4), -3 );
+  EXPECT_EQ( max_channel_value(image, 4), 22 );
+  EXPECT_EQ( median_channel_value(image), median_channel_value(image, 4) );
+
+  double min_val, max_val;
+  find_image_min_max( image, min_val, max_val, 4 );
+  EXPECT_EQ( -3, min_val );
+  EXPECT_EQ( 22, max_val );
+
+  math::Histogram hist, threaded_hist, expected, threaded_expected;
+  histogram( image, 50, hist );
+  histogram( image, 50, threaded_hist, 4 );
+  histogram( image, 50, -3, 22, expected );
+  histogram( image, 50, -3, 22, threaded_expected, 4 );
+  EXPECT_EQ( expected.get_total_num_values(), hist.get_total_num_values() );
+  EXPECT_EQ( expected.get_total_num_values(), threaded_hist.get_total_num_values() );
+  for ( int i = 0; i < 50; i++ ) {
+    EXPECT_EQ( expected.get_bin_value(i), hist.get_bin_value(i) );
+    EXPECT_EQ( expected.get_bin_value(i), threaded_hist.get_bin_value(i) );
+    EXPECT_EQ( expected.get_bin_value(i), threaded_expected.get_bin_value(i) );
+  }
+
+  ImageView<PixelRGB<float> > rgb(300, 170);
+  for ( int row = 0; row < rgb.rows(); row++ )
+    for ( int col = 0; col < rgb.cols(); col++ )
+      rgb(col,row) = PixelRGB<float>( col, row, (col * 7 + row * 13) % 101 );
+  EXPECT_PIXEL_EQ( median_pixel_value(rgb), median_pixel_value(rgb, 4) );
+  EXPECT_PIXEL_EQ( min_pixel_value(rgb), min_pixel_value(rgb, 4) );
+  EXPECT_PIXEL_EQ( max_pixel_value(rgb), max_pixel_value(rgb, 4) );
+  EXPECT_PIXEL_NEAR( mean_pixel_value(rgb), mean_pixel_value(rgb, 4), 1e-9 );
+  // Float sums of squares round differently when added block by block
+  EXPECT_PIXEL_NEAR( stddev_pixel_value(rgb), stddev_pixel_value(rgb, 4), 1e-2 );
+}
+
+namespace {
+  // Fails on pixels past a column, as a bad read would
+  struct FailPastColumn : ReturnFixedType<float> {
+    float operator()( float value ) const {
+      if ( value >= 250 )
+        vw_throw( IOErr() << "FailPastColumn: bad pixel." );
+      return value;
+    }
+  };
+}
+
+TEST( Statistics, ReduceBlocksErrors ) {
+  ImageView<float> image(300, 170);
+  for ( int row = 0; row < image.rows(); row++ )
+    for ( int col = 0; col < image.cols(); col++ )
+      image(col,row) = float( col );
+
+  // The exception of a block reaches the caller, with its type
+  MeanAccumulator<float> serial, threaded;
+  EXPECT_THROW( reduce_blocks( per_pixel_filter( image, FailPastColumn() ), serial,
+                               Vector2i(64,48), 1 ), IOErr );
+  EXPECT_THROW( reduce_blocks( per_pixel_filter( image, FailPastColumn() ), threaded,
+                               Vector2i(64,48), 4 ), IOErr );
+
+  // A single block, with more threads than blocks
+  MeanAccumulator<float> whole, single;
+  for_each_pixel( crop( image, 0, 0, 40, 30 ), whole );
+  reduce_blocks( crop( image, 0, 0, 40, 30 ), single, Vector2i(64,48), 8 );
+  EXPECT_EQ( whole.value(), single.value() );
+}
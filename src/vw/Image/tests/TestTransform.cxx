@@ -202,3 +202,264 @@ TEST( Transform, FreeForward ) {
                         tx.forward(tx.reverse(Vector2(i*i,i))), 1e-3 );
   }
 }
+
+// Rasterization must give the same pixels as per-pixel access.
+template <class ViewT>
+static void expect_rasterize_matches( ViewT const& view, BBox2i const& bbox ) {
+  typedef typename ViewT::pixel_type PixelT;
+  ImageView<PixelT> result( bbox.width(), bbox.height(), view.planes() );
+  view.rasterize( result, bbox );
+  for ( int32 p = 0; p < view.planes(); ++p )
+    for ( int32 j = 0; j < bbox.height(); ++j )
+      for ( int32 i = 0; i < bbox.width(); ++i )
+        EXPECT_EQ( view( bbox.min().x()+i, bbox.min().y()+j, p ), result(i,j,p) );
+}
+
+static ImageView<float> transform_test_image() {
+  ImageView<float> im(23,17,2);
+  for ( int32 p = 0; p < im.planes(); ++p )
+    for ( int32 j = 0; j < im.rows(); ++j )
+      for ( int32 i = 0; i < im.cols(); ++i )
+        im(i,j,p) = float( sin(0.3*i+p) * cos(0.2*j) * 100 + i*j );
+  return im;
+}
+
+TEST( Transform, RasterizeRows ) {
+  ImageView<float> im = transform_test_image();
+  RotateTransform tx( 0.3, Vector2(11,8) );
+  BBox2i full(0,0,30,25), part(-3,4,20,9);
+
+  expect_rasterize_matches( transform(im, tx, 30, 25, ZeroEdgeExtension(), BilinearInterpolation()), full );
+  expect_rasterize_matches( transform(im, tx, 30, 25, ConstantEdgeExtension(), BicubicInterpolation()), full );
+  expect_rasterize_matches( transform(im, tx, 30, 25, ReflectEdgeExtension(), NearestPixelInterpolation()), part );
+  expect_rasterize_matches( transform(im, tx, 30, 25, ConstantEdgeExtension(), BilinearInterpolation()), part );
+  expect_rasterize_matches( transform_nodata(im, tx, 30, 25, ZeroEdgeExtension(),
+                                             BicubicInterpolation(), -1.0f), full );
+
+  ImageView<PixelRGB<uint8> > rgb(16,16);
+  for ( int32 j = 0; j < rgb.rows(); ++j )
+    for ( int32 i = 0; i < rgb.cols(); ++i )
+      rgb(i,j) = PixelRGB<uint8>( i*16, j*16, (i*j) % 256 );
+  expect_rasterize_matches( transform(rgb, tx, 20, 20, ConstantEdgeExtension(), BicubicInterpolation()),
+                            BBox2i(0,0,20,20) );
+}
+
+TEST( Transform, ApproximateRows ) {
+  RotateTransform tx( 0.3, Vector2(11,8) );
+  tx.set_tolerance( 0.01 );
+  BBox2i bbox(0,0,64,48);
+  ApproximateTransform<RotateTransform> approx( tx, bbox );
+
+  std::vector<Vector2> row( bbox.width() );
+  for ( int32 j = bbox.min().y(); j < bbox.max().y(); ++j ) {
+    approx.reverse_row( j, bbox.min().x(), bbox.width(), &row[0] );
+    for ( int32 i = 0; i < bbox.width(); ++i ) {
+      Vector2 expected = approx.reverse( Vector2(bbox.min().x()+i, j) );
+      EXPECT_EQ( expected[0], row[i][0] );
+      EXPECT_EQ( expected[1], row[i][1] );
+      EXPECT_VECTOR_NEAR( tx.reverse( Vector2(bbox.min().x()+i, j) ), row[i], 0.01 );
+    }
+  }
+
+  // A rasterized approximated view stays within the tolerance
+  ImageView<float> im = transform_test_image();
+  ImageView<float> exact = transform( im, RotateTransform( 0.3, Vector2(11,8) ),
+                                      ConstantEdgeExtension(), BilinearInterpolation() );
+  ImageView<float> approximated = transform( im, tx, ConstantEdgeExtension(), BilinearInterpolation() );
+  for ( int32 p = 0; p < im.planes(); ++p )
+    for ( int32 j = 0; j < im.rows(); ++j )
+      for ( int32 i = 0; i < im.cols(); ++i )
+        EXPECT_NEAR( exact(i,j,p), approximated(i,j,p), 2.0 );
+}
+
+namespace row_test {
+  // Undefined left of x=0, so no approximation table covers that side.
+  // Rows of exact points are counted.
+  class RowTransform : public TransformBase<RowTransform> {
+  public:
+    int32* rows;
+    RowTransform( int32* rows ) : rows(rows) {}
+    inline Vector2 reverse( const Vector2& p ) const {
+      if ( p.x() < 0 )
+        return Vector2( std::numeric_limits<double>::quiet_NaN(), 0 );
+      return Vector2( 0.9*p.x() + 1, 1.1*p.y() - 2 );
+    }
+  };
+
+  void exact_reverse_row( RowTransform const& tx, double y, double x0, int32 n, Vector2* out ) {
+    ++*tx.rows;
+    for ( int32 k = 0; k < n; ++k )
+      out[k] = tx.reverse( Vector2(x0+k, y) );
+  }
+}
+
+TEST( Transform, ExactReverseRow ) {
+  ImageView<float> im = transform_test_image();
+  int32 rows = 0;
+  row_test::RowTransform tx( &rows );
+  ImageView<float> result = transform( im, tx, 20, 15, ConstantEdgeExtension(), BilinearInterpolation() );
+  EXPECT_EQ( 15, rows );
+  expect_rasterize_matches( transform( im, tx, 20, 15, ConstantEdgeExtension(), BilinearInterpolation() ),
+                            BBox2i(0,0,20,15) );
+
+  // The approximation falls back to whole exact rows too
+  rows = 0;
+  BBox2i bbox(-5,0,20,10);
+  ApproximateTransform<row_test::RowTransform> approx( tx, bbox );
+  std::vector<Vector2> row( bbox.width() );
+  approx.reverse_row( 3, bbox.min().x(), bbox.width(), &row[0] );
+  EXPECT_EQ( 1, rows );
+  for ( int32 i = 5; i < bbox.width(); ++i )
+    EXPECT_VECTOR_NEAR( tx.reverse( Vector2(bbox.min().x()+i, 3) ), row[i], 1e-12 );
+}
+
+TEST( Transform, ApproximationGrid ) {
+  HomographyTransform tx( Matrix3x3( 1.02, 0.1, -20, -0.08, 0.97, 30, 1e-4, 2e-4, 1 ) );
+  tx.set_tolerance( 0.05 );
+  Cache cache( 1 << 24 );
+  boost::shared_ptr<ApproximationGrid<HomographyTransform> > grid
+    ( new ApproximationGrid<HomographyTransform>( tx, BBox2i(-10,5,100,70), 64, 16, cache ) );
+
+  BBox2i bbox(-10,5,100,70);
+  ApproximateTransform<HomographyTransform> approx( grid, bbox );
+  uint64 calls = grid->stats().exact_calls();
+  EXPECT_GT( calls, 0u );
+
+  std::vector<Vector2> row( bbox.width() );
+  for ( int32 j = bbox.min().y(); j < bbox.max().y(); ++j ) {
+    approx.reverse_row( j, bbox.min().x(), bbox.width(), &row[0] );
+    for ( int32 i = 0; i < bbox.width(); ++i ) {
+      Vector2 p( bbox.min().x()+i, j );
+      Vector2 expected = approx.reverse( p );
+      EXPECT_EQ( expected[0], row[i][0] );
+      EXPECT_EQ( expected[1], row[i][1] );
+      EXPECT_VECTOR_NEAR( tx.reverse( p ), row[i], 0.2 );
+    }
+  }
+
+  // A tile over the same cells reuses their tables
+  ApproximateTransform<HomographyTransform> approx2( grid, BBox2i(0,32,64,32) );
+  EXPECT_EQ( calls, grid->stats().exact_calls() );
+  EXPECT_VECTOR_NEAR( approx.reverse( Vector2(10,40) ), approx2.reverse( Vector2(10,40) ), 1e-12 );
+}
+
+TEST( Transform, ApproximationGridDomainEdge ) {
+  HomographyTransform tx( Matrix3x3( 1.02, 0.1, -20, -0.08, 0.97, 30, 1e-3, 2e-3, 1 ) );
+  tx.set_tolerance( 0.05 );
+  Cache cache( 1 << 24 );
+  BBox2i domain(-10,5,100,70);
+  boost::shared_ptr<ApproximationGrid<HomographyTransform> > grid
+    ( new ApproximationGrid<HomographyTransform>( tx, domain, 64, 16, cache ) );
+
+  // The leaves at the domain edge are cut short of their squares.
+  // Points past them, and around the leaf boundaries, are not
+  // extrapolated from the nearest table.
+  BBox2i bbox(-40,-20,170,130);
+  ApproximateTransform<HomographyTransform> approx( grid, bbox );
+  for ( double y = bbox.min().y(); y < bbox.max().y(); y += 0.25 )
+    for ( double x = bbox.min().x(); x < bbox.max().x(); x += 0.25 ) {
+      bool edge = std::abs( x - domain.min().x() ) < 2 || std::abs( x - domain.max().x() ) < 2 ||
+                  std::abs( y - domain.min().y() ) < 2 || std::abs( y - domain.max().y() ) < 2 ||
+                  std::abs( x - 16*std::floor( x/16 + 0.5 ) ) < 1 ||
+                  std::abs( y - 16*std::floor( y/16 + 0.5 ) ) < 1;
+      if ( !edge )
+        continue;
+      Vector2 p( x, y );
+      EXPECT_VECTOR_NEAR( tx.reverse( p ), approx.reverse( p ), 0.05 );
+      if ( x < domain.min().x() || x > domain.max().x() ||
+           y < domain.min().y() || y > domain.max().y() ) {
+        EXPECT_VECTOR_NEAR( tx.reverse( p ), approx.reverse( p ), 1e-12 );
+      }
+    }
+
+  std::vector<Vector2> row( bbox.width() );
+  for ( int32 j = bbox.min().y(); j < bbox.max().y(); ++j ) {
+    approx.reverse_row( j, bbox.min().x(), bbox.width(), &row[0] );
+    for ( int32 i = 0; i < bbox.width(); ++i ) {
+      Vector2 expected = approx.reverse( Vector2(bbox.min().x()+i, j) );
+      EXPECT_EQ( expected[0], row[i][0] );
+      EXPECT_EQ( expected[1], row[i][1] );
+    }
+  }
+}
+
+namespace grid_test {
+  // Undefined in a corner. The points it is called at are recorded.
+  class CornerTransform : public TransformBase<CornerTransform> {
+  public:
+    BBox2* called;
+    CornerTransform( BBox2* called ) : called(called) {}
+    inline Vector2 reverse( const Vector2& p ) const {
+      called->grow( p );
+      if ( p.x() < 8 && p.y() < 8 )
+        return Vector2( std::numeric_limits<double>::quiet_NaN(), 0 );
+      return Vector2( 0.9*p.x() + 1e-3*p.y()*p.y(), 1.1*p.y() - 2 );
+    }
+  };
+}
+
+TEST( Transform, ApproximationGridFailedCells ) {
+  BBox2 called;
+  grid_test::CornerTransform tx( &called );
+  tx.set_tolerance( 0.05 );
+  Cache cache( 1 << 24 );
+  BBox2i domain(0,0,100,70);
+  boost::shared_ptr<ApproximationGrid<grid_test::CornerTransform> > grid
+    ( new ApproximationGrid<grid_test::CornerTransform>( tx, domain, 64, 16, cache ) );
+  ApproximateTransform<grid_test::CornerTransform> approx( grid, domain );
+
+  // Only the leaf where the transform fails is left without a table
+  boost::shared_ptr<transform_p::ApproximationCell> cell = grid->cell( 0, 0 );
+  EXPECT_FALSE( cell->leaf( 0, 0 ).table.is_valid_image() );
+  EXPECT_TRUE ( cell->leaf( 20, 0 ).table.is_valid_image() );
+  EXPECT_TRUE ( cell->leaf( 0, 20 ).table.is_valid_image() );
+
+  // The tables stop at the edge of the domain
+  EXPECT_GE( called.min().x(), 0 );
+  EXPECT_GE( called.min().y(), 0 );
+  EXPECT_LE( called.max().x(), 100 );
+  EXPECT_LE( called.max().y(), 70 );
+
+  for ( int32 j = domain.min().y(); j < domain.max().y(); ++j )
+    for ( int32 i = domain.min().x(); i < domain.max().x(); ++i ) {
+      if ( i < 8 && j < 8 )
+        continue;
+      Vector2 p( i, j );
+      EXPECT_VECTOR_NEAR( tx.reverse( p ), approx.reverse( p ), 0.05 );
+    }
+}
+
+TEST( Transform, ApproximationGridView ) {
+  ImageView<float> im = transform_test_image();
+  HomographyTransform tx( Matrix3x3( 1.02, 0.1, -2, -0.08, 0.97, 3, 1e-4, 2e-4, 1 ) );
+  ImageView<float> exact = transform( im, tx, ConstantEdgeExtension(), BilinearInterpolation() );
+  tx.set_tolerance( 0.01 );
+  TransformView<InterpolationView<EdgeExtensionView<ImageView<float>, ConstantEdgeExtension>, BilinearInterpolation>,
+                HomographyTransform> view = transform( im, tx, ConstantEdgeExtension(), BilinearInterpolation() );
+  // The grid is made when the view is first rasterized
+  EXPECT_TRUE( view.approximation_grid().get() == 0 );
+
+  ImageView<float> approximated( view.cols(), view.rows(), view.planes() );
+  for ( int32 j = 0; j < view.rows(); j += 8 )
+    for ( int32 i = 0; i < view.cols(); i += 8 ) {
+      BBox2i tile = BBox2i(i,j,8,8);
+      tile.crop( bounding_box(view) );
+      view.rasterize( crop(approximated, tile), tile );
+    }
+  ASSERT_TRUE( view.approximation_grid().get() != 0 );
+  ApproximationStats const& stats = view.approximation_grid()->stats();
+  EXPECT_EQ( uint64(im.cols()*im.rows()), stats.pixels() );
+  uint64 calls = stats.exact_calls();
+
+  // Rasterizing again finds the tables in the cache
+  ImageView<float> again = view;
+  EXPECT_EQ( calls, stats.exact_calls() );
+  EXPECT_GT( stats.pixels(), uint64(im.cols()*im.rows()) );
+
+  for ( int32 p = 0; p < im.planes(); ++p )
+    for ( int32 j = 0; j < im.rows(); ++j )
+      for ( int32 i = 0; i < im.cols(); ++i ) {
+        EXPECT_NEAR( exact(i,j,p), approximated(i,j,p), 1.0 );
+        EXPECT_EQ( approximated(i,j,p), again(i,j,p) );
+      }
+}
@@ -0,0 +1,160 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+#include <vw/Math/BatchFunctions.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+  // The values are processed in blocks of this size, copied to local
+  // arrays.  The compiler then knows that the arrays do not overlap and
+  // how long the loops are, so it can vectorize them without run-time
+  // checks.  The last block is padded with zeros.
+  const size_t BLOCK = 256;
+
+  // Adding and subtracting this rounds a double of magnitude below 2^51
+  // to the nearest integer.
+  const double ROUND_MAGIC = 6755399441055744.0; // 1.5 * 2^52
+
+  const double SINCOS_MAX_ARG = 1e5;
+
+  // Pi/2 in three parts, the first two with enough trailing zeros that
+  // their products with the quadrant number are exact (fdlibm).
+  const double PIO2_1 = 1.57079632673412561417e+00;
+  const double PIO2_2 = 6.07710050630396597660e-11;
+  const double PIO2_3 = 2.02226624871116645580e-21;
+  const double TWO_OVER_PI = 6.36619772367581382433e-01;
+
+  // sin and cos on [-pi/4, pi/4] (fdlibm __kernel_sin and __kernel_cos)
+  const double S1 = -1.66666666666666324348e-01;
+  const double S2 =  8.33333333332248946124e-03;
+  const double S3 = -1.98412698298579493134e-04;
+  const double S4 =  2.75573137070700676789e-06;
+  const double S5 = -2.50507602534068634195e-08;
+  const double S6 =  1.58969099521155010221e-10;
+
+  const double C1 =  4.16666666666666019037e-02;
+  const double C2 = -1.38888888888741095749e-03;
+  const double C3 =  2.48015872894767294178e-05;
+  const double C4 = -2.75573143513906633035e-07;
+  const double C5 =  2.08757232129817482790e-09;
+  const double C6 = -1.13596475577881948265e-11;
+
+  // atan on [-0.66, 0.66] as x + x^3 P(x^2)/Q(x^2) (Cephes).  Only
+  // [0, tan(pi/8)] is used.
+  const double P0 = -8.750608600031904122785e-01;
+  const double P1 = -1.615753718733365076637e+01;
+  const double P2 = -7.500855792314704667340e+01;
+  const double P3 = -1.228866684490136173410e+02;
+  const double P4 = -6.485021904942025371773e+01;
+  const double Q0 =  2.485846490142306297962e+01;
+  const double Q1 =  1.650270098316988542046e+02;
+  const double Q2 =  4.328810604912902668951e+02;
+  const double Q3 =  4.853903996359136964868e+02;
+  const double Q4 =  1.945506571482613964425e+02;
+
+  // Pi/4 and its rounding error
+  const double PIO4    = 7.85398163397448278999e-01;
+  const double PIO4_LO = 3.06161699786838301793e-17;
+
+  void sincos_block( double const* x, double* s, double* c ) {
+    for (size_t i = 0; i < BLOCK; i++) {
+      // Reduce to r in [-pi/4, pi/4], with x = r + k pi/2
+      double k = (x[i] * TWO_OVER_PI + ROUND_MAGIC) - ROUND_MAGIC;
+      double r = ((x[i] - k * PIO2_1) - k * PIO2_2) - k * PIO2_3;
+      // The quadrant, k mod 4. Rounding k/4 - 3/8 gives floor(k/4)
+      // without a call to floor().
+      double q = k - 4 * ((k * 0.25 - 0.375 + ROUND_MAGIC) - ROUND_MAGIC);
+
+      double z  = r * r;
+      double sr = r + r * z * (S1 + z * (S2 + z * (S3 + z * (S4 + z * (S5 + z * S6)))));
+      double cr = 1.0 - 0.5 * z + z * z * (C1 + z * (C2 + z * (C3 + z * (C4 + z * (C5 + z * C6)))));
+
+      bool odd = (q == 1 || q == 3);
+      double sv = odd ? cr : sr;
+      double cv = odd ? sr : cr;
+      s[i] = (q >= 2)           ? -sv : sv;
+      c[i] = (q == 1 || q == 2) ? -cv : cv;
+    }
+  }
+
+  void atan2_block( double const* y, double const* x, double* result ) {
+    for (size_t i = 0; i < BLOCK; i++) {
+      double ax = std::fabs(x[i]), ay = std::fabs(y[i]);
+      double num = std::min(ax, ay), den = std::max(ax, ay);
+      // atan(t) with t in [0,1] is twice the atan of t/(1+sqrt(1+t^2)),
+      // which is at most tan(pi/8).  The ratio of two subnormals is
+      // still correctly rounded, so only two zeros need a stand-in
+      // denominator.
+      double t = num / (den > 0 ? den : 1.0);
+      double u = t / (1 + std::sqrt(1 + t * t));
+      double z = u * u;
+      double p = (((P0 * z + P1) * z + P2) * z + P3) * z + P4;
+      double q = ((((z + Q0) * z + Q1) * z + Q2) * z + Q3) * z + Q4;
+      double a = 2 * (u + u * z * p / q);
+      // Undo the swap of the arguments, then the reflection in x.  Each
+      // time the two candidates are ordered, and picking the smaller
+      // or larger one is a select the compiler does not turn into a
+      // branch.  A negative zero x counts as negative, as in std::atan2.
+      double b = ((PIO4 - a) + PIO4_LO) + PIO4;
+      a = (ay > ax) ? std::max(a, b) : std::min(a, b);
+      b = ((2 * PIO4 - a) + 2 * PIO4_LO) + 2 * PIO4;
+      a = (std::copysign(1.0, x[i]) < 0) ? std::max(a, b) : std::min(a, b);
+      result[i] = std::copysign(a, y[i]);
+    }
+  }
+
+} // namespace
+
+void vw::math::batch_sincos( double const* x, double* s, double* c, size_t n ) {
+  double xb[BLOCK], sb[BLOCK], cb[BLOCK];
+  for (size_t start = 0; start < n; start += BLOCK) {
+    size_t count = std::min(BLOCK, n - start);
+    std::copy(x + start, x + start + count, xb);
+    std::fill(xb + count, xb + BLOCK, 0.0);
+    sincos_block(xb, sb, cb);
+    for (size_t i = 0; i < count; i++) {
+      if (!(std::fabs(xb[i]) <= SINCOS_MAX_ARG)) {
+        sb[i] = std::sin(xb[i]);
+        cb[i] = std::cos(xb[i]);
+      }
+    }
+    std::copy(sb, sb + count, s + start);
+    std::copy(cb, cb + count, c + start);
+  }
+}
+
+void vw::math::batch_atan2( double const* y, double const* x, double* result, size_t n ) {
+  double yb[BLOCK], xb[BLOCK], rb[BLOCK];
+  for (size_t start = 0; start < n; start += BLOCK) {
+    size_t count = std::min(BLOCK, n - start);
+    std::copy(y + start, y + start + count, yb);
+    std::copy(x + start, x + start + count, xb);
+    std::fill(yb + count, yb + BLOCK, 0.0);
+    std::fill(xb + count, xb + BLOCK, 1.0);
+    atan2_block(yb, xb, rb);
+    for (size_t i = 0; i < count; i++) {
+      if (!(std::fabs(xb[i]) <= std::numeric_limits<double>::max() &&
+            std::fabs(yb[i]) <= std::numeric_limits<double>::max()))
+        rb[i] = std::atan2(yb[i], xb[i]);
+    }
+    std::copy(rb, rb + count, result + start);
+  }
+}
@@ -0,0 +1,52 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file Math/BatchFunctions.h
+///
+/// Trigonometric functions over arrays of values.
+///
+/// These evaluate the same polynomial approximations as the usual
+/// libm implementations, but as straight-line code with no branches on
+/// the data, so that the compiler can vectorize the loops over the
+/// arrays.  Over the ranges below they agree with std::sin, std::cos
+/// and std::atan2 to within a few units in the last place (a relative
+/// error of at most 1e-15).  Values outside those ranges, including
+/// infinities and NaNs, are handed to the standard functions, so every
+/// input gets a correct result.
+///
+#ifndef __VW_MATH_BATCHFUNCTIONS_H__
+#define __VW_MATH_BATCHFUNCTIONS_H__
+
+#include <cstddef>
+
+namespace vw {
+namespace math {
+
+  /// Sets s[i] and c[i] to the sine and cosine of x[i], in radians, for
+  /// n values.  The fast path covers |x| <= 1e5.  The outputs may be
+  /// the same array as the input, but not the same as each other.
+  void batch_sincos( double const* x, double* s, double* c, size_t n );
+
+  /// Sets result[i] to atan2(y[i], x[i]) for n values.  The fast path
+  /// covers all finite inputs.  The output may be the same array as
+  /// either input.
+  void batch_atan2( double const* y, double const* x, double* result, size_t n );
+
+}} // namespace vw::math
+
+#endif // __VW_MATH_BATCHFUNCTIONS_H__
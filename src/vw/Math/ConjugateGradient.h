@@ -69,6 +69,10 @@
 /// which may be buggy and certainly is underperforming Armijo
 /// for me at the moment.  I also provide a steepest_descent()
 /// method for comparison to conjugate_gradient().
+///
+/// For linear systems with a symmetric positive definite matrix
+/// there is also preconditioned_conjugate_gradient(), which works
+/// with any matrix type that can be multiplied by a vector.
 
 #ifndef __VW_MATH_CONJUGATEGRADIENT_H__
 #define __VW_MATH_CONJUGATEGRADIENT_H__
@@ -240,6 +244,59 @@ namespace math{
     return pos;
   }
 
+
+  /// The identity preconditioner, for running
+  /// preconditioned_conjugate_gradient() without one.
+  struct IdentityPreconditioner {
+    template <class VectorT>
+    VectorT operator()( VectorT const& r ) const { return r; }
+  };
+
+  /// Solves the linear system A*x = b for a symmetric positive
+  /// definite A with the preconditioned conjugate gradient method.
+  /// Unlike the functions above this one has a real stopping rule: it
+  /// returns once the residual norm drops below tolerance*|b| or after
+  /// max_iterations steps.
+  /// * A only has to support A*x returning something assignable to VectorT.
+  /// * precondition(r) returns M^-1 r for a symmetric positive definite
+  ///   approximation M of A.
+  /// * x is the initial guess.
+  /// The number of iterations used is stored in *iterations if it is
+  /// not null.
+  template <class MatrixT, class VectorT, class PreconditionerT>
+  VectorT preconditioned_conjugate_gradient( MatrixT const& A,
+                                             VectorT const& b,
+                                             VectorT x,
+                                             PreconditionerT const& precondition,
+                                             int max_iterations,
+                                             double tolerance,
+                                             int* iterations = 0 ) {
+    VectorT r = b - A * x;
+    VectorT z = precondition( r );
+    VectorT p = z;
+    double rz = dot_prod( r, z );
+    double threshold = tolerance * norm_2( b );
+    int i = 0;
+    for ( ; i < max_iterations && norm_2( r ) > threshold; ++i ) {
+      VectorT q = A * p;
+      double pq = dot_prod( p, q );
+      if ( !( pq > 0 ) )
+        break; // A is not positive definite along p
+      double alpha = rz / pq;
+      x += alpha * p;
+      r -= alpha * q;
+      z = precondition( r );
+      double rz_next = dot_prod( r, z );
+      p = z + ( rz_next / rz ) * p;
+      rz = rz_next;
+    }
+    VW_OUT(DebugMessage, "math") << "PCG: " << i << " iterations, residual "
+                                 << norm_2( r ) << std::endl;
+    if ( iterations )
+      *iterations = i;
+    return x;
+  }
+
 } } // namespace vw::math
 
 #endif // #ifndef __VW_MATH_CONJUGATEGRADIENT_H__
@@ -345,6 +345,12 @@ namespace vw {
         return m_accum;
       }
 
+      /// Folds in the result of another accumulator. This is only
+      /// meaningful for associative functors such as the default sum.
+      void merge( Accumulator const& other ) {
+        m_func(m_accum, other.m_accum);
+      }
+
       void reset( AccumT const& accum = AccumT() ) {
         m_accum = accum;
       }
@@ -386,6 +392,15 @@ namespace vw {
         VW_ASSERT(m_valid, ArgumentErr() << "MinMaxAccumulator: no valid samples");
         return std::make_pair(m_minval,m_maxval);
       }
+
+      bool is_valid() const { return m_valid; }
+
+      void merge( MinMaxAccumulator const& other ) {
+        if ( !other.m_valid )
+          return;
+        (*this)( other.m_minval );
+        (*this)( other.m_maxval );
+      }
     };
 
     // Note: This function modifies the input!
@@ -416,6 +431,10 @@ namespace vw {
       ValT value() {
         return destructive_median(m_values);
       }
+
+      void merge( MedianAccumulator const& other ) {
+        m_values.insert( m_values.end(), other.m_values.begin(), other.m_values.end() );
+      }
     };
 
     // Compute the normalized median absolute deviation:
@@ -484,6 +503,11 @@ namespace vw {
         VW_ASSERT(m_count, ArgumentErr() << "MeanAccumulator: no valid samples");
         return m_accum / m_count;
       }
+
+      void merge( MeanAccumulator const& other ) {
+        m_accum += other.m_accum;
+        m_count += other.m_count;
+      }
     };
 
 
@@ -515,6 +539,12 @@ namespace vw {
         VW_ASSERT(num_samples, ArgumentErr() << "StdDevAccumulator(): no valid samples.");
         return mom1_accum / num_samples;
       }
+
+      void merge( StdDevAccumulator const& other ) {
+        mom1_accum  += other.mom1_accum;
+        mom2_accum  += other.mom2_accum;
+        num_samples += other.num_samples;
+      }
     };
 
 
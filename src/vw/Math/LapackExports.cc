@@ -149,4 +149,12 @@ D_getrf(d, double);
 D_getrs(s, float);
 D_getrs(d, double);
 
+#define D_gemm(prefix, type)                    \
+  void gemm(char transa, char transb, f77_int m, f77_int n, f77_int k, type alpha, const type *a, f77_int lda, const type *b, f77_int ldb, type beta, type *c, f77_int ldc) { \
+    prefix ## gemm_(&transa, &transb, &m, &n, &k, &alpha, a, &lda, b, &ldb, &beta, c, &ldc); \
+  }
+
+D_gemm(s, float);
+D_gemm(d, double);
+
 }} // vw::math
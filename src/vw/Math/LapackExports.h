@@ -180,6 +180,13 @@ namespace math {
     void dgetrf_(f77_int *m, f77_int *n, double *a, f77_int *lda,
                  f77_int *ipiv, f77_int *info );
 
+    void sgemm_(char *transa, char *transb, f77_int *m, f77_int *n, f77_int *k,
+                float *alpha, const float *a, f77_int *lda, const float *b, f77_int *ldb,
+                float *beta, float *c, f77_int *ldc);
+    void dgemm_(char *transa, char *transb, f77_int *m, f77_int *n, f77_int *k,
+                double *alpha, const double *a, f77_int *lda, const double *b, f77_int *ldb,
+                double *beta, double *c, f77_int *ldc);
+
     void sgetrs_(char *trans, f77_int* n, f77_int *nrhs, float *a, f77_int *lda,
                  f77_int *ipiv, float *b, f77_int *ldb, f77_int *info );
     void dgetrs_(char *trans, f77_int* n, f77_int *nrhs, double *a, f77_int *lda,
@@ -233,6 +240,9 @@ namespace math {
   void getrs(char trans, f77_int n, f77_int nrhs, float *a, f77_int lda, f77_int *ipiv, float *b, f77_int ldb, f77_int *info);
   void getrs(char trans, f77_int n, f77_int nrhs, double *a, f77_int lda, f77_int *ipiv, double *b, f77_int ldb, f77_int *info);
 
+  void gemm(char transa, char transb, f77_int m, f77_int n, f77_int k, float alpha, const float *a, f77_int lda, const float *b, f77_int ldb, float beta, float *c, f77_int ldc);
+  void gemm(char transa, char transb, f77_int m, f77_int n, f77_int k, double alpha, const double *a, f77_int lda, const double *b, f77_int ldb, double beta, double *c, f77_int ldc);
+
   /// \endcond
 
 } // namespace math
@@ -49,7 +49,12 @@
 #include <vw/Math/Vector.h>
 #include <vw/config.h>
 
+#if defined(VW_HAVE_PKG_LAPACK) && VW_HAVE_PKG_LAPACK==1
+#include <vw/Math/LapackExports.h>
+#endif
+
 #include <stack>
+#include <vector>
 
 #include <boost/type_traits.hpp>
 #include <boost/mpl/if.hpp>
@@ -75,6 +80,7 @@ namespace math {
 
   template <class MatrixT> class MatrixRow;
   template <class MatrixT> class MatrixCol;
+  template <class Matrix1T, class Matrix2T, bool Transpose1N, bool Transpose2N> class MatrixMatrixProduct;
 
   // *******************************************************************
   // class MatrixBase<MatrixT>
@@ -464,6 +470,15 @@ namespace math {
     Matrix( MatrixBase<T> const& m )
       : core_(m.impl().begin(),m.impl().end()), m_rows(m.impl().rows()), m_cols(m.impl().cols()) {}
 
+    /// Matrix products are evaluated with a cache-blocked kernel
+    /// rather than one dot product per element.
+    template <class Matrix1T, class Matrix2T, bool Transpose1N, bool Transpose2N>
+    Matrix( MatrixBase<MatrixMatrixProduct<Matrix1T,Matrix2T,Transpose1N,Transpose2N> > const& m )
+      : core_(m.impl().rows()*m.impl().cols()), m_rows(m.impl().rows()), m_cols(m.impl().cols()) {
+      if ( core_.size() > 0 )
+        m.impl().evaluate_to( core_.begin() );
+    }
+
     /// Standard copy assignment operator.
     Matrix& operator=( Matrix const& m ) {
       Matrix tmp( m );
@@ -479,7 +494,7 @@ namespace math {
       Matrix tmp( m );
       m_rows = tmp.m_rows;
       m_cols = tmp.m_cols;
-      core_ = tmp.core_;
+      core_.swap( tmp.core_ );
       return *this;
     }
 
@@ -1928,6 +1943,157 @@ namespace math {
   }
 
 
+  // *******************************************************************
+  // Blocked matrix multiplication kernel.
+  // *******************************************************************
+
+  /// \cond INTERNAL
+  namespace detail {
+
+    // Block sizes for the packed product.  A KC x NC panel of op(B) and
+    // an MC x KC panel of op(A) are sized to stay in cache while an
+    // MR x NR tile of the result is accumulated in registers.
+    static const size_t GEMM_MR = 4,  GEMM_NR = 8;
+    static const size_t GEMM_MC = 64, GEMM_KC = 256, GEMM_NC = 512;
+
+    // Below this many multiply-adds the per-element evaluation is faster.
+    static const size_t GEMM_MIN_WORK = 16*16*16;
+
+    // Copy an mc x kc block of op(A) into zero-padded MR-row slivers.
+    template <class DstT, class SrcT>
+    void gemm_pack_a( size_t mc, size_t kc, SrcT const* a,
+                      size_t row_stride, size_t col_stride, DstT* packed ) {
+      for ( size_t i0 = 0; i0 < mc; i0 += GEMM_MR ) {
+        size_t mr = (std::min)( GEMM_MR, mc - i0 );
+        for ( size_t p = 0; p < kc; ++p ) {
+          for ( size_t i = 0; i < mr; ++i )
+            packed[i] = DstT( a[(i0+i)*row_stride + p*col_stride] );
+          for ( size_t i = mr; i < GEMM_MR; ++i )
+            packed[i] = DstT();
+          packed += GEMM_MR;
+        }
+      }
+    }
+
+    // Copy a kc x nc block of op(B) into zero-padded NR-column slivers.
+    template <class DstT, class SrcT>
+    void gemm_pack_b( size_t kc, size_t nc, SrcT const* b,
+                      size_t row_stride, size_t col_stride, DstT* packed ) {
+      for ( size_t j0 = 0; j0 < nc; j0 += GEMM_NR ) {
+        size_t nr = (std::min)( GEMM_NR, nc - j0 );
+        for ( size_t p = 0; p < kc; ++p ) {
+          for ( size_t j = 0; j < nr; ++j )
+            packed[j] = DstT( b[p*row_stride + (j0+j)*col_stride] );
+          for ( size_t j = nr; j < GEMM_NR; ++j )
+            packed[j] = DstT();
+          packed += GEMM_NR;
+        }
+      }
+    }
+
+    // Multiply one packed sliver of A by one packed sliver of B and add
+    // the mr x nr valid part into C.  The fixed trip counts of the inner
+    // loops let the compiler keep the accumulators in vector registers.
+    template <class T>
+    void gemm_micro_kernel( size_t kc, T const* a, T const* b,
+                            T* c, size_t ldc, size_t mr, size_t nr ) {
+      T acc[GEMM_MR][GEMM_NR];
+      for ( size_t i = 0; i < GEMM_MR; ++i )
+        for ( size_t j = 0; j < GEMM_NR; ++j )
+          acc[i][j] = T();
+      for ( size_t p = 0; p < kc; ++p ) {
+        for ( size_t i = 0; i < GEMM_MR; ++i ) {
+          T ai = a[i];
+          for ( size_t j = 0; j < GEMM_NR; ++j )
+            acc[i][j] += ai * b[j];
+        }
+        a += GEMM_MR;
+        b += GEMM_NR;
+      }
+      for ( size_t i = 0; i < mr; ++i )
+        for ( size_t j = 0; j < nr; ++j )
+          c[i*ldc + j] += acc[i][j];
+    }
+
+    /// Computes C = op(A)*op(B) into densely packed row-major C, where
+    /// op(A) is m x k and op(B) is k x n.  Each operand is described by
+    /// its data pointer and the distance between consecutive rows and
+    /// columns of op(), so transposed storage needs no extra copy.
+    template <class T, class AT, class BT>
+    void gemm_blocked( size_t m, size_t n, size_t k,
+                       AT const* a, size_t a_row_stride, size_t a_col_stride,
+                       BT const* b, size_t b_row_stride, size_t b_col_stride,
+                       T* c ) {
+      std::fill( c, c + m*n, T() );
+      if ( m == 0 || n == 0 || k == 0 )
+        return;
+
+      size_t kc_max = (std::min)( GEMM_KC, k );
+      size_t nc_max = (std::min)( GEMM_NC, ((n + GEMM_NR - 1) / GEMM_NR) * GEMM_NR );
+      size_t mc_max = (std::min)( GEMM_MC, ((m + GEMM_MR - 1) / GEMM_MR) * GEMM_MR );
+      std::vector<T> packed_a( mc_max * kc_max ), packed_b( kc_max * nc_max );
+
+      for ( size_t jc = 0; jc < n; jc += GEMM_NC ) {
+        size_t nc = (std::min)( GEMM_NC, n - jc );
+        for ( size_t pc = 0; pc < k; pc += GEMM_KC ) {
+          size_t kc = (std::min)( GEMM_KC, k - pc );
+          gemm_pack_b( kc, nc, b + pc*b_row_stride + jc*b_col_stride,
+                       b_row_stride, b_col_stride, &packed_b[0] );
+          for ( size_t ic = 0; ic < m; ic += GEMM_MC ) {
+            size_t mc = (std::min)( GEMM_MC, m - ic );
+            gemm_pack_a( mc, kc, a + ic*a_row_stride + pc*a_col_stride,
+                         a_row_stride, a_col_stride, &packed_a[0] );
+            for ( size_t jr = 0; jr < nc; jr += GEMM_NR )
+              for ( size_t ir = 0; ir < mc; ir += GEMM_MR )
+                gemm_micro_kernel( kc, &packed_a[ir*kc], &packed_b[jr*kc],
+                                   c + (ic+ir)*n + jc + jr, n,
+                                   (std::min)( GEMM_MR, mc - ir ),
+                                   (std::min)( GEMM_NR, nc - jr ) );
+          }
+        }
+      }
+    }
+
+    // Chooses between BLAS and the blocked kernel.  The arguments
+    // describe op(A) (m x k) and op(B) (k x n) stored row-major, with
+    // lda/ldb the row length of the stored (untransposed) matrices.
+    template <class T, class AT, class BT>
+    struct GemmDispatch {
+      static void apply( size_t m, size_t n, size_t k,
+                         AT const* a, bool trans_a, size_t lda,
+                         BT const* b, bool trans_b, size_t ldb, T* c ) {
+        gemm_blocked( m, n, k,
+                      a, trans_a ? 1 : lda, trans_a ? lda : 1,
+                      b, trans_b ? 1 : ldb, trans_b ? ldb : 1, c );
+      }
+    };
+
+#if defined(VW_HAVE_PKG_LAPACK) && VW_HAVE_PKG_LAPACK==1
+    // BLAS is column-major, so compute C^T = op(B)^T * op(A)^T instead.
+    template <>
+    struct GemmDispatch<float,float,float> {
+      static void apply( size_t m, size_t n, size_t k,
+                         float const* a, bool trans_a, size_t lda,
+                         float const* b, bool trans_b, size_t ldb, float* c ) {
+        gemm( trans_b ? 'T' : 'N', trans_a ? 'T' : 'N', n, m, k,
+              1.0f, b, ldb, a, lda, 0.0f, c, n );
+      }
+    };
+    template <>
+    struct GemmDispatch<double,double,double> {
+      static void apply( size_t m, size_t n, size_t k,
+                         double const* a, bool trans_a, size_t lda,
+                         double const* b, bool trans_b, size_t ldb, double* c ) {
+        gemm( trans_b ? 'T' : 'N', trans_a ? 'T' : 'N', n, m, k,
+              1.0, b, ldb, a, lda, 0.0, c, n );
+      }
+    };
+#endif
+
+  } // namespace detail
+  /// \endcond
+
+
   // *******************************************************************
   // Matrix matrix product.
   // *******************************************************************
@@ -1967,6 +2133,33 @@ namespace math {
       else                                      return dot_prod( select_col(m_matrix1,i), select_row(m_matrix2,j) );
     }
 
+    /// Writes the whole product into densely packed row-major storage.
+    /// Large products go through BLAS or the cache-blocked kernel, small
+    /// ones (including all the usual fixed-size cases) are evaluated one
+    /// element at a time as before.
+    void evaluate_to( value_type* dest ) const {
+      size_t m = rows(), n = cols();
+      size_t k = (Transpose1N)?(m_matrix1.rows()):(m_matrix1.cols());
+      if ( m*n*k < detail::GEMM_MIN_WORK ) {
+        std::copy( begin(), end(), dest );
+        return;
+      }
+      typedef typename boost::remove_const<typename Matrix1T::value_type>::type value1_type;
+      typedef typename boost::remove_const<typename Matrix2T::value_type>::type value2_type;
+      detail::GemmDispatch<value_type,value1_type,value2_type>::apply
+        ( m, n, k, m_matrix1.data(), Transpose1N, m_matrix1.cols(),
+                   m_matrix2.data(), Transpose2N, m_matrix2.cols(), dest );
+    }
+
+    /// As above, converting to a different destination element type.
+    template <class DestT>
+    void evaluate_to( DestT* dest ) const {
+      std::vector<value_type> result( rows()*cols() );
+      if ( !result.empty() )
+        evaluate_to( &result[0] );
+      std::copy( result.begin(), result.end(), dest );
+    }
+
     typedef IndexingMatrixIterator<const MatrixMatrixProduct> iterator;
     typedef iterator const_iterator;
 
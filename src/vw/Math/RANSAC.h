@@ -56,6 +56,15 @@
 
 #include <vw/Math/Vector.h>
 #include <vw/Core/Log.h>
+#include <vw/Core/ThreadPool.h>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <limits>
 
 namespace vw {
 namespace math {
@@ -105,6 +114,25 @@ namespace math {
   typedef HomogeneousL2NormErrorMetric<2> InterestPointErrorMetric;
 
   /// RANSAC Driver class
+  ///
+  /// By default hypotheses are generated and scored serially for a fixed
+  /// number of iterations, as in the classic formulation. Three optional
+  /// refinements can be switched on after construction:
+  ///
+  /// - set_num_threads() generates and scores hypotheses on several
+  ///   threads.  Each thread draws samples from its own random stream,
+  ///   while a single thread draws from std::rand() as before.  The
+  ///   fitting and error functors must be safe to call concurrently,
+  ///   and the first exception one of them throws is rethrown as is.
+  ///
+  /// - set_confidence() turns the iteration count into an upper bound.
+  ///   After each new largest consensus set the number of iterations
+  ///   is lowered to log(1-p) / log(1-w^s), where p is the confidence,
+  ///   w the current inlier ratio and s the sample size.
+  ///
+  /// - set_preemptive_subset_size() scores every hypothesis on a fixed
+  ///   random subset of the data before scoring it on the whole set.
+  ///   Hypotheses which are clearly too weak are dropped early.
   template <class FittingFuncT, class ErrorFuncT>
   class RandomSampleConsensus {
     const FittingFuncT& m_fitting_func;
@@ -113,26 +141,44 @@ namespace math {
           double        m_inlier_threshold;
           int           m_min_num_output_inliers;
           bool          m_reduce_min_num_output_inliers_if_no_fit;
+          int           m_num_threads;
+          double        m_confidence;
+          int           m_preemptive_subset_size;
     
     /// \cond INTERNAL
-    // Utility Function: Pick N UNIQUE, random integers in the range [0, size]
-    inline void get_n_unique_integers(int size, std::vector<int> & samples) const {
+    // Draws integers in [0, size) from std::rand(), the way serial
+    // RANSAC always has, so its results don't depend on the thread
+    // support.
+    struct StdRandSampler {
+      int operator()(int size) {
+        const double divisor = static_cast<double>(RAND_MAX) + 1.0;
+        return static_cast<int>( (static_cast<double>(std::rand()) / divisor) * size );
+      }
+    };
+
+    // Draws integers in [0, size) from a stream owned by one thread.
+    class StreamSampler {
+      boost::random::mt19937 m_generator;
+    public:
+      StreamSampler(uint32 seed) : m_generator(seed) {}
+      int operator()(int size) {
+        boost::random::uniform_int_distribution<int> distribution(0, size-1);
+        return distribution(m_generator);
+      }
+    };
 
-      // Note: We do not modify the initial random seed. As such, if
-      // a program uses RANSAC, repeatedly running this program will
-      // always return the same results. However, if that program
-      // calls RANSAC twice while within the same instance of the
-      // program, the second time the result of RANSAC will be
-      // different, since we keep on pulling new random numbers.
+    // Utility Function: Pick N UNIQUE, random integers in the range [0, size)
+    template <class SamplerT>
+    inline void get_n_unique_integers(int size, std::vector<int> & samples,
+                                      SamplerT & sampler) const {
         
       int n = samples.size();
       VW_ASSERT(size >= n, ArgumentErr() << "Not enough samples (" << n << " / " << size << ")\n");
 
-      const double divisor = static_cast<double>(RAND_MAX) + 1.0;
       for (int i = 0; i < n; ++i) {
         bool done = false;
         while (!done) {
-          samples[i] = static_cast<int>( (static_cast<double>(std::rand()) / divisor) * size );
+          samples[i] = sampler(size);
           done = true;
           for (int j = 0; j < i; j++)
             if (samples[i] == samples[j])
@@ -140,6 +186,164 @@ namespace math {
         }
       }
     }
+
+    // The state shared by all workers of a single attempt_ransac() call.
+    // Everything in here is protected by the mutex.
+    struct SharedState {
+      Mutex  mutex;
+      int    next_iteration;  ///< Next hypothesis index to hand out.
+      int    iteration_limit; ///< Only decreases, see set_confidence().
+      int    max_num_inliers; ///< Largest consensus set seen so far.
+      int    num_inliers;     ///< Consensus set size of the best model.
+      int    best_iteration;  ///< Used to break ties between equal errors.
+      double min_err;
+      std::exception_ptr error; ///< First exception thrown by a worker.
+      typename FittingFuncT::result_type best_H;
+
+      SharedState(int num_iterations) :
+        next_iteration(0), iteration_limit(num_iterations), max_num_inliers(0),
+        num_inliers(0), best_iteration(num_iterations),
+        min_err(std::numeric_limits<double>::max()) {}
+    };
+
+    // A worker which keeps taking hypothesis indices from the shared
+    // state until the iteration limit is reached.
+    template <class ContainerT1, class ContainerT2>
+    class HypothesisTask : public Task {
+      RandomSampleConsensus    const& m_ransac;
+      std::vector<ContainerT1> const& m_p1;
+      std::vector<ContainerT2> const& m_p2;
+      std::vector<int>         const& m_subset;
+      SharedState                   & m_state;
+      StreamSampler                   m_sampler;
+    public:
+      HypothesisTask(RandomSampleConsensus const& ransac,
+                     std::vector<ContainerT1> const& p1, std::vector<ContainerT2> const& p2,
+                     std::vector<int> const& subset, SharedState & state, uint32 seed) :
+        m_ransac(ransac), m_p1(p1), m_p2(p2), m_subset(subset), m_state(state),
+        m_sampler(seed) {}
+
+      virtual void operator()() {
+        try {
+          m_ransac.run_hypotheses(m_p1, m_p2, m_subset, m_state, m_sampler);
+        } catch (...) {
+          // Exceptions can't cross the thread boundary, so keep the
+          // first one for attempt_ransac() and stop the other workers.
+          Mutex::Lock lock(m_state.mutex);
+          if (!m_state.error)
+            m_state.error = std::current_exception();
+          m_state.iteration_limit = 0;
+        }
+      }
+    };
+
+    // The number of iterations needed to draw at least one all-inlier
+    // sample with probability m_confidence.
+    int adaptive_iteration_limit(int num_inliers, int num_samples, int min_elems_for_fit) const {
+      if (m_confidence <= 0.0)
+        return m_num_iterations;
+      double good_sample_prob = std::pow(double(num_inliers) / num_samples, min_elems_for_fit);
+      if (good_sample_prob >= 1.0)
+        return 1;
+      if (good_sample_prob <= 0.0)
+        return m_num_iterations;
+      double needed = std::ceil(std::log(1.0 - m_confidence) / std::log(1.0 - good_sample_prob));
+      if (needed >= m_num_iterations)
+        return m_num_iterations;
+      return std::max(1, int(needed));
+    }
+
+    // Score H on the preemptive subset only. Reject it if the subset
+    // holds fewer than half of the inliers a model with exactly
+    // m_min_num_output_inliers inliers would be expected to have there.
+    template <class ContainerT1, class ContainerT2>
+    bool passes_preemptive_test(typename FittingFuncT::result_type const& H,
+                                std::vector<ContainerT1> const& p1,
+                                std::vector<ContainerT2> const& p2,
+                                std::vector<int>         const& subset) const {
+      int needed = int(0.5 * double(subset.size()) * m_min_num_output_inliers / p1.size());
+      int count  = 0;
+      for (size_t i = 0; i < subset.size() && count < needed; i++)
+        if (m_error_func(H, p1[subset[i]], p2[subset[i]]) < m_inlier_threshold)
+          count++;
+      return count >= needed;
+    }
+
+    // The hypothesize-and-verify loop run by each worker.
+    template <class ContainerT1, class ContainerT2, class SamplerT>
+    void run_hypotheses(std::vector<ContainerT1> const& p1,
+                        std::vector<ContainerT2> const& p2,
+                        std::vector<int>         const& subset,
+                        SharedState                   & state,
+                        SamplerT                      & sampler) const {
+
+      int min_elems_for_fit = m_fitting_func.min_elements_needed_for_fit(p1[0]);
+
+      std::vector<ContainerT1> try1;
+      std::vector<ContainerT2> try2;
+      std::vector<int> random_indices(min_elems_for_fit);
+
+      while (true) {
+        int iteration;
+        {
+          Mutex::Lock lock(state.mutex);
+          if (state.next_iteration >= state.iteration_limit)
+            return;
+          iteration = state.next_iteration++;
+        }
+
+        // 0. Get min_elems_for_fit points at random, taking care not
+        //    to select the same point twice.
+        get_n_unique_integers(p1.size(), random_indices, sampler);
+        // Resizing below is essential, as by now their size may have changed
+        try1.resize(min_elems_for_fit);
+        try2.resize(min_elems_for_fit);
+        for (int i = 0; i < min_elems_for_fit; ++i) {
+          try1[i] = p1[random_indices[i]];
+          try2[i] = p2[random_indices[i]];
+        }
+
+        // 1. Compute the fit using these samples.
+        typename FittingFuncT::result_type H = m_fitting_func(try1, try2);
+
+        // 2. Optionally reject hopeless fits using the small subset.
+        if (!subset.empty() && !passes_preemptive_test(H, p1, p2, subset))
+          continue;
+
+        // 3. Find all the inliers for this fit.
+        inliers(H, p1, p2, try1, try2);
+
+        // 4. Skip this model if too few inliers.
+        if ((int)try1.size() < m_min_num_output_inliers) 
+          continue;
+
+        // 5. Re-estimate the model using the inliers.
+        H = m_fitting_func(try1, try2, H);
+        
+        // 6. Find the mean error for the inliers.
+        double err_val = 0.0;
+        for (size_t i = 0; i < try1.size(); i++) 
+          err_val += m_error_func(H, try1[i], try2[i]);
+        err_val /= try1.size();
+
+        // 7. Save this model if its error is lowest so far, and shrink
+        //    the number of iterations if the consensus set grew.
+        Mutex::Lock lock(state.mutex);
+        if ((int)try1.size() > state.max_num_inliers) {
+          state.max_num_inliers = try1.size();
+          state.iteration_limit = std::min(state.iteration_limit,
+                                           adaptive_iteration_limit(try1.size(), p1.size(),
+                                                                    min_elems_for_fit));
+        }
+        if (err_val < state.min_err ||
+            (err_val == state.min_err && iteration < state.best_iteration)) {
+          state.min_err        = err_val;
+          state.best_H         = H;
+          state.num_inliers    = try1.size();
+          state.best_iteration = iteration;
+        }
+      }
+    }
     /// \endcond
 
   public:
@@ -178,6 +382,26 @@ namespace math {
     void reduce_min_num_output_inliers(){
       m_min_num_output_inliers = int(m_min_num_output_inliers/1.5);
     }
+
+    /// Generate and score hypotheses on this many threads.
+    void set_num_threads(int num_threads) {
+      m_num_threads = std::max(1, num_threads);
+    }
+
+    /// Stop as soon as an all-inlier sample has been drawn with this
+    /// probability (e.g. 0.99).  The iteration count passed to the
+    /// constructor remains the upper bound.  Zero disables the early stop.
+    void set_confidence(double confidence) {
+      VW_ASSERT(confidence >= 0.0 && confidence < 1.0,
+                ArgumentErr() << "RANSAC confidence must be in [0, 1).");
+      m_confidence = confidence;
+    }
+
+    /// Score each hypothesis on this many random points before scoring
+    /// it on all of them.  Zero disables the preemptive test.
+    void set_preemptive_subset_size(int subset_size) {
+      m_preemptive_subset_size = std::max(0, subset_size);
+    }
       
     /// Constructor - Stores all the inputs in member variables
     RandomSampleConsensus(FittingFuncT const& fitting_func, 
@@ -191,7 +415,8 @@ namespace math {
       m_num_iterations(num_iterations), 
       m_inlier_threshold(inlier_threshold),
       m_min_num_output_inliers(min_num_output_inliers),
-      m_reduce_min_num_output_inliers_if_no_fit(reduce_min_num_output_inliers_if_no_fit){}
+      m_reduce_min_num_output_inliers_if_no_fit(reduce_min_num_output_inliers_if_no_fit),
+      m_num_threads(1), m_confidence(0.0), m_preemptive_subset_size(0) {}
 
     /// As attempt_ransac but keep trying with smaller numbers of required inliers.
     template <class ContainerT1, class ContainerT2>
@@ -246,65 +471,53 @@ namespace math {
       VW_ASSERT( m_min_num_output_inliers >= min_elems_for_fit,
                  RANSACErr() << "RANSAC Error.  Number of requested inliers is less than min number of elements needed for fit. (" << m_min_num_output_inliers << "/" << min_elems_for_fit << ")\n");
 
-      typename FittingFuncT::result_type best_H;
-
-      std::vector<ContainerT1> try1;
-      std::vector<ContainerT2> try2;
-      std::vector<int> random_indices(min_elems_for_fit);
-
-      int num_inliers = 0;
-      double min_err = std::numeric_limits<double>::max();
-      for (int iteration = 0; iteration < m_num_iterations; ++iteration) {
-
-        // 0. Get min_elems_for_fit points at random, taking care not
-        //    to select the same point twice.
-        get_n_unique_integers(p1.size(), random_indices);
-        // Resizing below is essential, as by now their size may have changed
-        try1.resize(min_elems_for_fit);
-        try2.resize(min_elems_for_fit);
-        for (int i = 0; i < min_elems_for_fit; ++i) {
-          try1[i] = p1[random_indices[i]];
-          try2[i] = p2[random_indices[i]];
-        }
-
-        // 1. Compute the fit using these samples.
-        typename FittingFuncT::result_type H = m_fitting_func(try1, try2);
-
-        // 2. Find all the inliers for this fit.
-        inliers(H, p1, p2, try1, try2);
-
-        // 3. Skip this model if too few inliers.
-        if ((int)try1.size() < m_min_num_output_inliers) 
-          continue;
-
-        // 4. Re-estimate the model using the inliers.
-        H = m_fitting_func(try1, try2, H);
-        
-        // 5. Find the mean error for the inliers.
-        double err_val = 0.0;
-        for (size_t i = 0; i < try1.size(); i++) 
-          err_val += m_error_func(H, try1[i], try2[i]);
-        err_val /= try1.size();
-
-        // 6. Save this model if its error is lowest so far.
-        if (err_val < min_err){
-          min_err     = err_val;
-          best_H      = H;
-          num_inliers = try1.size();
-        }
+      // Note: We do not modify the initial random seed. As such, if
+      // a program uses RANSAC, repeatedly running this program will
+      // always return the same results (as long as a single thread is
+      // used). However, if that program calls RANSAC twice while
+      // within the same instance of the program, the second time the
+      // result of RANSAC will be different, since we keep on pulling
+      // new random numbers.
+      StdRandSampler sampler;
+
+      // Draw the subset used for preemptive scoring with a partial
+      // Fisher-Yates shuffle.
+      std::vector<int> subset;
+      if (m_preemptive_subset_size > 0 && m_preemptive_subset_size < (int)p1.size()) {
+        std::vector<int> all(p1.size());
+        for (size_t i = 0; i < all.size(); i++)
+          all[i] = i;
+        for (int i = 0; i < m_preemptive_subset_size; i++)
+          std::swap(all[i], all[i + sampler(all.size() - i)]);
+        subset.assign(all.begin(), all.begin() + m_preemptive_subset_size);
+      }
 
+      SharedState state(m_num_iterations);
+      if (m_num_threads <= 1) {
+        run_hypotheses(p1, p2, subset, state, sampler);
+      } else {
+        // Each thread gets its own stream, seeded from std::rand().
+        typedef HypothesisTask<ContainerT1, ContainerT2> TaskT;
+        FifoWorkQueue queue(m_num_threads);
+        for (int i = 0; i < m_num_threads; i++)
+          queue.add_task(boost::shared_ptr<Task>(new TaskT(*this, p1, p2, subset, state,
+                                                           static_cast<uint32>(std::rand()))));
+        queue.join_all();
+        if (state.error)
+          std::rethrow_exception(state.error);
       }
 
-      if (num_inliers < m_min_num_output_inliers) {
+      if (state.num_inliers < m_min_num_output_inliers) {
         vw_throw( RANSACErr() << "RANSAC was unable to find a fit that matched the supplied data." );
       }
 
       // For debugging
       VW_OUT(InfoMessage, "interest_point") << "\nRANSAC Summary:"     << std::endl;
-      VW_OUT(InfoMessage, "interest_point") << "\tFit = "              << best_H      << std::endl;
-      VW_OUT(InfoMessage, "interest_point") << "\tInliers / Total  = " << num_inliers << " / " << p1.size() << "\n\n";
+      VW_OUT(InfoMessage, "interest_point") << "\tFit = "              << state.best_H      << std::endl;
+      VW_OUT(InfoMessage, "interest_point") << "\tInliers / Total  = " << state.num_inliers << " / " << p1.size() << "\n";
+      VW_OUT(InfoMessage, "interest_point") << "\tIterations       = " << state.next_iteration << " / " << m_num_iterations << "\n\n";
       
-      return best_H;
+      return state.best_H;
     }
 
   }; // End of RandomSampleConsensus class definition
@@ -0,0 +1,624 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Core/Exception.h>
+#include <vw/Math/SparseCholesky.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace vw;
+using namespace vw::math;
+
+namespace {
+
+  typedef std::vector<std::vector<size_t> > adjacency_type;
+
+  // Block graph of A, without self loops.
+  adjacency_type block_graph( BlockSparseSymmetricMatrix const& A ) {
+    adjacency_type graph( A.num_blocks() );
+    for ( size_t j = 0; j < A.num_blocks(); j++ ) {
+      BlockSparseSymmetricMatrix::column_type const& column = A.column(j);
+      for ( BlockSparseSymmetricMatrix::column_type::const_iterator it = column.begin();
+            it != column.end(); ++it ) {
+        if ( it->first == j )
+          continue;
+        graph[j].push_back( it->first );
+        graph[it->first].push_back( j );
+      }
+    }
+    return graph;
+  }
+
+  // Recursive nested dissection. Every call owns the vertices whose
+  // label equals its own label. Separators are numbered after both of
+  // the parts they split.
+  class NestedDissection {
+    adjacency_type const& m_graph;
+    size_t m_leaf_size;
+    std::vector<int> m_label;
+    std::vector<int> m_level;
+    int m_next_label;
+    std::vector<size_t>& m_ordering;
+
+    // Breadth first search from root over the vertices labelled
+    // label. Fills m_level and returns the vertices in visiting order.
+    std::vector<size_t> bfs( size_t root, int label ) {
+      std::vector<size_t> visited;
+      visited.push_back( root );
+      m_level[root] = 0;
+      for ( size_t head = 0; head < visited.size(); head++ ) {
+        size_t v = visited[head];
+        for ( size_t n = 0; n < m_graph[v].size(); n++ ) {
+          size_t w = m_graph[v][n];
+          if ( m_label[w] == label && m_level[w] < 0 ) {
+            m_level[w] = m_level[v] + 1;
+            visited.push_back( w );
+          }
+        }
+      }
+      return visited;
+    }
+
+    void clear_levels( std::vector<size_t> const& nodes ) {
+      for ( size_t i = 0; i < nodes.size(); i++ )
+        m_level[nodes[i]] = -1;
+    }
+
+    size_t degree( size_t v, int label ) const {
+      size_t count = 0;
+      for ( size_t n = 0; n < m_graph[v].size(); n++ )
+        if ( m_label[m_graph[v][n]] == label )
+          count++;
+      return count;
+    }
+
+    void append( std::vector<size_t> nodes ) {
+      std::sort( nodes.begin(), nodes.end() );
+      for ( size_t i = 0; i < nodes.size(); i++ ) {
+        m_label[nodes[i]] = -1;
+        m_ordering.push_back( nodes[i] );
+      }
+    }
+
+  public:
+    NestedDissection( adjacency_type const& graph, size_t leaf_size,
+                      std::vector<size_t>& ordering ) :
+      m_graph(graph), m_leaf_size(std::max(leaf_size,size_t(1))),
+      m_label(graph.size(), 0), m_level(graph.size(), -1),
+      m_next_label(1), m_ordering(ordering) {}
+
+    void operator()( std::vector<size_t> const& nodes, int label ) {
+      if ( nodes.size() <= m_leaf_size ) {
+        append( nodes );
+        return;
+      }
+
+      // Split disconnected subgraphs first
+      std::vector<size_t> component = bfs( nodes[0], label );
+      if ( component.size() < nodes.size() ) {
+        std::vector<std::vector<size_t> > components( 1, component );
+        for ( size_t i = 0; i < nodes.size(); i++ )
+          if ( m_level[nodes[i]] < 0 )
+            components.push_back( bfs( nodes[i], label ) );
+        std::vector<int> labels( components.size() );
+        for ( size_t c = 0; c < components.size(); c++ ) {
+          clear_levels( components[c] );
+          labels[c] = m_next_label++;
+          for ( size_t i = 0; i < components[c].size(); i++ )
+            m_label[components[c][i]] = labels[c];
+        }
+        for ( size_t c = 0; c < components.size(); c++ )
+          (*this)( components[c], labels[c] );
+        return;
+      }
+
+      // Find a pseudo peripheral vertex: restart from the lowest
+      // degree vertex of the last level until the depth stops growing.
+      size_t root = nodes[0];
+      int depth = m_level[component.back()];
+      for ( int sweep = 0; sweep < 4; sweep++ ) {
+        size_t best = component.back();
+        size_t best_degree = degree( best, label );
+        for ( size_t i = component.size(); i-- > 0 && m_level[component[i]] == depth; ) {
+          size_t d = degree( component[i], label );
+          if ( d < best_degree ) {
+            best = component[i];
+            best_degree = d;
+          }
+        }
+        clear_levels( component );
+        std::vector<size_t> candidate = bfs( best, label );
+        int candidate_depth = m_level[candidate.back()];
+        if ( candidate_depth <= depth ) {
+          clear_levels( candidate );
+          component = bfs( root, label );
+          break;
+        }
+        root = best;
+        depth = candidate_depth;
+        component.swap( candidate );
+      }
+
+      // Too dense to be worth splitting
+      if ( depth < 2 ) {
+        clear_levels( component );
+        append( component );
+        return;
+      }
+
+      // The middle level separates the levels above it from the levels
+      // below it. Separator vertices with no neighbour below are moved
+      // to the upper part.
+      int middle = depth / 2;
+      std::vector<size_t> upper, lower, separator;
+      for ( size_t i = 0; i < component.size(); i++ ) {
+        size_t v = component[i];
+        if ( m_level[v] < middle ) {
+          upper.push_back( v );
+        } else if ( m_level[v] > middle ) {
+          lower.push_back( v );
+        } else {
+          bool touches_lower = false;
+          for ( size_t n = 0; n < m_graph[v].size() && !touches_lower; n++ ) {
+            size_t w = m_graph[v][n];
+            touches_lower = m_label[w] == label && m_level[w] == middle + 1;
+          }
+          if ( touches_lower )
+            separator.push_back( v );
+          else
+            upper.push_back( v );
+        }
+      }
+      clear_levels( component );
+
+      int upper_label = m_next_label++, lower_label = m_next_label++;
+      for ( size_t i = 0; i < upper.size(); i++ )
+        m_label[upper[i]] = upper_label;
+      for ( size_t i = 0; i < lower.size(); i++ )
+        m_label[lower[i]] = lower_label;
+      for ( size_t i = 0; i < separator.size(); i++ )
+        m_label[separator[i]] = -2;
+
+      if ( !upper.empty() )
+        (*this)( upper, upper_label );
+      if ( !lower.empty() )
+        (*this)( lower, lower_label );
+      append( separator );
+    }
+  };
+
+  // Dense Cholesky of the top width x width part of a column major
+  // height x width panel. The part below it is replaced by the
+  // matching rows of L. Returns false if the panel is not positive
+  // definite.
+  bool factor_panel( double* panel, size_t height, size_t width ) {
+    for ( size_t c = 0; c < width; c++ ) {
+      double* column = panel + c * height;
+      double diagonal = column[c];
+      if ( !(diagonal > 0) )
+        return false;
+      diagonal = std::sqrt( diagonal );
+      double scale = 1.0 / diagonal;
+      column[c] = diagonal;
+      for ( size_t r = c + 1; r < height; r++ )
+        column[r] *= scale;
+      for ( size_t c2 = c + 1; c2 < width; c2++ ) {
+        double factor = column[c2];
+        if ( factor == 0 )
+          continue;
+        double* column2 = panel + c2 * height;
+        for ( size_t r = c2; r < height; r++ )
+          column2[r] -= column[r] * factor;
+      }
+    }
+    return true;
+  }
+
+  // Inverse of a small symmetric positive definite matrix. Falls back
+  // to the inverse of the diagonal if the Cholesky factorization fails.
+  Matrix<double> spd_inverse( Matrix<double> const& A ) {
+    size_t n = A.rows();
+    std::vector<double> L( n * n );
+    for ( size_t c = 0; c < n; c++ )
+      for ( size_t r = 0; r < n; r++ )
+        L[c * n + r] = A(r, c);
+
+    Matrix<double> result( n, n );
+    if ( !factor_panel( &L[0], n, n ) ) {
+      for ( size_t i = 0; i < n; i++ )
+        result(i, i) = A(i, i) != 0 ? 1.0 / A(i, i) : 0.0;
+      return result;
+    }
+
+    // Solve L*L^T*x = e_k for every column k
+    std::vector<double> x( n );
+    for ( size_t k = 0; k < n; k++ ) {
+      std::fill( x.begin(), x.end(), 0.0 );
+      x[k] = 1;
+      for ( size_t c = 0; c < n; c++ ) {
+        x[c] /= L[c * n + c];
+        for ( size_t r = c + 1; r < n; r++ )
+          x[r] -= L[c * n + r] * x[c];
+      }
+      for ( size_t c = n; c-- > 0; ) {
+        for ( size_t r = c + 1; r < n; r++ )
+          x[c] -= L[c * n + r] * x[r];
+        x[c] /= L[c * n + c];
+      }
+      for ( size_t r = 0; r < n; r++ )
+        result(r, k) = x[r];
+    }
+    return result;
+  }
+
+} // namespace
+
+
+// ---------------------------------------------------------------------
+// BlockSparseSymmetricMatrix
+// ---------------------------------------------------------------------
+
+BlockSparseSymmetricMatrix::BlockSparseSymmetricMatrix( size_t num_blocks,
+                                                        size_t block_size ) :
+  m_block_size(block_size), m_columns(num_blocks) {}
+
+size_t BlockSparseSymmetricMatrix::num_nonzero_blocks() const {
+  size_t count = 0;
+  for ( size_t j = 0; j < m_columns.size(); j++ )
+    count += m_columns[j].size();
+  return count;
+}
+
+Matrix<double>& BlockSparseSymmetricMatrix::block( size_t i, size_t j ) {
+  VW_ASSERT( i >= j && i < m_columns.size(),
+             ArgumentErr() << "BlockSparseSymmetricMatrix: only blocks on or below the diagonal are stored." );
+  column_type::iterator it = m_columns[j].find( i );
+  if ( it == m_columns[j].end() )
+    it = m_columns[j].insert( std::make_pair( i, Matrix<double>( m_block_size, m_block_size ) ) ).first;
+  return it->second;
+}
+
+void BlockSparseSymmetricMatrix::multiply( Vector<double> const& x, Vector<double>& y ) const {
+  VW_ASSERT( x.size() == rows(),
+             ArgumentErr() << "BlockSparseSymmetricMatrix: vector has the wrong size." );
+  y.set_size( rows() );
+  y.set_all( 0.0 );
+  size_t bs = m_block_size;
+  for ( size_t j = 0; j < m_columns.size(); j++ ) {
+    for ( column_type::const_iterator it = m_columns[j].begin();
+          it != m_columns[j].end(); ++it ) {
+      size_t i = it->first;
+      Matrix<double> const& B = it->second;
+      for ( size_t r = 0; r < bs; r++ )
+        for ( size_t c = 0; c < bs; c++ ) {
+          y[i*bs + r] += B(r, c) * x[j*bs + c];
+          if ( i != j )
+            y[j*bs + c] += B(r, c) * x[i*bs + r];
+        }
+    }
+  }
+}
+
+
+// ---------------------------------------------------------------------
+// Ordering
+// ---------------------------------------------------------------------
+
+std::vector<size_t> vw::math::nested_dissection_ordering( BlockSparseSymmetricMatrix const& A,
+                                                          size_t leaf_size ) {
+  adjacency_type graph = block_graph( A );
+  std::vector<size_t> ordering, nodes( graph.size() );
+  ordering.reserve( graph.size() );
+  for ( size_t i = 0; i < nodes.size(); i++ )
+    nodes[i] = i;
+  if ( !nodes.empty() )
+    NestedDissection( graph, leaf_size, ordering )( nodes, 0 );
+  return ordering;
+}
+
+
+// ---------------------------------------------------------------------
+// SupernodalCholesky
+// ---------------------------------------------------------------------
+
+SupernodalCholesky::SupernodalCholesky() :
+  m_block_size(1), m_analyzed(false), m_factored(false) {}
+
+size_t SupernodalCholesky::factor_size() const {
+  size_t size = 0;
+  for ( size_t s = 0; s < m_supernodes.size(); s++ )
+    size += m_supernodes[s].rows.size() * ( m_supernodes[s].last - m_supernodes[s].first );
+  return size * m_block_size * m_block_size;
+}
+
+void SupernodalCholesky::analyze( BlockSparseSymmetricMatrix const& A ) {
+  size_t n = A.num_blocks();
+  m_block_size = A.block_size();
+  m_ordering = nested_dissection_ordering( A );
+  m_inverse_ordering.resize( n );
+  for ( size_t i = 0; i < n; i++ )
+    m_inverse_ordering[ m_ordering[i] ] = i;
+
+  // Lower pattern of the reordered matrix, by column
+  std::vector<std::vector<size_t> > pattern( n );
+  for ( size_t j = 0; j < n; j++ ) {
+    BlockSparseSymmetricMatrix::column_type const& column = A.column(j);
+    for ( BlockSparseSymmetricMatrix::column_type::const_iterator it = column.begin();
+          it != column.end(); ++it ) {
+      size_t a = m_inverse_ordering[it->first], b = m_inverse_ordering[j];
+      if ( a == b )
+        continue;
+      pattern[ std::min(a,b) ].push_back( std::max(a,b) );
+    }
+  }
+
+  // Elimination tree, using the row patterns (Liu's algorithm with
+  // path compression).
+  const size_t none = size_t(-1);
+  std::vector<std::vector<size_t> > row_pattern( n );
+  for ( size_t j = 0; j < n; j++ )
+    for ( size_t k = 0; k < pattern[j].size(); k++ )
+      row_pattern[ pattern[j][k] ].push_back( j );
+  std::vector<size_t> parent( n, none ), ancestor( n, none );
+  for ( size_t k = 0; k < n; k++ ) {
+    for ( size_t p = 0; p < row_pattern[k].size(); p++ ) {
+      size_t r = row_pattern[k][p];
+      while ( ancestor[r] != none && ancestor[r] != k ) {
+        size_t next = ancestor[r];
+        ancestor[r] = k;
+        r = next;
+      }
+      if ( ancestor[r] == none ) {
+        ancestor[r] = k;
+        parent[r] = k;
+      }
+    }
+  }
+  row_pattern.clear();
+
+  // Column structures of L below the diagonal. A column's structure
+  // is its own pattern merged with the structures of its children.
+  std::vector<std::vector<size_t> > structure( n );
+  std::vector<size_t> num_children( n, 0 );
+  for ( size_t j = 0; j < n; j++ ) {
+    std::vector<size_t>& s = structure[j];
+    s.insert( s.end(), pattern[j].begin(), pattern[j].end() );
+    std::sort( s.begin(), s.end() );
+    s.erase( std::unique( s.begin(), s.end() ), s.end() );
+    if ( parent[j] != none ) {
+      num_children[ parent[j] ]++;
+      std::vector<size_t>& p = structure[ parent[j] ];
+      std::vector<size_t>::iterator below = std::upper_bound( s.begin(), s.end(), parent[j] );
+      p.insert( p.end(), below, s.end() );
+    }
+  }
+  pattern.clear();
+
+  // Fundamental supernodes: j joins the supernode of j-1 when j-1 is
+  // its only child and their structures match.
+  m_supernodes.clear();
+  m_supernode_of.resize( n );
+  for ( size_t j = 0; j < n; j++ ) {
+    bool extend = j > 0 && parent[j-1] == j && num_children[j] == 1 &&
+      structure[j-1].size() == structure[j].size() + 1;
+    if ( !extend ) {
+      m_supernodes.push_back( Supernode() );
+      m_supernodes.back().first = j;
+    }
+    m_supernodes.back().last = j + 1;
+    m_supernode_of[j] = m_supernodes.size() - 1;
+  }
+  for ( size_t s = 0; s < m_supernodes.size(); s++ ) {
+    Supernode& node = m_supernodes[s];
+    node.rows.clear();
+    for ( size_t j = node.first; j < node.last; j++ )
+      node.rows.push_back( j );
+    std::vector<size_t> const& below = structure[ node.last - 1 ];
+    node.rows.insert( node.rows.end(), below.begin(), below.end() );
+    node.panel.clear();
+  }
+
+  m_analyzed = true;
+  m_factored = false;
+}
+
+void SupernodalCholesky::factor( BlockSparseSymmetricMatrix const& A ) {
+  if ( !m_analyzed || A.num_blocks() != m_ordering.size() ||
+       A.block_size() != m_block_size )
+    analyze( A );
+  m_factored = false;
+
+  size_t n = A.num_blocks();
+  size_t bs = m_block_size;
+  const size_t none = size_t(-1);
+  std::vector<size_t> position( n, none );
+
+  // Scatter A into the panels
+  for ( size_t s = 0; s < m_supernodes.size(); s++ ) {
+    Supernode& node = m_supernodes[s];
+    size_t height = node.rows.size() * bs;
+    node.panel.assign( height * ( node.last - node.first ) * bs, 0.0 );
+  }
+  for ( size_t j = 0; j < n; j++ ) {
+    BlockSparseSymmetricMatrix::column_type const& column = A.column(j);
+    for ( BlockSparseSymmetricMatrix::column_type::const_iterator it = column.begin();
+          it != column.end(); ++it ) {
+      size_t a = m_inverse_ordering[it->first], b = m_inverse_ordering[j];
+      bool transposed = a < b;
+      size_t row = std::max(a,b), col = std::min(a,b);
+      Supernode& node = m_supernodes[ m_supernode_of[col] ];
+      std::vector<size_t>::const_iterator found =
+        std::lower_bound( node.rows.begin(), node.rows.end(), row );
+      if ( found == node.rows.end() || *found != row )
+        vw_throw( LogicErr() << "SupernodalCholesky: matrix pattern differs from the analyzed pattern." );
+      size_t height = node.rows.size() * bs;
+      size_t r0 = ( found - node.rows.begin() ) * bs;
+      size_t c0 = ( col - node.first ) * bs;
+      Matrix<double> const& B = it->second;
+      for ( size_t c = 0; c < bs; c++ )
+        for ( size_t r = 0; r < bs; r++ )
+          node.panel[ (c0 + c) * height + r0 + r ] = transposed ? B(c, r) : B(r, c);
+    }
+  }
+
+  // Factor the supernodes in order, pushing each one's update into the
+  // supernodes that own its rows.
+  std::vector<double> update, left, right;
+  for ( size_t s = 0; s < m_supernodes.size(); s++ ) {
+    Supernode& node = m_supernodes[s];
+    size_t width = ( node.last - node.first ) * bs;
+    size_t height = node.rows.size() * bs;
+    if ( !factor_panel( &node.panel[0], height, width ) )
+      vw_throw( MathErr() << "SupernodalCholesky: matrix is not positive definite." );
+
+    size_t below = height - width;
+    if ( below == 0 )
+      continue;
+
+    // Rows of L21 in row major order, for the product kernel
+    left.resize( below * width );
+    for ( size_t c = 0; c < width; c++ )
+      for ( size_t r = 0; r < below; r++ )
+        left[ r * width + c ] = node.panel[ c * height + width + r ];
+
+    size_t num_own = node.last - node.first;
+    size_t g = num_own;
+    while ( g < node.rows.size() ) {
+      // Rows g..g_end belong to the same target supernode
+      Supernode& target = m_supernodes[ m_supernode_of[ node.rows[g] ] ];
+      size_t g_end = g;
+      while ( g_end < node.rows.size() && node.rows[g_end] < target.last )
+        g_end++;
+
+      // update = L21[g:,:] * L21[g:g_end,:]^T
+      size_t m = ( node.rows.size() - g ) * bs;
+      size_t k = ( g_end - g ) * bs;
+      update.resize( m * k );
+      detail::gemm_blocked( m, k, width,
+                            &left[ (g - num_own) * bs * width ], width, size_t(1),
+                            &left[ (g - num_own) * bs * width ], size_t(1), width,
+                            &update[0] );
+
+      for ( size_t t = 0; t < target.rows.size(); t++ )
+        position[ target.rows[t] ] = t;
+      size_t target_height = target.rows.size() * bs;
+      for ( size_t cb = g; cb < g_end; cb++ ) {
+        size_t target_col = ( node.rows[cb] - target.first ) * bs;
+        for ( size_t rb = cb; rb < node.rows.size(); rb++ ) {
+          size_t target_row = position[ node.rows[rb] ] * bs;
+          for ( size_t c = 0; c < bs; c++ ) {
+            double* dst = &target.panel[ (target_col + c) * target_height + target_row ];
+            double const* src = &update[ (rb - g) * bs * k + (cb - g) * bs + c ];
+            for ( size_t r = 0; r < bs; r++ )
+              dst[r] -= src[ r * k ];
+          }
+        }
+      }
+      for ( size_t t = 0; t < target.rows.size(); t++ )
+        position[ target.rows[t] ] = none;
+
+      g = g_end;
+    }
+  }
+
+  m_factored = true;
+}
+
+Vector<double> SupernodalCholesky::solve( Vector<double> const& b ) const {
+  VW_ASSERT( m_factored, LogicErr() << "SupernodalCholesky: solve() called before factor()." );
+  size_t bs = m_block_size;
+  VW_ASSERT( b.size() == m_ordering.size() * bs,
+             ArgumentErr() << "SupernodalCholesky: vector has the wrong size." );
+
+  Vector<double> y( b.size() );
+  for ( size_t i = 0; i < m_ordering.size(); i++ )
+    subvector( y, i*bs, bs ) = subvector( b, m_ordering[i]*bs, bs );
+
+  // Forward substitution with L
+  for ( size_t s = 0; s < m_supernodes.size(); s++ ) {
+    Supernode const& node = m_supernodes[s];
+    size_t width = ( node.last - node.first ) * bs;
+    size_t height = node.rows.size() * bs;
+    double* x = &y[ node.first * bs ];
+    for ( size_t c = 0; c < width; c++ ) {
+      double const* column = &node.panel[ c * height ];
+      x[c] /= column[c];
+      for ( size_t r = c + 1; r < width; r++ )
+        x[r] -= column[r] * x[c];
+      for ( size_t rb = node.last - node.first; rb < node.rows.size(); rb++ ) {
+        double* dst = &y[ node.rows[rb] * bs ];
+        double const* src = column + rb * bs;
+        for ( size_t r = 0; r < bs; r++ )
+          dst[r] -= src[r] * x[c];
+      }
+    }
+  }
+
+  // Back substitution with L^T
+  for ( size_t s = m_supernodes.size(); s-- > 0; ) {
+    Supernode const& node = m_supernodes[s];
+    size_t width = ( node.last - node.first ) * bs;
+    size_t height = node.rows.size() * bs;
+    double* x = &y[ node.first * bs ];
+    for ( size_t c = width; c-- > 0; ) {
+      double const* column = &node.panel[ c * height ];
+      double sum = x[c];
+      for ( size_t r = c + 1; r < width; r++ )
+        sum -= column[r] * x[r];
+      for ( size_t rb = node.last - node.first; rb < node.rows.size(); rb++ ) {
+        double const* src = column + rb * bs;
+        double const* val = &y[ node.rows[rb] * bs ];
+        for ( size_t r = 0; r < bs; r++ )
+          sum -= src[r] * val[r];
+      }
+      x[c] = sum / column[c];
+    }
+  }
+
+  Vector<double> result( b.size() );
+  for ( size_t i = 0; i < m_ordering.size(); i++ )
+    subvector( result, m_ordering[i]*bs, bs ) = subvector( y, i*bs, bs );
+  return result;
+}
+
+
+// ---------------------------------------------------------------------
+// BlockJacobiPreconditioner
+// ---------------------------------------------------------------------
+
+BlockJacobiPreconditioner::BlockJacobiPreconditioner( BlockSparseSymmetricMatrix const& A ) :
+  m_block_size( A.block_size() ), m_inverse_blocks( A.num_blocks() ) {
+  for ( size_t j = 0; j < A.num_blocks(); j++ ) {
+    BlockSparseSymmetricMatrix::column_type::const_iterator it = A.column(j).find(j);
+    if ( it == A.column(j).end() ) {
+      m_inverse_blocks[j].set_size( m_block_size, m_block_size );
+      m_inverse_blocks[j].set_identity();
+    } else {
+      m_inverse_blocks[j] = spd_inverse( it->second );
+    }
+  }
+}
+
+Vector<double> BlockJacobiPreconditioner::operator()( Vector<double> const& r ) const {
+  size_t bs = m_block_size;
+  Vector<double> z( r.size() );
+  for ( size_t j = 0; j < m_inverse_blocks.size(); j++ )
+    subvector( z, j*bs, bs ) = m_inverse_blocks[j] * subvector( r, j*bs, bs );
+  return z;
+}
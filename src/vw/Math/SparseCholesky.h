@@ -0,0 +1,158 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file SparseCholesky.h
+///
+/// Block sparse symmetric matrices and solvers for them.
+///
+/// BlockSparseSymmetricMatrix stores a symmetric matrix built from
+/// dense square blocks that all have the same size. This is the shape
+/// of the reduced camera system in bundle adjustment, where every
+/// block couples the parameters of two cameras.
+///
+/// SupernodalCholesky factors such a matrix as L*L^T after reordering
+/// its blocks by nested dissection. Consecutive columns of L that
+/// share a sparsity pattern are grouped into supernodes. Each
+/// supernode is stored as a dense panel, so most of the work is done
+/// by dense kernels. The ordering and symbolic analysis depend only on
+/// the block pattern and can be reused across factorizations.
+///
+/// BlockJacobiPreconditioner inverts the diagonal blocks. It is meant
+/// for use with preconditioned_conjugate_gradient() from
+/// ConjugateGradient.h.
+///
+#ifndef __VW_MATH_SPARSE_CHOLESKY_H__
+#define __VW_MATH_SPARSE_CHOLESKY_H__
+
+#include <vw/Math/Vector.h>
+#include <vw/Math/Matrix.h>
+
+#include <map>
+#include <vector>
+
+namespace vw {
+namespace math {
+
+  /// A symmetric matrix of num_blocks x num_blocks dense blocks, each
+  /// block_size x block_size. Only the diagonal blocks and the blocks
+  /// below them are stored. Blocks that were never touched are zero.
+  class BlockSparseSymmetricMatrix {
+  public:
+    /// Blocks of one block column, keyed by block row (>= the column).
+    typedef std::map<size_t, Matrix<double> > column_type;
+
+    explicit BlockSparseSymmetricMatrix( size_t num_blocks = 0, size_t block_size = 1 );
+
+    size_t num_blocks() const { return m_columns.size(); }
+    size_t block_size() const { return m_block_size; }
+    size_t rows() const { return m_columns.size() * m_block_size; }
+    size_t cols() const { return rows(); }
+
+    /// Number of stored blocks, including the diagonal.
+    size_t num_nonzero_blocks() const;
+
+    /// Block (i,j) for i >= j. A zero block is created if it isn't
+    /// stored yet.
+    Matrix<double>& block( size_t i, size_t j );
+
+    /// The stored blocks of block column j.
+    column_type const& column( size_t j ) const { return m_columns[j]; }
+
+    /// y = A*x
+    void multiply( Vector<double> const& x, Vector<double>& y ) const;
+
+  private:
+    size_t m_block_size;
+    std::vector<column_type> m_columns;
+  };
+
+  inline Vector<double> operator*( BlockSparseSymmetricMatrix const& A,
+                                   Vector<double> const& x ) {
+    Vector<double> y;
+    A.multiply( x, y );
+    return y;
+  }
+
+  /// Nested dissection ordering of the blocks of A. The result lists
+  /// the original block indices in their new order. Subgraphs of at
+  /// most leaf_size blocks are left in their original order.
+  std::vector<size_t> nested_dissection_ordering( BlockSparseSymmetricMatrix const& A,
+                                                  size_t leaf_size = 8 );
+
+  /// Supernodal Cholesky factorization P*A*P^T = L*L^T.
+  class SupernodalCholesky {
+  public:
+    SupernodalCholesky();
+
+    /// Computes the ordering, the elimination tree and the supernode
+    /// layout of A. This only depends on the block pattern of A, so a
+    /// sequence of matrices with the same pattern only has to be
+    /// analyzed once.
+    void analyze( BlockSparseSymmetricMatrix const& A );
+
+    /// Numeric factorization. Calls analyze() if it hasn't been called
+    /// yet. Throws MathErr if A is not positive definite and LogicErr if
+    /// A has a block outside of the analyzed pattern.
+    void factor( BlockSparseSymmetricMatrix const& A );
+
+    /// Solves A*x = b with the last factorization.
+    Vector<double> solve( Vector<double> const& b ) const;
+
+    bool analyzed() const { return m_analyzed; }
+    bool factored() const { return m_factored; }
+
+    /// The block ordering in use. Lists the original block indices in
+    /// the order they are eliminated.
+    std::vector<size_t> const& ordering() const { return m_ordering; }
+
+    size_t num_supernodes() const { return m_supernodes.size(); }
+
+    /// Number of scalar entries stored for L.
+    size_t factor_size() const;
+
+  private:
+    struct Supernode {
+      size_t first, last;         // Block columns [first,last) of L
+      std::vector<size_t> rows;   // Block rows, starting with first..last-1
+      std::vector<double> panel;  // rows.size()*bs x (last-first)*bs, column major
+    };
+
+    size_t m_block_size;
+    std::vector<size_t> m_ordering, m_inverse_ordering;
+    std::vector<size_t> m_supernode_of;
+    std::vector<Supernode> m_supernodes;
+    bool m_analyzed, m_factored;
+  };
+
+  /// Applies the inverse of the block diagonal of a
+  /// BlockSparseSymmetricMatrix.
+  class BlockJacobiPreconditioner {
+  public:
+    BlockJacobiPreconditioner() : m_block_size(1) {}
+    BlockJacobiPreconditioner( BlockSparseSymmetricMatrix const& A );
+
+    Vector<double> operator()( Vector<double> const& r ) const;
+
+  private:
+    size_t m_block_size;
+    std::vector<Matrix<double> > m_inverse_blocks;
+  };
+
+}} // namespace vw::math
+
+#endif // __VW_MATH_SPARSE_CHOLESKY_H__
@@ -27,6 +27,7 @@
 #include <vector>
 #include <algorithm>
 #include <fstream>
+#include <limits>
 
 #include <vw/Core/CompoundTypes.h>
 #include <vw/Core/TypeDeduction.h>
@@ -168,7 +169,10 @@ public: // Functions
   void operator()(double value) { add_value(value); }
 
   /// Add a value with no bounds checking on the input!
-  void add_value_no_check(double value);
+  void add_value_no_check(double value, size_t count=1);
+
+  /// Add the counts of another histogram with the same bins.
+  void merge(Histogram const& other);
 
   /// Return the bin index containing the specified histogram percentile
   size_t get_percentile(double percentile) const;
@@ -187,6 +191,97 @@ private: // Variables
 }; // End class histogram
 
 
+/// Mergeable quantile estimator.
+/// - Values are stored exactly until there are more than exact_limit of
+///   them, so quantiles of small inputs are exact.
+/// - Past that it becomes a t-digest: the values are summarized by
+///   clusters that get smaller towards the tails. The rank error is
+///   roughly proportional to sqrt(q*(1-q))/compression.
+/// - Partial results from different threads can be combined with merge().
+template <class ValT>
+class QuantileAccumulator : public ReturnFixedType<void> {
+public:
+  typedef ValT value_type;
+
+  QuantileAccumulator( size_t compression = 200, size_t exact_limit = 1<<20 );
+
+  void operator()( ValT const& value );
+  void merge( QuantileAccumulator const& other );
+
+  /// Number of values added
+  size_t size() const { return m_count; }
+
+  /// True while the values are still stored exactly
+  bool is_exact() const { return m_centroids.empty() && m_count <= m_exact_limit; }
+
+  /// Value at quantile q in [0,1], interpolating between neighbors.
+  ValT quantile( double q ) const;
+
+  /// The median. While exact it matches destructive_median().
+  ValT median() const;
+  ValT value() const { return median(); }
+
+private:
+  struct Centroid {
+    double mean, weight;
+    Centroid( double m = 0, double w = 0 ) : mean(m), weight(w) {}
+    bool operator<( Centroid const& other ) const { return mean < other.mean; }
+  };
+
+  void add_centroid( double mean, double weight );
+  void switch_to_digest() const;
+  void compress() const;
+
+  size_t m_compression, m_exact_limit, m_count;
+  double m_min, m_max;
+  mutable std::vector<ValT>     m_values;
+  mutable std::vector<Centroid> m_centroids;
+  mutable size_t m_num_unmerged;
+}; // End class QuantileAccumulator
+
+
+/// Builds a histogram in a single pass over data of unknown range.
+/// - The first values are kept as they are.
+/// - Integer data between -32768 and 65535 is counted per value, which
+///   is exact.
+/// - Anything else goes into a fine histogram whose range doubles
+///   whenever a value falls outside it. Each value is then placed
+///   within 1/fine_bins of the data range of its exact position.
+/// - fill() makes a Histogram with num_bins bins spanning the data,
+///   as two passes (min/max first, then counting) would.
+class StreamingHistogram {
+public:
+  StreamingHistogram( size_t fine_bins = 1<<14, size_t raw_limit = 1<<16 );
+
+  void operator()( double value ) { add( value, 1.0 ); }
+  void add( double value, double count );
+  void merge( StreamingHistogram const& other );
+
+  size_t size() const { return size_t(m_total); }
+  double min_value() const { return m_min; }
+  double max_value() const { return m_max; }
+
+  /// Fills hist with num_bins bins over [min_value,max_value]. If all
+  /// values are equal the range is extended by one.
+  void fill( size_t num_bins, Histogram& hist ) const;
+
+private:
+  enum Mode { RawMode, CountMode, BinMode };
+  static const int COUNT_OFFSET = 32768, COUNT_SIZE = 32768+65536;
+
+  void switch_to_counts();
+  void switch_to_bins();
+  void add_to_bins( double value, double count );
+
+  Mode   m_mode;
+  size_t m_fine_bins, m_raw_limit;
+  double m_min, m_max, m_total;
+  std::vector<double> m_raw;
+  std::vector<double> m_counts;       // Per value or per fine bin
+  double m_bin_start, m_bin_width;
+}; // End class StreamingHistogram
+
+
 
 
 
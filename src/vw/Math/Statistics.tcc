@@ -570,11 +570,20 @@ void Histogram::add_value(double value, bool saturate) {
   ++m_num_values;
 }
 inline
-void Histogram::add_value_no_check(double value) {
+void Histogram::add_value_no_check(double value, size_t count) {
   // Compute the bin
   int bin = static_cast<int>(round( m_max_bin * ( (value - m_min_value)/m_range ) ));
-  m_bin_values[bin] += 1.0;    
-  ++m_num_values;
+  m_bin_values[bin] += count;
+  m_num_values += count;
+}
+inline
+void Histogram::merge(Histogram const& other) {
+  if ( other.m_num_bins != m_num_bins || other.m_min_value != m_min_value ||
+       other.m_max_value != m_max_value )
+    vw_throw(ArgumentErr() << "Histogram::merge: histograms have different bins.");
+  for (int i=0; i<m_num_bins; ++i)
+    m_bin_values[i] += other.m_bin_values[i];
+  m_num_values += other.m_num_values;
 }
 inline
 size_t Histogram::get_percentile(double percentile) const {
@@ -605,3 +614,297 @@ void Histogram::write_to_disk(std::string const& path) const {
   f.close();
 }
 
+
+//--------------------------------------------------------------------------
+// Class QuantileAccumulator
+
+template <class ValT>
+QuantileAccumulator<ValT>::QuantileAccumulator( size_t compression, size_t exact_limit )
+  : m_compression(compression), m_exact_limit(exact_limit), m_count(0),
+    m_min(std::numeric_limits<double>::max()), m_max(-std::numeric_limits<double>::max()),
+    m_num_unmerged(0) {
+  VW_ASSERT(compression > 0, ArgumentErr() << "QuantileAccumulator: compression must be positive.");
+}
+
+template <class ValT>
+void QuantileAccumulator<ValT>::operator()( ValT const& value ) {
+  m_count++;
+  if ( double(value) < m_min ) m_min = value;
+  if ( double(value) > m_max ) m_max = value;
+  if ( m_centroids.empty() && m_count <= m_exact_limit ) {
+    m_values.push_back( value );
+    return;
+  }
+  if ( !m_values.empty() )
+    switch_to_digest();
+  add_centroid( value, 1 );
+}
+
+template <class ValT>
+void QuantileAccumulator<ValT>::merge( QuantileAccumulator const& other ) {
+  if ( other.m_count == 0 )
+    return;
+  m_count += other.m_count;
+  m_min = std::min( m_min, other.m_min );
+  m_max = std::max( m_max, other.m_max );
+  if ( m_centroids.empty() && other.m_centroids.empty() && m_count <= m_exact_limit ) {
+    m_values.insert( m_values.end(), other.m_values.begin(), other.m_values.end() );
+    return;
+  }
+  if ( !m_values.empty() )
+    switch_to_digest();
+  for ( size_t i = 0; i < other.m_values.size(); i++ )
+    add_centroid( other.m_values[i], 1 );
+  for ( size_t i = 0; i < other.m_centroids.size(); i++ )
+    add_centroid( other.m_centroids[i].mean, other.m_centroids[i].weight );
+}
+
+template <class ValT>
+void QuantileAccumulator<ValT>::add_centroid( double mean, double weight ) {
+  m_centroids.push_back( Centroid( mean, weight ) );
+  m_num_unmerged++;
+  if ( m_num_unmerged > 5 * m_compression )
+    compress();
+}
+
+template <class ValT>
+void QuantileAccumulator<ValT>::switch_to_digest() const {
+  for ( size_t i = 0; i < m_values.size(); i++ )
+    m_centroids.push_back( Centroid( m_values[i], 1 ) );
+  m_num_unmerged += m_values.size();
+  std::vector<ValT>().swap( m_values );
+  compress();
+}
+
+// Merges neighboring centroids as long as the merged centroid stays
+// within one unit of the scale function k(q) = c/(2 pi) asin(2q-1).
+template <class ValT>
+void QuantileAccumulator<ValT>::compress() const {
+  if ( m_num_unmerged == 0 )
+    return;
+  std::sort( m_centroids.begin(), m_centroids.end() );
+
+  double total = 0;
+  for ( size_t i = 0; i < m_centroids.size(); i++ )
+    total += m_centroids[i].weight;
+
+  const double scale = double(m_compression) / (2*M_PI);
+  std::vector<Centroid> result;
+  result.reserve( 2*m_compression );
+  Centroid current = m_centroids[0];
+  double weight_before = 0;
+  double q_limit = ( sin( ( scale*asin(-1.0) + 1 ) / scale ) + 1 ) / 2;
+  for ( size_t i = 1; i < m_centroids.size(); i++ ) {
+    Centroid const& next = m_centroids[i];
+    if ( ( weight_before + current.weight + next.weight ) / total <= q_limit ) {
+      current.mean += ( next.mean - current.mean ) * next.weight / ( current.weight + next.weight );
+      current.weight += next.weight;
+    } else {
+      result.push_back( current );
+      weight_before += current.weight;
+      double k = scale * asin( 2 * std::min( weight_before / total, 1.0 ) - 1 ) + 1;
+      q_limit = k >= scale * M_PI / 2 ? 1.0 : ( sin( k / scale ) + 1 ) / 2;
+      current = next;
+    }
+  }
+  result.push_back( current );
+  m_centroids.swap( result );
+  m_num_unmerged = 0;
+}
+
+template <class ValT>
+ValT QuantileAccumulator<ValT>::median() const {
+  VW_ASSERT(m_count, ArgumentErr() << "QuantileAccumulator: no valid samples.");
+  if ( !is_exact() )
+    return quantile( 0.5 );
+  // Same as destructive_median(), without copying the values
+  size_t len = m_values.size();
+  typename std::vector<ValT>::iterator middle = m_values.begin() + len/2;
+  std::nth_element( m_values.begin(), middle, m_values.end() );
+  if ( len % 2 )
+    return *middle;
+  ValT below = *std::max_element( m_values.begin(), middle );
+  return ( below + *middle ) / 2;
+}
+
+template <class ValT>
+ValT QuantileAccumulator<ValT>::quantile( double q ) const {
+  VW_ASSERT(m_count, ArgumentErr() << "QuantileAccumulator: no valid samples.");
+  VW_ASSERT(q >= 0 && q <= 1, ArgumentErr() << "QuantileAccumulator: quantile must be between 0 and 1.");
+
+  double result;
+  if ( is_exact() ) {
+    double position = q * ( m_values.size() - 1 );
+    size_t index = size_t( position );
+    typename std::vector<ValT>::iterator lower = m_values.begin() + index;
+    std::nth_element( m_values.begin(), lower, m_values.end() );
+    result = *lower;
+    if ( index + 1 < m_values.size() && position > index )
+      result += ( position - index ) *
+        ( double(*std::min_element( lower + 1, m_values.end() )) - result );
+  } else {
+    compress();
+    double total = m_count, target = q * total;
+    Centroid const& first = m_centroids.front();
+    Centroid const& last  = m_centroids.back();
+    if ( target <= first.weight / 2 ) {
+      result = m_min + ( first.mean - m_min ) * ( first.weight > 1 ? target / ( first.weight / 2 ) : 1 );
+    } else if ( target >= total - last.weight / 2 ) {
+      double tail = total - target;
+      result = m_max - ( m_max - last.mean ) * ( last.weight > 1 ? tail / ( last.weight / 2 ) : 1 );
+    } else {
+      double center = first.weight / 2;
+      result = last.mean;
+      for ( size_t i = 0; i + 1 < m_centroids.size(); i++ ) {
+        double next_center = center + ( m_centroids[i].weight + m_centroids[i+1].weight ) / 2;
+        if ( target <= next_center ) {
+          result = m_centroids[i].mean + ( m_centroids[i+1].mean - m_centroids[i].mean ) *
+            ( target - center ) / ( next_center - center );
+          break;
+        }
+        center = next_center;
+      }
+    }
+  }
+  if ( std::numeric_limits<ValT>::is_integer )
+    result = round( result );
+  return ValT( result );
+}
+
+
+//--------------------------------------------------------------------------
+// Class StreamingHistogram
+
+inline
+StreamingHistogram::StreamingHistogram( size_t fine_bins, size_t raw_limit )
+  : m_mode(RawMode), m_fine_bins(fine_bins + fine_bins % 2), m_raw_limit(raw_limit),
+    m_min(std::numeric_limits<double>::max()), m_max(-std::numeric_limits<double>::max()),
+    m_total(0), m_bin_start(0), m_bin_width(0) {}
+
+inline
+void StreamingHistogram::add( double value, double count ) {
+  if ( value != value ) // NaN
+    return;
+  if ( value < m_min ) m_min = value;
+  if ( value > m_max ) m_max = value;
+  m_total += count;
+
+  if ( m_mode == RawMode ) {
+    if ( count == 1 && m_raw.size() < m_raw_limit ) {
+      m_raw.push_back( value );
+      return;
+    }
+    switch_to_counts();
+  }
+  if ( m_mode == CountMode ) {
+    if ( value == floor(value) && value >= -COUNT_OFFSET && value < COUNT_SIZE - COUNT_OFFSET ) {
+      m_counts[ int(value) + COUNT_OFFSET ] += count;
+      return;
+    }
+    switch_to_bins();
+  }
+  add_to_bins( value, count );
+}
+
+inline
+void StreamingHistogram::merge( StreamingHistogram const& other ) {
+  for ( size_t i = 0; i < other.m_raw.size(); i++ )
+    add( other.m_raw[i], 1.0 );
+  if ( other.m_mode == CountMode ) {
+    for ( int i = 0; i < COUNT_SIZE; i++ )
+      if ( other.m_counts[i] != 0 )
+        add( i - COUNT_OFFSET, other.m_counts[i] );
+  } else if ( other.m_mode == BinMode ) {
+    for ( size_t i = 0; i < other.m_fine_bins; i++ )
+      if ( other.m_counts[i] != 0 ) {
+        double center = other.m_bin_start + ( i + 0.5 ) * other.m_bin_width;
+        add( std::min( std::max( center, other.m_min ), other.m_max ), other.m_counts[i] );
+      }
+  }
+  // Bin centers don't carry the exact extremes
+  if ( other.m_total > 0 ) {
+    m_min = std::min( m_min, other.m_min );
+    m_max = std::max( m_max, other.m_max );
+  }
+}
+
+inline
+void StreamingHistogram::switch_to_counts() {
+  std::vector<double> raw;
+  raw.swap( m_raw );
+  m_mode = CountMode;
+  m_counts.assign( COUNT_SIZE, 0 );
+  for ( size_t i = 0; i < raw.size(); i++ ) {
+    double value = raw[i];
+    if ( m_mode == CountMode && value == floor(value) &&
+         value >= -COUNT_OFFSET && value < COUNT_SIZE - COUNT_OFFSET ) {
+      m_counts[ int(value) + COUNT_OFFSET ] += 1;
+      continue;
+    }
+    if ( m_mode == CountMode )
+      switch_to_bins();
+    add_to_bins( value, 1 );
+  }
+}
+
+inline
+void StreamingHistogram::switch_to_bins() {
+  std::vector<double> counts( m_fine_bins, 0 );
+  counts.swap( m_counts );
+  m_mode = BinMode;
+  // Starting with the range seen so far
+  m_bin_start = m_min;
+  m_bin_width = ( m_max > m_min ? ( m_max - m_min ) * ( 1 + 1e-9 ) : 1.0 ) / m_fine_bins;
+  for ( int i = 0; i < int(counts.size()); i++ )
+    if ( counts[i] != 0 )
+      add_to_bins( i - COUNT_OFFSET, counts[i] );
+}
+
+inline
+void StreamingHistogram::add_to_bins( double value, double count ) {
+  // Doubling the range until the value fits. The old bins are merged
+  // in pairs into one half of the new range.
+  while ( value < m_bin_start || value >= m_bin_start + m_fine_bins * m_bin_width ) {
+    bool grow_down = value < m_bin_start;
+    size_t half = m_fine_bins / 2;
+    std::vector<double> counts( m_fine_bins, 0 );
+    for ( size_t i = 0; i < m_fine_bins; i++ )
+      counts[ ( grow_down ? half : 0 ) + i/2 ] += m_counts[i];
+    m_counts.swap( counts );
+    if ( grow_down )
+      m_bin_start -= m_fine_bins * m_bin_width;
+    m_bin_width *= 2;
+  }
+  size_t bin = size_t( ( value - m_bin_start ) / m_bin_width );
+  if ( bin >= m_fine_bins )
+    bin = m_fine_bins - 1;
+  m_counts[bin] += count;
+}
+
+inline
+void StreamingHistogram::fill( size_t num_bins, Histogram& hist ) const {
+  double min_val = m_min, max_val = m_max;
+  if ( m_total == 0 ) {
+    // Same as a two pass build over no valid values
+    min_val = std::numeric_limits<double>::max();
+    max_val = -std::numeric_limits<double>::max();
+  }
+  if ( max_val == min_val )
+    max_val = min_val + 1.0;
+  hist.initialize( num_bins, min_val, max_val );
+
+  for ( size_t i = 0; i < m_raw.size(); i++ )
+    hist.add_value_no_check( m_raw[i] );
+  if ( m_mode == CountMode ) {
+    for ( int i = 0; i < COUNT_SIZE; i++ )
+      if ( m_counts[i] != 0 )
+        hist.add_value_no_check( i - COUNT_OFFSET, size_t( m_counts[i] ) );
+  } else if ( m_mode == BinMode ) {
+    for ( size_t i = 0; i < m_fine_bins; i++ )
+      if ( m_counts[i] != 0 ) {
+        double center = m_bin_start + ( i + 0.5 ) * m_bin_width;
+        hist.add_value_no_check( std::min( std::max( center, m_min ), m_max ),
+                                 size_t( m_counts[i] ) );
+      }
+  }
+}
@@ -19,7 +19,9 @@
 // TestConjugateGradient.h
 #include <gtest/gtest_VW.h>
 #include <vw/Math/Vector.h>
+#include <vw/Math/Matrix.h>
 #include <vw/Math/ConjugateGradient.h>
+#include <test/Helpers.h>
 
 using namespace vw;
 using namespace vw::math;
@@ -62,3 +64,22 @@ TEST( ConjugateGradient, ConjugateGradient ) {
   EXPECT_NEAR(result[0], 0.1962, 1e-3);
   EXPECT_NEAR(result[1], 0.4846, 1e-3);
 }
+
+TEST( ConjugateGradient, PreconditionedLinear ) {
+  // Symmetric positive definite tridiagonal system
+  const size_t n = 50;
+  Matrix<double> A(n,n);
+  Vector<double> b(n), zero(n);
+  for ( size_t i = 0; i < n; i++ ) {
+    A(i,i) = 4 + double(i)/n;
+    if ( i > 0 )
+      A(i,i-1) = A(i-1,i) = -1;
+    b[i] = sin(double(i));
+  }
+
+  int iterations = 0;
+  Vector<double> x = preconditioned_conjugate_gradient( A, b, zero, IdentityPreconditioner(),
+                                                        100, 1e-12, &iterations );
+  EXPECT_VECTOR_NEAR( A*x, b, 1e-10 );
+  EXPECT_LE( iterations, int(n) );
+}
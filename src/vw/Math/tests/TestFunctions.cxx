@@ -18,6 +18,7 @@
 #include <test/Helpers.h>
 #include <gtest/gtest_VW.h>
 #include <vw/Math/Functions.h>
+#include <vw/Math/BatchFunctions.h>
 
 // This is tested here to consolidate otherwise tiny files
 #include <vw/Math/BresenhamLine.h>
@@ -54,6 +55,48 @@ TEST(Functions, ERFC) {
   EXPECT_NEAR( 0.00002209049699858544, vw::math::impl::erfc(3.0)   , DELTA);
 }
 
+TEST(Functions, BatchSinCos) {
+  std::vector<double> x;
+  for ( int i = -5000; i <= 5000; i++ )
+    x.push_back( i * 0.0137 );
+  x.push_back( -0.0 );
+  x.push_back( M_PI / 2 );
+  x.push_back( 1e6 ); // Past the fast path
+  x.push_back( std::numeric_limits<double>::quiet_NaN() );
+  std::vector<double> s(x.size()), c(x.size());
+  vw::math::batch_sincos( &x[0], &s[0], &c[0], x.size() );
+  for ( size_t i = 0; i + 1 < x.size(); i++ ) {
+    EXPECT_NEAR( std::sin(x[i]), s[i], DELTA );
+    EXPECT_NEAR( std::cos(x[i]), c[i], DELTA );
+  }
+  EXPECT_TRUE( std::isnan(s.back()) );
+  EXPECT_TRUE( std::isnan(c.back()) );
+}
+
+TEST(Functions, BatchAtan2) {
+  std::vector<double> y, x;
+  for ( int i = -40; i <= 40; i++ )
+    for ( int j = -40; j <= 40; j++ ) {
+      y.push_back( i * std::pow(1.7, std::abs(j) % 9) );
+      x.push_back( j * 0.3 );
+    }
+  const double special[][2] = { {0,-0.0}, {-0.0,-0.0}, {-0.0,1}, {1e-300,-1},
+                                {1,std::numeric_limits<double>::infinity()},
+                                {1e-310,1e-310}, {-3e-320,1e-310}, {1e-310,-5e-324},
+                                {1e-310,2e-308}, {2e-308,-1e-310} };
+  for ( size_t i = 0; i < sizeof(special)/sizeof(special[0]); i++ ) {
+    y.push_back( special[i][0] );
+    x.push_back( special[i][1] );
+  }
+  std::vector<double> a(x.size());
+  vw::math::batch_atan2( &y[0], &x[0], &a[0], x.size() );
+  for ( size_t i = 0; i < x.size(); i++ ) {
+    double expected = std::atan2(y[i], x[i]);
+    EXPECT_NEAR( expected, a[i], 2 * DELTA );
+    EXPECT_EQ( std::signbit(expected), std::signbit(a[i]) );
+  }
+}
+
 TEST(BresenhamLine, BresenhamLine) {
 
   vw::math::BresenhamLine lineA(0,0,  5,10);
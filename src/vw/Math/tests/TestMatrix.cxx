@@ -18,6 +18,8 @@
 
 // TestMatrix.h
 #include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+#include <vw/Core/Stopwatch.h>
 #include <vw/Math/Matrix.h>
 
 using namespace vw;
@@ -410,6 +412,102 @@ TEST(Matrix, Products) {
   EXPECT_EQ( 742, r8(1,1) );
 }
 
+// Reference product for checking the blocked and BLAS paths.
+template <class T1, class T2>
+Matrix<double> naive_product( Matrix<T1> const& a, Matrix<T2> const& b ) {
+  Matrix<double> c( a.rows(), b.cols() );
+  for ( size_t i = 0; i < a.rows(); ++i )
+    for ( size_t j = 0; j < b.cols(); ++j )
+      for ( size_t p = 0; p < a.cols(); ++p )
+        c(i,j) += double(a(i,p)) * double(b(p,j));
+  return c;
+}
+
+TEST(Matrix, LargeProducts) {
+  // Odd sizes exercise the partial tiles at every block edge.
+  Matrix<double> a( 131, 267 ), b( 267, 75 );
+  Matrix<int>    ai( 70, 301 ),  bi( 301, 45 );
+  Matrix<float>  af( 37, 29 );
+  for ( size_t i = 0; i < a.rows(); ++i )
+    for ( size_t j = 0; j < a.cols(); ++j )
+      a(i,j) = double((i*7 + j*3) % 17) - 8.5;
+  for ( size_t i = 0; i < b.rows(); ++i )
+    for ( size_t j = 0; j < b.cols(); ++j )
+      b(i,j) = double((i*5 + j*11) % 13) * 0.25;
+  for ( size_t i = 0; i < ai.rows(); ++i )
+    for ( size_t j = 0; j < ai.cols(); ++j )
+      ai(i,j) = int((i + 2*j) % 9) - 4;
+  for ( size_t i = 0; i < bi.rows(); ++i )
+    for ( size_t j = 0; j < bi.cols(); ++j )
+      bi(i,j) = int((3*i + j) % 7) - 3;
+  for ( size_t i = 0; i < af.rows(); ++i )
+    for ( size_t j = 0; j < af.cols(); ++j )
+      af(i,j) = float(i) - float(j) * 0.5f;
+
+  Matrix<double> c = a*b;
+  EXPECT_MATRIX_NEAR( naive_product(a,b), c, 1e-9 );
+
+  Matrix<double> d;
+  d = a*b;
+  EXPECT_MATRIX_NEAR( naive_product(a,b), d, 1e-9 );
+
+  // Integer products are exact.
+  Matrix<int> ci = ai*bi;
+  EXPECT_MATRIX_EQ( naive_product(ai,bi), ci );
+
+  // Mixed element types and conversion on assignment.
+  Matrix<double> cf = af*submatrix(b,0,0,29,40);
+  EXPECT_MATRIX_NEAR( naive_product(af,Matrix<double>(submatrix(b,0,0,29,40))), cf, 1e-4 );
+  Matrix<float> cff = a*b;
+  EXPECT_MATRIX_NEAR( naive_product(a,b), cff, 1e-3 );
+
+  // Transposed operands.
+  Matrix<double> at = transpose(a);
+  Matrix<double> ct = math::MatrixMatrixProduct<Matrix<double>,Matrix<double>,true,false>( at, b );
+  EXPECT_MATRIX_NEAR( c, ct, 1e-9 );
+  Matrix<double> bt = transpose(b);
+  Matrix<double> ctt = math::MatrixMatrixProduct<Matrix<double>,Matrix<double>,true,true>( at, bt );
+  EXPECT_MATRIX_NEAR( c, ctt, 1e-9 );
+
+  // Chained products and degenerate shapes.
+  Matrix<double> chain = transpose(b)*transpose(a)*a;
+  EXPECT_MATRIX_NEAR( naive_product(Matrix<double>(transpose(c)),a), chain, 1e-6 );
+  Matrix<double> empty = Matrix<double>(0,40)*Matrix<double>(40,300);
+  EXPECT_EQ( 0u, empty.rows() );
+  EXPECT_EQ( 300u, empty.cols() );
+}
+
+// Run with --gtest_also_run_disabled_tests to compare the per-element
+// product against the blocked/BLAS evaluation.
+TEST(Matrix, DISABLED_ProductBenchmark) {
+  const size_t sizes[] = { 3, 8, 16, 32, 64, 128, 256, 512, 1000, 2000 };
+  for ( size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); ++s ) {
+    size_t n = sizes[s];
+    Matrix<double> a( n, n ), b( n, n ), c( n, n );
+    for ( size_t i = 0; i < n; ++i )
+      for ( size_t j = 0; j < n; ++j ) {
+        a(i,j) = double(i+j) / n;
+        b(i,j) = double(i) - double(j);
+      }
+    size_t repeat = (std::max)( size_t(1), size_t(20000000) / (n*n*n) );
+    repeat = (std::min)( repeat, size_t(10000) );
+
+    Stopwatch elementwise, blocked;
+    elementwise.start();
+    for ( size_t r = 0; r < repeat && n <= 512; ++r )
+      c = no_tmp( a*b );
+    elementwise.stop();
+    blocked.start();
+    for ( size_t r = 0; r < repeat; ++r )
+      c = a*b;
+    blocked.stop();
+
+    std::cout << n << "x" << n << ": per-element "
+              << (n <= 512 ? elementwise.elapsed_seconds() / repeat : 0.0)
+              << " s, blocked " << blocked.elapsed_seconds() / repeat << " s\n";
+  }
+}
+
 TEST(Matrix, Transpose) {
   Matrix2x2f m(1,2,3,4);
   Matrix<float> r = transpose(m);
@@ -0,0 +1,145 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <test/Helpers.h>
+#include <vw/Math/Vector.h>
+#include <vw/Math/Matrix.h>
+#include <vw/Math/Geometry.h>
+#include <vw/Math/RANSAC.h>
+
+using namespace vw;
+using namespace vw::math;
+
+// Fits a translation to three points and remembers the first points it
+// was given, or fails if asked to.
+struct RecordingFittingFunctor {
+  typedef Matrix<double,3,3> result_type;
+  mutable std::vector<int> first_sample;
+  bool fail;
+
+  RecordingFittingFunctor(bool fail = false) : fail(fail) {}
+
+  template <class ContainerT>
+  size_t min_elements_needed_for_fit(ContainerT const& /*example*/) const { return 3; }
+
+  template <class ContainerT>
+  Matrix<double> operator()(std::vector<ContainerT> const& p1,
+                            std::vector<ContainerT> const& p2,
+                            Matrix<double> const& seed = Matrix<double>()) const {
+    if (fail)
+      vw_throw(ArgumentErr() << "Fitting failed.");
+    if (first_sample.empty())
+      for (size_t i = 0; i < p1.size(); i++)
+        first_sample.push_back(int(p1[i][0] + 20 * p1[i][1]));
+    return TranslationFittingFunctor()(p1, p2, seed);
+  }
+};
+
+class RANSACTest : public ::testing::Test {
+protected:
+  // 200 points shifted by (5,-3), of which every fourth one is an outlier.
+  virtual void SetUp() {
+    for (int i = 0; i < 200; i++) {
+      Vector3 p(i % 20, i / 20, 1);
+      Vector3 q = p + Vector3(5, -3, 0);
+      if (i % 4 == 0)
+        q += Vector3(40 + i, 17, 0);
+      p1.push_back(p);
+      p2.push_back(q);
+    }
+  }
+
+  template <class RansacT>
+  void check_fit(RansacT const& ransac, Matrix<double> const& H) {
+    EXPECT_NEAR(H(0,2),  5, 1e-8);
+    EXPECT_NEAR(H(1,2), -3, 1e-8);
+    EXPECT_EQ(150u, ransac.inlier_indices(H, p1, p2).size());
+  }
+
+  std::vector<Vector3> p1, p2;
+};
+
+TEST_F(RANSACTest, Serial) {
+  RandomSampleConsensus<TranslationFittingFunctor, InterestPointErrorMetric>
+    ransac(TranslationFittingFunctor(), InterestPointErrorMetric(), 100, 0.5, 100);
+  Matrix<double> H = ransac(p1, p2);
+  check_fit(ransac, H);
+}
+
+TEST_F(RANSACTest, Threaded) {
+  RandomSampleConsensus<TranslationFittingFunctor, InterestPointErrorMetric>
+    ransac(TranslationFittingFunctor(), InterestPointErrorMetric(), 100, 0.5, 100);
+  ransac.set_num_threads(4);
+  Matrix<double> H = ransac(p1, p2);
+  check_fit(ransac, H);
+}
+
+TEST_F(RANSACTest, AdaptivePreemptive) {
+  RandomSampleConsensus<TranslationFittingFunctor, InterestPointErrorMetric>
+    ransac(TranslationFittingFunctor(), InterestPointErrorMetric(), 1000, 0.5, 100);
+  ransac.set_num_threads(3);
+  ransac.set_confidence(0.999);
+  ransac.set_preemptive_subset_size(20);
+  Matrix<double> H = ransac(p1, p2);
+  check_fit(ransac, H);
+}
+
+TEST_F(RANSACTest, NoFit) {
+  // Asking for more inliers than exist must fail on every thread.
+  RandomSampleConsensus<TranslationFittingFunctor, InterestPointErrorMetric>
+    ransac(TranslationFittingFunctor(), InterestPointErrorMetric(), 50, 0.5, 180);
+  ransac.set_num_threads(4);
+  EXPECT_THROW(ransac(p1, p2), RANSACErr);
+}
+
+TEST_F(RANSACTest, SerialDrawsFromStdRand) {
+  // One thread draws its samples from std::rand() the way RANSAC always
+  // has, so serial results don't change.
+  std::vector<Vector3> q(p1);
+  for (size_t i = 0; i < q.size(); i++)
+    q[i] += Vector3(5, -3, 0);
+  RecordingFittingFunctor fitting;
+  RandomSampleConsensus<RecordingFittingFunctor, InterestPointErrorMetric>
+    ransac(fitting, InterestPointErrorMetric(), 1, 0.5, 3);
+  std::srand(7);
+  ransac.attempt_ransac(p1, q);
+
+  std::srand(7);
+  std::vector<int> expected;
+  const double divisor = static_cast<double>(RAND_MAX) + 1.0;
+  while (expected.size() < 3) {
+    int sample = static_cast<int>((static_cast<double>(std::rand()) / divisor) * p1.size());
+    if (std::find(expected.begin(), expected.end(), sample) == expected.end())
+      expected.push_back(sample);
+  }
+  EXPECT_EQ(expected, fitting.first_sample);
+}
+
+TEST_F(RANSACTest, FittingErrors) {
+  // Errors thrown by the functors keep their type, with or without
+  // threads.
+  RecordingFittingFunctor fitting(true);
+  RandomSampleConsensus<RecordingFittingFunctor, InterestPointErrorMetric>
+    ransac(fitting, InterestPointErrorMetric(), 100, 0.5, 100);
+  EXPECT_THROW(ransac.attempt_ransac(p1, p2), ArgumentErr);
+  ransac.set_num_threads(4);
+  EXPECT_THROW(ransac.attempt_ransac(p1, p2), ArgumentErr);
+}
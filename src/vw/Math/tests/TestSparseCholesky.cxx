@@ -0,0 +1,152 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+// TestSparseCholesky.h
+#include <gtest/gtest_VW.h>
+#include <vw/Math/Vector.h>
+#include <vw/Math/Matrix.h>
+#include <vw/Math/SparseCholesky.h>
+#include <vw/Math/ConjugateGradient.h>
+#include <test/Helpers.h>
+
+#include <algorithm>
+
+using namespace vw;
+using namespace vw::math;
+
+// Builds a block matrix with the pattern of a width x height grid
+// graph. Every block is filled with small values and the diagonal is
+// made dominant so that the result is positive definite.
+static BlockSparseSymmetricMatrix grid_matrix( size_t width, size_t height,
+                                               size_t block_size ) {
+  BlockSparseSymmetricMatrix A( width * height, block_size );
+  srand(42);
+  for ( size_t j = 0; j < width * height; j++ ) {
+    Matrix<double>& diag = A.block(j,j);
+    for ( size_t r = 0; r < block_size; r++ )
+      for ( size_t c = 0; c <= r; c++ )
+        diag(r,c) = diag(c,r) = double(rand()) / RAND_MAX - 0.5;
+    for ( size_t r = 0; r < block_size; r++ )
+      diag(r,r) += 4.0 * block_size + 4.0;
+
+    size_t x = j % width, y = j / width;
+    if ( x + 1 < width ) {
+      Matrix<double>& b = A.block(j+1,j);
+      for ( size_t k = 0; k < b.rows()*b.cols(); k++ )
+        b.data()[k] = double(rand()) / RAND_MAX - 0.5;
+    }
+    if ( y + 1 < height ) {
+      Matrix<double>& b = A.block(j+width,j);
+      for ( size_t k = 0; k < b.rows()*b.cols(); k++ )
+        b.data()[k] = double(rand()) / RAND_MAX - 0.5;
+    }
+  }
+  return A;
+}
+
+static Vector<double> test_vector( size_t size ) {
+  Vector<double> b( size );
+  for ( size_t i = 0; i < size; i++ )
+    b[i] = sin( double(i) ) + 0.5;
+  return b;
+}
+
+TEST(SparseCholesky, Multiply) {
+  BlockSparseSymmetricMatrix A( 2, 2 );
+  A.block(0,0) = Matrix2x2( 4, 1, 1, 3 );
+  A.block(1,1) = Matrix2x2( 5, 0, 0, 6 );
+  A.block(1,0) = Matrix2x2( 1, 2, 3, 4 );
+  EXPECT_EQ( 3u, A.num_nonzero_blocks() );
+
+  Matrix<double> dense(4,4);
+  submatrix(dense,0,0,2,2) = A.block(0,0);
+  submatrix(dense,2,2,2,2) = A.block(1,1);
+  submatrix(dense,2,0,2,2) = A.block(1,0);
+  submatrix(dense,0,2,2,2) = transpose(A.block(1,0));
+
+  Vector<double> x = test_vector(4);
+  EXPECT_VECTOR_NEAR( dense*x, A*x, 1e-12 );
+}
+
+TEST(SparseCholesky, NestedDissectionOrdering) {
+  BlockSparseSymmetricMatrix A = grid_matrix( 12, 9, 1 );
+  std::vector<size_t> ordering = nested_dissection_ordering( A, 4 );
+  ASSERT_EQ( A.num_blocks(), ordering.size() );
+  std::sort( ordering.begin(), ordering.end() );
+  for ( size_t i = 0; i < ordering.size(); i++ )
+    EXPECT_EQ( i, ordering[i] );
+}
+
+TEST(SparseCholesky, Solve) {
+  BlockSparseSymmetricMatrix A = grid_matrix( 10, 7, 3 );
+  Vector<double> b = test_vector( A.rows() );
+
+  SupernodalCholesky cholesky;
+  cholesky.factor( A );
+  ASSERT_TRUE( cholesky.factored() );
+  EXPECT_LE( cholesky.num_supernodes(), A.num_blocks() );
+  Vector<double> x = cholesky.solve( b );
+  EXPECT_VECTOR_NEAR( A*x, b, 1e-10 );
+
+  // The analysis is reused when the values change
+  BlockSparseSymmetricMatrix A2 = A;
+  for ( size_t j = 0; j < A2.num_blocks(); j++ )
+    A2.block(j,j) *= 2.0;
+  cholesky.factor( A2 );
+  x = cholesky.solve( b );
+  EXPECT_VECTOR_NEAR( A2*x, b, 1e-10 );
+}
+
+TEST(SparseCholesky, DisconnectedBlocks) {
+  // Two independent grids, plus a camera that sees nothing else
+  BlockSparseSymmetricMatrix grid = grid_matrix( 5, 5, 2 );
+  BlockSparseSymmetricMatrix A( 2*grid.num_blocks() + 1, 2 );
+  for ( size_t j = 0; j < grid.num_blocks(); j++ ) {
+    typedef BlockSparseSymmetricMatrix::column_type::const_iterator iter;
+    for ( iter it = grid.column(j).begin(); it != grid.column(j).end(); ++it ) {
+      A.block( it->first, j ) = it->second;
+      A.block( it->first + grid.num_blocks(), j + grid.num_blocks() ) = it->second;
+    }
+  }
+  A.block( A.num_blocks()-1, A.num_blocks()-1 ) = Matrix2x2( 2, 0, 0, 3 );
+
+  SupernodalCholesky cholesky;
+  cholesky.factor( A );
+  Vector<double> b = test_vector( A.rows() );
+  EXPECT_VECTOR_NEAR( A*cholesky.solve( b ), b, 1e-10 );
+}
+
+TEST(SparseCholesky, NotPositiveDefinite) {
+  BlockSparseSymmetricMatrix A = grid_matrix( 4, 4, 2 );
+  A.block(5,5) = Matrix2x2( -1, 0, 0, 1 );
+  SupernodalCholesky cholesky;
+  EXPECT_THROW( cholesky.factor( A ), MathErr );
+  EXPECT_FALSE( cholesky.factored() );
+}
+
+TEST(SparseCholesky, BlockJacobiPCG) {
+  BlockSparseSymmetricMatrix A = grid_matrix( 10, 7, 3 );
+  Vector<double> b = test_vector( A.rows() );
+  Vector<double> x( A.rows() );
+  int iterations = 0;
+  x = preconditioned_conjugate_gradient( A, b, x, BlockJacobiPreconditioner( A ),
+                                         200, 1e-12, &iterations );
+  EXPECT_VECTOR_NEAR( A*x, b, 1e-9 );
+  EXPECT_GT( iterations, 0 );
+  EXPECT_LT( iterations, 200 );
+}
@@ -165,3 +165,100 @@ TEST(Statistics, CDF_Merge ) {
   cdf0.duplicate(cdf2);
   EXPECT_NEAR( cdf2.median(), cdf0.median(), 0.01 );
 }
+
+TEST(Statistics, QuantileExact) {
+  QuantileAccumulator<int> quant;
+  for ( int i = 10; i > 0; i-- )
+    quant( i );
+  EXPECT_TRUE( quant.is_exact() );
+  EXPECT_EQ( 10u, quant.size() );
+  EXPECT_EQ( 5, quant.median() ); // (5+6)/2 in integer math
+  EXPECT_EQ( 1, quant.quantile(0) );
+  EXPECT_EQ( 10, quant.quantile(1) );
+
+  QuantileAccumulator<double> dquant;
+  dquant( 1 ); dquant( 4 ); dquant( 2 ); dquant( 3 );
+  EXPECT_NEAR( 2.5, dquant.median(), DELTA );
+  EXPECT_NEAR( 1.75, dquant.quantile(0.25), DELTA );
+}
+
+TEST(Statistics, QuantileDigest) {
+  boost::mt19937 random_gen(42);
+  boost::normal_distribution<double> norm(5, 3);
+  boost::variate_generator<boost::mt19937&, boost::normal_distribution<double> > generator( random_gen, norm );
+
+  // Small exact limit so that the partials turn into digests
+  QuantileAccumulator<double> quant1( 200, 1000 ), quant2( 200, 1000 );
+  std::vector<double> samples;
+  for ( size_t i = 0; i < 100000; i++ ) {
+    double sample = generator();
+    samples.push_back( sample );
+    if ( i % 2 )
+      quant1( sample );
+    else
+      quant2( sample );
+  }
+  quant1.merge( quant2 );
+  EXPECT_FALSE( quant1.is_exact() );
+  EXPECT_EQ( samples.size(), quant1.size() );
+
+  std::sort( samples.begin(), samples.end() );
+  const double qs[] = { 0.001, 0.1, 0.25, 0.5, 0.75, 0.9, 0.999 };
+  for ( size_t i = 0; i < sizeof(qs)/sizeof(qs[0]); i++ ) {
+    // Compare ranks, the values are sparse in the tails
+    double value = quant1.quantile( qs[i] );
+    double rank = double( std::lower_bound( samples.begin(), samples.end(), value ) -
+                          samples.begin() ) / samples.size();
+    EXPECT_NEAR( qs[i], rank, 0.002 ) << "q = " << qs[i];
+  }
+  EXPECT_EQ( samples.front(), quant1.quantile(0) );
+  EXPECT_EQ( samples.back(),  quant1.quantile(1) );
+}
+
+TEST(Statistics, StreamingHistogram) {
+  // Integer data is counted exactly
+  StreamingHistogram stream( 1<<14, 10 );
+  std::vector<double> values;
+  for ( int i = 0; i < 1000; i++ )
+    values.push_back( (i * 37) % 200 - 50 );
+  StreamingHistogram half( 1<<14, 10 );
+  for ( size_t i = 0; i < values.size(); i++ )
+    ( i < 500 ? stream : half )( values[i] );
+  stream.merge( half );
+  EXPECT_EQ( -50, stream.min_value() );
+  EXPECT_EQ( 149, stream.max_value() );
+
+  Histogram hist, expected( 20, -50, 149 );
+  stream.fill( 20, hist );
+  for ( size_t i = 0; i < values.size(); i++ )
+    expected.add_value_no_check( values[i] );
+  EXPECT_EQ( expected.get_total_num_values(), hist.get_total_num_values() );
+  for ( size_t i = 0; i < 20; i++ )
+    EXPECT_EQ( expected.get_bin_value(i), hist.get_bin_value(i) );
+
+  // Floating point data over a growing range
+  StreamingHistogram fstream( 1<<14, 10 );
+  Histogram fexpected( 10, 0, 999.5 );
+  for ( int i = 0; i < 2000; i++ ) {
+    fstream( i * 0.5 );
+    fexpected.add_value_no_check( i * 0.5 );
+  }
+  fstream( std::numeric_limits<double>::quiet_NaN() );
+  EXPECT_EQ( 2000u, fstream.size() );
+  fstream.fill( 10, hist );
+  EXPECT_NEAR( 49.975,  hist.get_bin_center(0), DELTA );
+  EXPECT_NEAR( 949.525, hist.get_bin_center(9), DELTA );
+  for ( size_t i = 0; i < 10; i++ )
+    EXPECT_NEAR( fexpected.get_bin_value(i), hist.get_bin_value(i), 2 );
+}
+
+TEST(Statistics, HistogramMerge) {
+  Histogram hist1( 4, 0, 3 ), hist2( 4, 0, 3 ), hist3( 5, 0, 3 );
+  hist1( 0 ); hist1( 1 );
+  hist2( 1 ); hist2.add_value_no_check( 3, 4 );
+  hist1.merge( hist2 );
+  EXPECT_EQ( 7u, hist1.get_total_num_values() );
+  EXPECT_EQ( 2, hist1.get_bin_value(1) );
+  EXPECT_EQ( 4, hist1.get_bin_value(3) );
+  EXPECT_THROW( hist1.merge( hist3 ), ArgumentErr );
+}
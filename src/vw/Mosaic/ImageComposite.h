@@ -24,11 +24,15 @@
 #define __VW_MOSAIC_IMAGECOMPOSITE_H__
 
 #include <iostream>
+#include <exception>
 #include <vector>
 #include <list>
+#include <algorithm>
 
 #include <vw/Core/Cache.h>
 #include <vw/Core/ProgressCallback.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageViewRef.h>
 #include <vw/Image/ImageMath.h>
@@ -39,6 +43,9 @@
 #include <vw/Image/SparseImageCheck.h>
 #include <vw/FileIO/DiskImageResource.h>
 
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+
 namespace vw {
 namespace mosaic {
 
@@ -193,9 +200,10 @@ namespace mosaic {
         return m_composite.sources[m_index].size() / PixelNumChannels<pixel_type>::value;
       }
       boost::shared_ptr<value_type> generate() const {
-        ImageView<pixel_type> source = *m_composite.sources[m_index];
-        m_composite.sources[m_index].release();
-        m_composite.sources[m_index].deprioritize();
+        Cache::Handle<SourceGenerator> handle = m_composite.sources[m_index];
+        ImageView<pixel_type> source = *handle;
+        handle.release();
+        handle.deprioritize();
         return boost::shared_ptr<value_type>( new value_type( select_alpha_channel( source ) ) );
       }
     };
@@ -215,13 +223,155 @@ namespace mosaic {
 
     friend class PyramidGenerator;
 
+    /// A bucket grid over the source bounding boxes, so that finding
+    /// the sources near a patch doesn't mean looking at all of them.
+    class SourceIndex {
+      BBox2i m_bounds;
+      int32  m_cell_size, m_grid_cols, m_grid_rows;
+      std::vector<std::vector<uint32> > m_cells;
+
+      // The range of cells covering bbox, clamped to the grid
+      BBox2i cells( BBox2i const& bbox ) const {
+        Vector2i lo = elem_quot( bbox.min() - m_bounds.min(), m_cell_size );
+        Vector2i hi = elem_quot( bbox.max() - m_bounds.min() - Vector2i(1,1), m_cell_size );
+        return BBox2i( Vector2i( std::min( std::max( lo.x(), 0 ), m_grid_cols-1 ),
+                                 std::min( std::max( lo.y(), 0 ), m_grid_rows-1 ) ),
+                       Vector2i( std::min( std::max( hi.x(), lo.x() ), m_grid_cols-1 ) + 1,
+                                 std::min( std::max( hi.y(), lo.y() ), m_grid_rows-1 ) + 1 ) );
+      }
+
+    public:
+      SourceIndex() : m_cell_size(0), m_grid_cols(0), m_grid_rows(0) {}
+
+      void build( std::vector<BBox2i> const& bboxes ) {
+        m_cells.clear();
+        if( bboxes.empty() ) return;
+
+        // Cells about the size of a typical source, but no more of
+        // them than a few per source.
+        std::vector<int32> sizes;
+        m_bounds = bboxes[0];
+        for( size_t i=0; i<bboxes.size(); ++i ) {
+          m_bounds.grow( bboxes[i] );
+          sizes.push_back( std::max( bboxes[i].width(), bboxes[i].height() ) );
+        }
+        std::nth_element( sizes.begin(), sizes.begin() + sizes.size()/2, sizes.end() );
+        m_cell_size = std::max( sizes[sizes.size()/2], int32(32) );
+        for( ;; m_cell_size *= 2 ) {
+          m_grid_cols = ( m_bounds.width () + m_cell_size - 1 ) / m_cell_size + 1;
+          m_grid_rows = ( m_bounds.height() + m_cell_size - 1 ) / m_cell_size + 1;
+          if( int64(m_grid_cols) * m_grid_rows <= 4 * int64(bboxes.size()) + 64 ) break;
+        }
+
+        m_cells.resize( m_grid_cols * m_grid_rows );
+        for( size_t i=0; i<bboxes.size(); ++i ) {
+          BBox2i range = cells( bboxes[i] );
+          for( int32 y=range.min().y(); y<range.max().y(); ++y )
+            for( int32 x=range.min().x(); x<range.max().x(); ++x )
+              m_cells[y*m_grid_cols+x].push_back( uint32(i) );
+        }
+      }
+
+      void clear() { m_cells.clear(); }
+
+      /// Finds the sources whose bounding boxes intersect bbox, in
+      /// the order they were inserted. Until the index is built this
+      /// checks every source.
+      void find( std::vector<BBox2i> const& bboxes, BBox2i const& bbox, std::vector<uint32>& result ) const {
+        result.clear();
+        if( m_cells.empty() ) {
+          for( size_t i=0; i<bboxes.size(); ++i )
+            if( bbox.intersects( bboxes[i] ) ) result.push_back( uint32(i) );
+          return;
+        }
+        BBox2i range = cells( bbox );
+        for( int32 y=range.min().y(); y<range.max().y(); ++y )
+          for( int32 x=range.min().x(); x<range.max().x(); ++x ) {
+            std::vector<uint32> const& cell = m_cells[y*m_grid_cols+x];
+            for( size_t i=0; i<cell.size(); ++i )
+              if( bbox.intersects( bboxes[cell[i]] ) ) result.push_back( cell[i] );
+          }
+        std::sort( result.begin(), result.end() );
+        result.erase( std::unique( result.begin(), result.end() ), result.end() );
+      }
+    };
+
+    /// A source taking part in a blended patch, and the pyramid it
+    /// adds to it. The handle is attached when the pyramid is the
+    /// cached one.
+    struct PatchSource {
+      unsigned index;
+      boost::shared_ptr<Pyramid> pyramid;
+      Cache::Handle<PyramidGenerator> handle;
+      std::exception_ptr error;
+      PatchSource( unsigned index ) : index(index) {}
+    };
+
+    class PatchPyramidTask : public Task, private boost::noncopyable {
+      ImageComposite const& m_composite;
+      PatchSource& m_source;
+      BBox2i m_padded_bbox;
+    public:
+      PatchPyramidTask( ImageComposite const& composite, PatchSource& source, BBox2i const& padded_bbox )
+        : m_composite(composite), m_source(source), m_padded_bbox(padded_bbox) {}
+      void operator()() {
+        try {
+          m_composite.patch_pyramid( m_source, m_padded_bbox );
+        } catch ( ... ) {
+          m_source.error = std::current_exception();
+        }
+      }
+    };
+
+    class PatchLevelTask : public Task, private boost::noncopyable {
+      std::vector<PatchSource> const& m_batch;
+      int m_level;
+      BBox2i m_bbox;
+      ImageView<pixel_type> m_sum;
+      ImageView<channel_type> m_msum;
+      std::exception_ptr& m_error;
+    public:
+      PatchLevelTask( std::vector<PatchSource> const& batch, int level, BBox2i const& bbox,
+                      ImageView<pixel_type> const& sum, ImageView<channel_type> const& msum,
+                      std::exception_ptr& error )
+        : m_batch(batch), m_level(level), m_bbox(bbox), m_sum(sum), m_msum(msum), m_error(error) {}
+      void operator()() {
+        try {
+          add_level( m_batch, m_level, m_bbox, m_sum, m_msum );
+        } catch ( ... ) {
+          m_error = std::current_exception();
+        }
+      }
+    };
+
+    class PatchTask : public Task, private boost::noncopyable {
+      ImageComposite const& m_composite;
+      BBox2i m_bbox;
+      CropView<ImageView<pixel_type> > m_dest;
+      std::exception_ptr& m_error;
+    public:
+      PatchTask( ImageComposite const& composite, BBox2i const& bbox,
+                 CropView<ImageView<pixel_type> > const& dest, std::exception_ptr& error )
+        : m_composite(composite), m_bbox(bbox), m_dest(dest), m_error(error) {}
+      void operator()() {
+        try {
+          if( m_composite.m_draft_mode ) m_dest = m_composite.draft_patch( m_bbox );
+          else m_dest = m_composite.blend_patch( m_bbox, 1 );
+        } catch ( ... ) {
+          m_error = std::current_exception();
+        }
+      }
+    };
+
     std::vector<BBox2i > bboxes;
     BBox2i view_bbox, data_bbox;
     int    mindim, levels;
     bool   m_draft_mode;
     bool   m_fill_holes;
     bool   m_reuse_masks;
+    int32  m_num_threads;
     Cache& m_cache;
+    SourceIndex m_index;
     std::vector<ImageViewRef<pixel_type> >        sourcerefs;
     std::vector<Cache::Handle<SourceGenerator > > sources;
     std::vector<Cache::Handle<AlphaGenerator  > > alphas;
@@ -229,9 +379,23 @@ namespace mosaic {
 
     void generate_masks( ProgressCallback const& progress_callback ) const;
 
+    /// Builds the blending pyramid of one source over the given region
+    /// of it.
+    boost::shared_ptr<Pyramid> build_pyramid( unsigned index, ImageView<pixel_type> source, BBox2i const& region ) const;
+
+    /// Gets the pyramid a source adds to the patch whose sources lie
+    /// in padded_bbox. A source much larger than the patch gets a new
+    /// pyramid of just the part of it that reaches the patch, and the
+    /// rest use their cached full pyramids.
+    void patch_pyramid( PatchSource& source, BBox2i const& padded_bbox ) const;
+
+    /// Adds a level of each source pyramid in the batch to the sums.
+    static void add_level( std::vector<PatchSource> const& batch, int level, BBox2i const& bbox,
+                           ImageView<pixel_type> const& sum, ImageView<channel_type> const& msum );
+
     /// Generates a full-resolution patch of the mosaic corresponding
-    /// to the given bounding box.
-    ImageView<pixel_type> blend_patch( BBox2i const& patch_bbox ) const;
+    /// to the given bounding box, on up to num_threads threads.
+    ImageView<pixel_type> blend_patch( BBox2i const& patch_bbox, int32 num_threads ) const;
 
     // Generates a full-resolution patch of the mosaic corresponding
     // to the given bounding box WITHOUT blending.
@@ -241,7 +405,7 @@ namespace mosaic {
     typedef pixel_type result_type;
 
     ImageComposite() : m_draft_mode (false), m_fill_holes(false),
-                       m_reuse_masks(false), m_cache(vw_system_cache()) {}
+                       m_reuse_masks(false), m_num_threads(1), m_cache(vw_system_cache()) {}
 
     void insert( ImageViewRef<pixel_type> const& image, int x, int y );
 
@@ -249,10 +413,13 @@ namespace mosaic {
     void prepare( BBox2i const& total_bbox, const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() );
 
     /// Generate a section of the output image.
-    ImageView<pixel_type> generate_patch( BBox2i const& patch_bbox ) const {
-      if( m_draft_mode ) return draft_patch( patch_bbox );
-      else return blend_patch( patch_bbox );
-    }
+    ///
+    /// With more than one thread, a large section is made in pieces
+    /// in parallel, and the source pyramids of a small one are made
+    /// and summed in parallel. Leave this at one thread when the
+    /// caller already makes patches in parallel, as the quadtree
+    /// generator does.
+    ImageView<pixel_type> generate_patch( BBox2i const& patch_bbox ) const;
 
     /// If draft mode is on no image blending is performed.
     void set_draft_mode (bool draft_mode ) { m_draft_mode = draft_mode; }
@@ -261,6 +428,9 @@ namespace mosaic {
 
     void set_reuse_masks(bool reuse_masks) { m_reuse_masks = reuse_masks; }
 
+    int32 get_num_threads() const { return m_num_threads; }
+    void set_num_threads( int32 num_threads ) { m_num_threads = num_threads; }
+
     int32 cols  () const { return view_bbox.width();  }
     int32 rows  () const { return view_bbox.height(); }
     int32 planes() const { return 1;                  }
@@ -290,7 +460,10 @@ namespace mosaic {
     }
 
     bool sparse_check( BBox2i const& bbox ) const {
-      for (unsigned int i = 0; i < bboxes.size(); ++i) {
+      std::vector<uint32> overlaps;
+      m_index.find( bboxes, bbox, overlaps );
+      for (unsigned int k = 0; k < overlaps.size(); ++k) {
+        uint32 i = overlaps[k];
         BBox2i src_bbox = bboxes[i];
         src_bbox.crop(bbox);
         if( ! src_bbox.empty() ) {
@@ -330,28 +503,27 @@ void vw::mosaic::ImageComposite<PixelT>::generate_masks( vw::ProgressCallback co
   std::vector<Cache::Handle<GrassfireGenerator> > grassfires;
   for( unsigned i=0; i<sources.size(); ++i )
     grassfires.push_back( m_cache.insert( GrassfireGenerator( sourcerefs[i] ) ) );
+  std::vector<uint32> overlaps;
   for( unsigned p1=0; p1<sources.size(); ++p1 ) {
     ImageView<float> mask = copy( *(grassfires[p1]) );
-    for( unsigned p2=0; p2<sources.size(); ++p2 ) {
+    grassfires[p1].release();
+    m_index.find( bboxes, bboxes[p1], overlaps );
+    for( unsigned k=0; k<overlaps.size(); ++k ) {
+      unsigned p2 = overlaps[k];
       if( p1 == p2 ) continue;
       int ox = bboxes[p2].min().x() - bboxes[p1].min().x();
       int oy = bboxes[p2].min().y() - bboxes[p1].min().y();
-      if( ! ( ox >= bboxes[p1].width() ||
-              oy >= bboxes[p1].height() ||
-              -ox >= bboxes[p2].width() ||
-              -oy >= bboxes[p2].height() ) )
-      {
-        ImageView<float> other = *grassfires[p2];
-        int left = std::max( ox, 0 );
-        int top = std::max( oy, 0 );
-        int right = std::min( bboxes[p2].width()+ox, bboxes[p1].width() );
-        int bottom = std::min( bboxes[p2].height()+oy, bboxes[p1].height() );
-        for( int j=top; j<bottom; ++j ) {
-          for( int i=left; i<right; ++i ) {
-            if( ( other(i-ox,j-oy) > mask(i,j) ) ||
-                ( other(i-ox,j-oy) == mask(i,j) && p2 > p1 ) )
-              mask(i,j) = 0;
-          }
+      ImageView<float> other = *grassfires[p2];
+      grassfires[p2].release();
+      int left = std::max( ox, 0 );
+      int top = std::max( oy, 0 );
+      int right = std::min( bboxes[p2].width()+ox, bboxes[p1].width() );
+      int bottom = std::min( bboxes[p2].height()+oy, bboxes[p1].height() );
+      for( int j=top; j<bottom; ++j ) {
+        for( int i=left; i<right; ++i ) {
+          if( ( other(i-ox,j-oy) > mask(i,j) ) ||
+              ( other(i-ox,j-oy) == mask(i,j) && p2 > p1 ) )
+            mask(i,j) = 0;
         }
       }
       progress_callback.report_fractional_progress( double(p1*(sources.size()+1)+p2+1), double((sources.size()+1)*sources.size()) );
@@ -369,28 +541,37 @@ void vw::mosaic::ImageComposite<PixelT>::generate_masks( vw::ProgressCallback co
 template <class PixelT>
 boost::shared_ptr<typename vw::mosaic::ImageComposite<PixelT>::Pyramid> vw::mosaic::ImageComposite<PixelT>::PyramidGenerator::generate() const {
   vw_out(DebugMessage, "mosaic") << "ImageComposite generating pyramid " << m_index << std::endl;
+  Cache::Handle<SourceGenerator> handle = m_composite.sources[m_index];
+  ImageView<pixel_type> source = copy(*handle);
+  handle.release();
+  handle.deprioritize();
+  return m_composite.build_pyramid( m_index, source, m_composite.bboxes[m_index] );
+}
+
+
+template <class PixelT>
+boost::shared_ptr<typename vw::mosaic::ImageComposite<PixelT>::Pyramid>
+vw::mosaic::ImageComposite<PixelT>::build_pyramid( unsigned index, ImageView<pixel_type> source, BBox2i const& region ) const {
   boost::shared_ptr<Pyramid> ptr( new Pyramid );
-  ImageView<pixel_type> source = copy(*m_composite.sources[m_index]);
-  m_composite.sources[m_index].release();
-  m_composite.sources[m_index].deprioritize();
 
   // This is sort of a kluge: the hole-filling algorithm currently
   // doesn't cope well with partially-transparent source pixels.
-  if( m_composite.m_fill_holes ) source /= select_alpha_channel(source);
+  if( m_fill_holes ) source /= select_alpha_channel(source);
 
-  PositionedImage<pixel_type> image_high( m_composite.view_bbox.width(), m_composite.view_bbox.height(), source, m_composite.bboxes[m_index] );
+  PositionedImage<pixel_type> image_high( view_bbox.width(), view_bbox.height(), source, region );
   PositionedImage<pixel_type> image_low = image_high.reduce();
   ImageView<channel_type> mask_image;
 
   std::ostringstream mask_filename;
-  mask_filename << "mask." << m_index << ".png";
-  read_image( mask_image, mask_filename.str() );
-  PositionedImage<channel_type> mask( m_composite.view_bbox.width(), m_composite.view_bbox.height(), mask_image, m_composite.bboxes[m_index] );
+  mask_filename << "mask." << index << ".png";
+  boost::scoped_ptr<DiskImageResource> mask_resource( DiskImageResource::open( mask_filename.str() ) );
+  read_image( mask_image, *mask_resource, region - bboxes[index].min() );
+  PositionedImage<channel_type> mask( view_bbox.width(), view_bbox.height(), mask_image, region );
 
-  for( int l=0; l<m_composite.levels; ++l ) {
+  for( int l=0; l<levels; ++l ) {
     PositionedImage<pixel_type> diff = image_high;
     if( l > 0 ) mask = mask.reduce();
-    if( l < m_composite.levels-1 ) {
+    if( l < levels-1 ) {
       PositionedImage<pixel_type> next_image_low = image_low.reduce();
       image_low.unpremultiply();
       diff.subtract_expanded( image_low );
@@ -412,6 +593,8 @@ void vw::mosaic::ImageComposite<PixelT>::insert( ImageViewRef<pixel_type> const&
   alphas.push_back( m_cache.insert( AlphaGenerator( *this, pyramids.size() ) ) );
   pyramids.push_back( m_cache.insert( PyramidGenerator( *this, pyramids.size() ) ) );
 
+  m_index.clear();
+
   int cols = image.cols(), rows = image.rows();
   BBox2i image_bbox( Vector2i(x, y), Vector2i(x+cols, y+rows) );
   bboxes.push_back( image_bbox );
@@ -434,6 +617,7 @@ void vw::mosaic::ImageComposite<PixelT>::prepare( vw::ProgressCallback const& pr
   for( unsigned i=0; i<sources.size(); ++i )
     bboxes[i] -= view_bbox.min();
   data_bbox -= view_bbox.min();
+  m_index.build( bboxes );
 
   levels = (int) floorf( logf( float(mindim)/2.0f ) / logf(2.0f) ) - 1;
   if( levels < 1 ) levels = 1;
@@ -451,6 +635,71 @@ void vw::mosaic::ImageComposite<PixelT>::prepare( BBox2i const& total_bbox,
   prepare( progress_callback );
 }
 
+template <class PixelT>
+vw::ImageView<PixelT> vw::mosaic::ImageComposite<PixelT>::generate_patch( BBox2i const& patch_bbox ) const {
+  // Large patches are split into pieces that are made in parallel.
+  // The pieces are large enough that blending them isn't mostly
+  // spent on the padding around them.
+  const int32 piece_size = 512;
+  if( m_num_threads <= 1 || ( patch_bbox.width() <= piece_size && patch_bbox.height() <= piece_size ) ) {
+    if( m_draft_mode ) return draft_patch( patch_bbox );
+    else return blend_patch( patch_bbox, m_num_threads );
+  }
+
+  ImageView<pixel_type> composite( patch_bbox.width(), patch_bbox.height() );
+  // Each piece keeps its own exception, and the first one is rethrown
+  // as is.
+  std::list<std::exception_ptr> errors;
+  {
+    FifoWorkQueue queue( m_num_threads );
+    for( int32 y=patch_bbox.min().y(); y<patch_bbox.max().y(); y+=piece_size ) {
+      for( int32 x=patch_bbox.min().x(); x<patch_bbox.max().x(); x+=piece_size ) {
+        BBox2i piece( Vector2i( x, y ), Vector2i( std::min( x+piece_size, patch_bbox.max().x() ),
+                                                  std::min( y+piece_size, patch_bbox.max().y() ) ) );
+        errors.push_back( std::exception_ptr() );
+        queue.add_task( boost::shared_ptr<Task>( new PatchTask( *this, piece, crop( composite, piece-patch_bbox.min() ),
+                                                                errors.back() ) ) );
+      }
+    }
+    queue.join_all();
+  }
+  for( std::list<std::exception_ptr>::const_iterator it=errors.begin(); it!=errors.end(); ++it )
+    if( *it )
+      std::rethrow_exception( *it );
+  return composite;
+}
+
+
+template <class PixelT>
+void vw::mosaic::ImageComposite<PixelT>::patch_pyramid( PatchSource& source, BBox2i const& padded_bbox ) const {
+  // Only the source pixels in padded_bbox can reach the patch, so a
+  // pyramid of just those gives the same patch as the full one.
+  unsigned p = source.index;
+  BBox2i footprint = padded_bbox;
+  footprint.crop( bboxes[p] );
+
+  // A pyramid that's already cached, or whose footprint is most of
+  // the source anyway, is used whole.
+  if( pyramids[p].valid() ||
+      2 * int64(footprint.width()) * footprint.height() > int64(bboxes[p].width()) * bboxes[p].height() ) {
+    source.handle = pyramids[p];
+    source.pyramid = source.handle;
+    return;
+  }
+  ImageView<pixel_type> part = crop( sourcerefs[p], footprint - bboxes[p].min() );
+  source.pyramid = build_pyramid( p, part, footprint );
+}
+
+
+template <class PixelT>
+void vw::mosaic::ImageComposite<PixelT>::add_level( std::vector<PatchSource> const& batch, int level, BBox2i const& bbox,
+                                                    ImageView<pixel_type> const& sum, ImageView<channel_type> const& msum ) {
+  for( size_t i=0; i<batch.size(); ++i ) {
+    batch[i].pyramid->images[level].addto( sum,  bbox.min().x(), bbox.min().y() );
+    batch[i].pyramid->masks [level].addto( msum, bbox.min().x(), bbox.min().y() );
+  }
+}
+
 // Suppose a destination image patch at a given level of the pyramid
 // has a bounding box that begins at offset x and has width w.  It
 // is affected by a range of pixels at the next level of the pyramid
@@ -462,7 +711,7 @@ void vw::mosaic::ImageComposite<PixelT>::prepare( BBox2i const& total_bbox,
 // Generates a full-resolution patch of the mosaic corresponding
 // to the given bounding box.
 template <class PixelT>
-vw::ImageView<PixelT> vw::mosaic::ImageComposite<PixelT>::blend_patch( BBox2i const& patch_bbox ) const {
+vw::ImageView<PixelT> vw::mosaic::ImageComposite<PixelT>::blend_patch( BBox2i const& patch_bbox, int32 num_threads ) const {
 #if VW_DEBUG_LEVEL > 1
   vw_out(DebugMessage, "mosaic") << "ImageComposite compositing patch " << patch_bbox << "..." << std::endl;
 #endif
@@ -498,23 +747,62 @@ vw::ImageView<PixelT> vw::mosaic::ImageComposite<PixelT>::blend_patch( BBox2i co
 
   // Make a list of the images whose bounding boxes permit them to
   // impact the patch, prioritizing ones that are already in memory.
+  std::vector<uint32> overlaps;
+  m_index.find( bboxes, padded_bbox, overlaps );
   std::list<unsigned> image_list;
-  for( unsigned p=0; p<sources.size(); ++p ) {
-    if( ! padded_bbox.intersects( bboxes[p] ) ) continue;
+  for( unsigned k=0; k<overlaps.size(); ++k ) {
+    unsigned p = overlaps[k];
     if( ! pyramids[p].valid() ) image_list.push_back( p );
     else image_list.push_front( p );
   }
 
-  // Add each source image pyramid to the blend pyramid.
+  // Add each source image pyramid to the blend pyramid. The sources
+  // are taken a batch of one per thread at a time, so that no more
+  // pyramids than that are held at once. The pyramids of a batch are
+  // made in parallel, and then its levels are summed in parallel.
+  const size_t batch_size = std::max( num_threads, int32(1) );
+  std::vector<PatchSource> batch;
+  batch.reserve( batch_size );
   std::list<unsigned>::iterator ili=image_list.begin(), ilend=image_list.end();
-  for( ; ili!=ilend; ++ili ) {
-    unsigned p = *ili;
-    boost::shared_ptr<Pyramid> pyr = pyramids[p];
-    for( int l=0; l<levels; ++l ) {
-      pyr->images[l].addto( sum_pyr [l], bbox_pyr[l].min().x(), bbox_pyr[l].min().y() );
-      pyr->masks [l].addto( msum_pyr[l], bbox_pyr[l].min().x(), bbox_pyr[l].min().y() );
+  while( ili != ilend ) {
+    batch.clear();
+    for( ; ili!=ilend && batch.size()<batch_size; ++ili )
+      batch.push_back( PatchSource( *ili ) );
+
+    if( batch.size() == 1 ) {
+      patch_pyramid( batch[0], padded_bbox );
+    }
+    else {
+      FifoWorkQueue queue( num_threads );
+      for( size_t i=0; i<batch.size(); ++i )
+        queue.add_task( boost::shared_ptr<Task>( new PatchPyramidTask( *this, batch[i], padded_bbox ) ) );
+      queue.join_all();
     }
-    pyramids[p].release();
+
+    std::exception_ptr error;
+    for( size_t i=0; i<batch.size() && !error; ++i )
+      error = batch[i].error;
+    if( ! error ) {
+      if( num_threads > 1 ) {
+        std::vector<std::exception_ptr> level_errors( levels );
+        FifoWorkQueue queue( num_threads );
+        for( int l=0; l<levels; ++l )
+          queue.add_task( boost::shared_ptr<Task>( new PatchLevelTask( batch, l, bbox_pyr[l], sum_pyr[l], msum_pyr[l],
+                                                                       level_errors[l] ) ) );
+        queue.join_all();
+        for( int l=0; l<levels && !error; ++l )
+          error = level_errors[l];
+      }
+      else {
+        for( int l=0; l<levels; ++l )
+          add_level( batch, l, bbox_pyr[l], sum_pyr[l], msum_pyr[l] );
+      }
+    }
+
+    for( size_t i=0; i<batch.size(); ++i )
+      if( batch[i].pyramid && batch[i].handle.attached() ) batch[i].handle.release();
+    if( error )
+      std::rethrow_exception( error );
   }
 
   // Collapse the pyramid
@@ -538,11 +826,12 @@ vw::ImageView<PixelT> vw::mosaic::ImageComposite<PixelT>::blend_patch( BBox2i co
 
     // Trim to the maximal source alpha, reloading images if needed
     ImageView<channel_type> alpha( patch_bbox.width(), patch_bbox.height() );
-    for( unsigned p=0; p<sources.size(); ++p ) {
-      if( ! patch_bbox.intersects( bboxes[p] ) ) continue;
-
-      ImageView<channel_type> source_alpha = *alphas[p];
-      alphas[p].release();
+    m_index.find( bboxes, patch_bbox, overlaps );
+    for( unsigned k=0; k<overlaps.size(); ++k ) {
+      unsigned p = overlaps[k];
+      Cache::Handle<AlphaGenerator> handle = alphas[p];
+      ImageView<channel_type> source_alpha = *handle;
+      handle.release();
 
       BBox2i overlap = patch_bbox;
       overlap.crop( bboxes[p] );
@@ -574,8 +863,10 @@ vw::ImageView<PixelT> vw::mosaic::ImageComposite<PixelT>::draft_patch( BBox2i co
   ImageView<pixel_type> composite(patch_bbox.width(),patch_bbox.height());
 
   // Add each image to the composite.
-  for( unsigned p=0; p<sources.size(); ++p ) {
-    if( ! patch_bbox.intersects( bboxes[p] ) ) continue;
+  std::vector<uint32> overlaps;
+  m_index.find( bboxes, patch_bbox, overlaps );
+  for( unsigned k=0; k<overlaps.size(); ++k ) {
+    unsigned p = overlaps[k];
     BBox2i bbox = patch_bbox;
     bbox.crop( bboxes[p] );
     PositionedImage<pixel_type> image( view_bbox.width(), view_bbox.height(),
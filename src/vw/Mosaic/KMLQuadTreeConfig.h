@@ -64,6 +64,10 @@ namespace mosaic {
 
     cartography::GeoReference output_georef(uint32 xresolution, uint32 yresolution = 0);
 
+    // The KML files link to the tile files, and each one is only
+    // written if the tile files it links to exist on disk.
+    bool supports_tile_archive() const { return false; }
+
   private:
     // The implementation is stored in a shared pointer so that it can
     // be safely bound to the quadtree callbacks in colsures even if
@@ -35,6 +35,9 @@ namespace mosaic {
     virtual void configure( QuadTreeGenerator& qtree ) const = 0;
     /// 
     virtual cartography::GeoReference output_georef(uint32 xresolution, uint32 yresolution = 0) = 0;
+    /// Whether the tiles can be written to a TileArchive instead of
+    /// files.  Not if the metadata needs the tile files on disk.
+    virtual bool supports_tile_archive() const { return true; }
     
     /// Creates a new QuadTreeConfig object of the specified type
     static boost::shared_ptr<QuadTreeConfig> make(const std::string& type);
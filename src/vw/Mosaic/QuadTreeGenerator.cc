@@ -20,8 +20,11 @@
 
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/convenience.hpp>
+#include <boost/filesystem/operations.hpp>
 namespace fs = boost::filesystem;
 
+#include <sstream>
+
 #include <vw/FileIO/DiskImageResource.h>
 
 namespace vw {
@@ -84,6 +87,114 @@ namespace mosaic {
     return boost::shared_ptr<DstImageResource>( DiskImageResource::create( info.filepath+info.filetype, format ) );
   }
 
+  boost::shared_ptr<SrcImageResource> QuadTreeGenerator::default_tile_reader_func::operator()( QuadTreeGenerator const&, TileInfo const& info ) {
+    std::string filename = info.filepath + info.filetype;
+    if( ! fs::exists( filename ) )
+      return boost::shared_ptr<SrcImageResource>();
+    return boost::shared_ptr<SrcImageResource>( DiskImageResource::open( filename ) );
+  }
+
+  void QuadTreeGenerator::remove_other_file_type( TileInfo const& info ) const {
+    if( m_file_type != "auto" )
+      return;
+    if( info.filetype == ".jpg" )
+      fs::remove( info.filepath + ".png" );
+    else if( info.filetype == ".png" )
+      fs::remove( info.filepath + ".jpg" );
+  }
+
+  // The manifest has one line per tile, "name<tab>filetype<tab>image bbox",
+  // with "-" as the file type of culled tiles.  The tiles of a run are
+  // preceded by a "#begin" line with the dirty bbox, and followed by an
+  // "#end" line once the run is done.
+
+  QuadTreeGenerator::Manifest::Manifest( std::string const& filename )
+    : m_filename( filename ), m_run_open( false ), m_resuming( false ) {
+    std::ifstream in( filename.c_str() );
+    std::string line;
+    while( std::getline( in, line ) ) {
+      if( line == "#end" ) {
+        m_run_open = false;
+        continue;
+      }
+      if( line.compare( 0, 7, "#begin " ) == 0 ) {
+        std::istringstream fields( line.substr( 7 ) );
+        int32 x0, y0, x1, y1;
+        if( fields >> x0 >> y0 >> x1 >> y1 ) {
+          m_run_bbox = BBox2i( Vector2i(x0,y0), Vector2i(x1,y1) );
+          m_run_open = true;
+          m_run_tiles.clear();
+        }
+        continue;
+      }
+
+      size_t tab1 = line.find( '\t' );
+      size_t tab2 = tab1 == std::string::npos ? tab1 : line.find( '\t', tab1+1 );
+      if( tab2 == std::string::npos )
+        continue; // Cut short when a run was interrupted
+      std::istringstream fields( line.substr( tab2+1 ) );
+      int32 x0, y0, x1, y1;
+      if( ! ( fields >> x0 >> y0 >> x1 >> y1 ) )
+        continue;
+      std::string name = line.substr( 0, tab1 );
+      Entry& entry = m_tiles[name];
+      entry.filetype = line.substr( tab1+1, tab2-tab1-1 );
+      if( entry.filetype == "-" )
+        entry.filetype.clear();
+      entry.image_bbox = BBox2i( Vector2i(x0,y0), Vector2i(x1,y1) );
+      if( m_run_open )
+        m_run_tiles.insert( name );
+    }
+  }
+
+  size_t QuadTreeGenerator::Manifest::begin( BBox2i const& dirty_bbox ) {
+    m_resuming = m_run_open && m_run_bbox == dirty_bbox;
+    m_out.open( m_filename.c_str(), std::ios::app );
+    VW_ASSERT( m_out.good(), IOErr() << "QuadTreeGenerator: could not open manifest " << m_filename );
+    if( m_resuming )
+      return m_run_tiles.size();
+    m_run_tiles.clear();
+    m_out << "#begin " << dirty_bbox.min().x() << " " << dirty_bbox.min().y() << " "
+          << dirty_bbox.max().x() << " " << dirty_bbox.max().y() << std::endl;
+    return 0;
+  }
+
+  void QuadTreeGenerator::Manifest::write_entry( std::ostream& out, std::string const& name, Entry const& entry ) const {
+    out << name << '\t' << ( entry.filetype.empty() ? "-" : entry.filetype ) << '\t'
+        << entry.image_bbox.min().x() << " " << entry.image_bbox.min().y() << " "
+        << entry.image_bbox.max().x() << " " << entry.image_bbox.max().y() << "\n";
+  }
+
+  void QuadTreeGenerator::Manifest::record( TileInfo const& info, bool written ) {
+    Entry& entry = m_tiles[info.name];
+    entry.filetype   = written ? info.filetype : std::string();
+    entry.image_bbox = info.image_bbox;
+    write_entry( m_out, info.name, entry );
+    m_out.flush(); // Every tile is a checkpoint
+  }
+
+  QuadTreeGenerator::Manifest::Entry const* QuadTreeGenerator::Manifest::find( std::string const& name ) const {
+    std::map<std::string,Entry>::const_iterator it = m_tiles.find( name );
+    return it == m_tiles.end() ? 0 : &it->second;
+  }
+
+  void QuadTreeGenerator::Manifest::end() {
+    m_out << "#end" << std::endl;
+    m_out.close();
+
+    // Only the latest record of each tile is worth keeping
+    std::string tmp = m_filename + ".tmp";
+    {
+      std::ofstream out( tmp.c_str() );
+      for( std::map<std::string,Entry>::const_iterator it = m_tiles.begin(); it != m_tiles.end(); ++it )
+        write_entry( out, it->first, it->second );
+      VW_ASSERT( out.good(), IOErr() << "QuadTreeGenerator: could not write " << tmp );
+    }
+    fs::rename( tmp, m_filename );
+    m_run_open = m_resuming = false;
+    m_run_tiles.clear();
+  }
+
   void QuadTreeGenerator::generate( const ProgressCallback &progress_callback ) {
     ScopedWatch sw("QuadTreeGenerator::generate");
     int32 tree_levels = get_tree_levels();
@@ -93,8 +204,23 @@ namespace mosaic {
     vw_out(DebugMessage, "mosaic") << "Generating quadtree with "       << tree_levels << " levels." << std::endl;
 
     BBox2i region_bbox = BBox2i(0,0,m_tile_size,m_tile_size) * (1<<(tree_levels-1));
+    m_manifest.reset();
+    if( ! m_manifest_file.empty() ) {
+      m_manifest.reset( new Manifest( m_manifest_file ) );
+      size_t done = m_manifest->begin( m_dirty_bbox.empty() ? region_bbox : m_dirty_bbox );
+      if( done > 0 )
+        vw_out(InfoMessage, "mosaic") << "Resuming quadtree generation, " << done << " tiles already written." << std::endl;
+    }
+    if( ! m_dirty_bbox.empty() )
+      vw_out(DebugMessage, "mosaic") << "Regenerating tiles that overlap " << m_dirty_bbox << std::endl;
+
     m_processor->generate( region_bbox, progress_callback );
 
+    if( m_manifest ) {
+      m_manifest->end();
+      m_manifest.reset();
+    }
+
     progress_callback.report_finished();
   }
 
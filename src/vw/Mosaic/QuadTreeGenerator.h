@@ -23,16 +23,24 @@
 #ifndef __VW_MOSAIC_QUADTREEGENERATOR_H__
 #define __VW_MOSAIC_QUADTREEGENERATOR_H__
 
+#include <exception>
 #include <vector>
 #include <map>
+#include <set>
 #include <string>
 #include <fstream>
 
 #include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
 
+#include <vw/Core/Condition.h>
 #include <vw/Core/ProgressCallback.h>
 #include <vw/Core/Stopwatch.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Image/EdgeExtension.h>
+#include <vw/Image/ImageIO.h>
 #include <vw/Image/SparseImageCheck.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageViewRef.h>
@@ -73,6 +81,8 @@ namespace mosaic {
         branch_func_type;
     typedef boost::function<boost::shared_ptr<DstImageResource>(QuadTreeGenerator const&, TileInfo const&, ImageFormat const&)> 
         tile_resource_func_type;
+    typedef boost::function<boost::shared_ptr<SrcImageResource>(QuadTreeGenerator const&, TileInfo const&)> 
+        tile_reader_func_type;
     typedef boost::function<void(QuadTreeGenerator const&, TileInfo const&)> 
         metadata_func_type;
     typedef boost::function<bool(BBox2i const&)> 
@@ -95,11 +105,13 @@ namespace mosaic {
         m_crop_bbox(),
         m_crop_images( false ),
         m_cull_images( false ),
+        m_num_threads( 1 ),
         m_dimensions( image.impl().cols(), image.impl().rows() ),
         m_processor( new Processor<typename ImageT::pixel_type>( this, image.impl() ) ),
         m_image_path_func( simple_image_path() ),
         m_branch_func( default_branch_func() ),
         m_tile_resource_func( default_tile_resource_func() ),
+        m_tile_reader_func( default_tile_reader_func() ),
         m_metadata_func(),
         m_sparse_image_check( SparseImageCheck<ImageT>(image.impl()) )
     {}
@@ -110,6 +122,14 @@ namespace mosaic {
       m_processor = processor;
     }
 
+    /// Generates the tree.  With more than one thread (see
+    /// set_num_threads()) tiles are generated in parallel.  The branch
+    /// and sparse image check functions still run on the calling thread,
+    /// and the path, resource and metadata functions run on one writer
+    /// thread, in the same tile order as the single threaded generator.
+    /// Tiles of earlier runs are read back on the worker threads, but
+    /// never at the same time as a tile is written, so none of the path,
+    /// resource, reader or metadata functions are called concurrently.
     void generate( const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() );
 
     void set_crop_bbox( BBox2i const& bbox ) {
@@ -118,6 +138,22 @@ namespace mosaic {
       m_crop_bbox = bbox;
     }
 
+    /// Only regenerates the tiles that overlap this region of the source
+    /// image.  Their ancestors are rebuilt from the existing tiles of
+    /// their other children, which are read back with the tile reader
+    /// function.  An empty bbox (the default) regenerates everything.
+    void set_dirty_bbox( BBox2i const& bbox ) {
+      m_dirty_bbox = bbox;
+    }
+
+    /// Records every tile as it is written in this file.  The records
+    /// tell later incremental runs where the data sits in cropped tiles,
+    /// and let a run that was interrupted skip the tiles it already
+    /// wrote when it is restarted with the same dirty bbox.
+    void set_manifest_file( std::string const& filename ) {
+      m_manifest_file = filename;
+    }
+
     // Compute number of tree levels required with a downsample factor of 2
     int32 get_tree_levels() const {
       int32 maxdim      = (std::max)( m_dimensions.x(), m_dimensions.y() ); // Get largest dimension
@@ -130,11 +166,14 @@ namespace mosaic {
     // Simple "get" functions
     std::string const& get_name()        const { return m_tree_name;   }
     BBox2i      const& get_crop_bbox()   const { return m_crop_bbox;   }
+    BBox2i      const& get_dirty_bbox()  const { return m_dirty_bbox;  }
+    std::string const& get_manifest_file() const { return m_manifest_file; }
     std::string const& get_file_type()   const { return m_file_type;   }
     int32              get_tile_size()   const { return m_tile_size;   }
     Vector2i    const& get_dimensions()  const { return m_dimensions;  }
     bool               get_crop_images() const { return m_crop_images; }
     bool               get_cull_images() const { return m_cull_images; }
+    int32              get_num_threads() const { return m_num_threads; }
     sparse_image_check_type const& sparse_image_check() const { return m_sparse_image_check; }
 
 
@@ -144,9 +183,11 @@ namespace mosaic {
     void set_tile_size         (int32                          size              ) {m_tile_size          = size;              }
     void set_crop_images       (bool                           crop              ) {m_crop_images        = crop;              }
     void set_cull_images       (bool                           cull              ) {m_cull_images        = cull;              }
+    void set_num_threads       (int32                          num_threads       ) {m_num_threads        = num_threads;       }
     void set_image_path_func   (image_path_func_type           image_path_func   ) {m_image_path_func    = image_path_func;   }
     void set_branch_func       (branch_func_type        const& branch_func       ) {m_branch_func        = branch_func;       }
     void set_tile_resource_func(tile_resource_func_type const& tile_resource_func) {m_tile_resource_func = tile_resource_func;}
+    void set_tile_reader_func  (tile_reader_func_type   const& tile_reader_func  ) {m_tile_reader_func   = tile_reader_func;  }
     void set_metadata_func     (metadata_func_type             metadata_func     ) {m_metadata_func      = metadata_func;     }
     void set_sparse_image_check(sparse_image_check_type const& func              ) {m_sparse_image_check = func;              }
 
@@ -163,6 +204,10 @@ namespace mosaic {
       return m_tile_resource_func( *this, info, format );
     }
 
+    boost::shared_ptr<SrcImageResource> tile_reader(TileInfo const& info) const {
+      return m_tile_reader_func( *this, info );
+    }
+
     void make_tile_metadata( TileInfo const& info ) const {
       if( m_metadata_func ) {
         m_metadata_func( *this, info );
@@ -199,13 +244,108 @@ namespace mosaic {
       boost::shared_ptr<DstImageResource> operator()( QuadTreeGenerator const& qtree, TileInfo const& info, ImageFormat const& format );
     };
 
+    /// The default reader function, opens the tiles written by the
+    /// default resource function.  Returns null if there is no tile.
+    struct default_tile_reader_func {
+      boost::shared_ptr<SrcImageResource> operator()( QuadTreeGenerator const& qtree, TileInfo const& info );
+    };
+
   protected:
+
+    /// The tiles written by this and earlier runs, kept in the manifest file
+    class Manifest {
+    public:
+      struct Entry {
+        std::string filetype; // Empty if the tile was culled
+        BBox2i image_bbox;
+      };
+
+      /// Loads the records of earlier runs
+      Manifest( std::string const& filename );
+
+      /// Starts recording a run, or resumes an interrupted run over the
+      /// same dirty bbox.  Returns the number of tiles already done.
+      size_t begin( BBox2i const& dirty_bbox );
+
+      /// Marks the run as done and rewrites the file with one record per tile
+      void end();
+
+      void record( TileInfo const& info, bool written );
+      Entry const* find( std::string const& name ) const;
+      bool done_before_resume( std::string const& name ) const {
+        return m_resuming && m_run_tiles.count( name );
+      }
+
+    private:
+      void write_entry( std::ostream& out, std::string const& name, Entry const& entry ) const;
+
+      std::string m_filename;
+      std::map<std::string,Entry> m_tiles;
+      std::set<std::string> m_run_tiles; // Tiles of the last unfinished run
+      BBox2i m_run_bbox;
+      bool m_run_open, m_resuming;
+      std::ofstream m_out;
+    };
+
+    /// With the "auto" file type a tile can be a jpg in one run and a
+    /// png in the next.  Removes the file of the type not being written,
+    /// so it isn't left behind or read back in place of the new tile.
+    void remove_other_file_type( TileInfo const& info ) const;
   
     /// Secret class that contains all the high level tree generation logic
     template <class PixelT>
     class Processor : public ProcessorBase {
       ImageViewRef<PixelT> m_source;
 
+      /// A tile of a tree that is being generated in parallel
+      struct Node {
+        TileInfo info;
+        boost::shared_ptr<Node> parent;
+        size_t slot;    // Which of the parent's children this is
+        int32  pending; // Children not yet generated, plus one until they are all planned
+        int32  index;   // Position in the depth-first write order
+        bool   stored;  // Read back from an earlier run instead of generated
+        std::vector<std::pair<BBox2i,ImageView<PixelT> > > parts; // Children, subsampled into this tile
+      };
+      typedef boost::shared_ptr<Node> node_ptr;
+
+      /// State shared by the planning thread, the workers and the writer
+      struct Build {
+        Mutex     mutex;
+        Mutex     io_mutex; // Held while calling the tile functions or using the manifest
+        Condition written_event;
+        FifoWorkQueue    workers;
+        OrderedWorkQueue writer;
+        int32 planned, written;       // Tiles given a write index, and tiles written
+        std::vector<double> progress; // Progress once each tile is written
+        bool  failed;
+        std::exception_ptr error;     // The first failure of a worker or the writer
+        Build( int32 num_threads ) : workers( num_threads ), writer( 1 ), planned( 0 ), written( 0 ), failed( false ) {}
+      };
+
+      /// Rasterizes a leaf tile, or assembles a parent once its children are done
+      class TileTask : public Task, private boost::noncopyable {
+        Processor& m_processor;
+        Build&     m_build;
+        node_ptr   m_node;
+      public:
+        TileTask( Processor& processor, Build& build, node_ptr const& node )
+          : m_processor( processor ), m_build( build ), m_node( node ) {}
+        void operator()() { m_processor.make_tile( m_build, m_node ); }
+      };
+
+      /// Writes a finished tile and its metadata
+      class WriteTask : public Task, private boost::noncopyable {
+        Processor&        m_processor;
+        Build&            m_build;
+        node_ptr          m_node;
+        ImageView<PixelT> m_image;
+      public:
+        WriteTask( Processor& processor, Build& build, node_ptr const& node, ImageView<PixelT> const& image )
+          : m_processor( processor ), m_build( build ), m_node( node ), m_image( image ) {}
+        void operator()() { m_processor.write_node( m_build, m_node, m_image ); }
+      };
+
     public:
       /// Construct the image with the qtree object and the full resolution source image
       template <class ImageT>
@@ -215,6 +355,12 @@ namespace mosaic {
 
       /// Top level call to generate a qtree from a specified region of the input image.
       void generate( BBox2i const& region_bbox, const ProgressCallback &progress_callback ) {
+        if( ! regenerate( "", region_bbox ) )
+          return;
+        if( qtree->get_num_threads() > 1 ) {
+          generate_parallel( region_bbox, progress_callback );
+          return;
+        }
         // Just redirect to the branch function leaving the name blank.
         generate_branch( "", region_bbox, progress_callback );
       }
@@ -227,38 +373,15 @@ namespace mosaic {
 
         ImageView<PixelT> image;
         TileInfo info;
-        info.name = name;
-        info.region_bbox = region_bbox;
-
-        BBox2i crop_bbox(Vector2i(), qtree->get_dimensions());
-        if( ! qtree->get_crop_bbox().empty() ) 
-          crop_bbox.crop( qtree->get_crop_bbox() );
-        info.image_bbox = info.region_bbox;
-        info.image_bbox.crop( crop_bbox );
-
-        if( info.image_bbox.empty() ) {
-          if( ! (qtree->get_crop_images() || qtree->get_cull_images()) )
-            image.set_size( qtree->get_tile_size(), qtree->get_tile_size() );
+        if( ! start_tile( name, region_bbox, info ) )
           return image;
-        }
-
-        if( qtree->m_sparse_image_check && ! qtree->m_sparse_image_check(info.region_bbox) ) 
-            return image;
-
-        Vector2i scale = info.region_bbox.size() / qtree->m_tile_size;
 
         // Call function to compute which children belong to this tile.
         // - Each child contains a name and a bounding box.
         std::vector<std::pair<std::string, BBox2i> > children = qtree->m_branch_func(*qtree, info.name, info.region_bbox);
         
         if( children.empty() ) { // This is the highest resolution level of tiles (bottom of tree)
-          image = crop( m_source, info.image_bbox ); // Extract portion of source image
-          if( info.image_bbox != info.region_bbox ) { // Pad with zero pixels if needed
-            image = edge_extend( image, info.region_bbox - info.image_bbox.min(), ZeroEdgeExtension() );
-          }
-          if( (info.region_bbox.width() != qtree->m_tile_size) || (info.region_bbox.height() != qtree->m_tile_size) ) {
-            image = subsample( image, scale.x(), scale.y() ); // Resample image to the output tile size
-          }
+          image = leaf_image( info );
         }
         else { // One or more sub-levels below this image, generate and copy from them one at a time
           image.set_size(qtree->m_tile_size,qtree->m_tile_size); // Initialize empty image
@@ -276,18 +399,142 @@ namespace mosaic {
             double child_area = (double) image_bbox.width() * image_bbox.height();
             double progress   = progress_callback.progress();
             SubProgressCallback spc( progress_callback, progress, progress + child_area/total_area );
-            ImageView<PixelT> child = generate_branch(children[i].first, children[i].second, spc); // (name, BBox, callback)
+            ImageView<PixelT> child;
+            if( regenerate( children[i].first, children[i].second ) ) {
+              child = generate_branch(children[i].first, children[i].second, spc); // (name, BBox, callback)
+            } else { // Reuse the tile from an earlier run
+              TileInfo child_info;
+              if( start_tile( children[i].first, children[i].second, child_info ) )
+                child = stored_tile( child_info );
+              spc.report_progress(1);
+            }
             if( ! child.is_valid_image() ) 
               continue;
             
-            BBox2i dst_bbox = elem_quot( children[i].second - info.region_bbox.min(), scale );            // Compute this child's ROI in the current tile.
+            BBox2i dst_bbox = child_bbox( info, children[i].second );                                      // Compute this child's ROI in the current tile.
             crop(image,dst_bbox) = box_subsample( child, elem_quot(qtree->m_tile_size,dst_bbox.size()) ); // Copy and resample the child image to the destination ROI
           }
         }
 
+        ImageView<PixelT> cropped_image = finish_tile( info, image );
+        write_tile( info, cropped_image );
+
+        progress_callback.report_progress(1);
+        return image;
+      }
+
+    private:
+      /// Fills in the tile info for a region.  Returns false if there is
+      /// nothing to generate there.
+      bool start_tile( std::string const& name, BBox2i const& region_bbox, TileInfo& info ) const {
+        info.name = name;
+        info.region_bbox = region_bbox;
+
+        BBox2i crop_bbox(Vector2i(), qtree->get_dimensions());
+        if( ! qtree->get_crop_bbox().empty() ) 
+          crop_bbox.crop( qtree->get_crop_bbox() );
+        info.image_bbox = info.region_bbox;
+        info.image_bbox.crop( crop_bbox );
+
+        if( info.image_bbox.empty() )
+          return false;
+        if( qtree->m_sparse_image_check && ! qtree->m_sparse_image_check(info.region_bbox) ) 
+          return false;
+        return true;
+      }
+
+      /// Whether a tile needs to be generated, rather than read back from
+      /// an earlier run
+      bool regenerate( std::string const& name, BBox2i const& region_bbox ) const {
+        if( ! qtree->m_dirty_bbox.empty() ) {
+          BBox2i overlap = region_bbox;
+          overlap.crop( qtree->m_dirty_bbox );
+          if( overlap.empty() )
+            return false;
+        }
+        return ! ( qtree->m_manifest && qtree->m_manifest->done_before_resume( name ) );
+      }
+
+      /// Reads a tile written by an earlier run, expanded back to the full
+      /// tile size if it was cropped.  Returns an empty image if there is
+      /// no such tile.
+      ImageView<PixelT> stored_tile( TileInfo info ) const {
+        info.filepath = qtree->m_image_path_func( *qtree, info.name );
+        boost::shared_ptr<SrcImageResource> r;
+        Manifest::Entry const* entry = qtree->m_manifest ? qtree->m_manifest->find( info.name ) : 0;
+        if( entry ) {
+          if( entry->filetype.empty() )
+            return ImageView<PixelT>(); // Culled
+          info.filetype   = entry->filetype;
+          info.image_bbox = entry->image_bbox;
+          r = qtree->m_tile_reader_func( *qtree, info );
+        }
+        else if( qtree->m_file_type == "auto" ) {
+          info.filetype = ".png";
+          r = qtree->m_tile_reader_func( *qtree, info );
+          if( ! r ) {
+            info.filetype = ".jpg";
+            r = qtree->m_tile_reader_func( *qtree, info );
+          }
+        }
+        else {
+          info.filetype = "." + qtree->m_file_type;
+          r = qtree->m_tile_reader_func( *qtree, info );
+        }
+        if( ! r )
+          return ImageView<PixelT>();
+
+        ImageView<PixelT> data;
+        read_image( data, *r );
+        // Some tile writers fill in the color under transparent pixels.
+        if( PixelHasAlpha<PixelT>::value ) {
+          for( int32 y=0; y<data.rows(); ++y )
+            for( int32 x=0; x<data.cols(); ++x )
+              if( is_transparent( data(x,y) ) )
+                data(x,y) = PixelT();
+        }
+        if( data.cols() == qtree->m_tile_size && data.rows() == qtree->m_tile_size )
+          return data;
+
+        // The tile was cropped to its data
+        BBox2i data_bbox = elem_quot( info.image_bbox - info.region_bbox.min(), tile_scale( info ) );
+        VW_ASSERT( data_bbox.width() == data.cols() && data_bbox.height() == data.rows(),
+                   IOErr() << "QuadTreeGenerator: stored tile \"" << info.name << "\" is "
+                           << data.cols() << "x" << data.rows() << ", expected " << data_bbox.size() );
+        ImageView<PixelT> image( qtree->m_tile_size, qtree->m_tile_size );
+        crop( image, data_bbox ) = data;
+        return image;
+      }
+
+      /// Source pixels per tile pixel
+      Vector2i tile_scale( TileInfo const& info ) const {
+        return info.region_bbox.size() / qtree->m_tile_size;
+      }
+
+      /// The region of a parent tile that one of its children covers
+      BBox2i child_bbox( TileInfo const& parent, BBox2i const& child_region ) const {
+        return elem_quot( child_region - parent.region_bbox.min(), tile_scale( parent ) );
+      }
+
+      /// Reads a tile at the bottom of the tree from the source image
+      ImageView<PixelT> leaf_image( TileInfo const& info ) const {
+        ImageView<PixelT> image = crop( m_source, info.image_bbox ); // Extract portion of source image
+        if( info.image_bbox != info.region_bbox ) { // Pad with zero pixels if needed
+          image = edge_extend( image, info.region_bbox - info.image_bbox.min(), ZeroEdgeExtension() );
+        }
+        if( (info.region_bbox.width() != qtree->m_tile_size) || (info.region_bbox.height() != qtree->m_tile_size) ) {
+          Vector2i scale = tile_scale( info );
+          image = subsample( image, scale.x(), scale.y() ); // Resample image to the output tile size
+        }
+        return image;
+      }
+
+      /// Crops or culls a finished tile and picks its file type.  Returns
+      /// the image to write, which is empty if the tile was culled.
+      ImageView<PixelT> finish_tile( TileInfo& info, ImageView<PixelT> const& image ) const {
         ImageView<PixelT> cropped_image = image;
         if( qtree->m_crop_images || qtree->m_cull_images ) {
-        
+          Vector2i scale = tile_scale( info );
           BBox2i data_bbox = elem_quot( info.image_bbox-info.region_bbox.min(), scale );
           if( PixelHasAlpha<PixelT>::value )
             data_bbox.crop( nonzero_data_bounding_box( image ) );
@@ -314,20 +561,219 @@ namespace mosaic {
         else { // User must have submitted the output file type
           info.filetype = "." + qtree->m_file_type;
         }
+        return cropped_image;
+      }
 
+      /// Writes a finished tile to disk and makes its metadata
+      void write_tile( TileInfo& info, ImageView<PixelT> const& cropped_image ) const {
         // Retrieve the output path for this tile and write it to disk
         info.filepath = qtree->m_image_path_func( *qtree, info.name );
         if( cropped_image.is_valid_image() ) {
           ScopedWatch sw("QuadTreeGenerator::write_tile");
+          qtree->remove_other_file_type( info );
           boost::shared_ptr<DstImageResource> r = qtree->m_tile_resource_func( *qtree, info, cropped_image.format() );
           write_image( *r, cropped_image );
         }
         // Call function to take care of any extra tile metadata tasks
         if( qtree->m_metadata_func ) 
           qtree->m_metadata_func( *qtree, info );
+        if( qtree->m_manifest )
+          qtree->m_manifest->record( info, cropped_image.is_valid_image() );
+      }
 
-        progress_callback.report_progress(1);
-        return image;
+      // The parallel generator plans the tree depth-first on the calling
+      // thread, which is also where the branch and sparse image checks
+      // run.  Leaves are handed to the workers as they are planned, so
+      // they are read in quadtree order and neighboring tiles share
+      // source blocks.  A parent is assembled as soon as its last child
+      // is done.  Tiles are written by a single writer thread in the
+      // same order as generate_branch() writes them, so the path,
+      // resource and metadata functions see the same sequence of tiles.
+      // Tiles kept from an earlier run are read back by the workers, and
+      // the writer and those reads take turns on the I/O mutex, so the
+      // tile functions are never called concurrently and the manifest
+      // is not read while it is being recorded.  Progress is reported on
+      // the calling thread in write order too.
+
+      void generate_parallel( BBox2i const& region_bbox, const ProgressCallback &progress_callback ) {
+        Build build( qtree->get_num_threads() );
+        int32 reported = 0;
+        progress_callback.report_progress(0);
+        try {
+          plan_tile( build, "", region_bbox, node_ptr(), 0, 0.0, 1.0, progress_callback, reported );
+          wait_for_writes( build, build.planned, progress_callback, reported );
+        } catch ( ... ) {
+          {
+            Mutex::Lock lock( build.mutex );
+            build.failed = true; // Queued tasks do nothing from here on
+          }
+          build.workers.join_all();
+          build.writer.join_all();
+          throw;
+        }
+        build.workers.join_all();
+        build.writer.join_all();
+      }
+
+      /// Plans a tile and its children, and queues the tile once it can
+      /// be generated.  Returns false if there is nothing to generate.
+      bool plan_tile( Build& build, std::string const& name, BBox2i const& region_bbox,
+                      node_ptr const& parent, size_t slot, double progress_begin, double progress_end,
+                      const ProgressCallback &progress_callback, int32& reported ) {
+        progress_callback.abort_if_requested();
+
+        node_ptr node( new Node );
+        if( ! start_tile( name, region_bbox, node->info ) )
+          return false;
+        node->parent  = parent;
+        node->slot    = slot;
+        node->pending = 1;
+        node->stored  = ! regenerate( name, region_bbox );
+        if( node->stored ) {
+          build.workers.add_task( boost::shared_ptr<Task>( new TileTask( *this, build, node ) ) );
+          return true;
+        }
+
+        std::vector<std::pair<std::string, BBox2i> > children = qtree->m_branch_func(*qtree, node->info.name, node->info.region_bbox);
+        if( children.empty() ) {
+          // Don't get too far ahead of the writer, so that only a few
+          // finished tiles are held in memory at once.
+          wait_for_writes( build, build.planned + 1 - 8 * qtree->get_num_threads(), progress_callback, reported );
+        }
+        else {
+          node->parts.resize( children.size() );
+          double total_area = (double) node->info.image_bbox.width() * node->info.image_bbox.height();
+          double done = 0;
+          for( size_t i=0; i<children.size(); ++i ) {
+            BBox2i image_bbox = children[i].second;
+            image_bbox.crop( node->info.image_bbox );
+            if( image_bbox.empty() )
+              continue;
+
+            // Progress is divided up the same way generate_branch() does it
+            double share = (double) image_bbox.width() * image_bbox.height() / total_area;
+            {
+              Mutex::Lock lock( build.mutex );
+              ++node->pending;
+            }
+            if( plan_tile( build, children[i].first, children[i].second, node, i,
+                           progress_begin + (progress_end-progress_begin)*done,
+                           progress_begin + (progress_end-progress_begin)*(done+share),
+                           progress_callback, reported ) ) {
+              done += share;
+            } else {
+              Mutex::Lock lock( build.mutex );
+              --node->pending;
+            }
+          }
+        }
+
+        node->index = build.planned++;
+        build.progress.push_back( progress_end );
+        bool ready;
+        {
+          Mutex::Lock lock( build.mutex );
+          ready = ( --node->pending == 0 );
+        }
+        if( ready )
+          build.workers.add_task( boost::shared_ptr<Task>( new TileTask( *this, build, node ) ) );
+        return true;
+      }
+
+      /// Waits until at least count tiles have been written, reporting
+      /// the progress of each one in order.
+      void wait_for_writes( Build& build, int32 count, const ProgressCallback &progress_callback, int32& reported ) {
+        while( true ) {
+          int32 written;
+          {
+            Mutex::Lock lock( build.mutex );
+            while( build.written == reported && build.written < count && ! build.failed )
+              build.written_event.wait( lock );
+            if( build.failed )
+              std::rethrow_exception( build.error );
+            written = build.written;
+          }
+          for( ; reported < written; ++reported )
+            progress_callback.report_progress( build.progress[reported] );
+          progress_callback.abort_if_requested();
+          if( written >= count )
+            return;
+        }
+      }
+
+      void fail( Build& build, std::exception_ptr const& error ) {
+        Mutex::Lock lock( build.mutex );
+        if( ! build.failed ) {
+          build.failed = true;
+          build.error  = error;
+        }
+        build.written_event.notify_all();
+      }
+
+      /// Generates a tile, hands it to its parent and queues it for writing
+      void make_tile( Build& build, node_ptr const& node ) {
+        {
+          Mutex::Lock lock( build.mutex );
+          if( build.failed )
+            return;
+        }
+        try {
+          ImageView<PixelT> image;
+          if( node->stored ) {
+            Mutex::Lock lock( build.io_mutex );
+            image = stored_tile( node->info );
+          }
+          else if( node->parts.empty() ) {
+            image = leaf_image( node->info );
+          }
+          else {
+            image.set_size(qtree->m_tile_size,qtree->m_tile_size);
+            for( size_t i=0; i<node->parts.size(); ++i )
+              if( node->parts[i].second.is_valid_image() )
+                crop(image,node->parts[i].first) = node->parts[i].second;
+            node->parts.clear();
+          }
+
+          if( node->parent ) {
+            BBox2i dst_bbox = child_bbox( node->parent->info, node->info.region_bbox );
+            ImageView<PixelT> part;
+            if( image.is_valid_image() )
+              part = box_subsample( image, elem_quot(qtree->m_tile_size,dst_bbox.size()) );
+            bool ready;
+            {
+              Mutex::Lock lock( build.mutex );
+              node->parent->parts[node->slot] = std::make_pair( dst_bbox, part );
+              ready = ( --node->parent->pending == 0 );
+            }
+            if( ready )
+              build.workers.add_task( boost::shared_ptr<Task>( new TileTask( *this, build, node->parent ) ) );
+          }
+          if( node->stored )
+            return;
+
+          ImageView<PixelT> cropped_image = finish_tile( node->info, image );
+          build.writer.add_task( boost::shared_ptr<Task>( new WriteTask( *this, build, node, cropped_image ) ), node->index );
+        } catch ( ... ) {
+          fail( build, std::current_exception() );
+        }
+      }
+
+      void write_node( Build& build, node_ptr const& node, ImageView<PixelT> const& cropped_image ) {
+        {
+          Mutex::Lock lock( build.mutex );
+          if( build.failed )
+            return;
+        }
+        try {
+          Mutex::Lock lock( build.io_mutex );
+          write_tile( node->info, cropped_image );
+        } catch ( ... ) {
+          fail( build, std::current_exception() );
+          return;
+        }
+        Mutex::Lock lock( build.mutex );
+        ++build.written;
+        build.written_event.notify_all();
       }
     }; // End class Processor
 
@@ -338,8 +784,12 @@ namespace mosaic {
     int32       m_tile_size;
     std::string m_file_type;
     BBox2i      m_crop_bbox;
+    BBox2i      m_dirty_bbox;
+    std::string m_manifest_file;
+    boost::shared_ptr<Manifest> m_manifest; // While generating
     bool        m_crop_images;
     bool        m_cull_images;
+    int32       m_num_threads;
     Vector2i    m_dimensions;
     boost::shared_ptr<ProcessorBase> m_processor;
 
@@ -347,6 +797,7 @@ namespace mosaic {
     image_path_func_type    m_image_path_func;
     branch_func_type        m_branch_func;
     tile_resource_func_type m_tile_resource_func;
+    tile_reader_func_type   m_tile_reader_func;
     metadata_func_type      m_metadata_func;
     sparse_image_check_type m_sparse_image_check;
   };
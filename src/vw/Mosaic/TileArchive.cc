@@ -0,0 +1,379 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Mosaic/TileArchive.h>
+#include <vw/FileIO/MemoryImageResource.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_array.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The archive starts with a magic number, followed by records.  Each
+// record has a 24 byte header (kind, name length, file type length,
+// reserved, data length), then the name, the file type and the data.
+// close() appends an index record, whose data lists the tiles as
+// (offset, size, name length, file type length, name, file type), and
+// then a trailer with the offset of the index record and another
+// magic number.  Numbers are little-endian.
+
+namespace {
+
+  const char archive_magic[8] = { 'V','W','T','I','L','E','S','1' };
+  const char trailer_magic[8] = { 'V','W','T','I','D','X','0','1' };
+  const vw::uint32 tile_kind  = 0x454c4954; // "TILE"
+  const vw::uint32 index_kind = 0x58444e49; // "INDX"
+  const vw::uint64 header_size = 24, trailer_size = 16;
+
+  void put32( std::string& s, vw::uint32 value ) {
+    for ( int i = 0; i < 4; ++i )
+      s.push_back( char( ( value >> ( 8 * i ) ) & 0xff ) );
+  }
+
+  void put64( std::string& s, vw::uint64 value ) {
+    for ( int i = 0; i < 8; ++i )
+      s.push_back( char( ( value >> ( 8 * i ) ) & 0xff ) );
+  }
+
+  vw::uint32 get32( vw::uint8 const* p ) {
+    vw::uint32 value = 0;
+    for ( int i = 3; i >= 0; --i )
+      value = ( value << 8 ) | p[i];
+    return value;
+  }
+
+  vw::uint64 get64( vw::uint8 const* p ) {
+    vw::uint64 value = 0;
+    for ( int i = 7; i >= 0; --i )
+      value = ( value << 8 ) | p[i];
+    return value;
+  }
+
+  std::string record_header( vw::uint32 kind, std::string const& name, std::string const& filetype, vw::uint64 size ) {
+    std::string header;
+    put32( header, kind );
+    put32( header, vw::uint32( name.size() ) );
+    put32( header, vw::uint32( filetype.size() ) );
+    put32( header, 0 );
+    put64( header, size );
+    return header + name + filetype;
+  }
+
+  void write_all( int fd, vw::uint64 offset, char const* data, size_t size, std::string const& filename ) {
+    while ( size > 0 ) {
+      ssize_t written = ::pwrite( fd, data, size, off_t( offset ) );
+      if ( written < 0 ) {
+        if ( errno == EINTR ) continue;
+        vw::vw_throw( vw::IOErr() << "TileArchive: Failed to write " << filename << ": " << ::strerror( errno ) );
+      }
+      data += written;
+      size -= written;
+      offset += written;
+    }
+  }
+
+  // Keeps the mapping alive for as long as a tile read from it
+  template <class MappingT>
+  struct KeepMapping {
+    boost::shared_ptr<MappingT> mapping;
+    KeepMapping( boost::shared_ptr<MappingT> const& mapping ) : mapping( mapping ) {}
+    void operator()( vw::uint8 const* ) const {}
+  };
+
+  class ArchiveTileResource : public vw::DstImageResource {
+    vw::mosaic::TileArchive& m_archive;
+    std::string m_name, m_filetype;
+    boost::scoped_ptr<vw::DstMemoryImageResource> m_resource;
+  public:
+    ArchiveTileResource( vw::mosaic::TileArchive& archive, std::string const& name, std::string const& filetype,
+                         vw::ImageFormat const& format )
+      : m_archive( archive ), m_name( name ), m_filetype( filetype ),
+        m_resource( vw::DstMemoryImageResource::create( filetype, format ) ) {}
+
+    // Tiles are encoded in one piece, so the tile is complete here
+    void write( vw::ImageBuffer const& buf, vw::BBox2i const& bbox ) {
+      m_resource->write( buf, bbox );
+      m_archive.write( m_name, m_filetype, m_resource->data(), m_resource->size() );
+    }
+    bool has_block_write() const { return false; }
+    bool has_nodata_write() const { return false; }
+    void flush() {}
+  };
+
+} // namespace
+
+namespace vw {
+namespace mosaic {
+
+  class TileArchive::Mapping : private boost::noncopyable {
+    uint8 const* m_data;
+    uint64 m_size;
+  public:
+    Mapping( int fd, uint64 size, std::string const& filename ) : m_data( 0 ), m_size( size ) {
+      void* data = ::mmap( 0, size_t( size ), PROT_READ, MAP_SHARED, fd, 0 );
+      if ( data == MAP_FAILED )
+        vw_throw( IOErr() << "TileArchive: Failed to map " << filename << ": " << ::strerror( errno ) );
+      m_data = static_cast<uint8 const*>( data );
+    }
+    ~Mapping() { ::munmap( const_cast<uint8*>( m_data ), size_t( m_size ) ); }
+    uint8 const* data() const { return m_data; }
+    uint64 size() const { return m_size; }
+  };
+
+  TileArchive::TileArchive( std::string const& filename, bool writable )
+    : m_filename( filename ), m_writable( writable ), m_fd( -1 ), m_end( 0 ),
+      m_sync_interval( 256 ), m_unsynced( 0 ) {
+    m_fd = ::open( filename.c_str(), writable ? ( O_RDWR | O_CREAT ) : O_RDONLY, 0644 );
+    if ( m_fd < 0 )
+      vw_throw( IOErr() << "TileArchive: Failed to open " << filename << ": " << ::strerror( errno ) );
+    try {
+      load();
+    }
+    catch ( ... ) {
+      ::close( m_fd );
+      throw;
+    }
+  }
+
+  TileArchive::~TileArchive() {
+    try {
+      close();
+    }
+    catch ( std::exception const& e ) {
+      vw_out(ErrorMessage) << e.what() << std::endl;
+    }
+  }
+
+  // Loads the index from the trailer if there is a valid one, and
+  // otherwise rebuilds it from the records.  A writable archive loses
+  // its index and anything after the last complete tile, so that new
+  // tiles follow the old ones.
+  void TileArchive::load() {
+    struct stat info;
+    if ( ::fstat( m_fd, &info ) != 0 )
+      vw_throw( IOErr() << "TileArchive: Failed to stat " << m_filename << ": " << ::strerror( errno ) );
+    uint64 size = info.st_size;
+
+    if ( size == 0 && m_writable ) {
+      write_all( m_fd, 0, archive_magic, sizeof(archive_magic), m_filename );
+      m_end = sizeof(archive_magic);
+      return;
+    }
+
+    boost::shared_ptr<Mapping> file;
+    if ( size >= sizeof(archive_magic) )
+      file.reset( new Mapping( m_fd, size, m_filename ) );
+    if ( ! file || std::memcmp( file->data(), archive_magic, sizeof(archive_magic) ) != 0 )
+      vw_throw( IOErr() << "TileArchive: " << m_filename << " is not a tile archive." );
+
+    uint64 end;
+    if ( load_index( file->data(), size ) )
+      end = get64( file->data() + size - trailer_size );
+    else
+      end = scan( file->data(), size );
+
+    if ( ! m_writable ) {
+      m_end = size;
+      m_mapping = file;
+      return;
+    }
+    file.reset();
+    if ( end < size && ::ftruncate( m_fd, off_t( end ) ) != 0 )
+      vw_throw( IOErr() << "TileArchive: Failed to truncate " << m_filename << ": " << ::strerror( errno ) );
+    m_end = end;
+  }
+
+  bool TileArchive::load_index( uint8 const* data, uint64 size ) {
+    if ( size < sizeof(archive_magic) + header_size + trailer_size ||
+         std::memcmp( data + size - sizeof(trailer_magic), trailer_magic, sizeof(trailer_magic) ) != 0 )
+      return false;
+    uint64 offset = get64( data + size - trailer_size );
+    uint64 end = size - trailer_size;
+    if ( offset < sizeof(archive_magic) || offset > end - header_size ||
+         get32( data + offset ) != index_kind || get32( data + offset + 4 ) != 0 || get32( data + offset + 8 ) != 0 ||
+         get64( data + offset + 16 ) != end - offset - header_size )
+      return false;
+
+    index_type index;
+    for ( uint64 pos = offset + header_size; pos < end; ) {
+      if ( end - pos < 24 )
+        return false;
+      Entry entry;
+      entry.offset = get64( data + pos );
+      entry.size = get64( data + pos + 8 );
+      uint64 name_size = get32( data + pos + 16 );
+      uint64 type_size = get32( data + pos + 20 );
+      pos += 24;
+      if ( end - pos < name_size + type_size || entry.offset > offset || offset - entry.offset < entry.size )
+        return false;
+      std::string name( reinterpret_cast<char const*>( data + pos ), size_t( name_size ) );
+      entry.filetype.assign( reinterpret_cast<char const*>( data + pos + name_size ), size_t( type_size ) );
+      pos += name_size + type_size;
+      index[name] = entry;
+    }
+    m_index.swap( index );
+    return true;
+  }
+
+  // Returns the end of the last complete tile record
+  uint64 TileArchive::scan( uint8 const* data, uint64 size ) {
+    uint64 pos = sizeof(archive_magic);
+    while ( size - pos >= header_size && get32( data + pos ) == tile_kind ) {
+      uint64 name_size = get32( data + pos + 4 );
+      uint64 type_size = get32( data + pos + 8 );
+      uint64 data_size = get64( data + pos + 16 );
+      uint64 remaining = size - pos - header_size;
+      if ( remaining < name_size + type_size || remaining - name_size - type_size < data_size )
+        break;
+      Entry entry;
+      entry.filetype.assign( reinterpret_cast<char const*>( data + pos + header_size + name_size ), size_t( type_size ) );
+      entry.offset = pos + header_size + name_size + type_size;
+      entry.size = data_size;
+      m_index[std::string( reinterpret_cast<char const*>( data + pos + header_size ), size_t( name_size ) )] = entry;
+      pos = entry.offset + data_size;
+    }
+    return pos;
+  }
+
+  void TileArchive::close() {
+    Mutex::Lock lock( m_mutex );
+    if ( m_fd < 0 )
+      return;
+    int fd = m_fd;
+    m_fd = -1;
+    m_mapping.reset();
+
+    if ( m_writable ) {
+      std::string index;
+      for ( index_type::const_iterator it = m_index.begin(); it != m_index.end(); ++it ) {
+        put64( index, it->second.offset );
+        put64( index, it->second.size );
+        put32( index, uint32( it->first.size() ) );
+        put32( index, uint32( it->second.filetype.size() ) );
+        index += it->first;
+        index += it->second.filetype;
+      }
+      std::string record = record_header( index_kind, "", "", index.size() ) + index;
+      put64( record, m_end );
+      record.append( trailer_magic, sizeof(trailer_magic) );
+      try {
+        write_all( fd, m_end, record.data(), record.size(), m_filename );
+        if ( ::fsync( fd ) != 0 )
+          vw_throw( IOErr() << "TileArchive: Failed to sync " << m_filename << ": " << ::strerror( errno ) );
+      }
+      catch ( ... ) {
+        ::close( fd );
+        throw;
+      }
+      m_end += record.size();
+    }
+    if ( ::close( fd ) != 0 )
+      vw_throw( IOErr() << "TileArchive: Failed to close " << m_filename << ": " << ::strerror( errno ) );
+  }
+
+  void TileArchive::write( std::string const& name, std::string const& filetype, uint8 const* data, size_t size ) {
+    Mutex::Lock lock( m_mutex );
+    VW_ASSERT( m_writable && m_fd >= 0, IOErr() << "TileArchive: " << m_filename << " is not open for writing." );
+
+    std::string header = record_header( tile_kind, name, filetype, size );
+    write_all( m_fd, m_end, header.data(), header.size(), m_filename );
+    write_all( m_fd, m_end + header.size(), reinterpret_cast<char const*>( data ), size, m_filename );
+
+    Entry& entry = m_index[name];
+    entry.filetype = filetype;
+    entry.offset = m_end + header.size();
+    entry.size = size;
+    m_end = entry.offset + size;
+
+    if ( m_sync_interval > 0 && ++m_unsynced >= m_sync_interval ) {
+      if ( ::fsync( m_fd ) != 0 )
+        vw_throw( IOErr() << "TileArchive: Failed to sync " << m_filename << ": " << ::strerror( errno ) );
+      m_unsynced = 0;
+    }
+  }
+
+  bool TileArchive::find( std::string const& name, Entry& entry ) const {
+    Mutex::Lock lock( m_mutex );
+    index_type::const_iterator it = m_index.find( name );
+    if ( it == m_index.end() )
+      return false;
+    entry = it->second;
+    return true;
+  }
+
+  size_t TileArchive::size() const {
+    Mutex::Lock lock( m_mutex );
+    return m_index.size();
+  }
+
+  // Maps the file again when it has grown past the current mapping.
+  // Tiles that are still open keep the old mapping alive.
+  boost::shared_ptr<TileArchive::Mapping> TileArchive::mapping( uint64 end ) const {
+    if ( ! m_mapping || m_mapping->size() < end ) {
+      VW_ASSERT( m_fd >= 0, IOErr() << "TileArchive: " << m_filename << " is closed." );
+      m_mapping.reset( new Mapping( m_fd, m_end, m_filename ) );
+    }
+    return m_mapping;
+  }
+
+  boost::shared_ptr<SrcImageResource> TileArchive::open_tile( std::string const& name, std::string const& filetype ) const {
+    Mutex::Lock lock( m_mutex );
+    index_type::const_iterator it = m_index.find( name );
+    if ( it == m_index.end() || it->second.filetype != filetype )
+      return boost::shared_ptr<SrcImageResource>();
+    Entry const& entry = it->second;
+    boost::shared_ptr<Mapping> file = mapping( entry.offset + entry.size );
+    boost::shared_array<const uint8> data( file->data() + entry.offset, KeepMapping<Mapping>( file ) );
+    return boost::shared_ptr<SrcImageResource>( SrcMemoryImageResource::open( filetype, data, size_t( entry.size ) ) );
+  }
+
+  std::string TileArchive::tile_name( int32 level, int32 x, int32 y ) {
+    std::string name;
+    for ( int32 bit = level - 1; bit >= 0; --bit )
+      name.push_back( char( '0' + ( ( x >> bit ) & 1 ) + 2 * ( ( y >> bit ) & 1 ) ) );
+    return name;
+  }
+
+  void TileArchive::attach( QuadTreeGenerator& qtree ) {
+    qtree.set_tile_resource_func( boost::bind( &TileArchive::tile_resource, this, _1, _2, _3 ) );
+    qtree.set_tile_reader_func( boost::bind( &TileArchive::tile_reader, this, _1, _2 ) );
+  }
+
+  void TileArchive::attach( QuadTreeGenerator& qtree, QuadTreeConfig const& config ) {
+    if ( !config.supports_tile_archive() )
+      vw_throw( NoImplErr() << "TileArchive: The quadtree config does not support tile archives, "
+                << "because its metadata refers to the tile files." );
+    attach( qtree );
+  }
+
+  boost::shared_ptr<DstImageResource> TileArchive::tile_resource( QuadTreeGenerator const&, QuadTreeGenerator::TileInfo const& info,
+                                                                  ImageFormat const& format ) {
+    return boost::shared_ptr<DstImageResource>( new ArchiveTileResource( *this, info.name, info.filetype, format ) );
+  }
+
+  boost::shared_ptr<SrcImageResource> TileArchive::tile_reader( QuadTreeGenerator const&, QuadTreeGenerator::TileInfo const& info ) const {
+    return open_tile( info.name, info.filetype );
+  }
+
+}} // namespace vw::mosaic
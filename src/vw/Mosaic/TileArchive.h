@@ -0,0 +1,141 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file TileArchive.h
+///
+/// A single file that holds the tiles of a quadtree, as an alternative
+/// to writing every tile to a file of its own.
+///
+#ifndef __VW_MOSAIC_TILEARCHIVE_H__
+#define __VW_MOSAIC_TILEARCHIVE_H__
+
+#include <string>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <vw/Core/Thread.h>
+#include <vw/Mosaic/QuadTreeGenerator.h>
+#include <vw/Mosaic/QuadTreeConfig.h>
+
+namespace vw {
+namespace mosaic {
+
+  /// A file of encoded tiles, indexed by tile name.
+  ///
+  /// Tiles are only ever appended to the file.  Each one is stored as
+  /// a record holding its name, file type and encoded bytes, so the
+  /// index can always be rebuilt by reading the records in order.  A
+  /// copy of the index is appended by close(), and opening an archive
+  /// that ends in one just loads it.  Writing a tile again appends a
+  /// new record that replaces the old one in the index.
+  ///
+  /// To write a tree into an archive, configure the QuadTreeGenerator
+  /// as usual and then call attach().  The tiles go into the archive
+  /// instead of the files named by the image path function, replacing
+  /// any tile writer the config set up; metadata files are still
+  /// written as before.  This only works with a QuadTreeConfig whose
+  /// supports_tile_archive() is true, which KML's is not, so pass the
+  /// config to attach() when there is one.  Tiles
+  /// are encoded with DstMemoryImageResource, so only the file types
+  /// it supports can be archived.
+  ///
+  /// Tiles are read through memory maps of the file, without copying.
+  class TileArchive : private boost::noncopyable {
+  public:
+    struct Entry {
+      std::string filetype;
+      uint64 offset, size;
+    };
+
+    /// Opens an archive.  A writable archive is created if it doesn't
+    /// exist yet, and is appended to otherwise.
+    TileArchive( std::string const& filename, bool writable = false );
+
+    /// Closes the archive, see close().  Errors are only logged.
+    ~TileArchive();
+
+    /// Appends the index to a writable archive, syncs it to disk and
+    /// closes it.  Nothing can be written afterwards.
+    void close();
+
+    /// Appends a tile.  The file is synced to disk every
+    /// get_sync_interval() tiles, and when it is closed.
+    void write( std::string const& name, std::string const& filetype, uint8 const* data, size_t size );
+
+    /// Looks a tile up by name.
+    bool find( std::string const& name, Entry& entry ) const;
+
+    /// Looks a tile of a standard quadtree up by level and position.
+    bool find( int32 level, int32 x, int32 y, Entry& entry ) const {
+      return find( tile_name( level, x, y ), entry );
+    }
+
+    /// Opens a tile for reading, or returns an empty pointer if there
+    /// is no tile with that name and file type.
+    boost::shared_ptr<SrcImageResource> open_tile( std::string const& name, std::string const& filetype ) const;
+
+    /// The number of tiles in the archive.
+    size_t size() const;
+
+    std::string const& filename() const { return m_filename; }
+
+    int32 get_sync_interval() const { return m_sync_interval; }
+    void set_sync_interval( int32 tiles ) { m_sync_interval = tiles; }
+
+    /// The name of the tile at the given position of a level of a
+    /// standard quadtree, where level 0 is the root tile and (0,0) is
+    /// the top-left tile of every level.
+    static std::string tile_name( int32 level, int32 x, int32 y );
+
+    /// Makes the generator write its tiles into this archive, and read
+    /// existing tiles back from it.  The archive must outlive the
+    /// generation.
+    void attach( QuadTreeGenerator& qtree );
+
+    /// Same as above for a generator set up by config.  Throws
+    /// NoImplErr if the config's metadata needs the tile files.
+    void attach( QuadTreeGenerator& qtree, QuadTreeConfig const& config );
+
+    boost::shared_ptr<DstImageResource> tile_resource( QuadTreeGenerator const& qtree, QuadTreeGenerator::TileInfo const& info,
+                                                       ImageFormat const& format );
+    boost::shared_ptr<SrcImageResource> tile_reader( QuadTreeGenerator const& qtree, QuadTreeGenerator::TileInfo const& info ) const;
+
+  private:
+    class Mapping;
+    typedef boost::unordered_map<std::string, Entry> index_type;
+
+    void load();
+    bool load_index( uint8 const* data, uint64 size );
+    uint64 scan( uint8 const* data, uint64 size );
+    boost::shared_ptr<Mapping> mapping( uint64 end ) const;
+
+    std::string m_filename;
+    bool m_writable;
+    int m_fd;
+    uint64 m_end;
+    int32 m_sync_interval, m_unsynced;
+    index_type m_index;
+    mutable boost::shared_ptr<Mapping> m_mapping;
+    mutable Mutex m_mutex;
+  };
+
+}} // namespace vw::mosaic
+
+#endif // __VW_MOSAIC_TILEARCHIVE_H__
@@ -46,11 +46,26 @@ namespace mosaic {
     }
 
   public:
-    // We only provide a constructor for image *creation*, at least for now.
+    // Creates a terrain tile
     UniviewTerrainResource( std::string const& filename, ImageFormat const& format )
       : DiskImageResourcePNG( filename, make_uint16(format) )
     {}
 
+    // Opens an existing terrain tile
+    UniviewTerrainResource( std::string const& filename )
+      : DiskImageResourcePNG( filename )
+    {}
+
+    // The reverse of write(): we read the uint16 data and reinterpret it
+    // as signed int16 before converting it to the requested type.
+    void read( ImageBuffer const& dst, BBox2i const& bbox ) const {
+      ImageView<PixelGray<uint16> > im_buf( bbox.width(), bbox.height() );
+      ImageBuffer buffer = im_buf.buffer();
+      DiskImageResourcePNG::read( buffer, bbox );
+      buffer.format.channel_type = VW_CHANNEL_INT16;
+      convert( dst, buffer );
+    }
+
     // First we convert to single-channel signed int16, then we spoof that as
     // uint16 data and pass it along to DiskImageResourcePNG to write.
     void write( ImageBuffer const& src, BBox2i const& bbox ) {
@@ -96,9 +111,20 @@ namespace mosaic {
   }
 
 
+  boost::shared_ptr<SrcImageResource> UniviewQuadTreeConfig::terrain_tile_reader( QuadTreeGenerator const& /*qtree*/, QuadTreeGenerator::TileInfo const& info ) {
+    std::string filename = info.filepath + info.filetype;
+    if( ! exists( fs::path( filename ) ) )
+      return boost::shared_ptr<SrcImageResource>();
+    return boost::shared_ptr<SrcImageResource>( new UniviewTerrainResource( filename ) );
+  }
+
+
   void UniviewQuadTreeConfig::configure( QuadTreeGenerator &qtree ) const {
     qtree.set_image_path_func( &image_path );
-    if( m_terrain ) qtree.set_tile_resource_func( &terrain_tile_resource );
+    if( m_terrain ) {
+      qtree.set_tile_resource_func( &terrain_tile_resource );
+      qtree.set_tile_reader_func( &terrain_tile_reader );
+    }
     qtree.set_metadata_func( boost::bind(&UniviewQuadTreeConfig::metadata_func,this,_1,_2) );
   }
 
@@ -16,12 +16,15 @@
 // __END_LICENSE__
 
 
-#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
 #include <vw/Mosaic/ImageComposite.h>
 
+#include <sstream>
+
 using namespace std;
 using namespace vw;
 using namespace vw::mosaic;
+using namespace vw::test;
 
 ImageView<uint32> make(uint32 x) {
   ImageView<uint32> img(8,8);
@@ -50,3 +53,130 @@ TEST(TestImageComposite, Basic) {
       EXPECT_EQ(2, c(col, row)) << "at (" << col << "," << row << ")";
   }
 }
+
+TEST(TestImageComposite, DraftManySources) {
+  // Scattered sources of a few sizes, and one that covers most of
+  // the rest, over an area larger than a patch piece
+  ImageComposite<uint32> c;
+  ImageView<uint32> expected(1100, 700);
+  vector<BBox2i> bboxes;
+  for (uint32 i = 0; i < 300; ++i) {
+    int32 size = ( i == 150 ) ? 600 : 8 + int32(i % 5) * 7;
+    bboxes.push_back(BBox2i(int32(i * 397 % 1050), int32(i * 211 % 650), size, size));
+    bboxes.back().crop(bounding_box(expected));
+    ImageView<uint32> image(bboxes.back().width(), bboxes.back().height());
+    fill(image, i + 1);
+    c.insert(image, bboxes.back().min().x(), bboxes.back().min().y());
+    fill(crop(expected, bboxes.back()), i + 1);
+  }
+  c.set_draft_mode(true);
+  c.prepare(BBox2i(0, 0, 1100, 700));
+
+  for (int32 num_threads = 1; num_threads <= 4; num_threads += 3) {
+    c.set_num_threads(num_threads);
+    ImageView<uint32> all = c.generate_patch(BBox2i(0, 0, 1100, 700));
+    ImageView<uint32> part = c.generate_patch(BBox2i(301, 97, 33, 45));
+    int32 bad = 0;
+    for (int32 row = 0; row < 700; ++row)
+      for (int32 col = 0; col < 1100; ++col)
+        bad += ( all(col, row) != expected(col, row) );
+    for (int32 row = 0; row < 45; ++row)
+      for (int32 col = 0; col < 33; ++col)
+        bad += ( part(col, row) != expected(301 + col, 97 + row) );
+    EXPECT_EQ(0, bad) << num_threads << " threads";
+    EXPECT_TRUE (c.sparse_check(BBox2i(0, 0, 20, 20)));
+  }
+}
+
+typedef PixelRGBA<float32> BlendPx;
+
+static ImageView<BlendPx> blend_source(int32 cols, int32 rows, int32 seed) {
+  ImageView<BlendPx> image(cols, rows);
+  for (int32 row = 0; row < rows; ++row)
+    for (int32 col = 0; col < cols; ++col) {
+      float32 a = ( col > 3 && row > 2 && col < cols - 2 && row < rows - 5 ) ? 1.0f : ( (col + row) % 3 ? 0.5f : 0.0f );
+      image(col, row) = BlendPx(a * float32((col * 7 + row * 13 + seed) % 101) / 101.0f,
+                                a * float32((col * 3 + seed * 5) % 53) / 53.0f,
+                                a * float32((row * 11 + seed) % 37) / 37.0f, a);
+    }
+  return image;
+}
+
+static void blend_composite(ImageComposite<BlendPx>& c) {
+  // A long strip, so that small patches use pyramids of part of it,
+  // under a row of smaller images
+  c.insert(blend_source(1500, 130, 1), 0, 40);
+  for (int32 i = 0; i < 6; ++i)
+    c.insert(blend_source(100 + i * 3, 100 + i, i + 2), 37 + i * 231, (i % 2) * 90);
+  c.prepare();
+}
+
+TEST(TestImageComposite, BlendPatches) {
+  vector<UnlinkName> masks;
+  for (int32 i = 0; i < 7; ++i) {
+    ostringstream name;
+    name << "mask." << i << ".png";
+    masks.push_back(UnlinkName(name.str(), "."));
+  }
+
+  // Small patches of the strip are made from pyramids of just the
+  // part of it they need, unless its full pyramid is cached.
+  ImageComposite<BlendPx> whole, tiled, threaded;
+  blend_composite(whole);
+  blend_composite(tiled);
+  blend_composite(threaded);
+  threaded.set_num_threads(4);
+  BBox2i bbox(0, 0, whole.cols(), whole.rows());
+  ImageView<BlendPx> expected = whole.generate_patch(bbox);
+  ImageView<BlendPx> parallel = threaded.generate_patch(bbox);
+
+  int32 bad = 0;
+  for (int32 y = 0; y < bbox.height(); y += 64)
+    for (int32 x = 0; x < bbox.width(); x += 64) {
+      BBox2i tile(x, y, std::min(64, bbox.width() - x), std::min(64, bbox.height() - y));
+      ImageView<BlendPx> full = whole.generate_patch(tile);
+      ImageView<BlendPx> part = tiled.generate_patch(tile);
+      for (int32 row = 0; row < tile.height(); ++row)
+        for (int32 col = 0; col < tile.width(); ++col)
+          for (int32 ch = 0; ch < 4; ++ch) {
+            float32 e = full(col, row)[ch], a = part(col, row)[ch];
+            bad += ( e == e ) ? !( fabs(e - a) < 1e-5 ) : ( a == a );
+          }
+    }
+  for (int32 row = 0; row < bbox.height(); ++row)
+    for (int32 col = 0; col < bbox.width(); ++col)
+      for (int32 ch = 0; ch < 4; ++ch) {
+        float32 e = expected(col, row)[ch], p = parallel(col, row)[ch];
+        bad += ( e == e ) ? !( fabs(e - p) < 1e-5 ) : ( p == p );
+      }
+  EXPECT_EQ(0, bad);
+}
+
+// Fails once armed, as a source that can no longer be read would
+struct FailWhenArmed : ReturnFixedType<BlendPx> {
+  bool const* armed;
+  FailWhenArmed(bool const* armed) : armed(armed) {}
+  BlendPx operator()(BlendPx const& pix) const {
+    if (*armed)
+      vw_throw(ArgumentErr() << "FailWhenArmed: bad source.");
+    return pix;
+  }
+};
+
+TEST(TestImageComposite, PatchErrors) {
+  // The exception of a patch piece or a source pyramid reaches the
+  // caller, with its type
+  for (int32 draft = 0; draft < 2; ++draft) {
+    bool armed = false;
+    ImageComposite<BlendPx> c;
+    ImageView<BlendPx> good = blend_source(700, 600, 1), bad = blend_source(700, 600, 2);
+    c.insert(good, 0, 0);
+    c.insert(per_pixel_filter(bad, FailWhenArmed(&armed)), 300, 0);
+    c.set_draft_mode(draft);
+    c.set_num_threads(4);
+    c.prepare();
+    armed = true;
+    EXPECT_THROW(c.generate_patch(BBox2i(0, 0, 1000, 600)), ArgumentErr) << draft;
+    EXPECT_THROW(c.generate_patch(BBox2i(250, 0, 300, 300)), ArgumentErr) << draft;
+  }
+}
@@ -0,0 +1,272 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <test/Helpers.h>
+#include <vw/Mosaic/QuadTreeGenerator.h>
+
+#include <boost/bind.hpp>
+#include <boost/filesystem/operations.hpp>
+
+using namespace std;
+using namespace vw;
+using namespace vw::mosaic;
+using namespace vw::test;
+
+typedef PixelRGBA<uint8> Px;
+
+// Keeps the tiles in memory instead of writing them to disk
+class TileRecorder {
+  class Resource : public DstImageResource {
+    ImageView<Px>& m_image;
+  public:
+    Resource( ImageView<Px>& image, ImageFormat const& format ) : m_image( image ) {
+      m_image.set_size( format.cols, format.rows );
+    }
+    void write( ImageBuffer const& buf, BBox2i const& /*bbox*/ ) { convert( m_image.buffer(), buf ); }
+    bool has_block_write() const { return false; }
+    bool has_nodata_write() const { return false; }
+    void flush() {}
+  };
+
+  class StoredTile : public SrcImageResource {
+    ImageView<Px> m_image;
+  public:
+    StoredTile( ImageView<Px> const& image ) : m_image( image ) {}
+    ImageFormat format() const { return m_image.format(); }
+    void read( ImageBuffer const& buf, BBox2i const& bbox ) const {
+      ImageView<Px> block = crop( m_image, bbox );
+      convert( buf, block.buffer() );
+    }
+    bool has_block_read() const { return false; }
+    bool has_nodata_read() const { return false; }
+  };
+
+  // Notes when two of the tile functions run at the same time
+  class Busy {
+    TileRecorder& m_recorder;
+  public:
+    Busy( TileRecorder& recorder ) : m_recorder( recorder ) {
+      Mutex::Lock lock( m_recorder.busy_mutex );
+      if ( m_recorder.busy++ )
+        m_recorder.concurrent = true;
+    }
+    ~Busy() {
+      Mutex::Lock lock( m_recorder.busy_mutex );
+      --m_recorder.busy;
+    }
+  };
+
+  Mutex busy_mutex;
+  int32 busy;
+
+public:
+  map<string, ImageView<Px> > tiles;
+  vector<string> order;
+  vector<BBox2i> image_bboxes;
+  bool concurrent; // Set if the tile functions were ever called concurrently
+
+  boost::shared_ptr<DstImageResource> resource( QuadTreeGenerator const&, QuadTreeGenerator::TileInfo const& info,
+                                                ImageFormat const& format ) {
+    Busy busy( *this );
+    return boost::shared_ptr<DstImageResource>( new Resource( tiles[info.filepath + info.filetype], format ) );
+  }
+
+  boost::shared_ptr<SrcImageResource> reader( QuadTreeGenerator const&, QuadTreeGenerator::TileInfo const& info ) {
+    Busy busy( *this );
+    Thread::sleep_ms( 1 ); // Give an overlapping call the chance to happen
+    map<string, ImageView<Px> >::const_iterator it = tiles.find( info.filepath + info.filetype );
+    if ( it == tiles.end() )
+      return boost::shared_ptr<SrcImageResource>();
+    return boost::shared_ptr<SrcImageResource>( new StoredTile( it->second ) );
+  }
+
+  // Fails after writing this many more tiles
+  int32 fail_after;
+  TileRecorder() : busy( 0 ), concurrent( false ), fail_after( -1 ) {}
+
+  void metadata( QuadTreeGenerator const&, QuadTreeGenerator::TileInfo const& info ) {
+    Busy busy( *this );
+    if ( fail_after == 0 )
+      vw_throw( IOErr() << "Interrupted" );
+    --fail_after;
+    order.push_back( info.name );
+    image_bboxes.push_back( info.image_bbox );
+  }
+};
+
+class ProgressRecorder : public ProgressCallback {
+public:
+  mutable vector<double> values;
+  void report_progress( double progress ) const {
+    values.push_back( progress );
+    ProgressCallback::report_progress( progress );
+  }
+};
+
+static ImageView<Px> test_image( int32 cols, int32 rows ) {
+  ImageView<Px> image( cols, rows );
+  for ( int32 row = 0; row < rows; ++row )
+    for ( int32 col = 0; col < cols; ++col )
+      image( col, row ) = Px( col % 251, row % 241, ( col * row ) % 239, ( col + row ) % 7 ? 255 : 0 );
+  return image;
+}
+
+static void generate( ImageView<Px> const& image, int32 num_threads, bool crop,
+                      TileRecorder& recorder, ProgressRecorder& progress,
+                      BBox2i const& dirty_bbox = BBox2i(), std::string const& manifest = "" ) {
+  QuadTreeGenerator qtree( image, "tree" );
+  qtree.set_dirty_bbox( dirty_bbox );
+  qtree.set_manifest_file( manifest );
+  qtree.set_tile_reader_func( boost::bind( &TileRecorder::reader, &recorder, _1, _2 ) );
+  qtree.set_tile_size( 32 );
+  qtree.set_file_type( "auto" );
+  qtree.set_crop_images( crop );
+  qtree.set_num_threads( num_threads );
+  qtree.set_tile_resource_func( boost::bind( &TileRecorder::resource, &recorder, _1, _2, _3 ) );
+  qtree.set_metadata_func( boost::bind( &TileRecorder::metadata, &recorder, _1, _2 ) );
+  qtree.generate( progress );
+}
+
+static void expect_same_tiles( TileRecorder const& expected, TileRecorder const& actual ) {
+  ASSERT_EQ( expected.tiles.size(), actual.tiles.size() );
+  for ( map<string, ImageView<Px> >::const_iterator it = expected.tiles.begin(); it != expected.tiles.end(); ++it ) {
+    map<string, ImageView<Px> >::const_iterator other = actual.tiles.find( it->first );
+    ASSERT_TRUE( other != actual.tiles.end() ) << it->first;
+    ImageView<Px> const& a = it->second;
+    ImageView<Px> const& b = other->second;
+    ASSERT_EQ( a.cols(), b.cols() ) << it->first;
+    ASSERT_EQ( a.rows(), b.rows() ) << it->first;
+    for ( int32 row = 0; row < a.rows(); ++row )
+      for ( int32 col = 0; col < a.cols(); ++col )
+        EXPECT_EQ( a( col, row ), b( col, row ) ) << it->first;
+  }
+}
+
+TEST( QuadTreeGenerator, ParallelMatchesSerial ) {
+  ImageView<Px> image = test_image( 201, 130 );
+  for ( int crop = 0; crop < 2; ++crop ) {
+    TileRecorder serial, parallel;
+    ProgressRecorder serial_progress, parallel_progress;
+    generate( image, 1, crop, serial, serial_progress );
+    generate( image, 4, crop, parallel, parallel_progress );
+
+    // Same tiles, written in the same order
+    ASSERT_EQ( serial.order.size(), parallel.order.size() );
+    EXPECT_EQ( serial.order, parallel.order );
+    EXPECT_EQ( serial.image_bboxes, parallel.image_bboxes );
+    expect_same_tiles( serial, parallel );
+
+    // One report per tile, in write order, ending where the serial
+    // generator ends
+    ASSERT_EQ( parallel.order.size() + 1, parallel_progress.values.size() );
+    for ( size_t i = 1; i < parallel_progress.values.size(); ++i )
+      EXPECT_LE( parallel_progress.values[i-1], parallel_progress.values[i] );
+    EXPECT_DOUBLE_EQ( serial_progress.values.back(), parallel_progress.values.back() );
+  }
+}
+
+static void fail_metadata( QuadTreeGenerator const&, QuadTreeGenerator::TileInfo const& ) {
+  vw_throw( ArgumentErr() << "fail_metadata: bad tile." );
+}
+
+TEST( QuadTreeGenerator, ParallelErrors ) {
+  ImageView<Px> image = test_image( 100, 100 );
+  QuadTreeGenerator qtree( image, "tree" );
+  qtree.set_tile_size( 16 );
+  qtree.set_num_threads( 3 );
+  qtree.set_tile_resource_func( QuadTreeGenerator::tile_resource_func_type() );
+  EXPECT_THROW( qtree.generate(), boost::bad_function_call );
+
+  // The exception of the writer reaches the caller, with its type
+  TileRecorder recorder;
+  qtree.set_tile_resource_func( boost::bind( &TileRecorder::resource, &recorder, _1, _2, _3 ) );
+  qtree.set_metadata_func( fail_metadata );
+  EXPECT_THROW( qtree.generate(), ArgumentErr );
+}
+
+TEST( QuadTreeGenerator, Incremental ) {
+  ImageView<Px> before = test_image( 201, 130 );
+  ImageView<Px> after = copy( before );
+  BBox2i dirty( 150, 20, 30, 40 );
+  fill( crop( after, dirty ), Px( 10, 20, 30, 255 ) );
+
+  for ( int32 num_threads = 1; num_threads <= 4; num_threads += 3 ) {
+    UnlinkName manifest( "TestQuadTreeGenerator.manifest" );
+    TileRecorder full, incremental;
+    ProgressRecorder progress;
+    generate( after, num_threads, true, full, progress );
+    generate( before, num_threads, true, incremental, progress, BBox2i(), manifest );
+    size_t all_tiles = incremental.order.size();
+
+    // Only the tiles over the changed region and their ancestors are
+    // written again, and the result is the same as a full rebuild.
+    incremental.order.clear();
+    generate( after, num_threads, true, incremental, progress, dirty, manifest );
+    EXPECT_LT( incremental.order.size(), all_tiles / 4 );
+    EXPECT_EQ( 1, count( incremental.order.begin(), incremental.order.end(), "" ) );
+    EXPECT_FALSE( incremental.concurrent );
+    expect_same_tiles( full, incremental );
+  }
+}
+
+TEST( QuadTreeGenerator, Resume ) {
+  ImageView<Px> image = test_image( 201, 130 );
+  for ( int32 num_threads = 1; num_threads <= 4; num_threads += 3 ) {
+    UnlinkName manifest( "TestQuadTreeGenerator.manifest" );
+    TileRecorder full, resumed;
+    ProgressRecorder progress;
+    generate( image, num_threads, true, full, progress );
+
+    resumed.fail_after = 10;
+    EXPECT_THROW( generate( image, num_threads, true, resumed, progress, BBox2i(), manifest ), IOErr );
+    EXPECT_EQ( 10u, resumed.order.size() );
+
+    // The restarted run skips the tiles that were already written
+    resumed.fail_after = -1;
+    resumed.order.clear();
+    generate( image, num_threads, true, resumed, progress, BBox2i(), manifest );
+    EXPECT_EQ( full.order.size() - 10, resumed.order.size() );
+    expect_same_tiles( full, resumed );
+
+    // Once a run is finished it isn't resumed again
+    resumed.order.clear();
+    generate( image, num_threads, true, resumed, progress, BBox2i(), manifest );
+    EXPECT_EQ( full.order.size(), resumed.order.size() );
+  }
+}
+
+TEST( QuadTreeGenerator, AutoFileTypeChanges ) {
+  // A tile that turns from a png into a jpg, or back, between runs
+  // doesn't leave its old file behind.
+  UnlinkName tree( "TestQuadTreeGenerator.qtree" );
+  ImageView<Px> opaque( 32, 32 );
+  fill( opaque, Px( 10, 20, 30, 255 ) );
+  ImageView<Px> transparent = copy( opaque );
+  transparent( 5, 5 ) = Px();
+
+  ImageView<Px> const* runs[] = { &transparent, &opaque, &transparent };
+  for ( int32 run = 0; run < 3; ++run ) {
+    QuadTreeGenerator qtree( *runs[run], tree );
+    qtree.set_tile_size( 32 );
+    qtree.set_file_type( "auto" );
+    qtree.generate();
+    bool png = ( runs[run] == &transparent );
+    EXPECT_EQ( png,  boost::filesystem::exists( tree + "/r.png" ) ) << run;
+    EXPECT_EQ( !png, boost::filesystem::exists( tree + "/r.jpg" ) ) << run;
+  }
+}
@@ -0,0 +1,207 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <test/Helpers.h>
+#include <vw/Mosaic/TileArchive.h>
+#include <vw/Mosaic/QuadTreeConfig.h>
+#include <vw/FileIO/DiskImageResource.h>
+
+#include <fstream>
+
+#include <boost/bind.hpp>
+#include <boost/filesystem/operations.hpp>
+
+using namespace std;
+using namespace vw;
+using namespace vw::mosaic;
+using namespace vw::test;
+
+namespace fs = boost::filesystem;
+
+typedef PixelRGBA<uint8> Px;
+
+// Transparent pixels are black, so that the tiles survive the trip
+// through an unpremultiplied PNG file unchanged
+static ImageView<Px> test_image( int32 cols, int32 rows ) {
+  ImageView<Px> image( cols, rows );
+  for ( int32 row = 0; row < rows; ++row )
+    for ( int32 col = 0; col < cols; ++col )
+      if ( ( col + row ) % 7 )
+        image( col, row ) = Px( col % 251, row % 241, ( col * row ) % 239, 255 );
+  return image;
+}
+
+static void record_tile( map<string, string>& tiles, QuadTreeGenerator const&, QuadTreeGenerator::TileInfo const& info ) {
+  if ( fs::exists( info.filepath + info.filetype ) )
+    tiles[info.name] = info.filepath + info.filetype;
+}
+
+static void generate( QuadTreeGenerator& qtree, int32 num_threads ) {
+  qtree.set_tile_size( 32 );
+  qtree.set_file_type( "png" );
+  qtree.set_crop_images( true );
+  qtree.set_num_threads( num_threads );
+  qtree.generate();
+}
+
+static string archived_bytes( string const& filename, TileArchive::Entry const& entry ) {
+  ifstream file( filename.c_str(), ios::binary );
+  file.seekg( entry.offset );
+  string bytes( entry.size, '\0' );
+  file.read( &bytes[0], entry.size );
+  return bytes;
+}
+
+static void write_tile( TileArchive& archive, string const& name, string const& bytes ) {
+  archive.write( name, ".raw", reinterpret_cast<uint8 const*>( bytes.data() ), bytes.size() );
+}
+
+TEST( TileArchive, QuadTree ) {
+  ImageView<Px> before = test_image( 201, 130 );
+  ImageView<Px> after = copy( before );
+  BBox2i dirty( 150, 20, 30, 40 );
+  fill( crop( after, dirty ), Px( 10, 20, 30, 255 ) );
+
+  UnlinkName dir( "TestTileArchive.tree" );
+  UnlinkName filename( "TestTileArchive.tiles" );
+  UnlinkName manifest( "TestTileArchive.manifest" );
+
+  map<string, string> expected;
+  {
+    QuadTreeGenerator qtree( after, dir + "/tree" );
+    qtree.set_metadata_func( boost::bind( &record_tile, boost::ref( expected ), _1, _2 ) );
+    generate( qtree, 1 );
+  }
+
+  // Builds the tree in two runs, the second of which reads back the
+  // tiles it doesn't write again from the reopened archive
+  for ( int32 run = 0; run < 2; ++run ) {
+    TileArchive archive( filename, true );
+    archive.set_sync_interval( 5 );
+    QuadTreeGenerator qtree( run ? after : before, dir + "/archived" );
+    qtree.set_manifest_file( manifest );
+    if ( run )
+      qtree.set_dirty_bbox( dirty );
+    archive.attach( qtree );
+    generate( qtree, 4 );
+  }
+  EXPECT_FALSE( fs::exists( dir + "/archived" ) );
+
+  TileArchive archive( filename );
+  ASSERT_EQ( expected.size(), archive.size() );
+  for ( map<string, string>::const_iterator it = expected.begin(); it != expected.end(); ++it ) {
+    ImageView<Px> tile, archived;
+    read_image( tile, it->second );
+    boost::shared_ptr<SrcImageResource> resource = archive.open_tile( it->first, ".png" );
+    ASSERT_TRUE( resource.get() ) << it->first;
+    read_image( archived, *resource );
+    ASSERT_EQ( tile.cols(), archived.cols() ) << it->first;
+    ASSERT_EQ( tile.rows(), archived.rows() ) << it->first;
+    for ( int32 row = 0; row < tile.rows(); ++row )
+      for ( int32 col = 0; col < tile.cols(); ++col )
+        EXPECT_EQ( tile( col, row ), archived( col, row ) ) << it->first;
+  }
+  EXPECT_FALSE( archive.open_tile( "", ".jpg" ).get() );
+}
+
+// KML only links to tiles that are files on disk
+TEST( TileArchive, Configs ) {
+  EXPECT_FALSE( QuadTreeConfig::make( "KML" )->supports_tile_archive() );
+  EXPECT_TRUE( QuadTreeConfig::make( "TMS" )->supports_tile_archive() );
+  EXPECT_TRUE( QuadTreeConfig::make( "GMAP" )->supports_tile_archive() );
+  EXPECT_TRUE( QuadTreeConfig::make( "GIGAPAN" )->supports_tile_archive() );
+
+  UnlinkName filename( "TestTileArchive.tiles" );
+  TileArchive archive( filename, true );
+  QuadTreeGenerator qtree( test_image( 10, 10 ), "TestTileArchive.unused" );
+  EXPECT_THROW( archive.attach( qtree, *QuadTreeConfig::make( "KML" ) ), NoImplErr );
+  EXPECT_NO_THROW( archive.attach( qtree, *QuadTreeConfig::make( "TMS" ) ) );
+}
+
+TEST( TileArchive, TileNames ) {
+  EXPECT_EQ( "", TileArchive::tile_name( 0, 0, 0 ) );
+  EXPECT_EQ( "01", TileArchive::tile_name( 2, 1, 0 ) );
+  EXPECT_EQ( "13", TileArchive::tile_name( 2, 3, 1 ) );
+  EXPECT_EQ( "2", TileArchive::tile_name( 1, 0, 1 ) );
+}
+
+TEST( TileArchive, Append ) {
+  UnlinkName filename( "TestTileArchive.tiles" );
+  {
+    TileArchive archive( filename, true );
+    write_tile( archive, "0", "first" );
+    write_tile( archive, "1", "second" );
+  }
+  {
+    TileArchive archive( filename, true );
+    write_tile( archive, "0", "replaced" );
+    write_tile( archive, "23", "third" );
+  }
+
+  TileArchive archive( filename );
+  EXPECT_EQ( 3u, archive.size() );
+  TileArchive::Entry entry;
+  ASSERT_TRUE( archive.find( 1, 0, 0, entry ) );
+  EXPECT_EQ( ".raw", entry.filetype );
+  EXPECT_EQ( "replaced", archived_bytes( filename, entry ) );
+  ASSERT_TRUE( archive.find( "1", entry ) );
+  EXPECT_EQ( "second", archived_bytes( filename, entry ) );
+  ASSERT_TRUE( archive.find( 2, 1, 3, entry ) );
+  EXPECT_EQ( "third", archived_bytes( filename, entry ) );
+  EXPECT_FALSE( archive.find( "3", entry ) );
+  EXPECT_THROW( write_tile( archive, "3", "read only" ), IOErr );
+}
+
+TEST( TileArchive, Recover ) {
+  UnlinkName filename( "TestTileArchive.tiles" );
+  uint64 complete;
+  {
+    TileArchive archive( filename, true );
+    write_tile( archive, "0", "first" );
+    write_tile( archive, "1", "second" );
+    TileArchive::Entry entry;
+    archive.find( "1", entry );
+    complete = entry.offset + entry.size;
+  }
+
+  // An archive that was never closed has no index, and may end in the
+  // middle of a tile
+  fs::resize_file( string( filename ), complete - 3 );
+  {
+    TileArchive archive( filename );
+    EXPECT_EQ( 1u, archive.size() );
+  }
+  {
+    TileArchive archive( filename, true );
+    EXPECT_EQ( 1u, archive.size() );
+    write_tile( archive, "2", "third" );
+  }
+
+  TileArchive archive( filename );
+  EXPECT_EQ( 2u, archive.size() );
+  TileArchive::Entry entry;
+  ASSERT_TRUE( archive.find( "0", entry ) );
+  EXPECT_EQ( "first", archived_bytes( filename, entry ) );
+  ASSERT_TRUE( archive.find( "2", entry ) );
+  EXPECT_EQ( "third", archived_bytes( filename, entry ) );
+  EXPECT_FALSE( archive.find( "1", entry ) );
+
+  UnlinkName other( "TestTileArchive.txt" );
+  ofstream( other.c_str() ) << "not an archive";
+  EXPECT_THROW( TileArchive archive2( other ), IOErr );
+}
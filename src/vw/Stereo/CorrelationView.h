@@ -24,6 +24,7 @@
 #include <vw/Core/Thread.h>
 #include <vw/Image/Algorithms.h>
 #include <vw/Image/ErodeView.h>
+#include <vw/Image/ImagePyramid.h>
 #include <vw/Image/PerPixelAccessorViews.h>
 #include <vw/Image/ImageIO.h>
 #include <vw/FileIO/DiskImageView.h>
@@ -165,8 +165,8 @@ build_image_pyramids(BBox2i const& bbox, int32 const max_pyramid_levels,
 
   // Smooth and downsample to build the pyramid (don't smooth the masks)
   for ( int32 i = 1; i <= max_pyramid_levels; ++i ) {
-    left_pyramid      [i] = subsample(separable_convolution_filter(left_pyramid [i-1],kernel,kernel),2);
-    right_pyramid     [i] = subsample(separable_convolution_filter(right_pyramid[i-1],kernel,kernel),2);
+    left_pyramid      [i] = pyramid_reduce(left_pyramid [i-1],kernel);
+    right_pyramid     [i] = pyramid_reduce(right_pyramid[i-1],kernel);
     left_mask_pyramid [i] = subsample_mask_by_two(left_mask_pyramid [i-1]);
     right_mask_pyramid[i] = subsample_mask_by_two(right_mask_pyramid[i-1]);
     
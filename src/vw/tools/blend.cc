@@ -96,6 +96,7 @@ void do_blend() {
   }
   else {
     vw_out(InfoMessage) << "Blending..." << std::endl;
+    composite.set_num_threads( vw_settings().default_num_threads() );
     write_image( mosaic_name+".blend."+file_type, composite );
     vw_out(InfoMessage) << "Done!" << std::endl;
   }
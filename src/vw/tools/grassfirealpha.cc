@@ -26,6 +26,8 @@
 #include <vw/Image/PixelMath.h>
 #include <vw/Image/Statistics.h>
 #include <vw/Image/Filter.h>
+#include <vw/Image/DistanceTransform.h>
+#include <vw/Image/ConnectedComponents.h>
 #include <vw/FileIO/DiskImageView.h>
 #include <vw/Cartography/GeoReference.h>
 
@@ -34,6 +36,7 @@
 #include <boost/program_options.hpp>
 #include <boost/utility/enable_if.hpp>
 #include <boost/foreach.hpp>
+#include <boost/scoped_ptr.hpp>
 namespace po = boost::program_options;
 
 using namespace vw;
@@ -141,8 +144,24 @@ create_alpha( ImageViewBase<Image1T> const& image1,
   return BinaryPerPixelView<Image1T, Image2T, func_type >(image1.impl(), image2.impl(), func_type());
 }
 
+// Keeps the mask pixels of data regions of at least min_size pixels
+template <class PixelT>
+class KeepLargeRegionsFunc : public ReturnFixedType<PixelT> {
+  ConnectedComponents const& m_regions;
+  uint64 m_min_size;
+public:
+  KeepLargeRegionsFunc( ConnectedComponents const& regions, uint64 min_size )
+    : m_regions(regions), m_min_size(min_size) {}
+
+  inline PixelT operator()( PixelT const& pix, uint32 label ) const {
+    if ( label && m_regions.size( label ) >= m_min_size )
+      return pix;
+    return PixelT();
+  }
+};
+
 struct Options {
-  Options() : nodata(-1), feather_min(0), feather_max(0) {}
+  Options() : nodata(-1), feather_min(0), feather_max(0), euclidean(false), min_region_size(0) {}
   // Input
   std::vector<std::string> input_files;
 
@@ -154,8 +173,54 @@ struct Options {
   std::string output_filename;
   bool force_float;
   float blur_sigma;
+  bool euclidean;
+  uint64 min_region_size;
 };
 
+// Distance from each pixel to the nearest zero pixel of mask. If the
+// user didn't give a feather length it is set to the largest distance.
+template <class MaskT>
+ImageViewRef<float> distance_to_edge( Options& opt, ImageViewBase<MaskT> const& mask ) {
+  // Distances past feather_max are never used, so the Euclidean
+  // distance can be computed a tile at a time without loading the
+  // whole image.
+  if ( opt.euclidean && opt.feather_max >= 1 )
+    return euclidean_distance_view( mask.impl(), opt.feather_max );
+
+  ImageView<float> distance;
+  if ( opt.euclidean )
+    distance = euclidean_distance_transform( mask );
+  else
+    distance = pixel_cast<float>( grassfire( mask ) );
+
+  // Check to see if the user has specified a feather length.  If not,
+  // then we send the feather_max to the max pixel value (which
+  // results in a full grassfire blend all the way to the center of the image.)
+  if (opt.feather_max < 1)
+    opt.feather_max = max_pixel_value( distance );
+  return distance;
+}
+
+// Same as above, but data regions smaller than min_region_size are
+// dropped from the mask first. The regions are kept in the caller's
+// pointer since the returned view may still read them.
+template <class MaskT>
+ImageViewRef<float> feather_distance( Options& opt, ImageViewBase<MaskT> const& mask,
+                                      boost::scoped_ptr<ConnectedComponents>& regions ) {
+  if ( opt.min_region_size == 0 )
+    return distance_to_edge( opt, mask );
+
+  typedef typename MaskT::pixel_type pixel_type;
+  regions.reset( new ConnectedComponents( create_mask( mask.impl() ) ) );
+  vw_out() << "\t--> Found " << regions->num_components() << " data regions.\n";
+
+  typedef ComponentLabelView<UnaryPerPixelView<MaskT, CreatePixelMask<pixel_type> > > label_type;
+  typedef KeepLargeRegionsFunc<pixel_type> func_type;
+  return distance_to_edge( opt, BinaryPerPixelView<MaskT, label_type, func_type>
+                           ( mask.impl(), component_labels( create_mask( mask.impl() ), *regions ),
+                             func_type( *regions, opt.min_region_size ) ) );
+}
+
 // Operation code for data that uses nodata
 template <class PixelT>
 void grassfire_nodata( Options& opt,
@@ -167,15 +232,10 @@ void grassfire_nodata( Options& opt,
   cartography::GeoReference georef;
   cartography::read_georeference(georef, input);
   DiskImageView<PixelT> input_image(input);
-  ImageView<int32> distance =
-    grassfire(notnodata(input_image,
-                        inter_type(opt.nodata)));
-
-  // Check to see if the user has specified a feather length.  If not,
-  // then we send the feather_max to the max pixel value (which
-  // results in a full grassfire blend all the way to the center of the image.)
-  if (opt.feather_max < 1)
-    opt.feather_max = max_pixel_value( distance );
+  boost::scoped_ptr<ConnectedComponents> regions;
+  ImageViewRef<float> distance =
+    feather_distance(opt, notnodata(input_image,
+                                    inter_type(opt.nodata)), regions);
   vw_out() << "\t--> Distance range: [ " << opt.feather_min << " " << opt.feather_max << " ]\n";
 
   ImageViewRef<inter_type> norm_dist;
@@ -214,13 +274,9 @@ void grassfire_alpha( Options& opt,
   cartography::GeoReference georef;
   cartography::read_georeference(georef, input);
   DiskImageView<PixelT> input_image(input);
-  ImageView<int32> distance = grassfire(apply_mask(invert_mask(alpha_to_mask(input_image)),1));
-
-  // Check to see if the user has specified a feather length.  If not,
-  // then we send the feather_max to the max pixel value (which
-  // results in a full grassfire blend all the way to the center of the image.)
-  if (opt.feather_max < 1)
-    opt.feather_max = max_pixel_value( distance );
+  boost::scoped_ptr<ConnectedComponents> regions;
+  ImageViewRef<float> distance =
+    feather_distance(opt, apply_mask(invert_mask(alpha_to_mask(input_image)),1), regions);
   vw_out() << "\t--> Distance range: [ " << opt.feather_min << " " << opt.feather_max << " ]\n";
 
   typedef typename CompoundChannelType<PixelT>::type inter_type;
@@ -259,6 +315,8 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
     ("output-filename,o", po::value(&opt.output_filename), "Output file name. The grassfire weights will be the second band in this file.")
     ("cache",             po::value(&cache_size)->default_value(1024), "Source data cache size, in megabytes.")
     ("blur-sigma",        po::value<float>(&opt.blur_sigma)->default_value(0), "Blur the grassfire result before appyling the tranfer function to create an even smoother blend.")
+    ("min-region-size",   po::value(&opt.min_region_size)->default_value(0), "Data regions with fewer pixels than this are made transparent instead of feathered.")
+    ("euclidean",         "Feather by Euclidean distance instead of grassfire (Manhattan) distance. With a feather-max, images larger than memory can be processed.")
     ("force-float",       "Force the data to be read in as a float.  This option also turns off auto-rescaling.  Useful for reading 16-bit integer DEMs as though they were full of floats.")
     ("help,h",            "Display this help message");
 
@@ -291,6 +349,8 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
     vw_throw( ArgumentErr() << "Missing input files!\n"
               << usage.str() << general_options );
 
+  opt.euclidean = vm.count("euclidean") != 0;
+
   if ( vm.count("force-float") )
     opt.force_float = true;
   else
@@ -25,6 +25,7 @@
 
 #include <vw/tools/image2qtree.h>
 #include <vw/Cartography/GeoReferenceUtils.h>
+#include <vw/Mosaic/TileArchive.h>
 #include <boost/program_options.hpp>
 
 using namespace vw;
@@ -76,6 +77,25 @@ void get_normalize_vals(boost::shared_ptr<DiskImageResource> file,
   cout << "Pixel range for \"" << file->filename() << ": [" << new_lo << " " << new_hi << "]    Output dynamic range: [" << lo_value << " " << hi_value << "]" << endl;
 }
 
+void generate_quadtree(QuadTreeGenerator& quadtree, const QuadTreeConfig* config, const Options& opt,
+                       const ProgressCallback& progress) {
+  if (opt.tile_archive.empty()) {
+    quadtree.generate(progress);
+    return;
+  }
+
+  // The archive replaces the tile writers of the config, so it is
+  // attached after the config has been applied.
+  vw_out() << "Writing tiles to: " << opt.tile_archive << endl;
+  TileArchive archive(opt.tile_archive, true);
+  if (config)
+    archive.attach(quadtree, *config);
+  else
+    archive.attach(quadtree);
+  quadtree.generate(progress);
+  archive.close();
+}
+
 std::vector<GeoReference>
 load_image_georeferences( const Options& opt, int& total_resolution ) {
   std::vector<GeoReference> georeferences;
@@ -184,6 +204,7 @@ int handle_options(int argc, char *argv[], Options& opt) {
   po::options_description general_options("Description: Turns georeferenced image(s) into a quadtree with geographical metadata\n\nGeneral Options");
   general_options.add_options()
     ("output-name,o", po::value(&opt.output_file_name), "Specify the base output directory")
+    ("num-threads",   po::value(&opt.num_threads)->default_value(0), "Number of threads to generate tiles with. If set to 0 (default), use the visionworkbench default number of threads.")
     ("help,h",        po::bool_switch(&opt.help),       "Display this help message");
 
 
@@ -217,6 +238,7 @@ const std::string projection_options_str = "DEFAULT, NONE, SINUSOIDAL, MERCATOR,
     ("jpeg-quality"     , po::value(&opt.jpeg_quality)                           , "JPEG quality factor (0.0 to 1.0)")
     ("png-compression"  , po::value(&opt.png_compression)                        , "PNG compression level (0 to 9)")
     ("tile-size"        , po::value(&opt.tile_size)                              , "Tile size in pixels")
+    ("tile-archive"     , po::value(&opt.tile_archive)                           , "Write the image tiles into this single archive file instead of one file per tile. Metadata files are still written to the output directory.")
     ("max-lod-pixels"   , po::value(&opt.kml.max_lod_pixels)->default_value(1024), "Max LoD in pixels, or -1 for none (kml only)")
     ("draw-order-offset", po::value(&opt.kml.draw_order_offset)->default_value(0), "Offset for the <drawOrder> tag for this overlay (kml only)")
     ("multiband"        , po::bool_switch(&opt.multiband)                        , "Composite images using multi-band blending")
@@ -270,6 +292,9 @@ const std::string projection_options_str = "DEFAULT, NONE, SINUSOIDAL, MERCATOR,
       opt.nodata_set = true;
     
     opt.validate();
+
+    if ( opt.num_threads > 0 )
+      vw_settings().set_default_num_threads(opt.num_threads);
   } catch (const po::error& e) {
     cerr << usage.str() << endl
          << "Failed to parse command line arguments:" << endl
@@ -60,10 +60,12 @@ struct Options {
   Options() :
     output_file_type(""),
     module_name(""),
+    tile_archive(""),
     nudge_x(0), nudge_y(0),
     tile_size(0),
     jpeg_quality(-9999),
     png_compression(99999),
+    num_threads(0),
     pixel_scale(0),
     pixel_offset(0),
     aspect_ratio(1),
@@ -86,10 +88,12 @@ struct Options {
   std::string output_file_name;
   std::string output_file_type;
   std::string module_name;
+  std::string tile_archive;
   double      nudge_x, nudge_y;
   vw::uint32  tile_size;
   float       jpeg_quality;
   vw::uint32  png_compression;
+  vw::int32   num_threads;
   float       pixel_scale, pixel_offset;
   vw::int32   aspect_ratio;
   vw::uint32  global_resolution;
@@ -159,6 +163,12 @@ struct Options {
     if (mode == "CELESTIA" || mode == "UNIVIEW")
       VW_ASSERT(!module_name.empty(),
                 vw::tools::Usage() << "Uniview and Celestia require --module-name");
+    if (!tile_archive.empty()) {
+      VW_ASSERT(!terrain,
+                vw::tools::Usage() << "Uniview terrain tiles cannot be written to a tile archive");
+      VW_ASSERT(mode == "NONE" || vw::mosaic::QuadTreeConfig::make(mode)->supports_tile_archive(),
+                vw::tools::Usage() << mode << " tiles cannot be written to a tile archive, because the metadata refers to the tile files");
+    }
 
     if (proj.type == "NONE")
       VW_ASSERT(input_files.size() == 1,
@@ -184,6 +194,15 @@ void
 get_normalize_vals(boost::shared_ptr<vw::DiskImageResource> file,
                    const Options& opt);
 
+/// Generates the quadtree, writing its tiles into the tile archive
+/// instead of separate files if one was requested.  config is the
+/// config applied to the quadtree, if any.
+void
+generate_quadtree(vw::mosaic::QuadTreeGenerator& quadtree,
+                  const vw::mosaic::QuadTreeConfig* config,
+                  const Options& opt,
+                  const vw::ProgressCallback& progress);
+
 template <class PixelT>
 void do_normal_mosaic(const Options& opt, const vw::ProgressCallback *progress) {
   using namespace vw;
@@ -191,16 +210,18 @@ void do_normal_mosaic(const Options& opt, const vw::ProgressCallback *progress)
   mosaic::QuadTreeGenerator quadtree(img, opt.output_file_name);
   quadtree.set_tile_size( 256 );
   quadtree.set_file_type( "png" );
+  quadtree.set_num_threads( vw_settings().default_num_threads() );
 
+  boost::shared_ptr<mosaic::QuadTreeConfig> config;
   if ( opt.mode != "NONE" ) {
-    boost::shared_ptr<mosaic::QuadTreeConfig> config = mosaic::QuadTreeConfig::make(opt.mode);
+    config = mosaic::QuadTreeConfig::make(opt.mode);
     config->configure( quadtree );
   }
 
   vw_out() << "Generating overlay..." << std::endl;
   vw_out() << "Writing: " << opt.output_file_name << std::endl;
 
-  quadtree.generate( *progress );
+  generate_quadtree( quadtree, config.get(), opt, *progress );
 }
 
 /// Set up the input georeference object from the file or user inputs
@@ -357,6 +378,7 @@ void do_mosaic(const Options& opt, const vw::ProgressCallback *progress) {
             LogicErr() << "Composite image is empty. Georeference calculation is probably incorrect.");
 
   mosaic::QuadTreeGenerator quadtree( composite, opt.output_file_name );
+  quadtree.set_num_threads( vw_settings().default_num_threads() );
 
   // This whole bit here is terrible. This functionality should be moved into the Config base class somehow.
   if( opt.mode == "KML" ) {
@@ -403,7 +425,7 @@ void do_mosaic(const Options& opt, const vw::ProgressCallback *progress) {
   vw_out() << "Generating overlay..." << std::endl;
   vw_out() << "Writing: " << opt.output_file_name << std::endl;
 
-  quadtree.generate(*progress);
+  generate_quadtree(quadtree, config.get(), opt, *progress);
 }
 
 // Define all of the function instantiations here, they are defined in
@@ -73,7 +73,8 @@ struct Options {
   std::string align_method;
   float matcher_threshold, detect_gain, tile_size;
   float inlier_threshold;
-  int   ransac_iterations;
+  int   ransac_iterations, ransac_threads;
+  double ransac_confidence;
   bool  single_scale, debug_images;
   bool  save_intermediate;
 };
@@ -229,6 +230,8 @@ void align_images( Options & opt ) {
       math::RandomSampleConsensus<math::HomographyFittingFunctor, math::InterestPointErrorMetric> 
                   ransac(math::HomographyFittingFunctor(), math::InterestPointErrorMetric(), opt.ransac_iterations, 
                          opt.inlier_threshold, ransac_ip1.size()/2, true);
+      ransac.set_num_threads(opt.ransac_threads > 0 ? opt.ransac_threads : vw_settings().default_num_threads());
+      ransac.set_confidence(opt.ransac_confidence);
       align_matrix = ransac(ransac_ip2, ransac_ip1);
       indices      = ransac.inlier_indices(align_matrix, ransac_ip2, ransac_ip1);
     }
@@ -236,6 +239,8 @@ void align_images( Options & opt ) {
       math::RandomSampleConsensus<math::AffineFittingFunctor, math::InterestPointErrorMetric> 
                   ransac(math::AffineFittingFunctor(), math::InterestPointErrorMetric(), opt.ransac_iterations, 
                          opt.inlier_threshold, ransac_ip1.size()/2, true);
+      ransac.set_num_threads(opt.ransac_threads > 0 ? opt.ransac_threads : vw_settings().default_num_threads());
+      ransac.set_confidence(opt.ransac_confidence);
       align_matrix = ransac(ransac_ip2, ransac_ip1);
       indices      = ransac.inlier_indices(align_matrix, ransac_ip2, ransac_ip1);
     }
@@ -339,6 +344,10 @@ void handle_arguments( int argc, char* argv[], Options& opt ) {
                            "RANSAC inlier threshold.")
     ("ransac-iterations", po::value(&opt.ransac_iterations)->default_value(100), 
                           "Number of RANSAC iterations.")
+    ("ransac-threads", po::value(&opt.ransac_threads)->default_value(1),
+                       "Number of threads for RANSAC. With more than one, or 0 for the default number, the result can change from run to run.")
+    ("ransac-confidence", po::value(&opt.ransac_confidence)->default_value(0),
+                          "Stop RANSAC once the best fit is found with this probability, such as 0.999. If 0 (default), run all the iterations.")
     ("align-method", po::value(&opt.align_method)->default_value("similarity"),
                    "Choose similarity, homography, or epipolar image alignment.");
 
@@ -137,7 +137,8 @@ int main(int argc, char** argv) {
   double      matcher_threshold;
   std::string ransac_constraint, distance_metric_in, output_prefix;
   float       inlier_threshold;
-  int         ransac_iterations;
+  int         ransac_iterations, ransac_threads;
+  double      ransac_confidence;
 
   po::options_description general_options("Options");
   general_options.add_options()
@@ -155,6 +156,10 @@ int main(int argc, char** argv) {
                             "RANSAC inlier threshold.")
     ("ransac-iterations",   po::value(&ransac_iterations)->default_value(100), 
                             "Number of RANSAC iterations.")
+    ("ransac-threads",      po::value(&ransac_threads)->default_value(1),
+                            "Number of threads for RANSAC. With more than one, or 0 for the default number, the result can change from run to run.")
+    ("ransac-confidence",   po::value(&ransac_confidence)->default_value(0),
+                            "Stop RANSAC once the best fit is found with this probability, such as 0.999. If 0 (default), run all the iterations.")
     ("debug-image,d",       "Write out debug images.");
 
   po::options_description hidden_options("");
@@ -274,6 +279,8 @@ int main(int argc, char** argv) {
                       ransac_iterations,
                       inlier_threshold,
                       ransac_ip1.size()/2, true);
+          ransac.set_num_threads(ransac_threads > 0 ? ransac_threads : vw_settings().default_num_threads());
+          ransac.set_confidence(ransac_confidence);
           Matrix<double> H(ransac(ransac_ip1,ransac_ip2));
           std::cout << "\t--> Similarity: " << H << "\n";
           indices = ransac.inlier_indices(H,ransac_ip1,ransac_ip2);
@@ -285,6 +292,8 @@ int main(int argc, char** argv) {
                       ransac_iterations,
                       inlier_threshold,
                       ransac_ip1.size()/2, true);
+          ransac.set_num_threads(ransac_threads > 0 ? ransac_threads : vw_settings().default_num_threads());
+          ransac.set_confidence(ransac_confidence);
           Matrix<double> H(ransac(ransac_ip1,ransac_ip2));
           std::cout << "\t--> Homography: " << H << "\n";
           indices = ransac.inlier_indices(H,ransac_ip1,ransac_ip2);
@@ -296,6 +305,8 @@ int main(int argc, char** argv) {
                       ransac_iterations, 
                       inlier_threshold, 
                       ransac_ip1.size()/2, true );
+          ransac.set_num_threads(ransac_threads > 0 ? ransac_threads : vw_settings().default_num_threads());
+          ransac.set_confidence(ransac_confidence);
           Matrix<double> F(ransac(ransac_ip1,ransac_ip2));
           std::cout << "\t--> Fundamental: " << F << "\n";
           indices = ransac.inlier_indices(F,ransac_ip1,ransac_ip2);